@@ -10,8 +10,16 @@
 // the includes
 //*****************************************************************************
 
+#include <string.h>
 #include "cllc.h"
 
+#if CLLC_DATALOGGER_ENABLE == 1
+static void CLLC_startDataLogCapture(void);
+#endif
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+static void CLLC_countCLAStats(void);
+#endif
+
 //
 //--- System Related Globals ---
 // Put the variables that are specific to control in the below section
@@ -26,6 +34,10 @@ CLLC_Lab_EnumType CLLC_Lab;
 
 CLLC_TripFlag_EnumType CLLC_tripFlag;
 
+#if CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_EVENT
+volatile CLLC_TripEvent CLLC_tripEvent;
+#endif
+
 CLLC_PwmSwState_EnumType CLLC_pwmSwStateActive, CLLC_pwmSwState;
 
 CLLC_PowerFlowState_EnumType CLLC_powerFlowStateActive, CLLC_powerFlowState;
@@ -44,6 +56,11 @@ float32_t CLLC_gvOut;
 float32_t CLLC_gvError;
 float32_t CLLC_gvPartialComputedValue;
 
+#if CLLC_GV_SCHEDULE == 1
+DCL_GSM CLLC_gvSchedule;
+float32_t CLLC_gvScheduleScale;
+#endif
+
 //
 // Flags for clearing trips and closing the loop
 //
@@ -63,6 +80,11 @@ float32_t CLLC_pwmPeriodMax_pu;
 float32_t CLLC_pwmPeriodMax_ticks;
 uint32_t CLLC_pwmPeriod_ticks;
 
+//
+// averages of the sensed signals
+//
+CLLC_AVG_Bank CLLC_avg;
+
 //
 // 1- Primary Side (PFC-Inv/Bus)
 //
@@ -71,19 +93,16 @@ float32_t CLLC_iPrimSensed_pu;
 float32_t CLLC_iPrimSensedOffset_pu;
 float32_t CLLC_iPrimSensedCalIntercept_pu;
 float32_t CLLC_iPrimSensedCalXvariable_pu;
-EMAVG CLLC_iPrimSensedAvg_pu;
 
 float32_t CLLC_iPrimTankSensed_Amps;
 float32_t CLLC_iPrimTankSensed_pu;
 float32_t CLLC_iPrimTankSensedOffset_pu;
 float32_t CLLC_iPrimTankSensedCalIntercept_pu;
 float32_t CLLC_iPrimTankSensedCalXvariable_pu;
-EMAVG CLLC_iPrimTankSensedAvg_pu;
 
 float32_t CLLC_vPrimSensed_Volts;
 float32_t CLLC_vPrimSensed_pu;
 float32_t CLLC_vPrimSensedOffset_pu;
-EMAVG CLLC_vPrimSensedAvg_pu;
 
 float32_t CLLC_vPrimRef_Volts;
 float32_t CLLC_vPrimRef_pu;
@@ -108,7 +127,6 @@ float32_t CLLC_iSecSensed_pu;
 float32_t CLLC_iSecSensedOffset_pu;
 float32_t CLLC_iSecSensedCalIntercept_pu;
 float32_t CLLC_iSecSensedCalXvariable_pu;
-EMAVG CLLC_iSecSensedAvg_pu;
 
 volatile float32_t CLLC_iSecRef_Amps;
 float32_t CLLC_iSecRef_pu;
@@ -121,7 +139,6 @@ float32_t CLLC_vSecSensedOffset_pu;
 float32_t CLLC_vSecRef_Volts;
 float32_t CLLC_vSecRef_pu;
 float32_t CLLC_vSecRefSlewed_pu;
-EMAVG CLLC_vSecSensedAvg_pu;
 
 volatile float32_t CLLC_pwmDutySecRef_pu;
 float32_t CLLC_pwmDutySec_pu;
@@ -139,29 +156,346 @@ float32_t CLLC_pwmPhaseShiftPrimSec_ns;
 int32_t CLLC_pwmPhaseShiftPrimSec_ticks;
 int16_t CLLC_pwmPhaseShiftPrimSec_countDirection;
 
+float32_t CLLC_pwmDutyAPrimFactor;
+float32_t CLLC_pwmDutyASecFactor;
+int32_t CLLC_pwmPhaseShiftPrimSecDelay_ticks;
+
+//
+// factor sets of the references ISR3 took, the count selects the one ISR2
+// takes
+//
+CLLC_PWMFactors CLLC_pwmFactorsSet[2];
+volatile uint16_t CLLC_pwmFactorsCount;
+uint16_t CLLC_pwmFactorsTaken;
+
 
 volatile uint16_t CLLC_pwmISRTrig_ticks;
 
-volatile uint32_t CLLC_cla_task_counter;
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+//
+// ISR2 on the CLA, the copies it works from are owned by the CLA
+//
+CLLC_CLA_Setpoint CLLC_claSetpoint;
+uint16_t CLLC_claClearTripTaken;
+uint16_t CLLC_claPrechargeTaken;
+uint16_t CLLC_claISR2Count;
+#endif
+
+//
+// CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD, an update held back by ISR2 because the
+// zero of PRIM LEG1 was too close, and how often that happened
+//
+volatile uint16_t CLLC_pwmUpdateDeferred;
+volatile uint32_t CLLC_pwmUpdateDeferCount;
 
 volatile uint32_t CLLC_precharge_count;
 
-void CLLC_runISR3(void)
+//
+// SFRA related variables, kept out of the control variables section as SFRA
+// only runs on the C28x
+//
+#pragma SET_DATA_SECTION()
+
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+//
+// setpoints the C28x hands over to ISR2 on the CLA and what it hands back,
+// each side writes one message RAM and only reads the other
+//
+#pragma DATA_SECTION(CLLC_cpuToClaMailbox, "CpuToCla1MsgRAM")
+volatile CLLC_CLA_SetpointMailbox CLLC_cpuToClaMailbox;
+
+#pragma DATA_SECTION(CLLC_claToCpuMailbox, "Cla1ToCpuMsgRAM")
+volatile CLLC_CLA_TelemetryMailbox CLLC_claToCpuMailbox;
+
+CLLC_CLA_Telemetry CLLC_claTelemetry;
+volatile int32_t CLLC_startPrecharge;
+#endif
+
+#if CLLC_SFRA_TYPE != CLLC_SFRA_DISABLED
+
+SFRA_F32 CLLC_sfra1;
+float32_t CLLC_plantMagVect[CLLC_SFRA_FREQ_LENGTH];
+float32_t CLLC_plantPhaseVect[CLLC_SFRA_FREQ_LENGTH];
+float32_t CLLC_olMagVect[CLLC_SFRA_FREQ_LENGTH];
+float32_t CLLC_olPhaseVect[CLLC_SFRA_FREQ_LENGTH];
+float32_t CLLC_clMagVect[CLLC_SFRA_FREQ_LENGTH];
+float32_t CLLC_clPhaseVect[CLLC_SFRA_FREQ_LENGTH];
+float32_t CLLC_freqVect[CLLC_SFRA_FREQ_LENGTH];
+#endif
+
+//
+// Runtime counters, see cllc_stats.h. One block in C28x RAM, found in a RAM
+// dump by the address of CLLC_stats in the .map file.
+//
+CLLC_STATS_Counters CLLC_stats;
+
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+static uint16_t CLLC_statsCLAISR2Count;
+static uint16_t CLLC_statsCLATripFlag;
+#endif
+
+#if CLLC_DATALOGGER_ENABLE == 1
+//
+// Datalogger, the ring ISR2 writes and the samples per channel the
+// background took from it. CLLC_dataLogTriggerSample is the first sample of
+// a channel at or after the trigger, -1 until there is one.
+//
+CLLC_DATALOG_Log CLLC_dataLog;
+volatile CLLC_DATALOG_Record CLLC_dataLogRing[CLLC_DATALOG_RING_SIZE];
+float32_t CLLC_dataLogBuffer[CLLC_DATALOG_CHANNELS]
+                            [CLLC_DATALOG_CAPTURE_SIZE];
+uint16_t CLLC_dataLogBufferCount[CLLC_DATALOG_CHANNELS];
+int16_t CLLC_dataLogTriggerSample[CLLC_DATALOG_CHANNELS];
+volatile uint16_t CLLC_dataLogSoftwareTrigger;
+volatile uint16_t CLLC_dataLogRearm;
+#endif
+
+#if CLLC_TELEMETRY_ENABLE == 1
+//
+// Telemetry stream and its ring of bytes
+//
+CLLC_TELEMETRY_Stream CLLC_telemetry;
+volatile uint16_t CLLC_telemetryRing[CLLC_TELEMETRY_RING_SIZE];
+#endif
+
+#if CLLC_FSI_ENABLE == 1
+//
+// FSI link, the last setpoint taken
+//
+CLLC_FSILINK_Tx CLLC_fsiTx;
+CLLC_FSILINK_Rx CLLC_fsiRx;
+CLLC_FSILINK_Setpoint CLLC_fsiSetpoint;
+#endif
+
+#if CLLC_SHARE_ROLE == CLLC_SHARE_FOLLOWER
+//
+// Current sharing, the last reference taken and the state of the link
+//
+CLLC_FSILINK_Share CLLC_fsiShare;
+CLLC_SHARE_Follower CLLC_shareFollower;
+#endif
+
+#if CLLC_CAN_ENABLE == 1
+//
+// CAN-FD service, the last command of each kind taken
+//
+CLLC_CANLINK_Link CLLC_canLink;
+CLLC_CANLINK_Command CLLC_canCommand;
+uint16_t CLLC_canTickCount;
+
+void CLLC_runCAN(void)
 {
+    CLLC_CANLINK_Report report;
+    uint16_t taken;
 
-    EMAVG_run(&CLLC_iSecSensedAvg_pu, CLLC_iSecSensed_pu);
-    EMAVG_run(&CLLC_iPrimSensedAvg_pu, CLLC_iPrimSensed_pu);
-    EMAVG_run(&CLLC_vSecSensedAvg_pu, CLLC_vSecSensed_pu);
-    EMAVG_run(&CLLC_vPrimSensedAvg_pu, CLLC_vPrimSensed_pu);
+    CLLC_canTickCount++;
+    if(CLLC_canTickCount < CLLC_CAN_TICK_DECIMATION)
+    {
+        return;
+    }
+    CLLC_canTickCount = 0;
+
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+    report.tripFlag = CLLC_claTelemetry.tripFlag;
+#else
+    report.tripFlag = (uint16_t)CLLC_tripFlag.CLLC_TripFlag_Enum;
+#endif
+    report.powerFlowState =
+            (uint16_t)CLLC_powerFlowStateActive.CLLC_PowerFlowState_Enum;
+    report.closeGvLoop = (CLLC_closeGvLoop != 0) ? 1U : 0U;
+    report.closeGiLoop = (CLLC_closeGiLoop != 0) ? 1U : 0U;
+    report.vPrimSensed_Volts = CLLC_vPrimSensed_Volts;
+    report.vSecSensed_Volts = CLLC_vSecSensed_Volts;
+    report.iPrimSensed_Amps = CLLC_iPrimSensed_Amps;
+    report.iSecSensed_Amps = CLLC_iSecSensed_Amps;
+    report.vSecRef_Volts = CLLC_vSecRef_Volts;
+    report.iSecRef_Amps = CLLC_iSecRef_Amps;
+    report.pwmFrequency_Hz = CLLC_ISR2_OUTPUT(pwmFrequency_Hz);
+    report.gvOut = CLLC_ISR2_OUTPUT(gvOut);
+    report.giOut = CLLC_ISR2_OUTPUT(giOut);
+
+    taken = CLLC_CANLINK_run(&CLLC_canLink, &report, &CLLC_canCommand);
+
+    if((taken & CLLC_CANLINK_TAKEN_SETPOINT) != 0U)
+    {
+        CLLC_vSecRef_Volts = CLLC_canCommand.setpoint.vSecRef_Volts;
+        CLLC_iSecRef_Amps = CLLC_canCommand.setpoint.iSecRef_Amps;
+        CLLC_pwmFrequencyRef_Hz =
+                CLLC_canCommand.setpoint.pwmFrequencyRef_Hz;
+    }
+    if((taken & CLLC_CANLINK_TAKEN_ENABLE) != 0U)
+    {
+        CLLC_closeGvLoop = ((CLLC_canCommand.enable &
+                             CLLC_CANLINK_ENABLE_GV_LOOP) != 0U) ? 1 : 0;
+        CLLC_closeGiLoop = ((CLLC_canCommand.enable &
+                             CLLC_CANLINK_ENABLE_GI_LOOP) != 0U) ? 1 : 0;
+        if((CLLC_canCommand.enable & CLLC_CANLINK_ENABLE_CLEAR_TRIP) != 0U)
+        {
+            CLLC_clearTrip = 1;
+        }
+    }
+}
+#endif
+
+#if CLLC_ADC_CALIBRATION == 1
+//
+// ADC calibration of the four ISR2 readings, the self calibration of the
+// currents
+//
+CLLC_ADCCAL_Channel CLLC_iPrimADCCal;
+CLLC_ADCCAL_Channel CLLC_iSecADCCal;
+CLLC_ADCCAL_Channel CLLC_vPrimADCCal;
+CLLC_ADCCAL_Channel CLLC_vSecADCCal;
+CLLC_ADCCAL_SelfCal CLLC_iPrimADCSelfCal;
+CLLC_ADCCAL_SelfCal CLLC_iSecADCSelfCal;
+uint16_t CLLC_adcSelfCalDone;
+
+void CLLC_setupADCCalibration(void)
+{
+    CLLC_ADCCAL_config(&CLLC_iPrimADCCal, CLLC_ADC_PU_SCALE_FACTOR,
+                       CLLC_IPRIM_SENSE_CHAIN_GAIN,
+                       CLLC_iPrimSensedOffset_pu,
+                       CLLC_iPrimSensedCalXvariable_pu,
+                       CLLC_iPrimSensedCalIntercept_pu, 1);
+    CLLC_ADCCAL_config(&CLLC_iSecADCCal, CLLC_ADC_PU_SCALE_FACTOR,
+                       CLLC_ISEC_SENSE_CHAIN_GAIN,
+                       CLLC_iSecSensedOffset_pu,
+                       CLLC_iSecSensedCalXvariable_pu,
+                       CLLC_iSecSensedCalIntercept_pu, CLLC_ADC_OVERSAMPLE);
+    CLLC_ADCCAL_config(&CLLC_vPrimADCCal, CLLC_ADC_PU_SCALE_FACTOR,
+                       CLLC_VPRIM_SENSE_CHAIN_GAIN,
+                       CLLC_vPrimSensedOffset_pu, 1.0f, 0.0f, 1);
+    CLLC_ADCCAL_config(&CLLC_vSecADCCal, CLLC_ADC_PU_SCALE_FACTOR,
+                       CLLC_VSEC_SENSE_CHAIN_GAIN,
+                       CLLC_vSecSensedOffset_pu, 1.0f, 0.0f,
+                       CLLC_ADC_OVERSAMPLE);
+
+    CLLC_HAL_setADCZero(CLLC_IPRIM_ADC_MODULE, CLLC_IPRIM_ADC_PPB,
+                        CLLC_iPrimADCCal.zero);
+    CLLC_HAL_setADCZero(CLLC_ISEC_ADC_MODULE, CLLC_ISEC_ADC_PPB,
+                        CLLC_iSecADCCal.zero);
+    CLLC_HAL_setADCZero(CLLC_VPRIM_ADC_MODULE, CLLC_VPRIM_ADC_PPB,
+                        CLLC_vPrimADCCal.zero);
+    CLLC_HAL_setADCZero(CLLC_VSEC_ADC_MODULE, CLLC_VSEC_ADC_PPB,
+                        CLLC_vSecADCCal.zero);
+
+    CLLC_ADCCAL_startSelfCal(&CLLC_iPrimADCSelfCal, CLLC_ADC_SELFCAL_SAMPLES);
+    CLLC_ADCCAL_startSelfCal(&CLLC_iSecADCSelfCal, CLLC_ADC_SELFCAL_SAMPLES);
+    CLLC_adcSelfCalDone = 0;
+}
 
-    CLLC_vPrimSensed_Volts = CLLC_vPrimSensedAvg_pu.out *
-                             CLLC_VPRIM_MAX_SENSE_VOLTS;
-    CLLC_vSecSensed_Volts = CLLC_vSecSensedAvg_pu.out *
-                             CLLC_VSEC_OPTIMAL_RANGE_VOLTS;
-    CLLC_iPrimSensed_Amps = CLLC_iPrimSensedAvg_pu.out *
-                             CLLC_IPRIM_MAX_SENSE_AMPS;
-    CLLC_iSecSensed_Amps = CLLC_iSecSensedAvg_pu.out *
-                            CLLC_ISEC_MAX_SENSE_AMPS;
+void CLLC_runADCSelfCal(void)
+{
+    uint16_t done;
+
+    if(CLLC_adcSelfCalDone != 0U)
+    {
+        return;
+    }
+
+    if(CLLC_HAL_isPowerStageTripped() == 0U)
+    {
+        CLLC_ADCCAL_startSelfCal(&CLLC_iPrimADCSelfCal,
+                                 CLLC_ADC_SELFCAL_SAMPLES);
+        CLLC_ADCCAL_startSelfCal(&CLLC_iSecADCSelfCal,
+                                 CLLC_ADC_SELFCAL_SAMPLES);
+        return;
+    }
+
+    done = CLLC_ADCCAL_addSelfCalSample(&CLLC_iPrimADCSelfCal,
+                                        CLLC_IPRIM_ADCREAD);
+    done &= CLLC_ADCCAL_addSelfCalSample(&CLLC_iSecADCSelfCal,
+                                         CLLC_ISEC_ADCREAD_1);
+    if(done == 0U)
+    {
+        return;
+    }
+
+    CLLC_ADCCAL_setZero(&CLLC_iPrimADCCal,
+                        CLLC_ADCCAL_getSelfCalZero(&CLLC_iPrimADCSelfCal));
+    CLLC_ADCCAL_setZero(&CLLC_iSecADCCal,
+                        CLLC_ADCCAL_getSelfCalZero(&CLLC_iSecADCSelfCal));
+    CLLC_HAL_setADCZero(CLLC_IPRIM_ADC_MODULE, CLLC_IPRIM_ADC_PPB,
+                        CLLC_iPrimADCCal.zero);
+    CLLC_HAL_setADCZero(CLLC_ISEC_ADC_MODULE, CLLC_ISEC_ADC_PPB,
+                        CLLC_iSecADCCal.zero);
+    CLLC_adcSelfCalDone = 1;
+}
+#endif
+
+#if CLLC_PHASES > 1
+//
+// the interleaved phases, phase 0 first
+//
+CLLC_PHASE_Instance CLLC_phase[CLLC_PHASES];
+
+void CLLC_setupPhases(void)
+{
+    uint16_t i;
+
+    CLLC_PHASE_init(&CLLC_phase[0], 0, CLLC_PHASES,
+                    CLLC_PRIM_LEG1_PWM_BASE, CLLC_PRIM_LEG2_PWM_BASE,
+                    CLLC_SEC_LEG1_PWM_BASE, CLLC_SEC_LEG2_PWM_BASE,
+                    CLLC_ISEC_ADCRESULTREGBASE, CLLC_ISEC_ADC_SOC_NO_1);
+    CLLC_PHASE_init(&CLLC_phase[1], 1, CLLC_PHASES,
+                    CLLC_PHASE1_PRIM_LEG1_PWM_BASE,
+                    CLLC_PHASE1_PRIM_LEG2_PWM_BASE,
+                    CLLC_PHASE1_SEC_LEG1_PWM_BASE,
+                    CLLC_PHASE1_SEC_LEG2_PWM_BASE,
+                    CLLC_PHASE1_ISEC_ADCRESULTREGBASE,
+                    CLLC_PHASE1_ISEC_ADC_SOC_NO);
+
+    for(i = 1; i < CLLC_PHASES; i++)
+    {
+        CLLC_HAL_setupPhasePWM(&CLLC_phase[i]);
+    }
+}
+#endif
+
+void CLLC_runISR3(void)
+{
+    float32_t avgIn[CLLC_AVG_CHANNELS];
+    float32_t avgValue[CLLC_AVG_CHANNELS];
+
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+    CLLC_receiveCLATelemetry();
+    CLLC_countCLAStats();
+#if CLLC_DATALOGGER_ENABLE == 1
+    CLLC_runDataLog();
+#endif
+#endif
+
+#if CLLC_FSI_ENABLE == 1
+#if CLLC_SHARE_ROLE == CLLC_SHARE_FOLLOWER
+    CLLC_runShareRx();
+#else
+    CLLC_runFSIRx();
+#endif
+#if CLLC_SHARE_ROLE == CLLC_SHARE_MASTER
+    CLLC_runShareTx();
+#elif CLLC_ISR2_RUNNING_ON == CLA_CORE
+    CLLC_runFSITx();
+#endif
+#endif
+
+#if CLLC_TELEMETRY_ENABLE == 1
+    CLLC_runTelemetry();
+#endif
+
+#if CLLC_CAN_ENABLE == 1
+    CLLC_runCAN();
+#endif
+
+    avgIn[CLLC_AVG_ISEC] = CLLC_ISR2_OUTPUT(iSecSensed_pu);
+    avgIn[CLLC_AVG_IPRIM] = CLLC_ISR2_OUTPUT(iPrimSensed_pu);
+    avgIn[CLLC_AVG_VSEC] = CLLC_ISR2_OUTPUT(vSecSensed_pu);
+    avgIn[CLLC_AVG_VPRIM] = CLLC_ISR2_OUTPUT(vPrimSensed_pu);
+    CLLC_AVG_run(&CLLC_avg, avgIn, avgValue);
+
+    CLLC_vPrimSensed_Volts = avgValue[CLLC_AVG_VPRIM];
+    CLLC_vSecSensed_Volts = avgValue[CLLC_AVG_VSEC];
+    CLLC_iPrimSensed_Amps = avgValue[CLLC_AVG_IPRIM];
+    CLLC_iSecSensed_Amps = avgValue[CLLC_AVG_ISEC];
 
     #if CLLC_CONTROL_MODE == CLLC_VOLTAGE_MODE
 
@@ -169,11 +503,20 @@ void CLLC_runISR3(void)
             CLLC_vSecRef_pu = CLLC_vSecRef_Volts /
                                CLLC_VSEC_OPTIMAL_RANGE_VOLTS;
 
-            if((CLLC_vSecRef_pu - CLLC_vSecRefSlewed_pu) >
+            //
+            // while the loop is open the reference sits on the output, the
+            // loop then closes without a step and slews from there
+            //
+            if(CLLC_closeGvLoop == 0)
+            {
+                CLLC_vSecRefSlewed_pu = CLLC_ISR2_OUTPUT(vSecSensed_pu);
+            }
+            else if((CLLC_vSecRef_pu - CLLC_vSecRefSlewed_pu) >
                 (2.0 * CLLC_VOLTS_PER_SECOND_SLEW /
                         CLLC_VSEC_OPTIMAL_RANGE_VOLTS) *
                 (1.0 / (float32_t)CLLC_ISR3_FREQUENCY_HZ))
             {
+                CLLC_STATS_COUNT(refSlewLimits);
                 CLLC_vSecRefSlewed_pu = CLLC_vSecRefSlewed_pu +
                         ((CLLC_VOLTS_PER_SECOND_SLEW /
                                 CLLC_VSEC_OPTIMAL_RANGE_VOLTS) *
@@ -184,6 +527,7 @@ void CLLC_runISR3(void)
                             CLLC_VSEC_OPTIMAL_RANGE_VOLTS)
                     * (1.0 / (float32_t)CLLC_ISR3_FREQUENCY_HZ))
             {
+                CLLC_STATS_COUNT(refSlewLimits);
                 CLLC_vSecRefSlewed_pu = CLLC_vSecRefSlewed_pu -
                         ((CLLC_VOLTS_PER_SECOND_SLEW /
                                 CLLC_VSEC_OPTIMAL_RANGE_VOLTS) *
@@ -202,6 +546,7 @@ void CLLC_runISR3(void)
                         CLLC_VPRIM_MAX_SENSE_VOLTS)
                 * (1.0 / (float32_t)CLLC_ISR3_FREQUENCY_HZ))
             {
+                CLLC_STATS_COUNT(refSlewLimits);
                 CLLC_vPrimRefSlewed_pu = CLLC_vPrimRefSlewed_pu +
                         ((CLLC_VOLTS_PER_SECOND_SLEW /
                                 CLLC_VPRIM_MAX_SENSE_VOLTS) *
@@ -212,6 +557,7 @@ void CLLC_runISR3(void)
                             CLLC_VPRIM_MAX_SENSE_VOLTS)
                  * (1.0 / (float32_t)CLLC_ISR3_FREQUENCY_HZ))
             {
+                CLLC_STATS_COUNT(refSlewLimits);
                 CLLC_vPrimRefSlewed_pu = CLLC_vPrimRefSlewed_pu -
                         ((CLLC_VOLTS_PER_SECOND_SLEW /
                                 CLLC_VPRIM_MAX_SENSE_VOLTS) *
@@ -225,10 +571,15 @@ void CLLC_runISR3(void)
     #else
         CLLC_iSecRef_pu = CLLC_iSecRef_Amps / CLLC_ISEC_MAX_SENSE_AMPS;
 
-        if((CLLC_iSecRef_pu - CLLC_iSecRefSlewed_pu) >
+        if(CLLC_closeGiLoop == 0)
+        {
+            CLLC_iSecRefSlewed_pu = CLLC_ISR2_OUTPUT(iSecSensed_pu);
+        }
+        else if((CLLC_iSecRef_pu - CLLC_iSecRefSlewed_pu) >
             (2.0 * CLLC_AMPS_PER_SECOND_SLEW / CLLC_ISEC_MAX_SENSE_AMPS) *
             (1.0 / (float32_t)CLLC_ISR3_FREQUENCY_HZ))
         {
+            CLLC_STATS_COUNT(refSlewLimits);
             CLLC_iSecRefSlewed_pu = CLLC_iSecRefSlewed_pu +
               ((CLLC_AMPS_PER_SECOND_SLEW / CLLC_ISEC_MAX_SENSE_AMPS) *
                (1.0 / (float32_t)CLLC_ISR3_FREQUENCY_HZ));
@@ -238,6 +589,7 @@ void CLLC_runISR3(void)
                      CLLC_ISEC_MAX_SENSE_AMPS) *
                (1.0 / (float32_t)CLLC_ISR3_FREQUENCY_HZ))
         {
+            CLLC_STATS_COUNT(refSlewLimits);
             CLLC_iSecRefSlewed_pu = CLLC_iSecRefSlewed_pu -
                  ((CLLC_AMPS_PER_SECOND_SLEW / CLLC_ISEC_MAX_SENSE_AMPS) *
                  (1.0 / (float32_t)CLLC_ISR3_FREQUENCY_HZ));
@@ -248,6 +600,8 @@ void CLLC_runISR3(void)
         }
     #endif
 
+    CLLC_takePWMReferences();
+
     CLLC_calculatePWMDeadBandPrimTicks();
 
     CLLC_HAL_updatePWMDeadBandPrim(CLLC_pwmDeadBandREDPrim_ticks,
@@ -270,7 +624,7 @@ void CLLC_initGlobalVariables(void)
     #endif
 
     DCL_resetDF13(&CLLC_gi);
-    #if CLLC_SEC_CONNECTED_IN_BATTERY_EMULATION_MODE == 1
+    #if CLLC_TEST_SETUP == CLLC_TEST_SETUP_EMULATED_BATTERY
         CLLC_gi.a1 = CLLC_GI2_2P2Z_A1;
         CLLC_gi.a2 = CLLC_GI2_2P2Z_A2;
         CLLC_gi.a3 = CLLC_GI2_2P2Z_A3;
@@ -307,28 +661,153 @@ void CLLC_initGlobalVariables(void)
         CLLC_gv.b3 = CLLC_GV2_2P2Z_B3;
     #endif
 
-//     DLOG_4CH_reset(&dLog1);
-//     DLOG_4CH_config(&dLog1,
-//                     &dVal1, &dVal2, &dVal3, &dVal4,
-//                     dBuff1, dBuff2, dBuff3, dBuff4,
-//                     100, 0.5, 1);
-
-//     dlogTrigger = 0;
-
-    EMAVG_reset(&CLLC_iSecSensedAvg_pu);
-    EMAVG_config(&CLLC_iSecSensedAvg_pu, 0.01);
+#if CLLC_GV_SCHEDULE == 1
+    {
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_PRIM_SEC
+        const float32_t gain[GSM_N + 1] = CLLC_GV1_SCHEDULE_GAINS;
+    #else
+        const float32_t gain[GSM_N + 1] = CLLC_GV2_SCHEDULE_GAINS;
+    #endif
 
-    EMAVG_reset(&CLLC_iPrimSensedAvg_pu);
-    EMAVG_config(&CLLC_iPrimSensedAvg_pu, 0.01);
+        CLLC_GVSCHED_init(&CLLC_gvSchedule, gain);
+        CLLC_gvScheduleScale = 1.0f / (1.0f -
+                                       (CLLC_MIN_PWM_SWITCHING_FREQUENCY_HZ /
+                                        CLLC_MAX_PWM_SWITCHING_FREQUENCY_HZ));
+    }
+#endif
+
+#if CLLC_DATALOGGER_ENABLE == 1
+    CLLC_DATALOG_config(&CLLC_dataLog, CLLC_dataLogRing,
+                        CLLC_DATALOG_RING_SIZE, CLLC_DATALOG_PRE_TRIGGER,
+                        CLLC_DATALOG_POST_TRIGGER);
+    CLLC_DATALOG_setChannel(&CLLC_dataLog, 0, &CLLC_DATALOG_CH0,
+                            CLLC_DATALOG_CH0_DECIMATION);
+#if CLLC_DATALOG_CHANNELS > 1
+    CLLC_DATALOG_setChannel(&CLLC_dataLog, 1, &CLLC_DATALOG_CH1,
+                            CLLC_DATALOG_CH1_DECIMATION);
+#endif
+#if CLLC_DATALOG_CHANNELS > 2
+    CLLC_DATALOG_setChannel(&CLLC_dataLog, 2, &CLLC_DATALOG_CH2,
+                            CLLC_DATALOG_CH2_DECIMATION);
+#endif
+#if CLLC_DATALOG_CHANNELS > 3
+    CLLC_DATALOG_setChannel(&CLLC_dataLog, 3, &CLLC_DATALOG_CH3,
+                            CLLC_DATALOG_CH3_DECIMATION);
+#endif
+    CLLC_DATALOG_setTrigger(&CLLC_dataLog, CLLC_DATALOG_TRIGGER_SOURCES,
+                            CLLC_DATALOG_TRIGGER_CHANNEL,
+                            CLLC_DATALOG_TRIGGER_LEVEL);
+    CLLC_dataLogSoftwareTrigger = 0;
+    CLLC_dataLogRearm = 0;
+    CLLC_startDataLogCapture();
+#endif
+
+#if CLLC_TELEMETRY_ENABLE == 1
+    CLLC_TELEMETRY_config(&CLLC_telemetry, CLLC_telemetryRing,
+                          CLLC_TELEMETRY_RING_SIZE,
+                          (uint32_t)CLLC_ISR3_FREQUENCY_HZ,
+                          CLLC_TELEMETRY_DECIMATION,
+                          CLLC_TELEMETRY_SCHEMA_PERIOD);
+    CLLC_TELEMETRY_addVariable(&CLLC_telemetry, CLLC_TELEMETRY_VAR0_NAME,
+                               &CLLC_TELEMETRY_VAR0);
+#if CLLC_TELEMETRY_VARIABLES > 1
+    CLLC_TELEMETRY_addVariable(&CLLC_telemetry, CLLC_TELEMETRY_VAR1_NAME,
+                               &CLLC_TELEMETRY_VAR1);
+#endif
+#if CLLC_TELEMETRY_VARIABLES > 2
+    CLLC_TELEMETRY_addVariable(&CLLC_telemetry, CLLC_TELEMETRY_VAR2_NAME,
+                               &CLLC_TELEMETRY_VAR2);
+#endif
+#if CLLC_TELEMETRY_VARIABLES > 3
+    CLLC_TELEMETRY_addVariable(&CLLC_telemetry, CLLC_TELEMETRY_VAR3_NAME,
+                               &CLLC_TELEMETRY_VAR3);
+#endif
+#if CLLC_TELEMETRY_STATS == 1
+    CLLC_TELEMETRY_addCounter(&CLLC_telemetry, "isr1Retrig",
+                              &CLLC_stats.isr1Retriggers);
+    CLLC_TELEMETRY_addCounter(&CLLC_telemetry, "isr2Overrun",
+                              &CLLC_stats.isr2Overruns);
+    CLLC_TELEMETRY_addCounter(&CLLC_telemetry, "isr3Overrun",
+                              &CLLC_stats.isr3Overruns);
+    CLLC_TELEMETRY_addCounter(&CLLC_telemetry, "primOC",
+                              &CLLC_stats.tripPrimOverCurrent);
+    CLLC_TELEMETRY_addCounter(&CLLC_telemetry, "secOC",
+                              &CLLC_stats.tripSecOverCurrent);
+    CLLC_TELEMETRY_addCounter(&CLLC_telemetry, "tankOC",
+                              &CLLC_stats.tripPrimTankOverCurrent);
+#endif
+#endif
+
+#if CLLC_FSI_ENABLE == 1
+    {
+        CLLC_FSILINK_Setpoint setpointMin;
+        CLLC_FSILINK_Setpoint setpointMax;
+
+        setpointMin.vSecRef_Volts = CLLC_FSI_VSEC_REF_MIN_VOLTS;
+        setpointMin.iSecRef_Amps = CLLC_FSI_ISEC_REF_MIN_AMPS;
+        setpointMin.pwmFrequencyRef_Hz = CLLC_FSI_PWM_FREQUENCY_MIN_HZ;
+        setpointMax.vSecRef_Volts = CLLC_FSI_VSEC_REF_MAX_VOLTS;
+        setpointMax.iSecRef_Amps = CLLC_FSI_ISEC_REF_MAX_AMPS;
+        setpointMax.pwmFrequencyRef_Hz = CLLC_FSI_PWM_FREQUENCY_MAX_HZ;
+
+        CLLC_FSILINK_initTx(&CLLC_fsiTx);
+        CLLC_FSILINK_initRx(&CLLC_fsiRx, &setpointMin, &setpointMax);
+    }
+#endif
 
-    EMAVG_reset(&CLLC_iPrimTankSensedAvg_pu);
-    EMAVG_config(&CLLC_iPrimTankSensedAvg_pu, 0.01);
+#if CLLC_SHARE_ROLE == CLLC_SHARE_FOLLOWER
+    CLLC_fsiShare.iSecRef_pu = 0;
+    CLLC_fsiShare.vSecRef_pu = CLLC_VSEC_NOMINAL_VOLTS /
+                               CLLC_VSEC_OPTIMAL_RANGE_VOLTS;
+    CLLC_SHARE_initFollower(&CLLC_shareFollower, CLLC_fsiShare.vSecRef_pu,
+                            CLLC_SHARE_TRIM_GAIN, CLLC_SHARE_TRIM_MAX_PU,
+                            CLLC_SHARE_TIMEOUT_POLLS,
+                            CLLC_SHARE_RECOVER_FRAMES);
+#endif
 
-    EMAVG_reset(&CLLC_vPrimSensedAvg_pu);
-    EMAVG_config(&CLLC_vPrimSensedAvg_pu, 0.01);
+#if CLLC_CAN_ENABLE == 1
+    {
+        CLLC_CANLINK_Setpoint setpointMin;
+        CLLC_CANLINK_Setpoint setpointMax;
+        uint16_t period_ticks[CLLC_CANLINK_REPORTS];
+
+        setpointMin.vSecRef_Volts = CLLC_CAN_VSEC_REF_MIN_VOLTS;
+        setpointMin.iSecRef_Amps = CLLC_CAN_ISEC_REF_MIN_AMPS;
+        setpointMin.pwmFrequencyRef_Hz = CLLC_CAN_PWM_FREQUENCY_MIN_HZ;
+        setpointMax.vSecRef_Volts = CLLC_CAN_VSEC_REF_MAX_VOLTS;
+        setpointMax.iSecRef_Amps = CLLC_CAN_ISEC_REF_MAX_AMPS;
+        setpointMax.pwmFrequencyRef_Hz = CLLC_CAN_PWM_FREQUENCY_MAX_HZ;
+
+        period_ticks[CLLC_CANLINK_REPORT_STATUS] =
+                CLLC_CAN_STATUS_PERIOD_TICKS;
+        period_ticks[CLLC_CANLINK_REPORT_MEASUREMENTS] =
+                CLLC_CAN_MEASUREMENTS_PERIOD_TICKS;
+        period_ticks[CLLC_CANLINK_REPORT_LOOP] = CLLC_CAN_LOOP_PERIOD_TICKS;
+
+        //
+        // periods that make no schedule leave every report off
+        //
+        if(CLLC_CANLINK_config(&CLLC_canLink, CLLC_CAN_BASE,
+                               CLLC_CAN_BASE_ID, period_ticks, &setpointMin,
+                               &setpointMax) == 0U)
+        {
+            CLLC_canLink.schedule.slot[0] = 0;
+            CLLC_canLink.schedule.length = 1;
+            CLLC_canLink.schedule.index = 0;
+        }
+        CLLC_canCommand.enable = 0;
+        CLLC_canTickCount = 0;
+    }
+#endif
 
-    EMAVG_reset(&CLLC_vSecSensedAvg_pu);
-    EMAVG_config(&CLLC_vSecSensedAvg_pu, 0.01);
+    CLLC_AVG_config(&CLLC_avg, CLLC_AVG_ISEC, CLLC_AVG_ISEC_MULTIPLIER,
+                    CLLC_ISEC_MAX_SENSE_AMPS);
+    CLLC_AVG_config(&CLLC_avg, CLLC_AVG_IPRIM, CLLC_AVG_IPRIM_MULTIPLIER,
+                    CLLC_IPRIM_MAX_SENSE_AMPS);
+    CLLC_AVG_config(&CLLC_avg, CLLC_AVG_VSEC, CLLC_AVG_VSEC_MULTIPLIER,
+                    CLLC_VSEC_OPTIMAL_RANGE_VOLTS);
+    CLLC_AVG_config(&CLLC_avg, CLLC_AVG_VPRIM, CLLC_AVG_VPRIM_MULTIPLIER,
+                    CLLC_VPRIM_MAX_SENSE_VOLTS);
 
     CLLC_iPrimSensed_Amps = 0;
     CLLC_vPrimSensed_Volts = 0;
@@ -340,6 +819,10 @@ void CLLC_initGlobalVariables(void)
                        CLLC_VSEC_OPTIMAL_RANGE_VOLTS;
     CLLC_vSecRefSlewed_pu = 0;
 
+    CLLC_iSecRef_Amps = CLLC_ISEC_NOMINAL_AMPS;
+    CLLC_iSecRef_pu = CLLC_ISEC_NOMINAL_AMPS / CLLC_ISEC_MAX_SENSE_AMPS;
+    CLLC_iSecRefSlewed_pu = 0;
+
     CLLC_vPrimRef_Volts = CLLC_VPRIM_NOMINAL_VOLTS;
     CLLC_vPrimRef_pu = CLLC_VPRIM_NOMINAL_VOLTS /
                         CLLC_VPRIM_MAX_SENSE_VOLTS;
@@ -356,6 +839,8 @@ void CLLC_initGlobalVariables(void)
     CLLC_pwmFrequencyRef_Hz = CLLC_NOMINAL_PWM_SWITCHING_FREQUENCY_HZ;
     CLLC_pwmFrequency_Hz = CLLC_NOMINAL_PWM_SWITCHING_FREQUENCY_HZ;
     CLLC_pwmFrequencyPrev_Hz = CLLC_pwmFrequency_Hz - 1.0;
+    CLLC_pwmISRTrig_ticks = CLLC_HAL_getISR1TriggerTicks(
+                                                CLLC_pwmFrequencyPrev_Hz);
 
     CLLC_pwmPhaseShiftPrimSec_ns = 81;
     CLLC_pwmPhaseShiftPrimSecRef_ns = 81;
@@ -382,6 +867,9 @@ void CLLC_initGlobalVariables(void)
         CLLC_pwmDutyPrimRef_pu = 0.5;
         CLLC_pwmDutySec_pu = 0.45;
         CLLC_pwmDutySecRef_pu = 0.45;
+
+        CLLC_calculatePWMDutyPhaseShiftFactors_primToSecPowerFlow(
+                &CLLC_pwmFactorsSet[0]);
     }
     else if(CLLC_powerFlowState.CLLC_PowerFlowState_Enum ==
             CLLC_powerFlow_SecToPrim)
@@ -390,8 +878,18 @@ void CLLC_initGlobalVariables(void)
         CLLC_pwmDutyPrimRef_pu = 0.45;
         CLLC_pwmDutySec_pu = 0.5;
         CLLC_pwmDutySecRef_pu = 0.5;
+
+        CLLC_calculatePWMDutyPhaseShiftFactors_secToPrimPowerFlow(
+                &CLLC_pwmFactorsSet[0]);
     }
 
+    //
+    // ISR2 starts from the factors of the initial references
+    //
+    CLLC_pwmFactorsCount = 0;
+    CLLC_pwmFactorsTaken = 0;
+    CLLC_setPWMDutyPhaseShiftFactors(&CLLC_pwmFactorsSet[0]);
+
     CLLC_iSecSensedCalIntercept_pu = -0.00026;
     CLLC_iSecSensedCalXvariable_pu = 0.882981;
 
@@ -408,6 +906,13 @@ void CLLC_initGlobalVariables(void)
 
 //     commandSentTo_AC_DC.CommandSentTo_AC_DC_Enum = ac_dc_OFF;
     CLLC_tripFlag.CLLC_TripFlag_Enum = CLLC_noTrip;
+#if CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_EVENT
+    CLLC_tripEvent.cause = (uint16_t)CLLC_noTrip;
+    CLLC_tripEvent.source = 0;
+    CLLC_tripEvent.isr2Count = 0;
+    CLLC_tripEvent.isr2Cycles = 0;
+    CLLC_tripEvent.events = 0;
+#endif
 
 //     slewSCIcommand = 0;
     CLLC_vPrimRef_Volts = 400;
@@ -416,30 +921,22 @@ void CLLC_initGlobalVariables(void)
     CLLC_closeGvLoop = 0;
     CLLC_clearTrip = 0;
 
-    CLLC_cla_task_counter = 0;
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+    memset(&CLLC_claSetpoint, 0, sizeof(CLLC_claSetpoint));
+    memset(&CLLC_claTelemetry, 0, sizeof(CLLC_claTelemetry));
+    CLLC_claClearTripTaken = 0;
+    CLLC_claPrechargeTaken = 0;
+    CLLC_claISR2Count = 0;
+    CLLC_startPrecharge = 0;
+    CLLC_statsCLAISR2Count = 0;
+    CLLC_statsCLATripFlag = (uint16_t)CLLC_noTrip;
+#endif
 
-}
+    CLLC_STATS_reset(&CLLC_stats);
 
-void CLLC_updateBoardStatus(void)
-{
-    int16_t tripStatusRead;
-    tripStatusRead = CLLC_HAL_readTripFlags();
+    CLLC_pwmUpdateDeferred = 0;
+    CLLC_pwmUpdateDeferCount = 0;
 
-    if(CLLC_tripFlag.CLLC_TripFlag_Enum == CLLC_noTrip)
-    {
-        if(tripStatusRead == (int16_t)CLLC_primOverCurrentTrip)
-        {
-            CLLC_tripFlag.CLLC_TripFlag_Enum = CLLC_primOverCurrentTrip;
-        }
-        else if(tripStatusRead == (int16_t)CLLC_secOverCurrentTrip)
-        {
-            CLLC_tripFlag.CLLC_TripFlag_Enum = CLLC_secOverCurrentTrip;
-        }
-        else if(tripStatusRead == (int16_t)CLLC_primTankOverCurrentTrip)
-        {
-            CLLC_tripFlag.CLLC_TripFlag_Enum = CLLC_primTankOverCurrentTrip;
-        }
-    }
 }
 
 void CLLC_setBuildLevelIndicatorVariable(void)
@@ -615,3 +1112,169 @@ void CLLC_changeSynchronousRectifierPwmBehavior(uint16_t powerFlow)
     }
 
 }
+
+void CLLC_setupSFRA(void)
+{
+    #if CLLC_SFRA_TYPE != CLLC_SFRA_DISABLED
+        SFRA_F32_reset(&CLLC_sfra1);
+        SFRA_F32_config(&CLLC_sfra1,
+                        CLLC_SFRA_ISR_FREQ_HZ,
+                        CLLC_SFRA_AMPLITUDE,
+                        CLLC_SFRA_FREQ_LENGTH,
+                        CLLC_SFRA_FREQ_START,
+                        CLLC_SFRA_FREQ_STEP_MULTIPLY,
+                        CLLC_plantMagVect,
+                        CLLC_plantPhaseVect,
+                        CLLC_olMagVect,
+                        CLLC_olPhaseVect,
+                        CLLC_clMagVect,
+                        CLLC_clPhaseVect,
+                        CLLC_freqVect,
+                        1);
+
+        SFRA_F32_resetFreqRespArray(&CLLC_sfra1);
+        SFRA_F32_initFreqArrayWithLogSteps(&CLLC_sfra1,
+                                           CLLC_SFRA_FREQ_START,
+                                           CLLC_SFRA_FREQ_STEP_MULTIPLY);
+
+        //
+        // plot option 1, the GUI shows GH and H
+        //
+        SFRA_GUI_config(CLLC_SFRA_GUI_SCI_BASE,
+                        CLLC_SCI_VBUS_CLK,
+                        CLLC_SFRA_GUI_SCI_BAUDRATE,
+                        CLLC_SFRA_GUI_SCIRX_GPIO,
+                        CLLC_SFRA_GUI_SCIRX_GPIO_PIN_CONFIG,
+                        CLLC_SFRA_GUI_SCITX_GPIO,
+                        CLLC_SFRA_GUI_SCITX_GPIO_PIN_CONFIG,
+                        CLLC_SFRA_GUI_LED_INDICATOR,
+                        CLLC_SFRA_GUI_LED_GPIO,
+                        CLLC_SFRA_GUI_LED_GPIO_PIN_CONFIG,
+                        &CLLC_sfra1,
+                        1);
+    #endif
+}
+
+void CLLC_runSFRABackgroundTasks(void)
+{
+    #if CLLC_SFRA_TYPE != CLLC_SFRA_DISABLED
+        SFRA_F32_runBackgroundTask(&CLLC_sfra1);
+        SFRA_GUI_runSerialHostComms(&CLLC_sfra1);
+    #endif
+}
+
+#if CLLC_DATALOGGER_ENABLE == 1
+//
+// Empties the graph window buffers and arms the logger
+//
+static void CLLC_startDataLogCapture(void)
+{
+    uint16_t i;
+
+    for(i = 0; i < CLLC_DATALOG_CHANNELS; i++)
+    {
+        CLLC_dataLogBufferCount[i] = 0;
+        CLLC_dataLogTriggerSample[i] = -1;
+    }
+
+    CLLC_DATALOG_arm(&CLLC_dataLog);
+}
+
+//
+// Background side of the datalogger, runs with the interrupts enabled.
+// Sorts the records of the capture into the buffer of their channel, the
+// samples past CLLC_DATALOG_CAPTURE_SIZE are drained and not kept. A
+// capture is taken once, CLLC_dataLogRearm set from the watch window arms
+// the logger again when it is complete.
+//
+void CLLC_runDataLogBackground(void)
+{
+    CLLC_DATALOG_Record record[16];
+    uint16_t count, i, channel, n;
+
+    if(CLLC_dataLogSoftwareTrigger == 1U)
+    {
+        CLLC_dataLogSoftwareTrigger = 0;
+        CLLC_DATALOG_trigger(&CLLC_dataLog);
+    }
+
+    do
+    {
+        count = CLLC_DATALOG_read(&CLLC_dataLog, record, 16);
+
+        for(i = 0; i < count; i++)
+        {
+            channel = record[i].channel;
+            n = CLLC_dataLogBufferCount[channel];
+
+            if(n < CLLC_DATALOG_CAPTURE_SIZE)
+            {
+                if((CLLC_dataLogTriggerSample[channel] < 0) &&
+                   ((int16_t)(record[i].tick -
+                              CLLC_dataLog.triggerTick) >= 0))
+                {
+                    CLLC_dataLogTriggerSample[channel] = (int16_t)n;
+                }
+                CLLC_dataLogBuffer[channel][n] = record[i].value;
+                CLLC_dataLogBufferCount[channel] = n + 1U;
+            }
+        }
+    }
+    while(count != 0U);
+
+    if((CLLC_dataLogRearm == 1U) && (CLLC_DATALOG_isDone(&CLLC_dataLog) != 0U))
+    {
+        CLLC_dataLogRearm = 0;
+        CLLC_startDataLogCapture();
+    }
+}
+#endif
+
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+//
+// ISR2 on the CLA counts nothing itself, ISR3 counts its runs and the trips
+// it reports from the telemetry it hands back
+//
+static void CLLC_countCLAStats(void)
+{
+    uint16_t tripFlag = CLLC_claTelemetry.tripFlag;
+
+    CLLC_stats.isr2Count += (uint16_t)(CLLC_claTelemetry.isr2Count -
+                                       CLLC_statsCLAISR2Count);
+    CLLC_statsCLAISR2Count = CLLC_claTelemetry.isr2Count;
+
+    if((CLLC_statsCLATripFlag == (uint16_t)CLLC_noTrip) &&
+       (tripFlag != (uint16_t)CLLC_noTrip))
+    {
+        if(tripFlag == (uint16_t)CLLC_primOverCurrentTrip)
+        {
+            CLLC_STATS_COUNT(tripPrimOverCurrent);
+        }
+        else if(tripFlag == (uint16_t)CLLC_secOverCurrentTrip)
+        {
+            CLLC_STATS_COUNT(tripSecOverCurrent);
+        }
+        else if(tripFlag == (uint16_t)CLLC_primTankOverCurrentTrip)
+        {
+            CLLC_STATS_COUNT(tripPrimTankOverCurrent);
+        }
+    }
+    CLLC_statsCLATripFlag = tripFlag;
+}
+#endif
+
+#if CLLC_TELEMETRY_ENABLE == 1
+//
+// Refills the SCI transmit FIFO from the telemetry ring, called by the
+// telemetry ISR with interrupts enabled
+//
+void CLLC_runTelemetryTx(void)
+{
+    uint16_t bytes[CLLC_HAL_TELEMETRY_TX_FIFO_SIZE];
+    uint16_t count;
+
+    count = CLLC_TELEMETRY_read(&CLLC_telemetry, bytes,
+                                CLLC_HAL_getTelemetryTxSpace());
+    CLLC_HAL_writeTelemetryTx(bytes, count);
+}
+#endif
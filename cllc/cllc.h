@@ -31,6 +31,7 @@ extern "C" {
 //
 #include "cllc_settings.h"
 #include "cllc_hal.h"
+#include "cllc_stats.h"
 
 //
 // Library header files
@@ -57,6 +58,8 @@ extern "C" {
 #define CLLC_GV_IMMEDIATE_RUN DCL_runDF13_C5
 #define CLLC_GV_PRECOMPUTE_RUN DCL_runDF13_C6
 
+#include "cllc_gvsched.h"
+
 #else
 #include "DCL/DCLCLA.h"
 #define CLLC_GI DCL_DF13_CLA
@@ -123,7 +126,74 @@ static inline float32_t runDF13_L6(DCL_DF13_CLA *p,
 
 #endif
 
-#include "utilities/emavg.h"
+#include "cllc_avg.h"
+
+//
+// SFRA Library, injects into the reference of the loop selected by
+// CLLC_SFRA_TYPE and collects the control output and the feedback once per
+// ISR2, both pass the signal through when SFRA is disabled
+//
+#if CLLC_SFRA_TYPE != CLLC_SFRA_DISABLED
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+#error "SFRA only runs on the C28x, disable it when ISR2 runs on the CLA"
+#endif
+#include "sfra/sfra_f32.h"
+#include "sfra/sfra_gui_scicomms_driverlib.h"
+#define CLLC_SFRA_INJECT SFRA_F32_inject
+#define CLLC_SFRA_COLLECT SFRA_F32_collect
+#else
+#define CLLC_SFRA_INJECT(ref) (ref)
+#define CLLC_SFRA_COLLECT(controlOutput, feedback)
+#endif
+
+#if (CLLC_TRIP_DECODE != CLLC_TRIP_DECODE_ISR2) && \
+    (CLLC_ISR2_RUNNING_ON == CLA_CORE)
+#error "Trip decoding out of ISR2 needs ISR2 on the C28x"
+#endif
+
+#if (CLLC_ADC_OVERSAMPLE > 1) && (CLLC_ISR2_RUNNING_ON == CLA_CORE)
+#error "ADC oversampling needs ISR2 on the C28x, the DMA cannot write CLA RAM"
+#endif
+
+#if (CLLC_ADC_CALIBRATION == 1) && (CLLC_ISR2_RUNNING_ON == CLA_CORE)
+#error "ADC calibration needs ISR2 on the C28x, the gains are in C28x RAM"
+#endif
+
+#if (CLLC_PHASES != 1) && (CLLC_PHASES != 2)
+#error "CLLC_PHASES is 1 or 2, phase 1 takes the last four PWMs"
+#endif
+
+#if (CLLC_GV_SCHEDULE == 1) && (CLLC_ISR2_RUNNING_ON == CLA_CORE)
+#error "The gain schedule of GV needs ISR2 on the C28x, DCL_GSM runs on it"
+#endif
+
+#if CLLC_PHASES > 1
+#if (CLLC_POWER_FLOW != CLLC_POWER_FLOW_PRIM_SEC) || \
+    (CLLC_ISR2_RUNNING_ON == CLA_CORE)
+#error "Interleaved phases run the prim to sec power flow with ISR2 on the C28x"
+#endif
+#if CLLC_PWM_UPDATE_MODE != CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD
+#error "Interleaved phases need CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD, ISR2 commits all of them"
+#endif
+#if CLLC_ADC_CALIBRATION == 1
+#error "ADC calibration covers the ISEC of phase 0 only, sharing needs both alike"
+#endif
+#if (CLLC_TELEMETRY_ENABLE == 1) || (CLLC_CAN_ENABLE == 1)
+#error "The PWM pins of phase 1 are those of the telemetry SCI and the MCAN"
+#endif
+#endif
+
+#if CLLC_SHARE_ROLE != CLLC_SHARE_NONE
+#if CLLC_FSI_ENABLE != 1
+#error "Current sharing sends the references on the FSI, set CLLC_FSI_ENABLE"
+#endif
+#if (CLLC_POWER_FLOW != CLLC_POWER_FLOW_PRIM_SEC) || \
+    (CLLC_INCR_BUILD != CLLC_CLOSED_LOOP_BUILD) || \
+    (CLLC_CONTROL_MODE != CLLC_VOLTAGE_MODE) || \
+    (CLLC_ISR2_RUNNING_ON == CLA_CORE)
+#error "Current sharing runs the prim to sec voltage loop with ISR2 on the C28x"
+#endif
+#endif
 
 #pragma FUNC_ALWAYS_INLINE(EPWM_setActionQualifierContSWForceAction)
 
@@ -137,17 +207,19 @@ void CLLC_runISR3(void);
 //
 void CLLC_initGlobalVariables(void);
 
-//
-// Function reads the trip flags and updates the board status enum type variable
-//
-void CLLC_updateBoardStatus(void);
-
 //
 //
 //
 void CLLC_setBuildLevelIndicatorVariable(void);
 void CLLC_changeSynchronousRectifierPwmBehavior(uint16_t powerFlow);
 
+//
+// Functions to configure the SFRA object and the SFRA GUI comms, and to run
+// their background tasks
+//
+void CLLC_setupSFRA(void);
+void CLLC_runSFRABackgroundTasks(void);
+
 //
 // typedefs
 //
@@ -191,7 +263,26 @@ typedef union{
     int32_t pad;
 }CLLC_TripFlag_EnumType;
 
-extern  CLLC_TripFlag_EnumType CLLC_TripFlag;
+extern  CLLC_TripFlag_EnumType CLLC_tripFlag;
+
+//
+// The first board trip, latched by the trip zone interrupt with
+// CLLC_TRIP_DECODE_EVENT: its cause, the CLLC_HAL_readTripFlags source, the
+// ISR2 run it came in after and the cycles into that ISR2 period
+//
+typedef struct
+{
+    uint16_t cause;                     // CLLC_TripFlag_Enum
+    uint16_t source;                    // 0 until the first trip
+    uint32_t isr2Count;                 // CLLC_stats.isr2Count
+    uint32_t isr2Cycles;                // ISR2 eCAP counter
+    uint32_t events;                    // trip zone interrupts taken
+} CLLC_TripEvent;
+
+#if (CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_EVENT) && \
+    !defined(__TMS320C28XX_CLA__)
+extern volatile CLLC_TripEvent CLLC_tripEvent;
+#endif
 
 typedef union{
     enum
@@ -230,6 +321,68 @@ typedef union{
 
 extern CLLC_PrechargeState_EnumType CLLC_PrechargeState;
 extern volatile uint32_t CLLC_precharge_count;
+
+//
+// The duty and phase shift terms of the tick calculation for one set of
+// references, ISR3 works them out and ISR2 takes them
+//
+typedef struct
+{
+    float32_t dutyAPrimFactor;
+    float32_t dutyASecFactor;
+    int32_t phaseShiftPrimSecDelay_ticks;
+}CLLC_PWMFactors;
+
+//
+// CLA execution, the C28x and the CLA only exchange ISR2 setpoints and
+// telemetry through the message RAMs. Each side writes its mailbox as two
+// buffers, fills the one the other side is not reading and then flips the
+// index, so the other side always takes a complete set. Only explicitly
+// sized types are used as int and enums are 32 bit wide on the CLA.
+//
+typedef struct
+{
+    float32_t pwmPeriodRef_pu;
+    CLLC_PWMFactors pwmFactors;
+    float32_t vPrimRefSlewed_pu;
+    float32_t vSecRefSlewed_pu;
+    float32_t iSecRefSlewed_pu;
+    int32_t closeGiLoop;
+    int32_t closeGvLoop;
+    uint16_t clearTripRequest;      // counts the clear trip requests
+    uint16_t prechargeRequest;      // counts the precharge start requests
+    uint16_t count;                 // counts the sets published
+    uint16_t pwmFactorsCount;       // counts the factor sets of ISR3
+}CLLC_CLA_Setpoint;
+
+typedef struct
+{
+    float32_t iPrimSensed_pu;
+    float32_t iSecSensed_pu;
+    float32_t vPrimSensed_pu;
+    float32_t vSecSensed_pu;
+    float32_t pwmPeriod_pu;          // the loop output, not slewed
+    float32_t pwmFrequency_Hz;
+    float32_t giOut;
+    float32_t gvOut;
+    uint32_t pwmUpdateDeferCount;
+    uint16_t tripFlag;
+    uint16_t prechargeState;
+    uint16_t setpointCount;         // count of the setpoints ISR2 ran on
+    uint16_t isr2Count;
+}CLLC_CLA_Telemetry;
+
+typedef struct
+{
+    CLLC_CLA_Setpoint buffer[2];
+    uint16_t index;                 // buffer to take, written last
+}CLLC_CLA_SetpointMailbox;
+
+typedef struct
+{
+    CLLC_CLA_Telemetry buffer[2];
+    uint16_t index;
+}CLLC_CLA_TelemetryMailbox;
 //
 // globals
 //
@@ -244,6 +397,15 @@ extern float32_t CLLC_gvOut;
 extern float32_t CLLC_gvError;
 extern float32_t CLLC_gvPartialComputedValue;
 
+#if CLLC_GV_SCHEDULE == 1
+extern DCL_GSM CLLC_gvSchedule;
+extern float32_t CLLC_gvScheduleScale;
+#endif
+
+#if CLLC_SFRA_TYPE != CLLC_SFRA_DISABLED
+extern SFRA_F32 CLLC_sfra1;
+#endif
+
 //
 // Flags for clearing trips and closing the loop
 //
@@ -262,6 +424,13 @@ extern float32_t CLLC_pwmPeriodMin_pu;
 extern float32_t CLLC_pwmPeriodMax_pu;
 extern float32_t CLLC_pwmPeriodMax_ticks;
 extern uint32_t CLLC_pwmPeriod_ticks;
+
+//
+// averages of the sensed signals, run by ISR3, which writes their values in
+// volts and amps to the CLLC_*Sensed_Volts and _Amps globals
+//
+extern CLLC_AVG_Bank CLLC_avg;
+
 //
 // 1- Primary Side (PFC-Inv/Bus)
 //
@@ -270,19 +439,16 @@ extern float32_t CLLC_iPrimSensed_pu;
 extern float32_t CLLC_iPrimSensedOffset_pu;
 extern float32_t CLLC_iPrimSensedCalIntercept_pu;
 extern float32_t CLLC_iPrimSensedCalXvariable_pu;
-extern EMAVG CLLC_iPrimSensedAvg_pu;
 
 extern float32_t CLLC_iPrimTankSensed_Amps;
 extern float32_t CLLC_iPrimTankSensed_pu;
 extern float32_t CLLC_iPrimTankSensedOffset_pu;
 extern float32_t CLLC_iPrimTankSensedCalIntercept_pu;
 extern float32_t CLLC_iPrimTankSensedCalXvariable_pu;
-extern EMAVG CLLC_iPrimTankSensedAvg_pu;
 
 extern float32_t CLLC_vPrimSensed_Volts;
 extern float32_t CLLC_vPrimSensed_pu;
 extern float32_t CLLC_vPrimSensedOffset_pu;
-extern EMAVG CLLC_vPrimSensedAvg_pu;
 
 extern float32_t CLLC_vPrimRef_Volts;
 extern float32_t CLLC_vPrimRef_pu;
@@ -307,7 +473,6 @@ extern float32_t CLLC_iSecSensed_pu;
 extern float32_t CLLC_iSecSensedOffset_pu;
 extern float32_t CLLC_iSecSensedCalIntercept_pu;
 extern float32_t CLLC_iSecSensedCalXvariable_pu;
-extern EMAVG CLLC_iSecSensedAvg_pu;
 
 extern volatile float32_t CLLC_iSecRef_Amps;
 extern float32_t CLLC_iSecRef_pu;
@@ -320,7 +485,6 @@ extern float32_t CLLC_vSecSensedOffset_pu;
 extern float32_t CLLC_vSecRef_Volts;
 extern float32_t CLLC_vSecRef_pu;
 extern float32_t CLLC_vSecRefSlewed_pu;
-extern EMAVG CLLC_vSecSensedAvg_pu;
 
 extern volatile float32_t CLLC_pwmDutySecRef_pu;
 extern float32_t CLLC_pwmDutySec_pu;
@@ -338,32 +502,181 @@ extern float32_t CLLC_pwmPhaseShiftPrimSec_ns;
 extern int32_t CLLC_pwmPhaseShiftPrimSec_ticks;
 extern int16_t CLLC_pwmPhaseShiftPrimSec_countDirection;
 
+extern float32_t CLLC_pwmDutyAPrimFactor;
+extern float32_t CLLC_pwmDutyASecFactor;
+extern int32_t CLLC_pwmPhaseShiftPrimSecDelay_ticks;
+
+extern CLLC_PWMFactors CLLC_pwmFactorsSet[2];
+extern volatile uint16_t CLLC_pwmFactorsCount;
+extern uint16_t CLLC_pwmFactorsTaken;
 
 extern volatile uint16_t CLLC_pwmISRTrig_ticks;
 
-extern volatile uint32_t CLLC_cla_task_counter;
+extern volatile uint16_t CLLC_pwmUpdateDeferred;
+extern volatile uint32_t CLLC_pwmUpdateDeferCount;
+
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+extern volatile int32_t CLLC_startPrecharge;
+
+extern volatile CLLC_CLA_SetpointMailbox CLLC_cpuToClaMailbox;
+extern volatile CLLC_CLA_TelemetryMailbox CLLC_claToCpuMailbox;
+
+extern CLLC_CLA_Setpoint CLLC_claSetpoint;
+extern uint16_t CLLC_claClearTripTaken;
+extern uint16_t CLLC_claPrechargeTaken;
+extern uint16_t CLLC_claISR2Count;
+
+extern CLLC_CLA_Telemetry CLLC_claTelemetry;
+#endif
+
+//
+// ISR2 inputs that are set on the C28x side and ISR2 outputs that are used
+// there. With ISR2 on the CLA they are taken from the setpoint mailbox once
+// per ISR2 and read from the last telemetry set once per ISR3.
+//
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+#define CLLC_ISR2_INPUT(x) (CLLC_claSetpoint.x)
+#define CLLC_ISR2_OUTPUT(x) (CLLC_claTelemetry.x)
+#else
+#define CLLC_ISR2_INPUT(x) (CLLC_##x)
+#define CLLC_ISR2_OUTPUT(x) (CLLC_##x)
+#endif
 
 // extern uint32_t slewSCIcommand;
 
+//
+// the sec bus is taken per unit of CLLC_VSEC_OPTIMAL_RANGE_VOLTS, the range
+// its reference and CLLC_vSecSensed_Volts are scaled to
+//
+#define CLLC_VSEC_ADC_PU_SCALE_FACTOR (CLLC_ADC_PU_SCALE_FACTOR *            \
+                                       (CLLC_VSEC_MAX_SENSE_VOLTS /          \
+                                        CLLC_VSEC_OPTIMAL_RANGE_VOLTS))
+
+//
+// ISEC and VSEC as read by ISR2, oversampled they are the sum of the
+// conversions and the scale takes the average
+//
+#if CLLC_ADC_OVERSAMPLE > 1
+#define CLLC_ISEC_SENSE_ADCREAD CLLC_ISEC_OVERSAMPLE_ADCREAD
+#define CLLC_VSEC_SENSE_ADCREAD CLLC_VSEC_OVERSAMPLE_ADCREAD
+#define CLLC_ISEC_SENSE_PU_SCALE_FACTOR (CLLC_ADC_PU_SCALE_FACTOR /          \
+                                         (float32_t)CLLC_ADC_OVERSAMPLE)
+#define CLLC_VSEC_SENSE_PU_SCALE_FACTOR (CLLC_VSEC_ADC_PU_SCALE_FACTOR /     \
+                                         (float32_t)CLLC_ADC_OVERSAMPLE)
+#else
+#define CLLC_ISEC_SENSE_ADCREAD CLLC_ISEC_ADCREAD_1
+#define CLLC_VSEC_SENSE_ADCREAD CLLC_VSEC_ADCREAD_1
+#define CLLC_ISEC_SENSE_PU_SCALE_FACTOR CLLC_ADC_PU_SCALE_FACTOR
+#define CLLC_VSEC_SENSE_PU_SCALE_FACTOR CLLC_VSEC_ADC_PU_SCALE_FACTOR
+#endif
+
+//
+// The four readings of ISR2. Calibrated, a PPB result or the sum of the
+// oversampling conversions less its zero, times the gain of the channel.
+//
+#if CLLC_ADC_CALIBRATION == 1
+#include "cllc_adccal.h"
+
+extern CLLC_ADCCAL_Channel CLLC_iPrimADCCal;
+extern CLLC_ADCCAL_Channel CLLC_iSecADCCal;
+extern CLLC_ADCCAL_Channel CLLC_vPrimADCCal;
+extern CLLC_ADCCAL_Channel CLLC_vSecADCCal;
+extern CLLC_ADCCAL_SelfCal CLLC_iPrimADCSelfCal;
+extern CLLC_ADCCAL_SelfCal CLLC_iSecADCSelfCal;
+extern uint16_t CLLC_adcSelfCalDone;
+
+//
+// Gains and zeros of the four channels from the sensed offset and Cal
+// globals, into the PPBs. Run after CLLC_HAL_setupADC.
+//
+void CLLC_setupADCCalibration(void);
+
+//
+// One code of each current while the bridges are tripped, a trip cleared
+// part way starts over. Once all are taken their means become the zeros.
+//
+void CLLC_runADCSelfCal(void);
+
+#define CLLC_ADC_PPB_SENSED_PU(resultBase, ppb, cal)                          \
+            ((float32_t)ADC_readPPBResult(resultBase, ppb) * (cal).gain_pu)
+
+#define CLLC_IPRIM_SENSED_PU                                                  \
+            CLLC_ADC_PPB_SENSED_PU(CLLC_IPRIM_ADCRESULTREGBASE,               \
+                                   CLLC_IPRIM_ADC_PPB, CLLC_iPrimADCCal)
+#define CLLC_VPRIM_SENSED_PU                                                  \
+            CLLC_ADC_PPB_SENSED_PU(CLLC_VPRIM_ADCRESULTREGBASE,               \
+                                   CLLC_VPRIM_ADC_PPB, CLLC_vPrimADCCal)
+#if CLLC_ADC_OVERSAMPLE > 1
+#define CLLC_ISEC_SENSED_PU                                                   \
+            CLLC_ADCCAL_readSum(&CLLC_iSecADCCal, CLLC_ISEC_SENSE_ADCREAD)
+#define CLLC_VSEC_SENSED_PU                                                   \
+            CLLC_ADCCAL_readSum(&CLLC_vSecADCCal, CLLC_VSEC_SENSE_ADCREAD)
+#else
+#define CLLC_ISEC_SENSED_PU                                                   \
+            CLLC_ADC_PPB_SENSED_PU(CLLC_ISEC_ADCRESULTREGBASE,                \
+                                   CLLC_ISEC_ADC_PPB, CLLC_iSecADCCal)
+#define CLLC_VSEC_SENSED_PU                                                   \
+            CLLC_ADC_PPB_SENSED_PU(CLLC_VSEC_ADCRESULTREGBASE,                \
+                                   CLLC_VSEC_ADC_PPB, CLLC_vSecADCCal)
+#endif
+#else
+#define CLLC_IPRIM_SENSED_PU ((float32_t)CLLC_IPRIM_ADCREAD *                 \
+                              CLLC_ADC_PU_SCALE_FACTOR)
+#define CLLC_ISEC_SENSED_PU  ((float32_t)CLLC_ISEC_SENSE_ADCREAD *            \
+                              CLLC_ISEC_SENSE_PU_SCALE_FACTOR)
+#define CLLC_VPRIM_SENSED_PU ((float32_t)CLLC_VPRIM_ADCREAD_1 *               \
+                              CLLC_ADC_PU_SCALE_FACTOR)
+#define CLLC_VSEC_SENSED_PU  ((float32_t)CLLC_VSEC_SENSE_ADCREAD *            \
+                              CLLC_VSEC_SENSE_PU_SCALE_FACTOR)
+#endif
+
+#if CLLC_PHASES > 1
+extern CLLC_PHASE_Instance CLLC_phase[CLLC_PHASES];
+
+//
+// Binds the phases and sets up the PWMs of those after phase 0, held in the
+// trip. Run after CLLC_HAL_setupPWM and CLLC_HAL_setupGlobalLoad.
+//
+void CLLC_setupPhases(void);
+#endif
+
 //
 // the function prototypes
 //
 #pragma FUNC_ALWAYS_INLINE(CLLC_readSensedSignalsPrimToSecPowerFlow)
 static inline void CLLC_readSensedSignalsPrimToSecPowerFlow(void)
 {
-    CLLC_iPrimSensed_pu = (float32_t)CLLC_IPRIM_ADCREAD *
-                                       CLLC_ADC_PU_SCALE_FACTOR;
-    CLLC_iSecSensed_pu =  (float32_t)CLLC_ISEC_ADCREAD_1 *
-                                       CLLC_ADC_PU_SCALE_FACTOR;
-    CLLC_vPrimSensed_pu = (float32_t)CLLC_VPRIM_ADCREAD_1 *
-                                       CLLC_ADC_PU_SCALE_FACTOR;
-    CLLC_vSecSensed_pu =  (float32_t)CLLC_VSEC_ADCREAD_1 *
-                                        CLLC_ADC_PU_SCALE_FACTOR;
+#if CLLC_PHASES > 1
+    uint16_t i;
+#endif
+
+    CLLC_iPrimSensed_pu = CLLC_IPRIM_SENSED_PU;
+    CLLC_iSecSensed_pu = CLLC_ISEC_SENSED_PU;
+    CLLC_vPrimSensed_pu = CLLC_VPRIM_SENSED_PU;
+    CLLC_vSecSensed_pu = CLLC_VSEC_SENSED_PU;
+
+#if CLLC_PHASES > 1
+    //
+    // ISEC of each phase for the sharing, phase 0 is the reading above
+    //
+    CLLC_phase[0].iSecSensed_pu = CLLC_iSecSensed_pu;
+    for(i = 1; i < CLLC_PHASES; i++)
+    {
+        CLLC_phase[i].iSecSensed_pu =
+                (float32_t)CLLC_HAL_readPhaseISec(&CLLC_phase[i]) *
+                CLLC_ADC_PU_SCALE_FACTOR;
+    }
+#endif
 }
 
 #pragma FUNC_ALWAYS_INLINE(CLLC_readSensedSignalsSecToPrimPowerFlow)
 static inline void CLLC_readSensedSignalsSecToPrimPowerFlow(void)
 {
+    CLLC_iPrimSensed_pu = CLLC_IPRIM_SENSED_PU;
+    CLLC_iSecSensed_pu = CLLC_ISEC_SENSED_PU;
+    CLLC_vPrimSensed_pu = CLLC_VPRIM_SENSED_PU;
+    CLLC_vSecSensed_pu = CLLC_VSEC_SENSED_PU;
+
     // iPrimSensed_pu = ((float32_t)IPRIM_ADCREAD *
     //                                    ADC_PU_SCALE_FACTOR
     //                - iPrimSensedOffset_pu) * -2.0;
@@ -389,6 +702,582 @@ static inline void CLLC_readSensedSignalsSecToPrimPowerFlow(void)
     //                         iPrimSensedCalIntercept_pu;
 }
 
+//
+// Updates the board status enum type variable from the trip flags read,
+// inline as ISR2 calls it on the C28x and on the CLA
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_decodeTrip)
+static inline void CLLC_decodeTrip(int16_t tripStatusRead)
+{
+    if(CLLC_tripFlag.CLLC_TripFlag_Enum == CLLC_noTrip)
+    {
+        if(tripStatusRead == (int16_t)CLLC_primOverCurrentTrip)
+        {
+            CLLC_tripFlag.CLLC_TripFlag_Enum = CLLC_primOverCurrentTrip;
+            CLLC_STATS_COUNT(tripPrimOverCurrent);
+        }
+        else if(tripStatusRead == (int16_t)CLLC_secOverCurrentTrip)
+        {
+            CLLC_tripFlag.CLLC_TripFlag_Enum = CLLC_secOverCurrentTrip;
+            CLLC_STATS_COUNT(tripSecOverCurrent);
+        }
+        else if(tripStatusRead == (int16_t)CLLC_primTankOverCurrentTrip)
+        {
+            CLLC_tripFlag.CLLC_TripFlag_Enum = CLLC_primTankOverCurrentTrip;
+            CLLC_STATS_COUNT(tripPrimTankOverCurrent);
+        }
+    }
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_updateBoardStatus)
+static inline void CLLC_updateBoardStatus(void)
+{
+    CLLC_decodeTrip(CLLC_HAL_readTripFlags());
+}
+
+#if (CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_EVENT) && \
+    !defined(__TMS320C28XX_CLA__)
+//
+// The trip zone interrupt, on the one-shot trip of PRIM LEG1. The PWMs are
+// already off, this only finds the cause. The eCAP counter is read first,
+// the nearest to the trip. A trip while the one-shot flag is still set
+// raises no interrupt, the flags it latches are read by the first one after
+// the clear trip.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_runTripEvent)
+static inline void CLLC_runTripEvent(void)
+{
+    uint32_t isr2Cycles = CLLC_HAL_getISR2LatencyCycles();
+    int16_t tripStatusRead = CLLC_HAL_readTripFlags();
+
+    CLLC_tripEvent.events++;
+    CLLC_decodeTrip(tripStatusRead);
+
+    if((CLLC_tripEvent.source == 0U) && (tripStatusRead != 0))
+    {
+        CLLC_tripEvent.cause = (uint16_t)CLLC_tripFlag.CLLC_TripFlag_Enum;
+        CLLC_tripEvent.isr2Count = CLLC_stats.isr2Count;
+        CLLC_tripEvent.isr2Cycles = isr2Cycles;
+        CLLC_tripEvent.source = (uint16_t)tripStatusRead;
+    }
+
+    CLLC_HAL_clearTripEventInterruptFlag();
+}
+#endif
+
+//
+// A clear trip set from the watch window, taken once by ISR2. On the CLA
+// it arrives as a new request count in the setpoint mailbox.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_takeClearTripRequest)
+static inline uint16_t CLLC_takeClearTripRequest(void)
+{
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+    if(CLLC_claSetpoint.clearTripRequest != CLLC_claClearTripTaken)
+    {
+        CLLC_claClearTripTaken = CLLC_claSetpoint.clearTripRequest;
+        return(1);
+    }
+#else
+    if(CLLC_clearTrip == 1)
+    {
+        CLLC_clearTrip = 0;
+        return(1);
+    }
+#endif
+    return(0);
+}
+
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+//
+// Fills a setpoint set from the globals, the watch window flags are turned
+// into request counts here, CLLC_PrechargeState belongs to the CLA. The duty
+// and phase shift references go as the factors ISR3 worked out of them.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_writeCLASetpoints)
+static inline void CLLC_writeCLASetpoints(volatile CLLC_CLA_Setpoint *s)
+{
+    const CLLC_PWMFactors *f;
+    uint16_t pwmFactorsCount;
+
+    s->pwmPeriodRef_pu = CLLC_pwmPeriodRef_pu;
+
+    //
+    // the factor set ISR3 published last, ISR3 fills the other one, so the
+    // set can only change under the copy if two ISR3 periods pass during it
+    //
+    pwmFactorsCount = CLLC_pwmFactorsCount;
+    f = &CLLC_pwmFactorsSet[pwmFactorsCount & 1U];
+    s->pwmFactors.dutyAPrimFactor = f->dutyAPrimFactor;
+    s->pwmFactors.dutyASecFactor = f->dutyASecFactor;
+    s->pwmFactors.phaseShiftPrimSecDelay_ticks =
+            f->phaseShiftPrimSecDelay_ticks;
+    s->pwmFactorsCount = pwmFactorsCount;
+    s->vPrimRefSlewed_pu = CLLC_vPrimRefSlewed_pu;
+    s->vSecRefSlewed_pu = CLLC_vSecRefSlewed_pu;
+    s->iSecRefSlewed_pu = CLLC_iSecRefSlewed_pu;
+    s->closeGiLoop = CLLC_closeGiLoop;
+    s->closeGvLoop = CLLC_closeGvLoop;
+
+    if(CLLC_clearTrip == 1)
+    {
+        s->clearTripRequest++;
+        CLLC_clearTrip = 0;
+    }
+
+    if(CLLC_startPrecharge == 1)
+    {
+        s->prechargeRequest++;
+        CLLC_startPrecharge = 0;
+    }
+}
+
+//
+// Before the CLA runs, the set the index points to is filled in place and
+// the first ISR2 starts from it
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_initCLASetpoints)
+static inline void CLLC_initCLASetpoints(void)
+{
+    CLLC_writeCLASetpoints(
+            &CLLC_cpuToClaMailbox.buffer[CLLC_cpuToClaMailbox.index & 1U]);
+}
+
+//
+// C28x background loop. A new set is only written once the CLA has run an
+// ISR2 on the last one, the CLA then reads the buffer the index points to
+// and the one written is the other.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_sendCLASetpoints)
+static inline void CLLC_sendCLASetpoints(void)
+{
+    volatile CLLC_CLA_Setpoint *last;
+    volatile CLLC_CLA_Setpoint *next;
+    uint16_t index;
+
+    index = CLLC_cpuToClaMailbox.index & 1U;
+    last = &CLLC_cpuToClaMailbox.buffer[index];
+    next = &CLLC_cpuToClaMailbox.buffer[index ^ 1U];
+
+    if(CLLC_claToCpuMailbox.buffer[CLLC_claToCpuMailbox.index & 1U].
+           setpointCount != last->count)
+    {
+        return;
+    }
+
+    next->clearTripRequest = last->clearTripRequest;
+    next->prechargeRequest = last->prechargeRequest;
+    CLLC_writeCLASetpoints(next);
+    next->count = last->count + 1U;
+
+    CLLC_cpuToClaMailbox.index = index ^ 1U;
+}
+
+//
+// CLA ISR2, takes the set the index points to. A precharge start that
+// comes with a clear trip is taken one ISR2 later, after the clear trip has
+// reset the precharge.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_receiveCLASetpoints)
+static inline void CLLC_receiveCLASetpoints(void)
+{
+    volatile CLLC_CLA_Setpoint *s;
+
+    s = &CLLC_cpuToClaMailbox.buffer[CLLC_cpuToClaMailbox.index & 1U];
+
+    CLLC_claSetpoint.pwmPeriodRef_pu = s->pwmPeriodRef_pu;
+    CLLC_claSetpoint.pwmFactors.dutyAPrimFactor =
+            s->pwmFactors.dutyAPrimFactor;
+    CLLC_claSetpoint.pwmFactors.dutyASecFactor = s->pwmFactors.dutyASecFactor;
+    CLLC_claSetpoint.pwmFactors.phaseShiftPrimSecDelay_ticks =
+            s->pwmFactors.phaseShiftPrimSecDelay_ticks;
+    CLLC_claSetpoint.vPrimRefSlewed_pu = s->vPrimRefSlewed_pu;
+    CLLC_claSetpoint.vSecRefSlewed_pu = s->vSecRefSlewed_pu;
+    CLLC_claSetpoint.iSecRefSlewed_pu = s->iSecRefSlewed_pu;
+    CLLC_claSetpoint.closeGiLoop = s->closeGiLoop;
+    CLLC_claSetpoint.closeGvLoop = s->closeGvLoop;
+    CLLC_claSetpoint.clearTripRequest = s->clearTripRequest;
+    CLLC_claSetpoint.prechargeRequest = s->prechargeRequest;
+    CLLC_claSetpoint.count = s->count;
+    CLLC_claSetpoint.pwmFactorsCount = s->pwmFactorsCount;
+
+    if((CLLC_claSetpoint.prechargeRequest != CLLC_claPrechargeTaken) &&
+       (CLLC_claSetpoint.clearTripRequest == CLLC_claClearTripTaken))
+    {
+        CLLC_claPrechargeTaken = CLLC_claSetpoint.prechargeRequest;
+        CLLC_PrechargeState.CLLC_PrechargeState_Enum =
+                CLLC_precharge_starting;
+    }
+}
+
+//
+// CLA ISR2, publishes what the C28x side uses from this ISR2
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_sendCLATelemetry)
+static inline void CLLC_sendCLATelemetry(void)
+{
+    volatile CLLC_CLA_Telemetry *t;
+    uint16_t index;
+
+    index = (CLLC_claToCpuMailbox.index & 1U) ^ 1U;
+    t = &CLLC_claToCpuMailbox.buffer[index];
+
+    CLLC_claISR2Count++;
+
+    t->iPrimSensed_pu = CLLC_iPrimSensed_pu;
+    t->iSecSensed_pu = CLLC_iSecSensed_pu;
+    t->vPrimSensed_pu = CLLC_vPrimSensed_pu;
+    t->vSecSensed_pu = CLLC_vSecSensed_pu;
+    t->pwmPeriod_pu = CLLC_pwmPeriod_pu;
+    t->pwmFrequency_Hz = CLLC_pwmFrequency_Hz;
+    t->giOut = CLLC_giOut;
+    t->gvOut = CLLC_gvOut;
+    t->pwmUpdateDeferCount = CLLC_pwmUpdateDeferCount;
+    t->tripFlag = (uint16_t)CLLC_tripFlag.CLLC_TripFlag_Enum;
+    t->prechargeState =
+            (uint16_t)CLLC_PrechargeState.CLLC_PrechargeState_Enum;
+    t->setpointCount = CLLC_claSetpoint.count;
+    t->isr2Count = CLLC_claISR2Count;
+
+    CLLC_claToCpuMailbox.index = index;
+}
+
+//
+// C28x ISR3, takes the last telemetry set. The CLA publishes once per ISR2
+// and alternates the buffers, the set read here can only change under the
+// copy if two ISR2 periods pass during it.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_receiveCLATelemetry)
+static inline void CLLC_receiveCLATelemetry(void)
+{
+    volatile CLLC_CLA_Telemetry *t;
+
+    t = &CLLC_claToCpuMailbox.buffer[CLLC_claToCpuMailbox.index & 1U];
+
+    CLLC_claTelemetry.iPrimSensed_pu = t->iPrimSensed_pu;
+    CLLC_claTelemetry.iSecSensed_pu = t->iSecSensed_pu;
+    CLLC_claTelemetry.vPrimSensed_pu = t->vPrimSensed_pu;
+    CLLC_claTelemetry.vSecSensed_pu = t->vSecSensed_pu;
+    CLLC_claTelemetry.pwmPeriod_pu = t->pwmPeriod_pu;
+    CLLC_claTelemetry.pwmFrequency_Hz = t->pwmFrequency_Hz;
+    CLLC_claTelemetry.giOut = t->giOut;
+    CLLC_claTelemetry.gvOut = t->gvOut;
+    CLLC_claTelemetry.pwmUpdateDeferCount = t->pwmUpdateDeferCount;
+    CLLC_claTelemetry.tripFlag = t->tripFlag;
+    CLLC_claTelemetry.prechargeState = t->prechargeState;
+    CLLC_claTelemetry.setpointCount = t->setpointCount;
+    CLLC_claTelemetry.isr2Count = t->isr2Count;
+}
+#endif
+
+//
+// Datalogger, ISR2 logs the channels of cllc_user_settings.h, with ISR2 on
+// the CLA ISR3 logs them from the telemetry. The background drains the
+// ring into CLLC_dataLogBuffer for the graph window.
+//
+#if (CLLC_DATALOGGER_ENABLE == 1) && !defined(__TMS320C28XX_CLA__)
+#include "cllc_datalog.h"
+
+extern CLLC_DATALOG_Log CLLC_dataLog;
+extern float32_t CLLC_dataLogBuffer[CLLC_DATALOG_CHANNELS]
+                                   [CLLC_DATALOG_CAPTURE_SIZE];
+extern uint16_t CLLC_dataLogBufferCount[CLLC_DATALOG_CHANNELS];
+extern int16_t CLLC_dataLogTriggerSample[CLLC_DATALOG_CHANNELS];
+extern volatile uint16_t CLLC_dataLogSoftwareTrigger;
+extern volatile uint16_t CLLC_dataLogRearm;
+
+void CLLC_runDataLogBackground(void);
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_runDataLog)
+static inline void CLLC_runDataLog(void)
+{
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+    CLLC_DATALOG_run(&CLLC_dataLog, CLLC_claTelemetry.tripFlag);
+#else
+    CLLC_DATALOG_run(&CLLC_dataLog,
+            (CLLC_tripFlag.CLLC_TripFlag_Enum != CLLC_noTrip) ? 1U : 0U);
+#endif
+}
+#endif
+
+//
+// Telemetry, ISR3 samples the variables of cllc_user_settings.h into the
+// ring, the SCI transmit FIFO interrupt sends it out. A frame queued wakes
+// the interrupt up, it goes back to sleep once the ring is empty.
+//
+#if (CLLC_TELEMETRY_ENABLE == 1) && !defined(__TMS320C28XX_CLA__)
+#include "cllc_telemetry.h"
+
+extern CLLC_TELEMETRY_Stream CLLC_telemetry;
+
+void CLLC_runTelemetryTx(void);
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_runTelemetry)
+static inline void CLLC_runTelemetry(void)
+{
+    if(CLLC_TELEMETRY_run(&CLLC_telemetry) != 0U)
+    {
+        CLLC_HAL_enableTelemetryTxInterrupt();
+    }
+}
+#endif
+
+//
+// FSI link, ISR2 sends a sample frame every run, with ISR2 on the CLA ISR3
+// sends one from the telemetry. ISR3 takes the last setpoint frame landed
+// at its start, so a setpoint is in use at most one ISR3 period after it
+// landed. A setpoint frame overwritten unread counts as lost.
+//
+#if (CLLC_FSI_ENABLE == 1) && !defined(__TMS320C28XX_CLA__)
+#include "cllc_fsilink.h"
+#if CLLC_SHARE_ROLE != CLLC_SHARE_NONE
+#include "cllc_share.h"
+#endif
+
+extern CLLC_FSILINK_Tx CLLC_fsiTx;
+extern CLLC_FSILINK_Rx CLLC_fsiRx;
+extern CLLC_FSILINK_Setpoint CLLC_fsiSetpoint;
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_runFSITx)
+static inline void CLLC_runFSITx(void)
+{
+    CLLC_FSILINK_Sample sample;
+    CLLC_FSILINK_Frame frame;
+
+    sample.vSecSensed_pu = CLLC_ISR2_OUTPUT(vSecSensed_pu);
+    sample.iSecSensed_pu = CLLC_ISR2_OUTPUT(iSecSensed_pu);
+    sample.pwmPeriod_pu = CLLC_ISR2_OUTPUT(pwmPeriod_pu);
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+    sample.pwmPhaseShiftPrimSec_ns = CLLC_pwmPhaseShiftPrimSecRef_ns;
+#else
+    sample.pwmPhaseShiftPrimSec_ns = CLLC_pwmPhaseShiftPrimSec_ns;
+#endif
+
+    CLLC_FSILINK_packSample(&CLLC_fsiTx, &frame, &sample);
+    CLLC_HAL_writeFSITxFrame(frame.tag, frame.userData, frame.word,
+                             frame.words);
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_runFSIRx)
+static inline void CLLC_runFSIRx(void)
+{
+    CLLC_FSILINK_Frame frame;
+    uint16_t events;
+
+    events = CLLC_HAL_getFSIRxEvents();
+    if(events == 0U)
+    {
+        return;
+    }
+
+    frame.words = CLLC_FSILINK_SETPOINT_WORDS;
+    CLLC_HAL_readFSIRxFrame(&frame.tag, &frame.userData, frame.word,
+                            frame.words);
+    CLLC_HAL_clearFSIRxEvents(events);
+
+    if(CLLC_FSILINK_takeSetpoint(&CLLC_fsiRx, events, &frame,
+                                 &CLLC_fsiSetpoint) != 0U)
+    {
+        CLLC_vSecRef_Volts = CLLC_fsiSetpoint.vSecRef_Volts;
+        CLLC_iSecRef_Amps = CLLC_fsiSetpoint.iSecRef_Amps;
+        CLLC_pwmFrequencyRef_Hz = CLLC_fsiSetpoint.pwmFrequencyRef_Hz;
+    }
+}
+
+#if CLLC_SHARE_ROLE == CLLC_SHARE_MASTER
+//
+// Current sharing, see cllc_share.h. The master sends its averaged ISEC
+// from ISR3, within the limits the followers take.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_runShareTx)
+static inline void CLLC_runShareTx(void)
+{
+    CLLC_FSILINK_Share share;
+    CLLC_FSILINK_Frame frame;
+
+    share.iSecRef_pu = CLLC_avg.out[CLLC_AVG_ISEC];
+    if(share.iSecRef_pu < (CLLC_FSI_ISEC_REF_MIN_AMPS /
+                           CLLC_ISEC_MAX_SENSE_AMPS))
+    {
+        share.iSecRef_pu = CLLC_FSI_ISEC_REF_MIN_AMPS /
+                           CLLC_ISEC_MAX_SENSE_AMPS;
+    }
+    else if(share.iSecRef_pu > (CLLC_FSI_ISEC_REF_MAX_AMPS /
+                                CLLC_ISEC_MAX_SENSE_AMPS))
+    {
+        share.iSecRef_pu = CLLC_FSI_ISEC_REF_MAX_AMPS /
+                           CLLC_ISEC_MAX_SENSE_AMPS;
+    }
+    share.vSecRef_pu = CLLC_vSecRefSlewed_pu;
+
+    CLLC_FSILINK_packShare(&CLLC_fsiTx, &frame, &share);
+    CLLC_HAL_writeFSITxFrame(frame.tag, frame.userData, frame.word,
+                             frame.words);
+}
+#endif
+
+#if CLLC_SHARE_ROLE == CLLC_SHARE_FOLLOWER
+extern CLLC_FSILINK_Share CLLC_fsiShare;
+extern CLLC_SHARE_Follower CLLC_shareFollower;
+
+//
+// A follower takes the share frame landed at the start of ISR3 and sends it
+// on to the next board as it is. The voltage reference of the master with
+// the trim of the current loop goes to CLLC_vSecRef_Volts and through the
+// slew of ISR3 to the voltage loop.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_runShareRx)
+static inline void CLLC_runShareRx(void)
+{
+    CLLC_FSILINK_Frame frame;
+    uint16_t events;
+    uint16_t taken = 0;
+
+    events = CLLC_HAL_getFSIRxEvents();
+    if(events != 0U)
+    {
+        frame.words = CLLC_FSILINK_SHARE_WORDS;
+        CLLC_HAL_readFSIRxFrame(&frame.tag, &frame.userData, frame.word,
+                                frame.words);
+        CLLC_HAL_clearFSIRxEvents(events);
+
+        taken = CLLC_FSILINK_takeShare(&CLLC_fsiRx, events, &frame,
+                                       &CLLC_fsiShare);
+        if(taken != 0U)
+        {
+            CLLC_HAL_writeFSITxFrame(frame.tag, frame.userData, frame.word,
+                                     frame.words);
+        }
+    }
+
+    CLLC_vSecRef_Volts = CLLC_SHARE_poll(&CLLC_shareFollower, taken,
+                                         CLLC_fsiShare.iSecRef_pu,
+                                         CLLC_fsiShare.vSecRef_pu,
+                                         CLLC_avg.out[CLLC_AVG_ISEC]) *
+                         CLLC_VSEC_OPTIMAL_RANGE_VOLTS;
+}
+#endif
+#endif
+
+//
+// CAN-FD service, ISR3 runs it every CLLC_CAN_TICK_DECIMATION runs. The
+// reports go out of the ISR3 averages and the last ISR2 outputs, setpoints
+// and loop enables taken are applied as they would be from the watch window.
+//
+#if (CLLC_CAN_ENABLE == 1) && !defined(__TMS320C28XX_CLA__)
+#include "cllc_canlink.h"
+
+extern CLLC_CANLINK_Link CLLC_canLink;
+extern CLLC_CANLINK_Command CLLC_canCommand;
+extern uint16_t CLLC_canTickCount;
+
+void CLLC_runCAN(void);
+#endif
+
+//
+// The duty and phase shift terms of the tick calculation only depend on
+// the references, they are worked out here when a reference changes, not at
+// every change of the switching frequency. The expressions are the ones the
+// tick calculation used inline, so the ticks come out bit for bit the same.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_calculatePWMDutyPhaseShiftFactors_primToSecPowerFlow)
+static inline void CLLC_calculatePWMDutyPhaseShiftFactors_primToSecPowerFlow(
+        CLLC_PWMFactors *f)
+{
+    f->dutyAPrimFactor = (float32_t)(1 - fabsf(CLLC_pwmDutyPrim_pu));
+    f->dutyASecFactor = (float32_t)(fabsf(CLLC_pwmDutySec_pu));
+
+    //
+    // phase_shift_ns_ticks = phase_shift_ns * pwm_clk_hz * one_ns * 2^16
+    //
+    f->phaseShiftPrimSecDelay_ticks =
+            (int32_t)((float32_t)CLLC_pwmPhaseShiftPrimSec_ns *
+                      CLLC_PWMSYSCLOCK_FREQ_HZ * ONE_NANO_SEC *
+                      TWO_RAISED_TO_THE_POWER_SIXTEEN);
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_calculatePWMDutyPhaseShiftFactors_secToPrimPowerFlow)
+static inline void CLLC_calculatePWMDutyPhaseShiftFactors_secToPrimPowerFlow(
+        CLLC_PWMFactors *f)
+{
+    f->dutyASecFactor = (float32_t)(1 - fabsf(CLLC_pwmDutySec_pu));
+    f->dutyAPrimFactor = (float32_t)(fabsf(CLLC_pwmDutyPrim_pu));
+
+    f->phaseShiftPrimSecDelay_ticks =
+            (int32_t)((float32_t)CLLC_pwmPhaseShiftPrimSec_ns *
+                      CLLC_PWMSYSCLOCK_FREQ_HZ * ONE_NANO_SEC);
+}
+
+//
+// ISR3 takes the duty and phase shift references. When one changed it
+// works out the factors into the set ISR2 does not read and then counts,
+// ISR2 only takes the set of a new count.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_takePWMReferences)
+static inline void CLLC_takePWMReferences(void)
+{
+    CLLC_PWMFactors *f;
+
+    if((CLLC_pwmPhaseShiftPrimSec_ns == CLLC_pwmPhaseShiftPrimSecRef_ns) &&
+       (CLLC_pwmDutyPrim_pu == CLLC_pwmDutyPrimRef_pu) &&
+       (CLLC_pwmDutySec_pu == CLLC_pwmDutySecRef_pu))
+    {
+        return;
+    }
+
+    CLLC_pwmDutyPrim_pu = CLLC_pwmDutyPrimRef_pu;
+    CLLC_pwmDutySec_pu = CLLC_pwmDutySecRef_pu;
+    CLLC_pwmPhaseShiftPrimSec_ns = CLLC_pwmPhaseShiftPrimSecRef_ns;
+
+    f = &CLLC_pwmFactorsSet[(CLLC_pwmFactorsCount + 1U) & 1U];
+
+    if(CLLC_powerFlowStateActive.CLLC_PowerFlowState_Enum ==
+            CLLC_powerFlow_SecToPrim)
+    {
+        CLLC_calculatePWMDutyPhaseShiftFactors_secToPrimPowerFlow(f);
+    }
+    else
+    {
+        CLLC_calculatePWMDutyPhaseShiftFactors_primToSecPowerFlow(f);
+    }
+
+    CLLC_pwmFactorsCount++;
+}
+
+//
+// Sets the factors the tick calculation of ISR2 works from
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_setPWMDutyPhaseShiftFactors)
+static inline void CLLC_setPWMDutyPhaseShiftFactors(const CLLC_PWMFactors *f)
+{
+    CLLC_pwmDutyAPrimFactor = f->dutyAPrimFactor;
+    CLLC_pwmDutyASecFactor = f->dutyASecFactor;
+    CLLC_pwmPhaseShiftPrimSecDelay_ticks = f->phaseShiftPrimSecDelay_ticks;
+}
+
+//
+// ISR2 takes the factors of the references ISR3 took last, once per count.
+// Returns 1 if it took a new set.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_takePWMDutyPhaseShiftFactors)
+static inline uint16_t CLLC_takePWMDutyPhaseShiftFactors(void)
+{
+    uint16_t count = CLLC_ISR2_INPUT(pwmFactorsCount);
+
+    if(count == CLLC_pwmFactorsTaken)
+    {
+        return(0);
+    }
+
+    CLLC_pwmFactorsTaken = count;
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+    CLLC_setPWMDutyPhaseShiftFactors(&CLLC_claSetpoint.pwmFactors);
+#else
+    CLLC_setPWMDutyPhaseShiftFactors(&CLLC_pwmFactorsSet[count & 1U]);
+#endif
+    return(1);
+}
+
 static inline void CLLC_calculatePWMDutyPeriodPhaseShiftTicks_primToSecPowerFlow(void)
 {
     uint32_t temp;
@@ -411,9 +1300,14 @@ static inline void CLLC_calculatePWMDutyPeriodPhaseShiftTicks_primToSecPowerFlow
     // for hi-res the duty needs to set around period hence calculate
     // duty ticks as (period *(1-duty))
     //
+#if CLLC_PHASES > 1
+    CLLC_pwmDutyAPrim_ticks = (uint32_t)((float32_t)CLLC_pwmPeriod_ticks *
+                                         (CLLC_pwmDutyAPrimFactor +
+                                          CLLC_phase[0].dutyTrim_pu));
+#else
     CLLC_pwmDutyAPrim_ticks = (uint32_t)((float32_t)CLLC_pwmPeriod_ticks *
-                                         (float32_t)
-                                         (1 - fabsf(CLLC_pwmDutyPrim_pu)));
+                                         CLLC_pwmDutyAPrimFactor);
+#endif
 
     CLLC_pwmDutyBPrim_ticks = CLLC_pwmDutyAPrim_ticks;
 
@@ -430,8 +1324,7 @@ static inline void CLLC_calculatePWMDutyPeriodPhaseShiftTicks_primToSecPowerFlow
     // hence multiply by 2 (<<1) for period*duty
     //
     CLLC_pwmDutyASec_ticks = (uint32_t)((float32_t)CLLC_pwmPeriod_ticks *
-                                      (float32_t)
-                                      (fabsf(CLLC_pwmDutySec_pu))) << 1;
+                                        CLLC_pwmDutyASecFactor) << 1;
 
     //
     // for secondary side B ticks = period - duty_a
@@ -447,9 +1340,7 @@ static inline void CLLC_calculatePWMDutyPeriodPhaseShiftTicks_primToSecPowerFlow
     //
     CLLC_pwmPhaseShiftPrimSec_ticks =
             ((int32_t)(CLLC_pwmPeriod_ticks >> 1) -
-             (int32_t)((float32_t)CLLC_pwmPhaseShiftPrimSec_ns *
-                       CLLC_PWMSYSCLOCK_FREQ_HZ * ONE_NANO_SEC *
-                       TWO_RAISED_TO_THE_POWER_SIXTEEN) +
+             CLLC_pwmPhaseShiftPrimSecDelay_ticks +
              ((int32_t)2 << 16));
 
     //
@@ -470,8 +1361,9 @@ static inline void CLLC_calculatePWMDutyPeriodPhaseShiftTicks_secToPrimPowerFlow
     // for this multiply by 2^16 , and divide by 1 (using left shift)
     // as the PWM is up down count mode
     //
-    temp = ((uint32_t)(((float32_t)(CLLC_pwmPeriod_pu *
-                                   CLLC_pwmPeriodMax_ticks))))>> 1;
+    temp = ((uint32_t)(((float32_t)(CLLC_pwmPeriodSlewed_pu *
+                                   CLLC_pwmPeriodMax_ticks) *
+                       (float32_t)TWO_RAISED_TO_THE_POWER_SIXTEEN)))>> 1;
 
     //
     // next zero the lower 8 bits, as they are not part of TBPRDHR register
@@ -483,8 +1375,7 @@ static inline void CLLC_calculatePWMDutyPeriodPhaseShiftTicks_secToPrimPowerFlow
     // duty ticks as (period *(1-duty))
     //
     CLLC_pwmDutyASec_ticks = (uint32_t)((float32_t)CLLC_pwmPeriod_ticks *
-                                         (float32_t)
-                                         (1 - fabsf(CLLC_pwmDutySec_pu)));
+                                         CLLC_pwmDutyASecFactor);
 
     CLLC_pwmDutyBSec_ticks = CLLC_pwmDutyASec_ticks;
 
@@ -493,8 +1384,7 @@ static inline void CLLC_calculatePWMDutyPeriodPhaseShiftTicks_secToPrimPowerFlow
     // not centered around zero or period
     //
     CLLC_pwmDutyAPrim_ticks = (uint32_t)((float32_t)CLLC_pwmPeriod_ticks *
-                                      (float32_t)
-                                      (fabsf(CLLC_pwmDutyPrim_pu))) << 1;
+                                         CLLC_pwmDutyAPrimFactor) << 1;
 
     //
     // dutyB = period - dutyA
@@ -518,8 +1408,7 @@ static inline void CLLC_calculatePWMDutyPeriodPhaseShiftTicks_secToPrimPowerFlow
     //
     CLLC_pwmPhaseShiftPrimSec_ticks =
             ((int32_t)(CLLC_pwmPeriod_ticks >> 1) +
-             (int32_t)((float32_t)CLLC_pwmPhaseShiftPrimSec_ns *
-                       CLLC_PWMSYSCLOCK_FREQ_HZ * ONE_NANO_SEC) +
+             CLLC_pwmPhaseShiftPrimSecDelay_ticks +
              ((int32_t)2 << 16));
 
 }
@@ -549,6 +1438,10 @@ static inline void CLLC_calculatePWMDeadBandPrimTicks(void)
 #pragma FUNC_ALWAYS_INLINE(CLLC_precharge)
 static inline void CLLC_precharge(void)
 {
+#if CLLC_PHASES > 1
+    uint16_t i;
+
+#endif
     if (CLLC_PrechargeState.CLLC_PrechargeState_Enum == CLLC_precharge_none)
     {
         // Set same phase between PWM1A & PWM2A
@@ -557,6 +1450,12 @@ static inline void CLLC_precharge(void)
         HWREG(CLLC_PRIM_LEG2_PWM_BASE + EPWM_O_TBPHS) = (int32_t)((float32_t)(CLLC_CONTROL_PRECHARGE_TPBRD_MAX) 
                                     * TWO_RAISED_TO_THE_POWER_SIXTEEN);
         EDIS;
+#if CLLC_GLOBAL_LOAD_ENABLED == 1
+        //
+        // PRIM LEG2 only sees a sync at a global load reload
+        //
+        CLLC_HAL_commitPWMUpdate();
+#endif
         // Reset count
         CLLC_precharge_count = CLLC_CONTROL_PRECHARGE_COUNT;
     }
@@ -570,12 +1469,24 @@ static inline void CLLC_precharge(void)
             HWREG(CLLC_PRIM_LEG2_PWM_BASE + EPWM_O_TBPHS) = (int32_t)((float32_t)(CLLC_CONTROL_PRECHARGE_TPBRD_MAX * 
             CLLC_precharge_count / CLLC_CONTROL_PRECHARGE_COUNT) * TWO_RAISED_TO_THE_POWER_SIXTEEN);
             EDIS;
+#if CLLC_GLOBAL_LOAD_ENABLED == 1
+            CLLC_HAL_commitPWMUpdate();
+#endif
         }
         else
         {
             // End pre-charge mode
             CLLC_PrechargeState.CLLC_PrechargeState_Enum = CLLC_precharge_finished;
             EPWM_disablePhaseShiftLoad(CLLC_PRIM_LEG2_PWM_BASE);
+#if CLLC_PHASES > 1
+            //
+            // the output is charged, the other phases join phase 0
+            //
+            for(i = 1; i < CLLC_PHASES; i++)
+            {
+                CLLC_HAL_releasePhase(&CLLC_phase[i]);
+            }
+#endif
         }
     }
 }
@@ -592,9 +1503,13 @@ static inline void CLLC_runISR1(void)
                       CLLC_pwmDutyBSec_ticks,
                       CLLC_pwmPhaseShiftPrimSec_ticks);
 
+#if CLLC_GLOBAL_LOAD_ENABLED == 1
+    CLLC_HAL_commitPWMUpdate();
+#else
     EPWM_enablePhaseShiftLoad(CLLC_SEC_LEG1_PWM_BASE);
     EPWM_enablePhaseShiftLoad(CLLC_SEC_LEG2_PWM_BASE);
-    
+#endif
+
     HWREGH(CLLC_ISR1_PERIPHERAL_TRIG_BASE + EPWM_O_CMPA + EPWM_COUNTER_COMPARE_C) = 0xFFFF;
 
     //
@@ -615,24 +1530,243 @@ static inline void CLLC_runISR1_secondTime(void)
     CLLC_HAL_clearISR1PeripheralInterruptFlag();
 }
 
+//
+// CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD, the ticks go to the shadow registers
+// straight from ISR2 and are committed with the global load, unless the zero
+// of PRIM LEG1 is too close, then the next ISR2 tries again
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_updatePWMFromISR2)
+static inline void CLLC_updatePWMFromISR2(void)
+{
+#if CLLC_PHASES > 1
+    uint16_t i;
+
+#endif
+    if(CLLC_HAL_isPWMUpdateWindowOpen())
+    {
+        CLLC_HAL_updatePWMDutyPeriodPhaseShift(CLLC_pwmPeriod_ticks,
+                          CLLC_pwmDutyAPrim_ticks,
+                          CLLC_pwmDutyBPrim_ticks,
+                          CLLC_pwmDutyASec_ticks,
+                          CLLC_pwmDutyBSec_ticks,
+                          CLLC_pwmPhaseShiftPrimSec_ticks);
+#if CLLC_PHASES > 1
+        for(i = 1; i < CLLC_PHASES; i++)
+        {
+            CLLC_HAL_updatePhasePWM(&CLLC_phase[i]);
+        }
+#endif
+        CLLC_HAL_commitPWMUpdate();
+        CLLC_pwmUpdateDeferred = 0;
+    }
+    else
+    {
+        CLLC_pwmUpdateDeferred = 1;
+        CLLC_pwmUpdateDeferCount++;
+    }
+}
+
+//
+// The period applied moves towards the one asked for by at most
+// CLLC_MAX_PERIOD_STEP_PU per ISR2
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_slewPWMPeriod)
+static inline void CLLC_slewPWMPeriod(void)
+{
+    if(fabsf(CLLC_pwmPeriod_pu - CLLC_pwmPeriodSlewed_pu) >
+                            CLLC_MAX_PERIOD_STEP_PU)
+    {
+        CLLC_STATS_COUNT(periodSlewLimits);
+        if(CLLC_pwmPeriod_pu > CLLC_pwmPeriodSlewed_pu)
+        {
+            CLLC_pwmPeriodSlewed_pu = CLLC_pwmPeriodSlewed_pu +
+                                        CLLC_MAX_PERIOD_STEP_PU;
+        }
+        else
+        {
+            CLLC_pwmPeriodSlewed_pu = CLLC_pwmPeriodSlewed_pu -
+                                        CLLC_MAX_PERIOD_STEP_PU;
+        }
+    }
+    else
+    {
+        CLLC_pwmPeriodSlewed_pu = CLLC_pwmPeriod_pu;
+    }
+}
+
+//
+// Prim to sec loops. The period goes out as soon as the immediate part of
+// the DF13 is done, the rest is worked out for the next ISR2. The output is
+// clamped to the period that can be applied before it goes back into the
+// history, so the loop does not wind up while the period sits at a limit.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_runGiLoop_primToSecPowerFlow)
+static inline void CLLC_runGiLoop_primToSecPowerFlow(void)
+{
+    CLLC_giError = CLLC_SFRA_INJECT(CLLC_ISR2_INPUT(iSecRefSlewed_pu)) -
+                   CLLC_iSecSensed_pu;
+
+    CLLC_giOut = CLLC_GI_IMMEDIATE_RUN(&CLLC_gi,
+                                       CLLC_giError,
+                                       CLLC_giPartialComputedValue);
+
+    if(CLLC_giOut > CLLC_GI_OUT_MAX)
+    {
+        CLLC_giOut = CLLC_GI_OUT_MAX;
+        CLLC_STATS_COUNT(giOutMaxClamps);
+    }
+    if(CLLC_giOut < CLLC_pwmPeriodMin_pu)
+    {
+        CLLC_giOut = CLLC_pwmPeriodMin_pu;
+        CLLC_STATS_COUNT(giOutMinClamps);
+    }
+
+    CLLC_pwmPeriod_pu = CLLC_giOut;
+
+    CLLC_giPartialComputedValue = CLLC_GI_PRECOMPUTE_RUN(&CLLC_gi,
+                                                         CLLC_giError,
+                                                         CLLC_giOut);
+}
+
+//
+// Scales the error of GV by the gain schedule at the slewed period, see
+// cllc_gvsched.h
+//
+#if CLLC_GV_SCHEDULE == 1
+#pragma FUNC_ALWAYS_INLINE(CLLC_scheduleGvError)
+static inline void CLLC_scheduleGvError(void)
+{
+    CLLC_gvError = CLLC_gvError *
+                   CLLC_GVSCHED_getGain(&CLLC_gvSchedule,
+                                        CLLC_pwmPeriodSlewed_pu,
+                                        CLLC_pwmPeriodMin_pu,
+                                        CLLC_gvScheduleScale);
+}
+#endif
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_runGvLoop_primToSecPowerFlow)
+static inline void CLLC_runGvLoop_primToSecPowerFlow(void)
+{
+#if CLLC_SHARE_ROLE != CLLC_SHARE_NONE
+    CLLC_gvError = CLLC_SHARE_getDroopError(
+                        CLLC_SFRA_INJECT(CLLC_ISR2_INPUT(vSecRefSlewed_pu)),
+                        CLLC_vSecSensed_pu, CLLC_iSecSensed_pu,
+                        CLLC_SHARE_DROOP_PU);
+#else
+    CLLC_gvError = CLLC_SFRA_INJECT(CLLC_ISR2_INPUT(vSecRefSlewed_pu)) -
+                   CLLC_vSecSensed_pu;
+#endif
+#if CLLC_GV_SCHEDULE == 1
+    CLLC_scheduleGvError();
+#endif
+
+    CLLC_gvOut = CLLC_GV_IMMEDIATE_RUN(&CLLC_gv,
+                                       CLLC_gvError,
+                                       CLLC_gvPartialComputedValue);
+
+    if(CLLC_gvOut > CLLC_GV_OUT_MAX)
+    {
+        CLLC_gvOut = CLLC_GV_OUT_MAX;
+        CLLC_STATS_COUNT(gvOutMaxClamps);
+    }
+    if(CLLC_gvOut < CLLC_pwmPeriodMin_pu)
+    {
+        CLLC_gvOut = CLLC_pwmPeriodMin_pu;
+        CLLC_STATS_COUNT(gvOutMinClamps);
+    }
+
+    CLLC_pwmPeriod_pu = CLLC_gvOut;
+
+    CLLC_gvPartialComputedValue = CLLC_GV_PRECOMPUTE_RUN(&CLLC_gv,
+                                                         CLLC_gvError,
+                                                         CLLC_gvOut);
+}
+
+//
+// Open loop, the period follows CLLC_pwmPeriodRef_pu. The history of both
+// loops holds the present period and error, and ISR3 keeps the slewed
+// references on the sensed values, so a loop closed here starts from the
+// period that is running.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_trackOpenLoop_primToSecPowerFlow)
+static inline void CLLC_trackOpenLoop_primToSecPowerFlow(void)
+{
+    CLLC_giError = CLLC_ISR2_INPUT(iSecRefSlewed_pu) - CLLC_iSecSensed_pu;
+    CLLC_gi.d1 = CLLC_giError;
+    CLLC_gi.d2 = CLLC_giError;
+    CLLC_gi.d5 = CLLC_pwmPeriod_pu;
+    CLLC_gi.d6 = CLLC_pwmPeriod_pu;
+    CLLC_giPartialComputedValue = CLLC_pwmPeriod_pu -
+                                  (CLLC_gi.b0 * CLLC_giError);
+
+#if CLLC_SHARE_ROLE != CLLC_SHARE_NONE
+    CLLC_gvError = CLLC_SHARE_getDroopError(CLLC_ISR2_INPUT(vSecRefSlewed_pu),
+                                            CLLC_vSecSensed_pu,
+                                            CLLC_iSecSensed_pu,
+                                            CLLC_SHARE_DROOP_PU);
+#else
+    CLLC_gvError = CLLC_ISR2_INPUT(vSecRefSlewed_pu) - CLLC_vSecSensed_pu;
+#endif
+#if CLLC_GV_SCHEDULE == 1
+    CLLC_scheduleGvError();
+#endif
+    CLLC_gv.d1 = CLLC_gvError;
+    CLLC_gv.d2 = CLLC_gvError;
+    CLLC_gv.d5 = CLLC_pwmPeriod_pu;
+    CLLC_gv.d6 = CLLC_pwmPeriod_pu;
+    CLLC_gvPartialComputedValue = CLLC_pwmPeriod_pu -
+                                  (CLLC_gv.b0 * CLLC_gvError);
+
+    #if CLLC_INCR_BUILD == CLLC_OPEN_LOOP_BUILD
+        CLLC_pwmPeriod_pu = CLLC_SFRA_INJECT(CLLC_ISR2_INPUT(pwmPeriodRef_pu));
+    #else
+        CLLC_pwmPeriod_pu = CLLC_ISR2_INPUT(pwmPeriodRef_pu);
+    #endif
+
+    if(CLLC_pwmPeriod_pu < CLLC_pwmPeriodMin_pu)
+    {
+        CLLC_pwmPeriod_pu = CLLC_pwmPeriodMin_pu;
+    }
+    else if(CLLC_pwmPeriod_pu > 1.0)
+    {
+        CLLC_pwmPeriod_pu = 1.0;
+    }
+}
+
 #pragma FUNC_ALWAYS_INLINE(CLLC_runISR2_primToSecPowerFlow)
 static inline void CLLC_runISR2_primToSecPowerFlow(void)
 {
+    uint16_t pwmUpdate;
+    uint16_t closeLoop;
+#if CLLC_PHASES > 1
+    uint16_t phaseUpdate = 0;
+    uint16_t i;
+#endif
+
     //
     // Read Current and Voltage Measurements
     //
     CLLC_readSensedSignalsPrimToSecPowerFlow();
+#if CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_ISR2
     CLLC_updateBoardStatus();
+#endif
 
     // Let start by clearTrip = 1
-    if(CLLC_clearTrip == 1)
+    if(CLLC_takeClearTripRequest())
     {
         CLLC_HAL_clearPWMTripFlags(CLLC_PRIM_LEG1_PWM_BASE);
         CLLC_HAL_clearPWMTripFlags(CLLC_PRIM_LEG2_PWM_BASE);
         CLLC_HAL_clearPWMTripFlags(CLLC_SEC_LEG1_PWM_BASE);
         CLLC_HAL_clearPWMTripFlags(CLLC_SEC_LEG2_PWM_BASE);
-
-        CLLC_clearTrip = 0;
+#if CLLC_PHASES > 1
+        //
+        // the other phases wait for the precharge again
+        //
+        for(i = 1; i < CLLC_PHASES; i++)
+        {
+            CLLC_HAL_holdPhase(&CLLC_phase[i]);
+        }
+#endif
 
         // Ready to go to mode pre-charge
         CLLC_PrechargeState.CLLC_PrechargeState_Enum = CLLC_precharge_none;
@@ -640,7 +1774,45 @@ static inline void CLLC_runISR2_primToSecPowerFlow(void)
     if (CLLC_PrechargeState.CLLC_PrechargeState_Enum != CLLC_precharge_finished) CLLC_precharge();
     else
     {
-        // Calculate control values in here
+        #if CLLC_INCR_BUILD == CLLC_CLOSED_LOOP_BUILD
+            #if CLLC_CONTROL_MODE == CLLC_CURRENT_MODE
+                closeLoop = (CLLC_ISR2_INPUT(closeGiLoop) == 1);
+            #else
+                closeLoop = (CLLC_ISR2_INPUT(closeGvLoop) == 1);
+            #endif
+        #else
+            closeLoop = 0;
+        #endif
+
+        if(closeLoop)
+        {
+            #if CLLC_CONTROL_MODE == CLLC_CURRENT_MODE
+                CLLC_runGiLoop_primToSecPowerFlow();
+            #else
+                CLLC_runGvLoop_primToSecPowerFlow();
+            #endif
+        }
+        else
+        {
+            CLLC_trackOpenLoop_primToSecPowerFlow();
+        }
+
+        #if CLLC_SFRA_TYPE == CLLC_SFRA_CURRENT
+            CLLC_SFRA_COLLECT((float *)&CLLC_pwmPeriod_pu,
+                              (float *)&CLLC_iSecSensed_pu);
+        #else
+            CLLC_SFRA_COLLECT((float *)&CLLC_pwmPeriod_pu,
+                              (float *)&CLLC_vSecSensed_pu);
+        #endif
+
+        CLLC_slewPWMPeriod();
+
+#if CLLC_PHASES > 1
+        phaseUpdate = CLLC_PHASE_share(CLLC_phase, CLLC_PHASES,
+                                       1.0f / (float32_t)CLLC_PHASES,
+                                       CLLC_PHASE_SHARE_KI,
+                                       CLLC_PHASE_TRIM_MAX_PU);
+#endif
     }
 
     CLLC_pwmFrequency_Hz = (CLLC_PWMSYSCLOCK_FREQ_HZ /
@@ -652,59 +1824,85 @@ static inline void CLLC_runISR2_primToSecPowerFlow(void)
     //
     // Only issue ISR1 if there is a change in the PWM
     //
-    if((CLLC_pwmFrequencyPrev_Hz != CLLC_pwmFrequency_Hz) ||
-       (CLLC_pwmPhaseShiftPrimSec_ns != CLLC_pwmPhaseShiftPrimSecRef_ns) ||
-       (CLLC_pwmDutyPrim_pu != CLLC_pwmDutyPrimRef_pu) ||
-       (CLLC_pwmDutySec_pu != CLLC_pwmDutySecRef_pu))
+    pwmUpdate = (CLLC_pwmFrequencyPrev_Hz != CLLC_pwmFrequency_Hz);
+#if CLLC_PWM_UPDATE_MODE == CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD
+    pwmUpdate |= CLLC_pwmUpdateDeferred;
+#endif
+#if CLLC_PHASES > 1
+    pwmUpdate |= phaseUpdate;
+#endif
+
+    if(CLLC_takePWMDutyPhaseShiftFactors())
     {
-        CLLC_pwmDutyPrim_pu = CLLC_pwmDutyPrimRef_pu;
-        CLLC_pwmDutySec_pu = CLLC_pwmDutySecRef_pu;
-        CLLC_pwmPhaseShiftPrimSec_ns = CLLC_pwmPhaseShiftPrimSecRef_ns;
+        pwmUpdate = 1;
+    }
 
+    if(pwmUpdate)
+    {
         CLLC_calculatePWMDutyPeriodPhaseShiftTicks_primToSecPowerFlow();
+#if CLLC_PHASES > 1
+        CLLC_PHASE_calculateTicks(&CLLC_phase[1], CLLC_PHASES - 1,
+                                  CLLC_pwmPeriod_ticks,
+                                  CLLC_pwmDutyAPrimFactor,
+                                  (uint32_t)CLLC_pwmPhaseShiftPrimSec_ticks);
+#endif
 
-        CLLC_HAL_setupISR1Trigger(CLLC_pwmFrequencyPrev_Hz);
+#if CLLC_PWM_UPDATE_MODE == CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD
+        CLLC_updatePWMFromISR2();
 
         CLLC_pwmFrequencyPrev_Hz = CLLC_pwmFrequency_Hz;
+#else
+        //
+        // ISR1 fires at the end of the present period, which still runs at
+        // the previous frequency, whose trigger was worked out at the last
+        // update. A trigger still set is one ISR1 has not taken yet, it
+        // moves and that update goes out with this one.
+        //
+        if(CLLC_HAL_isISR1TriggerPending())
+        {
+            CLLC_STATS_COUNT(isr1Retriggers);
+        }
+        CLLC_HAL_setISR1TriggerTicks(CLLC_pwmISRTrig_ticks);
 
-        #if CLLC_ISR1_RUNNING_ON == CLA_CORE
-              CLLC_pwmISRTrig_ticks =
-                     ((TICKS_IN_PWM_FREQUENCY(CLLC_pwmFrequency_Hz,
-                                          CLLC_PWMSYSCLOCK_FREQ_HZ)>> 1) - 20);
-        #else
-              CLLC_pwmISRTrig_ticks =
-                     ((TICKS_IN_PWM_FREQUENCY(CLLC_pwmFrequency_Hz,
-                                          CLLC_PWMSYSCLOCK_FREQ_HZ)>> 1) - 27);
-        #endif
+        CLLC_pwmFrequencyPrev_Hz = CLLC_pwmFrequency_Hz;
+
+        CLLC_pwmISRTrig_ticks =
+                CLLC_HAL_getISR1TriggerTicks(CLLC_pwmFrequency_Hz);
+#endif
     }
 }
 
 #pragma FUNC_ALWAYS_INLINE(CLLC_runISR2_secToPrimPowerFlow)
 static inline void CLLC_runISR2_secToPrimPowerFlow(void)
 {
+    uint16_t pwmUpdate;
+
     //
     // Read Current and Voltage Measurements
     //
     CLLC_readSensedSignalsSecToPrimPowerFlow();
 
-    if(CLLC_clearTrip == 1)
+    if(CLLC_takeClearTripRequest())
     {
         CLLC_HAL_clearPWMTripFlags(CLLC_PRIM_LEG1_PWM_BASE);
         CLLC_HAL_clearPWMTripFlags(CLLC_PRIM_LEG2_PWM_BASE);
         CLLC_HAL_clearPWMTripFlags(CLLC_SEC_LEG1_PWM_BASE);
         CLLC_HAL_clearPWMTripFlags(CLLC_SEC_LEG2_PWM_BASE);
-
-        CLLC_clearTrip = 0;
     }
 
-    if(CLLC_closeGvLoop == 1)
+    if(CLLC_ISR2_INPUT(closeGvLoop) == 1)
     {
 
-        #if SFRA_TYPE == SFRA_DISABLED
-            CLLC_gvError = (CLLC_vPrimRefSlewed_pu - CLLC_vPrimSensed_pu);
+        #if CLLC_SFRA_TYPE == CLLC_SFRA_DISABLED
+            CLLC_gvError = (CLLC_ISR2_INPUT(vPrimRefSlewed_pu) -
+                            CLLC_vPrimSensed_pu);
         #else
-            CLLC_gvError = (SFRA_INJECT(CLLC_vPrimRefSlewed_pu) -
-                                      CLLC_vPrimSensed_pu);
+            CLLC_gvError =
+                    (CLLC_SFRA_INJECT(CLLC_ISR2_INPUT(vPrimRefSlewed_pu)) -
+                     CLLC_vPrimSensed_pu);
+        #endif
+        #if CLLC_GV_SCHEDULE == 1
+            CLLC_scheduleGvError();
         #endif
 
         CLLC_gvOut = CLLC_GV_IMMEDIATE_RUN(&CLLC_gv,
@@ -714,10 +1912,12 @@ static inline void CLLC_runISR2_secToPrimPowerFlow(void)
         if(CLLC_gvOut > CLLC_GV_OUT_MAX)
         {
             CLLC_gvOut = CLLC_GV_OUT_MAX;
+            CLLC_STATS_COUNT(gvOutMaxClamps);
         }
         if(CLLC_gvOut < CLLC_GV_OUT_MIN)
         {
             CLLC_gvOut = CLLC_GV_OUT_MIN;
+            CLLC_STATS_COUNT(gvOutMinClamps);
         }
 
         CLLC_gvPartialComputedValue = CLLC_GV_PRECOMPUTE_RUN(&CLLC_gv,
@@ -744,7 +1944,11 @@ static inline void CLLC_runISR2_secToPrimPowerFlow(void)
         CLLC_gv.d6 = CLLC_pwmPeriod_pu;
         CLLC_gv.d7 = CLLC_pwmPeriod_pu;
 
-        CLLC_gvError = (CLLC_vPrimRefSlewed_pu - CLLC_vPrimSensed_pu);
+        CLLC_gvError = (CLLC_ISR2_INPUT(vPrimRefSlewed_pu) -
+                        CLLC_vPrimSensed_pu);
+        #if CLLC_GV_SCHEDULE == 1
+            CLLC_scheduleGvError();
+        #endif
         CLLC_gv.d0 = CLLC_gvError;
         CLLC_gv.d1 = CLLC_gvError;
         CLLC_gv.d2 = CLLC_gvError;
@@ -754,13 +1958,13 @@ static inline void CLLC_runISR2_secToPrimPowerFlow(void)
 
         #if CLLC_INCR_BUILD == CLLC_OPEN_LOOP_BUILD
             #if CLLC_SFRA_TYPE == CLLC_SFRA_DISABLED
-                CLLC_pwmPeriod_pu = CLLC_pwmPeriodRef_pu;
+                CLLC_pwmPeriod_pu = CLLC_ISR2_INPUT(pwmPeriodRef_pu);
             #else
                 CLLC_pwmPeriod_pu =
-                        CLLC_SFRA_INJECT(CLLC_pwmPeriodRef_pu);
+                        CLLC_SFRA_INJECT(CLLC_ISR2_INPUT(pwmPeriodRef_pu));
             #endif
         #else
-            CLLC_pwmPeriod_pu = CLLC_pwmPeriodRef_pu;
+            CLLC_pwmPeriod_pu = CLLC_ISR2_INPUT(pwmPeriodRef_pu);
         #endif
 
         if(CLLC_pwmPeriod_pu < CLLC_pwmPeriodMin_pu)
@@ -773,24 +1977,10 @@ static inline void CLLC_runISR2_secToPrimPowerFlow(void)
         }
     }
 
-    if(fabsf(CLLC_pwmPeriod_pu - CLLC_pwmPeriodSlewed_pu) >
-                            CLLC_MAX_PERIOD_STEP_PU)
-    {
-        if(CLLC_pwmPeriod_pu > CLLC_pwmPeriodSlewed_pu)
-        {
-            CLLC_pwmPeriodSlewed_pu = CLLC_pwmPeriodSlewed_pu +
-                                        CLLC_MAX_PERIOD_STEP_PU;
-        }
-        else
-        {
-            CLLC_pwmPeriodSlewed_pu = CLLC_pwmPeriodSlewed_pu -
-                                        CLLC_MAX_PERIOD_STEP_PU;
-        }
-    }
-    else
-    {
-        CLLC_pwmPeriodSlewed_pu = CLLC_pwmPeriod_pu;
-    }
+    CLLC_SFRA_COLLECT((float *)&CLLC_pwmPeriod_pu,
+                      (float *)&CLLC_vPrimSensed_pu);
+
+    CLLC_slewPWMPeriod();
 
     CLLC_pwmFrequency_Hz = (CLLC_PWMSYSCLOCK_FREQ_HZ /
                              (CLLC_pwmPeriodSlewed_pu *
@@ -801,31 +1991,42 @@ static inline void CLLC_runISR2_secToPrimPowerFlow(void)
     //
     // Only issue ISR1 if there is a change in the PWM
     //
-    if((CLLC_pwmFrequencyPrev_Hz != CLLC_pwmFrequency_Hz) ||
-       (CLLC_pwmPhaseShiftPrimSec_ns != CLLC_pwmPhaseShiftPrimSecRef_ns) ||
-       (CLLC_pwmDutyPrim_pu != CLLC_pwmDutyPrimRef_pu) ||
-       (CLLC_pwmDutySec_pu != CLLC_pwmDutySecRef_pu))
-    {
+    pwmUpdate = (CLLC_pwmFrequencyPrev_Hz != CLLC_pwmFrequency_Hz);
+#if CLLC_PWM_UPDATE_MODE == CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD
+    pwmUpdate |= CLLC_pwmUpdateDeferred;
+#endif
 
-        CLLC_pwmDutyPrim_pu = CLLC_pwmDutyPrimRef_pu;
-        CLLC_pwmDutySec_pu = CLLC_pwmDutySecRef_pu;
-        CLLC_pwmPhaseShiftPrimSec_ns = CLLC_pwmPhaseShiftPrimSecRef_ns;
+    if(CLLC_takePWMDutyPhaseShiftFactors())
+    {
+        pwmUpdate = 1;
+    }
 
+    if(pwmUpdate)
+    {
         CLLC_calculatePWMDutyPeriodPhaseShiftTicks_secToPrimPowerFlow();
 
-        CLLC_HAL_setupISR1Trigger(CLLC_pwmFrequencyPrev_Hz);
+#if CLLC_PWM_UPDATE_MODE == CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD
+        CLLC_updatePWMFromISR2();
 
         CLLC_pwmFrequencyPrev_Hz = CLLC_pwmFrequency_Hz;
+#else
+        //
+        // ISR1 fires at the end of the present period, which still runs at
+        // the previous frequency, whose trigger was worked out at the last
+        // update. A trigger still set is one ISR1 has not taken yet, it
+        // moves and that update goes out with this one.
+        //
+        if(CLLC_HAL_isISR1TriggerPending())
+        {
+            CLLC_STATS_COUNT(isr1Retriggers);
+        }
+        CLLC_HAL_setISR1TriggerTicks(CLLC_pwmISRTrig_ticks);
 
-        #if CLLC_ISR1_RUNNING_ON == CLA_CORE
-              CLLC_pwmISRTrig_ticks =
-                     ((TICKS_IN_PWM_FREQUENCY(CLLC_pwmFrequency_Hz,
-                                          CLLC_PWMSYSCLOCK_FREQ_HZ)>> 1) - 20);
-        #else
-              CLLC_pwmISRTrig_ticks =
-                     ((TICKS_IN_PWM_FREQUENCY(CLLC_pwmFrequency_Hz,
-                                          CLLC_PWMSYSCLOCK_FREQ_HZ)>> 1) - 27);
-        #endif
+        CLLC_pwmFrequencyPrev_Hz = CLLC_pwmFrequency_Hz;
+
+        CLLC_pwmISRTrig_ticks =
+                CLLC_HAL_getISR1TriggerTicks(CLLC_pwmFrequency_Hz);
+#endif
 
     }
 }
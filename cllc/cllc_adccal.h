@@ -0,0 +1,163 @@
+//#############################################################################
+//
+// FILE:   cllc_adccal.h
+//
+// TITLE:  Offset and gain calibration of the ADC readings
+//         The sense chain of a signal maps its code to per unit as
+//             pu = ((code * scale - offset) * chainGain) * slope + intercept
+//         which is one gain and one zero code:
+//             pu = (code - zero) * scale * chainGain * slope
+//             zero = offset / scale - intercept / (scale * chainGain * slope)
+//         The zero goes into the reference offset of an ADC post processing
+//         block (PPB), which subtracts it from the result as it converts, so
+//         the reading is the PPB result times the gain. Readings that add up
+//         several conversions subtract the zero of the sum in software
+//         instead, kept to a fraction of a code.
+//
+//         The self calibration takes the mean code of a signal known to be
+//         zero, the currents with the bridges off, for its zero. That zero
+//         replaces both the offset and the intercept.
+//
+//#############################################################################
+
+#ifndef CLLC_ADCCAL_H
+#define CLLC_ADCCAL_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "cllc_settings.h"
+
+//
+// Defines
+//
+#define CLLC_ADCCAL_MAX_CODE    4095    // 12 bit results, the PPB offset too
+
+//
+// typedefs
+//
+typedef struct
+{
+    float32_t gain_pu;          // per unit per code of the reading
+    int32_t zeroSum;            // zero of the sum of the conversions
+    uint16_t zero;              // zero code, the PPB reference offset
+    uint16_t conversions;       // conversions added up per reading
+} CLLC_ADCCAL_Channel;
+
+typedef struct
+{
+    uint32_t sum;
+    uint16_t samples;
+    uint16_t samplesToTake;
+} CLLC_ADCCAL_SelfCal;
+
+//
+// Inline functions
+//
+
+//
+// The zero of a channel, in codes of one conversion
+//
+static inline void CLLC_ADCCAL_setZero(CLLC_ADCCAL_Channel *ch,
+                                       float32_t zero_codes)
+{
+    float32_t zeroSum = zero_codes * (float32_t)ch->conversions;
+
+    ch->zeroSum = (int32_t)((zeroSum < 0.0f) ? (zeroSum - 0.5f) :
+                                               (zeroSum + 0.5f));
+
+    if(zero_codes <= 0.0f)
+    {
+        ch->zero = 0;
+    }
+    else if(zero_codes >= (float32_t)CLLC_ADCCAL_MAX_CODE)
+    {
+        ch->zero = CLLC_ADCCAL_MAX_CODE;
+    }
+    else
+    {
+        ch->zero = (uint16_t)(zero_codes + 0.5f);
+    }
+}
+
+//
+// Gain and zero of a channel from its sense chain, see the top of the file
+//
+static inline void CLLC_ADCCAL_config(CLLC_ADCCAL_Channel *ch,
+                                      float32_t scale_pu,
+                                      float32_t chainGain,
+                                      float32_t offset_pu,
+                                      float32_t slope,
+                                      float32_t intercept_pu,
+                                      uint16_t conversions)
+{
+    float32_t gain_pu = scale_pu * chainGain * slope;
+    float32_t zero_codes = offset_pu / scale_pu;
+
+    if(gain_pu != 0.0f)
+    {
+        zero_codes -= intercept_pu / gain_pu;
+    }
+
+    ch->conversions = (conversions == 0U) ? 1U : conversions;
+    ch->gain_pu = gain_pu / (float32_t)ch->conversions;
+    CLLC_ADCCAL_setZero(ch, zero_codes);
+}
+
+//
+// A reading of the sum of the conversions, zero subtracted in software
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_ADCCAL_readSum)
+static inline float32_t CLLC_ADCCAL_readSum(const CLLC_ADCCAL_Channel *ch,
+                                            uint32_t sum)
+{
+    return((float32_t)((int32_t)sum - ch->zeroSum) * ch->gain_pu);
+}
+
+static inline void CLLC_ADCCAL_startSelfCal(CLLC_ADCCAL_SelfCal *cal,
+                                            uint16_t samples)
+{
+    cal->sum = 0;
+    cal->samples = 0;
+    cal->samplesToTake = (samples == 0U) ? 1U : samples;
+}
+
+//
+// Adds a code of the signal at zero, returns 1 once all are taken
+//
+static inline uint16_t CLLC_ADCCAL_addSelfCalSample(CLLC_ADCCAL_SelfCal *cal,
+                                                    uint16_t code)
+{
+    if(cal->samples < cal->samplesToTake)
+    {
+        cal->sum += code;
+        cal->samples++;
+    }
+
+    return((cal->samples >= cal->samplesToTake) ? 1U : 0U);
+}
+
+//
+// Mean of the codes taken, the zero of the channel
+//
+static inline float32_t CLLC_ADCCAL_getSelfCalZero(
+        const CLLC_ADCCAL_SelfCal *cal)
+{
+    if(cal->samples == 0U)
+    {
+        return(0.0f);
+    }
+
+    return((float32_t)cal->sum / (float32_t)cal->samples);
+}
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
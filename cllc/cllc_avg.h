@@ -0,0 +1,87 @@
+//#############################################################################
+//
+// FILE:   cllc_avg.h
+//
+// TITLE:  Bank of the exponential moving averages of the sensed signals
+//         ISR3 averages each sensed signal and scales the average to volts
+//         or amps. The bank holds each part of the state of all channels in
+//         one array, the averages, the multipliers and the scales, and one
+//         loop runs the average of EMAVG_run,
+//         out = ((in - out) * multiplier) + out, and the scaled value over
+//         all of them. The channels do not depend on each other, so the
+//         compiler fills the delay slots of the FPU on one channel with the
+//         loads of the next and gcc vectorizes the loop on the host.
+//
+//         The inputs and values are arrays of the caller, not of the bank.
+//         Inlined into ISR3 they stay in registers, a value goes straight
+//         to its global and an input is not stored just ahead of the loop
+//         that loads it again.
+//
+//         The channels are CLLC_AVG_ISEC..CLLC_AVG_VPRIM in cllc_settings.h,
+//         host/cllc_avg_bench.c checks the bank against EMAVG_run and times
+//         both.
+//
+//#############################################################################
+
+#ifndef CLLC_AVG_H
+#define CLLC_AVG_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "cllc_settings.h"
+
+//
+// typedefs
+//
+typedef struct
+{
+    float32_t out[CLLC_AVG_CHANNELS];
+    float32_t multiplier[CLLC_AVG_CHANNELS];
+    float32_t scale[CLLC_AVG_CHANNELS];
+} CLLC_AVG_Bank;
+
+//
+// Inline functions
+//
+
+//
+// Sets the multiplier of one channel and the scale of its average to
+// volts or amps and clears its average
+//
+static inline void CLLC_AVG_config(CLLC_AVG_Bank *bank, uint16_t channel,
+                                   float32_t multiplier, float32_t scale)
+{
+    bank->out[channel] = 0;
+    bank->multiplier[channel] = multiplier;
+    bank->scale[channel] = scale;
+}
+
+//
+// Averages the inputs of all channels and scales the averages to value
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_AVG_run)
+static inline void CLLC_AVG_run(CLLC_AVG_Bank *bank, const float32_t *in,
+                                float32_t *value)
+{
+    float32_t out;
+    uint16_t j;
+
+    for(j = 0; j < CLLC_AVG_CHANNELS; j++)
+    {
+        out = ((in[j] - bank->out[j]) * bank->multiplier[j]) + bank->out[j];
+        bank->out[j] = out;
+        value[j] = out * bank->scale[j];
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
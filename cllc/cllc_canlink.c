@@ -0,0 +1,374 @@
+//#############################################################################
+//
+// FILE:   cllc_canlink.c
+//
+// TITLE:  CAN-FD service on the MCAN, see cllc_canlink.h
+//
+//#############################################################################
+
+//*****************************************************************************
+// the includes
+//*****************************************************************************
+
+#include "cllc_settings.h"
+#include "cllc_canlink.h"
+
+//
+// Data length codes of the CAN-FD payload sizes
+//
+static const uint16_t CLLC_CANLINK_dlcBytes[16] = {0, 1, 2, 3, 4, 5, 6, 7,
+                                                   8, 12, 16, 20, 24, 32, 48,
+                                                   64};
+
+//
+// The smallest code that holds the bytes
+//
+uint16_t CLLC_CANLINK_getDLC(uint16_t bytes)
+{
+    uint16_t dlc = 0;
+
+    while((dlc < 15U) && (CLLC_CANLINK_dlcBytes[dlc] < bytes))
+    {
+        dlc++;
+    }
+    return(dlc);
+}
+
+uint16_t CLLC_CANLINK_getBytes(uint16_t dlc)
+{
+    return(CLLC_CANLINK_dlcBytes[dlc & 0xFU]);
+}
+
+//
+// The periods are laid out over their common period, the shortest first,
+// each at the first offset that keeps the busiest tick it lands in least
+// busy. Returns 0 when a period is 0 or the common period does not fit
+// into CLLC_CANLINK_SLOTS_MAX.
+//
+uint16_t CLLC_CANLINK_buildSchedule(CLLC_CANLINK_Schedule *schedule,
+                                    const uint16_t *period_ticks,
+                                    uint16_t count)
+{
+    uint16_t order[16];
+    uint16_t load[CLLC_CANLINK_SLOTS_MAX];
+    uint32_t length = 1;
+    uint32_t a;
+    uint32_t b;
+    uint16_t i;
+    uint16_t j;
+    uint16_t k;
+    uint16_t offset;
+    uint16_t bestOffset;
+    uint16_t peak;
+    uint16_t bestPeak;
+    uint16_t period;
+
+    if(count > 16U)
+    {
+        return(0);
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        if(period_ticks[i] == 0U)
+        {
+            return(0);
+        }
+
+        //
+        // least common multiple
+        //
+        a = length;
+        b = period_ticks[i];
+        while(b != 0U)
+        {
+            k = (uint16_t)(a % b);
+            a = b;
+            b = k;
+        }
+        length = (length / a) * period_ticks[i];
+        if(length > CLLC_CANLINK_SLOTS_MAX)
+        {
+            return(0);
+        }
+
+        //
+        // insertion by period
+        //
+        for(j = i; (j > 0U) && (period_ticks[order[j - 1U]] > period_ticks[i]);
+            j--)
+        {
+            order[j] = order[j - 1U];
+        }
+        order[j] = i;
+    }
+
+    schedule->length = (uint16_t)length;
+    schedule->index = 0;
+    for(k = 0; k < schedule->length; k++)
+    {
+        schedule->slot[k] = 0;
+        load[k] = 0;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        period = period_ticks[order[i]];
+        bestOffset = 0;
+        bestPeak = 0xFFFFU;
+        for(offset = 0; offset < period; offset++)
+        {
+            peak = 0;
+            for(k = offset; k < schedule->length; k += period)
+            {
+                if(load[k] > peak)
+                {
+                    peak = load[k];
+                }
+            }
+            if(peak < bestPeak)
+            {
+                bestPeak = peak;
+                bestOffset = offset;
+            }
+        }
+
+        for(k = bestOffset; k < schedule->length; k += period)
+        {
+            schedule->slot[k] |= (uint16_t)(1U << order[i]);
+            load[k]++;
+        }
+    }
+
+    return(1);
+}
+
+//
+// The headers of the reports are worked out here, once. The receive side
+// takes setpoints only with every value within its limits, a NaN is never
+// within them. Returns 0 when the periods do not make a schedule.
+//
+uint16_t CLLC_CANLINK_config(CLLC_CANLINK_Link *link, uint32_t base,
+                             uint16_t baseId, const uint16_t *period_ticks,
+                             const CLLC_CANLINK_Setpoint *setpointMin,
+                             const CLLC_CANLINK_Setpoint *setpointMax)
+{
+    static const uint16_t id[CLLC_CANLINK_REPORTS] =
+            {CLLC_CANLINK_ID_STATUS, CLLC_CANLINK_ID_MEASUREMENTS,
+             CLLC_CANLINK_ID_LOOP};
+    static const uint16_t bytes[CLLC_CANLINK_REPORTS] =
+            {CLLC_CANLINK_STATUS_BYTES, CLLC_CANLINK_MEASUREMENTS_BYTES,
+             CLLC_CANLINK_LOOP_BYTES};
+    uint16_t i;
+
+    link->base = base;
+    link->baseId = baseId;
+    for(i = 0; i < CLLC_CANLINK_REPORTS; i++)
+    {
+        link->header[i][0] = (uint32_t)(baseId + id[i]) <<
+                             CLLC_CANLINK_STD_ID_SHIFT;
+        link->header[i][1] = ((uint32_t)CLLC_CANLINK_getDLC(bytes[i]) <<
+                              CLLC_CANLINK_DLC_SHIFT) |
+                             CLLC_CANLINK_FDF | CLLC_CANLINK_BRS;
+    }
+    link->setpointMin = *setpointMin;
+    link->setpointMax = *setpointMax;
+    link->txFrames = 0;
+    link->txSkipped = 0;
+    link->rxFrames = 0;
+    link->rxRejected = 0;
+    link->rxLost = 0;
+
+    return(CLLC_CANLINK_buildSchedule(&link->schedule, period_ticks,
+                                      CLLC_CANLINK_REPORTS));
+}
+
+//
+// One report into its transmit buffer
+//
+static void CLLC_CANLINK_writeReport(CLLC_CANLINK_Link *link, uint16_t report,
+                                     const CLLC_CANLINK_Report *r)
+{
+    uint32_t element = CLLC_CANLINK_getTxElement(link->base, report);
+
+    HWREG(element) = link->header[report][0];
+    HWREG(element + 4U) = link->header[report][1];
+
+    switch(report)
+    {
+        case CLLC_CANLINK_REPORT_STATUS:
+            CLLC_CANLINK_putWord(element, 0,
+                    ((uint32_t)r->tripFlag & 0xFFU) |
+                    (((uint32_t)r->powerFlowState & 0xFFU) << 8) |
+                    ((r->closeGvLoop != 0U) ? 0x10000UL : 0UL) |
+                    ((r->closeGiLoop != 0U) ? 0x20000UL : 0UL));
+            CLLC_CANLINK_putWord(element, 1,
+                    (link->rxFrames & 0xFFFFU) |
+                    ((link->rxRejected & 0xFFFFU) << 16));
+            break;
+
+        case CLLC_CANLINK_REPORT_MEASUREMENTS:
+            CLLC_CANLINK_putValue(element, 0, r->vPrimSensed_Volts);
+            CLLC_CANLINK_putValue(element, 1, r->vSecSensed_Volts);
+            CLLC_CANLINK_putValue(element, 2, r->iPrimSensed_Amps);
+            CLLC_CANLINK_putValue(element, 3, r->iSecSensed_Amps);
+            break;
+
+        default:
+            CLLC_CANLINK_putValue(element, 0, r->vSecRef_Volts);
+            CLLC_CANLINK_putValue(element, 1, r->iSecRef_Amps);
+            CLLC_CANLINK_putValue(element, 2, r->pwmFrequency_Hz);
+            CLLC_CANLINK_putValue(element, 3, r->gvOut);
+            CLLC_CANLINK_putValue(element, 4, r->giOut);
+            break;
+    }
+}
+
+//
+// One receive FIFO element. Returns the CLLC_CANLINK_TAKEN_ bit of the
+// command taken, 0 when it was rejected.
+//
+static uint16_t CLLC_CANLINK_readCommand(CLLC_CANLINK_Link *link,
+                                         uint32_t element,
+                                         CLLC_CANLINK_Command *command)
+{
+    CLLC_CANLINK_Setpoint s;
+    uint32_t r0 = HWREG(element);
+    uint16_t bytes = CLLC_CANLINK_getBytes((uint16_t)(HWREG(element + 4U) >>
+                                           CLLC_CANLINK_DLC_SHIFT));
+    uint16_t id = (uint16_t)((r0 >> CLLC_CANLINK_STD_ID_SHIFT) & 0x7FFU);
+
+    if((r0 & CLLC_CANLINK_XTD) != 0U)
+    {
+        return(0);
+    }
+
+    if((id == (link->baseId + CLLC_CANLINK_ID_SETPOINT)) &&
+       (bytes == CLLC_CANLINK_SETPOINT_BYTES))
+    {
+        s.vSecRef_Volts = CLLC_CANLINK_getValue(element, 0);
+        s.iSecRef_Amps = CLLC_CANLINK_getValue(element, 1);
+        s.pwmFrequencyRef_Hz = CLLC_CANLINK_getValue(element, 2);
+
+        if((s.vSecRef_Volts >= link->setpointMin.vSecRef_Volts) &&
+           (s.vSecRef_Volts <= link->setpointMax.vSecRef_Volts) &&
+           (s.iSecRef_Amps >= link->setpointMin.iSecRef_Amps) &&
+           (s.iSecRef_Amps <= link->setpointMax.iSecRef_Amps) &&
+           (s.pwmFrequencyRef_Hz >= link->setpointMin.pwmFrequencyRef_Hz) &&
+           (s.pwmFrequencyRef_Hz <= link->setpointMax.pwmFrequencyRef_Hz))
+        {
+            command->setpoint = s;
+            return(CLLC_CANLINK_TAKEN_SETPOINT);
+        }
+    }
+    else if((id == (link->baseId + CLLC_CANLINK_ID_ENABLE)) &&
+            (bytes == CLLC_CANLINK_ENABLE_BYTES))
+    {
+        command->enable = (uint16_t)(CLLC_CANLINK_getWord(element, 0) &
+                                     (CLLC_CANLINK_ENABLE_GV_LOOP |
+                                      CLLC_CANLINK_ENABLE_GI_LOOP |
+                                      CLLC_CANLINK_ENABLE_CLEAR_TRIP));
+        return(CLLC_CANLINK_TAKEN_ENABLE);
+    }
+
+    return(0);
+}
+
+//
+// One tick of the service: the reports due go into their buffers and are
+// requested with one write, then up to CLLC_CANLINK_RX_PER_RUN commands are
+// taken from the FIFO. Returns the CLLC_CANLINK_TAKEN_ bits, the last
+// command of each kind in command.
+//
+uint16_t CLLC_CANLINK_run(CLLC_CANLINK_Link *link,
+                          const CLLC_CANLINK_Report *report,
+                          CLLC_CANLINK_Command *command)
+{
+    uint16_t due;
+    uint16_t request = 0;
+    uint16_t taken = 0;
+    uint16_t result;
+    uint16_t i;
+    uint32_t pending;
+    uint32_t status;
+    uint16_t fill;
+    uint16_t get;
+
+    due = link->schedule.slot[link->schedule.index];
+    link->schedule.index++;
+    if(link->schedule.index == link->schedule.length)
+    {
+        link->schedule.index = 0;
+    }
+
+    if(due != 0U)
+    {
+        pending = HWREG(link->base + MCAN_TXBRP);
+        for(i = 0; i < CLLC_CANLINK_REPORTS; i++)
+        {
+            if((due & (1U << i)) == 0U)
+            {
+                continue;
+            }
+            if((pending & (1UL << i)) != 0U)
+            {
+                link->txSkipped++;
+                continue;
+            }
+            CLLC_CANLINK_writeReport(link, i, report);
+            request |= (uint16_t)(1U << i);
+            link->txFrames++;
+        }
+        if(request != 0U)
+        {
+            HWREG(link->base + MCAN_TXBAR) = request;
+        }
+    }
+
+    status = HWREG(link->base + MCAN_RXF0S);
+    if((status & MCAN_RXF0S_RF0L_MASK) != 0U)
+    {
+        link->rxLost++;
+        HWREG(link->base + MCAN_IR) = MCAN_IR_RF0L_MASK;
+    }
+
+    fill = (uint16_t)((status & MCAN_RXF0S_F0FL_MASK) >>
+                      MCAN_RXF0S_F0FL_SHIFT);
+    get = (uint16_t)((status & MCAN_RXF0S_F0GI_MASK) >>
+                     MCAN_RXF0S_F0GI_SHIFT);
+    if(fill > CLLC_CANLINK_RX_PER_RUN)
+    {
+        fill = CLLC_CANLINK_RX_PER_RUN;
+    }
+
+    for(i = 0; i < fill; i++)
+    {
+        result = CLLC_CANLINK_readCommand(link,
+                     CLLC_CANLINK_getRxElement(link->base, get), command);
+        if(result != 0U)
+        {
+            taken |= result;
+            link->rxFrames++;
+        }
+        else
+        {
+            link->rxRejected++;
+        }
+
+        //
+        // acknowledging an element frees it and every one before it, the
+        // last one is acknowledged below
+        //
+        if(i == (fill - 1U))
+        {
+            HWREG(link->base + MCAN_RXF0A) = get;
+        }
+        get++;
+        if(get == CLLC_CANLINK_RX_FIFO_SIZE)
+        {
+            get = 0;
+        }
+    }
+
+    return(taken);
+}
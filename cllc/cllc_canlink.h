@@ -0,0 +1,240 @@
+//#############################################################################
+//
+// FILE:   cllc_canlink.h
+//
+// TITLE:  CAN-FD service on the MCAN, reports out and commands in
+//         Three reports go out at their own periods, each from its own
+//         dedicated transmit buffer, and two commands come in through receive
+//         FIFO 0. The identifiers are CLLC_CAN_BASE_ID plus:
+//
+//         0x0 status        8 bytes   trip, power flow, loop flags, counts
+//         0x1 measurements  16 bytes  vPrim, vSec, iPrim, iSec, volts/amps
+//         0x2 loop          20 bytes  vSecRef, iSecRef, pwmFrequency, gv, gi
+//         0x8 setpoint      12 bytes  vSecRef_Volts, iSecRef_Amps,
+//                                     pwmFrequencyRef_Hz
+//         0x9 enable        4 bytes   CLLC_CANLINK_ENABLE_ bits
+//
+//         Values are float32, little endian like the MCAN payload words.
+//
+//         The reports are written straight into their buffers in the message
+//         RAM, one 32 bit store per payload word, no element is built and
+//         copied as MCAN_writeMsgRam does. The commands are read from the
+//         FIFO element in place. The periods are in ticks of the service,
+//         CLLC_CANLINK_run, and are laid out once into a table over their
+//         common period that says which reports are due in each tick; the
+//         offsets spread the reports over the ticks. A report whose buffer
+//         is still pending is skipped and counted, not overwritten.
+//
+//         The message RAM and registers are taken through HWREG at the
+//         byte offsets of hw_mcanss.h from the MCAN base, as mcan.c does, so
+//         the host build runs the service against host/cllc_mcan_stub.h.
+//         The bit timing and message RAM configuration are in cllc_hal.c.
+//
+//#############################################################################
+
+#ifndef CLLC_CANLINK_H
+#define CLLC_CANLINK_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "inc/hw_types.h"
+#include "inc/hw_mcanss.h"
+#include "cllc_settings.h"
+
+//
+// Defines
+//
+#define CLLC_CANLINK_REPORTS            3U
+#define CLLC_CANLINK_REPORT_STATUS      0U      // also the transmit buffer
+#define CLLC_CANLINK_REPORT_MEASUREMENTS 1U
+#define CLLC_CANLINK_REPORT_LOOP        2U
+
+#define CLLC_CANLINK_ID_STATUS          0x0U
+#define CLLC_CANLINK_ID_MEASUREMENTS    0x1U
+#define CLLC_CANLINK_ID_LOOP            0x2U
+#define CLLC_CANLINK_ID_SETPOINT        0x8U
+#define CLLC_CANLINK_ID_ENABLE          0x9U
+
+#define CLLC_CANLINK_STATUS_BYTES       8U
+#define CLLC_CANLINK_MEASUREMENTS_BYTES 16U
+#define CLLC_CANLINK_LOOP_BYTES         20U
+#define CLLC_CANLINK_SETPOINT_BYTES     12U
+#define CLLC_CANLINK_ENABLE_BYTES       4U
+
+#define CLLC_CANLINK_ENABLE_GV_LOOP     0x1U    // closes the voltage loop
+#define CLLC_CANLINK_ENABLE_GI_LOOP     0x2U    // closes the current loop
+#define CLLC_CANLINK_ENABLE_CLEAR_TRIP  0x4U    // one clear per command
+
+#define CLLC_CANLINK_TAKEN_SETPOINT     0x1U
+#define CLLC_CANLINK_TAKEN_ENABLE       0x2U
+
+//
+// Message RAM, byte offsets: one standard filter, the transmit buffers and
+// receive FIFO 0, all elements with 64 data bytes
+//
+#define CLLC_CANLINK_RAM_FILTER         0x000U
+#define CLLC_CANLINK_RAM_TX_BUFFERS     0x010U
+#define CLLC_CANLINK_RAM_RX_FIFO        0x100U
+#define CLLC_CANLINK_RAM_ELEMENT_BYTES  72U
+#define CLLC_CANLINK_RX_FIFO_SIZE       8U
+
+//
+// Receive FIFO elements taken per run at most
+//
+#define CLLC_CANLINK_RX_PER_RUN         4U
+
+#define CLLC_CANLINK_SLOTS_MAX          200U
+
+//
+// element header, the standard identifier sits in bits 28:18 of word 0
+//
+#define CLLC_CANLINK_STD_ID_SHIFT       18U
+#define CLLC_CANLINK_XTD                0x40000000UL
+#define CLLC_CANLINK_DLC_SHIFT          16U
+#define CLLC_CANLINK_BRS                0x00100000UL
+#define CLLC_CANLINK_FDF                0x00200000UL
+
+//
+// typedefs
+//
+typedef struct
+{
+    uint16_t tripFlag;
+    uint16_t powerFlowState;
+    uint16_t closeGvLoop;
+    uint16_t closeGiLoop;
+    float32_t vPrimSensed_Volts;
+    float32_t vSecSensed_Volts;
+    float32_t iPrimSensed_Amps;
+    float32_t iSecSensed_Amps;
+    float32_t vSecRef_Volts;
+    float32_t iSecRef_Amps;
+    float32_t pwmFrequency_Hz;
+    float32_t gvOut;
+    float32_t giOut;
+} CLLC_CANLINK_Report;
+
+typedef struct
+{
+    float32_t vSecRef_Volts;
+    float32_t iSecRef_Amps;
+    float32_t pwmFrequencyRef_Hz;
+} CLLC_CANLINK_Setpoint;
+
+typedef struct
+{
+    CLLC_CANLINK_Setpoint setpoint;
+    uint16_t enable;            // CLLC_CANLINK_ENABLE_ bits
+} CLLC_CANLINK_Command;
+
+typedef struct
+{
+    uint16_t slot[CLLC_CANLINK_SLOTS_MAX];  // reports due, one bit each
+    uint16_t length;
+    uint16_t index;
+} CLLC_CANLINK_Schedule;
+
+typedef struct
+{
+    uint32_t base;              // MCAN driver base
+    uint16_t baseId;
+    uint32_t header[CLLC_CANLINK_REPORTS][2];
+    CLLC_CANLINK_Schedule schedule;
+    CLLC_CANLINK_Setpoint setpointMin;
+    CLLC_CANLINK_Setpoint setpointMax;
+    uint32_t txFrames;
+    uint32_t txSkipped;         // the buffer was still pending
+    uint32_t rxFrames;          // commands taken
+    uint32_t rxRejected;        // identifier, length or values wrong
+    uint32_t rxLost;            // times the FIFO was full
+} CLLC_CANLINK_Link;
+
+//
+// the function prototypes
+//
+uint16_t CLLC_CANLINK_buildSchedule(CLLC_CANLINK_Schedule *schedule,
+                                    const uint16_t *period_ticks,
+                                    uint16_t count);
+uint16_t CLLC_CANLINK_config(CLLC_CANLINK_Link *link, uint32_t base,
+                             uint16_t baseId, const uint16_t *period_ticks,
+                             const CLLC_CANLINK_Setpoint *setpointMin,
+                             const CLLC_CANLINK_Setpoint *setpointMax);
+uint16_t CLLC_CANLINK_run(CLLC_CANLINK_Link *link,
+                          const CLLC_CANLINK_Report *report,
+                          CLLC_CANLINK_Command *command);
+uint16_t CLLC_CANLINK_getDLC(uint16_t bytes);
+uint16_t CLLC_CANLINK_getBytes(uint16_t dlc);
+
+//
+// Message RAM address of a transmit buffer and of a receive FIFO element
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_CANLINK_getTxElement)
+static inline uint32_t CLLC_CANLINK_getTxElement(uint32_t base,
+                                                 uint16_t buffer)
+{
+    return(base + MCAN_MCAN_MSG_MEM + CLLC_CANLINK_RAM_TX_BUFFERS +
+           ((uint32_t)buffer * CLLC_CANLINK_RAM_ELEMENT_BYTES));
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_CANLINK_getRxElement)
+static inline uint32_t CLLC_CANLINK_getRxElement(uint32_t base,
+                                                 uint16_t index)
+{
+    return(base + MCAN_MCAN_MSG_MEM + CLLC_CANLINK_RAM_RX_FIFO +
+           ((uint32_t)index * CLLC_CANLINK_RAM_ELEMENT_BYTES));
+}
+
+//
+// Payload word k of an element, after the two header words
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_CANLINK_putWord)
+static inline void CLLC_CANLINK_putWord(uint32_t element, uint16_t k,
+                                        uint32_t value)
+{
+    HWREG(element + 8U + ((uint32_t)k << 2)) = value;
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_CANLINK_getWord)
+static inline uint32_t CLLC_CANLINK_getWord(uint32_t element, uint16_t k)
+{
+    return(HWREG(element + 8U + ((uint32_t)k << 2)));
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_CANLINK_putValue)
+static inline void CLLC_CANLINK_putValue(uint32_t element, uint16_t k,
+                                         float32_t value)
+{
+    union
+    {
+        float32_t value;
+        uint32_t bits;
+    } v;
+
+    v.value = value;
+    CLLC_CANLINK_putWord(element, k, v.bits);
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_CANLINK_getValue)
+static inline float32_t CLLC_CANLINK_getValue(uint32_t element, uint16_t k)
+{
+    union
+    {
+        float32_t value;
+        uint32_t bits;
+    } v;
+
+    v.bits = CLLC_CANLINK_getWord(element, k);
+    return(v.value);
+}
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
@@ -0,0 +1,286 @@
+//#############################################################################
+//
+// FILE:   cllc_datalog.c
+//
+// TITLE:  Data logger configuration and the background side of the ring,
+//         see cllc_datalog.h
+//
+//#############################################################################
+
+//*****************************************************************************
+// the includes
+//*****************************************************************************
+
+#include "cllc_settings.h"
+#include "cllc_datalog.h"
+
+//
+// Before the logging ISR is enabled. ringSize is a power of 2 up to 32768,
+// the pre-trigger history is kept below it so the capture can go on after
+// the trigger. The logger is idle until CLLC_DATALOG_arm.
+//
+void CLLC_DATALOG_config(CLLC_DATALOG_Log *log,
+                         volatile CLLC_DATALOG_Record *ring, uint16_t ringSize,
+                         uint16_t preTrigger, uint16_t postTrigger)
+{
+    uint16_t i;
+
+    log->channels = 0;
+    log->decimated = 0;
+    for(i = 0; i < CLLC_DATALOG_CHANNELS_MAX; i++)
+    {
+        log->input[i] = 0;
+        log->decimation[i] = 1;
+        log->skipCount[i] = 0;
+    }
+
+    log->ring = ring;
+    log->ringMask = ringSize - 1U;
+    log->preTrigger = (preTrigger < ringSize) ? preTrigger : log->ringMask;
+    log->postTrigger = postTrigger;
+
+    log->triggerSources = CLLC_DATALOG_TRIGGER_SOFTWARE;
+    log->triggerChannel = 0;
+    log->triggerInput = 0;
+    log->triggerLevel = 0;
+    log->triggerPrevious = 0;
+
+    log->state = CLLC_DATALOG_IDLE;
+    log->writeIndex = 0;
+    log->captureStart = 0;
+    log->captureCount = 0;
+    log->triggerTick = 0;
+    log->overrunCount = 0;
+    log->tick = 0;
+    log->budget = 0;
+    log->armIndex = 0;
+    log->postLeft = 0;
+    log->armCount = 0;
+    log->softwareCount = 0;
+
+    log->readIndex = 0;
+    log->readCapture = 0;
+    log->armRequest = 0;
+    log->softwareRequest = 0;
+}
+
+//
+// Channels are added in order, the channel count is the highest one set
+//
+void CLLC_DATALOG_setChannel(CLLC_DATALOG_Log *log, uint16_t channel,
+                             const float32_t *input, uint16_t decimation)
+{
+    if(channel >= CLLC_DATALOG_CHANNELS_MAX)
+    {
+        return;
+    }
+
+    log->input[channel] = input;
+    log->decimation[channel] = (decimation > 1U) ? decimation : 1U;
+    log->skipCount[channel] = 0;
+    if(decimation > 1U)
+    {
+        log->decimated = 1;
+    }
+
+    if(channel >= log->channels)
+    {
+        log->channels = channel + 1U;
+    }
+}
+
+//
+// sources is an OR of CLLC_DATALOG_TRIGGER_*, the level applies to the
+// given channel, which has to be set before the logger is armed
+//
+void CLLC_DATALOG_setTrigger(CLLC_DATALOG_Log *log, uint16_t sources,
+                             uint16_t channel, float32_t level)
+{
+    log->triggerSources = sources;
+    log->triggerChannel = channel;
+    log->triggerLevel = level;
+}
+
+//
+// The ISR drops what is left of the capture and waits for the trigger on
+// its next run
+//
+void CLLC_DATALOG_arm(CLLC_DATALOG_Log *log)
+{
+    log->armRequest = log->armCount + 1U;
+}
+
+//
+// Fires the software trigger source on the next run of the armed logger
+//
+void CLLC_DATALOG_trigger(CLLC_DATALOG_Log *log)
+{
+    log->softwareRequest = log->softwareCount + 1U;
+}
+
+//
+// From the ISR when the background has asked for the arm. The trigger
+// channel is taken here so the run reads it directly. While armed the ring
+// holds no capture, the budget goes up to the end of the ring, and each
+// time it is set again the history start is brought up to preTrigger
+// records back so it is never more than a 16 bit index apart.
+//
+void CLLC_DATALOG_takeArm(CLLC_DATALOG_Log *log)
+{
+    uint16_t i;
+
+    log->armCount = log->armRequest;
+    log->softwareCount = log->softwareRequest;
+    log->triggerInput = log->input[log->triggerChannel];
+    log->triggerPrevious = *log->triggerInput;
+    for(i = 0; i < log->channels; i++)
+    {
+        log->skipCount[i] = 0;
+    }
+    log->armIndex = log->writeIndex;
+    log->budget = (log->decimated == 0U) ?
+                  (log->ringMask + 1U - (log->writeIndex & log->ringMask)) :
+                  0U;
+    log->state = CLLC_DATALOG_ARMED;
+}
+
+//
+// From the ISR on the run the trigger fires, the capture starts up to
+// preTrigger records back and the run goes to CLLC_DATALOG_sample for the
+// budget of the capture
+//
+void CLLC_DATALOG_startCapture(CLLC_DATALOG_Log *log, uint16_t tick)
+{
+    uint16_t index = log->writeIndex;
+    uint16_t history = index - log->armIndex;
+
+    log->captureStart = index - ((history < log->preTrigger) ?
+                                 history : log->preTrigger);
+    log->triggerTick = tick;
+    log->postLeft = log->postTrigger;
+    log->budget = 0;
+    log->captureCount++;
+    log->state = CLLC_DATALOG_TRIGGERED;
+}
+
+//
+// From the ISR when the run is past the budget or a channel is decimated.
+// Writes the records of the channels due on this run, once triggered only
+// into the room the ring has left and no more than the capture has left,
+// the rest are counted and dropped. Until the background has taken up the
+// capture its read index is still that of the one before and the capture
+// start stands in.
+//
+void CLLC_DATALOG_sample(CLLC_DATALOG_Log *log, uint16_t tick)
+{
+    volatile CLLC_DATALOG_Record *record;
+    uint16_t state = log->state;
+    uint16_t index = log->writeIndex;
+    uint16_t left = 0xFFFFU;
+    uint16_t room = 0xFFFFU;
+    uint16_t taken = 0;
+    uint16_t written, budget, i;
+
+    if(state == CLLC_DATALOG_TRIGGERED)
+    {
+        left = log->postLeft + log->budget;
+        room = log->ringMask + 1U -
+               (uint16_t)(index - ((log->readCapture == log->captureCount) ?
+                                   log->readIndex : log->captureStart));
+    }
+    else if((uint16_t)(index - log->armIndex) > log->preTrigger)
+    {
+        log->armIndex = index - log->preTrigger;
+    }
+
+    for(i = 0; (i < log->channels) && (taken < left); i++)
+    {
+        if(log->skipCount[i] != 0U)
+        {
+            log->skipCount[i]--;
+            continue;
+        }
+        log->skipCount[i] = log->decimation[i] - 1U;
+
+        if(taken < room)
+        {
+            record = &log->ring[(uint16_t)(index + taken) & log->ringMask];
+            record->value = *log->input[i];
+            record->channel = i;
+            record->tick = tick;
+        }
+        taken++;
+    }
+
+    written = (taken < room) ? taken : room;
+    index += written;
+    log->writeIndex = index;
+
+    budget = (log->decimated == 0U) ?
+             (log->ringMask + 1U - (index & log->ringMask)) : 0U;
+    if(state == CLLC_DATALOG_TRIGGERED)
+    {
+        log->overrunCount += taken - written;
+        left -= taken;
+        room -= written;
+        budget = (room < budget) ? room : budget;
+        budget = (left < budget) ? left : budget;
+        log->postLeft = left - budget;
+        if(left == 0U)
+        {
+            log->state = CLLC_DATALOG_DONE;
+        }
+    }
+    log->budget = budget;
+}
+
+//
+// Takes up to maxRecords records of the capture in progress or done, in the
+// order they were written, and returns how many. None while armed.
+//
+uint16_t CLLC_DATALOG_read(CLLC_DATALOG_Log *log, CLLC_DATALOG_Record *record,
+                           uint16_t maxRecords)
+{
+    uint16_t state = log->state;
+    uint16_t index, available, i;
+
+    if((state != CLLC_DATALOG_TRIGGERED) && (state != CLLC_DATALOG_DONE))
+    {
+        return(0);
+    }
+
+    //
+    // a new capture, the ISR set its start before the state
+    //
+    if(log->readCapture != log->captureCount)
+    {
+        log->readIndex = log->captureStart;
+        log->readCapture = log->captureCount;
+    }
+
+    index = log->readIndex;
+    available = log->writeIndex - index;
+    if(available > maxRecords)
+    {
+        available = maxRecords;
+    }
+
+    for(i = 0; i < available; i++)
+    {
+        record[i] = log->ring[(uint16_t)(index + i) & log->ringMask];
+    }
+
+    log->readIndex = index + available;
+
+    return(available);
+}
+
+//
+// The capture is complete and the background has taken all of it
+//
+uint16_t CLLC_DATALOG_isDone(const CLLC_DATALOG_Log *log)
+{
+    return((log->state == CLLC_DATALOG_DONE) &&
+           (log->readCapture == log->captureCount) &&
+           (log->readIndex == log->writeIndex));
+}
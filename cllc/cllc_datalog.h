@@ -0,0 +1,230 @@
+//#############################################################################
+//
+// FILE:   cllc_datalog.h
+//
+// TITLE:  Data logger, N channels at their own decimation with pre-trigger
+//         history, taken over from DLOG_4CH
+//         The ISR logging the channels (CLLC_DATALOG_run) is the only writer
+//         of the ring and of the records in it, the background
+//         (CLLC_DATALOG_read) is the only reader. Each index and handshake
+//         count has one writer, so neither side disables interrupts and a
+//         16 bit store is all the ordering either side needs.
+//
+//         Every run the ISR samples the channels whose decimation is due and
+//         writes one record per sample into the ring. While armed the ring
+//         is a circular pre-trigger buffer the ISR overwrites, the
+//         background does not read it. The run on which any enabled trigger
+//         fires publishes where the capture starts, preTrigger records back,
+//         the background drains from there while the ISR adds the
+//         postTrigger records after it. A capture longer than the ring is
+//         streamed, records that find the ring full are counted and dropped.
+//         Then the logger waits until the background arms it again.
+//
+//         Per run the ISR does the trigger check while armed and then, with
+//         no channel decimated, only the stores of the records as long as
+//         the budget the ISR keeps of the room in the ring holds them. The
+//         arm, the start of the capture, the decimation counts and setting
+//         the budget again are out of line in cllc_datalog.c. No divide and
+//         no loop other than over the channels.
+//
+//#############################################################################
+
+#ifndef CLLC_DATALOG_H
+#define CLLC_DATALOG_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "cllc_settings.h"
+
+//
+// Defines
+//
+#define CLLC_DATALOG_CHANNELS_MAX       8U
+
+//
+// trigger sources, the capture starts on the first run any enabled one fires
+//
+#define CLLC_DATALOG_TRIGGER_SOFTWARE   0x1U    // CLLC_DATALOG_trigger
+#define CLLC_DATALOG_TRIGGER_EVENT      0x2U    // event of the run, a trip
+#define CLLC_DATALOG_TRIGGER_RISING     0x4U    // trigger channel up through
+                                                // the level
+#define CLLC_DATALOG_TRIGGER_FALLING    0x8U    // and down through it
+
+//
+// states, written by the ISR only
+//
+#define CLLC_DATALOG_IDLE               0U
+#define CLLC_DATALOG_ARMED              1U
+#define CLLC_DATALOG_TRIGGERED          2U
+#define CLLC_DATALOG_DONE               3U
+
+//
+// typedefs
+//
+typedef struct
+{
+    float32_t value;
+    uint16_t channel;
+    uint16_t tick;              // run count of the sample, low word
+} CLLC_DATALOG_Record;
+
+typedef struct
+{
+    const float32_t *input[CLLC_DATALOG_CHANNELS_MAX];
+    uint16_t decimation[CLLC_DATALOG_CHANNELS_MAX];     // one sample every
+                                                        // decimation runs
+    uint16_t skipCount[CLLC_DATALOG_CHANNELS_MAX];
+    uint16_t channels;
+    uint16_t decimated;         // 1 when a channel has a decimation above 1
+    volatile CLLC_DATALOG_Record *ring;
+    uint16_t ringMask;          // ring size - 1, the size a power of 2
+    uint16_t preTrigger;        // records kept ahead of the trigger
+    uint16_t postTrigger;       // records from the trigger on
+
+    uint16_t triggerSources;    // CLLC_DATALOG_TRIGGER_*
+    uint16_t triggerChannel;
+    const float32_t *triggerInput;  // of triggerChannel, taken on the arm
+    float32_t triggerLevel;
+    float32_t triggerPrevious;
+
+    //
+    // written by the ISR
+    //
+    volatile uint16_t state;
+    volatile uint16_t writeIndex;   // free running, masked into the ring
+    volatile uint16_t captureStart;
+    volatile uint16_t captureCount;
+    volatile uint16_t triggerTick;
+    volatile uint16_t overrunCount;
+    uint16_t tick;
+    uint16_t budget;            // records the run may write as they come
+    uint16_t armIndex;          // write index the history starts from
+    uint16_t postLeft;          // records of the capture not in the budget
+    uint16_t armCount;
+    uint16_t softwareCount;
+
+    //
+    // written by the background
+    //
+    volatile uint16_t readIndex;
+    volatile uint16_t readCapture;  // captureCount readIndex belongs to
+    volatile uint16_t armRequest;
+    volatile uint16_t softwareRequest;
+} CLLC_DATALOG_Log;
+
+//
+// the function prototypes
+//
+void CLLC_DATALOG_config(CLLC_DATALOG_Log *log,
+                         volatile CLLC_DATALOG_Record *ring, uint16_t ringSize,
+                         uint16_t preTrigger, uint16_t postTrigger);
+void CLLC_DATALOG_setChannel(CLLC_DATALOG_Log *log, uint16_t channel,
+                             const float32_t *input, uint16_t decimation);
+void CLLC_DATALOG_setTrigger(CLLC_DATALOG_Log *log, uint16_t sources,
+                             uint16_t channel, float32_t level);
+void CLLC_DATALOG_arm(CLLC_DATALOG_Log *log);
+void CLLC_DATALOG_trigger(CLLC_DATALOG_Log *log);
+uint16_t CLLC_DATALOG_read(CLLC_DATALOG_Log *log, CLLC_DATALOG_Record *record,
+                           uint16_t maxRecords);
+uint16_t CLLC_DATALOG_isDone(const CLLC_DATALOG_Log *log);
+
+//
+// out of line parts of CLLC_DATALOG_run
+//
+void CLLC_DATALOG_takeArm(CLLC_DATALOG_Log *log);
+void CLLC_DATALOG_startCapture(CLLC_DATALOG_Log *log, uint16_t tick);
+void CLLC_DATALOG_sample(CLLC_DATALOG_Log *log, uint16_t tick);
+
+//
+// Whether the trigger fires on this run, the level crossing compares
+// against the trigger channel of the previous run whatever its decimation.
+// The software request is taken up by the next arm.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_DATALOG_isTriggered)
+static inline uint16_t CLLC_DATALOG_isTriggered(CLLC_DATALOG_Log *log,
+                                                uint16_t event)
+{
+    uint16_t sources = log->triggerSources;
+    float32_t level = log->triggerLevel;
+    float32_t previous = log->triggerPrevious;
+    float32_t value = *log->triggerInput;
+
+    log->triggerPrevious = value;
+
+    return((((sources & CLLC_DATALOG_TRIGGER_EVENT) != 0U) &&
+            (event != 0U)) ||
+           (((sources & CLLC_DATALOG_TRIGGER_SOFTWARE) != 0U) &&
+            (log->softwareRequest != log->softwareCount)) ||
+           (((sources & CLLC_DATALOG_TRIGGER_RISING) != 0U) &&
+            (previous < level) && (value >= level)) ||
+           (((sources & CLLC_DATALOG_TRIGGER_FALLING) != 0U) &&
+            (previous > level) && (value <= level)));
+}
+
+//
+// Called once per run of the ISR, event is nonzero while the event trigger
+// source should fire, e.g. tripped.
+//
+// The run writes a record of every channel in a row as long as the budget
+// holds them, that is all the run does besides the trigger check while
+// armed. The budget is what was left of the room in the ring, of the
+// capture and up to the end of the ring when they were last looked at, the
+// room only grows as the background reads. Past the budget, and on every
+// run with a decimated channel, CLLC_DATALOG_sample takes the records and
+// sets the budget again.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_DATALOG_run)
+static inline void CLLC_DATALOG_run(CLLC_DATALOG_Log *log, uint16_t event)
+{
+    volatile CLLC_DATALOG_Record *record;
+    uint16_t tick, index, channels, i;
+    float32_t value;
+
+    if(log->armRequest != log->armCount)
+    {
+        CLLC_DATALOG_takeArm(log);
+    }
+
+    tick = log->tick;
+    log->tick = tick + 1U;
+
+    if((log->state == CLLC_DATALOG_ARMED) &&
+       (CLLC_DATALOG_isTriggered(log, event) != 0U))
+    {
+        CLLC_DATALOG_startCapture(log, tick);
+    }
+
+    channels = log->channels;
+    if(log->budget >= channels)
+    {
+        index = log->writeIndex;
+        record = &log->ring[index & log->ringMask];
+        for(i = 0; i < channels; i++)
+        {
+            value = *log->input[i];
+            record->value = value;
+            record->channel = i;
+            record->tick = tick;
+            record++;
+        }
+        log->writeIndex = index + channels;
+        log->budget -= channels;
+    }
+    else if((log->state == CLLC_DATALOG_ARMED) ||
+            (log->state == CLLC_DATALOG_TRIGGERED))
+    {
+        CLLC_DATALOG_sample(log, tick);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
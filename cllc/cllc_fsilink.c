@@ -0,0 +1,197 @@
+//#############################################################################
+//
+// FILE:   cllc_fsilink.c
+//
+// TITLE:  Framing of the FSI link, see cllc_fsilink.h
+//
+//#############################################################################
+
+//*****************************************************************************
+// the includes
+//*****************************************************************************
+
+#include "cllc_settings.h"
+#include "cllc_fsilink.h"
+
+void CLLC_FSILINK_initTx(CLLC_FSILINK_Tx *tx)
+{
+    tx->sequence = 0;
+    tx->frames = 0;
+}
+
+//
+// Setpoints are only taken with every value within its limits, a NaN is
+// never within them
+//
+void CLLC_FSILINK_initRx(CLLC_FSILINK_Rx *rx,
+                         const CLLC_FSILINK_Setpoint *setpointMin,
+                         const CLLC_FSILINK_Setpoint *setpointMax)
+{
+    rx->setpointMin = *setpointMin;
+    rx->setpointMax = *setpointMax;
+    rx->haveSequence = 0;
+    rx->nextSequence = 0;
+    rx->frames = 0;
+    rx->lostFrames = 0;
+    rx->errorFrames = 0;
+    rx->overrunCount = 0;
+    rx->rejectedFrames = 0;
+}
+
+void CLLC_FSILINK_packSetpoint(CLLC_FSILINK_Tx *tx, CLLC_FSILINK_Frame *frame,
+                               const CLLC_FSILINK_Setpoint *setpoint)
+{
+    frame->tag = CLLC_FSILINK_TAG_SETPOINT;
+    frame->userData = CLLC_FSILINK_VERSION;
+    frame->words = CLLC_FSILINK_SETPOINT_WORDS;
+    frame->word[0] = tx->sequence;
+    CLLC_FSILINK_putValue(&frame->word[1], setpoint->vSecRef_Volts);
+    CLLC_FSILINK_putValue(&frame->word[3], setpoint->iSecRef_Amps);
+    CLLC_FSILINK_putValue(&frame->word[5], setpoint->pwmFrequencyRef_Hz);
+
+    tx->sequence++;
+    tx->frames++;
+}
+
+//
+// The events of one received frame. Returns 1 for a good data frame with
+// the tag and length expected, its sequence number counted.
+//
+static uint16_t CLLC_FSILINK_takeFrame(CLLC_FSILINK_Rx *rx, uint16_t events,
+                                       const CLLC_FSILINK_Frame *frame,
+                                       uint16_t tag, uint16_t words)
+{
+    if((events & CLLC_FSILINK_RX_EVT_OVERRUNS) != 0U)
+    {
+        rx->overrunCount++;
+    }
+
+    if((events & CLLC_FSILINK_RX_EVT_ERRORS) != 0U)
+    {
+        rx->errorFrames++;
+        return(0);
+    }
+
+    if((events & CLLC_FSILINK_RX_EVT_DATA_FRAME) == 0U)
+    {
+        return(0);
+    }
+
+    if((frame->words != words) || (frame->tag != tag) ||
+       (frame->userData != CLLC_FSILINK_VERSION))
+    {
+        rx->rejectedFrames++;
+        return(0);
+    }
+
+    if(rx->haveSequence != 0U)
+    {
+        rx->lostFrames += (uint16_t)(frame->word[0] - rx->nextSequence);
+    }
+    rx->haveSequence = 1;
+    rx->nextSequence = frame->word[0] + 1U;
+
+    return(1);
+}
+
+uint16_t CLLC_FSILINK_takeSample(CLLC_FSILINK_Rx *rx, uint16_t events,
+                                 const CLLC_FSILINK_Frame *frame,
+                                 CLLC_FSILINK_Sample *sample)
+{
+    if(CLLC_FSILINK_takeFrame(rx, events, frame, CLLC_FSILINK_TAG_SAMPLE,
+                              CLLC_FSILINK_SAMPLE_WORDS) == 0U)
+    {
+        return(0);
+    }
+
+    sample->vSecSensed_pu = CLLC_FSILINK_getValue(&frame->word[1]);
+    sample->iSecSensed_pu = CLLC_FSILINK_getValue(&frame->word[3]);
+    sample->pwmPeriod_pu = CLLC_FSILINK_getValue(&frame->word[5]);
+    sample->pwmPhaseShiftPrimSec_ns = CLLC_FSILINK_getValue(&frame->word[7]);
+
+    rx->frames++;
+    return(1);
+}
+
+uint16_t CLLC_FSILINK_takeSetpoint(CLLC_FSILINK_Rx *rx, uint16_t events,
+                                   const CLLC_FSILINK_Frame *frame,
+                                   CLLC_FSILINK_Setpoint *setpoint)
+{
+    CLLC_FSILINK_Setpoint s;
+
+    if(CLLC_FSILINK_takeFrame(rx, events, frame, CLLC_FSILINK_TAG_SETPOINT,
+                              CLLC_FSILINK_SETPOINT_WORDS) == 0U)
+    {
+        return(0);
+    }
+
+    s.vSecRef_Volts = CLLC_FSILINK_getValue(&frame->word[1]);
+    s.iSecRef_Amps = CLLC_FSILINK_getValue(&frame->word[3]);
+    s.pwmFrequencyRef_Hz = CLLC_FSILINK_getValue(&frame->word[5]);
+
+    if(!((s.vSecRef_Volts >= rx->setpointMin.vSecRef_Volts) &&
+         (s.vSecRef_Volts <= rx->setpointMax.vSecRef_Volts) &&
+         (s.iSecRef_Amps >= rx->setpointMin.iSecRef_Amps) &&
+         (s.iSecRef_Amps <= rx->setpointMax.iSecRef_Amps) &&
+         (s.pwmFrequencyRef_Hz >= rx->setpointMin.pwmFrequencyRef_Hz) &&
+         (s.pwmFrequencyRef_Hz <= rx->setpointMax.pwmFrequencyRef_Hz)))
+    {
+        rx->rejectedFrames++;
+        return(0);
+    }
+
+    *setpoint = s;
+    rx->frames++;
+    return(1);
+}
+
+void CLLC_FSILINK_packShare(CLLC_FSILINK_Tx *tx, CLLC_FSILINK_Frame *frame,
+                            const CLLC_FSILINK_Share *share)
+{
+    frame->tag = CLLC_FSILINK_TAG_SHARE;
+    frame->userData = CLLC_FSILINK_VERSION;
+    frame->words = CLLC_FSILINK_SHARE_WORDS;
+    frame->word[0] = tx->sequence;
+    CLLC_FSILINK_putValue(&frame->word[1], share->iSecRef_pu);
+    CLLC_FSILINK_putValue(&frame->word[3], share->vSecRef_pu);
+
+    tx->sequence++;
+    tx->frames++;
+}
+
+//
+// The references are taken within the setpoint limits, the current per unit
+// of CLLC_ISEC_MAX_SENSE_AMPS and the voltage of CLLC_VSEC_OPTIMAL_RANGE_VOLTS
+//
+uint16_t CLLC_FSILINK_takeShare(CLLC_FSILINK_Rx *rx, uint16_t events,
+                                const CLLC_FSILINK_Frame *frame,
+                                CLLC_FSILINK_Share *share)
+{
+    CLLC_FSILINK_Share s;
+
+    if(CLLC_FSILINK_takeFrame(rx, events, frame, CLLC_FSILINK_TAG_SHARE,
+                              CLLC_FSILINK_SHARE_WORDS) == 0U)
+    {
+        return(0);
+    }
+
+    s.iSecRef_pu = CLLC_FSILINK_getValue(&frame->word[1]);
+    s.vSecRef_pu = CLLC_FSILINK_getValue(&frame->word[3]);
+
+    if(!((s.iSecRef_pu * CLLC_ISEC_MAX_SENSE_AMPS >=
+          rx->setpointMin.iSecRef_Amps) &&
+         (s.iSecRef_pu * CLLC_ISEC_MAX_SENSE_AMPS <=
+          rx->setpointMax.iSecRef_Amps) &&
+         (s.vSecRef_pu * CLLC_VSEC_OPTIMAL_RANGE_VOLTS >=
+          rx->setpointMin.vSecRef_Volts) &&
+         (s.vSecRef_pu * CLLC_VSEC_OPTIMAL_RANGE_VOLTS <=
+          rx->setpointMax.vSecRef_Volts)))
+    {
+        rx->rejectedFrames++;
+        return(0);
+    }
+
+    *share = s;
+    rx->frames++;
+    return(1);
+}
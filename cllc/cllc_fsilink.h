@@ -0,0 +1,212 @@
+//#############################################################################
+//
+// FILE:   cllc_fsilink.h
+//
+// TITLE:  Framing of the FSI link, samples out and setpoints in
+//         Every ISR2 run sends one sample frame of the sensed secondary
+//         voltage and current, the switching period and the phase shift, a
+//         remote controller sends setpoint frames back, taken at a fixed
+//         point of ISR3. The FSI adds the start and end of frame, the frame
+//         type and an 8 bit CRC, this file what goes into the data words,
+//         the frame tag and the user data:
+//
+//         tag         CLLC_FSILINK_TAG_SAMPLE or CLLC_FSILINK_TAG_SETPOINT
+//         user data   CLLC_FSILINK_VERSION
+//         word 0      sequence number, counts the frames of the direction
+//         word 1..    the float32 values, low word first
+//
+//         Boards sharing one bus (cllc_share.h) send share frames instead,
+//         the current reference of the master and its voltage reference,
+//         forwarded as they are from board to board:
+//
+//         tag         CLLC_FSILINK_TAG_SHARE
+//         word 0      sequence number of the master
+//         word 1..    iSecRef_pu, vSecRef_pu
+//
+//         The sequence number is checked on the receiving side: every
+//         number that never arrived good counts as lost, whether the frame
+//         was dropped on the line or flagged by the receiver. A frame with
+//         the wrong tag, version or length, or values out of the limits, is
+//         counted and not taken. The receiving side takes the events of the
+//         FSI receiver as they are, the CLLC_FSILINK_RX_EVT_ values are the
+//         FSI_RX_EVT_ flags of fsi.h.
+//
+//         The registers are in cllc_hal.h, the host loopback model in
+//         host/cllc_fsi_loopback.h.
+//
+//#############################################################################
+
+#ifndef CLLC_FSILINK_H
+#define CLLC_FSILINK_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "cllc_settings.h"
+
+//
+// Defines
+//
+#define CLLC_FSILINK_WORDS_MAX          16U
+#define CLLC_FSILINK_VERSION            1U
+
+#define CLLC_FSILINK_TAG_SAMPLE         1U
+#define CLLC_FSILINK_TAG_SETPOINT       2U
+#define CLLC_FSILINK_TAG_SHARE          3U
+
+#define CLLC_FSILINK_SAMPLE_WORDS       9U      // sequence, 4 values
+#define CLLC_FSILINK_SETPOINT_WORDS     7U      // sequence, 3 values
+#define CLLC_FSILINK_SHARE_WORDS        5U      // sequence, 2 values
+
+//
+// receiver events, as FSI_RX_EVT_ in fsi.h
+//
+#define CLLC_FSILINK_RX_EVT_CRC_ERR     0x0004U
+#define CLLC_FSILINK_RX_EVT_TYPE_ERR    0x0008U
+#define CLLC_FSILINK_RX_EVT_EOF_ERR     0x0010U
+#define CLLC_FSILINK_RX_EVT_OVERRUN     0x0020U
+#define CLLC_FSILINK_RX_EVT_FRAME_DONE  0x0040U
+#define CLLC_FSILINK_RX_EVT_ERR_FRAME   0x0100U
+#define CLLC_FSILINK_RX_EVT_FRAME_OVERRUN 0x0400U
+#define CLLC_FSILINK_RX_EVT_DATA_FRAME  0x0800U
+
+#define CLLC_FSILINK_RX_EVT_ERRORS      (CLLC_FSILINK_RX_EVT_CRC_ERR |        \
+                                         CLLC_FSILINK_RX_EVT_TYPE_ERR |       \
+                                         CLLC_FSILINK_RX_EVT_EOF_ERR |        \
+                                         CLLC_FSILINK_RX_EVT_ERR_FRAME)
+#define CLLC_FSILINK_RX_EVT_OVERRUNS    (CLLC_FSILINK_RX_EVT_OVERRUN |        \
+                                         CLLC_FSILINK_RX_EVT_FRAME_OVERRUN)
+
+//
+// typedefs
+//
+typedef struct
+{
+    uint16_t tag;
+    uint16_t userData;
+    uint16_t words;
+    uint16_t word[CLLC_FSILINK_WORDS_MAX];
+} CLLC_FSILINK_Frame;
+
+typedef struct
+{
+    float32_t vSecSensed_pu;
+    float32_t iSecSensed_pu;
+    float32_t pwmPeriod_pu;
+    float32_t pwmPhaseShiftPrimSec_ns;
+} CLLC_FSILINK_Sample;
+
+typedef struct
+{
+    float32_t vSecRef_Volts;
+    float32_t iSecRef_Amps;
+    float32_t pwmFrequencyRef_Hz;
+} CLLC_FSILINK_Setpoint;
+
+typedef struct
+{
+    float32_t iSecRef_pu;
+    float32_t vSecRef_pu;
+} CLLC_FSILINK_Share;
+
+typedef struct
+{
+    uint16_t sequence;          // of the next frame
+    uint32_t frames;
+} CLLC_FSILINK_Tx;
+
+typedef struct
+{
+    CLLC_FSILINK_Setpoint setpointMin;
+    CLLC_FSILINK_Setpoint setpointMax;
+    uint16_t haveSequence;
+    uint16_t nextSequence;
+    uint32_t frames;            // taken
+    uint32_t lostFrames;        // sequence numbers that never arrived good
+    uint32_t errorFrames;       // flagged by the receiver
+    uint32_t overrunCount;      // frames the receiver overwrote unread
+    uint32_t rejectedFrames;    // tag, version, length or values wrong
+} CLLC_FSILINK_Rx;
+
+//
+// the function prototypes
+//
+void CLLC_FSILINK_initTx(CLLC_FSILINK_Tx *tx);
+void CLLC_FSILINK_initRx(CLLC_FSILINK_Rx *rx,
+                         const CLLC_FSILINK_Setpoint *setpointMin,
+                         const CLLC_FSILINK_Setpoint *setpointMax);
+void CLLC_FSILINK_packSetpoint(CLLC_FSILINK_Tx *tx, CLLC_FSILINK_Frame *frame,
+                               const CLLC_FSILINK_Setpoint *setpoint);
+uint16_t CLLC_FSILINK_takeSample(CLLC_FSILINK_Rx *rx, uint16_t events,
+                                 const CLLC_FSILINK_Frame *frame,
+                                 CLLC_FSILINK_Sample *sample);
+uint16_t CLLC_FSILINK_takeSetpoint(CLLC_FSILINK_Rx *rx, uint16_t events,
+                                   const CLLC_FSILINK_Frame *frame,
+                                   CLLC_FSILINK_Setpoint *setpoint);
+void CLLC_FSILINK_packShare(CLLC_FSILINK_Tx *tx, CLLC_FSILINK_Frame *frame,
+                            const CLLC_FSILINK_Share *share);
+uint16_t CLLC_FSILINK_takeShare(CLLC_FSILINK_Rx *rx, uint16_t events,
+                                const CLLC_FSILINK_Frame *frame,
+                                CLLC_FSILINK_Share *share);
+
+//
+// Low word first
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_FSILINK_putValue)
+static inline void CLLC_FSILINK_putValue(uint16_t *word, float32_t value)
+{
+    union
+    {
+        float32_t value;
+        uint32_t bits;
+    } v;
+
+    v.value = value;
+    word[0] = (uint16_t)(v.bits & 0xFFFFU);
+    word[1] = (uint16_t)(v.bits >> 16);
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_FSILINK_getValue)
+static inline float32_t CLLC_FSILINK_getValue(const uint16_t *word)
+{
+    union
+    {
+        float32_t value;
+        uint32_t bits;
+    } v;
+
+    v.bits = (uint32_t)word[0] | ((uint32_t)word[1] << 16);
+    return(v.value);
+}
+
+//
+// The sample frame of one ISR2 run
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_FSILINK_packSample)
+static inline void CLLC_FSILINK_packSample(CLLC_FSILINK_Tx *tx,
+                                           CLLC_FSILINK_Frame *frame,
+                                           const CLLC_FSILINK_Sample *sample)
+{
+    frame->tag = CLLC_FSILINK_TAG_SAMPLE;
+    frame->userData = CLLC_FSILINK_VERSION;
+    frame->words = CLLC_FSILINK_SAMPLE_WORDS;
+    frame->word[0] = tx->sequence;
+    CLLC_FSILINK_putValue(&frame->word[1], sample->vSecSensed_pu);
+    CLLC_FSILINK_putValue(&frame->word[3], sample->iSecSensed_pu);
+    CLLC_FSILINK_putValue(&frame->word[5], sample->pwmPeriod_pu);
+    CLLC_FSILINK_putValue(&frame->word[7], sample->pwmPhaseShiftPrimSec_ns);
+
+    tx->sequence++;
+    tx->frames++;
+}
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
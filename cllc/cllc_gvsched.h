@@ -0,0 +1,89 @@
+//#############################################################################
+//
+// FILE:   cllc_gvsched.h
+//
+// TITLE:  Gain schedule of the voltage loop over the switching period
+//         The gain of the tank from the period to the bus voltage falls by
+//         more than an order of magnitude from the bottom of the switching
+//         range to its top and peaks at resonance, the coefficients of GV
+//         are tuned for one point of it. A DCL_GSM maps the slewed period,
+//         from CLLC_pwmPeriodMin_pu to 1 over its 8 sectors, to a gain on
+//         the error of GV that holds the crossover of the loop, read each
+//         ISR2.
+//
+//         The gain goes on the error ahead of the DF13 and not into its
+//         coefficients. The history of the DF13 holds the scaled errors and
+//         the outputs as they were, so a change of the gain only acts on
+//         the errors to come and the output does not jump, whether the
+//         period slews through the sectors or the loop is closed at an
+//         other period than it was opened.
+//
+//         The gains are CLLC_GV1/2_SCHEDULE_GAINS in cllc_settings.h,
+//         host/cllc_gvsched_check.c checks the margins of the loop over the
+//         schedule.
+//
+//#############################################################################
+
+#ifndef CLLC_GVSCHED_H
+#define CLLC_GVSCHED_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "cllc_settings.h"
+#include "DCL/DCLF32.h"
+
+//
+// Inline functions
+//
+
+//
+// Loads the gains at the GSM_N + 1 sector bounds, gain[0] at
+// periodMin_pu and gain[GSM_N] at 1, and the slopes of the sectors
+//
+static inline void CLLC_GVSCHED_init(DCL_GSM *schedule,
+                                     const float32_t *gain)
+{
+    uint16_t j;
+
+    for(j = 0; j < GSM_N; j++)
+    {
+        schedule->c[j] = gain[j];
+        schedule->m[j] = (gain[j + 1] - gain[j]) * (float32_t)GSM_N;
+    }
+    schedule->c[GSM_N] = gain[GSM_N];
+    schedule->h = 1.0f / (float32_t)GSM_N;
+    schedule->sps = NULL_ADDR;
+    schedule->css = NULL_ADDR;
+}
+
+//
+// The gain at the slewed period, the period per unit of the range above
+// periodMin_pu in scale
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_GVSCHED_getGain)
+static inline float32_t CLLC_GVSCHED_getGain(DCL_GSM *schedule,
+                                             float32_t period_pu,
+                                             float32_t periodMin_pu,
+                                             float32_t scale)
+{
+    float32_t x = (period_pu - periodMin_pu) * scale;
+
+    if(x < 0.0f)
+    {
+        x = 0.0f;
+    }
+
+    return(DCL_runGSM_C1(schedule, x));
+}
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
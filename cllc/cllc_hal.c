@@ -22,6 +22,13 @@ volatile uint32_t ePWM[9] = {0,
                              EPWM7_BASE,
                              EPWM8_BASE};
 
+volatile uint16_t CLLC_HAL_isrExitMark[3];
+
+#if CLLC_ADC_OVERSAMPLE > 1
+volatile uint16_t CLLC_HAL_iSecOversample[2 * CLLC_ADC_OVERSAMPLE];
+volatile uint16_t CLLC_HAL_vSecOversample[2 * CLLC_ADC_OVERSAMPLE];
+#endif
+
 //
 //  This routine sets up the basic device configuration such as initializing PLL
 //  CPU timers and copying code from FLASH to RAM
@@ -166,6 +173,22 @@ void CLLC_HAL_setupPWMinUpDownCountMode(uint32_t base1,
 
 }
 
+//
+// the message RAMs are cleared by hardware, the mailboxes start out with
+// both buffers zero
+//
+void CLLC_HAL_initCLAMessageRAM(void)
+{
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+    MemCfg_initSections(MEMCFG_SECT_MSGCPUTOCLA1 | MEMCFG_SECT_MSGCLA1TOCPU);
+
+    while(!MemCfg_getInitStatus(MEMCFG_SECT_MSGCPUTOCLA1 |
+                                MEMCFG_SECT_MSGCLA1TOCPU))
+    {
+    }
+#endif
+}
+
 void CLLC_HAL_setupCLA(void)
 {
     //
@@ -173,8 +196,14 @@ void CLLC_HAL_setupCLA(void)
     //
 #if CLLC_ISR1_RUNNING_ON == CLA_CORE
 
+#ifdef _FLASH
+    //
+    // the CLA program is loaded to flash, copy it to the LS RAM it runs
+    // from while the RAM still belongs to the C28x
+    //
     memcpy((uint32_t *)&Cla1ProgRunStart, (uint32_t *)&Cla1ProgLoadStart,
             (uint32_t)&Cla1ProgLoadSize );
+#endif
 
     //
     // first assign memory to CLA
@@ -197,18 +226,27 @@ void CLLC_HAL_setupCLA(void)
     // Suppressing #770-D conversion from pointer to smaller integer
     // The CLA address range is 16 bits so the addresses passed to the MVECT
     // registers will be in the lower 64KW address space. Turn the warning
-    // back on after the MVECTs are assigned addresses
+    // back on after the MVECTs are assigned addresses. The cast goes through
+    // uintptr_t so the host build, with wider pointers, does not warn.
     //
     #pragma diag_suppress = 770
 
-    CLA_mapTaskVector(CLA1_BASE , CLA_MVECT_1, (uint16_t)&Cla1Task1);
-    CLA_mapTaskVector(CLA1_BASE , CLA_MVECT_2, (uint16_t)&Cla1Task2);
-    CLA_mapTaskVector(CLA1_BASE , CLA_MVECT_3, (uint16_t)&Cla1Task3);
-    CLA_mapTaskVector(CLA1_BASE , CLA_MVECT_4, (uint16_t)&Cla1Task4);
-    CLA_mapTaskVector(CLA1_BASE , CLA_MVECT_5, (uint16_t)&Cla1Task5);
-    CLA_mapTaskVector(CLA1_BASE , CLA_MVECT_6, (uint16_t)&Cla1Task6);
-    CLA_mapTaskVector(CLA1_BASE , CLA_MVECT_7, (uint16_t)&Cla1Task7);
-    CLA_mapBackgroundTaskVector(CLA1_BASE, (uint16_t)&Cla1BackgroundTask);
+    CLA_mapTaskVector(CLA1_BASE , CLA_MVECT_1,
+                      (uint16_t)(uintptr_t)&Cla1Task1);
+    CLA_mapTaskVector(CLA1_BASE , CLA_MVECT_2,
+                      (uint16_t)(uintptr_t)&Cla1Task2);
+    CLA_mapTaskVector(CLA1_BASE , CLA_MVECT_3,
+                      (uint16_t)(uintptr_t)&Cla1Task3);
+    CLA_mapTaskVector(CLA1_BASE , CLA_MVECT_4,
+                      (uint16_t)(uintptr_t)&Cla1Task4);
+    CLA_mapTaskVector(CLA1_BASE , CLA_MVECT_5,
+                      (uint16_t)(uintptr_t)&Cla1Task5);
+    CLA_mapTaskVector(CLA1_BASE , CLA_MVECT_6,
+                      (uint16_t)(uintptr_t)&Cla1Task6);
+    CLA_mapTaskVector(CLA1_BASE , CLA_MVECT_7,
+                      (uint16_t)(uintptr_t)&Cla1Task7);
+    CLA_mapBackgroundTaskVector(CLA1_BASE,
+                                (uint16_t)(uintptr_t)&Cla1BackgroundTask);
 
     #pragma diag_warning = 770
 
@@ -216,10 +254,10 @@ void CLLC_HAL_setupCLA(void)
     CLA_enableTasks(CLA1_BASE, CLA_TASKFLAG_ALL);
 
     CLA_enableHardwareTrigger(CLA1_BASE);
-    CLA_setTriggerSource(CLA_TASK_8, ISR2_TRIG_CLA);
+    CLA_setTriggerSource(CLA_TASK_8, CLLC_ISR2_TRIG_CLA);
     CLA_enableBackgroundTask(CLA1_BASE);
 
-    CLA_setTriggerSource(CLA_TASK_1, ISR1_TRIG_CLA);
+    CLA_setTriggerSource(CLA_TASK_1, CLLC_ISR1_TRIG_CLA);
 #endif
 }
 
@@ -476,6 +514,173 @@ void CLLC_HAL_setupPWM(uint16_t powerFlowDir)
     EPWM_setGlobalLoadOneShotLatch(CLLC_PRIM_LEG1_PWM_BASE);
 }
 
+//
+// Global load of the period and compares of the four bridge PWMs, the
+// one-shot latch is set by CLLC_HAL_commitPWMUpdate. The prim legs load at
+// their zero, the sec legs at the sync, which PRIM LEG1 only issues on the
+// one-shot reload, so TBPHS is taken at the same instant and the phase load
+// of the sec legs can stay enabled. Replaces the raw GLDCTL writes of main.
+//
+void CLLC_HAL_setupGlobalLoad(void)
+{
+    uint32_t base[4] = {CLLC_PRIM_LEG1_PWM_BASE, CLLC_PRIM_LEG2_PWM_BASE,
+                        CLLC_SEC_LEG1_PWM_BASE, CLLC_SEC_LEG2_PWM_BASE};
+    uint16_t i;
+
+    for(i = 0; i < 4; i++)
+    {
+        EPWM_enableGlobalLoadRegisters(base[i],
+                                       EPWM_GL_REGISTER_TBPRD_TBPRDHR |
+                                       EPWM_GL_REGISTER_CMPA_CMPAHR |
+                                       EPWM_GL_REGISTER_CMPB_CMPBHR);
+        EPWM_setGlobalLoadTrigger(base[i], (i < 2) ?
+                                  EPWM_GL_LOAD_PULSE_CNTR_ZERO :
+                                  EPWM_GL_LOAD_PULSE_SYNC);
+        EPWM_setGlobalLoadEventPrescale(base[i], 1);
+        EPWM_enableGlobalLoadOneShotMode(base[i]);
+        EPWM_enableGlobalLoad(base[i]);
+    }
+
+    EPWM_setOneShotSyncOutTrigger(CLLC_PRIM_LEG1_PWM_BASE,
+                                  EPWM_OSHT_SYNC_OUT_TRIG_RELOAD);
+    EPWM_enableOneShotSync(CLLC_PRIM_LEG1_PWM_BASE);
+
+    EPWM_enablePhaseShiftLoad(CLLC_SEC_LEG1_PWM_BASE);
+    EPWM_enablePhaseShiftLoad(CLLC_SEC_LEG2_PWM_BASE);
+}
+
+#if CLLC_PHASES > 1
+//
+// the link of another PWM to the one at base
+//
+static EPWM_CurrentLink CLLC_HAL_getPWMLink(uint32_t base)
+{
+    return((EPWM_CurrentLink)((base - EPWM1_BASE) /
+                              (EPWM2_BASE - EPWM1_BASE)));
+}
+
+//
+// The PWMs of a phase after phase 0, prim to sec power flow, set up as those
+// of phase 0 after CLLC_HAL_setupPWM and CLLC_HAL_setupGlobalLoad. All four
+// sync to PRIM LEG1 of phase 0, the prim legs at the interleave and the sec
+// legs at the interleave plus the prim to sec phase shift. The period comes
+// from PRIM LEG1 of phase 0 and the sec compares from SEC LEG1 of phase 0
+// through the links, and the global load of the phase is linked to that of
+// phase 0 and taken at the sync, which phase 0 issues on the one-shot
+// reload, so an update is six more writes and lands with that of phase 0.
+// The CMPSS blanking of the synchronous rectification stays on phase 0,
+// there is no comparator left for a second one. The trips are those of
+// phase 0 and the phase starts held in the one-shot trip.
+//
+void CLLC_HAL_setupPhasePWM(const CLLC_PHASE_Instance *phase)
+{
+    uint32_t base[4] = {phase->primLeg1Base, phase->primLeg2Base,
+                        phase->secLeg1Base, phase->secLeg2Base};
+    uint16_t i;
+
+    CLLC_HAL_setupHRPWMinUpDownCountModeWithDeadBand(
+                               base[0],
+                               CLLC_NOMINAL_PWM_SWITCHING_FREQUENCY_HZ,
+                               CLLC_PWMSYSCLOCK_FREQ_HZ,
+                               CLLC_PRIM_PWM_DEADBAND_RED_NS,
+                               CLLC_PRIM_PWM_DEADBAND_FED_NS);
+    CLLC_HAL_setupHRPWMinUpDownCountModeWithDeadBand(
+                               base[1],
+                               CLLC_NOMINAL_PWM_SWITCHING_FREQUENCY_HZ,
+                               CLLC_PWMSYSCLOCK_FREQ_HZ,
+                               CLLC_PRIM_PWM_DEADBAND_RED_NS,
+                               CLLC_PRIM_PWM_DEADBAND_FED_NS);
+    CLLC_HAL_setupHRPWMinUpDownCount2ChAsymmetricMode(
+                              base[2],
+                              CLLC_NOMINAL_PWM_SWITCHING_FREQUENCY_HZ,
+                              CLLC_PWMSYSCLOCK_FREQ_HZ);
+    CLLC_HAL_setupHRPWMinUpDownCount2ChAsymmetricMode(
+                              base[3],
+                              CLLC_NOMINAL_PWM_SWITCHING_FREQUENCY_HZ,
+                              CLLC_PWMSYSCLOCK_FREQ_HZ);
+
+    //
+    // workaround for when TBPHS skips over CMPA, as on PRIM LEG2 of phase 0
+    //
+    EPWM_setActionQualifierAction(base[1], EPWM_AQ_OUTPUT_A ,
+           EPWM_AQ_OUTPUT_LOW, EPWM_AQ_OUTPUT_ON_TIMEBASE_ZERO);
+    EPWM_setActionQualifierAction(base[1], EPWM_AQ_OUTPUT_A ,
+           EPWM_AQ_OUTPUT_HIGH, EPWM_AQ_OUTPUT_ON_TIMEBASE_PERIOD);
+
+    //
+    // swapped outputs of PRIM LEG2 and SEC LEG1
+    //
+    HWREGH(base[1] + EPWM_O_DBCTL) = (HWREGH(base[1] + EPWM_O_DBCTL) | 0x3000);
+    HWREGH(base[2] + EPWM_O_DBCTL) = (HWREGH(base[2] + EPWM_O_DBCTL) | 0x3000);
+
+    for(i = 0; i < 4; i++)
+    {
+        EPWM_enablePhaseShiftLoad(base[i]);
+        EPWM_setSyncInPulseSource(base[i],
+                                  EPWM_SYNC_IN_PULSE_SRC_SYNCOUT_EPWM1);
+        EPWM_setCountModeAfterSync(base[i], EPWM_COUNT_MODE_UP_AFTER_SYNC);
+
+        EPWM_setupEPWMLinks(base[i], EPWM_LINK_WITH_EPWM_1, EPWM_LINK_TBPRD);
+        EPWM_setupEPWMLinks(base[i], EPWM_LINK_WITH_EPWM_1,
+                            EPWM_LINK_GLDCTL2);
+
+        EPWM_enableGlobalLoadRegisters(base[i],
+                                       EPWM_GL_REGISTER_TBPRD_TBPRDHR |
+                                       EPWM_GL_REGISTER_CMPA_CMPAHR |
+                                       EPWM_GL_REGISTER_CMPB_CMPBHR);
+        EPWM_setGlobalLoadTrigger(base[i], EPWM_GL_LOAD_PULSE_SYNC);
+        EPWM_setGlobalLoadEventPrescale(base[i], 1);
+        EPWM_enableGlobalLoadOneShotMode(base[i]);
+        EPWM_enableGlobalLoad(base[i]);
+
+#if CLLC_BOARD_PROTECTION_GANFAULT == 1
+        EPWM_enableTripZoneSignals(base[i], EPWM_TZ_SIGNAL_OSHT2);
+#endif
+#if CLLC_BOARD_PROTECTION_IPRIM == 1 ||                                       \
+    CLLC_BOARD_PROTECTION_ISEC == 1  ||                                       \
+    CLLC_BOARD_PROTECTION_VSEC == 1
+        EPWM_selectDigitalCompareTripInput(base[i], EPWM_DC_TRIP_TRIPIN4,
+                                           EPWM_DC_TYPE_DCAH);
+        EPWM_setTripZoneDigitalCompareEventCondition(base[i],
+                                                     EPWM_TZ_DC_OUTPUT_A1,
+                                                     EPWM_TZ_EVENT_DCXH_HIGH);
+        EPWM_setDigitalCompareEventSource(base[i], EPWM_DC_MODULE_A,
+                                          EPWM_DC_EVENT_1,
+                                          EPWM_DC_EVENT_SOURCE_ORIG_SIGNAL);
+        EPWM_setDigitalCompareEventSyncMode(base[i], EPWM_DC_MODULE_A,
+                                            EPWM_DC_EVENT_1,
+                                            EPWM_DC_EVENT_INPUT_NOT_SYNCED);
+        EPWM_enableTripZoneSignals(base[i], EPWM_TZ_SIGNAL_DCAEVT1);
+#endif
+        EPWM_enableTripZoneSignals(base[i], EPWM_TZ_SIGNAL_CBC6);
+        EPWM_setTripZoneAction(base[i], EPWM_TZ_ACTION_EVENT_TZA,
+                               EPWM_TZ_ACTION_LOW);
+        EPWM_setTripZoneAction(base[i], EPWM_TZ_ACTION_EVENT_TZB,
+                               EPWM_TZ_ACTION_LOW);
+    }
+
+    //
+    // CMPA and CMPB of PRIM LEG2 from PRIM LEG1, those of the sec legs from
+    // SEC LEG1 of phase 0
+    //
+    EPWM_setupEPWMLinks(base[1], CLLC_HAL_getPWMLink(base[0]),
+                        EPWM_LINK_COMP_A);
+    EPWM_setupEPWMLinks(base[1], CLLC_HAL_getPWMLink(base[0]),
+                        EPWM_LINK_COMP_B);
+    for(i = 2; i < 4; i++)
+    {
+        EPWM_setupEPWMLinks(base[i],
+                            CLLC_HAL_getPWMLink(CLLC_SEC_LEG1_PWM_BASE),
+                            EPWM_LINK_COMP_A);
+        EPWM_setupEPWMLinks(base[i],
+                            CLLC_HAL_getPWMLink(CLLC_SEC_LEG1_PWM_BASE),
+                            EPWM_LINK_COMP_B);
+    }
+
+    CLLC_HAL_holdPhase(phase);
+}
+#endif
+
 void CLLC_HAL_setupECAPinPWMMode(uint32_t base1,
                             float32_t pwmFreq_Hz,
                             float32_t pwmSysClkFreq_Hz)
@@ -734,6 +939,47 @@ void CLLC_HAL_setupHRPWMinUpDownCount2ChAsymmetricMode(uint32_t base1,
 // mode is 2: prim and sec PWM on
 // mode is 3: prim and sec PWM on
 //
+#if CLLC_PHASES > 1
+//
+// the pins of phase 1 in the modes of CLLC_HAL_setupPWMpins, the prim pins
+// are the first four
+//
+static void CLLC_HAL_setupPhasePWMpins(uint16_t mode)
+{
+    static const uint32_t pinConfig[8] = CLLC_PHASE1_PWM_GPIO_PIN_CONFIGS;
+    static const uint32_t disPinConfig[8] =
+            CLLC_PHASE1_PWM_DIS_GPIO_PIN_CONFIGS;
+    uint16_t pin, gpio, enable, disable;
+
+    for(pin = 0; pin < 8; pin++)
+    {
+        gpio = CLLC_PHASE1_PWM_FIRST_GPIO + pin;
+        if(pin < 4)
+        {
+            disable = (mode == 0);
+            enable = (mode == 1 || mode == 2 || mode == 3);
+        }
+        else
+        {
+            disable = (mode == 0 || mode == 1);
+            enable = (mode == 2 || mode == 3);
+        }
+
+        if(disable)
+        {
+            GPIO_writePin(gpio, 0);
+            GPIO_setPinConfig(disPinConfig[pin]);
+        }
+        if(enable)
+        {
+            GPIO_setDirectionMode(gpio, GPIO_DIR_MODE_OUT);
+            GPIO_setPadConfig(gpio, GPIO_PIN_TYPE_STD);
+            GPIO_setPinConfig(pinConfig[pin]);
+        }
+    }
+}
+#endif
+
 void CLLC_HAL_setupPWMpins(uint16_t mode)
 {
     //
@@ -809,10 +1055,58 @@ void CLLC_HAL_setupPWMpins(uint16_t mode)
         GPIO_setPadConfig(CLLC_SEC_LEG2_PWM_H_GPIO, GPIO_PIN_TYPE_STD);
         GPIO_setPinConfig(CLLC_SEC_LEG2_PWM_H_GPIO_PIN_CONFIG );
     }
+
+#if CLLC_PHASES > 1
+    CLLC_HAL_setupPhasePWMpins(mode);
+#endif
+}
+
+//
+// the oversampling SOCs triggered by TRIG1, the others by TRIG2
+//
+#define CLLC_HAL_OVERSAMPLE_TRIG1_SOCS ((CLLC_ADC_OVERSAMPLE + 1U) / 2U)
+
+#if CLLC_ADC_OVERSAMPLE > 1
+//
+// The ADC interrupt at the end of the last oversampling SOC, once per
+// switching period, triggers the DMA channel, which copies all the results
+// in one burst. A transfer is two bursts, the first into the first half of
+// result and the second into the other half: the source steps back to the
+// first SOC and the destination runs on. Continuous mode keeps the
+// interrupt, nobody clears it, and rearms the channel at the begin
+// addresses after each transfer.
+//
+static void CLLC_HAL_setupOversampleDMA(uint32_t adcBase,
+                                        uint32_t resultBase,
+                                        ADC_SOCNumber firstSOC,
+                                        ADC_IntNumber adcInt,
+                                        uint32_t dmaBase,
+                                        DMA_Trigger dmaTrig,
+                                        volatile uint16_t *result)
+{
+    ADC_setInterruptSource(adcBase, adcInt,
+                           (ADC_SOCNumber)(firstSOC + CLLC_ADC_OVERSAMPLE -
+                                           1U));
+    ADC_enableContinuousMode(adcBase, adcInt);
+    ADC_enableInterrupt(adcBase, adcInt);
+    ADC_clearInterruptStatus(adcBase, adcInt);
+
+    DMA_configAddresses(dmaBase, (const void *)result,
+                        (const void *)(uintptr_t)(resultBase + ADC_O_RESULT0 +
+                                                  (uint32_t)firstSOC));
+    DMA_configBurst(dmaBase, CLLC_ADC_OVERSAMPLE, 1, 1);
+    DMA_configTransfer(dmaBase, 2U, -(int16_t)(CLLC_ADC_OVERSAMPLE - 1U), 1);
+    DMA_configMode(dmaBase, dmaTrig, DMA_CFG_ONESHOT_DISABLE |
+                   DMA_CFG_CONTINUOUS_ENABLE | DMA_CFG_SIZE_16BIT);
+    DMA_clearTriggerFlag(dmaBase);
+    DMA_enableTrigger(dmaBase);
+    DMA_startChannel(dmaBase);
 }
+#endif
 
 void CLLC_HAL_setupADC(void)
 {
+    uint16_t i;
 
     ADC_setVREF(ADCA_BASE, ADC_REFERENCE_INTERNAL, ADC_REFERENCE_3_3V);
     ADC_setVREF(ADCB_BASE, ADC_REFERENCE_INTERNAL, ADC_REFERENCE_3_3V);
@@ -840,81 +1134,18 @@ void CLLC_HAL_setupADC(void)
 
 
     //
-    //ISEC
+    //ISEC, the SOCs after the first only when oversampling
     //
-    ADC_setupSOC(CLLC_ISEC_ADC_MODULE,
-                 CLLC_ISEC_ADC_SOC_NO_1,
-                 CLLC_ISEC_ADC_TRIG_SOURCE_1,
-                 CLLC_ISEC_ADC_PIN,
-                 CLLC_ISEC_ADC_ACQPS_SYS_CLKS);
-
-    #if CLLC_OVERSAMPLING_ENABLED == 1
-        ADC_setupSOC(CLLC_ISEC_ADC_MODULE,
-                     CLLC_ISEC_ADC_SOC_NO_2,
-                     CLLC_ISEC_ADC_TRIG_SOURCE_1,
-                     CLLC_ISEC_ADC_PIN,
-                     CLLC_ISEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_ISEC_ADC_MODULE,
-                     CLLC_ISEC_ADC_SOC_NO_3,
-                     CLLC_ISEC_ADC_TRIG_SOURCE_1,
-                     CLLC_ISEC_ADC_PIN,
-                     CLLC_ISEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_ISEC_ADC_MODULE,
-                     CLLC_ISEC_ADC_SOC_NO_4,
-                     CLLC_ISEC_ADC_TRIG_SOURCE_1,
-                     CLLC_ISEC_ADC_PIN,
-                     CLLC_ISEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_ISEC_ADC_MODULE,
-                     CLLC_ISEC_ADC_SOC_NO_5,
-                     CLLC_ISEC_ADC_TRIG_SOURCE_1,
-                     CLLC_ISEC_ADC_PIN,
-                     CLLC_ISEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_ISEC_ADC_MODULE,
-                     CLLC_ISEC_ADC_SOC_NO_6,
-                     CLLC_ISEC_ADC_TRIG_SOURCE_1,
-                     CLLC_ISEC_ADC_PIN,
-                     CLLC_ISEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_ISEC_ADC_MODULE,
-                     CLLC_ISEC_ADC_SOC_NO_7,
-                     CLLC_ISEC_ADC_TRIG_SOURCE_2,
-                     CLLC_ISEC_ADC_PIN,
-                     CLLC_ISEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_ISEC_ADC_MODULE,
-                     CLLC_ISEC_ADC_SOC_NO_8,
-                     CLLC_ISEC_ADC_TRIG_SOURCE_2,
-                     CLLC_ISEC_ADC_PIN,
-                     CLLC_ISEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_ISEC_ADC_MODULE,
-                     CLLC_ISEC_ADC_SOC_NO_9,
-                     CLLC_ISEC_ADC_TRIG_SOURCE_2,
-                     CLLC_ISEC_ADC_PIN,
-                     CLLC_ISEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_ISEC_ADC_MODULE,
-                     CLLC_ISEC_ADC_SOC_NO_10,
-                     CLLC_ISEC_ADC_TRIG_SOURCE_2,
-                     CLLC_ISEC_ADC_PIN,
-                     CLLC_ISEC_ADC_ACQPS_SYS_CLKS);
-
+    for(i = 0; i < CLLC_ADC_OVERSAMPLE; i++)
+    {
         ADC_setupSOC(CLLC_ISEC_ADC_MODULE,
-                     CLLC_ISEC_ADC_SOC_NO_11,
-                     CLLC_ISEC_ADC_TRIG_SOURCE_2,
+                     (ADC_SOCNumber)(CLLC_ISEC_ADC_SOC_NO_1 + i),
+                     (i < CLLC_HAL_OVERSAMPLE_TRIG1_SOCS) ?
+                             CLLC_ISEC_ADC_TRIG_SOURCE_1 :
+                             CLLC_ISEC_ADC_TRIG_SOURCE_2,
                      CLLC_ISEC_ADC_PIN,
                      CLLC_ISEC_ADC_ACQPS_SYS_CLKS);
-
-//        ADC_setupSOC(CLLC_ISEC_ADC_MODULE,
-//                     ISEC_ADC_SOC_NO_12,
-//                     ISEC_ADC_TRIG_SOURCE_2,
-//                     ISEC_ADC_PIN,
-//                     ISEC_ADC_ACQPS_SYS_CLKS);
-    #endif
+    }
 
     //
     //VPRIM
@@ -925,7 +1156,7 @@ void CLLC_HAL_setupADC(void)
                  CLLC_VPRIM_ADC_PIN,
                  CLLC_VPRIM_ADC_ACQPS_SYS_CLKS);
 
-    #if CLLC_OVERSAMPLING_ENABLED == 1
+    #if CLLC_ADC_OVERSAMPLE > 1
         ADC_setupSOC(CLLC_VPRIM_ADC_MODULE,
                      CLLC_VPRIM_ADC_SOC_NO_2,
                      CLLC_VPRIM_ADC_TRIG_SOURCE_2,
@@ -947,88 +1178,18 @@ void CLLC_HAL_setupADC(void)
 
 
     //
-    //VSEC
+    //VSEC, the same as ISEC
     //
-    ADC_setupSOC(CLLC_VSEC_ADC_MODULE,
-                 CLLC_VSEC_ADC_SOC_NO_1,
-                 CLLC_VSEC_ADC_TRIG_SOURCE_1,
-                 CLLC_VSEC_ADC_PIN,
-                 CLLC_VSEC_ADC_ACQPS_SYS_CLKS);
-
-    #if CLLC_OVERSAMPLING_ENABLED == 1
-
-        ADC_setupSOC(CLLC_VSEC_ADC_MODULE,
-                     CLLC_VSEC_ADC_SOC_NO_2,
-                     CLLC_VSEC_ADC_TRIG_SOURCE_1,
-                     CLLC_VSEC_ADC_PIN,
-                     CLLC_VSEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_VSEC_ADC_MODULE,
-                     CLLC_VSEC_ADC_SOC_NO_2,
-                     CLLC_VSEC_ADC_TRIG_SOURCE_1,
-                     CLLC_VSEC_ADC_PIN,
-                     CLLC_VSEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_VSEC_ADC_MODULE,
-                     CLLC_VSEC_ADC_SOC_NO_3,
-                     CLLC_VSEC_ADC_TRIG_SOURCE_1,
-                     CLLC_VSEC_ADC_PIN,
-                     CLLC_VSEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_VSEC_ADC_MODULE,
-                     CLLC_VSEC_ADC_SOC_NO_4,
-                     CLLC_VSEC_ADC_TRIG_SOURCE_1,
-                     CLLC_VSEC_ADC_PIN,
-                     CLLC_VSEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_VSEC_ADC_MODULE,
-                     CLLC_VSEC_ADC_SOC_NO_5,
-                     CLLC_VSEC_ADC_TRIG_SOURCE_1,
-                     CLLC_VSEC_ADC_PIN,
-                     CLLC_VSEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_VSEC_ADC_MODULE,
-                     CLLC_VSEC_ADC_SOC_NO_6,
-                     CLLC_VSEC_ADC_TRIG_SOURCE_1,
-                     CLLC_VSEC_ADC_PIN,
-                     CLLC_VSEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_VSEC_ADC_MODULE,
-                     CLLC_VSEC_ADC_SOC_NO_7,
-                     CLLC_VSEC_ADC_TRIG_SOURCE_2,
-                     CLLC_VSEC_ADC_PIN,
-                     CLLC_VSEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_VSEC_ADC_MODULE,
-                     CLLC_VSEC_ADC_SOC_NO_8,
-                     CLLC_VSEC_ADC_TRIG_SOURCE_2,
-                     CLLC_VSEC_ADC_PIN,
-                     CLLC_VSEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_VSEC_ADC_MODULE,
-                     CLLC_VSEC_ADC_SOC_NO_9,
-                     CLLC_VSEC_ADC_TRIG_SOURCE_2,
-                     CLLC_VSEC_ADC_PIN,
-                     CLLC_VSEC_ADC_ACQPS_SYS_CLKS);
-
-        ADC_setupSOC(CLLC_VSEC_ADC_MODULE,
-                     CLLC_VSEC_ADC_SOC_NO_10,
-                     CLLC_VSEC_ADC_TRIG_SOURCE_2,
-                     CLLC_VSEC_ADC_PIN,
-                     CLLC_VSEC_ADC_ACQPS_SYS_CLKS);
-
+    for(i = 0; i < CLLC_ADC_OVERSAMPLE; i++)
+    {
         ADC_setupSOC(CLLC_VSEC_ADC_MODULE,
-                     CLLC_VSEC_ADC_SOC_NO_11,
-                     CLLC_VSEC_ADC_TRIG_SOURCE_2,
+                     (ADC_SOCNumber)(CLLC_VSEC_ADC_SOC_NO_1 + i),
+                     (i < CLLC_HAL_OVERSAMPLE_TRIG1_SOCS) ?
+                             CLLC_VSEC_ADC_TRIG_SOURCE_1 :
+                             CLLC_VSEC_ADC_TRIG_SOURCE_2,
                      CLLC_VSEC_ADC_PIN,
                      CLLC_VSEC_ADC_ACQPS_SYS_CLKS);
-
-//        ADC_setupSOC(CLLC_VSEC_ADC_MODULE,
-//                     CLLC_VSEC_ADC_SOC_NO_12,
-//                     CLLC_VSEC_ADC_TRIG_SOURCE_2,
-//                     CLLC_VSEC_ADC_PIN,
-//                     CLLC_VSEC_ADC_ACQPS_SYS_CLKS);
-    #endif
+    }
 
     //
     // IPRIM
@@ -1039,6 +1200,17 @@ void CLLC_HAL_setupADC(void)
                  CLLC_IPRIM_ADC_PIN,
                  CLLC_IPRIM_ADC_ACQPS_SYS_CLKS);
 
+#if CLLC_PHASES > 1
+    //
+    // ISEC of phase 1
+    //
+    ADC_setupSOC(CLLC_PHASE1_ISEC_ADC_MODULE,
+                 CLLC_PHASE1_ISEC_ADC_SOC_NO,
+                 CLLC_ISEC_ADC_TRIG_SOURCE_1,
+                 CLLC_PHASE1_ISEC_ADC_PIN,
+                 CLLC_ISEC_ADC_ACQPS_SYS_CLKS);
+#endif
+
     //
     // setup another slow ADC conversion for ISR3 trigger
     //
@@ -1048,6 +1220,39 @@ void CLLC_HAL_setupADC(void)
                  CLLC_VSEC_ADC_PIN,
                  CLLC_VSEC_ADC_ACQPS_SYS_CLKS);
 
+#if CLLC_ADC_CALIBRATION == 1
+    //
+    // a PPB on the SOC ISR2 reads of each signal, its zero is set by
+    // CLLC_setupADCCalibration
+    //
+    ADC_setupPPB(CLLC_IPRIM_ADC_MODULE, CLLC_IPRIM_ADC_PPB,
+                 CLLC_IPRIM_ADC_SOC_NO);
+    ADC_setupPPB(CLLC_ISEC_ADC_MODULE, CLLC_ISEC_ADC_PPB,
+                 CLLC_ISEC_ADC_SOC_NO_1);
+    ADC_setupPPB(CLLC_VPRIM_ADC_MODULE, CLLC_VPRIM_ADC_PPB,
+                 CLLC_VPRIM_ADC_SOC_NO_1);
+    ADC_setupPPB(CLLC_VSEC_ADC_MODULE, CLLC_VSEC_ADC_PPB,
+                 CLLC_VSEC_ADC_SOC_NO_1);
+#endif
+
+#if CLLC_ADC_OVERSAMPLE > 1
+    DMA_initController();
+    DMA_setEmulationMode(DMA_EMULATION_FREE_RUN);
+    CLLC_HAL_setupOversampleDMA(CLLC_ISEC_ADC_MODULE,
+                                CLLC_ISEC_ADCRESULTREGBASE,
+                                CLLC_ISEC_ADC_SOC_NO_1,
+                                CLLC_ISEC_OVERSAMPLE_ADC_INT,
+                                CLLC_ISEC_OVERSAMPLE_DMA_BASE,
+                                CLLC_ISEC_OVERSAMPLE_DMA_TRIG,
+                                CLLC_HAL_iSecOversample);
+    CLLC_HAL_setupOversampleDMA(CLLC_VSEC_ADC_MODULE,
+                                CLLC_VSEC_ADCRESULTREGBASE,
+                                CLLC_VSEC_ADC_SOC_NO_1,
+                                CLLC_VSEC_OVERSAMPLE_ADC_INT,
+                                CLLC_VSEC_OVERSAMPLE_DMA_BASE,
+                                CLLC_VSEC_OVERSAMPLE_DMA_TRIG,
+                                CLLC_HAL_vSecOversample);
+#endif
 }
 
 void CLLC_HAL_setupProfilingGPIO(void)
@@ -1072,8 +1277,252 @@ void CLLC_HAL_setupProfilingGPIO(void)
 #endif
 }
 
+#if CLLC_TELEMETRY_ENABLE == 1
+//
+// SCI for the telemetry stream, transmit only, 8N1 with the FIFO. The
+// transmit FIFO interrupt stays disabled until the first frame is queued.
+//
+void CLLC_HAL_setupTelemetrySCI(void)
+{
+    GPIO_setPinConfig(CLLC_TELEMETRY_SCITX_GPIO_PIN_CONFIG);
+
+    SCI_performSoftwareReset(CLLC_TELEMETRY_SCI_BASE);
+    SCI_setConfig(CLLC_TELEMETRY_SCI_BASE, CLLC_SCI_VBUS_CLK,
+                  CLLC_TELEMETRY_SCI_BAUDRATE,
+                  (SCI_CONFIG_WLEN_8 | SCI_CONFIG_STOP_ONE |
+                   SCI_CONFIG_PAR_NONE));
+
+    SCI_enableFIFO(CLLC_TELEMETRY_SCI_BASE);
+    SCI_resetTxFIFO(CLLC_TELEMETRY_SCI_BASE);
+    SCI_setFIFOInterruptLevel(CLLC_TELEMETRY_SCI_BASE,
+                              CLLC_HAL_TELEMETRY_TX_LEVEL, SCI_FIFO_RX16);
+    SCI_disableInterrupt(CLLC_TELEMETRY_SCI_BASE, SCI_INT_TXFF);
+    SCI_clearInterruptStatus(CLLC_TELEMETRY_SCI_BASE, SCI_INT_TXFF);
+
+    SCI_enableModule(CLLC_TELEMETRY_SCI_BASE);
+    SCI_disableRxModule(CLLC_TELEMETRY_SCI_BASE);
+    SCI_performSoftwareReset(CLLC_TELEMETRY_SCI_BASE);
+}
+#endif
+
+#if CLLC_FSI_ENABLE == 1
+//
+// FSI link, one lane each way, n-word frames of the sample length out and
+// of the setpoint length in. Polled, no FSI interrupt.
+//
+void CLLC_HAL_setupFSI(void)
+{
+    GPIO_setPinConfig(CLLC_FSI_TX_D0_PIN_CONFIG);
+    GPIO_setPinConfig(CLLC_FSI_TX_CLK_PIN_CONFIG);
+    GPIO_setPinConfig(CLLC_FSI_RX_D0_PIN_CONFIG);
+    GPIO_setPinConfig(CLLC_FSI_RX_CLK_PIN_CONFIG);
+    GPIO_setQualificationMode(CLLC_FSI_RX_D0_GPIO, GPIO_QUAL_ASYNC);
+    GPIO_setQualificationMode(CLLC_FSI_RX_CLK_GPIO, GPIO_QUAL_ASYNC);
+
+    FSI_performTxInitialization(CLLC_FSI_TX_BASE, CLLC_FSI_PRESCALER);
+    FSI_setTxDataWidth(CLLC_FSI_TX_BASE, FSI_DATA_WIDTH_1_LANE);
+    FSI_setTxFrameType(CLLC_FSI_TX_BASE, FSI_FRAME_TYPE_NWORD_DATA);
+#if CLLC_SHARE_ROLE == CLLC_SHARE_NONE
+    FSI_setTxSoftwareFrameSize(CLLC_FSI_TX_BASE, CLLC_FSILINK_SAMPLE_WORDS);
+#else
+    FSI_setTxSoftwareFrameSize(CLLC_FSI_TX_BASE, CLLC_FSILINK_SHARE_WORDS);
+#endif
+
+    FSI_performRxInitialization(CLLC_FSI_RX_BASE);
+    FSI_setRxDataWidth(CLLC_FSI_RX_BASE, FSI_DATA_WIDTH_1_LANE);
+#if CLLC_SHARE_ROLE == CLLC_SHARE_FOLLOWER
+    FSI_setRxSoftwareFrameSize(CLLC_FSI_RX_BASE, CLLC_FSILINK_SHARE_WORDS);
+#else
+    FSI_setRxSoftwareFrameSize(CLLC_FSI_RX_BASE,
+                               CLLC_FSILINK_SETPOINT_WORDS);
+#endif
+    FSI_setRxBufferPtr(CLLC_FSI_RX_BASE, 0);
+    FSI_clearRxEvents(CLLC_FSI_RX_BASE, FSI_RX_EVTMASK);
+}
+#endif
+
+#if CLLC_CAN_ENABLE == 1
+//
+// MCAN for the CAN-FD service, message RAM as laid out in cllc_canlink.h:
+// one dedicated transmit buffer per report, receive FIFO 0 for the
+// commands, 64 byte elements. One range filter lets the two command
+// identifiers into the FIFO, every other frame is rejected. Polled, no MCAN
+// interrupt. At 2 Mbit/s the transceiver loop delay stays well ahead of
+// the data phase sample point, no delay compensation.
+//
+void CLLC_HAL_setupMCAN(void)
+{
+    MCAN_InitParams initParams = {0};
+    MCAN_ConfigParams configParams = {0};
+    MCAN_MsgRAMConfigParams ramParams = {0};
+    MCAN_BitTimingParams bitTimes = {0};
+    MCAN_StdMsgIDFilterElement filter = {0};
+
+    GPIO_setPinConfig(CLLC_CAN_TX_PIN_CONFIG);
+    GPIO_setPinConfig(CLLC_CAN_RX_PIN_CONFIG);
+    GPIO_setQualificationMode(CLLC_CAN_RX_GPIO, GPIO_QUAL_ASYNC);
+
+    SysCtl_setMCANClk(SYSCTL_MCANCLK_DIV_1);
+    MCAN_selectClockSource(CLLC_CAN_BASE, MCAN_CLOCK_SOURCE_SYS);
+
+    while(MCAN_isMemInitDone(CLLC_CAN_BASE) == 0U)
+    {
+    }
+
+    MCAN_setOpMode(CLLC_CAN_BASE, MCAN_OPERATION_MODE_SW_INIT);
+    while(MCAN_getOpMode(CLLC_CAN_BASE) != MCAN_OPERATION_MODE_SW_INIT)
+    {
+    }
+
+    initParams.fdMode = 1U;
+    initParams.brsEnable = 1U;
+    initParams.wdcPreload = 0xFFU;
+    MCAN_init(CLLC_CAN_BASE, &initParams);
+
+    configParams.filterConfig.rrfe = 1U;
+    configParams.filterConfig.rrfs = 1U;
+    configParams.filterConfig.anfe = 2U;
+    configParams.filterConfig.anfs = 2U;
+    MCAN_config(CLLC_CAN_BASE, &configParams);
+
+    bitTimes.nomRatePrescalar = CLLC_CAN_NOM_PRESCALER;
+    bitTimes.nomTimeSeg1 = CLLC_CAN_NOM_TSEG1;
+    bitTimes.nomTimeSeg2 = CLLC_CAN_NOM_TSEG2;
+    bitTimes.nomSynchJumpWidth = CLLC_CAN_NOM_SJW;
+    bitTimes.dataRatePrescalar = CLLC_CAN_DATA_PRESCALER;
+    bitTimes.dataTimeSeg1 = CLLC_CAN_DATA_TSEG1;
+    bitTimes.dataTimeSeg2 = CLLC_CAN_DATA_TSEG2;
+    bitTimes.dataSynchJumpWidth = CLLC_CAN_DATA_SJW;
+    MCAN_setBitTime(CLLC_CAN_BASE, &bitTimes);
+
+    ramParams.flssa = CLLC_CANLINK_RAM_FILTER;
+    ramParams.lss = 1U;
+    ramParams.txStartAddr = CLLC_CANLINK_RAM_TX_BUFFERS;
+    ramParams.txBufNum = CLLC_CANLINK_REPORTS;
+    ramParams.txBufElemSize = MCAN_ELEM_SIZE_64BYTES;
+    ramParams.rxFIFO0startAddr = CLLC_CANLINK_RAM_RX_FIFO;
+    ramParams.rxFIFO0size = CLLC_CANLINK_RX_FIFO_SIZE;
+    ramParams.rxFIFO0OpMode = 0U;
+    ramParams.rxFIFO0ElemSize = MCAN_ELEM_SIZE_64BYTES;
+    MCAN_msgRAMConfig(CLLC_CAN_BASE, &ramParams);
+
+    filter.sfid1 = CLLC_CAN_BASE_ID + CLLC_CANLINK_ID_SETPOINT;
+    filter.sfid2 = CLLC_CAN_BASE_ID + CLLC_CANLINK_ID_ENABLE;
+    filter.sfec = MCAN_STDFILTEC_FIFO0;
+    filter.sft = MCAN_STDFILT_RANGE;
+    MCAN_addStdMsgIDFilter(CLLC_CAN_BASE, 0U, &filter);
+
+    MCAN_setOpMode(CLLC_CAN_BASE, MCAN_OPERATION_MODE_NORMAL);
+    while(MCAN_getOpMode(CLLC_CAN_BASE) != MCAN_OPERATION_MODE_NORMAL)
+    {
+    }
+}
+#endif
+
+#if CLLC_PROFILING == CLLC_PROFILING_ERAD
+//
+// One ISR: the counter counts CPU cycles from the fetch of the first
+// instruction of the ISR to the write of its exit mark
+//
+static void CLLC_HAL_setupERADISRCounter(uint32_t entryBusCompBase,
+                                         uint32_t exitBusCompBase,
+                                         uint32_t counterBase,
+                                         uint32_t isrAddress,
+                                         uint32_t exitMarkAddress)
+{
+    ERAD_BusComp_Config busComp;
+    ERAD_Counter_Config counter;
+
+    busComp.mask = 0;
+    busComp.comp_mode = ERAD_BUSCOMP_COMPMODE_EQ;
+    busComp.enable_int = false;
+    busComp.enable_stop = false;
+
+    busComp.reference = isrAddress;
+    busComp.bus_sel = ERAD_BUSCOMP_BUS_VPC;
+    ERAD_configBusComp(entryBusCompBase, busComp);
+
+    busComp.reference = exitMarkAddress;
+    busComp.bus_sel = ERAD_BUSCOMP_BUS_DWAB;
+    ERAD_configBusComp(exitBusCompBase, busComp);
+
+    counter.event = ERAD_EVENT_NO_EVENT;
+    counter.event_mode = ERAD_COUNTER_MODE_ACTIVE;
+    counter.reference = 0xFFFFFFFFUL;
+    counter.rst_on_match = false;
+    counter.enable_int = false;
+    counter.enable_stop = false;
+    ERAD_configCounterInStartStopMode(counterBase, counter,
+                (ERAD_Counter_Input_Event)
+                ERAD_BUSCOMP_BASE_TO_EVENT(entryBusCompBase),
+                (ERAD_Counter_Input_Event)
+                ERAD_BUSCOMP_BASE_TO_EVENT(exitBusCompBase));
+}
+
+//
+// ERAD profiling of the ISRs running on the C28x, the CLA is not seen by
+// the ERAD. The debugger must not own the ERAD, a session that sets
+// hardware breakpoints takes it back.
+//
+void CLLC_HAL_setupERADProfiler(uint16_t powerFlow)
+{
+    uint32_t instances = 0;
+
+    ERAD_initModule(ERAD_OWNER_APPLICATION);
+
+#if CLLC_ISR1_RUNNING_ON == C28x_CORE
+    CLLC_HAL_setupERADISRCounter(CLLC_ISR1_ERAD_ENTRY_BUSCOMP_BASE,
+                                 CLLC_ISR1_ERAD_EXIT_BUSCOMP_BASE,
+                                 CLLC_ISR1_ERAD_COUNTER_BASE,
+                                 (uint32_t)&CLLC_ISR1,
+                                 (uint32_t)&CLLC_HAL_isrExitMark[
+                                                    CLLC_PROFILER_ISR1]);
+    instances |= ERAD_getBusCompInstance(CLLC_ISR1_ERAD_ENTRY_BUSCOMP_BASE) |
+                 ERAD_getBusCompInstance(CLLC_ISR1_ERAD_EXIT_BUSCOMP_BASE) |
+                 ERAD_getCounterInstance(CLLC_ISR1_ERAD_COUNTER_BASE);
+#endif
+
+#if CLLC_ISR2_RUNNING_ON == C28x_CORE
+    CLLC_HAL_setupERADISRCounter(CLLC_ISR2_ERAD_ENTRY_BUSCOMP_BASE,
+                                 CLLC_ISR2_ERAD_EXIT_BUSCOMP_BASE,
+                                 CLLC_ISR2_ERAD_COUNTER_BASE,
+                                 (powerFlow == CLLC_POWER_FLOW_SEC_PRIM) ?
+                                 (uint32_t)&CLLC_ISR2_secToPrimPowerFlow :
+                                 (uint32_t)&CLLC_ISR2_primToSecPowerFlow,
+                                 (uint32_t)&CLLC_HAL_isrExitMark[
+                                                    CLLC_PROFILER_ISR2]);
+    instances |= ERAD_getBusCompInstance(CLLC_ISR2_ERAD_ENTRY_BUSCOMP_BASE) |
+                 ERAD_getBusCompInstance(CLLC_ISR2_ERAD_EXIT_BUSCOMP_BASE) |
+                 ERAD_getCounterInstance(CLLC_ISR2_ERAD_COUNTER_BASE);
+#endif
+
+    CLLC_HAL_setupERADISRCounter(CLLC_ISR3_ERAD_ENTRY_BUSCOMP_BASE,
+                                 CLLC_ISR3_ERAD_EXIT_BUSCOMP_BASE,
+                                 CLLC_ISR3_ERAD_COUNTER_BASE,
+                                 (uint32_t)&CLLC_ISR3,
+                                 (uint32_t)&CLLC_HAL_isrExitMark[
+                                                    CLLC_PROFILER_ISR3]);
+    instances |= ERAD_getBusCompInstance(CLLC_ISR3_ERAD_ENTRY_BUSCOMP_BASE) |
+                 ERAD_getBusCompInstance(CLLC_ISR3_ERAD_EXIT_BUSCOMP_BASE) |
+                 ERAD_getCounterInstance(CLLC_ISR3_ERAD_COUNTER_BASE);
+
+    CLLC_PROFILER_init(&CLLC_PROFILER_channel[CLLC_PROFILER_ISR1],
+                       CLLC_ISR1_PROFILER_LATENCY_SHIFT,
+                       CLLC_ISR1_PROFILER_EXECUTION_SHIFT);
+    CLLC_PROFILER_init(&CLLC_PROFILER_channel[CLLC_PROFILER_ISR2],
+                       CLLC_ISR2_PROFILER_LATENCY_SHIFT,
+                       CLLC_ISR2_PROFILER_EXECUTION_SHIFT);
+    CLLC_PROFILER_init(&CLLC_PROFILER_channel[CLLC_PROFILER_ISR3],
+                       CLLC_ISR3_PROFILER_LATENCY_SHIFT,
+                       CLLC_ISR3_PROFILER_EXECUTION_SHIFT);
+
+    ERAD_enableModules((uint16_t)instances);
+}
+#endif
+
 void CLLC_HAL_setupTrigForADC()
 {
+#if CLLC_PHASES == 1
     //
     //PWM module is used to trigger the SOC in this application
     //As control is carried out in ISR2,
@@ -1103,6 +1552,7 @@ void CLLC_HAL_setupTrigForADC()
     //
     EPWM_enableADCTrigger(CLLC_ISR2_PWM_BASE,
                           EPWM_SOC_A);
+#endif
 
     //
     // for the faster signals such as shunt current sense, the PWM time base of
@@ -1249,10 +1699,12 @@ void CLLC_HAL_setupBoardProtection()
     GPIO_setDirectionMode(CLLC_GANFAULTn_GPIO, GPIO_DIR_MODE_IN);
     GPIO_setQualificationMode(CLLC_GANFAULTn_GPIO, GPIO_QUAL_6SAMPLE);
     GPIO_setPinConfig(CLLC_GANFAULTn_GPIO_PIN_CONFIG);
-    GPIO_setPadConfig(CLLC_GANFAULTn_XBAR_BASE, GPIO_PIN_TYPE_STD);
+    GPIO_setPadConfig(CLLC_GANFAULTn_GPIO, GPIO_PIN_TYPE_STD);
 
-    XBAR_setInputPin(CLLC_GANFAULTn_XBAR_BASE, GANFAULTn_XBAR_INPUT, GANFAULTn_GPIO);
-    EPWM_clearOneShotTripZoneFlag(CLLC_PRIM_LEG1_PWM_BASE, GANFAULTn_EPWM_FLAG);
+    XBAR_setInputPin(CLLC_GANFAULTn_XBAR_BASE, CLLC_GANFAULTn_XBAR_INPUT,
+                     CLLC_GANFAULTn_GPIO);
+    EPWM_clearOneShotTripZoneFlag(CLLC_PRIM_LEG1_PWM_BASE,
+                                  CLLC_GANFAULTn_EPWM_FLAG);
 
     //
     // Enable the OSHT TZ2 trip
@@ -1982,3 +2434,19 @@ void CLLC_HAL_toggleLED1(void)
     }
 
 }
+
+//
+// Clocks of the background scheduler frames, the cycles since the last
+// overflow of the task A and task B CPU timers
+//
+uint32_t CLLC_HAL_getTaskAElapsedCycles(void)
+{
+    return(HWREG(CLLC_TASKA_CPUTIMER_BASE + CPUTIMER_O_PRD) -
+           CPUTimer_getTimerCount(CLLC_TASKA_CPUTIMER_BASE));
+}
+
+uint32_t CLLC_HAL_getTaskBElapsedCycles(void)
+{
+    return(HWREG(CLLC_TASKB_CPUTIMER_BASE + CPUTIMER_O_PRD) -
+           CPUTimer_getTimerCount(CLLC_TASKB_CPUTIMER_BASE));
+}
@@ -27,6 +27,18 @@ extern "C" {
 #include "driverlib.h"
 #include "device.h"
 #include "cllc_settings.h"
+#if CLLC_PHASES > 1
+#include "cllc_phase.h"
+#endif
+#ifndef __TMS320C28XX_CLA__
+#include "cllc_profiler.h"
+#if CLLC_FSI_ENABLE == 1
+#include "cllc_fsilink.h"
+#endif
+#if CLLC_CAN_ENABLE == 1
+#include "cllc_canlink.h"
+#endif
+#endif
 //
 // the function prototypes
 //
@@ -34,6 +46,10 @@ void CLLC_HAL_setupDevice(void);
 void CLLC_HAL_disablePWMClkCounting(void);
 void CLLC_HAL_enablePWMClkCounting(void);
 void CLLC_HAL_setupPWM(uint16_t powerFlowDir);
+void CLLC_HAL_setupGlobalLoad(void);
+#if CLLC_PHASES > 1
+void CLLC_HAL_setupPhasePWM(const CLLC_PHASE_Instance *phase);
+#endif
 void CLLC_HAL_setupCMPSSHighLowLimit(uint32_t base1,
                                  float32_t currentLimit,
                                  float32_t currentMaxSense,
@@ -55,6 +71,7 @@ void CLLC_HAL_setupPWMinUpDownCountMode(uint32_t base1,
 void CLLC_HAL_setupPWMpins(uint16_t mode);
 void CLLC_HAL_setupADC(void);
 void CLLC_HAL_setupProfilingGPIO(void);
+void CLLC_HAL_setupERADProfiler(uint16_t powerFlow);
 void CLLC_HAL_setupSynchronousRectificationAction(uint16_t powerFlow);
 void CLLC_HAL_setupSynchronousRectificationActionDebug(uint16_t powerFlow);
 void CLLC_HAL_setupBoardProtection(void);
@@ -63,7 +80,13 @@ void CLLC_HAL_setupTrigForADC(void);
 void CLLC_HAL_setupECAPinPWMMode(uint32_t base1,
                             float32_t pwmFreq_Hz,
                             float32_t pwmSysClkFreq_Hz);
+void CLLC_HAL_initCLAMessageRAM(void);
 void CLLC_HAL_setupCLA(void);
+void CLLC_HAL_setupTelemetrySCI(void);
+void CLLC_HAL_setupFSI(void);
+void CLLC_HAL_setupMCAN(void);
+uint32_t CLLC_HAL_getTaskAElapsedCycles(void);
+uint32_t CLLC_HAL_getTaskBElapsedCycles(void);
 
 //
 //CLA C Tasks defined in Cla1Tasks_C.cla
@@ -84,6 +107,27 @@ extern uint16_t Cla1ProgRunStart;
 extern uint16_t Cla1ProgRunEnd;
 extern uint16_t Cla1ProgRunSize;
 
+//
+// written on the exit of the ISRs, the writes stop the ERAD counters
+//
+extern volatile uint16_t CLLC_HAL_isrExitMark[3];
+
+#if (CLLC_ADC_OVERSAMPLE != 1) && (CLLC_ADC_OVERSAMPLE != 2) &&              \
+    (CLLC_ADC_OVERSAMPLE != 4) && (CLLC_ADC_OVERSAMPLE != 8) &&              \
+    (CLLC_ADC_OVERSAMPLE != 11)
+#error "CLLC_ADC_OVERSAMPLE is 1, 2, 4, 8 or 11"
+#endif
+
+#if CLLC_ADC_OVERSAMPLE > 1
+//
+// ISEC and VSEC results of the oversampling SOCs, the DMA copies them in one
+// burst per switching period once the last SOC has converted, into the two
+// halves in turn (CLLC_HAL_setupOversampleDMA)
+//
+extern volatile uint16_t CLLC_HAL_iSecOversample[2 * CLLC_ADC_OVERSAMPLE];
+extern volatile uint16_t CLLC_HAL_vSecOversample[2 * CLLC_ADC_OVERSAMPLE];
+#endif
+
 //
 // ISR related
 //
@@ -103,7 +147,7 @@ extern uint16_t Cla1ProgRunSize;
 
 #endif
 
-#if ISR2_RUNNING_ON == C28x_CORE
+#if CLLC_ISR2_RUNNING_ON == C28x_CORE
 
 #ifndef __TMS320C28XX_CLA__
     #pragma CODE_SECTION(CLLC_ISR2_primToSecPowerFlow,"isrcodefuncs");
@@ -136,9 +180,76 @@ extern uint16_t Cla1ProgRunSize;
     interrupt void CLLC_ISR3(void);
 #endif
 
+#if CLLC_TELEMETRY_ENABLE == 1
+#ifndef __TMS320C28XX_CLA__
+    #pragma CODE_SECTION(CLLC_telemetryISR,"ramfuncs");
+    interrupt void CLLC_telemetryISR(void);
+#endif
+#endif
+
+#if CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_EVENT
+#ifndef __TMS320C28XX_CLA__
+    #pragma CODE_SECTION(CLLC_tripEventISR,"ramfuncs");
+    interrupt void CLLC_tripEventISR(void);
+#endif
+#endif
+
 //
 // Inline functions
 //
+#if CLLC_ADC_OVERSAMPLE > 1
+//
+// The sum of the half of result the DMA wrote last. The bursts run off the
+// PWM and ISR2 off the ECAP, so a burst may be under way while ISR2 reads.
+// The active destination address of the channel tells the halves apart:
+// from the start of the second half up to its end the first half is whole,
+// otherwise the second half is. The DMA comes back to a half one switching
+// period later, 2.5 us at the most, far longer than the reads take.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_sumOversample)
+static inline uint32_t CLLC_HAL_sumOversample(uint32_t dmaBase,
+                                              const volatile uint16_t *result)
+{
+    uint32_t written = HWREG(dmaBase + DMA_O_DST_ADDR_ACTIVE) -
+                       (uint32_t)(uintptr_t)result;
+    uint32_t sum = 0;
+    uint16_t i;
+
+    if((written - CLLC_ADC_OVERSAMPLE) >= CLLC_ADC_OVERSAMPLE)
+    {
+        result += CLLC_ADC_OVERSAMPLE;
+    }
+
+    for(i = 0; i < CLLC_ADC_OVERSAMPLE; i++)
+    {
+        sum += result[i];
+    }
+
+    return(sum);
+}
+#endif
+
+#if CLLC_ADC_CALIBRATION == 1
+//
+// zero code of a signal, its PPB takes it off every result
+//
+static inline void CLLC_HAL_setADCZero(uint32_t adcBase, ADC_PPBNumber ppb,
+                                       uint16_t zero)
+{
+    ADC_setPPBReferenceOffset(adcBase, ppb, zero);
+}
+
+//
+// bridges off, every board trip and the start up hold PRIM LEG1 in the
+// one-shot trip
+//
+static inline uint16_t CLLC_HAL_isPowerStageTripped(void)
+{
+    return(((EPWM_getTripZoneFlagStatus(CLLC_PRIM_LEG1_PWM_BASE) &
+             EPWM_TZ_FLAG_OST) != 0U) ? 1U : 0U);
+}
+#endif
+
 #pragma FUNC_ALWAYS_INLINE(CLLC_HAL_readTripFlags)
 static inline int16_t CLLC_HAL_readTripFlags(void)
 {
@@ -268,6 +379,35 @@ static inline void CLLC_HAL_updatePWMDutyPeriodPhaseShift(
 
     EDIS;
 }
+
+//
+// With CLLC_GLOBAL_LOAD_ENABLED the registers written above are shadows, one
+// latch on PRIM LEG1 reaches all four PWMs through the GLDCTL2 link and they
+// take the new set together at the next zero of PRIM LEG1
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_commitPWMUpdate)
+static inline void CLLC_HAL_commitPWMUpdate(void)
+{
+    EPWM_setGlobalLoadOneShotLatch(CLLC_PRIM_LEG1_PWM_BASE);
+}
+
+//
+// ISR2 runs asynchronous to the PWM. The one-shot latch of the last commit
+// may still be pending, GLDCTL2.OSHTLD reads 0 on the device so it cannot
+// be checked, and a zero of PRIM LEG1 between the writes would then load a
+// half written set. The window is open when that zero is at least
+// CLLC_PWM_UPDATE_GUARD_TICKS away, the length of the writes: counting up
+// it is a whole down ramp away, counting down TBCTR ticks. A pending latch
+// then loads either the last set or the new one whole.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_isPWMUpdateWindowOpen)
+static inline uint16_t CLLC_HAL_isPWMUpdateWindowOpen(void)
+{
+    return((EPWM_getTimeBaseCounterDirection(CLLC_PRIM_LEG1_PWM_BASE) ==
+            EPWM_TIME_BASE_STATUS_COUNT_UP) ||
+           (EPWM_getTimeBaseCounterValue(CLLC_PRIM_LEG1_PWM_BASE) >
+            CLLC_PWM_UPDATE_GUARD_TICKS));
+}
 #pragma FUNC_ALWAYS_INLINE(CLLC_HAL_updatePWMDeadBandPrim)
 static inline void CLLC_HAL_updatePWMDeadBandPrim(uint32_t dbRED_ticks,
                                 uint32_t dbFED_ticks)
@@ -283,65 +423,287 @@ static inline void CLLC_HAL_updatePWMDeadBandPrim(uint32_t dbRED_ticks,
 #pragma FUNC_ALWAYS_INLINE(CLLC_HAL_setProfilingGPIO1)
 static inline void CLLC_HAL_setProfilingGPIO1(void)
 {
+#if CLLC_PROFILING == CLLC_PROFILING_GPIO
     #pragma diag_suppress = 770
     #pragma diag_suppress = 173
     HWREG(GPIODATA_BASE + CLLC_GPIO_PROFILING1_SET_REG) =
                                               CLLC_GPIO_PROFILING1_SET;
     #pragma diag_warning = 770
     #pragma diag_warning = 173
+#endif
 }
 
 #pragma FUNC_ALWAYS_INLINE(CLLC_HAL_resetProfilingGPIO1)
 static inline void CLLC_HAL_resetProfilingGPIO1(void)
 {
+#if CLLC_PROFILING == CLLC_PROFILING_GPIO
     #pragma diag_suppress = 770
     #pragma diag_suppress = 173
     HWREG(GPIODATA_BASE + CLLC_GPIO_PROFILING1_CLEAR_REG) =
                                                   CLLC_GPIO_PROFILING1_CLEAR;
     #pragma diag_warning = 770
     #pragma diag_warning = 173
+#endif
 }
 
 static inline void CLLC_HAL_setProfilingGPIO2(void)
 {
+#if CLLC_PROFILING == CLLC_PROFILING_GPIO
     #pragma diag_suppress = 770
     #pragma diag_suppress = 173
     HWREG(GPIODATA_BASE  +  CLLC_GPIO_PROFILING2_SET_REG ) =
                                                  CLLC_GPIO_PROFILING2_SET;
     #pragma diag_warning = 770
     #pragma diag_warning = 173
+#endif
 }
 
 static inline void CLLC_HAL_resetProfilingGPIO2(void)
 {
+#if CLLC_PROFILING == CLLC_PROFILING_GPIO
     #pragma diag_suppress = 770
     #pragma diag_suppress = 173
     HWREG(GPIODATA_BASE  +  CLLC_GPIO_PROFILING2_CLEAR_REG ) =
                                                  CLLC_GPIO_PROFILING2_CLEAR;
     #pragma diag_warning = 770
     #pragma diag_warning = 173
+#endif
 }
 
 static inline void CLLC_HAL_setProfilingGPIO3(void)
 {
+#if CLLC_PROFILING == CLLC_PROFILING_GPIO
     #pragma diag_suppress = 770
     #pragma diag_suppress = 173
     HWREG(GPIODATA_BASE  +  CLLC_GPIO_PROFILING3_SET_REG ) =
                                                  CLLC_GPIO_PROFILING3_SET;
     #pragma diag_warning = 770
     #pragma diag_warning = 173
+#endif
 }
 
 static inline void CLLC_HAL_resetProfilingGPIO3(void)
 {
+#if CLLC_PROFILING == CLLC_PROFILING_GPIO
     #pragma diag_suppress = 770
     #pragma diag_suppress = 173
     HWREG(GPIODATA_BASE  +  CLLC_GPIO_PROFILING3_CLEAR_REG ) =
                                                  CLLC_GPIO_PROFILING3_CLEAR;
     #pragma diag_warning = 770
     #pragma diag_warning = 173
+#endif
+}
+
+#ifndef __TMS320C28XX_CLA__
+//
+// ERAD profiling. The latency is read from the time base of the trigger
+// at the entry of the ISR, in SYSCLK cycles as the EPWM, ECAP and CPU timer
+// run undivided. ISR1 is triggered by CMPC of PRIM LEG1 counting up,
+// ISR2 by the period of the ECAP in APWM mode, which restarts from 0,
+// and ISR3 by the ADC conversion started at the zero of the CPU timer, so
+// its latency holds the conversion. The execution cycles run from the first
+// instruction of the ISR to the write of its exit mark and hold the ISRs
+// that preempt it. The count is read after the write, the few cycles the
+// stop takes to reach the counter are the same on every run.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_getISR1LatencyCycles)
+static inline uint32_t CLLC_HAL_getISR1LatencyCycles(void)
+{
+    uint16_t counter = EPWM_getTimeBaseCounterValue(
+                                    CLLC_ISR1_PERIPHERAL_TRIG_BASE);
+    uint16_t compare = EPWM_getCounterCompareValue(
+                                    CLLC_ISR1_PERIPHERAL_TRIG_BASE,
+                                    EPWM_COUNTER_COMPARE_C);
+
+    if(EPWM_getTimeBaseCounterDirection(CLLC_ISR1_PERIPHERAL_TRIG_BASE) ==
+       EPWM_TIME_BASE_STATUS_COUNT_UP)
+    {
+        return((uint32_t)counter - compare);
+    }
+    else
+    {
+        return((2UL * EPWM_getTimeBasePeriod(CLLC_ISR1_PERIPHERAL_TRIG_BASE))
+               - compare - counter);
+    }
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_getISR2LatencyCycles)
+static inline uint32_t CLLC_HAL_getISR2LatencyCycles(void)
+{
+    return(ECAP_getTimeBaseCounter(CLLC_ISR2_ECAP_BASE));
 }
 
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_getISR3LatencyCycles)
+static inline uint32_t CLLC_HAL_getISR3LatencyCycles(void)
+{
+    return(HWREG(CLLC_ISR3_TIMEBASE + CPUTIMER_O_PRD) -
+           CPUTimer_getTimerCount(CLLC_ISR3_TIMEBASE));
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_startERADProfilingISR1)
+static inline void CLLC_HAL_startERADProfilingISR1(void)
+{
+#if CLLC_PROFILING == CLLC_PROFILING_ERAD
+    CLLC_PROFILER_enter(&CLLC_PROFILER_channel[CLLC_PROFILER_ISR1],
+                        CLLC_HAL_getISR1LatencyCycles());
+#endif
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_stopERADProfilingISR1)
+static inline void CLLC_HAL_stopERADProfilingISR1(void)
+{
+#if CLLC_PROFILING == CLLC_PROFILING_ERAD
+    CLLC_HAL_isrExitMark[CLLC_PROFILER_ISR1] = 1;
+    CLLC_PROFILER_exit(&CLLC_PROFILER_channel[CLLC_PROFILER_ISR1],
+                       ERAD_getCurrentCount(CLLC_ISR1_ERAD_COUNTER_BASE));
+#endif
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_startERADProfilingISR2)
+static inline void CLLC_HAL_startERADProfilingISR2(void)
+{
+#if CLLC_PROFILING == CLLC_PROFILING_ERAD
+    CLLC_PROFILER_enter(&CLLC_PROFILER_channel[CLLC_PROFILER_ISR2],
+                        CLLC_HAL_getISR2LatencyCycles());
+#endif
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_stopERADProfilingISR2)
+static inline void CLLC_HAL_stopERADProfilingISR2(void)
+{
+#if CLLC_PROFILING == CLLC_PROFILING_ERAD
+    CLLC_HAL_isrExitMark[CLLC_PROFILER_ISR2] = 1;
+    CLLC_PROFILER_exit(&CLLC_PROFILER_channel[CLLC_PROFILER_ISR2],
+                       ERAD_getCurrentCount(CLLC_ISR2_ERAD_COUNTER_BASE));
+#endif
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_startERADProfilingISR3)
+static inline void CLLC_HAL_startERADProfilingISR3(void)
+{
+#if CLLC_PROFILING == CLLC_PROFILING_ERAD
+    CLLC_PROFILER_enter(&CLLC_PROFILER_channel[CLLC_PROFILER_ISR3],
+                        CLLC_HAL_getISR3LatencyCycles());
+#endif
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_stopERADProfilingISR3)
+static inline void CLLC_HAL_stopERADProfilingISR3(void)
+{
+#if CLLC_PROFILING == CLLC_PROFILING_ERAD
+    CLLC_HAL_isrExitMark[CLLC_PROFILER_ISR3] = 1;
+    CLLC_PROFILER_exit(&CLLC_PROFILER_channel[CLLC_PROFILER_ISR3],
+                       ERAD_getCurrentCount(CLLC_ISR3_ERAD_COUNTER_BASE));
+#endif
+}
+#endif
+
+#ifndef __TMS320C28XX_CLA__
+//
+// Telemetry SCI. The transmit FIFO interrupt fires while the FIFO holds no
+// more than CLLC_HAL_TELEMETRY_TX_LEVEL bytes and is only enabled while the
+// ring has bytes for it: ISR3 enables it after queuing a frame, the
+// telemetry ISR disables it with interrupts off once the ring is empty. An
+// enable racing the disable costs one interrupt that finds nothing to send.
+//
+#define CLLC_HAL_TELEMETRY_TX_LEVEL     SCI_FIFO_TX4
+#define CLLC_HAL_TELEMETRY_TX_FIFO_SIZE 16U
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_getTelemetryTxSpace)
+static inline uint16_t CLLC_HAL_getTelemetryTxSpace(void)
+{
+    return(CLLC_HAL_TELEMETRY_TX_FIFO_SIZE -
+           (uint16_t)SCI_getTxFIFOStatus(CLLC_TELEMETRY_SCI_BASE));
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_writeTelemetryTx)
+static inline void CLLC_HAL_writeTelemetryTx(const uint16_t *bytes,
+                                             uint16_t count)
+{
+    uint16_t i;
+
+    for(i = 0; i < count; i++)
+    {
+        HWREGH(CLLC_TELEMETRY_SCI_BASE + SCI_O_TXBUF) = bytes[i];
+    }
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_enableTelemetryTxInterrupt)
+static inline void CLLC_HAL_enableTelemetryTxInterrupt(void)
+{
+    HWREGH(CLLC_TELEMETRY_SCI_BASE + SCI_O_FFTX) |= SCI_FFTX_TXFFIENA;
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_disableTelemetryTxInterrupt)
+static inline void CLLC_HAL_disableTelemetryTxInterrupt(void)
+{
+    HWREGH(CLLC_TELEMETRY_SCI_BASE + SCI_O_FFTX) &= ~SCI_FFTX_TXFFIENA;
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_clearTelemetryInterruptFlag)
+static inline void CLLC_HAL_clearTelemetryInterruptFlag(void)
+{
+    HWREGH(CLLC_TELEMETRY_SCI_BASE + SCI_O_FFTX) |= SCI_FFTX_TXFFINTCLR;
+    Interrupt_clearACKGroup(CLLC_TELEMETRY_PIE_GROUP);
+}
+#endif
+
+#if (CLLC_FSI_ENABLE == 1) && !defined(__TMS320C28XX_CLA__)
+//
+// FSI link. Each frame is written from buffer word 0 and read from buffer
+// word 0, the pointers loaded back to 0 for it. The transmitter is done
+// with a sample frame well before the next ISR2 run, see
+// cllc_user_settings.h, so ISR2 starts one without checking.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_writeFSITxFrame)
+static inline void CLLC_HAL_writeFSITxFrame(uint16_t tag, uint16_t userData,
+                                            const uint16_t *words,
+                                            uint16_t count)
+{
+    uint16_t i;
+
+    FSI_setTxBufferPtr(CLLC_FSI_TX_BASE, 0);
+    for(i = 0; i < count; i++)
+    {
+        HWREGH(CLLC_FSI_TX_BASE + FSI_O_TX_BUF_BASE(i)) = words[i];
+    }
+    HWREGH(CLLC_FSI_TX_BASE + FSI_O_TX_FRAME_TAG_UDATA) =
+            (userData << FSI_TX_FRAME_TAG_UDATA_USER_DATA_S) |
+            (tag << FSI_TX_FRAME_TAG_UDATA_FRAME_TAG_S);
+    HWREGH(CLLC_FSI_TX_BASE + FSI_O_TX_FRAME_CTRL) |= FSI_TX_FRAME_CTRL_START;
+}
+
+//
+// The FSI_RX_EVT_ flags raised since they were last cleared
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_getFSIRxEvents)
+static inline uint16_t CLLC_HAL_getFSIRxEvents(void)
+{
+    return(FSI_getRxEventStatus(CLLC_FSI_RX_BASE));
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_readFSIRxFrame)
+static inline void CLLC_HAL_readFSIRxFrame(uint16_t *tag, uint16_t *userData,
+                                           uint16_t *words, uint16_t count)
+{
+    uint16_t i;
+
+    for(i = 0; i < count; i++)
+    {
+        words[i] = HWREGH(CLLC_FSI_RX_BASE + FSI_O_RX_BUF_BASE(i));
+    }
+    *tag = FSI_getRxFrameTag(CLLC_FSI_RX_BASE);
+    *userData = FSI_getRxUserDefinedData(CLLC_FSI_RX_BASE);
+    FSI_setRxBufferPtr(CLLC_FSI_RX_BASE, 0);
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_clearFSIRxEvents)
+static inline void CLLC_HAL_clearFSIRxEvents(uint16_t events)
+{
+    FSI_clearRxEvents(CLLC_FSI_RX_BASE, events);
+}
+#endif
+
 #pragma FUNC_ALWAYS_INLINE(CLLC_HAL_clearISR1PeripheralInterruptFlag)
 static inline void CLLC_HAL_clearISR1PeripheralInterruptFlag()
 {
@@ -361,25 +723,46 @@ static inline void CLLC_HAL_clearISR3PeripheralInterruptFlag()
     ADC_clearInterruptStatus(CLLC_ISR3_PERIPHERAL_TRIG_BASE, ADC_INT_NUMBER2);
 }
 
-#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_setupISR1Trigger)
-static inline void CLLC_HAL_setupISR1Trigger(float32_t freq)
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_getISR1TriggerTicks)
+static inline uint16_t CLLC_HAL_getISR1TriggerTicks(float32_t freq)
 {
     //
-    // below sets up the ISR trigger for ISR1
+    // below calculates the ISR trigger for ISR1
     // ISR is triggered right before period value by a compare C match
     // as latency on C28x and CLA is different, for CLA a -20 is used
     // for C28x -27 is used based in GPIO toggle orbserved on the oscilloscope
     //
     #if CLLC_ISR1_RUNNING_ON == CLA_CORE
-        EPWM_setCounterCompareValue(CLLC_ISR1_PERIPHERAL_TRIG_BASE,
-                                       EPWM_COUNTER_COMPARE_C,
-         ((TICKS_IN_PWM_FREQUENCY(freq, CLLC_PWMSYSCLOCK_FREQ_HZ) >> 1) - 20));
+        return((uint16_t)((TICKS_IN_PWM_FREQUENCY(freq,
+                                    CLLC_PWMSYSCLOCK_FREQ_HZ) >> 1) - 20));
     #else
-        EPWM_setCounterCompareValue(CLLC_ISR1_PERIPHERAL_TRIG_BASE,
-                                       EPWM_COUNTER_COMPARE_C,
-         ((TICKS_IN_PWM_FREQUENCY(freq, CLLC_PWMSYSCLOCK_FREQ_HZ) >> 1) - 27));
+        return((uint16_t)((TICKS_IN_PWM_FREQUENCY(freq,
+                                    CLLC_PWMSYSCLOCK_FREQ_HZ) >> 1) - 27));
     #endif
+}
 
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_setISR1TriggerTicks)
+static inline void CLLC_HAL_setISR1TriggerTicks(uint16_t ticks)
+{
+    EPWM_setCounterCompareValue(CLLC_ISR1_PERIPHERAL_TRIG_BASE,
+                                EPWM_COUNTER_COMPARE_C, ticks);
+}
+
+//
+// ISR1 parks CMPC at 0xFFFF once it ran, until then the trigger is pending
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_isISR1TriggerPending)
+static inline uint16_t CLLC_HAL_isISR1TriggerPending(void)
+{
+    return((EPWM_getCounterCompareValue(CLLC_ISR1_PERIPHERAL_TRIG_BASE,
+                                        EPWM_COUNTER_COMPARE_C) !=
+            0xFFFFU) ? 1U : 0U);
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_setupISR1Trigger)
+static inline void CLLC_HAL_setupISR1Trigger(float32_t freq)
+{
+    CLLC_HAL_setISR1TriggerTicks(CLLC_HAL_getISR1TriggerTicks(freq));
 }
 
 #ifndef __TMS320C28XX_CLA__
@@ -401,6 +784,13 @@ static inline void CLLC_HAL_clearISR3InterruputFlag()
     Interrupt_clearACKGroup(CLLC_ISR3_PIE_GROUP);
 }
 
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_clearTripEventInterruptFlag)
+static inline void CLLC_HAL_clearTripEventInterruptFlag(void)
+{
+    EPWM_clearTripZoneFlag(CLLC_TRIP_EVENT_PWM_BASE, EPWM_TZ_INTERRUPT);
+    Interrupt_clearACKGroup(CLLC_TRIP_EVENT_PIE_GROUP);
+}
+
 #pragma FUNC_ALWAYS_INLINE(CLLC_HAL_setupInterrupt)
 static inline void CLLC_HAL_setupInterrupt(uint16_t powerFlow)
 {
@@ -410,12 +800,17 @@ static inline void CLLC_HAL_setupInterrupt(uint16_t powerFlow)
     #endif
 
 
+    //
+    // ISR2 commits the PWM update itself, ISR1 stays off
+    //
+    #if CLLC_PWM_UPDATE_MODE != CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD
     EPWM_setInterruptSource(CLLC_ISR1_PERIPHERAL_TRIG_BASE,
                             EPWM_INT_TBCTR_U_CMPC);
     CLLC_HAL_setupISR1Trigger(CLLC_MIN_PWM_SWITCHING_FREQUENCY_HZ * 0.8);
     EPWM_setInterruptEventCount(CLLC_ISR1_PERIPHERAL_TRIG_BASE, 1);
     EPWM_clearEventTriggerInterruptFlag(CLLC_ISR1_PERIPHERAL_TRIG_BASE);
     EPWM_enableInterrupt(CLLC_ISR1_PERIPHERAL_TRIG_BASE);
+    #endif
 
 
     //
@@ -439,15 +834,18 @@ static inline void CLLC_HAL_setupInterrupt(uint16_t powerFlow)
     //Note the ISR1 is enabled in the PIE, though the peripheral interrupt is
     //not triggered until later
     //
-    #if CLLC_ISR1_RUNNING_ON == C28x_CORE
+    #if CLLC_ISR1_RUNNING_ON == C28x_CORE && \
+        CLLC_PWM_UPDATE_MODE != CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD
         Interrupt_register(CLLC_ISR1_TRIG, &CLLC_ISR1);
         CLLC_HAL_clearISR1InterruputFlag();
         Interrupt_enable(CLLC_ISR1_TRIG);
     #endif
 
-        //
-        //Still needed by TTPLPFC ISR2 code, do not disable when CLLLC is running on CLA
-        //
+    //
+    // with ISR2 on the CLA the ECAP interrupt triggers the CLA background
+    // task, it is not taken by the C28x
+    //
+    #if CLLC_ISR2_RUNNING_ON == C28x_CORE
         if(powerFlow == CLLC_POWER_FLOW_SEC_PRIM)
         {
             Interrupt_register(CLLC_ISR2_TRIG, &CLLC_ISR2_secToPrimPowerFlow);
@@ -458,11 +856,32 @@ static inline void CLLC_HAL_setupInterrupt(uint16_t powerFlow)
         }
         CLLC_HAL_clearISR2InterruputFlag();
         Interrupt_enable(CLLC_ISR2_TRIG);
+    #endif
 
 
     Interrupt_register(CLLC_ISR3_TRIG, &CLLC_ISR3);
     Interrupt_enable(CLLC_ISR3_TRIG);
 
+    //
+    // the SCI transmit FIFO interrupt is enabled by the first frame queued
+    //
+    #if CLLC_TELEMETRY_ENABLE == 1
+        Interrupt_register(CLLC_TELEMETRY_TRIG, &CLLC_telemetryISR);
+        Interrupt_enable(CLLC_TELEMETRY_TRIG);
+    #endif
+
+    //
+    // the board trips decoded on the one-shot trip of PRIM LEG1, not by
+    // ISR2. The interrupt flag only sets on an enabled trip, so it is clear
+    // here and the one-shot trips forced before leave it clear.
+    //
+    #if CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_EVENT
+        EPWM_enableTripZoneInterrupt(CLLC_TRIP_EVENT_PWM_BASE,
+                                     EPWM_TZ_INTERRUPT_OST);
+        Interrupt_register(CLLC_TRIP_EVENT_TRIG, &CLLC_tripEventISR);
+        Interrupt_enable(CLLC_TRIP_EVENT_TRIG);
+    #endif
+
     EALLOW;
     //
     // Enable Global interrupt INTM
@@ -501,6 +920,55 @@ static inline void CLLC_HAL_forcePWMOneShotTrip(uint32_t base)
 {
     EPWM_forceTripZoneEvent(base, EPWM_TZ_FORCE_EVENT_OST);
 }
+
+#if CLLC_PHASES > 1
+//
+// The registers ISR2 writes for a phase after phase 0, shadows committed
+// with those of phase 0. PRIM LEG2 takes CMPA and CMPB through its link, the
+// period and the sec compares come from phase 0 through theirs.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_updatePhasePWM)
+static inline void CLLC_HAL_updatePhasePWM(const CLLC_PHASE_Instance *phase)
+{
+    EALLOW;
+    HWREG(phase->primLeg1Base + HRPWM_O_CMPA) = phase->dutyAPrim_ticks;
+    HWREG(phase->primLeg1Base + HRPWM_O_CMPB) = phase->dutyBPrim_ticks;
+
+    HWREG(phase->primLeg1Base + EPWM_O_TBPHS) = phase->primPhase_ticks;
+    HWREG(phase->primLeg2Base + EPWM_O_TBPHS) = phase->primPhase_ticks;
+    HWREG(phase->secLeg1Base + EPWM_O_TBPHS) = phase->secPhase_ticks;
+    HWREG(phase->secLeg2Base + EPWM_O_TBPHS) = phase->secPhase_ticks;
+    EDIS;
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_HAL_readPhaseISec)
+static inline uint16_t CLLC_HAL_readPhaseISec(const CLLC_PHASE_Instance *phase)
+{
+    return(HWREGH(phase->iSecResultBase + ADC_RESULTx_OFFSET_BASE +
+                  phase->iSecSOC));
+}
+
+//
+// A phase after phase 0 is held in the one-shot trip while phase 0
+// precharges the output and let go once it is done
+//
+static inline void CLLC_HAL_holdPhase(const CLLC_PHASE_Instance *phase)
+{
+    CLLC_HAL_forcePWMOneShotTrip(phase->primLeg1Base);
+    CLLC_HAL_forcePWMOneShotTrip(phase->primLeg2Base);
+    CLLC_HAL_forcePWMOneShotTrip(phase->secLeg1Base);
+    CLLC_HAL_forcePWMOneShotTrip(phase->secLeg2Base);
+}
+
+static inline void CLLC_HAL_releasePhase(const CLLC_PHASE_Instance *phase)
+{
+    CLLC_HAL_clearPWMTripFlags(phase->primLeg1Base);
+    CLLC_HAL_clearPWMTripFlags(phase->primLeg2Base);
+    CLLC_HAL_clearPWMTripFlags(phase->secLeg1Base);
+    CLLC_HAL_clearPWMTripFlags(phase->secLeg2Base);
+}
+#endif
+
 #ifdef __cplusplus
 }
 #endif                                  /* extern "C" */
@@ -0,0 +1,194 @@
+//#############################################################################
+//
+// FILE:   cllc_phase.h
+//
+// TITLE:  Interleaved CLLC phases run from one MCU
+//         Each phase is one instance, the state ISR2 works on in the order
+//         it uses it and then the peripherals the phase is bound to. The
+//         instances sit in one array, ISR2 walks it once per step, so the
+//         cost of a phase is the same for each and adds up linearly.
+//
+//         The phases share the bus, the output and the voltage or current
+//         loop, which drives the period of all of them. Phase 0 is the stage
+//         on the CLLC_PRIM/SEC_LEGx PWMs and its registers are written as
+//         before, the other phases follow it with
+//             TBPHS = TBPRD * index / phases
+//         a shift of 1 / (2 * phases) of the switching period, so the ripple
+//         of the rectified output currents, at twice the switching frequency,
+//         cancels.
+//
+//         The currents are shared by trimming the duty of the prim legs down
+//         from 50%, which only lowers the gain of a phase. Every ISR2 the
+//         trim of each phase integrates its current above the mean of the
+//         phases, then the smallest trim is taken off all of them, so the
+//         phase that carries the least runs untrimmed.
+//
+//#############################################################################
+
+#ifndef CLLC_PHASE_H
+#define CLLC_PHASE_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "cllc_settings.h"
+
+//
+// typedefs
+//
+typedef struct
+{
+    //
+    // ISR2, in the order it is used
+    //
+    float32_t iSecSensed_pu;
+    float32_t dutyTrim_pu;          // taken off the duty factor of the prim
+    uint32_t dutyAPrim_ticks;
+    uint32_t dutyBPrim_ticks;
+    uint32_t primPhase_ticks;       // TBPHS of the prim legs
+    uint32_t secPhase_ticks;        // TBPHS of the sec legs
+    float32_t interleave_pu;        // index / phases, of TBPRD
+
+    //
+    // bindings, set once by CLLC_setupPhases
+    //
+    uint32_t primLeg1Base;
+    uint32_t primLeg2Base;
+    uint32_t secLeg1Base;
+    uint32_t secLeg2Base;
+    uint32_t iSecResultBase;
+    uint16_t iSecSOC;
+    uint16_t index;
+} CLLC_PHASE_Instance;
+
+//
+// Inline functions
+//
+
+//
+// Binds a phase to its PWMs and ISEC result, the state starts untrimmed
+//
+static inline void CLLC_PHASE_init(CLLC_PHASE_Instance *phase,
+                                   uint16_t index, uint16_t phases,
+                                   uint32_t primLeg1Base,
+                                   uint32_t primLeg2Base,
+                                   uint32_t secLeg1Base,
+                                   uint32_t secLeg2Base,
+                                   uint32_t iSecResultBase,
+                                   uint16_t iSecSOC)
+{
+    phase->iSecSensed_pu = 0.0f;
+    phase->dutyTrim_pu = 0.0f;
+    phase->dutyAPrim_ticks = 0;
+    phase->dutyBPrim_ticks = 0;
+    phase->primPhase_ticks = 0;
+    phase->secPhase_ticks = 0;
+    phase->interleave_pu = (float32_t)index / (float32_t)phases;
+
+    phase->primLeg1Base = primLeg1Base;
+    phase->primLeg2Base = primLeg2Base;
+    phase->secLeg1Base = secLeg1Base;
+    phase->secLeg2Base = secLeg2Base;
+    phase->iSecResultBase = iSecResultBase;
+    phase->iSecSOC = iSecSOC;
+    phase->index = index;
+}
+
+//
+// The trims of the phases from their currents, see the top of the file.
+// Returns 1 if a trim changed and the PWMs need an update.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_PHASE_share)
+static inline uint16_t CLLC_PHASE_share(CLLC_PHASE_Instance *phase,
+                                        uint16_t phases,
+                                        float32_t phasesInv,
+                                        float32_t ki,
+                                        float32_t trimMax_pu)
+{
+    float32_t mean_pu = 0.0f;
+    float32_t trim_pu;
+    float32_t trimMin_pu;
+    uint16_t changed = 0;
+    uint16_t i;
+
+    for(i = 0; i < phases; i++)
+    {
+        mean_pu += phase[i].iSecSensed_pu;
+    }
+    mean_pu = mean_pu * phasesInv;
+
+    //
+    // the trims integrate unclamped, only their differences matter
+    //
+    trimMin_pu = phase[0].dutyTrim_pu + ki * (phase[0].iSecSensed_pu - mean_pu);
+    for(i = 1; i < phases; i++)
+    {
+        trim_pu = phase[i].dutyTrim_pu +
+                  ki * (phase[i].iSecSensed_pu - mean_pu);
+        trimMin_pu = (trim_pu < trimMin_pu) ? trim_pu : trimMin_pu;
+    }
+
+    //
+    // then the least is taken off all of them and the others clamped
+    //
+    for(i = 0; i < phases; i++)
+    {
+        trim_pu = phase[i].dutyTrim_pu +
+                  ki * (phase[i].iSecSensed_pu - mean_pu) - trimMin_pu;
+        trim_pu = (trim_pu > trimMax_pu) ? trimMax_pu : trim_pu;
+        changed |= (trim_pu != phase[i].dutyTrim_pu) ? 1U : 0U;
+        phase[i].dutyTrim_pu = trim_pu;
+    }
+
+    return(changed);
+}
+
+//
+// The ticks of the phases from those of phase 0, the same expressions as
+// CLLC_calculatePWMDutyPeriodPhaseShiftTicks_primToSecPowerFlow
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_PHASE_calculateTicks)
+static inline void CLLC_PHASE_calculateTicks(CLLC_PHASE_Instance *phase,
+                                             uint16_t phases,
+                                             uint32_t period_ticks,
+                                             float32_t dutyAPrimFactor,
+                                             uint32_t phaseShiftPrimSec_ticks)
+{
+    uint16_t i;
+
+    for(i = 0; i < phases; i++)
+    {
+        phase[i].dutyBPrim_ticks = (uint32_t)((float32_t)period_ticks *
+                                              (dutyAPrimFactor +
+                                               phase[i].dutyTrim_pu));
+
+        //
+        // the errata in HRPWM, as for phase 0
+        //
+        phase[i].dutyAPrim_ticks = phase[i].dutyBPrim_ticks;
+        if((phase[i].dutyAPrim_ticks & 0x00FF00) == 0)
+        {
+            phase[i].dutyAPrim_ticks = phase[i].dutyAPrim_ticks | 0x000100;
+        }
+
+        //
+        // TBPHS has no hi-res part that follows the sync, whole counts only
+        //
+        phase[i].primPhase_ticks =
+                ((uint32_t)((float32_t)(period_ticks >> 16) *
+                            phase[i].interleave_pu)) << 16;
+        phase[i].secPhase_ticks = phase[i].primPhase_ticks +
+                                  phaseShiftPrimSec_ticks;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
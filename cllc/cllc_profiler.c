@@ -0,0 +1,127 @@
+//#############################################################################
+//
+// FILE:   cllc_profiler.c
+//
+// TITLE:  ISR profiler histograms, reset and the summaries read out in the
+//         background, see cllc_profiler.h
+//
+//#############################################################################
+
+//*****************************************************************************
+// the includes
+//*****************************************************************************
+
+#include <math.h>
+#include "cllc_settings.h"
+#include "cllc_profiler.h"
+
+CLLC_PROFILER_Channel CLLC_PROFILER_channel[CLLC_PROFILER_CHANNELS];
+
+void CLLC_PROFILER_resetHistogram(CLLC_PROFILER_Histogram *histogram)
+{
+    uint16_t i;
+
+    histogram->count = 0;
+    histogram->min = 0xFFFFFFFFUL;
+    histogram->max = 0;
+    histogram->sum = 0;
+    histogram->sumSquared = 0;
+
+    for(i = 0; i < CLLC_PROFILER_BINS; i++)
+    {
+        histogram->bin[i] = 0;
+    }
+}
+
+//
+// Before the ISRs are enabled, the shifts set the bin widths of the channel
+//
+void CLLC_PROFILER_init(CLLC_PROFILER_Channel *channel,
+                        uint16_t latencyShift, uint16_t executionShift)
+{
+    channel->latency.shift = latencyShift;
+    channel->execution.shift = executionShift;
+    CLLC_PROFILER_resetHistogram(&channel->latency);
+    CLLC_PROFILER_resetHistogram(&channel->execution);
+    channel->resetRequest = 0;
+    channel->resetCount = 0;
+}
+
+//
+// The ISR of the channel clears its histograms on its next run
+//
+void CLLC_PROFILER_requestReset(CLLC_PROFILER_Channel *channel)
+{
+    channel->resetRequest = channel->resetCount + 1U;
+}
+
+//
+// Upper edge of the bin in which the runs reach fraction of the count, the
+// maximum if that is the last bin. 0 for an empty histogram.
+//
+uint32_t CLLC_PROFILER_getPercentile(const CLLC_PROFILER_Histogram *histogram,
+                                     float32_t fraction)
+{
+    uint32_t target, total;
+    uint16_t i;
+
+    if(histogram->count == 0U)
+    {
+        return(0);
+    }
+
+    target = (uint32_t)ceilf(fraction * (float32_t)histogram->count);
+    if(target == 0U)
+    {
+        target = 1;
+    }
+
+    total = 0;
+    for(i = 0; i < (CLLC_PROFILER_BINS - 1U); i++)
+    {
+        total += histogram->bin[i];
+        if(total >= target)
+        {
+            return((((uint32_t)i + 1U) << histogram->shift) - 1U);
+        }
+    }
+
+    return(histogram->max);
+}
+
+void CLLC_PROFILER_getSummary(const CLLC_PROFILER_Histogram *histogram,
+                              CLLC_PROFILER_Summary *summary)
+{
+    float64_t mean, variance;
+
+    summary->count = histogram->count;
+    summary->overflow = histogram->bin[CLLC_PROFILER_BINS - 1U];
+
+    if(histogram->count == 0U)
+    {
+        summary->min = 0;
+        summary->max = 0;
+        summary->mean = 0;
+        summary->standardDeviation = 0;
+        summary->p50 = 0;
+        summary->p99 = 0;
+        summary->p999 = 0;
+        return;
+    }
+
+    //
+    // in 64 bits, the spread is small against the mean
+    //
+    mean = (float64_t)histogram->sum / (float64_t)histogram->count;
+    variance = ((float64_t)histogram->sumSquared /
+                (float64_t)histogram->count) - (mean * mean);
+
+    summary->min = histogram->min;
+    summary->max = histogram->max;
+    summary->mean = (float32_t)mean;
+    summary->standardDeviation = (variance > 0.0) ?
+                                 (float32_t)sqrt(variance) : 0.0f;
+    summary->p50 = CLLC_PROFILER_getPercentile(histogram, 0.5f);
+    summary->p99 = CLLC_PROFILER_getPercentile(histogram, 0.99f);
+    summary->p999 = CLLC_PROFILER_getPercentile(histogram, 0.999f);
+}
@@ -0,0 +1,170 @@
+//#############################################################################
+//
+// FILE:   cllc_profiler.h
+//
+// TITLE:  ISR profiler, histograms of the entry latency and the execution
+//         cycles of CLLC_ISR1, CLLC_ISR2_* and CLLC_ISR3
+//         The ISRs hand in one latency and one execution count per run,
+//         the cycles come from the ERAD counters and the trigger time bases
+//         (CLLC_HAL_setupERADProfiler). This file only bins them.
+//
+//         Each histogram has CLLC_PROFILER_BINS bins of 2^shift cycles from
+//         0, the last bin also takes everything above it. Next to the bins
+//         it keeps the count, minimum, maximum, sum and sum of squares, so
+//         mean and jitter come out exact whatever the bin width.
+//
+//         One ISR writes one channel and nothing else does, a reset asked
+//         for from the background or the watch window is carried out by the
+//         ISR on its next run (CLLC_PROFILER_requestReset).
+//
+//#############################################################################
+
+#ifndef CLLC_PROFILER_H
+#define CLLC_PROFILER_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "cllc_settings.h"
+
+//
+// Defines
+//
+#define CLLC_PROFILER_BINS          32U
+
+#define CLLC_PROFILER_ISR1          0U
+#define CLLC_PROFILER_ISR2          1U
+#define CLLC_PROFILER_ISR3          2U
+#define CLLC_PROFILER_CHANNELS      3U
+
+//
+// typedefs
+//
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint64_t sumSquared;        // holds 2^24 runs of up to 2^20 cycles
+    uint16_t shift;             // bin width 2^shift cycles
+    uint32_t bin[CLLC_PROFILER_BINS];
+} CLLC_PROFILER_Histogram;
+
+typedef struct
+{
+    CLLC_PROFILER_Histogram latency;
+    CLLC_PROFILER_Histogram execution;
+    uint32_t entryLatency;      // of the run in progress
+    uint16_t resetRequest;      // written by the background, see above
+    uint16_t resetCount;        // written by the ISR
+} CLLC_PROFILER_Channel;
+
+//
+// worked out in the background from a histogram
+//
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    float32_t mean;
+    float32_t standardDeviation;
+    uint32_t p50;               // upper edge of the bin holding the percentile
+    uint32_t p99;
+    uint32_t p999;
+    uint32_t overflow;          // runs in the last bin
+} CLLC_PROFILER_Summary;
+
+//
+// the globals
+//
+extern CLLC_PROFILER_Channel CLLC_PROFILER_channel[CLLC_PROFILER_CHANNELS];
+
+//
+// the function prototypes
+//
+void CLLC_PROFILER_init(CLLC_PROFILER_Channel *channel,
+                        uint16_t latencyShift, uint16_t executionShift);
+void CLLC_PROFILER_resetHistogram(CLLC_PROFILER_Histogram *histogram);
+void CLLC_PROFILER_requestReset(CLLC_PROFILER_Channel *channel);
+void CLLC_PROFILER_getSummary(const CLLC_PROFILER_Histogram *histogram,
+                              CLLC_PROFILER_Summary *summary);
+uint32_t CLLC_PROFILER_getPercentile(const CLLC_PROFILER_Histogram *histogram,
+                                     float32_t fraction);
+
+//
+// Add one run to a histogram, no divide and no loop
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_PROFILER_addToHistogram)
+static inline void CLLC_PROFILER_addToHistogram(
+                        CLLC_PROFILER_Histogram *histogram, uint32_t cycles)
+{
+    uint32_t bin = cycles >> histogram->shift;
+
+    if(bin > (CLLC_PROFILER_BINS - 1U))
+    {
+        bin = CLLC_PROFILER_BINS - 1U;
+    }
+    histogram->bin[bin]++;
+
+    if(cycles < histogram->min)
+    {
+        histogram->min = cycles;
+    }
+    if(cycles > histogram->max)
+    {
+        histogram->max = cycles;
+    }
+
+    histogram->count++;
+    histogram->sum += cycles;
+    histogram->sumSquared += (uint64_t)cycles * cycles;
+}
+
+//
+// One run of the ISR of the channel
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_PROFILER_record)
+static inline void CLLC_PROFILER_record(CLLC_PROFILER_Channel *channel,
+                                        uint32_t latencyCycles,
+                                        uint32_t executionCycles)
+{
+    if(channel->resetRequest != channel->resetCount)
+    {
+        CLLC_PROFILER_resetHistogram(&channel->latency);
+        CLLC_PROFILER_resetHistogram(&channel->execution);
+        channel->resetCount = channel->resetRequest;
+    }
+
+    CLLC_PROFILER_addToHistogram(&channel->latency, latencyCycles);
+    CLLC_PROFILER_addToHistogram(&channel->execution, executionCycles);
+}
+
+//
+// Called by the ISR of the channel on its entry and exit
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_PROFILER_enter)
+static inline void CLLC_PROFILER_enter(CLLC_PROFILER_Channel *channel,
+                                       uint32_t latencyCycles)
+{
+    channel->entryLatency = latencyCycles;
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_PROFILER_exit)
+static inline void CLLC_PROFILER_exit(CLLC_PROFILER_Channel *channel,
+                                      uint32_t executionCycles)
+{
+    CLLC_PROFILER_record(channel, channel->entryLatency, executionCycles);
+}
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
@@ -0,0 +1,218 @@
+//#############################################################################
+//
+// FILE:   cllc_scheduler.h
+//
+// TITLE:  Time triggered scheduler of the background tasks
+//         Two frames, A and B, each ticked by a timer of its own (CPU
+//         timers 0 and 1 on the device). The background loop runs a frame
+//         once per tick of its timer, A ahead of B, and the frame runs the
+//         tasks of a static table that are due on that tick, in table order.
+//         A task is due on the ticks of its frame where the tick count
+//         modulo its divider equals its phase, so slow tasks can be spread
+//         over the ticks.
+//
+//         Each frame reads its timer as the cycles since its last tick. The
+//         scheduler takes it ahead of the first task and after every task:
+//         the first read is the start latency of the frame, the difference
+//         between two reads the cycles of a task, ISRs that came in between
+//         included. A read below the one before means the next tick passed
+//         under the task, that frame is counted as an overrun and the
+//         period is added back. Work longer than one period is not told
+//         apart from work of one period less. A task over its budget is
+//         counted against it.
+//
+//         Header only. host/cllc_scheduler_check.c checks it against a
+//         virtual clock.
+//
+//#############################################################################
+
+#ifndef CLLC_SCHEDULER_H
+#define CLLC_SCHEDULER_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+
+//
+// Defines
+//
+#define CLLC_SCHEDULER_FRAME_A          0U
+#define CLLC_SCHEDULER_FRAME_B          1U
+#define CLLC_SCHEDULER_FRAMES           2U
+
+//
+// typedefs
+//
+typedef void (*CLLC_SCHEDULER_Function)(void);
+
+//
+// cycles since the last tick of a frame, 0 to its period - 1
+//
+typedef uint32_t (*CLLC_SCHEDULER_Clock)(void);
+
+typedef struct
+{
+    const char *name;
+    CLLC_SCHEDULER_Function run;
+    uint16_t frame;             // CLLC_SCHEDULER_FRAME_
+    uint16_t divider;           // due every divider ticks of the frame
+    uint16_t phase;             // on the ticks where tick % divider == phase
+    uint32_t budget_cycles;
+} CLLC_SCHEDULER_Task;
+
+typedef struct
+{
+    uint32_t runs;
+    uint32_t lastCycles;
+    uint32_t maxCycles;
+    uint32_t overBudget;        // runs longer than budget_cycles
+} CLLC_SCHEDULER_TaskStats;
+
+typedef struct
+{
+    CLLC_SCHEDULER_Clock getElapsedCycles;
+    uint32_t period_cycles;
+    uint32_t tick;              // ticks run
+    uint32_t lastCycles;        // start latency and tasks of the last tick
+    uint32_t maxLatencyCycles;
+    uint32_t maxCycles;
+    uint32_t overruns;          // ticks that ran into the next one
+} CLLC_SCHEDULER_Frame;
+
+typedef struct
+{
+    const CLLC_SCHEDULER_Task *task;
+    CLLC_SCHEDULER_TaskStats *stats;
+    uint16_t tasks;
+    CLLC_SCHEDULER_Frame frame[CLLC_SCHEDULER_FRAMES];
+} CLLC_SCHEDULER_Scheduler;
+
+//
+// Takes the task table and room for one CLLC_SCHEDULER_TaskStats per task.
+// Returns the number of tasks that can never run: a frame out of range, a
+// divider of 0 or a phase not below the divider. Those are skipped.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_SCHEDULER_config)
+static inline uint16_t CLLC_SCHEDULER_config(CLLC_SCHEDULER_Scheduler *s,
+                                             const CLLC_SCHEDULER_Task *task,
+                                             CLLC_SCHEDULER_TaskStats *stats,
+                                             uint16_t tasks)
+{
+    uint16_t rejected = 0;
+    uint16_t i;
+
+    s->task = task;
+    s->stats = stats;
+    s->tasks = tasks;
+
+    for(i = 0; i < tasks; i++)
+    {
+        stats[i].runs = 0;
+        stats[i].lastCycles = 0;
+        stats[i].maxCycles = 0;
+        stats[i].overBudget = 0;
+
+        if((task[i].frame >= CLLC_SCHEDULER_FRAMES) ||
+           (task[i].divider == 0U) || (task[i].phase >= task[i].divider))
+        {
+            rejected++;
+        }
+    }
+
+    return(rejected);
+}
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_SCHEDULER_configFrame)
+static inline void CLLC_SCHEDULER_configFrame(CLLC_SCHEDULER_Scheduler *s,
+                                         uint16_t frame,
+                                         CLLC_SCHEDULER_Clock getElapsedCycles,
+                                         uint32_t period_cycles)
+{
+    CLLC_SCHEDULER_Frame *f = &s->frame[frame];
+
+    f->getElapsedCycles = getElapsedCycles;
+    f->period_cycles = period_cycles;
+    f->tick = 0;
+    f->lastCycles = 0;
+    f->maxLatencyCycles = 0;
+    f->maxCycles = 0;
+    f->overruns = 0;
+}
+
+//
+// Once per tick of the frame, right after its timer flag is cleared
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_SCHEDULER_runFrame)
+static inline void CLLC_SCHEDULER_runFrame(CLLC_SCHEDULER_Scheduler *s,
+                                           uint16_t frame)
+{
+    CLLC_SCHEDULER_Frame *f = &s->frame[frame];
+    const CLLC_SCHEDULER_Task *task;
+    CLLC_SCHEDULER_TaskStats *stats;
+    uint32_t before, after, cycles, total;
+    uint16_t overrun = 0;
+    uint16_t i;
+
+    before = f->getElapsedCycles();
+    total = before;
+    if(before > f->maxLatencyCycles)
+    {
+        f->maxLatencyCycles = before;
+    }
+
+    for(i = 0; i < s->tasks; i++)
+    {
+        task = &s->task[i];
+        if((task->frame != frame) || (task->divider == 0U) ||
+           ((f->tick % task->divider) != task->phase))
+        {
+            continue;
+        }
+
+        task->run();
+
+        after = f->getElapsedCycles();
+        cycles = after - before;
+        if(after < before)
+        {
+            cycles += f->period_cycles;
+            overrun = 1;
+        }
+        before = after;
+        total += cycles;
+
+        stats = &s->stats[i];
+        stats->runs++;
+        stats->lastCycles = cycles;
+        if(cycles > stats->maxCycles)
+        {
+            stats->maxCycles = cycles;
+        }
+        if(cycles > task->budget_cycles)
+        {
+            stats->overBudget++;
+        }
+    }
+
+    f->lastCycles = total;
+    if(total > f->maxCycles)
+    {
+        f->maxCycles = total;
+    }
+    if(overrun != 0U)
+    {
+        f->overruns++;
+    }
+    f->tick++;
+}
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
@@ -106,6 +106,54 @@ extern "C" {
 #define CLA_CORE 2
 #endif
 
+//
+// PWM UPDATE, how the ticks worked out in ISR2 reach the PWM registers
+// 0 -> ISR1 writes the registers and enables the phase load of the sec legs,
+//      a second ISR1 pass disables it again
+// 1 -> ISR1 writes the shadow registers and commits them with one global
+//      load one-shot, the reload issues the one sync that loads TBPHS
+// 2 -> ISR2 writes the shadow registers and commits them as in 1, no ISR1
+//
+#define CLLC_PWM_UPDATE_ISR1_PHASE_LOAD 0
+#define CLLC_PWM_UPDATE_ISR1_GLOBAL_LOAD 1
+#define CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD 2
+
+//
+// PROFILING of the ISRs
+// 0 -> none
+// 1 -> GPIO, the profiling pins are high while the ISRs run
+// 2 -> ERAD, entry latency and execution cycles of the C28x ISRs are
+//      binned in CLLC_PROFILER_channel, the profiling pins stay free
+//
+#define CLLC_PROFILING_NONE 0
+#define CLLC_PROFILING_GPIO 1
+#define CLLC_PROFILING_ERAD 2
+
+//
+// Trip decoding, the CMPSS and GaN fault trip flags into CLLC_tripFlag, the
+// PWM trip itself is in hardware in all of them
+// 0 -> ISR2, reads the XBAR and trip zone flags every run
+// 1 -> background, a task of scheduler frame A
+// 2 -> event, the trip zone interrupt of PRIM LEG1 latches the cause and
+//      the time of the trip in CLLC_tripEvent, ISR2 does no trip work
+// 1 and 2 need ISR2 on the C28x, on the CLA ISR2 owns CLLC_tripFlag
+//
+#define CLLC_TRIP_DECODE_ISR2 0
+#define CLLC_TRIP_DECODE_BACKGROUND 1
+#define CLLC_TRIP_DECODE_EVENT 2
+
+//
+// Current SHARING of boards in parallel on one bus, cllc_share.h
+// 0 -> none
+// 1 -> master, closes the voltage loop and sends its current as the
+//      reference of the others on the FSI
+// 2 -> follower, trims its voltage reference to carry the current of the
+//      master, the droop alone while the link is down
+//
+#define CLLC_SHARE_NONE 0
+#define CLLC_SHARE_MASTER 1
+#define CLLC_SHARE_FOLLOWER 2
+
 //
 // SFRA Options
 // 0 -> disabled
@@ -136,100 +184,156 @@ extern "C" {
 // 6 -> Open loop check for PWM driver,
 // 7 -> Open loop check for PWM driver with protection,
 // 8 -> Closed loop voltage with resistive load
+// can be overridden on the compiler command line, e.g. -DCLLC_LAB=3, and so
+// can the SFRA type of the lab, e.g. -DCLLC_SFRA_TYPE=2, and the core the
+// control runs on, e.g. -DCLLC_CONTROL_RUNNING_ON=2
 //
 
+#ifndef CLLC_LAB
 #define CLLC_LAB 1
+#endif
 
 #if CLLC_LAB == 1
+#ifndef CLLC_CONTROL_RUNNING_ON
 #define CLLC_CONTROL_RUNNING_ON C28x_CORE
+#endif
 #define CLLC_POWER_FLOW CLLC_POWER_FLOW_PRIM_SEC
 #define CLLC_INCR_BUILD CLLC_OPEN_LOOP_BUILD
 #define CLLC_TEST_SETUP CLLC_TEST_SETUP_RES_LOAD
 #define CLLC_PROTECTION CLLC_PROTECTION_DISABLED
+#ifndef CLLC_SFRA_TYPE
 #define CLLC_SFRA_TYPE  0
+#endif
 #define CLLC_SFRA_AMPLITUDE (float32_t)CLLC_SFRA_INJECTION_AMPLITUDE_LEVEL2
 #endif
 
 #if CLLC_LAB == 2
-#define CLLC_CONTROL_RUNNING_ON 1
+#ifndef CLLC_CONTROL_RUNNING_ON
+#define CLLC_CONTROL_RUNNING_ON C28x_CORE
+#endif
 #define CLLC_POWER_FLOW CLLC_POWER_FLOW_PRIM_SEC
 #define CLLC_INCR_BUILD CLLC_OPEN_LOOP_BUILD
 #define CLLC_TEST_SETUP CLLC_TEST_SETUP_RES_LOAD
 #define CLLC_PROTECTION CLLC_PROTECTION_ENABLED
+#ifndef CLLC_SFRA_TYPE
 #define CLLC_SFRA_TYPE  0
+#endif
 #define CLLC_SFRA_AMPLITUDE (float32_t)CLLC_SFRA_INJECTION_AMPLITUDE_LEVEL2
 #endif
 
 #if CLLC_LAB == 3
-#define CLLC_CONTROL_RUNNING_ON 1
+#ifndef CLLC_CONTROL_RUNNING_ON
+#define CLLC_CONTROL_RUNNING_ON C28x_CORE
+#endif
 #define CLLC_POWER_FLOW CLLC_POWER_FLOW_PRIM_SEC
 #define CLLC_INCR_BUILD CLLC_CLOSED_LOOP_BUILD
 #define CLLC_CONTROL_MODE CLLC_VOLTAGE_MODE
 #define CLLC_TEST_SETUP CLLC_TEST_SETUP_RES_LOAD
 #define CLLC_PROTECTION CLLC_PROTECTION_ENABLED
+#ifndef CLLC_SFRA_TYPE
 #define CLLC_SFRA_TYPE  0
+#endif
 #define CLLC_SFRA_AMPLITUDE (float32_t)CLLC_SFRA_INJECTION_AMPLITUDE_LEVEL1
 #endif
 
 #if CLLC_LAB == 4
-#define CLLC_CONTROL_RUNNING_ON 1
+#ifndef CLLC_CONTROL_RUNNING_ON
+#define CLLC_CONTROL_RUNNING_ON C28x_CORE
+#endif
 #define CLLC_POWER_FLOW CLLC_POWER_FLOW_PRIM_SEC
 #define CLLC_INCR_BUILD CLLC_CLOSED_LOOP_BUILD
 #define CLLC_CONTROL_MODE CLLC_CURRENT_MODE
 #define CLLC_TEST_SETUP CLLC_TEST_SETUP_RES_LOAD
 #define CLLC_PROTECTION CLLC_PROTECTION_ENABLED
+#ifndef CLLC_SFRA_TYPE
 #define CLLC_SFRA_TYPE  0
+#endif
 #define CLLC_SFRA_AMPLITUDE (float32_t)CLLC_SFRA_INJECTION_AMPLITUDE_LEVEL1
 #endif
 
 #if CLLC_LAB == 5
-#define CLLC_CONTROL_RUNNING_ON 1
+#ifndef CLLC_CONTROL_RUNNING_ON
+#define CLLC_CONTROL_RUNNING_ON C28x_CORE
+#endif
 #define CLLC_POWER_FLOW CLLC_POWER_FLOW_PRIM_SEC
 #define CLLC_INCR_BUILD CLLC_CLOSED_LOOP_BUILD
 #define CLLC_CONTROL_MODE CLLC_CURRENT_MODE
 #define CLLC_TEST_SETUP CLLC_TEST_SETUP_EMULATED_BATTERY
 #define CLLC_PROTECTION CLLC_PROTECTION_ENABLED
+#ifndef CLLC_SFRA_TYPE
 #define CLLC_SFRA_TYPE  0
+#endif
 #define CLLC_SFRA_AMPLITUDE (float32_t)CLLC_SFRA_INJECTION_AMPLITUDE_LEVEL1
 #endif
 
 
 #if CLLC_LAB == 6
-#define CLLC_CONTROL_RUNNING_ON 1
+#ifndef CLLC_CONTROL_RUNNING_ON
+#define CLLC_CONTROL_RUNNING_ON C28x_CORE
+#endif
 #define CLLC_POWER_FLOW CLLC_POWER_FLOW_SEC_PRIM
 #define CLLC_INCR_BUILD CLLC_OPEN_LOOP_BUILD
 #define CLLC_CONTROL_MODE CLLC_VOLTAGE_MODE
 #define CLLC_TEST_SETUP CLLC_TEST_SETUP_RES_LOAD
 #define CLLC_PROTECTION CLLC_PROTECTION_DISABLED
+#ifndef CLLC_SFRA_TYPE
 #define CLLC_SFRA_TYPE  0
+#endif
 #define CLLC_SFRA_AMPLITUDE (float32_t)CLLC_SFRA_INJECTION_AMPLITUDE_LEVEL2
 #endif
 
 #if CLLC_LAB == 7
-#define CLLC_CONTROL_RUNNING_ON 1
+#ifndef CLLC_CONTROL_RUNNING_ON
+#define CLLC_CONTROL_RUNNING_ON C28x_CORE
+#endif
 #define CLLC_POWER_FLOW CLLC_POWER_FLOW_SEC_PRIM
 #define CLLC_INCR_BUILD CLLC_OPEN_LOOP_BUILD
 #define CLLC_CONTROL_MODE CLLC_VOLTAGE_MODE
 #define CLLC_TEST_SETUP CLLC_TEST_SETUP_RES_LOAD
 #define CLLC_PROTECTION CLLC_PROTECTION_ENABLED
+#ifndef CLLC_SFRA_TYPE
 #define CLLC_SFRA_TYPE  0
+#endif
 #define CLLC_SFRA_AMPLITUDE (float32_t)CLLC_SFRA_INJECTION_AMPLITUDE_LEVEL2
 #endif
 
 #if CLLC_LAB == 8
-#define CLLC_CONTROL_RUNNING_ON 1
+#ifndef CLLC_CONTROL_RUNNING_ON
+#define CLLC_CONTROL_RUNNING_ON C28x_CORE
+#endif
 #define CLLC_POWER_FLOW CLLC_POWER_FLOW_SEC_PRIM
 #define CLLC_INCR_BUILD CLLC_CLOSED_LOOP_BUILD
 #define CLLC_CONTROL_MODE CLLC_VOLTAGE_MODE
 #define CLLC_TEST_SETUP CLLC_TEST_SETUP_RES_LOAD
 #define CLLC_PROTECTION CLLC_PROTECTION_ENABLED
+#ifndef CLLC_SFRA_TYPE
 #define CLLC_SFRA_TYPE  0
+#endif
 #define CLLC_SFRA_AMPLITUDE (float32_t)CLLC_SFRA_INJECTION_AMPLITUDE_LEVEL1
 #endif
 
 
 #define CLLC_ISR1_RUNNING_ON CLLC_CONTROL_RUNNING_ON
 
+//
+// can be overridden on the command line, e.g. -DCLLC_PWM_UPDATE_MODE=2
+//
+#ifndef CLLC_PWM_UPDATE_MODE
+#define CLLC_PWM_UPDATE_MODE CLLC_PWM_UPDATE_ISR1_PHASE_LOAD
+#endif
+
+#ifndef CLLC_PROFILING
+#define CLLC_PROFILING CLLC_PROFILING_GPIO
+#endif
+
+#ifndef CLLC_TRIP_DECODE
+#if CLLC_CONTROL_RUNNING_ON == CLA_CORE
+#define CLLC_TRIP_DECODE CLLC_TRIP_DECODE_ISR2
+#else
+#define CLLC_TRIP_DECODE CLLC_TRIP_DECODE_EVENT
+#endif
+#endif
+
 #define CLLC_ISR2_FREQUENCY_HZ ((float32_t)120000)
 #define CLLC_ISR3_FREQUENCY_HZ ((float32_t)10000)
 #define CLLC_SFRA_ISR_FREQ_HZ       CLLC_ISR2_FREQUENCY_HZ
@@ -254,9 +358,24 @@ extern "C" {
 #define CLLC_IPRIM_TANK_MAX_SENSE_AMPS ((float32_t)34.375)
 #define CLLC_ISEC_TANK_MAX_SENSE_AMPS ((float32_t)42.375)
 
+//
+// channels of the averages ISR3 takes of the sensed signals (cllc_avg.h),
+// in the order ISR3 ran them before they shared one bank
+//
+#define CLLC_AVG_ISEC           0
+#define CLLC_AVG_IPRIM          1
+#define CLLC_AVG_VSEC           2
+#define CLLC_AVG_VPRIM          3
+#define CLLC_AVG_CHANNELS       4
+
 #define CLLC_VSEC_NOMINAL_VOLTS ((float32_t)350)
 #define CLLC_VPRIM_NOMINAL_VOLTS ((float32_t)400)
 
+//
+// current loop reference at start-up, raised from the watch window
+//
+#define CLLC_ISEC_NOMINAL_AMPS ((float32_t)3)
+
 #define CLLC_IPRIM_TRIP_LIMIT_AMPS ((float32_t)30)
 #define CLLC_ISEC_TRIP_LIMIT_AMPS  ((float32_t)30)
 #define CLLC_IPRIM_TANK_TRIP_LIMIT_AMPS ((float32_t)30)
@@ -269,52 +388,89 @@ extern "C" {
 
 //
 // Control Loop Design
+// Each compensator is specified in continuous time as
+//
+//     K (1 + s/wz1)(1 + s/wz2)(1 + s/wz3) / (s (1 + s/wp1)(1 + s/wp2))
+//
+// K in 1/s, the corners in Hz, 0 for none. The 2P2Z coefficients below are
+// its bilinear transform at CLLC_ISR2_FREQUENCY_HZ, printed with
+// host/cllc_coeffgen.c -g, which fails on an unstable compensator or one
+// at risk of a limit cycle. cllc_coeffgen without arguments checks that
+// the coefficients here are those of the specs.
 //
 
 //
 // LAB3
 //
-#define CLLC_GV1_2P2Z_A1    (float32_t) -1.7284895037
-#define CLLC_GV1_2P2Z_A2    (float32_t) 0.7284895037
+#define CLLC_GV1_ZPK_K           132000.0
+#define CLLC_GV1_ZPK_ZEROS_HZ    { 600.0, 0.0, 0.0 }
+#define CLLC_GV1_ZPK_POLES_HZ    { 6000.0, 0.0 }
+#define CLLC_GV1_2P2Z_A1    (float32_t) -1.7284895182
+#define CLLC_GV1_2P2Z_A2    (float32_t) 0.7284895182
 #define CLLC_GV1_2P2Z_A3    (float32_t) 0.0000000000
-#define CLLC_GV1_2P2Z_B0    (float32_t) 4.8280130584
-#define CLLC_GV1_2P2Z_B1    (float32_t) 0.1493277469
-#define CLLC_GV1_2P2Z_B2    (float32_t) -4.6786792593
+#define CLLC_GV1_2P2Z_B0    (float32_t) 4.8280115128
+#define CLLC_GV1_2P2Z_B1    (float32_t) 0.1493307799
+#define CLLC_GV1_2P2Z_B2    (float32_t) -4.6786808968
 #define CLLC_GV1_2P2Z_B3    (float32_t) 0.0000000000
 
 //
 // LAB4
 //
-#define CLLC_GI1_2P2Z_A1    (float32_t) -1.8277396009
-#define CLLC_GI1_2P2Z_A2    (float32_t) 0.8277396009
+#define CLLC_GI1_ZPK_K           300000.0
+#define CLLC_GI1_ZPK_ZEROS_HZ    { 3600.0, 0.0, 0.0 }
+#define CLLC_GI1_ZPK_POLES_HZ    { 3600.0, 0.0 }
+#define CLLC_GI1_2P2Z_A1    (float32_t) -1.8277395964
+#define CLLC_GI1_2P2Z_A2    (float32_t) 0.8277395964
 #define CLLC_GI1_2P2Z_A3    (float32_t) 0.0000000000
-#define CLLC_GI1_2P2Z_B0    (float32_t) 1.2500036172
-#define CLLC_GI1_2P2Z_B1    (float32_t) 0.2153188876
-#define CLLC_GI1_2P2Z_B2    (float32_t) -1.0346715071
+#define CLLC_GI1_2P2Z_B0    (float32_t) 1.2500000000
+#define CLLC_GI1_2P2Z_B1    (float32_t) 0.2153255045
+#define CLLC_GI1_2P2Z_B2    (float32_t) -1.0346745253
 #define CLLC_GI1_2P2Z_B3    (float32_t) 0.0000000000
 
 //
-// LAB5 
+// LAB5
 //
-#define CLLC_GI2_2P2Z_A1    (float32_t) 0.0341879720
-#define CLLC_GI2_2P2Z_A2    (float32_t) -0.7668017816
-#define CLLC_GI2_2P2Z_A3    (float32_t) -0.2673861903
-#define CLLC_GI2_2P2Z_B0    (float32_t) 1.3436620732
-#define CLLC_GI2_2P2Z_B1    (float32_t) 0.3459370813
-#define CLLC_GI2_2P2Z_B2    (float32_t) -0.7200660800
-#define CLLC_GI2_2P2Z_B3    (float32_t) -0.2790608258
+#define CLLC_GI2_ZPK_K           36000.0
+#define CLLC_GI2_ZPK_ZEROS_HZ    { 4800.0, 120000.0, 120000.0 }
+#define CLLC_GI2_ZPK_POLES_HZ    { 120000.0, 120000.0 }
+#define CLLC_GI2_2P2Z_A1    (float32_t) 0.0341879725
+#define CLLC_GI2_2P2Z_A2    (float32_t) -0.7668017745
+#define CLLC_GI2_2P2Z_A3    (float32_t) -0.2673861980
+#define CLLC_GI2_2P2Z_B0    (float32_t) 1.3436620235
+#define CLLC_GI2_2P2Z_B1    (float32_t) 0.3459370732
+#define CLLC_GI2_2P2Z_B2    (float32_t) -0.7200660706
+#define CLLC_GI2_2P2Z_B3    (float32_t) -0.2790608406
 
 //
-// LAB8 
+// LAB8
 //
-#define CLLC_GV2_2P2Z_A1    (float32_t) -0.4829060140
-#define CLLC_GV2_2P2Z_A2    (float32_t) -0.5170939860
+#define CLLC_GV2_ZPK_K           7500.0
+#define CLLC_GV2_ZPK_ZEROS_HZ    { 1000.0, 120000.0, 0.0 }
+#define CLLC_GV2_ZPK_POLES_HZ    { 120000.0, 0.0 }
+#define CLLC_GV2_2P2Z_A1    (float32_t) -0.4829060435
+#define CLLC_GV2_2P2Z_A2    (float32_t) -0.5170939565
 #define CLLC_GV2_2P2Z_A3    (float32_t) 0.0000000000
-#define CLLC_GV2_2P2Z_B0    (float32_t) 1.3436620732
-#define CLLC_GV2_2P2Z_B1    (float32_t) -0.3488624959
-#define CLLC_GV2_2P2Z_B2    (float32_t) -0.5396713815
+#define CLLC_GV2_2P2Z_B0    (float32_t) 1.2249120474
+#define CLLC_GV2_2P2Z_B1    (float32_t) -0.5290173888
+#define CLLC_GV2_2P2Z_B2    (float32_t) -0.6010763049
 #define CLLC_GV2_2P2Z_B3    (float32_t) 0.0000000000
 
+//
+// Gain schedule of GV over the switching period (cllc_gvsched.h), the gain
+// on the error at the GSM_N + 1 sector bounds from CLLC_pwmPeriodMin_pu to
+// 1. Generated with host/cllc_gvsched_check.c -g for the crossover at
+// CLLC_GV_SCHEDULE_LOAD of the rated load.
+//
+#define CLLC_GV_SCHEDULE_LOAD           0.10
+#define CLLC_GV1_SCHEDULE_CROSSOVER_HZ  1500.0
+#define CLLC_GV1_SCHEDULE_GAINS { 0.5389f, 0.1733f, 0.0450f, 0.0437f,      \
+                                  0.0741f, 0.2335f, 0.4444f, 0.6749f,      \
+                                  0.9338f }
+#define CLLC_GV2_SCHEDULE_CROSSOVER_HZ  2500.0
+#define CLLC_GV2_SCHEDULE_GAINS { 32.9544f, 10.3389f, 1.3207f, 1.2571f,    \
+                                  3.9912f, 14.1879f, 27.1804f, 41.3215f,   \
+                                  57.1902f }
+
 //=============================================================================
 // User code settings file
 //=============================================================================
@@ -0,0 +1,173 @@
+//#############################################################################
+//
+// FILE:   cllc_share.h
+//
+// TITLE:  Current sharing of boards in parallel on one secondary bus
+//         One board, the master, closes the voltage loop on the bus. Every
+//         ISR3 it sends its averaged ISEC as the current reference of the
+//         others, with its voltage reference, in a share frame on its FSI
+//         transmitter (cllc_fsilink.h). The followers are daisy chained:
+//         each takes the frame at the start of its ISR3 and sends it on to
+//         the next board as it is.
+//
+//         Every board runs the voltage loop with droop, the reference
+//         lowered by the droop resistance times its own current, which
+//         shares the load without the link. A follower on the link runs the
+//         current loop in ISR3 on top: the error of its averaged ISEC to
+//         the reference integrates into a trim of its voltage reference,
+//         within +-trimMax_pu, so it carries the current of the master.
+//         The period is not driven from the current error directly, boards
+//         in parallel on one bus are stiff voltage sources to each other
+//         and a few mV move amperes.
+//
+//         A follower that takes no reference for CLLC_SHARE_TIMEOUT_POLLS
+//         ISR3 runs clears the trim and is left with the droop on the last
+//         voltage reference of the master. It trims again after
+//         CLLC_SHARE_RECOVER_FRAMES references in a row.
+//
+//         ISR3 polls the link and the trim goes out through
+//         CLLC_vSecRef_Volts. The host simulation is host/cllc_share_sim.c.
+//
+//#############################################################################
+
+#ifndef CLLC_SHARE_H
+#define CLLC_SHARE_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "cllc_settings.h"
+
+//
+// typedefs
+//
+typedef struct
+{
+    float32_t iSecRef_pu;       // last taken
+    float32_t vSecRef_pu;
+    float32_t vSecTrim_pu;      // added to vSecRef_pu
+    float32_t trimGain;         // per pu of current error and ISR3 run
+    float32_t trimMax_pu;
+    uint16_t linkUp;
+    uint16_t silentPolls;       // since the last reference
+    uint16_t goodFrames;        // in a row, while the link is down
+    uint16_t timeoutPolls;
+    uint16_t recoverFrames;
+    uint32_t dropouts;
+    uint32_t recoveries;
+} CLLC_SHARE_Follower;
+
+//
+// Inline functions
+//
+
+//
+// The link starts down, the follower runs the droop until it has taken
+// recoverFrames references
+//
+static inline void CLLC_SHARE_initFollower(CLLC_SHARE_Follower *follower,
+                                           float32_t vSecRef_pu,
+                                           float32_t trimGain,
+                                           float32_t trimMax_pu,
+                                           uint16_t timeoutPolls,
+                                           uint16_t recoverFrames)
+{
+    follower->iSecRef_pu = 0.0f;
+    follower->vSecRef_pu = vSecRef_pu;
+    follower->vSecTrim_pu = 0.0f;
+    follower->trimGain = trimGain;
+    follower->trimMax_pu = trimMax_pu;
+    follower->linkUp = 0;
+    follower->silentPolls = 0;
+    follower->goodFrames = 0;
+    follower->timeoutPolls = timeoutPolls;
+    follower->recoverFrames = recoverFrames;
+    follower->dropouts = 0;
+    follower->recoveries = 0;
+}
+
+//
+// Once per ISR3, taken is 1 with a reference in iSecRef_pu and vSecRef_pu,
+// iSecSensed_pu is the averaged current of the board. Returns the voltage
+// reference with the trim.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_SHARE_poll)
+static inline float32_t CLLC_SHARE_poll(CLLC_SHARE_Follower *follower,
+                                        uint16_t taken,
+                                        float32_t iSecRef_pu,
+                                        float32_t vSecRef_pu,
+                                        float32_t iSecSensed_pu)
+{
+    float32_t trim;
+
+    if(taken != 0U)
+    {
+        follower->iSecRef_pu = iSecRef_pu;
+        follower->vSecRef_pu = vSecRef_pu;
+        follower->silentPolls = 0;
+
+        if((follower->linkUp == 0U) &&
+           (++follower->goodFrames >= follower->recoverFrames))
+        {
+            follower->linkUp = 1;
+            follower->recoveries++;
+        }
+    }
+    else if(follower->silentPolls < follower->timeoutPolls)
+    {
+        follower->silentPolls++;
+    }
+    else if(follower->linkUp != 0U)
+    {
+        follower->linkUp = 0;
+        follower->goodFrames = 0;
+        follower->vSecTrim_pu = 0.0f;
+        follower->dropouts++;
+    }
+    else
+    {
+        follower->goodFrames = 0;
+    }
+
+    if(follower->linkUp != 0U)
+    {
+        trim = follower->vSecTrim_pu + (follower->trimGain *
+                                        (follower->iSecRef_pu -
+                                         iSecSensed_pu));
+        if(trim > follower->trimMax_pu)
+        {
+            trim = follower->trimMax_pu;
+        }
+        else if(trim < -follower->trimMax_pu)
+        {
+            trim = -follower->trimMax_pu;
+        }
+        follower->vSecTrim_pu = trim;
+    }
+
+    return(follower->vSecRef_pu + follower->vSecTrim_pu);
+}
+
+//
+// The error of the voltage loop with the droop, the reference lowered by
+// droop_pu per unit of the sensed current
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_SHARE_getDroopError)
+static inline float32_t CLLC_SHARE_getDroopError(float32_t vSecRef_pu,
+                                                 float32_t vSecSensed_pu,
+                                                 float32_t iSecSensed_pu,
+                                                 float32_t droop_pu)
+{
+    return(vSecRef_pu - (droop_pu * iSecSensed_pu) - vSecSensed_pu);
+}
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
@@ -0,0 +1,137 @@
+//#############################################################################
+//
+// FILE:   cllc_stats.h
+//
+// TITLE:  Runtime counters of the ISRs and the control loops
+//         One block of 32 bit counters in place of loose globals: ISR runs
+//         and overruns, ISR1 triggers moved before they fired, trips by
+//         cause, slew limited steps and loop output clamps. Every counter is
+//         only ever counted up, each by one writer, with one read-modify-write
+//         of its own location (CLLC_STATS_COUNT), so there is no lock and
+//         no interrupt mask anywhere.
+//
+//         The background takes a consistent copy with CLLC_STATS_snapshot:
+//         it copies the block until two copies in a row match. The counters
+//         only grow, so two equal copies hold the values of every counter
+//         at the moment between them. The block starts with
+//         CLLC_STATS_LAYOUT so host/cllc_stats_dump.c can find and check it
+//         in a RAM dump through the address of CLLC_stats in the .map file.
+//
+//         On the CLA CLLC_STATS_COUNT is empty, with ISR2 there ISR3 counts
+//         the ISR2 runs from the CLA telemetry.
+//
+//#############################################################################
+
+#ifndef CLLC_STATS_H
+#define CLLC_STATS_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+
+//
+// Defines
+//
+#define CLLC_STATS_LAYOUT               0x53540001UL    // "ST", layout 1
+#define CLLC_STATS_WORDS                16U             // 32 bit counters
+#define CLLC_STATS_SNAPSHOT_PASSES_MAX  8U
+
+//
+// typedefs
+//
+typedef struct
+{
+    uint32_t layout;                    // CLLC_STATS_LAYOUT
+    uint32_t isr1Count;
+    uint32_t isr1Retriggers;            // armed again before it fired
+    uint32_t isr2Count;
+    uint32_t isr2Overruns;              // ran into the next ISR2 period
+    uint32_t isr3Count;
+    uint32_t isr3Overruns;              // ran into the next ISR3 period
+    uint32_t tripPrimOverCurrent;
+    uint32_t tripSecOverCurrent;
+    uint32_t tripPrimTankOverCurrent;
+    uint32_t refSlewLimits;             // ISR3 runs with the reference slewed
+    uint32_t periodSlewLimits;          // ISR2 runs with the period slewed
+    uint32_t gvOutMaxClamps;
+    uint32_t gvOutMinClamps;
+    uint32_t giOutMaxClamps;
+    uint32_t giOutMinClamps;
+} CLLC_STATS_Counters;
+
+//
+// the globals
+//
+#ifdef __TMS320C28XX_CLA__
+#define CLLC_STATS_COUNT(counter)
+#else
+extern CLLC_STATS_Counters CLLC_stats;
+
+#define CLLC_STATS_COUNT(counter)       (CLLC_stats.counter++)
+
+#pragma FUNC_ALWAYS_INLINE(CLLC_STATS_reset)
+static inline void CLLC_STATS_reset(CLLC_STATS_Counters *stats)
+{
+    uint32_t *word = (uint32_t *)stats;
+    uint16_t i;
+
+    for(i = 1; i < CLLC_STATS_WORDS; i++)
+    {
+        word[i] = 0;
+    }
+    stats->layout = CLLC_STATS_LAYOUT;
+}
+
+//
+// A copy of the counters as they all were at one moment, taken with the
+// ISRs running. Returns the copies it took, 0 when no two of
+// CLLC_STATS_SNAPSHOT_PASSES_MAX matched and the last one is in copy.
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_STATS_snapshot)
+static inline uint16_t CLLC_STATS_snapshot(const volatile CLLC_STATS_Counters *live,
+                                           CLLC_STATS_Counters *copy)
+{
+    const volatile uint32_t *from = (const volatile uint32_t *)live;
+    uint32_t *to = (uint32_t *)copy;
+    uint32_t word;
+    uint16_t passes;
+    uint16_t changed;
+    uint16_t i;
+
+    for(i = 0; i < CLLC_STATS_WORDS; i++)
+    {
+        to[i] = from[i];
+    }
+
+    for(passes = 2; passes <= CLLC_STATS_SNAPSHOT_PASSES_MAX; passes++)
+    {
+        changed = 0;
+        for(i = 0; i < CLLC_STATS_WORDS; i++)
+        {
+            word = from[i];
+            if(word != to[i])
+            {
+                to[i] = word;
+                changed = 1;
+            }
+        }
+        if(changed == 0U)
+        {
+            return(passes);
+        }
+    }
+
+    return(0);
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
@@ -0,0 +1,313 @@
+//#############################################################################
+//
+// FILE:   cllc_telemetry.c
+//
+// TITLE:  Telemetry frames into the ring and out of it to the SCI, see
+//         cllc_telemetry.h
+//
+//#############################################################################
+
+//*****************************************************************************
+// the includes
+//*****************************************************************************
+
+#include "cllc_settings.h"
+#include "cllc_telemetry.h"
+
+//
+// CRC-16/CCITT-FALSE, polynomial 0x1021
+//
+const uint16_t CLLC_TELEMETRY_crcTable[256] =
+{
+    0x0000U, 0x1021U, 0x2042U, 0x3063U, 0x4084U, 0x50A5U, 0x60C6U, 0x70E7U,
+    0x8108U, 0x9129U, 0xA14AU, 0xB16BU, 0xC18CU, 0xD1ADU, 0xE1CEU, 0xF1EFU,
+    0x1231U, 0x0210U, 0x3273U, 0x2252U, 0x52B5U, 0x4294U, 0x72F7U, 0x62D6U,
+    0x9339U, 0x8318U, 0xB37BU, 0xA35AU, 0xD3BDU, 0xC39CU, 0xF3FFU, 0xE3DEU,
+    0x2462U, 0x3443U, 0x0420U, 0x1401U, 0x64E6U, 0x74C7U, 0x44A4U, 0x5485U,
+    0xA56AU, 0xB54BU, 0x8528U, 0x9509U, 0xE5EEU, 0xF5CFU, 0xC5ACU, 0xD58DU,
+    0x3653U, 0x2672U, 0x1611U, 0x0630U, 0x76D7U, 0x66F6U, 0x5695U, 0x46B4U,
+    0xB75BU, 0xA77AU, 0x9719U, 0x8738U, 0xF7DFU, 0xE7FEU, 0xD79DU, 0xC7BCU,
+    0x48C4U, 0x58E5U, 0x6886U, 0x78A7U, 0x0840U, 0x1861U, 0x2802U, 0x3823U,
+    0xC9CCU, 0xD9EDU, 0xE98EU, 0xF9AFU, 0x8948U, 0x9969U, 0xA90AU, 0xB92BU,
+    0x5AF5U, 0x4AD4U, 0x7AB7U, 0x6A96U, 0x1A71U, 0x0A50U, 0x3A33U, 0x2A12U,
+    0xDBFDU, 0xCBDCU, 0xFBBFU, 0xEB9EU, 0x9B79U, 0x8B58U, 0xBB3BU, 0xAB1AU,
+    0x6CA6U, 0x7C87U, 0x4CE4U, 0x5CC5U, 0x2C22U, 0x3C03U, 0x0C60U, 0x1C41U,
+    0xEDAEU, 0xFD8FU, 0xCDECU, 0xDDCDU, 0xAD2AU, 0xBD0BU, 0x8D68U, 0x9D49U,
+    0x7E97U, 0x6EB6U, 0x5ED5U, 0x4EF4U, 0x3E13U, 0x2E32U, 0x1E51U, 0x0E70U,
+    0xFF9FU, 0xEFBEU, 0xDFDDU, 0xCFFCU, 0xBF1BU, 0xAF3AU, 0x9F59U, 0x8F78U,
+    0x9188U, 0x81A9U, 0xB1CAU, 0xA1EBU, 0xD10CU, 0xC12DU, 0xF14EU, 0xE16FU,
+    0x1080U, 0x00A1U, 0x30C2U, 0x20E3U, 0x5004U, 0x4025U, 0x7046U, 0x6067U,
+    0x83B9U, 0x9398U, 0xA3FBU, 0xB3DAU, 0xC33DU, 0xD31CU, 0xE37FU, 0xF35EU,
+    0x02B1U, 0x1290U, 0x22F3U, 0x32D2U, 0x4235U, 0x5214U, 0x6277U, 0x7256U,
+    0xB5EAU, 0xA5CBU, 0x95A8U, 0x8589U, 0xF56EU, 0xE54FU, 0xD52CU, 0xC50DU,
+    0x34E2U, 0x24C3U, 0x14A0U, 0x0481U, 0x7466U, 0x6447U, 0x5424U, 0x4405U,
+    0xA7DBU, 0xB7FAU, 0x8799U, 0x97B8U, 0xE75FU, 0xF77EU, 0xC71DU, 0xD73CU,
+    0x26D3U, 0x36F2U, 0x0691U, 0x16B0U, 0x6657U, 0x7676U, 0x4615U, 0x5634U,
+    0xD94CU, 0xC96DU, 0xF90EU, 0xE92FU, 0x99C8U, 0x89E9U, 0xB98AU, 0xA9ABU,
+    0x5844U, 0x4865U, 0x7806U, 0x6827U, 0x18C0U, 0x08E1U, 0x3882U, 0x28A3U,
+    0xCB7DU, 0xDB5CU, 0xEB3FU, 0xFB1EU, 0x8BF9U, 0x9BD8U, 0xABBBU, 0xBB9AU,
+    0x4A75U, 0x5A54U, 0x6A37U, 0x7A16U, 0x0AF1U, 0x1AD0U, 0x2AB3U, 0x3A92U,
+    0xFD2EU, 0xED0FU, 0xDD6CU, 0xCD4DU, 0xBDAAU, 0xAD8BU, 0x9DE8U, 0x8DC9U,
+    0x7C26U, 0x6C07U, 0x5C64U, 0x4C45U, 0x3CA2U, 0x2C83U, 0x1CE0U, 0x0CC1U,
+    0xEF1FU, 0xFF3EU, 0xCF5DU, 0xDF7CU, 0xAF9BU, 0xBFBAU, 0x8FD9U, 0x9FF8U,
+    0x6E17U, 0x7E36U, 0x4E55U, 0x5E74U, 0x2E93U, 0x3EB2U, 0x0ED1U, 0x1EF0U
+};
+
+//
+// Appends one byte to the frame being written at *index, and to its CRC
+//
+static void CLLC_TELEMETRY_putByte(CLLC_TELEMETRY_Stream *stream,
+                                   uint16_t *index, uint16_t *crc,
+                                   uint16_t byte)
+{
+    byte &= 0xFFU;
+    stream->ring[*index & stream->ringMask] = byte;
+    *index = *index + 1U;
+    *crc = (uint16_t)(*crc << 8) ^
+           CLLC_TELEMETRY_crcTable[((*crc >> 8) ^ byte) & 0xFFU];
+}
+
+static void CLLC_TELEMETRY_put32(CLLC_TELEMETRY_Stream *stream,
+                                 uint16_t *index, uint16_t *crc,
+                                 uint32_t word)
+{
+    CLLC_TELEMETRY_putByte(stream, index, crc, (uint16_t)word);
+    CLLC_TELEMETRY_putByte(stream, index, crc, (uint16_t)(word >> 8));
+    CLLC_TELEMETRY_putByte(stream, index, crc, (uint16_t)(word >> 16));
+    CLLC_TELEMETRY_putByte(stream, index, crc, (uint16_t)(word >> 24));
+}
+
+//
+// Header of a frame with the given payload length, when the whole frame
+// fits the ring. Returns 0 and leaves the ring as it is otherwise, the
+// sequence number of the frame is used up either way.
+//
+static uint16_t CLLC_TELEMETRY_startFrame(CLLC_TELEMETRY_Stream *stream,
+                                          uint16_t *index, uint16_t *crc,
+                                          uint16_t type, uint16_t length)
+{
+    uint16_t room = stream->ringMask + 1U - (*index - stream->readIndex);
+
+    if(room < (length + CLLC_TELEMETRY_HEADER_BYTES + CLLC_TELEMETRY_CRC_BYTES))
+    {
+        stream->sequence++;
+        stream->droppedFrames++;
+        return(0);
+    }
+
+    stream->ring[*index & stream->ringMask] = CLLC_TELEMETRY_SYNC0;
+    stream->ring[(uint16_t)(*index + 1U) & stream->ringMask] =
+            CLLC_TELEMETRY_SYNC1;
+    *index = *index + 2U;
+
+    *crc = 0xFFFFU;
+    CLLC_TELEMETRY_putByte(stream, index, crc, type);
+    CLLC_TELEMETRY_putByte(stream, index, crc, length);
+    CLLC_TELEMETRY_putByte(stream, index, crc, stream->sequence);
+    CLLC_TELEMETRY_putByte(stream, index, crc, stream->sequence >> 8);
+    stream->sequence++;
+
+    return(1);
+}
+
+//
+// The CRC closes the frame, then the transmit side gets all of it at once
+//
+static void CLLC_TELEMETRY_endFrame(CLLC_TELEMETRY_Stream *stream,
+                                    uint16_t index, uint16_t crc)
+{
+    stream->ring[index & stream->ringMask] = crc & 0xFFU;
+    stream->ring[(uint16_t)(index + 1U) & stream->ringMask] = crc >> 8;
+
+    stream->writeIndex = index + 2U;
+    stream->sentFrames++;
+}
+
+static uint16_t CLLC_TELEMETRY_getNameLength(const char *name)
+{
+    uint16_t length = 0;
+
+    while((length < CLLC_TELEMETRY_NAME_MAX) && (name[length] != '\0'))
+    {
+        length++;
+    }
+    return(length);
+}
+
+static uint16_t CLLC_TELEMETRY_sendSchema(CLLC_TELEMETRY_Stream *stream)
+{
+    uint16_t index = stream->writeIndex;
+    uint16_t length = 7;
+    uint16_t crc, i, j, nameLength;
+    const char *name;
+
+    for(i = 0; i < stream->variables; i++)
+    {
+        length += 2U + CLLC_TELEMETRY_getNameLength(stream->variable[i].name);
+    }
+
+    if(CLLC_TELEMETRY_startFrame(stream, &index, &crc,
+                                 CLLC_TELEMETRY_FRAME_SCHEMA, length) == 0U)
+    {
+        return(0);
+    }
+
+    CLLC_TELEMETRY_putByte(stream, &index, &crc, stream->variables);
+    CLLC_TELEMETRY_put32(stream, &index, &crc, stream->tickFrequency_Hz);
+    CLLC_TELEMETRY_putByte(stream, &index, &crc, stream->decimation);
+    CLLC_TELEMETRY_putByte(stream, &index, &crc, stream->decimation >> 8);
+
+    for(i = 0; i < stream->variables; i++)
+    {
+        name = stream->variable[i].name;
+        nameLength = CLLC_TELEMETRY_getNameLength(name);
+
+        CLLC_TELEMETRY_putByte(stream, &index, &crc,
+                               stream->variable[i].type);
+        CLLC_TELEMETRY_putByte(stream, &index, &crc, nameLength);
+        for(j = 0; j < nameLength; j++)
+        {
+            CLLC_TELEMETRY_putByte(stream, &index, &crc, (uint16_t)name[j]);
+        }
+    }
+
+    CLLC_TELEMETRY_endFrame(stream, index, crc);
+    return(1);
+}
+
+//
+// Before the sampling ISR is enabled. ringSize is a power of 2 up to 32768
+// and holds at least one schema frame, a schemaPeriod of 0 sends the schema
+// only ahead of the first data frame.
+//
+void CLLC_TELEMETRY_config(CLLC_TELEMETRY_Stream *stream,
+                           volatile uint16_t *ring, uint16_t ringSize,
+                           uint32_t tickFrequency_Hz, uint16_t decimation,
+                           uint16_t schemaPeriod)
+{
+    stream->variables = 0;
+    stream->tickFrequency_Hz = tickFrequency_Hz;
+    stream->decimation = (decimation != 0U) ? decimation : 1U;
+    stream->schemaPeriod = schemaPeriod;
+    stream->ring = ring;
+    stream->ringMask = ringSize - 1U;
+
+    stream->writeIndex = 0;
+    stream->tick = 0;
+    stream->skipCount = 0;
+    stream->schemaCount = 0;
+    stream->sequence = 0;
+    stream->sentFrames = 0;
+    stream->droppedFrames = 0;
+
+    stream->readIndex = 0;
+}
+
+static void CLLC_TELEMETRY_add(CLLC_TELEMETRY_Stream *stream,
+                               const char *name, uint16_t type,
+                               const void *value)
+{
+    if(stream->variables < CLLC_TELEMETRY_VARIABLES_MAX)
+    {
+        stream->variable[stream->variables].name = name;
+        stream->variable[stream->variables].type = type;
+        stream->variable[stream->variables].value = value;
+        stream->variables++;
+    }
+}
+
+void CLLC_TELEMETRY_addVariable(CLLC_TELEMETRY_Stream *stream,
+                                const char *name, const float32_t *value)
+{
+    CLLC_TELEMETRY_add(stream, name, CLLC_TELEMETRY_TYPE_FLOAT32, value);
+}
+
+//
+// A counter goes out as it is, read in one 32 bit access
+//
+void CLLC_TELEMETRY_addCounter(CLLC_TELEMETRY_Stream *stream,
+                               const char *name, const uint32_t *count)
+{
+    CLLC_TELEMETRY_add(stream, name, CLLC_TELEMETRY_TYPE_UINT32, count);
+}
+
+//
+// One data frame of the variables as they are now, after the schema when
+// that is due. Returns 1 if anything went into the ring.
+//
+uint16_t CLLC_TELEMETRY_sendFrame(CLLC_TELEMETRY_Stream *stream)
+{
+    union
+    {
+        float32_t value;
+        uint32_t bits;
+    } sample;
+    uint16_t sent = 0;
+    uint16_t index, crc, i;
+
+    if(stream->schemaCount == 0U)
+    {
+        if(CLLC_TELEMETRY_sendSchema(stream) == 0U)
+        {
+            return(0);
+        }
+        stream->schemaCount = (stream->schemaPeriod != 0U) ?
+                              stream->schemaPeriod : 0xFFFFU;
+        sent = 1;
+    }
+
+    index = stream->writeIndex;
+    if(CLLC_TELEMETRY_startFrame(stream, &index, &crc,
+                                 CLLC_TELEMETRY_FRAME_DATA,
+                                 4U + (4U * stream->variables)) == 0U)
+    {
+        return(sent);
+    }
+
+    CLLC_TELEMETRY_put32(stream, &index, &crc, stream->tick);
+    for(i = 0; i < stream->variables; i++)
+    {
+        if(stream->variable[i].type == CLLC_TELEMETRY_TYPE_UINT32)
+        {
+            sample.bits = *(const volatile uint32_t *)
+                                stream->variable[i].value;
+        }
+        else
+        {
+            sample.value = *(const float32_t *)stream->variable[i].value;
+        }
+        CLLC_TELEMETRY_put32(stream, &index, &crc, sample.bits);
+    }
+
+    CLLC_TELEMETRY_endFrame(stream, index, crc);
+
+    if(stream->schemaPeriod != 0U)
+    {
+        stream->schemaCount--;
+    }
+    return(1);
+}
+
+//
+// Takes up to maxBytes bytes from the ring for the SCI, returns how many
+//
+uint16_t CLLC_TELEMETRY_read(CLLC_TELEMETRY_Stream *stream, uint16_t *bytes,
+                             uint16_t maxBytes)
+{
+    uint16_t index = stream->readIndex;
+    uint16_t available = stream->writeIndex - index;
+    uint16_t i;
+
+    if(available > maxBytes)
+    {
+        available = maxBytes;
+    }
+
+    for(i = 0; i < available; i++)
+    {
+        bytes[i] = stream->ring[(uint16_t)(index + i) & stream->ringMask];
+    }
+
+    stream->readIndex = index + available;
+    return(available);
+}
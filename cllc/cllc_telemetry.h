@@ -0,0 +1,148 @@
+//#############################################################################
+//
+// FILE:   cllc_telemetry.h
+//
+// TITLE:  Binary telemetry stream, framed and CRC protected, sent out on an
+//         SCI from a ring of bytes
+//         The ISR sampling the variables (CLLC_TELEMETRY_run) is the only
+//         writer of the ring, the SCI transmit FIFO interrupt
+//         (CLLC_TELEMETRY_read) the only reader, neither disables interrupts.
+//         A frame that does not fit the ring is dropped whole and counted,
+//         the sequence number tells the decoder where.
+//
+//         Frame, all fields little endian:
+//         sync 0xA5 0x5A, type, payload length, sequence (16 bit), payload,
+//         CRC-16/CCITT-FALSE over type to the end of the payload.
+//
+//         Data payload: tick (32 bit) and 32 bits per variable, a float32
+//         or an unsigned counter.
+//         Schema payload: variable count, tick frequency in Hz (32 bit),
+//         decimation (16 bit), then per variable its type and the length
+//         and characters of its name. Sent first and then every
+//         schemaPeriod data frames, so a decoder can join at any point.
+//
+//         One byte per 16 bit word in the ring, as the SCI takes them. The
+//         SCI side is in cllc_hal.h.
+//
+//#############################################################################
+
+#ifndef CLLC_TELEMETRY_H
+#define CLLC_TELEMETRY_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "cllc_settings.h"
+
+//
+// Defines
+//
+#define CLLC_TELEMETRY_SYNC0            0xA5U
+#define CLLC_TELEMETRY_SYNC1            0x5AU
+
+#define CLLC_TELEMETRY_FRAME_SCHEMA     1U
+#define CLLC_TELEMETRY_FRAME_DATA       2U
+
+#define CLLC_TELEMETRY_TYPE_FLOAT32     1U
+#define CLLC_TELEMETRY_TYPE_UINT32      2U
+
+#define CLLC_TELEMETRY_HEADER_BYTES     6U
+#define CLLC_TELEMETRY_CRC_BYTES        2U
+#define CLLC_TELEMETRY_PAYLOAD_MAX      255U
+#define CLLC_TELEMETRY_FRAME_MAX        (CLLC_TELEMETRY_HEADER_BYTES +        \
+                                         CLLC_TELEMETRY_PAYLOAD_MAX +         \
+                                         CLLC_TELEMETRY_CRC_BYTES)
+
+#define CLLC_TELEMETRY_VARIABLES_MAX    16U
+#define CLLC_TELEMETRY_NAME_MAX         12U
+
+//
+// typedefs
+//
+typedef struct
+{
+    const char *name;           // CLLC_TELEMETRY_NAME_MAX characters kept
+    uint16_t type;              // CLLC_TELEMETRY_TYPE_
+    const void *value;
+} CLLC_TELEMETRY_Variable;
+
+typedef struct
+{
+    CLLC_TELEMETRY_Variable variable[CLLC_TELEMETRY_VARIABLES_MAX];
+    uint16_t variables;
+    uint32_t tickFrequency_Hz;  // of the runs
+    uint16_t decimation;        // one data frame every decimation runs
+    uint16_t schemaPeriod;      // data frames between schema frames
+    volatile uint16_t *ring;
+    uint16_t ringMask;          // ring size - 1, the size a power of 2
+
+    //
+    // written by the sampling ISR
+    //
+    volatile uint16_t writeIndex;
+    uint32_t tick;
+    uint16_t skipCount;
+    uint16_t schemaCount;
+    uint16_t sequence;
+    volatile uint32_t sentFrames;
+    volatile uint32_t droppedFrames;
+
+    //
+    // written by the transmit side
+    //
+    volatile uint16_t readIndex;
+} CLLC_TELEMETRY_Stream;
+
+//
+// the globals
+//
+extern const uint16_t CLLC_TELEMETRY_crcTable[256];
+
+//
+// the function prototypes
+//
+void CLLC_TELEMETRY_config(CLLC_TELEMETRY_Stream *stream,
+                           volatile uint16_t *ring, uint16_t ringSize,
+                           uint32_t tickFrequency_Hz, uint16_t decimation,
+                           uint16_t schemaPeriod);
+void CLLC_TELEMETRY_addVariable(CLLC_TELEMETRY_Stream *stream,
+                                const char *name, const float32_t *value);
+void CLLC_TELEMETRY_addCounter(CLLC_TELEMETRY_Stream *stream,
+                               const char *name, const uint32_t *count);
+uint16_t CLLC_TELEMETRY_sendFrame(CLLC_TELEMETRY_Stream *stream);
+uint16_t CLLC_TELEMETRY_read(CLLC_TELEMETRY_Stream *stream, uint16_t *bytes,
+                             uint16_t maxBytes);
+
+//
+// Called once per run of the sampling ISR, returns 1 when a frame went
+// into the ring and the transmit side has to be woken up
+//
+#pragma FUNC_ALWAYS_INLINE(CLLC_TELEMETRY_run)
+static inline uint16_t CLLC_TELEMETRY_run(CLLC_TELEMETRY_Stream *stream)
+{
+    uint16_t sent = 0;
+
+    if(stream->skipCount == 0U)
+    {
+        stream->skipCount = stream->decimation - 1U;
+        sent = CLLC_TELEMETRY_sendFrame(stream);
+    }
+    else
+    {
+        stream->skipCount--;
+    }
+
+    stream->tick++;
+    return(sent);
+}
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
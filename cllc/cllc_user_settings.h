@@ -99,7 +99,80 @@
 #define CLLC_SEC_LEG2_PWM_L_GPIO_PIN_CONFIG      GPIO_7_EPWM4_B
 #define CLLC_SEC_LEG2_PWM_L_DIS_GPIO_PIN_CONFIG  GPIO_7_GPIO7
 
+//
+// Interleaved CLLC phases run from this MCU, 1 or 2, see cllc/cllc_phase.h.
+// Phase 0 is the stage above, phase 1 a second one on EPWM5 to EPWM8, which
+// are all the PWMs left on the F28003x. Above 1 ISR2 is timed by ECAP1
+// alone, the ADC triggers move off EPWM6 and EPWM7 and the currents are
+// shared by a trim of the prim duty of each phase.
+//
+#ifndef CLLC_PHASES
+#define CLLC_PHASES 1
+#endif
+
+#define CLLC_PHASE1_PRIM_LEG1_PWM_BASE           EPWM5_BASE
+#define CLLC_PHASE1_PRIM_LEG2_PWM_BASE           EPWM6_BASE
+#define CLLC_PHASE1_SEC_LEG1_PWM_BASE            EPWM7_BASE
+#define CLLC_PHASE1_SEC_LEG2_PWM_BASE            EPWM8_BASE
+
+//
+// the H and L pins of PRIM LEG1, PRIM LEG2, SEC LEG1 and SEC LEG2 of phase
+// 1, GPIO8 to GPIO15 in that order
+//
+#define CLLC_PHASE1_PWM_FIRST_GPIO               8
+#define CLLC_PHASE1_PWM_GPIO_PIN_CONFIGS        {GPIO_8_EPWM5_A,              \
+                                                  GPIO_9_EPWM5_B,              \
+                                                  GPIO_10_EPWM6_A,             \
+                                                  GPIO_11_EPWM6_B,             \
+                                                  GPIO_12_EPWM7_A,             \
+                                                  GPIO_13_EPWM7_B,             \
+                                                  GPIO_14_EPWM8_A,             \
+                                                  GPIO_15_EPWM8_B}
+#define CLLC_PHASE1_PWM_DIS_GPIO_PIN_CONFIGS    {GPIO_8_GPIO8,                \
+                                                  GPIO_9_GPIO9,                \
+                                                  GPIO_10_GPIO10,              \
+                                                  GPIO_11_GPIO11,              \
+                                                  GPIO_12_GPIO12,              \
+                                                  GPIO_13_GPIO13,              \
+                                                  GPIO_14_GPIO14,              \
+                                                  GPIO_15_GPIO15}
+
+//
+// ISEC of phase 1, board dependent, one conversion on TRIG1
+//
+#define CLLC_PHASE1_ISEC_ADC_MODULE              ADCB_BASE
+#define CLLC_PHASE1_ISEC_ADC_PIN                 ADC_CH_ADCIN1
+#define CLLC_PHASE1_ISEC_ADCRESULTREGBASE        ADCBRESULT_BASE
+#define CLLC_PHASE1_ISEC_ADC_SOC_NO              ADC_SOC_NUMBER6
+
+//
+// trim of the prim duty factor per ISR2 and pu of current above the mean,
+// and the largest trim, of the period
+//
+#define CLLC_PHASE_SHARE_KI                      ((float32_t)0.002)
+#define CLLC_PHASE_TRIM_MAX_PU                   ((float32_t)0.1)
+
+#if CLLC_PWM_UPDATE_MODE == CLLC_PWM_UPDATE_ISR1_PHASE_LOAD
 #define CLLC_GLOBAL_LOAD_ENABLED 0
+#else
+#define CLLC_GLOBAL_LOAD_ENABLED 1
+#endif
+
+//
+// ISR2 does not write the shadow registers while the counter of PRIM LEG1
+// counts down and is this close to the zero at which they are loaded. The
+// guard covers the writes of CLLC_updatePWMFromISR2, 7 for phase 0 and 6
+// for each other phase, from the read of the counter to the commit. The
+// time base runs at SYSCLK, so a tick is a cycle: a 32 bit write of a
+// computed value to the peripheral frame is taken as 6 cycles, the read of
+// the counter, the test and the commit as 16.
+//
+#define CLLC_PWM_UPDATE_WRITES      (7 + (6 * (CLLC_PHASES - 1)))
+#define CLLC_PWM_UPDATE_CYCLES_PER_WRITE 6
+#define CLLC_PWM_UPDATE_FIXED_CYCLES 16
+#define CLLC_PWM_UPDATE_GUARD_TICKS (CLLC_PWM_UPDATE_FIXED_CYCLES +         \
+                                     (CLLC_PWM_UPDATE_WRITES *               \
+                                      CLLC_PWM_UPDATE_CYCLES_PER_WRITE))
 
 #define CLLC_MAX_PERIOD_STEP_PU ((float32_t)0.05)
 
@@ -129,6 +202,15 @@
 #define CLLC_ISR3_PERIPHERAL_TRIG_BASE ADCC_BASE
 #define CLLC_ISR3_TRIG INT_ADCC2
 #define CLLC_ISR3_PIE_GROUP INTERRUPT_ACK_GROUP10
+
+//
+// Trip zone interrupt of the event trip decoding, CLLC_TRIP_DECODE_EVENT,
+// taken on the one-shot trips of PRIM LEG1, which all the board trips reach
+//
+#define CLLC_TRIP_EVENT_PWM_BASE CLLC_PRIM_LEG1_PWM_BASE
+#define CLLC_TRIP_EVENT_TRIG INT_EPWM1_TZ
+#define CLLC_TRIP_EVENT_PIE_GROUP INTERRUPT_ACK_GROUP2
+
 //
 // Compensator related
 //
@@ -138,6 +220,15 @@
 #define CLLC_GV_OUT_MAX   ((float32_t)0.98)
 #define CLLC_GV_OUT_MIN   ((float32_t)-0.1)
 
+//
+// 1 to scale the error of GV by the gain schedule over the slewed period,
+// CLLC_GV1_SCHEDULE_GAINS or CLLC_GV2_SCHEDULE_GAINS in cllc_settings.h,
+// see cllc_gvsched.h. CLLC_gvError then holds the scaled error.
+//
+#ifndef CLLC_GV_SCHEDULE
+#define CLLC_GV_SCHEDULE 0
+#endif
+
 #define CLLC_VOLTS_PER_SECOND_SLEW ((float32_t)10.0)
 #define CLLC_AMPS_PER_SECOND_SLEW ((float32_t)0.5)
 
@@ -146,18 +237,50 @@
 //
 
 //
-// 0 is disabled, 1 is enabled
+// ISEC and VSEC conversions averaged into one reading: 1, 2, 4, 8 or 11.
+// The SOCs from CLLC_xSEC_ADC_SOC_NO_1 on convert the signal that many
+// times, the first half on TRIG1 and the rest on TRIG2. Above 1 a DMA
+// channel per signal copies the results to RAM on the ADC interrupt of the
+// last SOC, and ISR2 adds up the copy instead of reading the ADC. 16 would
+// need 16 SOCs, ADCA and ADCC have 11 free, SOC2 to SOC12.
 //
-#define CLLC_OVERSAMPLING_ENABLED   1
-#define CLLC_VSEC_OVERSAMPLING_11x  1
+#ifndef CLLC_ADC_OVERSAMPLE
+#define CLLC_ADC_OVERSAMPLE 1
+#endif
+
+//
+// 1 to calibrate IPRIM, ISEC, VPRIM and VSEC: the ADC post processing
+// blocks take the zero code off each result and ISR2 scales it with one
+// multiply, gain, offset and the CalX and CalIntercept fit all in it. Frame
+// A then measures the zero of the currents while the bridges are tripped,
+// CLLC_ADC_SELFCAL_SAMPLES codes each. 0 reads the raw results as before.
+//
+#ifndef CLLC_ADC_CALIBRATION
+#define CLLC_ADC_CALIBRATION 0
+#endif
+
+#ifndef CLLC_ADC_SELFCAL_SAMPLES
+#define CLLC_ADC_SELFCAL_SAMPLES 64
+#endif
 
 //
 // ADC triggers
 //
+#if CLLC_PHASES > 1
+//
+// EPWM6 and EPWM7 drive phase 1, the SOC events of PRIM LEG2 and SEC LEG2
+// of phase 0 are free
+//
+#define CLLC_ADC_SOC_TRIG1 ADC_TRIGGER_EPWM2_SOCA
+#define CLLC_ADC_SOC_TRIG2 ADC_TRIGGER_EPWM2_SOCB
+#define CLLC_ADC_SOC_TRIG3 ADC_TRIGGER_EPWM4_SOCA
+#define CLLC_ADC_SOC_TRIG4 ADC_TRIGGER_EPWM4_SOCB
+#else
 #define CLLC_ADC_SOC_TRIG1 ADC_TRIGGER_EPWM6_SOCA
 #define CLLC_ADC_SOC_TRIG2 ADC_TRIGGER_EPWM6_SOCB
 #define CLLC_ADC_SOC_TRIG3 ADC_TRIGGER_EPWM7_SOCA
 #define CLLC_ADC_SOC_TRIG4 ADC_TRIGGER_EPWM7_SOCB
+#endif
 #define CLLC_ADC_SOC_TRIG5 ADC_TRIGGER_CPU1_TINT2
 
 #define CLLC_ADC_SOC_TRIG_CLLC_PWM_SYNC1 ADC_TRIGGER_EPWM1_SOCA
@@ -203,6 +326,10 @@
 #define CLLC_ISEC_ADCREAD_10 ADC_readResult(CLLC_ISEC_ADCRESULTREGBASE, CLLC_ISEC_ADC_SOC_NO_10)
 #define CLLC_ISEC_ADCREAD_11 ADC_readResult(CLLC_ISEC_ADCRESULTREGBASE, CLLC_ISEC_ADC_SOC_NO_11)
 
+#define CLLC_ISEC_OVERSAMPLE_ADC_INT   ADC_INT_NUMBER3
+#define CLLC_ISEC_OVERSAMPLE_DMA_BASE  DMA_CH1_BASE
+#define CLLC_ISEC_OVERSAMPLE_DMA_TRIG  DMA_TRIGGER_ADCA3
+
 
 //
 // Signals mapped to ADC -B
@@ -267,6 +394,10 @@
 #define CLLC_VSEC_ADCREAD_10 ADC_readResult(CLLC_VSEC_ADCRESULTREGBASE, CLLC_VSEC_ADC_SOC_NO_10)
 #define CLLC_VSEC_ADCREAD_11 ADC_readResult(CLLC_VSEC_ADCRESULTREGBASE, CLLC_VSEC_ADC_SOC_NO_11)
 
+#define CLLC_VSEC_OVERSAMPLE_ADC_INT   ADC_INT_NUMBER3
+#define CLLC_VSEC_OVERSAMPLE_DMA_BASE  DMA_CH2_BASE
+#define CLLC_VSEC_OVERSAMPLE_DMA_TRIG  DMA_TRIGGER_ADCC3
+
 
 //
 // Signals mapped to ADC -A
@@ -279,12 +410,28 @@
 #define CLLC_IPRIM_ADC_SOC_NO          ADC_SOC_NUMBER13
 #define CLLC_IPRIM_ADCREAD ADC_readResult(CLLC_IPRIM_ADCRESULTREGBASE, CLLC_IPRIM_ADC_SOC_NO)
 
+//
+// ADC post processing blocks of the calibration, one per signal on the SOC
+// ISR2 reads, and the gain of each sense chain after its offset: the
+// currents are bipolar around mid scale, IPRIM inverted
+//
+#define CLLC_IPRIM_ADC_PPB             ADC_PPB_NUMBER1
+#define CLLC_ISEC_ADC_PPB              ADC_PPB_NUMBER2
+#define CLLC_VPRIM_ADC_PPB             ADC_PPB_NUMBER1
+#define CLLC_VSEC_ADC_PPB              ADC_PPB_NUMBER1
+
+#define CLLC_IPRIM_SENSE_CHAIN_GAIN    ((float32_t)-2.0)
+#define CLLC_ISEC_SENSE_CHAIN_GAIN     ((float32_t)2.0)
+#define CLLC_VPRIM_SENSE_CHAIN_GAIN    ((float32_t)1.0)
+#define CLLC_VSEC_SENSE_CHAIN_GAIN     (CLLC_VSEC_MAX_SENSE_VOLTS /            \
+                                        CLLC_VSEC_OPTIMAL_RANGE_VOLTS)
+
 //
 // Macros for reading the ADCs
 //
 #define CLLC_VPRIM_ADCREAD (CLLC_VPRIM_ADCREAD_1)
 
-#if CLLC_OVERSAMPLING_ENABLED == 1
+#if CLLC_ADC_OVERSAMPLE > 1
 //
 // 4x oversample
 //
@@ -298,42 +445,21 @@
 
 #define CLLC_VSEC_ADCREAD (CLLC_VSEC_ADCREAD_1)
 
-#if CLLC_OVERSAMPLING_ENABLED == 1
-    #if CLLC_VSEC_OVERSAMPLING_11x == 1
-        #define CLLC_VSEC_OVERSAMPLE_ADCREAD ((CLLC_VSEC_ADCREAD_1 + CLLC_VSEC_ADCREAD_2 + CLLC_VSEC_ADCREAD_3 + CLLC_VSEC_ADCREAD_4 + CLLC_VSEC_ADCREAD_5 + CLLC_VSEC_ADCREAD_6 + CLLC_VSEC_ADCREAD_7 + CLLC_VSEC_ADCREAD_8 + CLLC_VSEC_ADCREAD_9 + CLLC_VSEC_ADCREAD_10 + CLLC_VSEC_ADCREAD_11 ) * (0.0909090))
-    #else
+#if CLLC_ADC_OVERSAMPLE > 1
 //
-// 4x oversample
+// sum of the CLLC_ADC_OVERSAMPLE conversions the DMA copied last
 //
-
-//        #define CLLC_VSEC_OVERSAMPLE_ADCREAD ((CLLC_VSEC_ADCREAD_1 + CLLC_VSEC_ADCREAD_2 + CLLC_VSEC_ADCREAD_3 + CLLC_VSEC_ADCREAD_4) * (0.25))
-
-//
-// 2x oversample
-//
-         #define CLLC_VSEC_OVERSAMPLE_ADCREAD ((CLLC_VSEC_ADCREAD_1 + CLLC_VSEC_ADCREAD_2) * (0.5f))
-    #endif
+#define CLLC_VSEC_OVERSAMPLE_ADCREAD                                          \
+            CLLC_HAL_sumOversample(CLLC_VSEC_OVERSAMPLE_DMA_BASE,             \
+                                   CLLC_HAL_vSecOversample)
 #endif
 
 #define CLLC_ISEC_ADCREAD (CLLC_ISEC_ADCREAD_1)
 
-#if CLLC_OVERSAMPLING_ENABLED == 1
-#if CLLC_VSEC_OVERSAMPLING_11x == 1
-    //
-    // 12x oversample
-    //
-    #define CLLC_ISEC_OVERSAMPLE_ADCREAD ((CLLC_ISEC_ADCREAD_1 + CLLC_ISEC_ADCREAD_2 + CLLC_ISEC_ADCREAD_3 + CLLC_ISEC_ADCREAD_4 + CLLC_ISEC_ADCREAD_5 + CLLC_ISEC_ADCREAD_6 + CLLC_ISEC_ADCREAD_7 + CLLC_ISEC_ADCREAD_8 + CLLC_ISEC_ADCREAD_9 + CLLC_ISEC_ADCREAD_10 + CLLC_ISEC_ADCREAD_11 ) * (0.0909090))
-#else
-//
-// 4x oversample
-//
-//    #define CLLC_ISEC_OVERSAMPLE_ADCREAD ((CLLC_ISEC_ADCREAD_1 + CLLC_ISEC_ADCREAD_2 + CLLC_ISEC_ADCREAD_3 + CLLC_ISEC_ADCREAD_4) * (0.25))
-
-//
-// 2x oversample
-//
-    #define CLLC_ISEC_OVERSAMPLE_ADCREAD ((CLLC_ISEC_ADCREAD_1 + CLLC_ISEC_ADCREAD_2) * (0.5f))
-#endif
+#if CLLC_ADC_OVERSAMPLE > 1
+#define CLLC_ISEC_OVERSAMPLE_ADCREAD                                          \
+            CLLC_HAL_sumOversample(CLLC_ISEC_OVERSAMPLE_DMA_BASE,             \
+                                   CLLC_HAL_iSecOversample)
 #endif
 
 #if CLLC_PROTECTION == CLLC_PROTECTION_ENABLED
@@ -547,7 +673,10 @@
 // SFRA related
 //
 #define CLLC_SFRA_GUI_SCI_BASE SCIA_BASE
-#define CLLC_SCI_VBUS_CLK 50000000
+//
+// LSPCLK, SYSCLK / 4 as device.h sets it up, the SCI clock
+//
+#define CLLC_SCI_VBUS_CLK 30000000
 #define CLLC_SFRA_GUI_SCI_BAUDRATE 57600
 
 #define CLLC_SFRA_GUI_SCIRX_GPIO 28
@@ -586,12 +715,30 @@
 #define CLLC_TASKB_FREQ_HZ 10
 #define CLLC_TASKC_FREQ_HZ CLLC_ISR3_FREQUENCY_HZ
 
+//
+// periods of the background scheduler frames (cllc_scheduler.h), a CPU
+// timer counts from PRD down to 0, PRD + 1 cycles
+//
+#define CLLC_TASKA_PERIOD_CYCLES                                              \
+            ((uint32_t)(DEVICE_SYSCLK_FREQ / CLLC_TASKA_FREQ_HZ) + 1U)
+#define CLLC_TASKB_PERIOD_CYCLES                                              \
+            ((uint32_t)(DEVICE_SYSCLK_FREQ / CLLC_TASKB_FREQ_HZ) + 1U)
+
 #define CLLC_GET_TASKA_TIMER_OVERFLOW_STATUS CPUTimer_getTimerOverflowStatus(CLLC_TASKA_CPUTIMER_BASE)
 #define CLLC_CLEAR_TASKA_TIMER_OVERFLOW_FLAG CPUTimer_clearOverflowFlag(CLLC_TASKA_CPUTIMER_BASE)
 
 #define CLLC_GET_TASKB_TIMER_OVERFLOW_STATUS CPUTimer_getTimerOverflowStatus(CLLC_TASKB_CPUTIMER_BASE)
 #define CLLC_CLEAR_TASKB_TIMER_OVERFLOW_FLAG CPUTimer_clearOverflowFlag(CLLC_TASKB_CPUTIMER_BASE)
 
+//
+// multipliers of the averages ISR3 takes of the sensed signals per run
+// (cllc_avg.h), 0.01 averages over about 100 runs, 10 ms
+//
+#define CLLC_AVG_ISEC_MULTIPLIER        ((float32_t)0.01)
+#define CLLC_AVG_IPRIM_MULTIPLIER       ((float32_t)0.01)
+#define CLLC_AVG_VSEC_MULTIPLIER        ((float32_t)0.01)
+#define CLLC_AVG_VPRIM_MULTIPLIER       ((float32_t)0.01)
+
 //
 // Profiling related
 //
@@ -604,6 +751,32 @@
 #define CLLC_PROFILING1_ECAP_XBAR_MUX      ECAP_INPUT_INPUTXBAR15
 #define CLLC_PROFILING2_ECAP_XBAR_MUX      ECAP_INPUT_INPUTXBAR16
 
+//
+// ERAD profiling, a counter per ISR started by a bus comparator on the
+// entry of the ISR and stopped by one on the write of its exit mark
+//
+#define CLLC_ISR1_ERAD_ENTRY_BUSCOMP_BASE  ERAD_HWBP1_BASE
+#define CLLC_ISR1_ERAD_EXIT_BUSCOMP_BASE   ERAD_HWBP2_BASE
+#define CLLC_ISR1_ERAD_COUNTER_BASE        ERAD_COUNTER1_BASE
+#define CLLC_ISR2_ERAD_ENTRY_BUSCOMP_BASE  ERAD_HWBP3_BASE
+#define CLLC_ISR2_ERAD_EXIT_BUSCOMP_BASE   ERAD_HWBP4_BASE
+#define CLLC_ISR2_ERAD_COUNTER_BASE        ERAD_COUNTER2_BASE
+#define CLLC_ISR3_ERAD_ENTRY_BUSCOMP_BASE  ERAD_HWBP5_BASE
+#define CLLC_ISR3_ERAD_EXIT_BUSCOMP_BASE   ERAD_HWBP6_BASE
+#define CLLC_ISR3_ERAD_COUNTER_BASE        ERAD_COUNTER3_BASE
+
+//
+// histogram bin widths as a power of 2 in cycles, 32 bins each. ISR2 has
+// 1000 cycles at 120 kHz, ISR3 is preempted by both and its latency holds
+// the ADC conversion.
+//
+#define CLLC_ISR1_PROFILER_LATENCY_SHIFT   2
+#define CLLC_ISR1_PROFILER_EXECUTION_SHIFT 4
+#define CLLC_ISR2_PROFILER_LATENCY_SHIFT   2
+#define CLLC_ISR2_PROFILER_EXECUTION_SHIFT 5
+#define CLLC_ISR3_PROFILER_LATENCY_SHIFT   5
+#define CLLC_ISR3_PROFILER_EXECUTION_SHIFT 7
+
 #define CLLC_DAC_BASE DACB_BASE
 
 
@@ -612,7 +785,196 @@
 //    0: disabled
 //    1: enabled
 //
+#ifndef CLLC_DATALOGGER_ENABLE
 #define CLLC_DATALOGGER_ENABLE 0
+#endif
+
+//
+// Datalogger (cllc_datalog.h), logged by ISR2 or, with ISR2 on the CLA, by
+// ISR3 from the telemetry. The channels and their decimation in ISR2 runs,
+// the ring in records of one sample, a power of 2, the records kept ahead
+// of the trigger and taken from it on, and the samples per channel the
+// background keeps for the graph window. Triggers on a trip and on
+// CLLC_dataLogSoftwareTrigger.
+//
+#define CLLC_DATALOG_CHANNELS           4
+#define CLLC_DATALOG_CH0                CLLC_ISR2_OUTPUT(vSecSensed_pu)
+#define CLLC_DATALOG_CH0_DECIMATION     1
+#define CLLC_DATALOG_CH1                CLLC_ISR2_OUTPUT(iSecSensed_pu)
+#define CLLC_DATALOG_CH1_DECIMATION     1
+#define CLLC_DATALOG_CH2                CLLC_ISR2_OUTPUT(iPrimSensed_pu)
+#define CLLC_DATALOG_CH2_DECIMATION     1
+#define CLLC_DATALOG_CH3                CLLC_ISR2_OUTPUT(pwmPeriod_pu)
+#define CLLC_DATALOG_CH3_DECIMATION     1
+#define CLLC_DATALOG_RING_SIZE          256
+#define CLLC_DATALOG_PRE_TRIGGER        128
+#define CLLC_DATALOG_POST_TRIGGER       384
+#define CLLC_DATALOG_CAPTURE_SIZE       128
+#define CLLC_DATALOG_TRIGGER_SOURCES    (CLLC_DATALOG_TRIGGER_EVENT |         \
+                                         CLLC_DATALOG_TRIGGER_SOFTWARE)
+#define CLLC_DATALOG_TRIGGER_CHANNEL    0
+#define CLLC_DATALOG_TRIGGER_LEVEL      0.5f
+
+//
+// Telemetry enable
+//    0: disabled
+//    1: enabled
+//
+#ifndef CLLC_TELEMETRY_ENABLE
+#define CLLC_TELEMETRY_ENABLE 0
+#endif
+
+//
+// Telemetry stream (cllc_telemetry.h), sampled by ISR3 and sent out on
+// SCIB. A data frame every CLLC_TELEMETRY_DECIMATION runs of ISR3, the
+// schema every CLLC_TELEMETRY_SCHEMA_PERIOD data frames, the ring in bytes,
+// a power of 2. The SCI runs at LSPCLK / 16, its fastest, as the baud
+// rate register divides LSPCLK by 16 at least: 1.875 Mbaud carry
+// 187.5 kB/s, the 28 byte frames of the 4 variables below at 5 kHz 140 kB/s.
+//
+#define CLLC_TELEMETRY_SCI_BASE         SCIB_BASE
+#define CLLC_TELEMETRY_SCI_BAUDRATE     (CLLC_SCI_VBUS_CLK / 16)
+#define CLLC_TELEMETRY_SCITX_GPIO_PIN_CONFIG GPIO_9_SCIB_TX
+#define CLLC_TELEMETRY_TRIG             INT_SCIB_TX
+#define CLLC_TELEMETRY_PIE_GROUP        INTERRUPT_ACK_GROUP9
+#define CLLC_TELEMETRY_RING_SIZE        1024
+#define CLLC_TELEMETRY_DECIMATION       2
+#define CLLC_TELEMETRY_SCHEMA_PERIOD    1000
+#define CLLC_TELEMETRY_VARIABLES        4
+#define CLLC_TELEMETRY_VAR0             CLLC_ISR2_OUTPUT(vSecSensed_pu)
+#define CLLC_TELEMETRY_VAR0_NAME        "vSecSensed"
+#define CLLC_TELEMETRY_VAR1             CLLC_ISR2_OUTPUT(iSecSensed_pu)
+#define CLLC_TELEMETRY_VAR1_NAME        "iSecSensed"
+#define CLLC_TELEMETRY_VAR2             CLLC_ISR2_OUTPUT(iPrimSensed_pu)
+#define CLLC_TELEMETRY_VAR2_NAME        "iPrimSensed"
+#define CLLC_TELEMETRY_VAR3             CLLC_ISR2_OUTPUT(pwmPeriod_pu)
+#define CLLC_TELEMETRY_VAR3_NAME        "pwmPeriod"
+
+//
+// With CLLC_TELEMETRY_STATS 1 the counters of cllc_stats.h for ISR1
+// re-triggers, ISR2 and ISR3 overruns and the trips by cause follow the
+// variables, 24 bytes more per data frame
+//
+#ifndef CLLC_TELEMETRY_STATS
+#define CLLC_TELEMETRY_STATS            0
+#endif
+
+//
+// FSI link enable
+//    0: disabled
+//    1: enabled
+//
+#ifndef CLLC_FSI_ENABLE
+#define CLLC_FSI_ENABLE 0
+#endif
+
+//
+// FSI link (cllc_fsilink.h), a sample frame out every ISR2 run, setpoint
+// frames in, taken at the start of ISR3. One lane at TXCLK = SYSCLK /
+// CLLC_FSI_PRESCALER = 40 MHz, 2 bits per clock: the 9 word sample frame
+// takes 2.2 us of the 8.3 us between ISR2 runs. A setpoint is in use at
+// most one ISR3 period after it landed. The receiver takes the setpoints
+// within the limits below. GPIO50, the second transmit lane, stays free
+// for CLLC_GPIO_STEPCHANGEFREQ.
+//
+#define CLLC_FSI_TX_BASE                FSITXA_BASE
+#define CLLC_FSI_RX_BASE                FSIRXA_BASE
+#define CLLC_FSI_PRESCALER              3
+#define CLLC_FSI_TX_D0_PIN_CONFIG       GPIO_49_FSITXA_D0
+#define CLLC_FSI_TX_CLK_PIN_CONFIG      GPIO_51_FSITXA_CLK
+#define CLLC_FSI_RX_D0_GPIO             52
+#define CLLC_FSI_RX_D0_PIN_CONFIG       GPIO_52_FSIRXA_D0
+#define CLLC_FSI_RX_CLK_GPIO            54
+#define CLLC_FSI_RX_CLK_PIN_CONFIG      GPIO_54_FSIRXA_CLK
+#define CLLC_FSI_VSEC_REF_MIN_VOLTS     ((float32_t)0)
+#define CLLC_FSI_VSEC_REF_MAX_VOLTS     CLLC_VSEC_OPTIMAL_RANGE_VOLTS
+#define CLLC_FSI_ISEC_REF_MIN_AMPS      ((float32_t)0)
+#define CLLC_FSI_ISEC_REF_MAX_AMPS      CLLC_ISEC_TRIP_LIMIT_AMPS
+#define CLLC_FSI_PWM_FREQUENCY_MIN_HZ   CLLC_MIN_PWM_SWITCHING_FREQUENCY_HZ
+#define CLLC_FSI_PWM_FREQUENCY_MAX_HZ   CLLC_MAX_PWM_SWITCHING_FREQUENCY_HZ
+
+#if CLLC_FSI_ENABLE == 1
+#if CLLC_PROFILING == CLLC_PROFILING_GPIO
+    #warning GPIO49 resource conflict between FSITXA_D0 and CLLC_GPIO_PROFILING3
+#endif
+#endif
+
+//
+// Current sharing role, see cllc_settings.h, needs the FSI link
+//
+#ifndef CLLC_SHARE_ROLE
+#define CLLC_SHARE_ROLE CLLC_SHARE_NONE
+#endif
+
+//
+// Current sharing (cllc_share.h). The share frames take the FSI in place of
+// the samples, master TX to the RX of the first follower, its TX to the
+// next, the master still takes setpoints on its RX. The droop takes 0.2 Ohm,
+// 1% of the nominal output at 17.5 A, all boards alike. The current loop
+// of a follower integrates the current error into the trim at
+// CLLC_SHARE_TRIM_VOLTS_PER_AMP_S, up to 5 V. It settles with the droop
+// and the output resistance of the board over the gain, 20 ms on the droop
+// alone, twice the 10 ms of the averaged ISEC it closes on.
+// A follower falls back to the droop after CLLC_SHARE_TIMEOUT_POLLS ISR3
+// runs without a reference, 1 ms, and trims again after
+// CLLC_SHARE_RECOVER_FRAMES references in a row.
+//
+#define CLLC_SHARE_DROOP_OHMS           ((float32_t)0.2)
+#define CLLC_SHARE_DROOP_PU             (CLLC_SHARE_DROOP_OHMS *              \
+                                         CLLC_ISEC_MAX_SENSE_AMPS /           \
+                                         CLLC_VSEC_OPTIMAL_RANGE_VOLTS)
+#define CLLC_SHARE_TRIM_VOLTS_PER_AMP_S ((float32_t)10.0)
+#define CLLC_SHARE_TRIM_GAIN            (CLLC_SHARE_TRIM_VOLTS_PER_AMP_S *    \
+                                         CLLC_ISEC_MAX_SENSE_AMPS /           \
+                                         CLLC_VSEC_OPTIMAL_RANGE_VOLTS /      \
+                                         CLLC_ISR3_FREQUENCY_HZ)
+#define CLLC_SHARE_TRIM_MAX_VOLTS       ((float32_t)5.0)
+#define CLLC_SHARE_TRIM_MAX_PU          (CLLC_SHARE_TRIM_MAX_VOLTS /          \
+                                         CLLC_VSEC_OPTIMAL_RANGE_VOLTS)
+#define CLLC_SHARE_TIMEOUT_POLLS        10
+#define CLLC_SHARE_RECOVER_FRAMES       5
+
+//
+// CAN-FD service enable
+//    0: disabled
+//    1: enabled
+//
+#ifndef CLLC_CAN_ENABLE
+#define CLLC_CAN_ENABLE 0
+#endif
+
+//
+// CAN-FD service (cllc_canlink.h) on MCANA, run every
+// CLLC_CAN_TICK_DECIMATION ISR3 runs, a 1 ms tick. The report periods are
+// in ticks and their common period must stay within
+// CLLC_CANLINK_SLOTS_MAX. The MCAN runs from SYSCLK: 500 kbit/s nominal,
+// 120 MHz / 12 / (1 + 15 + 4), and 2 Mbit/s in the data phase,
+// 120 MHz / 3 / (1 + 15 + 4), both sampled at 80 %. The setpoints are taken
+// within the limits of the FSI link.
+//
+#define CLLC_CAN_BASE                   MCANA_DRIVER_BASE
+#define CLLC_CAN_TX_PIN_CONFIG          GPIO_13_MCAN_TX
+#define CLLC_CAN_RX_PIN_CONFIG          GPIO_12_MCAN_RX
+#define CLLC_CAN_RX_GPIO                12
+#define CLLC_CAN_BASE_ID                0x300
+#define CLLC_CAN_TICK_DECIMATION        10
+#define CLLC_CAN_STATUS_PERIOD_TICKS    100
+#define CLLC_CAN_MEASUREMENTS_PERIOD_TICKS 10
+#define CLLC_CAN_LOOP_PERIOD_TICKS      20
+#define CLLC_CAN_NOM_PRESCALER          11
+#define CLLC_CAN_NOM_TSEG1              14
+#define CLLC_CAN_NOM_TSEG2              3
+#define CLLC_CAN_NOM_SJW                3
+#define CLLC_CAN_DATA_PRESCALER         2
+#define CLLC_CAN_DATA_TSEG1             14
+#define CLLC_CAN_DATA_TSEG2             3
+#define CLLC_CAN_DATA_SJW               3
+#define CLLC_CAN_VSEC_REF_MIN_VOLTS     CLLC_FSI_VSEC_REF_MIN_VOLTS
+#define CLLC_CAN_VSEC_REF_MAX_VOLTS     CLLC_FSI_VSEC_REF_MAX_VOLTS
+#define CLLC_CAN_ISEC_REF_MIN_AMPS      CLLC_FSI_ISEC_REF_MIN_AMPS
+#define CLLC_CAN_ISEC_REF_MAX_AMPS      CLLC_FSI_ISEC_REF_MAX_AMPS
+#define CLLC_CAN_PWM_FREQUENCY_MIN_HZ   CLLC_FSI_PWM_FREQUENCY_MIN_HZ
+#define CLLC_CAN_PWM_FREQUENCY_MAX_HZ   CLLC_FSI_PWM_FREQUENCY_MAX_HZ
 
 #ifdef BUILD_F28003X
 #if CLLC_BOARD_PROTECTION_IPRIM == 1 ||  CLLC_BOARD_PROTECTION_ISEC == 1 || CLLC_BOARD_PROTECTION_VSEC == 1
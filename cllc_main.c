@@ -14,42 +14,65 @@
 //#############################################################################
 #include "cllc.h"
 
+#include "cllc_scheduler.h"
+
 //
-//---  State Machine Related ---
+// Background tasks, run by the scheduler from the CPU timer ticks
 //
-int16_t vTimer0[4];         // Virtual Timers slaved off CPU Timers (A events)
-int16_t vTimer1[4];         // Virtual Timers slaved off CPU Timers (B events)
+#if CLLC_SFRA_TYPE != CLLC_SFRA_DISABLED
+static void CLLC_runSFRATask(void);
+#endif
+#if CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_BACKGROUND
+static void CLLC_runTripDecodeTask(void);
+#endif
+#if CLLC_ADC_CALIBRATION == 1
+static void CLLC_runADCSelfCalTask(void);
+#endif
+static void CLLC_runStatsSnapshotTask(void);
 
 //
-// Variable declarations for state machine
+// budgets of the background tasks
 //
-void (*Alpha_State_Ptr)(void);  // Base States pointer
-void (*A_Task_Ptr)(void);       // State pointer A branch
-void (*B_Task_Ptr)(void);       // State pointer B branch
-void (*C_Task_Ptr)(void);       // State pointer C branch
+#define CLLC_TASK_BUDGET_CYCLES(us)                                           \
+            ((uint32_t)(DEVICE_SYSCLK_FREQ / 1000000UL) * (us))
 
 //
-// State Machine function prototypes
-//------------------------------------
-// Alpha states
+// Task table, frame A runs at CLLC_TASKA_FREQ_HZ, frame B at
+// CLLC_TASKB_FREQ_HZ
 //
-void A0(void);  //state A0
-void B0(void);  //state B0
+static const CLLC_SCHEDULER_Task CLLC_schedulerTask[] =
+{
+#if CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_BACKGROUND
+    {"tripDecode", &CLLC_runTripDecodeTask, CLLC_SCHEDULER_FRAME_A, 1, 0,
+     CLLC_TASK_BUDGET_CYCLES(5)},
+#endif
+#if CLLC_SFRA_TYPE != CLLC_SFRA_DISABLED
+    {"sfra", &CLLC_runSFRATask, CLLC_SCHEDULER_FRAME_A, 1, 0,
+     CLLC_TASK_BUDGET_CYCLES(200)},
+#endif
+#if CLLC_ADC_CALIBRATION == 1
+    {"adcSelfCal", &CLLC_runADCSelfCalTask, CLLC_SCHEDULER_FRAME_A, 1, 0,
+     CLLC_TASK_BUDGET_CYCLES(10)},
+#endif
+    {"statsSnapshot", &CLLC_runStatsSnapshotTask, CLLC_SCHEDULER_FRAME_B,
+     1, 0, CLLC_TASK_BUDGET_CYCLES(20)},
+};
+
+#define CLLC_SCHEDULER_TASKS                                                  \
+            (sizeof(CLLC_schedulerTask) / sizeof(CLLC_schedulerTask[0]))
 
 //
-// A branch states
+// scheduler state and the task run times, for the watch window
 //
-void A1(void);  //state A1
+CLLC_SCHEDULER_Scheduler CLLC_scheduler;
+CLLC_SCHEDULER_TaskStats CLLC_schedulerTaskStats[CLLC_SCHEDULER_TASKS];
+uint16_t CLLC_schedulerRejectedTasks;
 
 //
-// B branch states
+// consistent copy of CLLC_stats, taken by frame B
 //
-void B1(void);  //state B1
-void B2(void);  //state B2
-void B3(void);  //state B3
-uint32_t  CLLC_countcheckISR1;
-uint32_t  CLLC_countcheckISR2;
-uint32_t  CLLC_countcheckISR3;
+CLLC_STATS_Counters CLLC_statsSnapshot;
+
 //
 // Note that the watchdog is disabled in codestartbranch.asm
 // for this project. This is to prevent it from expiring while
@@ -80,15 +103,27 @@ void main(void)
     //                       
     CLLC_HAL_setupADC();
 
+#if CLLC_ADC_CALIBRATION == 1
+    //
+    // gains and zeros of the readings, zeros into the PPBs
+    //
+    CLLC_setupADCCalibration();
+#endif
+
     //
     // setup trigger for the ADC conversions
     //
     CLLC_HAL_setupTrigForADC();
 
     //
-    // Profiling GPIO
+    // Profiling GPIO or ERAD
     //
+#if CLLC_PROFILING == CLLC_PROFILING_GPIO
     CLLC_HAL_setupProfilingGPIO();
+#elif CLLC_PROFILING == CLLC_PROFILING_ERAD
+    CLLC_HAL_setupERADProfiler(
+            CLLC_powerFlowStateActive.CLLC_PowerFlowState_Enum);
+#endif
 
     //
     // clear any spurious flags
@@ -103,14 +138,25 @@ void main(void)
     //
     // Set global load to one-shot mode
     //
+#if CLLC_GLOBAL_LOAD_ENABLED == 1
+    CLLC_HAL_setupGlobalLoad();
+#else
     HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_GLDCTL) = 0xA1;
     HWREGH(CLLC_PRIM_LEG2_PWM_BASE + EPWM_O_GLDCTL) = 0xA7;
+#endif
     //
     // Link EPWM2 to EPWM1
     //
     HWREG(CLLC_PRIM_LEG2_PWM_BASE + EPWM_O_XLINK) &= ~(0xF0000000);
     EDIS;
 
+#if CLLC_PHASES > 1
+    //
+    // the PWMs of the other phases, linked to those above
+    //
+    CLLC_setupPhases();
+#endif
+
     //
     // setup PWM pins
     //
@@ -135,35 +181,102 @@ void main(void)
     
     //
     // as LLC is resonant and frequency changes,
-    // for ISR separate fixed frequency PWM is configured
+    // for ISR separate fixed frequency PWM is configured, unless it drives
+    // phase 1, the ECAP alone times ISR2
     //
+#if CLLC_PHASES == 1
     CLLC_HAL_setupPWMinUpDownCountMode(CLLC_ISR2_PWM_BASE,
                                CLLC_ISR2_FREQUENCY_HZ,
                                CLLC_PWMSYSCLOCK_FREQ_HZ);
+#endif
     CLLC_HAL_setupECAPinPWMMode(CLLC_ISR2_ECAP_BASE,
                                  CLLC_ISR2_FREQUENCY_HZ,
                                  CLLC_PWMSYSCLOCK_FREQ_HZ);
 
+    //
+    // SFRA object and GUI comms, no-op unless CLLC_SFRA_TYPE selects a loop
+    //
+    CLLC_setupSFRA();
+
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+    //
+    // the first setpoints are in place before the CLA runs ISR2
+    //
+    CLLC_HAL_initCLAMessageRAM();
+    CLLC_initCLASetpoints();
+#endif
+
+#if CLLC_TELEMETRY_ENABLE == 1
+    //
+    // telemetry stream out on the SCI
+    //
+    CLLC_HAL_setupTelemetrySCI();
+#endif
+
+#if CLLC_FSI_ENABLE == 1
+    //
+    // samples out and setpoints in on the FSI
+    //
+    CLLC_HAL_setupFSI();
+#endif
+
+#if CLLC_CAN_ENABLE == 1
+    //
+    // reports out and commands in on the MCAN
+    //
+    CLLC_HAL_setupMCAN();
+#endif
+
+    //
+    // background scheduler, frames A and B on the task A and B CPU timers
+    //
+    CLLC_schedulerRejectedTasks = CLLC_SCHEDULER_config(&CLLC_scheduler,
+                                                  CLLC_schedulerTask,
+                                                  CLLC_schedulerTaskStats,
+                                                  CLLC_SCHEDULER_TASKS);
+    CLLC_SCHEDULER_configFrame(&CLLC_scheduler, CLLC_SCHEDULER_FRAME_A,
+                               &CLLC_HAL_getTaskAElapsedCycles,
+                               CLLC_TASKA_PERIOD_CYCLES);
+    CLLC_SCHEDULER_configFrame(&CLLC_scheduler, CLLC_SCHEDULER_FRAME_B,
+                               &CLLC_HAL_getTaskBElapsedCycles,
+                               CLLC_TASKB_PERIOD_CYCLES);
+
     //
     // ISR Mapping
     //
     CLLC_HAL_setupInterrupt(CLLC_powerFlowStateActive.CLLC_PowerFlowState_Enum);
 
     //
-    // IDLE loop. Just sit and loop forever, periodically will branch into
-    // A0-A3, B0-B3, C0-C3 tasks
-    // Frequency of this branching is set in setupDevice routine:
+    // IDLE loop. Just sit and loop forever, runs a scheduler frame on each
+    // overflow of its CPU timer, frame A ahead of frame B and at most one
+    // frame per pass, periods set in setupDevice routine
     //
     for(;;)
     {
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
         //
-        // State machine entry & exit point
-        //===========================================================
+        // hand the references to ISR2 on the CLA
         //
-        // (*Alpha_State_Ptr)();   // jump to an Alpha state (A0,B0,...)
+        CLLC_sendCLASetpoints();
+#endif
+
+#if CLLC_DATALOGGER_ENABLE == 1
         //
-        //===========================================================
+        // drain the datalogger ring
         //
+        CLLC_runDataLogBackground();
+#endif
+
+        if(CLLC_GET_TASKA_TIMER_OVERFLOW_STATUS == 1)
+        {
+            CLLC_CLEAR_TASKA_TIMER_OVERFLOW_FLAG;
+            CLLC_SCHEDULER_runFrame(&CLLC_scheduler, CLLC_SCHEDULER_FRAME_A);
+        }
+        else if(CLLC_GET_TASKB_TIMER_OVERFLOW_STATUS == 1)
+        {
+            CLLC_CLEAR_TASKB_TIMER_OVERFLOW_FLAG;
+            CLLC_SCHEDULER_runFrame(&CLLC_scheduler, CLLC_SCHEDULER_FRAME_B);
+        }
     } //END MAIN CODE
 }
 // 
@@ -174,14 +287,15 @@ void main(void)
 #if CLLC_ISR1_RUNNING_ON == C28x_CORE
 interrupt void CLLC_ISR1(void)
 {
+    CLLC_HAL_startERADProfilingISR1();
     CLLC_HAL_setProfilingGPIO1();
 
     CLLC_runISR1();
 
     CLLC_HAL_clearISR1InterruputFlag();
-    CLLC_countcheckISR1+=1;
+    CLLC_STATS_COUNT(isr1Count);
     CLLC_HAL_resetProfilingGPIO1();
-
+    CLLC_HAL_stopERADProfilingISR1();
 }
 #endif
 
@@ -201,157 +315,152 @@ interrupt void CLLC_ISR1_second(void)
 #endif
 
 #if CLLC_ISR2_RUNNING_ON == C28x_CORE
+//
+// The ISR2 and ISR3 timebases restart at the start of their periods, a
+// latency at the end below the one at the start is a run into the next
+// period
+//
 interrupt void CLLC_ISR2_primToSecPowerFlow(void)
 {
+    uint32_t entryCycles = CLLC_HAL_getISR2LatencyCycles();
+
+    CLLC_HAL_startERADProfilingISR2();
     //
     // enable group 3 interrupt only to interrupt ISR2
     //
     IER |= 0x4;
     IER &= 0x4;
     EINT;
-    CLLC_countcheckISR2+=1;
+    CLLC_STATS_COUNT(isr2Count);
     CLLC_HAL_setProfilingGPIO2();
     CLLC_runISR2_primToSecPowerFlow();
+#if CLLC_DATALOGGER_ENABLE == 1
+    CLLC_runDataLog();
+#endif
+#if (CLLC_FSI_ENABLE == 1) && (CLLC_SHARE_ROLE == CLLC_SHARE_NONE)
+    CLLC_runFSITx();
+#endif
     CLLC_HAL_resetProfilingGPIO2();
     DINT;
+    if(CLLC_HAL_getISR2LatencyCycles() < entryCycles)
+    {
+        CLLC_STATS_COUNT(isr2Overruns);
+    }
     CLLC_HAL_clearISR2PeripheralInterruptFlag();
     CLLC_HAL_clearISR2InterruputFlag();
+    CLLC_HAL_stopERADProfilingISR2();
 }
 
 interrupt void CLLC_ISR2_secToPrimPowerFlow(void)
 {
+    uint32_t entryCycles = CLLC_HAL_getISR2LatencyCycles();
+
+    CLLC_HAL_startERADProfilingISR2();
     //
     // enable group 3 interrupt only to interrupt ISR2
     //
     IER |= 0x4;
     IER &= 0x4;
     EINT;
+    CLLC_STATS_COUNT(isr2Count);
     CLLC_runISR2_secToPrimPowerFlow();
+#if CLLC_DATALOGGER_ENABLE == 1
+    CLLC_runDataLog();
+#endif
+#if CLLC_FSI_ENABLE == 1
+    CLLC_runFSITx();
+#endif
     DINT;
+    if(CLLC_HAL_getISR2LatencyCycles() < entryCycles)
+    {
+        CLLC_STATS_COUNT(isr2Overruns);
+    }
     CLLC_HAL_clearISR2InterruputFlag();
+    CLLC_HAL_stopERADProfilingISR2();
 }
 #endif
 
 interrupt void CLLC_ISR3(void)
 {
+    uint32_t entryCycles = CLLC_HAL_getISR3LatencyCycles();
+
+    CLLC_HAL_startERADProfilingISR3();
     EINT;
     CLLC_HAL_setProfilingGPIO3();
     CLLC_runISR3();
     CLLC_HAL_resetProfilingGPIO3();
-    CLLC_countcheckISR3+=1;
+    CLLC_STATS_COUNT(isr3Count);
     DINT;
+    if(CLLC_HAL_getISR3LatencyCycles() < entryCycles)
+    {
+        CLLC_STATS_COUNT(isr3Overruns);
+    }
     CLLC_HAL_clearISR3InterruputFlag();
+    CLLC_HAL_stopERADProfilingISR3();
 }
 
+#if CLLC_TELEMETRY_ENABLE == 1
 //
-//=============================================================================
-//  STATE-MACHINE SEQUENCING AND SYNCRONIZATION FOR SLOW BACKGROUND TASKS
-//=============================================================================
-//
-//
-//--------------------------------- FRAME WORK --------------------------------
+// Below ISR3, the SCI refill runs with interrupts on, the ring is checked
+// for more bytes with them off so a frame ISR3 queues is not missed
 //
-void A0(void)
+interrupt void CLLC_telemetryISR(void)
 {
-    //
-    // // loop rate synchronizer for A-tasks
-    // //
-    // if(GET_TASKA_TIMER_OVERFLOW_STATUS == 1)
-    // {
-    //     CLEAR_TASKA_TIMER_OVERFLOW_FLAG;    // clear flag
-
-    //     //
-    //     // jump to an A Task (A1,A2,A3,...)
-    //     //
-    //     (*A_Task_Ptr)();
-
-    //     vTimer0[0]++;           // virtual timer 0, instance 0 (spare)
-    // }
-    // Alpha_State_Ptr = &B0;      // Comment out to allow only A tasks
+    EINT;
+    CLLC_runTelemetryTx();
+    DINT;
+    if(CLLC_telemetry.writeIndex == CLLC_telemetry.readIndex)
+    {
+        CLLC_HAL_disableTelemetryTxInterrupt();
+    }
+    CLLC_HAL_clearTelemetryInterruptFlag();
 }
+#endif
 
-void B0(void)
+#if CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_EVENT
+//
+// On the one-shot trip of PRIM LEG1, latches the cause and time of the trip
+//
+interrupt void CLLC_tripEventISR(void)
 {
-    //
-    // loop rate synchronizer for B-tasks
-    //
-    // if(GET_TASKB_TIMER_OVERFLOW_STATUS  == 1)
-    // {
-    //     CLEAR_TASKB_TIMER_OVERFLOW_FLAG;                // clear flag
-
-    //     //
-    //     // jump to a B Task (B1,B2,B3,...)
-    //     //
-    //     (*B_Task_Ptr)();
-
-    //     vTimer1[0]++;           // virtual timer 1, instance 0 (spare)
-    // }
-
-    // //
-    // // Allow A state tasks
-    // //
-    // Alpha_State_Ptr = &A0;
+    CLLC_runTripEvent();
 }
+#endif
 
 //
 //=============================================================================
-//  A - TASKS (executed in every 1 msec)
+//  BACKGROUND TASKS
 //=============================================================================
 //
-
-void A1(void)
+#if CLLC_SFRA_TYPE != CLLC_SFRA_DISABLED
+static void CLLC_runSFRATask(void)
 {
-// #if SFRA_TYPE != SFRA_DISABLED
-//     runSFRABackGroundTasks();
-// #endif
-
-//     // changeSynchronousRectifierPwmBehavior(POWER_FLOW);
-
-//     //
-//     //the next time CpuTimer0 'counter' reaches Period value go to A2
-//     //
-//     A_Task_Ptr = &A1;
-
+    CLLC_runSFRABackgroundTasks();
 }
+#endif
 
+#if CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_BACKGROUND
 //
-//=============================================================================
-//  B - TASKS (executed in every 5 msec)
-//=============================================================================
+// the only writer of CLLC_tripFlag, in place of ISR2
 //
-
-void B1(void)
+static void CLLC_runTripDecodeTask(void)
 {
-
-    // CLLC_updateBoardStatus();
-
-    //
-    //the next time CpuTimer1 'counter' reaches Period value go to B2
-    //
-    // B_Task_Ptr = &B2;
+    CLLC_updateBoardStatus();
 }
+#endif
 
-void B2(void)
+#if CLLC_ADC_CALIBRATION == 1
+//
+// zeros of the currents from the first CLLC_ADC_SELFCAL_SAMPLES frames
+// with the bridges tripped, nothing once they are taken
+//
+static void CLLC_runADCSelfCalTask(void)
 {
-
-    //
-    //the next time CpuTimer1 'counter' reaches Period value go to B3
-    //
-    // B_Task_Ptr = &B3;
-
+    CLLC_runADCSelfCal();
 }
+#endif
 
-void B3(void)
+static void CLLC_runStatsSnapshotTask(void)
 {
-    // HAL_toggleLED1();
-
-    //
-    //the next time CpuTimer1 'counter' reaches Period value go to B1
-    //
-    // B_Task_Ptr = &B1;
-
+    CLLC_STATS_snapshot(&CLLC_stats, &CLLC_statsSnapshot);
 }
-
-// //
-// // No more.
-// //
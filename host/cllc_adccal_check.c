@@ -0,0 +1,368 @@
+//#############################################################################
+//
+// FILE:   cllc_adccal_check.c
+//
+// TITLE:  Check of the ADC calibration
+//         Runs the firmware in the emulator built with CLLC_ADC_CALIBRATION,
+//         as CLLC_ADC_OVERSAMPLE was built. Checks the PPB of each signal on
+//         the SOC ISR2 reads, holding the zero of its sense chain. Then
+//         trips the bridges and feeds the current sense codes of a board
+//         whose zeros are off mid scale, with noise, through the self
+//         calibration: a trip cleared part way must start it over, and the
+//         zeros it takes must be the mean codes. Then sweeps the currents
+//         over the range and checks that ISR2 reads them within a code of
+//         their gain, and the voltages as the raw readings did. Reports the
+//         host time of the five operation chain of the reading against the
+//         one multiply, and the register accesses of ISR2.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -DCLLC_EMU_COUNT_ACCESSES -DCLLC_ADC_CALIBRATION=1
+//             -include host/cllc_emu_target.h
+//             -I. -Icllc -Ihost -Idevice -Idevice/driverlib -Ilibraries
+//             host/cllc_emu.c host/cllc_emu_firmware.c
+//             host/cllc_adccal_check.c cllc/cllc.c cllc/cllc_hal.c
+//             $(DRIVERLIB) -lm -o cllc_adccal_check
+//         with DRIVERLIB the driverlib sources listed in host/README.md, add
+//         -DCLLC_ADC_OVERSAMPLE=11 and device/driverlib/dma.c for the
+//         oversampled readings.
+//
+//         Usage:
+//         cllc_adccal_check [-n readings]
+//           -n  readings of the timing (default 10000000)
+//
+//         Exits 0 when all checks pass.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "cllc.h"
+#include "cllc_emu.h"
+#include "cllc_check.h"
+
+#ifndef CLLC_EMU_COUNT_ACCESSES
+#error "build with -DCLLC_EMU_COUNT_ACCESSES"
+#endif
+
+#if CLLC_ADC_CALIBRATION != 1
+#error "build with -DCLLC_ADC_CALIBRATION=1"
+#endif
+
+//
+// the board: zero current codes off mid scale, noise of the codes taken at
+// zero in codes peak
+//
+#define CLLC_ADCCAL_CHECK_IPRIM_ZERO    ((float32_t)2071.3)
+#define CLLC_ADCCAL_CHECK_ISEC_ZERO     ((float32_t)2030.7)
+#define CLLC_ADCCAL_CHECK_NOISE         ((float32_t)3.0)
+#define CLLC_ADCCAL_CHECK_SWEEP_STEPS   181U
+
+//
+// the globals
+//
+static uint32_t CLLC_ADCCAL_CHECK_seed = 12345U;
+
+//
+// uniform in -1..1
+//
+static float32_t CLLC_ADCCAL_CHECK_noise(void)
+{
+    CLLC_ADCCAL_CHECK_seed = CLLC_ADCCAL_CHECK_seed * 1103515245U + 12345U;
+    return(((float32_t)((CLLC_ADCCAL_CHECK_seed >> 8) & 0xFFFFU) /
+            32767.5f) - 1.0f);
+}
+
+static uint16_t CLLC_ADCCAL_CHECK_toCode(float32_t code)
+{
+    if(code <= 0.0f)
+    {
+        return(0);
+    }
+    if(code >= 4095.0f)
+    {
+        return(4095);
+    }
+    return((uint16_t)(code + 0.5f));
+}
+
+//
+// The SOCs ISR2 reads of each current, the oversampling ones dithered by a
+// code either way from the second on. Returns the mean of the ISEC codes.
+//
+static float32_t CLLC_ADCCAL_CHECK_writeCurrents(float32_t iPrimCode,
+                                                 float32_t iSecCode)
+{
+    uint32_t sum = 0;
+    int16_t dither;
+    uint16_t i, code;
+
+    CLLC_EMU_setADCResult(CLLC_IPRIM_ADCRESULTREGBASE, CLLC_IPRIM_ADC_SOC_NO,
+                          CLLC_ADCCAL_CHECK_toCode(iPrimCode));
+
+    for(i = 0; i < CLLC_ADC_OVERSAMPLE; i++)
+    {
+        dither = (CLLC_ADC_OVERSAMPLE > 1U) ? ((int16_t)((i + 1U) % 3U) - 1) :
+                                              0;
+        code = CLLC_ADCCAL_CHECK_toCode(iSecCode + (float32_t)dither);
+        CLLC_EMU_setADCResult(CLLC_ISEC_ADCRESULTREGBASE,
+                              CLLC_ISEC_ADC_SOC_NO_1 + i, code);
+        sum += code;
+    }
+
+    return((float32_t)sum / (float32_t)CLLC_ADC_OVERSAMPLE);
+}
+
+static void CLLC_ADCCAL_CHECK_checkPPB(const char *name, uint32_t adcBase,
+                                       ADC_PPBNumber ppb, uint16_t soc,
+                                       uint16_t zero)
+{
+    char what[64];
+
+    snprintf(what, sizeof(what), "%s PPB SOC", name);
+    CLLC_CHECK_expect(what,
+                      HWREGH(adcBase + ADC_O_PPB1CONFIG +
+                             (ADC_PPBxCONFIG_STEP * (uint32_t)ppb)) &
+                      ADC_PPB1CONFIG_CONFIG_M, soc);
+    snprintf(what, sizeof(what), "%s PPB zero", name);
+    CLLC_CHECK_expect(what,
+                      HWREGH(adcBase + ADC_O_PPB1OFFREF +
+                             (ADC_PPBxOFFREF_STEP * (uint32_t)ppb)),
+                      zero);
+}
+
+//
+// The reading as the commented chain of the sec to prim read had it, five
+// operations, against the calibrated one multiply. Returns ns per reading.
+//
+static double CLLC_ADCCAL_CHECK_time(uint32_t readings, uint16_t fused,
+                                     float32_t *out)
+{
+    volatile uint16_t code = 2100;
+    volatile float32_t offset_pu = CLLC_iPrimSensedOffset_pu;
+    volatile float32_t slope = CLLC_iPrimSensedCalXvariable_pu;
+    volatile float32_t intercept_pu = CLLC_iPrimSensedCalIntercept_pu;
+    volatile float32_t gain_pu = CLLC_iPrimADCCal.gain_pu;
+    volatile float32_t reading = 0.0f;
+    clock_t start;
+    uint32_t i;
+
+    start = clock();
+    for(i = 0; i < readings; i++)
+    {
+        if(fused != 0U)
+        {
+            reading = (float32_t)(int32_t)(code - CLLC_iPrimADCCal.zero) *
+                      gain_pu;
+        }
+        else
+        {
+            reading = (((float32_t)code * CLLC_ADC_PU_SCALE_FACTOR -
+                        offset_pu) * CLLC_IPRIM_SENSE_CHAIN_GAIN) * slope +
+                      intercept_pu;
+        }
+    }
+
+    *out = reading;
+    return(((double)(clock() - start) / (double)CLOCKS_PER_SEC) * 1.0e9 /
+           (double)readings);
+}
+
+int main(int argc, char *argv[])
+{
+    const CLLC_EMU_AccessStats *a = &CLLC_EMU_accesses[CLLC_EMU_ISR2];
+    uint32_t readings = 10000000UL;
+    float32_t iPrimSum = 0.0f;
+    float32_t iSecSum = 0.0f;
+    float32_t iPrimCode, iSecCode, iSecMean, current, tolerance;
+    float32_t iPrimGain, iSecGain;
+    float32_t maxError = 0.0f;
+    float32_t chain, fused;
+    double chain_ns, fused_ns;
+    uint16_t code;
+    uint32_t k;
+    int arg;
+
+    for(arg = 1; arg < argc; arg++)
+    {
+        if((strcmp(argv[arg], "-n") == 0) && (arg + 1 < argc))
+        {
+            readings = (uint32_t)strtoul(argv[++arg], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n readings]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    printf("lab %d, calibrated readings, %ux oversampling\n", CLLC_LAB,
+           (unsigned)CLLC_ADC_OVERSAMPLE);
+
+    CLLC_EMU_initFirmware();
+
+    //
+    // the PPBs on the SOCs, the zeros of the configured sense chains
+    //
+    CLLC_ADCCAL_CHECK_checkPPB("IPRIM", CLLC_IPRIM_ADC_MODULE,
+                               CLLC_IPRIM_ADC_PPB, CLLC_IPRIM_ADC_SOC_NO,
+                               CLLC_iPrimADCCal.zero);
+    CLLC_ADCCAL_CHECK_checkPPB("ISEC", CLLC_ISEC_ADC_MODULE,
+                               CLLC_ISEC_ADC_PPB, CLLC_ISEC_ADC_SOC_NO_1,
+                               CLLC_iSecADCCal.zero);
+    CLLC_ADCCAL_CHECK_checkPPB("VPRIM", CLLC_VPRIM_ADC_MODULE,
+                               CLLC_VPRIM_ADC_PPB, CLLC_VPRIM_ADC_SOC_NO_1,
+                               0);
+    CLLC_ADCCAL_CHECK_checkPPB("VSEC", CLLC_VSEC_ADC_MODULE,
+                               CLLC_VSEC_ADC_PPB, CLLC_VSEC_ADC_SOC_NO_1, 0);
+    CLLC_CHECK_expectNear("IPRIM configured zero",
+                          (float32_t)CLLC_iPrimADCCal.zero,
+                          CLLC_iPrimSensedOffset_pu /
+                          CLLC_ADC_PU_SCALE_FACTOR -
+                          CLLC_iPrimSensedCalIntercept_pu /
+                          (CLLC_ADC_PU_SCALE_FACTOR *
+                           CLLC_IPRIM_SENSE_CHAIN_GAIN *
+                           CLLC_iPrimSensedCalXvariable_pu), 0.5f);
+
+    CLLC_EMU_startFirmware();
+
+    //
+    // no self calibration with the bridges running
+    //
+    CLLC_ADCCAL_CHECK_writeCurrents(CLLC_ADCCAL_CHECK_IPRIM_ZERO,
+                                    CLLC_ADCCAL_CHECK_ISEC_ZERO);
+    CLLC_runADCSelfCal();
+    CLLC_CHECK_expect("samples untripped",
+                      CLLC_iPrimADCSelfCal.samples, 0);
+
+    //
+    // tripped, a clear part way starts over
+    //
+    CLLC_EMU_raiseTrip(CLLC_IPRIM_CMPSS_XBAR_FLAG1);
+    for(k = 0; k < CLLC_ADC_SELFCAL_SAMPLES / 2U; k++)
+    {
+        CLLC_ADCCAL_CHECK_writeCurrents(CLLC_ADCCAL_CHECK_IPRIM_ZERO,
+                                        CLLC_ADCCAL_CHECK_ISEC_ZERO);
+        CLLC_runADCSelfCal();
+    }
+    CLLC_CHECK_expect("samples tripped", CLLC_iSecADCSelfCal.samples,
+                      CLLC_ADC_SELFCAL_SAMPLES / 2U);
+
+    CLLC_EMU_clearTrip();
+    CLLC_EMU_step();
+    CLLC_runADCSelfCal();
+    CLLC_CHECK_expect("samples after the clear",
+                      CLLC_iSecADCSelfCal.samples, 0);
+    CLLC_CHECK_expect("done after the clear", CLLC_adcSelfCalDone, 0);
+
+    CLLC_EMU_raiseTrip(CLLC_IPRIM_CMPSS_XBAR_FLAG1);
+    for(k = 0; k < CLLC_ADC_SELFCAL_SAMPLES; k++)
+    {
+        CLLC_CHECK_expect("done early", CLLC_adcSelfCalDone, 0);
+
+        iPrimCode = CLLC_ADCCAL_CHECK_IPRIM_ZERO +
+                    CLLC_ADCCAL_CHECK_NOISE * CLLC_ADCCAL_CHECK_noise();
+        iSecCode = CLLC_ADCCAL_CHECK_ISEC_ZERO +
+                   CLLC_ADCCAL_CHECK_NOISE * CLLC_ADCCAL_CHECK_noise();
+        CLLC_ADCCAL_CHECK_writeCurrents(iPrimCode, iSecCode);
+        iPrimSum += (float32_t)CLLC_ADCCAL_CHECK_toCode(iPrimCode);
+        iSecSum += (float32_t)CLLC_ADCCAL_CHECK_toCode(iSecCode);
+        CLLC_runADCSelfCal();
+    }
+    CLLC_CHECK_expect("done", CLLC_adcSelfCalDone, 1);
+
+    CLLC_CHECK_expectNear("IPRIM zero",
+                          (float32_t)CLLC_iPrimADCCal.zero,
+                          iPrimSum / (float32_t)CLLC_ADC_SELFCAL_SAMPLES,
+                          0.5f);
+    CLLC_CHECK_expectNear("ISEC zero of the sum",
+                          (float32_t)CLLC_iSecADCCal.zeroSum,
+                          iSecSum * (float32_t)CLLC_ADC_OVERSAMPLE /
+                          (float32_t)CLLC_ADC_SELFCAL_SAMPLES, 0.5f);
+    CLLC_ADCCAL_CHECK_checkPPB("IPRIM self calibrated", CLLC_IPRIM_ADC_MODULE,
+                               CLLC_IPRIM_ADC_PPB, CLLC_IPRIM_ADC_SOC_NO,
+                               CLLC_iPrimADCCal.zero);
+    CLLC_ADCCAL_CHECK_checkPPB("ISEC self calibrated", CLLC_ISEC_ADC_MODULE,
+                               CLLC_ISEC_ADC_PPB, CLLC_ISEC_ADC_SOC_NO_1,
+                               CLLC_iSecADCCal.zero);
+
+    CLLC_EMU_clearTrip();
+    CLLC_EMU_step();
+    memset(CLLC_EMU_accesses, 0, sizeof(CLLC_EMU_accesses));
+
+    //
+    // the currents over the range, within a code of their gain: half a code
+    // of the conversion and half of the zero of a PPB, a sum keeps its zero
+    // to a fraction of a code
+    //
+    iPrimGain = CLLC_iPrimADCCal.gain_pu;
+    iSecGain = CLLC_iSecADCCal.gain_pu * (float32_t)CLLC_ADC_OVERSAMPLE;
+    for(k = 0; k < CLLC_ADCCAL_CHECK_SWEEP_STEPS; k++)
+    {
+        current = -0.8f + (1.6f * (float32_t)k /
+                           (float32_t)(CLLC_ADCCAL_CHECK_SWEEP_STEPS - 1U));
+        iPrimCode = CLLC_ADCCAL_CHECK_IPRIM_ZERO + current / iPrimGain;
+        iSecCode = CLLC_ADCCAL_CHECK_ISEC_ZERO + current / iSecGain;
+        iSecMean = CLLC_ADCCAL_CHECK_writeCurrents(iPrimCode, iSecCode);
+        CLLC_EMU_step();
+
+        tolerance = fabsf(iPrimGain) * 1.0f + 1.0e-5f;
+        CLLC_CHECK_expectNear("IPRIM", CLLC_iPrimSensed_pu, current,
+                              tolerance);
+        if(fabsf(CLLC_iPrimSensed_pu - current) / fabsf(iPrimGain) >
+           maxError)
+        {
+            maxError = fabsf(CLLC_iPrimSensed_pu - current) /
+                       fabsf(iPrimGain);
+        }
+
+        //
+        // the mean of the dithered codes against the zero of the sum
+        //
+        tolerance = fabsf(iSecGain) *
+                    ((CLLC_ADC_OVERSAMPLE > 1U) ? 0.5f : 1.0f) + 1.0e-5f;
+        CLLC_CHECK_expectNear("ISEC", CLLC_iSecSensed_pu,
+                              (iSecMean - CLLC_ADCCAL_CHECK_ISEC_ZERO) *
+                              iSecGain, tolerance);
+
+        //
+        // the voltages have no offset, the raw readings
+        //
+        code = (uint16_t)(k * 22U);
+        CLLC_EMU_setADCResultRange(CLLC_VPRIM_ADCRESULTREGBASE,
+                                   CLLC_VPRIM_ADC_SOC_NO_1,
+                                   CLLC_VPRIM_ADC_SOC_NO_4, code);
+        CLLC_EMU_setADCResultRange(CLLC_VSEC_ADCRESULTREGBASE,
+                                   CLLC_VSEC_ADC_SOC_NO_1,
+                                   CLLC_VSEC_ADC_SOC_NO_11, code);
+        CLLC_EMU_step();
+        CLLC_CHECK_expectNear("VPRIM", CLLC_vPrimSensed_pu,
+                              (float32_t)code *
+                              CLLC_ADC_PU_SCALE_FACTOR, 1.0e-6f);
+        CLLC_CHECK_expectNear("VSEC", CLLC_vSecSensed_pu,
+                              (float32_t)code *
+                              CLLC_VSEC_ADC_PU_SCALE_FACTOR, 1.0e-6f);
+
+        if(CLLC_CHECK_failures > 10U)
+        {
+            break;
+        }
+    }
+
+    printf("IPRIM error: max %.2f codes of gain\n", (double)maxError);
+
+    chain_ns = CLLC_ADCCAL_CHECK_time(readings, 0, &chain);
+    fused_ns = CLLC_ADCCAL_CHECK_time(readings, 1, &fused);
+    printf("reading on the host: chain %.2f ns, one multiply %.2f ns "
+           "(%.4f, %.4f pu)\n", chain_ns, fused_ns, (double)chain,
+           (double)fused);
+
+    printf("ISR2 register accesses: mean %.1f, max %lu over %lu runs\n",
+           (a->runs != 0U) ? (double)a->total / (double)a->runs : 0.0,
+           (unsigned long)a->max, (unsigned long)a->runs);
+
+    return(CLLC_CHECK_result());
+}
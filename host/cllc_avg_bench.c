@@ -0,0 +1,420 @@
+//#############################################################################
+//
+// FILE:   cllc_avg_bench.c
+//
+// TITLE:  Bit compatibility check and timing of the ISR3 averaging
+//         ISR3 averages the sensed signals and scales them to volts and
+//         amps in one pass over the CLLC_avg bank (cllc_avg.h), where it
+//         ran EMAVG_run on one EMAVG per signal and scaled the averages
+//         after. This runner feeds the same random inputs to a bank and to
+//         a set of EMAVG configured as ISR3 configured them, and compares
+//         the averages and the scaled values bit for bit. Then it runs the
+//         firmware of the lab against the averaged plant
+//         (cllc_plant_fha.h) and checks that ISR3 configured the bank,
+//         that the averages follow the ISR2 outputs and that ISR3 wrote
+//         each average times its scale to its CLLC_*Sensed_Volts or _Amps
+//         global. Last it times one ISR3 pass of either on the host, the
+//         emulator has no cycle model of the C28x, and fails if the bank is
+//         the slower one. The timing takes its passes in turn over
+//         CLLC_AVG_BENCH_SETS sets of averages, in ISR3 a pass does not wait
+//         on the average the pass before left as it would in a loop over one
+//         set.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -include host/cllc_emu_target.h -I. -Icllc -Ihost -Idevice
+//             -Idevice/driverlib -Ilibraries
+//             host/cllc_emu.c host/cllc_emu_firmware.c
+//             host/cllc_avg_bench.c host/cllc_plant_fha.c cllc/cllc.c
+//             cllc/cllc_hal.c $(DRIVERLIB) -lm -o cllc_avg_bench
+//         with DRIVERLIB the driverlib sources listed in host/README.md.
+//
+//         Usage:
+//         cllc_avg_bench [-n steps] [-t passes]
+//           -n  ISR2 periods to run the firmware for (default 120000)
+//           -t  passes to time per variant and round (default 10000000)
+//
+//         Exits 0 when all checks pass.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "cllc.h"
+#include "cllc_emu.h"
+#include "cllc_check.h"
+#include "cllc_plant_fha.h"
+#include "utilities/emavg.h"
+
+//
+// defines
+//
+#define CLLC_AVG_BENCH_INPUTS           1024U   // random input sets
+#define CLLC_AVG_BENCH_CHECK_PASSES     100000U
+#define CLLC_AVG_BENCH_TRACK            0.05f   // of the input, or 0.01 pu
+#define CLLC_AVG_BENCH_ROUNDS           5U      // timing, the best counts
+#define CLLC_AVG_BENCH_SETS             8U      // timing, passes in flight
+
+//
+// the globals
+//
+static CLLC_PLANT_FHA_Plant CLLC_AVG_BENCH_plant;
+
+static float32_t CLLC_AVG_BENCH_input[CLLC_AVG_BENCH_INPUTS]
+                                     [CLLC_AVG_CHANNELS];
+
+static const char *CLLC_AVG_BENCH_name[CLLC_AVG_CHANNELS] = {
+    "ISEC", "IPRIM", "VSEC", "VPRIM"};
+
+static const float32_t CLLC_AVG_BENCH_scale[CLLC_AVG_CHANNELS] = {
+    CLLC_ISEC_MAX_SENSE_AMPS, CLLC_IPRIM_MAX_SENSE_AMPS,
+    CLLC_VSEC_OPTIMAL_RANGE_VOLTS, CLLC_VPRIM_MAX_SENSE_VOLTS};
+
+static const float32_t CLLC_AVG_BENCH_multiplier[CLLC_AVG_CHANNELS] = {
+    CLLC_AVG_ISEC_MULTIPLIER, CLLC_AVG_IPRIM_MULTIPLIER,
+    CLLC_AVG_VSEC_MULTIPLIER, CLLC_AVG_VPRIM_MULTIPLIER};
+
+//
+// the averages as ISR3 kept them before the bank, one EMAVG and one scaled
+// value per signal
+//
+typedef struct
+{
+    EMAVG iSecAvg;
+    EMAVG iPrimAvg;
+    EMAVG vSecAvg;
+    EMAVG vPrimAvg;
+    float32_t iSec_Amps;
+    float32_t iPrim_Amps;
+    float32_t vSec_Volts;
+    float32_t vPrim_Volts;
+} CLLC_AVG_BENCH_Reference;
+
+//
+// the bank and the globals ISR3 writes its values to
+//
+typedef struct
+{
+    CLLC_AVG_Bank bank;
+    float32_t iSec_Amps;
+    float32_t iPrim_Amps;
+    float32_t vSec_Volts;
+    float32_t vPrim_Volts;
+} CLLC_AVG_BENCH_Bank;
+
+//
+// one set of either per ISR3 pass in flight in the timing, the checks use
+// the first
+//
+CLLC_AVG_BENCH_Reference CLLC_AVG_BENCH_reference[CLLC_AVG_BENCH_SETS];
+CLLC_AVG_BENCH_Bank CLLC_AVG_BENCH_bank[CLLC_AVG_BENCH_SETS];
+
+static uint32_t CLLC_AVG_BENCH_getBits(float32_t x)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &x, sizeof(bits));
+    return(bits);
+}
+
+static double CLLC_AVG_BENCH_now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return((double)t.tv_sec + (double)t.tv_nsec * 1.0e-9);
+}
+
+//
+// one ISR3 pass as it was, kept out of line so that the timing loop cannot
+// merge the passes
+//
+__attribute__((noinline))
+static void CLLC_AVG_BENCH_runReference(uint16_t set, const float32_t *in)
+{
+    CLLC_AVG_BENCH_Reference *r = &CLLC_AVG_BENCH_reference[set];
+
+    EMAVG_run(&r->iSecAvg, in[CLLC_AVG_ISEC]);
+    EMAVG_run(&r->iPrimAvg, in[CLLC_AVG_IPRIM]);
+    EMAVG_run(&r->vSecAvg, in[CLLC_AVG_VSEC]);
+    EMAVG_run(&r->vPrimAvg, in[CLLC_AVG_VPRIM]);
+
+    r->vPrim_Volts = r->vPrimAvg.out * CLLC_VPRIM_MAX_SENSE_VOLTS;
+    r->vSec_Volts = r->vSecAvg.out * CLLC_VSEC_OPTIMAL_RANGE_VOLTS;
+    r->iPrim_Amps = r->iPrimAvg.out * CLLC_IPRIM_MAX_SENSE_AMPS;
+    r->iSec_Amps = r->iSecAvg.out * CLLC_ISEC_MAX_SENSE_AMPS;
+}
+
+//
+// one ISR3 pass over the bank as CLLC_runISR3 makes it, the gather of the
+// ISR2 outputs, the run and the values out to their globals
+//
+__attribute__((noinline))
+static void CLLC_AVG_BENCH_runBank(uint16_t set, const float32_t *in)
+{
+    CLLC_AVG_BENCH_Bank *b = &CLLC_AVG_BENCH_bank[set];
+    float32_t avgIn[CLLC_AVG_CHANNELS];
+    float32_t avgValue[CLLC_AVG_CHANNELS];
+
+    avgIn[CLLC_AVG_ISEC] = in[CLLC_AVG_ISEC];
+    avgIn[CLLC_AVG_IPRIM] = in[CLLC_AVG_IPRIM];
+    avgIn[CLLC_AVG_VSEC] = in[CLLC_AVG_VSEC];
+    avgIn[CLLC_AVG_VPRIM] = in[CLLC_AVG_VPRIM];
+    CLLC_AVG_run(&b->bank, avgIn, avgValue);
+
+    b->vPrim_Volts = avgValue[CLLC_AVG_VPRIM];
+    b->vSec_Volts = avgValue[CLLC_AVG_VSEC];
+    b->iPrim_Amps = avgValue[CLLC_AVG_IPRIM];
+    b->iSec_Amps = avgValue[CLLC_AVG_ISEC];
+}
+
+static void CLLC_AVG_BENCH_reset(void)
+{
+    uint16_t set;
+    uint16_t j;
+
+    for(set = 0; set < CLLC_AVG_BENCH_SETS; set++)
+    {
+        CLLC_AVG_BENCH_Reference *r = &CLLC_AVG_BENCH_reference[set];
+
+        //
+        // as ISR3 configured the EMAVG, from a double 0.01
+        //
+        EMAVG_reset(&r->iSecAvg);
+        EMAVG_config(&r->iSecAvg, 0.01);
+        EMAVG_reset(&r->iPrimAvg);
+        EMAVG_config(&r->iPrimAvg, 0.01);
+        EMAVG_reset(&r->vSecAvg);
+        EMAVG_config(&r->vSecAvg, 0.01);
+        EMAVG_reset(&r->vPrimAvg);
+        EMAVG_config(&r->vPrimAvg, 0.01);
+
+        for(j = 0; j < CLLC_AVG_CHANNELS; j++)
+        {
+            CLLC_AVG_config(&CLLC_AVG_BENCH_bank[set].bank, j,
+                            CLLC_AVG_BENCH_multiplier[j],
+                            CLLC_AVG_BENCH_scale[j]);
+        }
+    }
+}
+
+//
+// the firmware bank as CLLC_initGlobalVariables left it
+//
+static void CLLC_AVG_BENCH_checkConfig(void)
+{
+    char what[64];
+    uint16_t j;
+
+    for(j = 0; j < CLLC_AVG_CHANNELS; j++)
+    {
+        snprintf(what, sizeof(what), "%s multiplier bits",
+                 CLLC_AVG_BENCH_name[j]);
+        CLLC_CHECK_expect(what,
+            CLLC_AVG_BENCH_getBits(CLLC_avg.multiplier[j]),
+            CLLC_AVG_BENCH_getBits(CLLC_AVG_BENCH_multiplier[j]));
+        snprintf(what, sizeof(what), "%s scale bits", CLLC_AVG_BENCH_name[j]);
+        CLLC_CHECK_expect(what, CLLC_AVG_BENCH_getBits(CLLC_avg.scale[j]),
+            CLLC_AVG_BENCH_getBits(CLLC_AVG_BENCH_scale[j]));
+        snprintf(what, sizeof(what), "%s average at reset",
+                 CLLC_AVG_BENCH_name[j]);
+        CLLC_CHECK_expect(what, CLLC_AVG_BENCH_getBits(CLLC_avg.out[j]),
+                          0);
+    }
+}
+
+//
+// the bank against the EMAVG on the same inputs, bit for bit
+//
+static void CLLC_AVG_BENCH_checkBits(void)
+{
+    const CLLC_AVG_BENCH_Reference *r = &CLLC_AVG_BENCH_reference[0];
+    const CLLC_AVG_BENCH_Bank *b = &CLLC_AVG_BENCH_bank[0];
+    const EMAVG *reference[CLLC_AVG_CHANNELS] = {
+        &r->iSecAvg, &r->iPrimAvg, &r->vSecAvg, &r->vPrimAvg};
+    const float32_t *value[CLLC_AVG_CHANNELS] = {
+        &r->iSec_Amps, &r->iPrim_Amps, &r->vSec_Volts, &r->vPrim_Volts};
+    const float32_t *bankValue[CLLC_AVG_CHANNELS] = {
+        &b->iSec_Amps, &b->iPrim_Amps, &b->vSec_Volts, &b->vPrim_Volts};
+    uint32_t mismatches = 0;
+    uint32_t pass;
+    uint16_t j;
+
+    CLLC_AVG_BENCH_reset();
+
+    for(pass = 0; pass < CLLC_AVG_BENCH_CHECK_PASSES; pass++)
+    {
+        const float32_t *in =
+            CLLC_AVG_BENCH_input[pass % CLLC_AVG_BENCH_INPUTS];
+
+        CLLC_AVG_BENCH_runReference(0, in);
+        CLLC_AVG_BENCH_runBank(0, in);
+
+        for(j = 0; j < CLLC_AVG_CHANNELS; j++)
+        {
+            if(CLLC_AVG_BENCH_getBits(b->bank.out[j]) !=
+               CLLC_AVG_BENCH_getBits(reference[j]->out))
+            {
+                mismatches++;
+            }
+            if(CLLC_AVG_BENCH_getBits(*bankValue[j]) !=
+               CLLC_AVG_BENCH_getBits(*value[j]))
+            {
+                mismatches++;
+            }
+        }
+    }
+
+    printf("%u passes x %u channels checked, %lu mismatches\n",
+           CLLC_AVG_BENCH_CHECK_PASSES, CLLC_AVG_CHANNELS,
+           (unsigned long)mismatches);
+    CLLC_CHECK_expect("mismatches", mismatches, 0);
+}
+
+//
+// the firmware bank after ISR3 ran in the emulator
+//
+static void CLLC_AVG_BENCH_checkFirmware(uint32_t steps)
+{
+    const float32_t *in[CLLC_AVG_CHANNELS] = {
+        &CLLC_iSecSensed_pu, &CLLC_iPrimSensed_pu, &CLLC_vSecSensed_pu,
+        &CLLC_vPrimSensed_pu};
+    const float32_t *value[CLLC_AVG_CHANNELS] = {
+        &CLLC_iSecSensed_Amps, &CLLC_iPrimSensed_Amps, &CLLC_vSecSensed_Volts,
+        &CLLC_vPrimSensed_Volts};
+    CLLC_PLANT_FHA_Params params;
+    char what[64];
+    uint32_t isr3 = CLLC_EMU_stats.isr3Count;
+    uint16_t j;
+
+    CLLC_PLANT_FHA_setDefaultParams(&params);
+    CLLC_PLANT_FHA_init(&CLLC_AVG_BENCH_plant, &params);
+    CLLC_EMU_setSampleHook(&CLLC_PLANT_FHA_sampleHook, &CLLC_AVG_BENCH_plant);
+
+    CLLC_EMU_startFirmware();
+    CLLC_EMU_run(steps);
+
+    CLLC_CHECK_expect("ISR3 ran", CLLC_EMU_stats.isr3Count != isr3, 1);
+
+    //
+    // the inputs are the ISR2 outputs, the average of a steady operating
+    // point stays close to them
+    //
+    for(j = 0; j < CLLC_AVG_CHANNELS; j++)
+    {
+        float32_t error = fabsf(CLLC_avg.out[j] - *in[j]);
+
+        printf("%-10s  in %9.6f pu  average %9.6f pu  value %10.4f\n",
+               CLLC_AVG_BENCH_name[j], *in[j], CLLC_avg.out[j], *value[j]);
+
+        snprintf(what, sizeof(what), "%s value bits", CLLC_AVG_BENCH_name[j]);
+        CLLC_CHECK_expect(what, CLLC_AVG_BENCH_getBits(*value[j]),
+            CLLC_AVG_BENCH_getBits(CLLC_avg.out[j] * CLLC_avg.scale[j]));
+        snprintf(what, sizeof(what), "%s average follows the input",
+                 CLLC_AVG_BENCH_name[j]);
+        CLLC_CHECK_expect(what, error <= fmaxf(CLLC_AVG_BENCH_TRACK *
+                                               fabsf(*in[j]), 0.01f), 1);
+    }
+
+    CLLC_CHECK_expect("VSEC average above 0", CLLC_avg.out[CLLC_AVG_VSEC] >
+                      0.0f, 1);
+}
+
+static double CLLC_AVG_BENCH_time(void (*run)(uint16_t, const float32_t *),
+                                  uint32_t passes)
+{
+    double t0;
+    uint32_t pass;
+
+    CLLC_AVG_BENCH_reset();
+
+    t0 = CLLC_AVG_BENCH_now();
+    for(pass = 0; pass < passes; pass++)
+    {
+        run((uint16_t)(pass % CLLC_AVG_BENCH_SETS),
+            CLLC_AVG_BENCH_input[pass % CLLC_AVG_BENCH_INPUTS]);
+    }
+
+    return((CLLC_AVG_BENCH_now() - t0) * 1.0e9 / (double)passes);
+}
+
+//
+// best of the rounds of either, taken in turn so that both see the same
+// load of the host. The bank fails if it is the slower one.
+//
+static void CLLC_AVG_BENCH_compareTimes(uint32_t passes)
+{
+    double reference = 1.0e9, bank = 1.0e9, t;
+    uint16_t round;
+
+    for(round = 0; round < CLLC_AVG_BENCH_ROUNDS; round++)
+    {
+        t = CLLC_AVG_BENCH_time(CLLC_AVG_BENCH_runReference, passes);
+        reference = (t < reference) ? t : reference;
+        t = CLLC_AVG_BENCH_time(CLLC_AVG_BENCH_runBank, passes);
+        bank = (t < bank) ? t : bank;
+    }
+
+    printf("ISR3 averaging: EMAVG %.2f ns/pass, bank %.2f ns/pass\n",
+           reference, bank);
+    CLLC_CHECK_expectTrue(bank <= reference,
+                          "bank slower than EMAVG: %.2f ns/pass, EMAVG "
+                          "%.2f ns/pass", bank, reference);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t steps = (uint32_t)CLLC_ISR2_FREQUENCY_HZ;
+    uint32_t passes = 10000000UL;
+    uint32_t i;
+    uint16_t j;
+    int opt;
+
+    while((opt = getopt(argc, argv, "n:t:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n':
+                steps = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                passes = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n steps] [-t passes]\n",
+                        argv[0]);
+                return(2);
+        }
+    }
+
+    if(passes == 0)
+    {
+        fprintf(stderr, "passes must be at least 1\n");
+        return(2);
+    }
+
+    srand(1);
+    for(i = 0; i < CLLC_AVG_BENCH_INPUTS; i++)
+    {
+        for(j = 0; j < CLLC_AVG_CHANNELS; j++)
+        {
+            CLLC_AVG_BENCH_input[i][j] = (float32_t)rand() /
+                                         (float32_t)RAND_MAX;
+        }
+    }
+
+    printf("lab %d\n", CLLC_LAB);
+
+    CLLC_EMU_initFirmware();
+    CLLC_AVG_BENCH_checkConfig();
+    CLLC_AVG_BENCH_checkBits();
+    CLLC_AVG_BENCH_checkFirmware(steps);
+
+    CLLC_AVG_BENCH_compareTimes(passes);
+
+    return(CLLC_CHECK_result());
+}
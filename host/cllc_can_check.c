@@ -0,0 +1,569 @@
+//#############################################################################
+//
+// FILE:   cllc_can_check.c
+//
+// TITLE:  Check of the CAN-FD service against a stub of the MCAN
+//         Runs cllc_canlink.h on the message RAM and registers of
+//         cllc_mcan_stub.h, one service tick after the other as ISR3 does
+//         it, and checks:
+//
+//         schedule   every report due exactly every period, the ticks no
+//                    busier than they need be, periods that make no
+//                    schedule rejected
+//         reports    identifier, length, FDF/BRS and every payload bit of
+//                    every report, with values that change every tick
+//         busy bus   a report due while its buffer is pending is skipped
+//                    and counted, the frame that leaves is the one written
+//                    first, frames plus skipped are the reports due
+//         commands   setpoints and enables taken exactly, setpoints out of
+//                    limits, NaN, wrong lengths, unknown and extended
+//                    identifiers rejected and counted, a FIFO overflow
+//                    counted and the FIFO drained over the next runs
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -include host/cllc_emu_target.h -I. -Icllc -Ihost -Idevice
+//             -Idevice/driverlib -Ilibraries host/cllc_can_check.c
+//             host/cllc_mcan_stub.c cllc/cllc_canlink.c -lm
+//             -o cllc_can_check
+//
+//         Exits 0 when all checks pass.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "inc/hw_memmap.h"
+#include "cllc_canlink.h"
+#include "cllc_mcan_stub.h"
+#include "cllc_check.h"
+
+//
+// Defines
+//
+#define CLLC_CAN_CHECK_BASE             MCANA_DRIVER_BASE
+#define CLLC_CAN_CHECK_BASE_ID          0x300U
+#define CLLC_CAN_CHECK_TICKS            1000U
+#define CLLC_CAN_CHECK_BUSY_START       200U
+#define CLLC_CAN_CHECK_BUSY_END         263U
+
+//
+// The register file of cllc_emu_target.h, no firmware in this build
+//
+uint16_t CLLC_EMU_regFile[CLLC_EMU_REGFILE_SIZE_WORDS];
+
+static const uint16_t CLLC_CAN_CHECK_period[CLLC_CANLINK_REPORTS] =
+{
+    100U, 10U, 20U
+};
+
+static const uint16_t CLLC_CAN_CHECK_bytes[CLLC_CANLINK_REPORTS] =
+{
+    CLLC_CANLINK_STATUS_BYTES, CLLC_CANLINK_MEASUREMENTS_BYTES,
+    CLLC_CANLINK_LOOP_BYTES
+};
+
+static const CLLC_CANLINK_Setpoint CLLC_CAN_CHECK_setpointMin =
+{
+    0.0f, 0.0f, 100000.0f
+};
+static const CLLC_CANLINK_Setpoint CLLC_CAN_CHECK_setpointMax =
+{
+    60.0f, 20.0f, 800000.0f
+};
+
+
+static uint32_t CLLC_CAN_CHECK_getBits(float32_t value)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    return(bits);
+}
+
+static uint32_t CLLC_CAN_CHECK_getWord(const CLLC_MCAN_STUB_Frame *frame,
+                                       uint16_t k)
+{
+    return((uint32_t)frame->data[4U * k] |
+           ((uint32_t)frame->data[(4U * k) + 1U] << 8) |
+           ((uint32_t)frame->data[(4U * k) + 2U] << 16) |
+           ((uint32_t)frame->data[(4U * k) + 3U] << 24));
+}
+
+static void CLLC_CAN_CHECK_putWord(CLLC_MCAN_STUB_Frame *frame, uint16_t k,
+                                   uint32_t word)
+{
+    frame->data[4U * k] = (uint8_t)word;
+    frame->data[(4U * k) + 1U] = (uint8_t)(word >> 8);
+    frame->data[(4U * k) + 2U] = (uint8_t)(word >> 16);
+    frame->data[(4U * k) + 3U] = (uint8_t)(word >> 24);
+}
+
+//
+// The values of a tick, exact in float32
+//
+static void CLLC_CAN_CHECK_getReport(uint32_t tick, CLLC_CANLINK_Report *r)
+{
+    r->tripFlag = (uint16_t)(tick % 7U);
+    r->powerFlowState = (uint16_t)(tick % 5U);
+    r->closeGvLoop = (uint16_t)(tick & 1U);
+    r->closeGiLoop = (uint16_t)((tick >> 1) & 1U);
+    r->vPrimSensed_Volts = 380.0f + ((float32_t)tick * 0.125f);
+    r->vSecSensed_Volts = 48.0f - ((float32_t)tick * 0.0078125f);
+    r->iPrimSensed_Amps = (float32_t)tick * 0.25f;
+    r->iSecSensed_Amps = -(float32_t)tick * 0.5f;
+    r->vSecRef_Volts = 40.0f + (float32_t)(tick % 160U) * 0.125f;
+    r->iSecRef_Amps = (float32_t)(tick % 40U) * 0.5f;
+    r->pwmFrequency_Hz = 400000.0f + (float32_t)tick;
+    r->gvOut = (float32_t)tick * (1.0f / 1024.0f);
+    r->giOut = -(float32_t)tick * (1.0f / 2048.0f);
+}
+
+//
+// A frame that left against the report written at tick
+//
+static void CLLC_CAN_CHECK_checkReport(const CLLC_MCAN_STUB_Frame *frame,
+                                       uint16_t report, uint32_t tick)
+{
+    static const uint16_t id[CLLC_CANLINK_REPORTS] =
+            {CLLC_CANLINK_ID_STATUS, CLLC_CANLINK_ID_MEASUREMENTS,
+             CLLC_CANLINK_ID_LOOP};
+    CLLC_CANLINK_Report r;
+    uint32_t expected[5];
+    uint16_t words = 0;
+    uint16_t k;
+
+    CLLC_CAN_CHECK_getReport(tick, &r);
+
+    if((frame->xtd != 0U) || (frame->fdf != 1U) || (frame->brs != 1U) ||
+       (frame->id != (CLLC_CAN_CHECK_BASE_ID + id[report])))
+    {
+        CLLC_CHECK_failValue("reports", "identifier",
+                             CLLC_CAN_CHECK_BASE_ID + id[report], frame->id);
+    }
+    if(frame->bytes != CLLC_CAN_CHECK_bytes[report])
+    {
+        CLLC_CHECK_failValue("reports", "bytes",
+                             CLLC_CAN_CHECK_bytes[report], frame->bytes);
+    }
+
+    switch(report)
+    {
+        case CLLC_CANLINK_REPORT_STATUS:
+            //
+            // the second word holds the command counts, none in this run
+            //
+            expected[0] = (uint32_t)r.tripFlag |
+                          ((uint32_t)r.powerFlowState << 8) |
+                          ((uint32_t)r.closeGvLoop << 16) |
+                          ((uint32_t)r.closeGiLoop << 17);
+            expected[1] = 0;
+            words = 2;
+            break;
+
+        case CLLC_CANLINK_REPORT_MEASUREMENTS:
+            expected[0] = CLLC_CAN_CHECK_getBits(r.vPrimSensed_Volts);
+            expected[1] = CLLC_CAN_CHECK_getBits(r.vSecSensed_Volts);
+            expected[2] = CLLC_CAN_CHECK_getBits(r.iPrimSensed_Amps);
+            expected[3] = CLLC_CAN_CHECK_getBits(r.iSecSensed_Amps);
+            words = 4;
+            break;
+
+        default:
+            expected[0] = CLLC_CAN_CHECK_getBits(r.vSecRef_Volts);
+            expected[1] = CLLC_CAN_CHECK_getBits(r.iSecRef_Amps);
+            expected[2] = CLLC_CAN_CHECK_getBits(r.pwmFrequency_Hz);
+            expected[3] = CLLC_CAN_CHECK_getBits(r.gvOut);
+            expected[4] = CLLC_CAN_CHECK_getBits(r.giOut);
+            words = 5;
+            break;
+    }
+
+    for(k = 0; k < words; k++)
+    {
+        if(CLLC_CAN_CHECK_getWord(frame, k) != expected[k])
+        {
+            CLLC_CHECK_failValue("reports", "payload word", expected[k],
+                                 CLLC_CAN_CHECK_getWord(frame, k));
+        }
+    }
+}
+
+//
+// Counts, spacing and peak load of a schedule
+//
+static void CLLC_CAN_CHECK_checkSchedule(const char *name,
+                                         const uint16_t *period,
+                                         uint16_t count, uint16_t peakMax)
+{
+    CLLC_CANLINK_Schedule schedule;
+    uint16_t i;
+    uint16_t k;
+    uint16_t load;
+    uint16_t peak = 0;
+    uint16_t hits;
+    int32_t last;
+    int32_t first;
+
+    if(CLLC_CANLINK_buildSchedule(&schedule, period, count) == 0U)
+    {
+        CLLC_CHECK_failValue(name, "built", 1, 0);
+        return;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        hits = 0;
+        first = -1;
+        last = -1;
+        for(k = 0; k < schedule.length; k++)
+        {
+            if((schedule.slot[k] & (1U << i)) == 0U)
+            {
+                continue;
+            }
+            if((last >= 0) && ((k - last) != period[i]))
+            {
+                CLLC_CHECK_failValue(name, "spacing", period[i], k - last);
+            }
+            if(first < 0)
+            {
+                first = k;
+            }
+            last = k;
+            hits++;
+        }
+        if(hits != (schedule.length / period[i]))
+        {
+            CLLC_CHECK_failValue(name, "due", schedule.length / period[i],
+                                 hits);
+        }
+        else if((first + schedule.length - last) != period[i])
+        {
+            CLLC_CHECK_failValue(name, "spacing over the wrap", period[i],
+                                 first + schedule.length - last);
+        }
+    }
+
+    for(k = 0; k < schedule.length; k++)
+    {
+        load = 0;
+        for(i = 0; i < count; i++)
+        {
+            load += (schedule.slot[k] >> i) & 1U;
+        }
+        if(load > peak)
+        {
+            peak = load;
+        }
+    }
+    if(peak > peakMax)
+    {
+        CLLC_CHECK_failValue(name, "peak load", peakMax, peak);
+    }
+}
+
+static void CLLC_CAN_CHECK_runSchedules(void)
+{
+    static const uint16_t shared[3] = {4U, 8U, 8U};
+    static const uint16_t tooLong[3] = {7U, 11U, 13U};
+    static const uint16_t zero[3] = {10U, 0U, 20U};
+    CLLC_CANLINK_Schedule schedule;
+
+    CLLC_CAN_CHECK_checkSchedule("schedule 100/10/20",
+                                 CLLC_CAN_CHECK_period, 3, 1);
+    CLLC_CAN_CHECK_checkSchedule("schedule 4/8/8", shared, 3, 1);
+
+    if(CLLC_CANLINK_buildSchedule(&schedule, tooLong, 3) != 0U)
+    {
+        CLLC_CHECK_failValue("schedule 7/11/13", "rejected", 1, 0);
+    }
+    if(CLLC_CANLINK_buildSchedule(&schedule, zero, 3) != 0U)
+    {
+        CLLC_CHECK_failValue("schedule 10/0/20", "rejected", 1, 0);
+    }
+}
+
+//
+// The reports over CLLC_CAN_CHECK_TICKS ticks, the bus held busy for a
+// while in the middle
+//
+static void CLLC_CAN_CHECK_runReports(void)
+{
+    CLLC_MCAN_STUB_Model model;
+    CLLC_MCAN_STUB_Frame frames[CLLC_CANLINK_REPORTS];
+    CLLC_CANLINK_Link link;
+    CLLC_CANLINK_Report report;
+    CLLC_CANLINK_Command command;
+    int32_t written[CLLC_CANLINK_REPORTS];
+    uint32_t due = 0;
+    uint32_t skipped = 0;
+    uint32_t sent = 0;
+    uint32_t tick;
+    uint16_t slot;
+    uint16_t count;
+    uint16_t n;
+    uint16_t i;
+
+    CLLC_MCAN_STUB_init(&model, CLLC_CAN_CHECK_BASE);
+    if(CLLC_CANLINK_config(&link, CLLC_CAN_CHECK_BASE,
+                           CLLC_CAN_CHECK_BASE_ID, CLLC_CAN_CHECK_period,
+                           &CLLC_CAN_CHECK_setpointMin,
+                           &CLLC_CAN_CHECK_setpointMax) == 0U)
+    {
+        CLLC_CHECK_failValue("reports", "config", 1, 0);
+        return;
+    }
+    memset(&command, 0, sizeof(command));
+    for(i = 0; i < CLLC_CANLINK_REPORTS; i++)
+    {
+        written[i] = -1;
+    }
+
+    for(tick = 0; tick < CLLC_CAN_CHECK_TICKS; tick++)
+    {
+        model.txBusy = ((tick >= CLLC_CAN_CHECK_BUSY_START) &&
+                        (tick < CLLC_CAN_CHECK_BUSY_END)) ? 1U : 0U;
+
+        //
+        // what the service must do this tick, from the schedule it built
+        //
+        slot = link.schedule.slot[link.schedule.index];
+        for(i = 0; i < CLLC_CANLINK_REPORTS; i++)
+        {
+            if((slot & (1U << i)) == 0U)
+            {
+                continue;
+            }
+            due++;
+            if(written[i] >= 0)
+            {
+                skipped++;
+            }
+            else
+            {
+                written[i] = (int32_t)tick;
+            }
+        }
+
+        CLLC_CAN_CHECK_getReport(tick, &report);
+        if(CLLC_CANLINK_run(&link, &report, &command) != 0U)
+        {
+            CLLC_CHECK_failValue("reports", "commands taken", 0, 1);
+        }
+        CLLC_MCAN_STUB_acknowledge(&model);
+
+        count = CLLC_MCAN_STUB_transmit(&model, frames, CLLC_CANLINK_REPORTS);
+        for(n = 0; n < count; n++)
+        {
+            i = (uint16_t)(frames[n].id - CLLC_CAN_CHECK_BASE_ID);
+            if((i >= CLLC_CANLINK_REPORTS) || (written[i] < 0))
+            {
+                CLLC_CHECK_failValue("reports", "frame not written", 0,
+                                     frames[n].id);
+                continue;
+            }
+            CLLC_CAN_CHECK_checkReport(&frames[n], i, (uint32_t)written[i]);
+            written[i] = -1;
+            sent++;
+        }
+    }
+
+    if((CLLC_CAN_CHECK_TICKS / CLLC_CAN_CHECK_period[0]) *
+       (1U + (CLLC_CAN_CHECK_period[0] / CLLC_CAN_CHECK_period[1]) +
+        (CLLC_CAN_CHECK_period[0] / CLLC_CAN_CHECK_period[2])) != due)
+    {
+        CLLC_CHECK_failValue("reports", "due", 1000.0 / 100.0 * 16.0, due);
+    }
+    if(skipped == 0U)
+    {
+        CLLC_CHECK_failValue("busy bus", "skipped while busy", 1, 0);
+    }
+    if(link.txSkipped != skipped)
+    {
+        CLLC_CHECK_failValue("busy bus", "skipped", skipped, link.txSkipped);
+    }
+    if(link.txFrames != sent)
+    {
+        CLLC_CHECK_failValue("busy bus", "frames", sent, link.txFrames);
+    }
+    if((link.txFrames + link.txSkipped) != due)
+    {
+        CLLC_CHECK_failValue("busy bus", "frames + skipped", due,
+                             link.txFrames + link.txSkipped);
+    }
+
+    printf("reports: %lu due, %lu sent, %lu skipped while the bus was busy "
+           "for %u ticks\n", (unsigned long)due, (unsigned long)link.txFrames,
+           (unsigned long)link.txSkipped,
+           CLLC_CAN_CHECK_BUSY_END - CLLC_CAN_CHECK_BUSY_START);
+}
+
+static void CLLC_CAN_CHECK_getSetpointFrame(CLLC_MCAN_STUB_Frame *frame,
+                                            float32_t vSecRef_Volts,
+                                            float32_t iSecRef_Amps,
+                                            float32_t pwmFrequencyRef_Hz)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->id = CLLC_CAN_CHECK_BASE_ID + CLLC_CANLINK_ID_SETPOINT;
+    frame->fdf = 1;
+    frame->brs = 1;
+    frame->dlc = CLLC_CANLINK_getDLC(CLLC_CANLINK_SETPOINT_BYTES);
+    CLLC_CAN_CHECK_putWord(frame, 0, CLLC_CAN_CHECK_getBits(vSecRef_Volts));
+    CLLC_CAN_CHECK_putWord(frame, 1, CLLC_CAN_CHECK_getBits(iSecRef_Amps));
+    CLLC_CAN_CHECK_putWord(frame, 2,
+                           CLLC_CAN_CHECK_getBits(pwmFrequencyRef_Hz));
+}
+
+static void CLLC_CAN_CHECK_getEnableFrame(CLLC_MCAN_STUB_Frame *frame,
+                                          uint32_t enable)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->id = CLLC_CAN_CHECK_BASE_ID + CLLC_CANLINK_ID_ENABLE;
+    frame->fdf = 1;
+    frame->brs = 1;
+    frame->dlc = CLLC_CANLINK_getDLC(CLLC_CANLINK_ENABLE_BYTES);
+    CLLC_CAN_CHECK_putWord(frame, 0, enable);
+}
+
+//
+// One tick with the frames received before it
+//
+static uint16_t CLLC_CAN_CHECK_runTick(CLLC_MCAN_STUB_Model *model,
+                                       CLLC_CANLINK_Link *link,
+                                       CLLC_CANLINK_Command *command,
+                                       const CLLC_MCAN_STUB_Frame *frames,
+                                       uint16_t count)
+{
+    CLLC_MCAN_STUB_Frame sent[CLLC_CANLINK_REPORTS];
+    CLLC_CANLINK_Report report;
+    uint16_t taken;
+    uint16_t n;
+
+    for(n = 0; n < count; n++)
+    {
+        (void)CLLC_MCAN_STUB_receive(model, &frames[n]);
+    }
+
+    CLLC_CAN_CHECK_getReport(0, &report);
+    taken = CLLC_CANLINK_run(link, &report, command);
+    CLLC_MCAN_STUB_acknowledge(model);
+    (void)CLLC_MCAN_STUB_transmit(model, sent, CLLC_CANLINK_REPORTS);
+
+    return(taken);
+}
+
+static void CLLC_CAN_CHECK_runCommands(void)
+{
+    CLLC_MCAN_STUB_Model model;
+    CLLC_MCAN_STUB_Frame frames[12];
+    CLLC_CANLINK_Link link;
+    CLLC_CANLINK_Command command;
+    uint16_t taken;
+    uint16_t n;
+
+    CLLC_MCAN_STUB_init(&model, CLLC_CAN_CHECK_BASE);
+    (void)CLLC_CANLINK_config(&link, CLLC_CAN_CHECK_BASE,
+                              CLLC_CAN_CHECK_BASE_ID, CLLC_CAN_CHECK_period,
+                              &CLLC_CAN_CHECK_setpointMin,
+                              &CLLC_CAN_CHECK_setpointMax);
+    memset(&command, 0, sizeof(command));
+
+    //
+    // taken
+    //
+    CLLC_CAN_CHECK_getSetpointFrame(&frames[0], 48.25f, 12.5f, 500000.0f);
+    taken = CLLC_CAN_CHECK_runTick(&model, &link, &command, frames, 1);
+    if((taken != CLLC_CANLINK_TAKEN_SETPOINT) ||
+       (command.setpoint.vSecRef_Volts != 48.25f) ||
+       (command.setpoint.iSecRef_Amps != 12.5f) ||
+       (command.setpoint.pwmFrequencyRef_Hz != 500000.0f))
+    {
+        CLLC_CHECK_failValue("commands", "setpoint", 48.25,
+                             command.setpoint.vSecRef_Volts);
+    }
+
+    CLLC_CAN_CHECK_getEnableFrame(&frames[0], 0xFFFFFFFFUL);
+    taken = CLLC_CAN_CHECK_runTick(&model, &link, &command, frames, 1);
+    if((taken != CLLC_CANLINK_TAKEN_ENABLE) ||
+       (command.enable != (CLLC_CANLINK_ENABLE_GV_LOOP |
+                           CLLC_CANLINK_ENABLE_GI_LOOP |
+                           CLLC_CANLINK_ENABLE_CLEAR_TRIP)))
+    {
+        CLLC_CHECK_failValue("commands", "enable", 7, command.enable);
+    }
+
+    //
+    // rejected, one per tick, the last setpoint taken must stay
+    //
+    CLLC_CAN_CHECK_getSetpointFrame(&frames[0], 60.5f, 12.5f, 500000.0f);
+    CLLC_CAN_CHECK_getSetpointFrame(&frames[1], 48.0f, NAN, 500000.0f);
+    CLLC_CAN_CHECK_getSetpointFrame(&frames[2], 48.0f, 12.5f, 500000.0f);
+    frames[2].dlc = CLLC_CANLINK_getDLC(16);
+    CLLC_CAN_CHECK_getEnableFrame(&frames[3], 1);
+    frames[3].dlc = CLLC_CANLINK_getDLC(8);
+    CLLC_CAN_CHECK_getEnableFrame(&frames[4], 1);
+    frames[4].id = CLLC_CAN_CHECK_BASE_ID + 0x3U;
+    CLLC_CAN_CHECK_getSetpointFrame(&frames[5], 48.0f, 12.5f, 500000.0f);
+    frames[5].xtd = 1;
+    for(n = 0; n < 6U; n++)
+    {
+        if(CLLC_CAN_CHECK_runTick(&model, &link, &command, &frames[n], 1) !=
+           0U)
+        {
+            CLLC_CHECK_failValue("commands", "rejected frame", n, 0);
+        }
+    }
+    if((link.rxFrames != 2U) || (link.rxRejected != 6U))
+    {
+        CLLC_CHECK_failValue("commands", "rejected", 6, link.rxRejected);
+    }
+    if(command.setpoint.vSecRef_Volts != 48.25f)
+    {
+        CLLC_CHECK_failValue("commands", "setpoint kept", 48.25,
+                             command.setpoint.vSecRef_Volts);
+    }
+
+    //
+    // overflow: twelve frames in one tick, eight fit, four per run
+    //
+    for(n = 0; n < 12U; n++)
+    {
+        CLLC_CAN_CHECK_getSetpointFrame(&frames[n], (float32_t)n, 1.0f,
+                                        200000.0f);
+    }
+    (void)CLLC_CAN_CHECK_runTick(&model, &link, &command, frames, 12);
+    if((model.rxDropped != 4U) || (link.rxLost != 1U) ||
+       (link.rxFrames != 6U) || (command.setpoint.vSecRef_Volts != 3.0f))
+    {
+        CLLC_CHECK_failValue("overflow", "first run", 6, link.rxFrames);
+    }
+    (void)CLLC_CAN_CHECK_runTick(&model, &link, &command, frames, 0);
+    if((link.rxLost != 1U) || (link.rxFrames != 10U) ||
+       (command.setpoint.vSecRef_Volts != 7.0f))
+    {
+        CLLC_CHECK_failValue("overflow", "second run", 10, link.rxFrames);
+    }
+    if((CLLC_CAN_CHECK_runTick(&model, &link, &command, frames, 0) != 0U) ||
+       (model.rxFill != 0U) ||
+       ((HWREG(CLLC_CAN_CHECK_BASE + MCAN_RXF0S) &
+         MCAN_RXF0S_RF0L_MASK) != 0U))
+    {
+        CLLC_CHECK_failValue("overflow", "drained", 0, model.rxFill);
+    }
+
+    printf("commands: %lu taken, %lu rejected, %lu overflows\n",
+           (unsigned long)link.rxFrames, (unsigned long)link.rxRejected,
+           (unsigned long)link.rxLost);
+}
+
+int main(void)
+{
+    CLLC_CAN_CHECK_runSchedules();
+    CLLC_CAN_CHECK_runReports();
+    CLLC_CAN_CHECK_runCommands();
+
+    return(CLLC_CHECK_result());
+}
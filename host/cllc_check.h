@@ -0,0 +1,127 @@
+//#############################################################################
+//
+// FILE:   cllc_check.h
+//
+// TITLE:  Failure count and reports shared by the host checks and benches
+//         Each failure is counted and reported on one line starting with
+//         FAIL. A check ends with CLLC_CHECK_result, which prints the count
+//         as "N failures" and gives the exit code, 0 without a failure.
+//
+//         The reports go to stdout, or to CLLC_CHECK_report when a check
+//         sets it, as cllc_coeffgen does while stdout carries the header
+//         it generates. Each check is one translation unit that includes
+//         this file once, so the count is static.
+//
+//#############################################################################
+
+#ifndef CLLC_CHECK_H
+#define CLLC_CHECK_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//
+// Globals
+//
+static uint32_t CLLC_CHECK_failures;
+static FILE *CLLC_CHECK_report;
+
+//
+// Inline functions
+//
+
+//
+// Counts a failure and reports it, FAIL and then the formatted message
+//
+static inline void CLLC_CHECK_vfail(const char *format, va_list args)
+{
+    FILE *report = (CLLC_CHECK_report != NULL) ? CLLC_CHECK_report : stdout;
+
+    fputs("FAIL ", report);
+    vfprintf(report, format, args);
+    fputc('\n', report);
+    CLLC_CHECK_failures++;
+}
+
+static inline void CLLC_CHECK_fail(const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    CLLC_CHECK_vfail(format, args);
+    va_end(args);
+}
+
+//
+// Fails with the value of what expected in the named case and the one got
+//
+static inline void CLLC_CHECK_failValue(const char *name, const char *what,
+                                        double expected, double actual)
+{
+    CLLC_CHECK_fail("%s: %s: expected %.9g, got %.9g", name, what, expected,
+                    actual);
+}
+
+//
+// Fails with the formatted message unless ok
+//
+static inline void CLLC_CHECK_expectTrue(int ok, const char *format, ...)
+{
+    va_list args;
+
+    if(!ok)
+    {
+        va_start(args, format);
+        CLLC_CHECK_vfail(format, args);
+        va_end(args);
+    }
+}
+
+//
+// Fails unless got is expected
+//
+static inline void CLLC_CHECK_expect(const char *what, unsigned long got,
+                                     unsigned long expected)
+{
+    if(got != expected)
+    {
+        CLLC_CHECK_fail("%s: got %lu, expected %lu", what, got, expected);
+    }
+}
+
+//
+// Fails unless got is within tolerance of expected
+//
+static inline void CLLC_CHECK_expectNear(const char *what, double got,
+                                         double expected, double tolerance)
+{
+    if(!(fabs(got - expected) <= tolerance))
+    {
+        CLLC_CHECK_fail("%s: got %.9g, expected %.9g within %.3g", what,
+                        got, expected, tolerance);
+    }
+}
+
+//
+// Prints the failure count and returns the exit code of the check
+//
+static inline int CLLC_CHECK_result(void)
+{
+    printf("%lu failures\n", (unsigned long)CLLC_CHECK_failures);
+    return((CLLC_CHECK_failures == 0U) ? 0 : 1);
+}
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
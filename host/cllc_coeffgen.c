@@ -0,0 +1,427 @@
+//#############################################################################
+//
+// FILE:   cllc_coeffgen.c
+//
+// TITLE:  DF13 coefficients of the compensators from their continuous time
+//         specs
+//         Each compensator of cllc_settings.h is given as
+//
+//             K (1 + s/wz1)(1 + s/wz2)(1 + s/wz3) / (s (1 + s/wp1)(1 + s/wp2))
+//
+//         in CLLC_xx_ZPK_K, CLLC_xx_ZPK_ZEROS_HZ and CLLC_xx_ZPK_POLES_HZ.
+//         The bilinear transform at CLLC_ISR2_FREQUENCY_HZ, in double,
+//         gives the DF13 of one order per pole, the integrator included.
+//         The zeros short of that order go to z = -1, the image of a zero
+//         at infinity. The coefficients are rounded to float32 as the DF13
+//         runs them, the last a coefficient set so that the a coefficients
+//         sum to -1 exactly and the integrator stays on z = 1.
+//
+//         Checks, on the float32 set: the integrator on z = 1, the other
+//         poles stable (DCL_isStableDF13 on the set with the integrator
+//         divided out), no pole with a negative real part outside
+//         CLLC_COEFFGEN_RADIUS_MAX, poles moved by less than
+//         CLLC_COEFFGEN_POLE_MOVE_MAX by the rounding, and a positive
+//         integral gain. A pole near z = -1 flips the period every ISR2 and
+//         dies out slowly, the rounding of the error and of the period keeps
+//         such a mode going as a limit cycle. A slow pole on the positive
+//         real axis is a lag corner and only has to be stable.
+//
+//         Without arguments it checks the CLLC_xx_2P2Z_* coefficients of
+//         cllc_settings.h, they must be the ones of the spec, and exits 0
+//         when all checks pass. With -g it prints the coefficients of the
+//         specs for cllc_settings.h and exits 1 if one of them fails.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -include host/cllc_emu_target.h
+//             -I. -Icllc -Ihost -Idevice -Idevice/driverlib -Ilibraries
+//             host/cllc_coeffgen.c -lm -o cllc_coeffgen
+//
+//         Usage:
+//         cllc_coeffgen [-g]
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include "cllc_settings.h"
+#include "DCL/DCLF32.h"
+#include "cllc_check.h"
+
+//
+// Defines
+//
+#define CLLC_COEFFGEN_ZEROS             3U
+#define CLLC_COEFFGEN_POLES             2U
+#define CLLC_COEFFGEN_ORDER_MAX         3U
+
+#define CLLC_COEFFGEN_RADIUS_MAX        0.9     // a pole at about 700 kHz
+#define CLLC_COEFFGEN_POLE_MOVE_MAX     1.0e-3
+
+//
+// typedefs
+//
+typedef struct
+{
+    const char *name;
+    const char *lab;
+    float64_t k;
+    float64_t zero_Hz[CLLC_COEFFGEN_ZEROS];     // 0 for none
+    float64_t pole_Hz[CLLC_COEFFGEN_POLES];     // 0 for none
+    float32_t a[CLLC_COEFFGEN_ORDER_MAX];       // a1..a3 of cllc_settings.h
+    float32_t b[CLLC_COEFFGEN_ORDER_MAX + 1];
+} CLLC_COEFFGEN_Loop;
+
+typedef struct
+{
+    uint16_t order;
+    float64_t a[CLLC_COEFFGEN_ORDER_MAX + 1];   // a[0] = 1
+    float64_t b[CLLC_COEFFGEN_ORDER_MAX + 1];
+} CLLC_COEFFGEN_Filter;
+
+//
+// Globals
+//
+static const CLLC_COEFFGEN_Loop CLLC_COEFFGEN_loop[] =
+{
+    {
+        "GV1", "LAB3", CLLC_GV1_ZPK_K,
+        CLLC_GV1_ZPK_ZEROS_HZ, CLLC_GV1_ZPK_POLES_HZ,
+        { CLLC_GV1_2P2Z_A1, CLLC_GV1_2P2Z_A2, CLLC_GV1_2P2Z_A3 },
+        { CLLC_GV1_2P2Z_B0, CLLC_GV1_2P2Z_B1, CLLC_GV1_2P2Z_B2,
+          CLLC_GV1_2P2Z_B3 }
+    },
+    {
+        "GI1", "LAB4", CLLC_GI1_ZPK_K,
+        CLLC_GI1_ZPK_ZEROS_HZ, CLLC_GI1_ZPK_POLES_HZ,
+        { CLLC_GI1_2P2Z_A1, CLLC_GI1_2P2Z_A2, CLLC_GI1_2P2Z_A3 },
+        { CLLC_GI1_2P2Z_B0, CLLC_GI1_2P2Z_B1, CLLC_GI1_2P2Z_B2,
+          CLLC_GI1_2P2Z_B3 }
+    },
+    {
+        "GI2", "LAB5", CLLC_GI2_ZPK_K,
+        CLLC_GI2_ZPK_ZEROS_HZ, CLLC_GI2_ZPK_POLES_HZ,
+        { CLLC_GI2_2P2Z_A1, CLLC_GI2_2P2Z_A2, CLLC_GI2_2P2Z_A3 },
+        { CLLC_GI2_2P2Z_B0, CLLC_GI2_2P2Z_B1, CLLC_GI2_2P2Z_B2,
+          CLLC_GI2_2P2Z_B3 }
+    },
+    {
+        "GV2", "LAB8", CLLC_GV2_ZPK_K,
+        CLLC_GV2_ZPK_ZEROS_HZ, CLLC_GV2_ZPK_POLES_HZ,
+        { CLLC_GV2_2P2Z_A1, CLLC_GV2_2P2Z_A2, CLLC_GV2_2P2Z_A3 },
+        { CLLC_GV2_2P2Z_B0, CLLC_GV2_2P2Z_B1, CLLC_GV2_2P2Z_B2,
+          CLLC_GV2_2P2Z_B3 }
+    },
+};
+
+//
+// Function Definitions
+//
+
+//
+// p = p * (c0 + c1 z^-1), p of order n
+//
+static void CLLC_COEFFGEN_multiply(float64_t *p, uint16_t n, float64_t c0,
+                                   float64_t c1)
+{
+    int16_t j;
+
+    p[n + 1] = p[n] * c1;
+    for(j = (int16_t)n; j > 0; j--)
+    {
+        p[j] = (p[j] * c0) + (p[j - 1] * c1);
+    }
+    p[0] = p[0] * c0;
+}
+
+//
+// The bilinear transform of the spec, s = 2/T (1 - z^-1)/(1 + z^-1). A
+// corner 1 + s/w goes to (1 + c) + (1 - c) z^-1 with c = 2/(T w), the
+// integrator to 2/T (1 - z^-1). Returns 0 for more zeros than poles.
+//
+static uint16_t CLLC_COEFFGEN_discretize(const CLLC_COEFFGEN_Loop *loop,
+                                         CLLC_COEFFGEN_Filter *filter)
+{
+    float64_t t = 1.0 / (float64_t)CLLC_ISR2_FREQUENCY_HZ;
+    float64_t c, scale;
+    uint16_t zeros = 0, j;
+
+    memset(filter, 0, sizeof(*filter));
+    filter->a[0] = 2.0 / t;
+    filter->a[1] = -2.0 / t;
+    filter->order = 1;
+    for(j = 0; j < CLLC_COEFFGEN_POLES; j++)
+    {
+        if(loop->pole_Hz[j] != 0.0)
+        {
+            c = 2.0 / (t * 2.0 * M_PI * loop->pole_Hz[j]);
+            CLLC_COEFFGEN_multiply(filter->a, filter->order, 1.0 + c,
+                                   1.0 - c);
+            filter->order++;
+        }
+    }
+
+    filter->b[0] = loop->k;
+    for(j = 0; j < CLLC_COEFFGEN_ZEROS; j++)
+    {
+        if(loop->zero_Hz[j] != 0.0)
+        {
+            if(zeros == filter->order)
+            {
+                return(0);
+            }
+            c = 2.0 / (t * 2.0 * M_PI * loop->zero_Hz[j]);
+            CLLC_COEFFGEN_multiply(filter->b, zeros, 1.0 + c, 1.0 - c);
+            zeros++;
+        }
+    }
+    for(; zeros < filter->order; zeros++)
+    {
+        CLLC_COEFFGEN_multiply(filter->b, zeros, 1.0, 1.0);
+    }
+
+    scale = filter->a[0];
+    for(j = 0; j <= filter->order; j++)
+    {
+        filter->a[j] = filter->a[j] / scale;
+        filter->b[j] = filter->b[j] / scale;
+    }
+
+    return(1);
+}
+
+//
+// The float32 set of the DF13. One a coefficient takes the rounding of the
+// others so that they sum to -1, the first of the order, smallest first,
+// that holds the sum exactly in float32.
+//
+static void CLLC_COEFFGEN_round(const CLLC_COEFFGEN_Filter *filter,
+                                float32_t *a, float32_t *b)
+{
+    float64_t sum;
+    uint16_t j, k, pick;
+    uint16_t taken = 0;
+
+    for(j = 0; j < CLLC_COEFFGEN_ORDER_MAX; j++)
+    {
+        a[j] = (float32_t)filter->a[j + 1];
+        b[j] = (float32_t)filter->b[j];
+    }
+    b[CLLC_COEFFGEN_ORDER_MAX] = (float32_t)filter->b[CLLC_COEFFGEN_ORDER_MAX];
+
+    while(taken != ((1U << filter->order) - 1U))
+    {
+        pick = 0;
+        for(j = 0; j < filter->order; j++)
+        {
+            if(((taken & (1U << j)) == 0U) &&
+               (((taken & (1U << pick)) != 0U) ||
+                (fabsf(a[j]) < fabsf(a[pick]))))
+            {
+                pick = j;
+            }
+        }
+        taken |= 1U << pick;
+
+        sum = 1.0;
+        for(k = 0; k < filter->order; k++)
+        {
+            sum += (k == pick) ? 0.0 : (float64_t)a[k];
+        }
+        if((float64_t)(float32_t)(-sum) == -sum)
+        {
+            a[pick] = (float32_t)(-sum);
+            break;
+        }
+    }
+}
+
+//
+// Divides the integrator out of 1 + a1 z^-1 + a2 z^-2 + a3 z^-3, leaving
+// 1 + c[0] z^-1 + c[1] z^-2. Returns the remainder, 0 with the integrator
+// on z = 1.
+//
+static float64_t CLLC_COEFFGEN_deflate(const float64_t *a, float64_t *c)
+{
+    c[0] = a[0] + 1.0;
+    c[1] = a[1] + c[0];
+
+    return(a[2] + c[1]);
+}
+
+static void CLLC_COEFFGEN_getRoots(const float64_t *c, double complex *root)
+{
+    double complex d = csqrt((c[0] * c[0]) - (4.0 * c[1]));
+
+    root[0] = (-c[0] + d) / 2.0;
+    root[1] = (-c[0] - d) / 2.0;
+}
+
+//
+// The checks of the float32 set, against the poles of the double one.
+// Returns the integral gain per ISR2.
+//
+static float64_t CLLC_COEFFGEN_check(const char *name,
+                                     const CLLC_COEFFGEN_Filter *filter,
+                                     const float32_t *a, const float32_t *b)
+{
+    float64_t a64[CLLC_COEFFGEN_ORDER_MAX], ideal[CLLC_COEFFGEN_ORDER_MAX];
+    float64_t c[2], cIdeal[2], remainder, radius, move, gain;
+    double complex root[2], rootIdeal[2], swap;
+    uint16_t j;
+    DCL_DF13_SPS sps = DF13_SPS_DEFAULTS;
+    DCL_DF13 df13;
+
+    for(j = 0; j < CLLC_COEFFGEN_ORDER_MAX; j++)
+    {
+        a64[j] = (float64_t)a[j];
+        ideal[j] = filter->a[j + 1];
+    }
+
+    remainder = CLLC_COEFFGEN_deflate(a64, c);
+    CLLC_COEFFGEN_deflate(ideal, cIdeal);
+    CLLC_CHECK_expectTrue(remainder == 0.0, "%s: integrator off z = 1 (%.6g)",
+                          name, remainder);
+
+    //
+    // a third pole on z = 0 leaves the other two to the test
+    //
+    sps.a1 = (float32_t)c[0];
+    sps.a2 = (float32_t)c[1];
+    sps.a3 = 0.0f;
+    df13.sps = &sps;
+    CLLC_CHECK_expectTrue(DCL_isStableDF13(&df13), "%s: unstable (%.6g)", name,
+                          c[0]);
+
+    CLLC_COEFFGEN_getRoots(c, root);
+    CLLC_COEFFGEN_getRoots(cIdeal, rootIdeal);
+    if(cabs(root[1]) > cabs(root[0]))
+    {
+        swap = root[0];
+        root[0] = root[1];
+        root[1] = swap;
+    }
+    radius = 0.0;
+    for(j = 0; j < 2U; j++)
+    {
+        if(creal(root[j]) < 0.0)
+        {
+            radius = fmax(radius, cabs(root[j]));
+        }
+    }
+    CLLC_CHECK_expectTrue(radius <= CLLC_COEFFGEN_RADIUS_MAX,
+                          "%s: alternating pole near z = -1 (%.6g)", name,
+                          radius);
+
+    move = fmin(fmax(cabs(root[0] - rootIdeal[0]),
+                     cabs(root[1] - rootIdeal[1])),
+                fmax(cabs(root[0] - rootIdeal[1]),
+                     cabs(root[1] - rootIdeal[0])));
+    CLLC_CHECK_expectTrue(move <= CLLC_COEFFGEN_POLE_MOVE_MAX,
+                          "%s: pole moved by the float32 rounding (%.6g)",
+                          name, move);
+
+    //
+    // near z = 1 the DF13 is gain / (1 - z^-1)
+    //
+    gain = ((float64_t)b[0] + (float64_t)b[1] + (float64_t)b[2] +
+            (float64_t)b[3]) / (1.0 + c[0] + c[1]);
+    CLLC_CHECK_expectTrue(gain > 0.0, "%s: integral gain not positive (%.6g)",
+                          name, gain);
+
+    fprintf(CLLC_CHECK_report, "%s order %u, integral gain %.4f per "
+            "ISR2, poles besides z = 1:", name, filter->order, gain);
+    for(j = 0; j + 1U < filter->order; j++)
+    {
+        fprintf(CLLC_CHECK_report, " %.4f%+.4fi", creal(root[j]),
+                cimag(root[j]));
+    }
+    fprintf(CLLC_CHECK_report, "\n");
+
+    return(gain);
+}
+
+static void CLLC_COEFFGEN_print(const CLLC_COEFFGEN_Loop *loop,
+                                const float32_t *a, const float32_t *b)
+{
+    uint16_t j;
+
+    printf("//\n// %s\n//\n", loop->lab);
+    for(j = 0; j < CLLC_COEFFGEN_ORDER_MAX; j++)
+    {
+        printf("#define CLLC_%s_2P2Z_A%u    (float32_t) %.10f\n", loop->name,
+               j + 1U, (float64_t)a[j]);
+    }
+    for(j = 0; j <= CLLC_COEFFGEN_ORDER_MAX; j++)
+    {
+        printf("#define CLLC_%s_2P2Z_B%u    (float32_t) %.10f\n", loop->name,
+               j, (float64_t)b[j]);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t generate = 0;
+    uint16_t n, j;
+    const CLLC_COEFFGEN_Loop *loop;
+    CLLC_COEFFGEN_Filter filter;
+    float32_t a[CLLC_COEFFGEN_ORDER_MAX], b[CLLC_COEFFGEN_ORDER_MAX + 1];
+
+    CLLC_CHECK_report = stdout;
+    if((argc == 2) && (strcmp(argv[1], "-g") == 0))
+    {
+        //
+        // the checks go to stderr, stdout is the block to paste
+        //
+        generate = 1;
+        CLLC_CHECK_report = stderr;
+    }
+    else if(argc != 1)
+    {
+        fprintf(stderr, "usage: %s [-g]\n", argv[0]);
+        return(1);
+    }
+
+    for(n = 0; n < sizeof(CLLC_COEFFGEN_loop) /
+                   sizeof(CLLC_COEFFGEN_loop[0]); n++)
+    {
+        loop = &CLLC_COEFFGEN_loop[n];
+        if(CLLC_COEFFGEN_discretize(loop, &filter) == 0U)
+        {
+            CLLC_CHECK_fail("%s: more zeros than poles (%.6g)", loop->name,
+                            loop->k);
+            continue;
+        }
+        CLLC_COEFFGEN_round(&filter, a, b);
+
+        if(generate != 0U)
+        {
+            CLLC_COEFFGEN_check(loop->name, &filter, a, b);
+            CLLC_COEFFGEN_print(loop, a, b);
+            continue;
+        }
+
+        for(j = 0; j < CLLC_COEFFGEN_ORDER_MAX; j++)
+        {
+            CLLC_CHECK_expectTrue(loop->a[j] == a[j],
+                                  "%s: a coefficient not the spec's (%.6g)",
+                                  loop->name, (float64_t)loop->a[j]);
+        }
+        for(j = 0; j <= CLLC_COEFFGEN_ORDER_MAX; j++)
+        {
+            CLLC_CHECK_expectTrue(loop->b[j] == b[j],
+                                  "%s: b coefficient not the spec's (%.6g)",
+                                  loop->name, (float64_t)loop->b[j]);
+        }
+        CLLC_COEFFGEN_check(loop->name, &filter, loop->a, loop->b);
+    }
+
+    if(generate != 0U)
+    {
+        return((CLLC_CHECK_failures == 0U) ? 0 : 1);
+    }
+
+    return(CLLC_CHECK_result());
+}
@@ -0,0 +1,518 @@
+//#############################################################################
+//
+// FILE:   cllc_datalog_bench.c
+//
+// TITLE:  Check of the datalogger against a model of its capture and timing
+//         of it against DLOG_4CH
+//         Runs the logger of cllc_datalog.h the way ISR2 and the background
+//         do, ISR2 runs interleaved with drains of the ring, and compares
+//         every record taken against the records a model of the decimation,
+//         pre-trigger history and post-trigger count says the capture holds.
+//         Covers decimation, each trigger source and the first of several,
+//         a software trigger asked for before the arm, a capture streamed
+//         through a ring shorter than it, a ring left full and re-arming.
+//         Then times one run of DLOG_4CH and of the logger with 4 channels.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -Wno-unknown-pragmas -Icllc -Ilibraries
+//             host/cllc_datalog_bench.c cllc/cllc_datalog.c -lm
+//             -o cllc_datalog_bench
+//
+//         Usage:
+//         cllc_datalog_bench [-t runs]
+//           -t  runs to time per logger (default 10000000)
+//
+//         Exits 0 when all captures match.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "cllc_datalog.h"
+#include "utilities/dlog_4ch.h"
+#include "cllc_check.h"
+
+//
+// Defines
+//
+#define CLLC_DATALOG_BENCH_RING_MAX     1024U
+#define CLLC_DATALOG_BENCH_RUNS_MAX     20000U
+#define CLLC_DATALOG_BENCH_BATCH        32U
+
+//
+// typedefs
+//
+typedef struct
+{
+    const char *name;
+    uint16_t channels;
+    uint16_t decimation[4];
+    uint16_t ringSize;
+    uint16_t preTrigger;
+    uint16_t postTrigger;
+    uint16_t sources;
+    uint16_t triggerChannel;
+    float32_t triggerLevel;
+    uint32_t softwareRun;       // run the background asks for the trigger on
+    uint32_t eventRun;          // run the event is set on
+    uint32_t runs;
+    uint32_t drainEvery;        // runs between drains, 0 only at the end
+    uint16_t rearm;             // arm again when done and take a second one
+} CLLC_DATALOG_BENCH_Case;
+
+typedef struct
+{
+    float32_t value;
+    uint16_t channel;
+    uint32_t run;
+} CLLC_DATALOG_BENCH_Sample;
+
+#define CLLC_DATALOG_BENCH_NONE         0xFFFFFFFFUL
+
+static const CLLC_DATALOG_BENCH_Case CLLC_DATALOG_BENCH_case[] =
+{
+    {"software",       3, {1, 2, 5, 1}, 256,  40,   100,
+     CLLC_DATALOG_TRIGGER_SOFTWARE, 0, 0.0f,  500, CLLC_DATALOG_BENCH_NONE,
+     1000,  1, 0},
+    {"early trigger",  2, {1, 3, 1, 1}, 256,  100,  50,
+     CLLC_DATALOG_TRIGGER_SOFTWARE, 0, 0.0f,  7,   CLLC_DATALOG_BENCH_NONE,
+     200,   1, 0},
+    {"event",          4, {1, 1, 1, 1}, 128,  64,   63,
+     CLLC_DATALOG_TRIGGER_EVENT,    0, 0.0f,  CLLC_DATALOG_BENCH_NONE, 333,
+     600,   0, 0},
+    {"rising",         2, {1, 4, 1, 1}, 256,  32,   200,
+     CLLC_DATALOG_TRIGGER_RISING,   0, 0.5f,  CLLC_DATALOG_BENCH_NONE,
+     CLLC_DATALOG_BENCH_NONE, 2000, 10, 0},
+    {"falling",        2, {2, 1, 1, 1}, 256,  32,   200,
+     CLLC_DATALOG_TRIGGER_FALLING,  1, -0.25f, CLLC_DATALOG_BENCH_NONE,
+     CLLC_DATALOG_BENCH_NONE, 2000, 10, 0},
+    {"first of all",   3, {1, 1, 2, 1}, 256,  50,   150,
+     CLLC_DATALOG_TRIGGER_SOFTWARE | CLLC_DATALOG_TRIGGER_EVENT |
+     CLLC_DATALOG_TRIGGER_RISING,   0, 0.5f,  1500, 1200, 3000, 5, 0},
+    {"early request",  2, {1, 1, 1, 1}, 256,  20,   40,
+     CLLC_DATALOG_TRIGGER_SOFTWARE | CLLC_DATALOG_TRIGGER_EVENT, 0, 0.0f,
+     0,    200,  400,   1, 0},
+    {"streamed",       4, {1, 1, 2, 8}, 64,   60,   9000,
+     CLLC_DATALOG_TRIGGER_SOFTWARE, 0, 0.0f,  100, CLLC_DATALOG_BENCH_NONE,
+     5000,  3, 0},
+    {"ring full",      4, {1, 1, 1, 1}, 64,   16,   200,
+     CLLC_DATALOG_TRIGGER_SOFTWARE, 0, 0.0f,  100, CLLC_DATALOG_BENCH_NONE,
+     300,   0, 0},
+    {"rearm",          2, {1, 2, 1, 1}, 128,  30,   60,
+     CLLC_DATALOG_TRIGGER_SOFTWARE, 0, 0.0f,  300, CLLC_DATALOG_BENCH_NONE,
+     1200,  4, 1},
+};
+
+static float32_t CLLC_DATALOG_BENCH_input[4];
+static volatile CLLC_DATALOG_Record
+    CLLC_DATALOG_BENCH_ring[CLLC_DATALOG_BENCH_RING_MAX];
+static CLLC_DATALOG_Record CLLC_DATALOG_BENCH_taken[CLLC_DATALOG_BENCH_RUNS_MAX
+                                                    * 4U];
+static CLLC_DATALOG_BENCH_Sample
+    CLLC_DATALOG_BENCH_sample[CLLC_DATALOG_BENCH_RUNS_MAX * 4U];
+
+//
+// Inputs of a run, the channels are told apart by their value, channel 0 a
+// sine for the level triggers
+//
+static void CLLC_DATALOG_BENCH_setInputs(uint32_t run)
+{
+    CLLC_DATALOG_BENCH_input[0] = sinf((float32_t)run * 0.01f);
+    CLLC_DATALOG_BENCH_input[1] = cosf((float32_t)run * 0.007f);
+    CLLC_DATALOG_BENCH_input[2] = 2000.0f + (float32_t)run;
+    CLLC_DATALOG_BENCH_input[3] = 3000.0f + (float32_t)run;
+}
+
+static double CLLC_DATALOG_BENCH_now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9));
+}
+
+static void CLLC_DATALOG_BENCH_setup(const CLLC_DATALOG_BENCH_Case *c,
+                                     CLLC_DATALOG_Log *log)
+{
+    uint16_t i;
+
+    CLLC_DATALOG_config(log, CLLC_DATALOG_BENCH_ring, c->ringSize,
+                        c->preTrigger, c->postTrigger);
+    for(i = 0; i < c->channels; i++)
+    {
+        CLLC_DATALOG_setChannel(log, i, &CLLC_DATALOG_BENCH_input[i],
+                                c->decimation[i]);
+    }
+    CLLC_DATALOG_setTrigger(log, c->sources, c->triggerChannel,
+                            c->triggerLevel);
+}
+
+//
+// The capture of the model: every sample the decimation takes from the arm
+// on, split at the first run a trigger fires on, preTrigger of them before
+// it and postTrigger from it. Returns the samples, the trigger run in
+// *triggerRun, none if it never fired.
+//
+static uint32_t CLLC_DATALOG_BENCH_model(const CLLC_DATALOG_BENCH_Case *c,
+                                         uint32_t armRun, uint32_t *triggerRun,
+                                         CLLC_DATALOG_BENCH_Sample *capture)
+{
+    float32_t previous, value, level = c->triggerLevel;
+    uint32_t run, before = 0, after = 0, taken = 0, first;
+    uint16_t i, fire;
+
+    *triggerRun = CLLC_DATALOG_BENCH_NONE;
+
+    CLLC_DATALOG_BENCH_setInputs(armRun);
+    previous = CLLC_DATALOG_BENCH_input[c->triggerChannel];
+
+    for(run = armRun; run < c->runs; run++)
+    {
+        CLLC_DATALOG_BENCH_setInputs(run);
+
+        if(*triggerRun == CLLC_DATALOG_BENCH_NONE)
+        {
+            value = CLLC_DATALOG_BENCH_input[c->triggerChannel];
+            fire = 0;
+            if(((c->sources & CLLC_DATALOG_TRIGGER_SOFTWARE) != 0U) &&
+               (c->softwareRun != 0U) &&
+               (c->softwareRun != CLLC_DATALOG_BENCH_NONE) &&
+               (run > c->softwareRun))
+            {
+                fire = 1;
+            }
+            if(((c->sources & CLLC_DATALOG_TRIGGER_EVENT) != 0U) &&
+               (c->eventRun != CLLC_DATALOG_BENCH_NONE) &&
+               (run >= c->eventRun))
+            {
+                fire = 1;
+            }
+            if(((c->sources & CLLC_DATALOG_TRIGGER_RISING) != 0U) &&
+               (previous < level) && (value >= level))
+            {
+                fire = 1;
+            }
+            if(((c->sources & CLLC_DATALOG_TRIGGER_FALLING) != 0U) &&
+               (previous > level) && (value <= level))
+            {
+                fire = 1;
+            }
+            previous = value;
+
+            if(fire != 0U)
+            {
+                *triggerRun = run;
+                before = taken;
+            }
+        }
+
+        for(i = 0; i < c->channels; i++)
+        {
+            if(((run - armRun) % c->decimation[i]) != 0U)
+            {
+                continue;
+            }
+            if((*triggerRun != CLLC_DATALOG_BENCH_NONE) &&
+               (after >= c->postTrigger))
+            {
+                break;
+            }
+            CLLC_DATALOG_BENCH_sample[taken].value =
+                    CLLC_DATALOG_BENCH_input[i];
+            CLLC_DATALOG_BENCH_sample[taken].channel = i;
+            CLLC_DATALOG_BENCH_sample[taken].run = run;
+            taken++;
+            if(*triggerRun != CLLC_DATALOG_BENCH_NONE)
+            {
+                after++;
+            }
+        }
+
+        if((*triggerRun != CLLC_DATALOG_BENCH_NONE) &&
+           (after >= c->postTrigger))
+        {
+            break;
+        }
+    }
+
+    if(*triggerRun == CLLC_DATALOG_BENCH_NONE)
+    {
+        return(0);
+    }
+
+    first = (before > c->preTrigger) ? (before - c->preTrigger) : 0U;
+    if((before - first) > (uint32_t)(c->ringSize - 1U))
+    {
+        first = before - (c->ringSize - 1U);
+    }
+    memcpy(capture, &CLLC_DATALOG_BENCH_sample[first],
+           (taken - first) * sizeof(CLLC_DATALOG_BENCH_Sample));
+    return(taken - first);
+}
+
+static uint32_t CLLC_DATALOG_BENCH_drain(CLLC_DATALOG_Log *log,
+                                         uint32_t taken)
+{
+    uint16_t count;
+
+    do
+    {
+        count = CLLC_DATALOG_read(log, &CLLC_DATALOG_BENCH_taken[taken], 16);
+        taken += count;
+    }
+    while(count != 0U);
+
+    return(taken);
+}
+
+//
+// The records taken against the model. With a full ring the ISR drops the
+// records that find no room, the ones taken are the first of the capture.
+//
+static void CLLC_DATALOG_BENCH_compare(const CLLC_DATALOG_BENCH_Case *c,
+                                       const CLLC_DATALOG_Log *log,
+                                       uint32_t armRun, uint32_t taken,
+                                       const CLLC_DATALOG_BENCH_Sample *model,
+                                       uint32_t modelCount,
+                                       uint32_t triggerRun)
+{
+    const CLLC_DATALOG_Record *r = CLLC_DATALOG_BENCH_taken;
+    uint32_t i, expected = modelCount;
+
+    if(c->drainEvery == 0U)
+    {
+        expected = (modelCount < c->ringSize) ? modelCount : c->ringSize;
+        if(log->overrunCount != (modelCount - expected))
+        {
+            CLLC_CHECK_fail("%s: %u records dropped, expected %lu", c->name,
+                            (unsigned)log->overrunCount,
+                            (unsigned long)(modelCount - expected));
+        }
+    }
+    else if(log->overrunCount != 0U)
+    {
+        CLLC_CHECK_fail("%s: %u records dropped", c->name,
+                        (unsigned)log->overrunCount);
+    }
+
+    if(taken != expected)
+    {
+        CLLC_CHECK_fail("%s (armed on run %lu): %lu records taken, "
+                        "expected %lu", c->name, (unsigned long)armRun,
+                        (unsigned long)taken, (unsigned long)expected);
+        if(taken > expected)
+        {
+            taken = expected;
+        }
+    }
+
+    if(log->triggerTick != (uint16_t)triggerRun)
+    {
+        CLLC_CHECK_fail("%s: triggered on run %u, expected %lu", c->name,
+                        (unsigned)log->triggerTick, (unsigned long)triggerRun);
+    }
+
+    for(i = 0; i < taken; i++)
+    {
+        if((r[i].value != model[i].value) ||
+           (r[i].channel != model[i].channel) ||
+           (r[i].tick != (uint16_t)model[i].run))
+        {
+            CLLC_CHECK_fail("%s: record %lu is channel %u run %u %g, "
+                            "expected channel %u run %lu %g", c->name,
+                            (unsigned long)i, (unsigned)r[i].channel,
+                            (unsigned)r[i].tick, r[i].value,
+                            (unsigned)model[i].channel,
+                            (unsigned long)model[i].run, model[i].value);
+            break;
+        }
+    }
+}
+
+static void CLLC_DATALOG_BENCH_runCase(const CLLC_DATALOG_BENCH_Case *c)
+{
+    static CLLC_DATALOG_BENCH_Sample model[CLLC_DATALOG_BENCH_RUNS_MAX * 4U];
+    CLLC_DATALOG_BENCH_Case active = *c;
+    CLLC_DATALOG_Log log;
+    uint32_t failuresBefore = CLLC_CHECK_failures;
+    uint32_t run, armRun = 0, taken = 0, modelCount, triggerRun;
+    uint32_t captures = 0;
+
+    CLLC_DATALOG_BENCH_setup(&active, &log);
+    CLLC_DATALOG_BENCH_setInputs(0);
+
+    //
+    // a software request ahead of the arm is dropped by it
+    //
+    if(active.softwareRun == 0U)
+    {
+        CLLC_DATALOG_trigger(&log);
+    }
+    CLLC_DATALOG_arm(&log);
+
+    modelCount = CLLC_DATALOG_BENCH_model(&active, armRun, &triggerRun,
+                                          model);
+
+    for(run = 0; run < active.runs; run++)
+    {
+        CLLC_DATALOG_BENCH_setInputs(run);
+        CLLC_DATALOG_run(&log,
+                         ((active.eventRun != CLLC_DATALOG_BENCH_NONE) &&
+                          (run >= active.eventRun)) ? 1U : 0U);
+
+        if((active.softwareRun != 0U) && (run == active.softwareRun))
+        {
+            CLLC_DATALOG_trigger(&log);
+        }
+
+        if((active.drainEvery != 0U) &&
+           (((run + 1U) % active.drainEvery) == 0U))
+        {
+            taken = CLLC_DATALOG_BENCH_drain(&log, taken);
+        }
+
+        if((active.rearm != 0U) && (CLLC_DATALOG_isDone(&log) != 0U))
+        {
+            CLLC_DATALOG_BENCH_compare(&active, &log, armRun, taken, model,
+                                       modelCount, triggerRun);
+            captures++;
+
+            //
+            // the ISR takes the arm on the next run, the trigger follows a
+            // while later
+            //
+            CLLC_DATALOG_arm(&log);
+            armRun = run + 1U;
+            taken = 0;
+            active.softwareRun = armRun + 150U;
+            active.rearm = 0;
+            modelCount = CLLC_DATALOG_BENCH_model(&active, armRun,
+                                                  &triggerRun, model);
+        }
+    }
+    taken = CLLC_DATALOG_BENCH_drain(&log, taken);
+
+    CLLC_DATALOG_BENCH_compare(&active, &log, armRun, taken, model,
+                               modelCount, triggerRun);
+    captures++;
+
+    if(CLLC_DATALOG_isDone(&log) == 0U)
+    {
+        CLLC_CHECK_fail("%s: capture not done", c->name);
+    }
+
+    printf("%-14s %u channels, ring %4u, %lu captures, %5lu records, "
+           "trigger on run %5lu, %3u dropped %s\n", c->name,
+           (unsigned)c->channels, (unsigned)c->ringSize,
+           (unsigned long)captures, (unsigned long)taken,
+           (unsigned long)triggerRun, (unsigned)log.overrunCount,
+           (CLLC_CHECK_failures == failuresBefore) ? "ok" : "FAIL");
+}
+
+int main(int argc, char *argv[])
+{
+    static float32_t buffer[4][CLLC_DATALOG_BENCH_BATCH * 4U];
+    CLLC_DATALOG_Log log;
+    DLOG_4CH dlog;
+    uint32_t timeRuns = 10000000;
+    uint32_t run, k;
+    double start, dlog_ns, datalog_ns, drain_ns;
+    size_t i;
+    int a;
+
+    for(a = 1; a < argc; a++)
+    {
+        if((strcmp(argv[a], "-t") == 0) && ((a + 1) < argc))
+        {
+            timeRuns = (uint32_t)strtoul(argv[++a], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-t runs]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    for(i = 0; i < (sizeof(CLLC_DATALOG_BENCH_case) /
+                    sizeof(CLLC_DATALOG_BENCH_case[0])); i++)
+    {
+        CLLC_DATALOG_BENCH_runCase(&CLLC_DATALOG_BENCH_case[i]);
+    }
+
+    timeRuns = (timeRuns / CLLC_DATALOG_BENCH_BATCH) *
+               CLLC_DATALOG_BENCH_BATCH;
+    if(timeRuns != 0U)
+    {
+        //
+        // DLOG_4CH logging all the time, it triggers again as soon as a
+        // buffer is full as channel 1 steps up through the level every run.
+        // Timed in the same batches as the logger so both carry the same
+        // clock reads.
+        //
+        DLOG_4CH_config(&dlog, &CLLC_DATALOG_BENCH_input[0],
+                        &CLLC_DATALOG_BENCH_input[1],
+                        &CLLC_DATALOG_BENCH_input[2],
+                        &CLLC_DATALOG_BENCH_input[3],
+                        buffer[0], buffer[1], buffer[2], buffer[3],
+                        CLLC_DATALOG_BENCH_BATCH * 4U, 0.5f, 1);
+        dlog_ns = 0;
+        for(run = 0; run < timeRuns; run += CLLC_DATALOG_BENCH_BATCH)
+        {
+            start = CLLC_DATALOG_BENCH_now_s();
+            for(k = 0; k < CLLC_DATALOG_BENCH_BATCH; k++)
+            {
+                CLLC_DATALOG_BENCH_input[0] = (float32_t)(k & 1U);
+                CLLC_DATALOG_BENCH_input[2] = (float32_t)(run + k);
+                DLOG_4CH_run(&dlog);
+            }
+            dlog_ns += CLLC_DATALOG_BENCH_now_s() - start;
+        }
+        dlog_ns = dlog_ns * 1e9 / (double)timeRuns;
+
+        //
+        // the logger streaming 4 channels, drained every batch of runs
+        //
+        CLLC_DATALOG_config(&log, CLLC_DATALOG_BENCH_ring, 256, 64, 0xFFFFU);
+        for(k = 0; k < 4U; k++)
+        {
+            CLLC_DATALOG_setChannel(&log, (uint16_t)k,
+                                    &CLLC_DATALOG_BENCH_input[k], 1);
+        }
+        CLLC_DATALOG_setTrigger(&log, CLLC_DATALOG_TRIGGER_SOFTWARE |
+                                CLLC_DATALOG_TRIGGER_RISING, 0, 0.5f);
+        datalog_ns = 0;
+        drain_ns = 0;
+        for(run = 0; run < timeRuns; run += CLLC_DATALOG_BENCH_BATCH)
+        {
+            if((log.state != CLLC_DATALOG_TRIGGERED) &&
+               (log.state != CLLC_DATALOG_ARMED))
+            {
+                CLLC_DATALOG_arm(&log);
+            }
+
+            start = CLLC_DATALOG_BENCH_now_s();
+            for(k = 0; k < CLLC_DATALOG_BENCH_BATCH; k++)
+            {
+                CLLC_DATALOG_BENCH_input[0] = (float32_t)(k & 1U);
+                CLLC_DATALOG_BENCH_input[2] = (float32_t)(run + k);
+                CLLC_DATALOG_run(&log, 0);
+            }
+            datalog_ns += CLLC_DATALOG_BENCH_now_s() - start;
+
+            start = CLLC_DATALOG_BENCH_now_s();
+            (void)CLLC_DATALOG_BENCH_drain(&log, 0);
+            drain_ns += CLLC_DATALOG_BENCH_now_s() - start;
+        }
+        datalog_ns = datalog_ns * 1e9 / (double)timeRuns;
+        drain_ns = drain_ns * 1e9 / (double)timeRuns;
+
+        printf("4 channels, ns per ISR2 run: DLOG_4CH %.2f, datalog %.2f "
+               "(+%.2f draining in the background), %u dropped\n", dlog_ns,
+               datalog_ns, drain_ns, (unsigned)log.overrunCount);
+    }
+
+    return(CLLC_CHECK_result());
+}
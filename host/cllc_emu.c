@@ -0,0 +1,1284 @@
+//#############################################################################
+//
+// FILE:   cllc_emu.c
+//
+// TITLE:  Host-side register-level peripheral emulator
+//         Register file, write watches and the ISR cadence that stands in
+//         for the PIE on the host, see cllc_emu.h
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "cllc.h"
+#include "cllc_emu.h"
+
+//
+// Register file, 16-bit word addressed like the C28x data space
+//
+uint16_t CLLC_EMU_regFile[CLLC_EMU_REGFILE_SIZE_WORDS];
+
+//
+// C28x core registers and intrinsics referenced by driverlib and the ISRs
+//
+volatile uint16_t IER;
+volatile uint16_t IFR;
+
+uint16_t __disable_interrupts(void)
+{
+    return(0);
+}
+
+uint16_t __enable_interrupts(void)
+{
+    return(0);
+}
+
+void SysCtl_delay(uint32_t count)
+{
+    (void)count;
+}
+
+//
+// device.c is not built for the host (PLL, flash and pin lock setup use
+// inline assembly), CLLC_HAL_setupDevice() is never called by the emulator
+//
+void Device_init(void)
+{
+}
+
+void Device_initGPIO(void)
+{
+}
+
+//
+// adc.c is not built either, ADC_setVREF() copies the offset trims from OTP
+// through a raw pointer, the emulated converters need no trimming
+//
+void ADC_setVREF(uint32_t base, ADC_ReferenceMode refMode,
+                 ADC_ReferenceVoltage refVoltage)
+{
+    (void)base;
+    (void)refMode;
+    (void)refVoltage;
+}
+
+//
+// gpio.c addresses the pin mux and pad control through raw pointers, pin
+// configuration has no effect on the emulated peripherals. The data
+// registers (GPxSET/GPxCLEAR used for profiling) are emulated.
+//
+void GPIO_setDirectionMode(uint32_t pin, GPIO_Direction pinIO)
+{
+    (void)pin;
+    (void)pinIO;
+}
+
+void GPIO_setPadConfig(uint32_t pin, uint32_t pinType)
+{
+    (void)pin;
+    (void)pinType;
+}
+
+void GPIO_setQualificationMode(uint32_t pin,
+                               GPIO_QualificationMode qualification)
+{
+    (void)pin;
+    (void)qualification;
+}
+
+void GPIO_setPinConfig(uint32_t pinConfig)
+{
+    (void)pinConfig;
+}
+
+void GPIO_setControllerCore(uint32_t pin, GPIO_CoreSelect core)
+{
+    (void)pin;
+    (void)core;
+}
+
+CLLC_EMU_Stats CLLC_EMU_stats;
+CLLC_EMU_PwmUpdateStats CLLC_EMU_pwmUpdate;
+#ifdef CLLC_EMU_COUNT_ACCESSES
+uint32_t CLLC_EMU_accessCount;
+CLLC_EMU_AccessStats CLLC_EMU_accesses[CLLC_EMU_ISR_TRIP + 1];
+#endif
+
+//
+// time since the last zero of the PRIM LEG1 counter, the up-down period is
+// taken from the active TBPRD:TBPRDHR
+//
+static double CLLC_EMU_pwmTime_s;
+
+//
+// TBPRD:TBPRDHR the up-down period was last worked out for, it only moves
+// when the firmware changes the frequency
+//
+static uint32_t CLLC_EMU_pwmPeriodKey;
+static double CLLC_EMU_pwmPeriod_s;
+
+#if CLLC_PWM_UPDATE_MODE == CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD
+//
+// ISR2 period in which an update held back by the firmware was first asked
+// for, negative when none is pending
+//
+static double CLLC_EMU_pwmDeferredSince_s = -1.0;
+#endif
+
+typedef struct
+{
+    uint32_t address;
+    uint32_t target;
+    uint32_t shadow;
+    uint16_t width;
+    uint16_t action;
+    char name[CLLC_EMU_NAME_LENGTH];
+} CLLC_EMU_Watch;
+
+static CLLC_EMU_Watch CLLC_EMU_watch[CLLC_EMU_MAX_WATCHES];
+static uint16_t CLLC_EMU_watchCount;
+
+//
+// the strobes have to be serviced after every ISR whether or not anyone
+// listens, the plain registers only matter to an event handler. They are
+// kept apart by width, no two strobes of different width share a target,
+// so the scan without a handler runs two straight loops.
+//
+typedef struct
+{
+    uint32_t address;
+    uint32_t target;
+    uint16_t action;
+} CLLC_EMU_Strobe;
+
+static CLLC_EMU_Strobe CLLC_EMU_strobe16[CLLC_EMU_MAX_WATCHES];
+static CLLC_EMU_Strobe CLLC_EMU_strobe32[CLLC_EMU_MAX_WATCHES];
+static uint16_t CLLC_EMU_strobe16Count;
+static uint16_t CLLC_EMU_strobe32Count;
+
+static CLLC_EMU_EventHandler CLLC_EMU_eventHandler;
+static void *CLLC_EMU_eventContext;
+
+static CLLC_EMU_SampleHook CLLC_EMU_sampleHook;
+static void *CLLC_EMU_sampleContext;
+
+static CLLC_EMU_StepEndHook CLLC_EMU_stepEndHook;
+static void *CLLC_EMU_stepEndContext;
+
+static void (*CLLC_EMU_handler[CLLC_EMU_MAX_HANDLERS])(void);
+static uint16_t CLLC_EMU_handlerCount;
+
+//
+// host memory the DMA can reach, found by the 32 bit address the firmware
+// wrote for it, a host pointer cut to the width of the DMA address registers
+//
+#define CLLC_EMU_MAX_MEMORY_MAPS 8U
+#define CLLC_EMU_DMA_CHANNELS    6U
+
+typedef struct
+{
+    uint32_t address;
+    uint32_t words;
+    volatile uint16_t *memory;
+} CLLC_EMU_MemoryMap;
+
+static CLLC_EMU_MemoryMap CLLC_EMU_memoryMap[CLLC_EMU_MAX_MEMORY_MAPS];
+static uint16_t CLLC_EMU_memoryMapCount;
+
+//
+// ISR3 runs off CPU timer 2 at CLLC_ISR3_FREQUENCY_HZ, expressed in ISR2
+// periods
+//
+#define CLLC_EMU_ISR3_DIVIDER ((uint32_t)(CLLC_ISR2_FREQUENCY_HZ /            \
+                                          CLLC_ISR3_FREQUENCY_HZ))
+
+static inline uint32_t CLLC_EMU_readWatch(const CLLC_EMU_Watch *w)
+{
+    if(w->width == CLLC_EMU_REG_32BIT)
+    {
+        return(HWREG(w->address));
+    }
+    return(HWREGH(w->address));
+}
+
+void CLLC_EMU_reset(void)
+{
+    memset(CLLC_EMU_regFile, 0, sizeof(CLLC_EMU_regFile));
+    memset(&CLLC_EMU_stats, 0, sizeof(CLLC_EMU_stats));
+    memset(&CLLC_EMU_pwmUpdate, 0, sizeof(CLLC_EMU_pwmUpdate));
+    #ifdef CLLC_EMU_COUNT_ACCESSES
+        memset(CLLC_EMU_accesses, 0, sizeof(CLLC_EMU_accesses));
+    #endif
+    CLLC_EMU_pwmTime_s = 0;
+    CLLC_EMU_pwmPeriodKey = 0;
+    CLLC_EMU_pwmPeriod_s = 0;
+    #if CLLC_PWM_UPDATE_MODE == CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD
+        CLLC_EMU_pwmDeferredSince_s = -1.0;
+    #endif
+    CLLC_EMU_watchCount = 0;
+    CLLC_EMU_strobe16Count = 0;
+    CLLC_EMU_strobe32Count = 0;
+    CLLC_EMU_handlerCount = 0;
+    CLLC_EMU_memoryMapCount = 0;
+    CLLC_EMU_eventHandler = NULL;
+    CLLC_EMU_eventContext = NULL;
+    CLLC_EMU_sampleHook = NULL;
+    CLLC_EMU_sampleContext = NULL;
+    CLLC_EMU_stepEndHook = NULL;
+    CLLC_EMU_stepEndContext = NULL;
+    IER = 0;
+    IFR = 0;
+}
+
+int16_t CLLC_EMU_watchRegister(uint32_t address, CLLC_EMU_RegWidth width,
+                               CLLC_EMU_Action action, uint32_t target,
+                               const char *name)
+{
+    CLLC_EMU_Watch *w;
+
+    if(CLLC_EMU_watchCount >= CLLC_EMU_MAX_WATCHES)
+    {
+        return(-1);
+    }
+
+    w = &CLLC_EMU_watch[CLLC_EMU_watchCount];
+    w->address = address;
+    w->target = target;
+    w->width = (uint16_t)width;
+    w->action = (uint16_t)action;
+    w->shadow = CLLC_EMU_readWatch(w);
+    strncpy(w->name, name, CLLC_EMU_NAME_LENGTH - 1);
+    w->name[CLLC_EMU_NAME_LENGTH - 1] = '\0';
+
+    if(action != CLLC_EMU_ACTION_NONE)
+    {
+        CLLC_EMU_Strobe *strobe = (width == CLLC_EMU_REG_32BIT) ?
+                &CLLC_EMU_strobe32[CLLC_EMU_strobe32Count++] :
+                &CLLC_EMU_strobe16[CLLC_EMU_strobe16Count++];
+
+        strobe->address = address;
+        strobe->target = target;
+        strobe->action = (uint16_t)action;
+    }
+
+    return((int16_t)CLLC_EMU_watchCount++);
+}
+
+static void CLLC_EMU_watchPWM(uint32_t base, uint16_t pwmNo)
+{
+    char name[CLLC_EMU_NAME_LENGTH];
+
+    snprintf(name, sizeof(name), "EPWM%u.TBPRDHR", pwmNo);
+    CLLC_EMU_watchRegister(base + HRPWM_O_TBPRDHR, CLLC_EMU_REG_32BIT,
+                           CLLC_EMU_ACTION_NONE, 0, name);
+    snprintf(name, sizeof(name), "EPWM%u.CMPA", pwmNo);
+    CLLC_EMU_watchRegister(base + HRPWM_O_CMPA, CLLC_EMU_REG_32BIT,
+                           CLLC_EMU_ACTION_NONE, 0, name);
+    snprintf(name, sizeof(name), "EPWM%u.CMPB", pwmNo);
+    CLLC_EMU_watchRegister(base + HRPWM_O_CMPB, CLLC_EMU_REG_32BIT,
+                           CLLC_EMU_ACTION_NONE, 0, name);
+    snprintf(name, sizeof(name), "EPWM%u.TBPHS", pwmNo);
+    CLLC_EMU_watchRegister(base + EPWM_O_TBPHS, CLLC_EMU_REG_32BIT,
+                           CLLC_EMU_ACTION_NONE, 0, name);
+    snprintf(name, sizeof(name), "EPWM%u.TBCTL", pwmNo);
+    CLLC_EMU_watchRegister(base + EPWM_O_TBCTL, CLLC_EMU_REG_16BIT,
+                           CLLC_EMU_ACTION_NONE, 0, name);
+    snprintf(name, sizeof(name), "EPWM%u.DBREDHR", pwmNo);
+    CLLC_EMU_watchRegister(base + HRPWM_O_DBREDHR, CLLC_EMU_REG_32BIT,
+                           CLLC_EMU_ACTION_NONE, 0, name);
+    snprintf(name, sizeof(name), "EPWM%u.DBFEDHR", pwmNo);
+    CLLC_EMU_watchRegister(base + HRPWM_O_DBFEDHR, CLLC_EMU_REG_32BIT,
+                           CLLC_EMU_ACTION_NONE, 0, name);
+    snprintf(name, sizeof(name), "EPWM%u.TZCLR", pwmNo);
+    CLLC_EMU_watchRegister(base + EPWM_O_TZCLR, CLLC_EMU_REG_16BIT,
+                           CLLC_EMU_ACTION_CLEAR_BITS, base + EPWM_O_TZFLG,
+                           name);
+    snprintf(name, sizeof(name), "EPWM%u.TZOSTCLR", pwmNo);
+    CLLC_EMU_watchRegister(base + EPWM_O_TZOSTCLR, CLLC_EMU_REG_16BIT,
+                           CLLC_EMU_ACTION_CLEAR_BITS, base + EPWM_O_TZOSTFLG,
+                           name);
+}
+
+//
+// Registers touched by the ISR hot paths, see CLLC_runISR1,
+// CLLC_runISR2_xxx, CLLC_runISR3 and the CLLC_HAL_clearXXX helpers
+//
+void CLLC_EMU_watchControlRegisters(void)
+{
+    uint16_t i;
+
+    CLLC_EMU_watchPWM(CLLC_PRIM_LEG1_PWM_BASE, CLLC_PRIM_LEG1_PWM_NO);
+    CLLC_EMU_watchPWM(CLLC_PRIM_LEG2_PWM_BASE, CLLC_PRIM_LEG2_PWM_NO);
+    CLLC_EMU_watchPWM(CLLC_SEC_LEG1_PWM_BASE, CLLC_SEC_LEG1_PWM_NO);
+    CLLC_EMU_watchPWM(CLLC_SEC_LEG2_PWM_BASE, CLLC_SEC_LEG2_PWM_NO);
+
+    CLLC_EMU_watchRegister(CLLC_ISR1_PERIPHERAL_TRIG_BASE + EPWM_O_CMPC,
+                           CLLC_EMU_REG_16BIT, CLLC_EMU_ACTION_NONE, 0,
+                           "ISR1.CMPC");
+    CLLC_EMU_watchRegister(CLLC_ISR1_PERIPHERAL_TRIG_BASE + EPWM_O_ETCLR,
+                           CLLC_EMU_REG_16BIT, CLLC_EMU_ACTION_CLEAR_BITS,
+                           CLLC_ISR1_PERIPHERAL_TRIG_BASE + EPWM_O_ETFLG,
+                           "ISR1.ETCLR");
+
+    CLLC_EMU_watchRegister(CLLC_ISR2_ECAP_BASE + ECAP_O_ECCLR,
+                           CLLC_EMU_REG_16BIT, CLLC_EMU_ACTION_CLEAR_BITS,
+                           CLLC_ISR2_ECAP_BASE + ECAP_O_ECFLG,
+                           "ISR2.ECCLR");
+
+    CLLC_EMU_watchRegister(CLLC_ISR3_PERIPHERAL_TRIG_BASE + ADC_O_INTFLGCLR,
+                           CLLC_EMU_REG_16BIT, CLLC_EMU_ACTION_CLEAR_BITS,
+                           CLLC_ISR3_PERIPHERAL_TRIG_BASE + ADC_O_INTFLG,
+                           "ISR3.INTFLGCLR");
+
+    for(i = 0; i < 4; i++)
+    {
+        char name[CLLC_EMU_NAME_LENGTH];
+
+        snprintf(name, sizeof(name), "XBAR.CLR%u", i + 1);
+        CLLC_EMU_watchRegister(XBAR_BASE + XBAR_O_CLR1 + (i * 2U),
+                               CLLC_EMU_REG_32BIT,
+                               CLLC_EMU_ACTION_CLEAR_BITS,
+                               XBAR_BASE + XBAR_O_FLG1 + (i * 2U), name);
+    }
+
+    CLLC_EMU_watchRegister(GPIODATA_BASE + GPIO_O_GPBSET, CLLC_EMU_REG_32BIT,
+                           CLLC_EMU_ACTION_SET_BITS,
+                           GPIODATA_BASE + GPIO_O_GPBDAT, "GPIO.GPBSET");
+    CLLC_EMU_watchRegister(GPIODATA_BASE + GPIO_O_GPBCLEAR,
+                           CLLC_EMU_REG_32BIT, CLLC_EMU_ACTION_CLEAR_BITS,
+                           GPIODATA_BASE + GPIO_O_GPBDAT, "GPIO.GPBCLEAR");
+
+    CLLC_EMU_watchRegister(PIECTRL_BASE + PIE_O_ACK, CLLC_EMU_REG_16BIT,
+                           CLLC_EMU_ACTION_CLEAR_BITS, PIECTRL_BASE + PIE_O_ACK,
+                           "PIE.ACK");
+}
+
+void CLLC_EMU_setEventHandler(CLLC_EMU_EventHandler handler, void *context)
+{
+    CLLC_EMU_eventHandler = handler;
+    CLLC_EMU_eventContext = context;
+}
+
+void CLLC_EMU_setSampleHook(CLLC_EMU_SampleHook hook, void *context)
+{
+    CLLC_EMU_sampleHook = hook;
+    CLLC_EMU_sampleContext = context;
+}
+
+void CLLC_EMU_getSampleHook(CLLC_EMU_SampleHook *hook, void **context)
+{
+    *hook = CLLC_EMU_sampleHook;
+    *context = CLLC_EMU_sampleContext;
+}
+
+void CLLC_EMU_setStepEndHook(CLLC_EMU_StepEndHook hook, void *context)
+{
+    CLLC_EMU_stepEndHook = hook;
+    CLLC_EMU_stepEndContext = context;
+}
+
+//
+// Apply one observed write, strobes are applied to their target and return
+// to zero, like the hardware reads them back
+//
+static void CLLC_EMU_applyWrite(CLLC_EMU_Watch *w, uint32_t value,
+                                uint16_t isr)
+{
+    CLLC_EMU_Event event;
+
+    if(w->action == CLLC_EMU_ACTION_NONE)
+    {
+        event.previous = w->shadow;
+        w->shadow = value;
+    }
+    else
+    {
+        event.previous = 0;
+
+        if(w->width == CLLC_EMU_REG_32BIT)
+        {
+            HWREG(w->address) = 0;
+            if(w->action == CLLC_EMU_ACTION_SET_BITS)
+            {
+                HWREG(w->target) |= value;
+            }
+            else
+            {
+                HWREG(w->target) &= ~value;
+            }
+        }
+        else
+        {
+            HWREGH(w->address) = 0;
+            if(w->action == CLLC_EMU_ACTION_SET_BITS)
+            {
+                HWREGH(w->target) |= (uint16_t)value;
+            }
+            else
+            {
+                HWREGH(w->target) &= (uint16_t)~value;
+            }
+        }
+    }
+
+    CLLC_EMU_stats.eventCount++;
+
+    if(CLLC_EMU_eventHandler != NULL)
+    {
+        event.step = CLLC_EMU_stats.step;
+        event.address = w->address;
+        event.value = value;
+        event.isr = isr;
+        event.watch = (uint16_t)(w - CLLC_EMU_watch);
+        event.name = w->name;
+        CLLC_EMU_eventHandler(&event, CLLC_EMU_eventContext);
+    }
+}
+
+//
+// Compare every watched register against its shadow and apply the strobes.
+// With no event handler installed only the strobes are scanned, the
+// shadows of the plain registers then catch up on the first scan after a
+// handler is set.
+//
+void CLLC_EMU_scanWrites(uint16_t isr)
+{
+    uint16_t i;
+
+    if(CLLC_EMU_eventHandler == NULL)
+    {
+        for(i = 0; i < CLLC_EMU_strobe16Count; i++)
+        {
+            const CLLC_EMU_Strobe *strobe = &CLLC_EMU_strobe16[i];
+            uint16_t value = HWREGH(strobe->address);
+
+            if(value != 0U)
+            {
+                HWREGH(strobe->address) = 0;
+                if(strobe->action == CLLC_EMU_ACTION_SET_BITS)
+                {
+                    HWREGH(strobe->target) |= value;
+                }
+                else
+                {
+                    HWREGH(strobe->target) &= (uint16_t)~value;
+                }
+                CLLC_EMU_stats.eventCount++;
+            }
+        }
+        for(i = 0; i < CLLC_EMU_strobe32Count; i++)
+        {
+            const CLLC_EMU_Strobe *strobe = &CLLC_EMU_strobe32[i];
+            uint32_t value = HWREG(strobe->address);
+
+            if(value != 0U)
+            {
+                HWREG(strobe->address) = 0;
+                if(strobe->action == CLLC_EMU_ACTION_SET_BITS)
+                {
+                    HWREG(strobe->target) |= value;
+                }
+                else
+                {
+                    HWREG(strobe->target) &= ~value;
+                }
+                CLLC_EMU_stats.eventCount++;
+            }
+        }
+        return;
+    }
+
+    for(i = 0; i < CLLC_EMU_watchCount; i++)
+    {
+        CLLC_EMU_Watch *w = &CLLC_EMU_watch[i];
+        uint32_t value = CLLC_EMU_readWatch(w);
+
+        if(w->action == CLLC_EMU_ACTION_NONE)
+        {
+            if(value != w->shadow)
+            {
+                CLLC_EMU_applyWrite(w, value, isr);
+            }
+        }
+        else if(value != 0U)
+        {
+            CLLC_EMU_applyWrite(w, value, isr);
+        }
+    }
+}
+
+const char *CLLC_EMU_getRegisterName(uint32_t address)
+{
+    uint16_t i;
+
+    for(i = 0; i < CLLC_EMU_watchCount; i++)
+    {
+        if(CLLC_EMU_watch[i].address == address)
+        {
+            return(CLLC_EMU_watch[i].name);
+        }
+    }
+    return("?");
+}
+
+uint16_t CLLC_EMU_getWatchCount(void)
+{
+    return(CLLC_EMU_watchCount);
+}
+
+//
+// Address, width and action of a watch, returns its name or NULL past the
+// last watch
+//
+const char *CLLC_EMU_getWatch(uint16_t index, uint32_t *address,
+                              CLLC_EMU_RegWidth *width,
+                              CLLC_EMU_Action *action)
+{
+    const CLLC_EMU_Watch *w;
+
+    if(index >= CLLC_EMU_watchCount)
+    {
+        return(NULL);
+    }
+
+    w = &CLLC_EMU_watch[index];
+    *address = w->address;
+    *width = (CLLC_EMU_RegWidth)w->width;
+    *action = (CLLC_EMU_Action)w->action;
+    return(w->name);
+}
+
+//
+// Interrupt_register() stores the handler address into the emulated PIE
+// vector table, which only keeps 32 bits of a host pointer. Handlers are
+// registered here so the vector can be resolved back to a callable function,
+// this keeps any vector swap done by the firmware effective on the host.
+//
+void CLLC_EMU_registerHandler(void (*handler)(void))
+{
+    if(CLLC_EMU_handlerCount < CLLC_EMU_MAX_HANDLERS)
+    {
+        CLLC_EMU_handler[CLLC_EMU_handlerCount++] = handler;
+    }
+}
+
+static inline uint32_t CLLC_EMU_getVector(uint32_t interruptNumber)
+{
+    return(HWREG((uint32_t)PIEVECTTABLE_BASE +
+                 (((interruptNumber & 0xFFFF0000U) >> 16U) * 2U)));
+}
+
+void CLLC_EMU_dispatch(uint32_t interruptNumber, uint16_t isr)
+{
+    uint32_t vector;
+    uint16_t i;
+
+    vector = CLLC_EMU_getVector(interruptNumber);
+
+    for(i = 0; i < CLLC_EMU_handlerCount; i++)
+    {
+        if((uint32_t)(uintptr_t)CLLC_EMU_handler[i] == vector)
+        {
+            uint32_t isr1Vector = CLLC_EMU_getVector(CLLC_ISR1_TRIG);
+
+            #ifdef CLLC_EMU_COUNT_ACCESSES
+                CLLC_EMU_AccessStats *a = &CLLC_EMU_accesses[isr];
+                uint32_t accesses = CLLC_EMU_accessCount;
+
+                CLLC_EMU_handler[i]();
+                accesses = CLLC_EMU_accessCount - accesses;
+                a->runs++;
+                a->total += accesses;
+                if(accesses > a->max)
+                {
+                    a->max = accesses;
+                }
+            #else
+                CLLC_EMU_handler[i]();
+            #endif
+            CLLC_EMU_scanWrites(isr);
+
+            if(CLLC_EMU_getVector(CLLC_ISR1_TRIG) != isr1Vector)
+            {
+                CLLC_EMU_pwmUpdate.vectorWriteCount++;
+            }
+            return;
+        }
+    }
+
+    CLLC_EMU_stats.unknownVectorCount++;
+}
+
+//
+// ISR1 is raised by the compare C match on the way up, CLLC_runISR1 parks
+// CMPC at 0xFFFF which the counter never reaches
+//
+uint16_t CLLC_EMU_isISR1Pending(void)
+{
+    return(((HWREGH(CLLC_ISR1_PERIPHERAL_TRIG_BASE + EPWM_O_ETSEL) &
+             EPWM_ETSEL_INTEN) != 0U) &&
+           (HWREGH(CLLC_ISR1_PERIPHERAL_TRIG_BASE + EPWM_O_CMPC) !=
+            0xFFFFU));
+}
+
+//
+// Up-down period of PRIM LEG1 from the active TBPRD:TBPRDHR, 0 before the
+// PWMs are set up
+//
+double CLLC_EMU_getPWMPeriod_s(void)
+{
+    uint32_t period;
+
+    period = ((uint32_t)HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_TBPRD) << 16) |
+             (HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_TBPRDHR) & 0xFF00U);
+
+    if(period != CLLC_EMU_pwmPeriodKey)
+    {
+        CLLC_EMU_pwmPeriodKey = period;
+        CLLC_EMU_pwmPeriod_s = 2.0 * ((double)period / 65536.0) /
+                               (double)CLLC_PWMSYSCLOCK_FREQ_HZ;
+    }
+    return(CLLC_EMU_pwmPeriod_s);
+}
+
+//
+// fmod(time_s, period_s) for a time of a few periods: the largest period
+// times a power of two that fits is taken off first, each subtraction is
+// exact as the time is then within a factor 2 of what is taken off, so the
+// result is the one of fmod without the library call
+//
+static inline double CLLC_EMU_wrapTime(double time_s, double period_s)
+{
+    double multiple_s = period_s;
+
+    while((multiple_s * 2.0) <= time_s)
+    {
+        multiple_s *= 2.0;
+    }
+
+    while(multiple_s >= period_s)
+    {
+        if(time_s >= multiple_s)
+        {
+            time_s -= multiple_s;
+        }
+        multiple_s *= 0.5;
+    }
+
+    return(time_s);
+}
+
+//
+// TBCTR and the direction of PRIM LEG1 at the ISR2 trigger, for the firmware
+// that reads them
+//
+static void CLLC_EMU_updateTimeBase(double period_s)
+{
+    uint16_t tbprd = HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_TBPRD);
+    double half_s = period_s * 0.5;
+    uint16_t status = HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_TBSTS) &
+                      ~EPWM_TBSTS_CTRDIR;
+
+    if(CLLC_EMU_pwmTime_s < half_s)
+    {
+        HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_TBCTR) =
+                (uint16_t)((CLLC_EMU_pwmTime_s / half_s) * tbprd);
+        status |= EPWM_TBSTS_CTRDIR;
+    }
+    else
+    {
+        HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_TBCTR) =
+                (uint16_t)(((period_s - CLLC_EMU_pwmTime_s) / half_s) * tbprd);
+    }
+    HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_TBSTS) = status;
+}
+
+static void CLLC_EMU_addPWMLatency(double latency_s)
+{
+    CLLC_EMU_PwmUpdateStats *u = &CLLC_EMU_pwmUpdate;
+
+    if((u->loadCount == 0U) || (latency_s < u->latencyMin_s))
+    {
+        u->latencyMin_s = latency_s;
+    }
+    if(latency_s > u->latencyMax_s)
+    {
+        u->latencyMax_s = latency_s;
+    }
+    u->latencySum_s += latency_s;
+    u->loadCount++;
+}
+
+//
+// ISR1 fires when the counter passes CMPC on the way up, in this period if
+// it has not got there yet, the registers it writes are all active at the
+// zero that follows
+//
+static void CLLC_EMU_requestPWMUpdateISR1(double period_s)
+{
+    uint16_t tbprd = HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_TBPRD);
+    uint16_t cmpc = HWREGH(CLLC_ISR1_PERIPHERAL_TRIG_BASE + EPWM_O_CMPC);
+    double isr1_s;
+
+    if(tbprd == 0U)
+    {
+        return;
+    }
+
+    isr1_s = ((double)cmpc / (double)tbprd) * period_s * 0.5;
+
+    CLLC_EMU_pwmUpdate.requestCount++;
+    CLLC_EMU_addPWMLatency(((CLLC_EMU_pwmTime_s <= isr1_s) ? period_s :
+                            (2.0 * period_s)) - CLLC_EMU_pwmTime_s);
+}
+
+#if CLLC_GLOBAL_LOAD_ENABLED == 1
+//
+// A global load one-shot latched by an ISR, the hardware clears OSHTLD when
+// it loads
+//
+static uint16_t CLLC_EMU_takeGlobalLoadLatch(void)
+{
+    if((HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_GLDCTL2) &
+        EPWM_GLDCTL2_OSHTLD) == 0U)
+    {
+        return(0);
+    }
+
+    HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_GLDCTL2) &=
+            (uint16_t)~EPWM_GLDCTL2_OSHTLD;
+    return(1);
+}
+#endif
+
+void CLLC_EMU_mapMemory(volatile void *memory, uint32_t words)
+{
+    CLLC_EMU_MemoryMap *m;
+
+    if(CLLC_EMU_memoryMapCount >= CLLC_EMU_MAX_MEMORY_MAPS)
+    {
+        return;
+    }
+
+    m = &CLLC_EMU_memoryMap[CLLC_EMU_memoryMapCount++];
+    m->address = (uint32_t)(uintptr_t)memory;
+    m->words = words;
+    m->memory = (volatile uint16_t *)memory;
+}
+
+#if CLLC_ADC_OVERSAMPLE > 1
+//
+// a word the DMA reads or writes, in the register file or in mapped memory,
+// NULL when the address is neither
+//
+static volatile uint16_t *CLLC_EMU_getDMAWord(uint32_t address)
+{
+    uint16_t i;
+
+    for(i = 0; i < CLLC_EMU_memoryMapCount; i++)
+    {
+        if((address - CLLC_EMU_memoryMap[i].address) <
+           CLLC_EMU_memoryMap[i].words)
+        {
+            return(&CLLC_EMU_memoryMap[i].memory[address -
+                                                 CLLC_EMU_memoryMap[i].address]);
+        }
+    }
+
+    if(address < CLLC_EMU_REGFILE_SIZE_WORDS)
+    {
+        return(&CLLC_EMU_regFile[address]);
+    }
+
+    return(NULL);
+}
+
+//
+// the ADC interrupt a DMA trigger stands for, 1 when it is enabled
+//
+static uint16_t CLLC_EMU_isDMATriggerEnabled(uint16_t trigger)
+{
+    static const uint32_t adcBase[3] = {ADCA_BASE, ADCB_BASE, ADCC_BASE};
+    uint16_t adc, adcInt, shift;
+
+    if((trigger < (uint16_t)DMA_TRIGGER_ADCA1) ||
+       (trigger > (uint16_t)DMA_TRIGGER_ADCC4))
+    {
+        return(0);
+    }
+
+    adc = (trigger - (uint16_t)DMA_TRIGGER_ADCA1) / 5U;
+    adcInt = (trigger - (uint16_t)DMA_TRIGGER_ADCA1) % 5U;
+    if(adcInt == 4U)
+    {
+        return(0);
+    }
+
+    shift = (adcInt & 0x1U) << 3U;
+    return(((HWREGH(adcBase[adc] + ADC_INTSELxNy_OFFSET_BASE + (adcInt >> 1)) >>
+             shift) & ADC_INTSEL1N2_INT1E) ? 1U : 0U);
+}
+
+//
+// The ADC SOCs are taken to convert once per ISR2 period, so every enabled
+// ADC interrupt comes once, after the plant has written the results and
+// ahead of ISR2. A channel running on one moves one burst of 16 bit words,
+// stepping the addresses as the DMA does and leaving them in the active
+// address registers, and starts over from the begin addresses once its
+// transfer is done. Wrap is not modelled.
+//
+static void CLLC_EMU_runDMA(void)
+{
+    static uint16_t burstsLeft[CLLC_EMU_DMA_CHANNELS];
+    static uint32_t src[CLLC_EMU_DMA_CHANNELS];
+    static uint32_t dst[CLLC_EMU_DMA_CHANNELS];
+    uint32_t base, select;
+    uint16_t ch, trigger, word, words;
+    volatile uint16_t *from, *to;
+
+    for(ch = 0; ch < CLLC_EMU_DMA_CHANNELS; ch++)
+    {
+        base = DMA_CH1_BASE + ((uint32_t)ch * (DMA_CH2_BASE - DMA_CH1_BASE));
+        if(((HWREGH(base + DMA_O_MODE) & DMA_MODE_PERINTE) == 0U) ||
+           ((HWREGH(base + DMA_O_CONTROL) & DMA_CONTROL_RUN) == 0U))
+        {
+            if(burstsLeft[ch] != 0U)
+            {
+                burstsLeft[ch] = 0;
+            }
+            continue;
+        }
+
+        select = HWREG(DMACLASRCSEL_BASE + ((ch < 4U) ?
+                                            SYSCTL_O_DMACHSRCSEL1 :
+                                            SYSCTL_O_DMACHSRCSEL2));
+        trigger = (uint16_t)((select >> ((ch % 4U) * 8U)) & 0xFFU);
+        if(CLLC_EMU_isDMATriggerEnabled(trigger) == 0U)
+        {
+            continue;
+        }
+
+        if(burstsLeft[ch] == 0U)
+        {
+            src[ch] = HWREG(base + DMA_O_SRC_BEG_ADDR_SHADOW);
+            dst[ch] = HWREG(base + DMA_O_DST_BEG_ADDR_SHADOW);
+            burstsLeft[ch] = HWREGH(base + DMA_O_TRANSFER_SIZE) + 1U;
+        }
+
+        words = HWREGH(base + DMA_O_BURST_SIZE) + 1U;
+        for(word = 0; word < words; word++)
+        {
+            from = CLLC_EMU_getDMAWord(src[ch]);
+            to = CLLC_EMU_getDMAWord(dst[ch]);
+            if((from == NULL) || (to == NULL) ||
+               ((HWREGH(base + DMA_O_MODE) & DMA_MODE_DATASIZE) != 0U))
+            {
+                CLLC_EMU_stats.dmaFaultCount++;
+                break;
+            }
+            *to = *from;
+
+            if(word + 1U < words)
+            {
+                src[ch] += (int16_t)HWREGH(base + DMA_O_SRC_BURST_STEP);
+                dst[ch] += (int16_t)HWREGH(base + DMA_O_DST_BURST_STEP);
+            }
+        }
+        src[ch] += (int16_t)HWREGH(base + DMA_O_SRC_TRANSFER_STEP);
+        dst[ch] += (int16_t)HWREGH(base + DMA_O_DST_TRANSFER_STEP);
+        HWREG(base + DMA_O_SRC_ADDR_ACTIVE) = src[ch];
+        HWREG(base + DMA_O_DST_ADDR_ACTIVE) = dst[ch];
+        CLLC_EMU_stats.dmaBurstCount++;
+
+        burstsLeft[ch]--;
+        if((burstsLeft[ch] == 0U) &&
+           ((HWREGH(base + DMA_O_MODE) & DMA_MODE_CONTINUOUS) == 0U))
+        {
+            HWREGH(base + DMA_O_CONTROL) &= ~DMA_CONTROL_RUN;
+        }
+    }
+}
+#endif
+
+#if CLLC_ADC_CALIBRATION == 1
+//
+// The PPBs of ADCA, ADCB and ADCC: each takes its reference offset off the
+// result of the SOC it is set up on, as a signed 32 bit result. Only the
+// offset is modelled, not the limits, the delta or the two's complement.
+//
+static void CLLC_EMU_runADCPPB(void)
+{
+    static const uint32_t adcBase[3] = {ADCA_BASE, ADCB_BASE, ADCC_BASE};
+    static const uint32_t resultBase[3] = {ADCARESULT_BASE, ADCBRESULT_BASE,
+                                           ADCCRESULT_BASE};
+    uint32_t config, result;
+    uint16_t adc, ppb, soc, offset;
+
+    for(adc = 0; adc < 3U; adc++)
+    {
+        config = adcBase[adc] + ADC_O_PPB1CONFIG;
+        result = resultBase[adc] + ADC_RESULTx_OFFSET_BASE;
+
+        for(ppb = 0; ppb < 4U; ppb++)
+        {
+            soc = HWREGH(config) & ADC_PPB1CONFIG_CONFIG_M;
+            offset = HWREGH(config + (ADC_O_PPB1OFFREF - ADC_O_PPB1CONFIG));
+            HWREG(resultBase[adc] + ADC_PPBxRESULT_OFFSET_BASE +
+                  ((uint32_t)ppb * 2UL)) =
+                    (uint32_t)((int32_t)HWREGH(result + (uint32_t)soc) -
+                               (int32_t)offset);
+            config += ADC_PPBxCONFIG_STEP;
+        }
+    }
+}
+#endif
+
+//
+// One ISR2 period, i.e. 1/CLLC_ISR2_FREQUENCY_HZ of simulated time
+//
+void CLLC_EMU_step(void)
+{
+    double period_s = CLLC_EMU_getPWMPeriod_s();
+
+    CLLC_EMU_updateTimeBase(period_s);
+
+    if(CLLC_EMU_sampleHook != NULL)
+    {
+        CLLC_EMU_sampleHook(CLLC_EMU_sampleContext);
+    }
+
+    //
+    // the firmware only sets up the PPBs for the ADC calibration and the
+    // DMA for the oversampling, the other builds leave both idle
+    //
+    #if CLLC_ADC_CALIBRATION == 1
+        CLLC_EMU_runADCPPB();
+    #endif
+    #if CLLC_ADC_OVERSAMPLE > 1
+        CLLC_EMU_runDMA();
+    #endif
+
+    #if CLLC_ISR2_RUNNING_ON == C28x_CORE
+        CLLC_EMU_dispatch(CLLC_ISR2_TRIG, CLLC_EMU_ISR2);
+    #else
+        //
+        // the C28x background loop publishes between two ISR2, the ECAP
+        // then triggers the CLA background task
+        //
+        CLLC_sendCLASetpoints();
+        Cla1BackgroundTask();
+        CLLC_EMU_scanWrites(CLLC_EMU_ISR2);
+    #endif
+    CLLC_EMU_stats.isr2Count++;
+
+    #if CLLC_GLOBAL_LOAD_ENABLED == 1
+        if(CLLC_EMU_takeGlobalLoadLatch() && (period_s > 0.0))
+        {
+            double latency_s = period_s - CLLC_EMU_pwmTime_s;
+
+            #if CLLC_PWM_UPDATE_MODE == CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD
+                if(CLLC_EMU_pwmDeferredSince_s >= 0.0)
+                {
+                    latency_s += ((double)CLLC_EMU_stats.step /
+                                  (double)CLLC_ISR2_FREQUENCY_HZ) -
+                                 CLLC_EMU_pwmDeferredSince_s;
+                    CLLC_EMU_pwmDeferredSince_s = -1.0;
+                }
+            #endif
+
+            CLLC_EMU_pwmUpdate.requestCount++;
+            CLLC_EMU_addPWMLatency(latency_s);
+        }
+    #endif
+
+    #if CLLC_PWM_UPDATE_MODE == CLLC_PWM_UPDATE_ISR2_GLOBAL_LOAD
+        if(CLLC_pwmUpdateDeferred && (CLLC_EMU_pwmDeferredSince_s < 0.0))
+        {
+            CLLC_EMU_pwmDeferredSince_s = (double)CLLC_EMU_stats.step /
+                                          (double)CLLC_ISR2_FREQUENCY_HZ;
+        }
+    #endif
+
+    if(CLLC_EMU_isISR1Pending())
+    {
+        CLLC_EMU_requestPWMUpdateISR1(period_s);
+
+        #if CLLC_ISR1_RUNNING_ON == C28x_CORE
+            CLLC_EMU_dispatch(CLLC_ISR1_TRIG, CLLC_EMU_ISR1);
+        #else
+            Cla1Task1();
+            CLLC_EMU_scanWrites(CLLC_EMU_ISR1);
+        #endif
+        CLLC_EMU_stats.isr1Count++;
+        CLLC_EMU_pwmUpdate.isr1Count++;
+
+        #if CLLC_GLOBAL_LOAD_ENABLED == 1
+            CLLC_EMU_takeGlobalLoadLatch();
+        #endif
+    }
+
+    if((CLLC_EMU_stats.step % CLLC_EMU_ISR3_DIVIDER) ==
+       (CLLC_EMU_ISR3_DIVIDER - 1U))
+    {
+        CLLC_EMU_dispatch(CLLC_ISR3_TRIG, CLLC_EMU_ISR3);
+        CLLC_EMU_stats.isr3Count++;
+    }
+
+    CLLC_EMU_stats.step++;
+
+    if(period_s > 0.0)
+    {
+        CLLC_EMU_pwmTime_s = CLLC_EMU_wrapTime(CLLC_EMU_pwmTime_s +
+                                               (1.0 /
+                                                (double)CLLC_ISR2_FREQUENCY_HZ),
+                                               period_s);
+    }
+
+    if(CLLC_EMU_stepEndHook != NULL)
+    {
+        CLLC_EMU_stepEndHook(CLLC_EMU_stepEndContext);
+    }
+}
+
+void CLLC_EMU_run(uint32_t steps)
+{
+    uint32_t i;
+
+    for(i = 0; i < steps; i++)
+    {
+        CLLC_EMU_step();
+    }
+}
+
+//
+// Same bring-up as main() in cllc_main.c, minus CLLC_HAL_setupDevice() which
+// waits on the PLL and flash wait states
+//
+void CLLC_EMU_initFirmware(void)
+{
+    CLLC_EMU_reset();
+
+    CLLC_initGlobalVariables();
+    CLLC_setBuildLevelIndicatorVariable();
+
+    CLLC_HAL_disablePWMClkCounting();
+    CLLC_HAL_setupADC();
+#if CLLC_ADC_CALIBRATION == 1
+    CLLC_setupADCCalibration();
+#endif
+    CLLC_HAL_setupTrigForADC();
+#if CLLC_PROFILING == CLLC_PROFILING_GPIO
+    CLLC_HAL_setupProfilingGPIO();
+#elif CLLC_PROFILING == CLLC_PROFILING_ERAD
+    CLLC_HAL_setupERADProfiler(
+            CLLC_powerFlowStateActive.CLLC_PowerFlowState_Enum);
+#endif
+    CLLC_HAL_setupPWM(CLLC_powerFlowStateActive.CLLC_PowerFlowState_Enum);
+
+#if CLLC_GLOBAL_LOAD_ENABLED == 1
+    CLLC_HAL_setupGlobalLoad();
+#else
+    HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_GLDCTL) = 0xA1;
+    HWREGH(CLLC_PRIM_LEG2_PWM_BASE + EPWM_O_GLDCTL) = 0xA7;
+#endif
+    HWREG(CLLC_PRIM_LEG2_PWM_BASE + EPWM_O_XLINK) &= ~(0xF0000000);
+#if CLLC_PHASES > 1
+    CLLC_setupPhases();
+#endif
+
+    CLLC_HAL_setupPWMpins(CLLC_pwmSwState_synchronousRectification_active);
+    CLLC_HAL_setupSynchronousRectificationAction(
+            CLLC_powerFlowStateActive.CLLC_PowerFlowState_Enum);
+    CLLC_HAL_setupSynchronousRectificationActionDebug(
+            CLLC_powerFlowStateActive.CLLC_PowerFlowState_Enum);
+    CLLC_HAL_enablePWMClkCounting();
+
+#if CLLC_PHASES == 1
+    CLLC_HAL_setupPWMinUpDownCountMode(CLLC_ISR2_PWM_BASE,
+                               CLLC_ISR2_FREQUENCY_HZ,
+                               CLLC_PWMSYSCLOCK_FREQ_HZ);
+#endif
+    CLLC_HAL_setupECAPinPWMMode(CLLC_ISR2_ECAP_BASE,
+                                 CLLC_ISR2_FREQUENCY_HZ,
+                                 CLLC_PWMSYSCLOCK_FREQ_HZ);
+
+    CLLC_setupSFRA();
+
+    //
+    // the SCI is not emulated, its interrupt never comes and once the ring
+    // is full the frames count as dropped
+    //
+    #if CLLC_TELEMETRY_ENABLE == 1
+        CLLC_HAL_setupTelemetrySCI();
+    #endif
+
+    //
+    // nor is the FSI, no setpoint frame ever lands, see
+    // host/cllc_fsi_loopback.h for the link
+    //
+    #if CLLC_FSI_ENABLE == 1
+        CLLC_HAL_setupFSI();
+    #endif
+
+    //
+    // the DMA of the oversampling SOCs copies into firmware RAM
+    //
+    #if CLLC_ADC_OVERSAMPLE > 1
+        CLLC_EMU_mapMemory(CLLC_HAL_iSecOversample,
+                           2U * CLLC_ADC_OVERSAMPLE);
+        CLLC_EMU_mapMemory(CLLC_HAL_vSecOversample,
+                           2U * CLLC_ADC_OVERSAMPLE);
+    #endif
+
+    //
+    // nor is the MCAN: mcan.c reaches it through plain pointers, not HWREG,
+    // so CLLC_HAL_setupMCAN is not run. The service still runs on the
+    // register file, where no frame leaves and no command lands, see
+    // host/cllc_mcan_stub.h for it against a stub
+    //
+
+    #if CLLC_ISR2_RUNNING_ON == CLA_CORE
+        //
+        // the message RAMs come out of their hardware init cleared
+        //
+        memset((void *)&CLLC_cpuToClaMailbox, 0,
+               sizeof(CLLC_cpuToClaMailbox));
+        memset((void *)&CLLC_claToCpuMailbox, 0,
+               sizeof(CLLC_claToCpuMailbox));
+        CLLC_initCLASetpoints();
+    #endif
+
+    #if CLLC_ISR1_RUNNING_ON == C28x_CORE
+        CLLC_EMU_registerHandler(&CLLC_ISR1);
+        CLLC_EMU_registerHandler(&CLLC_ISR1_second);
+    #endif
+    #if CLLC_ISR2_RUNNING_ON == C28x_CORE
+        CLLC_EMU_registerHandler(&CLLC_ISR2_primToSecPowerFlow);
+        CLLC_EMU_registerHandler(&CLLC_ISR2_secToPrimPowerFlow);
+    #endif
+    CLLC_EMU_registerHandler(&CLLC_ISR3);
+    #if CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_EVENT
+        CLLC_EMU_registerHandler(&CLLC_tripEventISR);
+    #endif
+
+    CLLC_HAL_setupInterrupt(CLLC_powerFlowStateActive.CLLC_PowerFlowState_Enum);
+
+    //
+    // the latch set by CLLC_HAL_setupPWM is taken at the first zero
+    //
+    #if CLLC_GLOBAL_LOAD_ENABLED == 1
+        CLLC_EMU_takeGlobalLoadLatch();
+    #endif
+
+    //
+    // start watching once the init writes have settled
+    //
+    CLLC_EMU_watchControlRegisters();
+}
+
+//
+// The watch window requests, taken by the next ISR2. With ISR2 on the CLA
+// the precharge state belongs to the CLA and is started through
+// CLLC_startPrecharge.
+//
+void CLLC_EMU_clearTrip(void)
+{
+    CLLC_clearTrip = 1;
+}
+
+//
+// A board trip between two ISR2: latches the input X-BAR flag of the CMPSS
+// trip, XBAR_INPUT_FLG_xxx, and the one-shot trip of the four PWMs it
+// reaches through TRIP4. The trip zone interrupt is taken right away when
+// the one-shot flag of CLLC_TRIP_EVENT_PWM_BASE was clear and its interrupt
+// enabled, a trip on a set flag raises none, as on the device.
+//
+void CLLC_EMU_raiseTrip(uint16_t inputFlag)
+{
+    static const uint32_t base[4] = {CLLC_PRIM_LEG1_PWM_BASE,
+                                     CLLC_PRIM_LEG2_PWM_BASE,
+                                     CLLC_SEC_LEG1_PWM_BASE,
+                                     CLLC_SEC_LEG2_PWM_BASE};
+    uint16_t tzflg = HWREGH(CLLC_TRIP_EVENT_PWM_BASE + EPWM_O_TZFLG);
+    uint16_t i;
+
+    HWREG(XBAR_BASE + XBAR_O_FLG1 +
+          (((inputFlag & XBAR_INPUT_FLG_REG_M) >> 8U) * 2U)) |=
+            (uint32_t)1U << (inputFlag & XBAR_INPUT_FLG_INPUT_M);
+
+    for(i = 0; i < 4U; i++)
+    {
+        HWREGH(base[i] + EPWM_O_TZFLG) |= EPWM_TZFLG_OST;
+    }
+
+    if(((tzflg & (EPWM_TZFLG_OST | EPWM_TZFLG_INT)) == 0U) &&
+       ((HWREGH(CLLC_TRIP_EVENT_PWM_BASE + EPWM_O_TZEINT) &
+         EPWM_TZ_INTERRUPT_OST) != 0U))
+    {
+        HWREGH(CLLC_TRIP_EVENT_PWM_BASE + EPWM_O_TZFLG) |= EPWM_TZFLG_INT;
+        #if CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_EVENT
+            CLLC_EMU_dispatch(CLLC_TRIP_EVENT_TRIG, CLLC_EMU_ISR_TRIP);
+        #endif
+    }
+}
+
+void CLLC_EMU_startPrecharge(void)
+{
+    #if CLLC_ISR2_RUNNING_ON == CLA_CORE
+        CLLC_startPrecharge = 1;
+    #else
+        CLLC_PrechargeState.CLLC_PrechargeState_Enum =
+                CLLC_precharge_starting;
+    #endif
+}
+
+//
+// Release the firmware the same way as from the watch window, the first
+// ISR2 clears the trips, then the precharge of the prim to sec labs is armed
+//
+void CLLC_EMU_startFirmware(void)
+{
+    CLLC_EMU_clearTrip();
+    CLLC_EMU_step();
+
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_PRIM_SEC
+        CLLC_EMU_startPrecharge();
+    #endif
+}
+
+//
+// Close the loop of a closed loop lab once the buses have come up. The
+// voltage reference of the sec to prim lab is slewed in CLLC_runISR3 and is
+// not reset by CLLC_initGlobalVariables, so it is started from the present
+// output and one more ISR2 is run open loop to load the DF13 history with
+// that error. The prim to sec labs keep their slewed reference on the
+// output and the DF13 history on the running period while open, so their
+// loop closes as it is. Returns the ISR2 periods the reference then takes to
+// reach CLLC_vPrimRef_Volts, 0 for the other labs.
+//
+uint32_t CLLC_EMU_closeLoop(void)
+{
+    uint32_t rampSteps = 0;
+
+    #if CLLC_INCR_BUILD == CLLC_CLOSED_LOOP_BUILD
+        #if CLLC_CONTROL_MODE == CLLC_CURRENT_MODE
+            CLLC_closeGiLoop = 1;
+        #else
+            #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+                CLLC_vPrimRefSlewed_pu = CLLC_vPrimSensed_pu;
+                CLLC_EMU_step();
+
+                rampSteps = (uint32_t)((fabsf(CLLC_vPrimRef_Volts -
+                                              (CLLC_vPrimSensed_pu *
+                                               CLLC_VPRIM_MAX_SENSE_VOLTS)) /
+                                        CLLC_VOLTS_PER_SECOND_SLEW) *
+                                       CLLC_ISR2_FREQUENCY_HZ);
+            #endif
+            CLLC_closeGvLoop = 1;
+        #endif
+    #endif
+
+    return(rampSteps);
+}
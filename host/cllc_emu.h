@@ -0,0 +1,214 @@
+//#############################################################################
+//
+// FILE:   cllc_emu.h
+//
+// TITLE:  Host-side register-level peripheral emulator
+//         The EPWM/HRPWM, ADC result, ECAP, CMPSS, XBAR, GPIO and PIE
+//         register windows from device/driverlib/inc/hw_*.h are mapped onto
+//         one emulated register file so the unmodified ISR code in cllc.h
+//         and cllc.c runs natively. Writes to watched registers are reported
+//         as events after every ISR invocation.
+//
+//#############################################################################
+
+#ifndef CLLC_EMU_H
+#define CLLC_EMU_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "cllc_emu_target.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_adc.h"
+#include "cllc_settings.h"
+
+//
+// Defines
+//
+#define CLLC_EMU_MAX_WATCHES     96
+#define CLLC_EMU_MAX_HANDLERS    16
+#define CLLC_EMU_NAME_LENGTH     24
+
+//
+// ISR tags carried by the events
+//
+#define CLLC_EMU_ISR_NONE   0
+#define CLLC_EMU_ISR1       1
+#define CLLC_EMU_ISR2       2
+#define CLLC_EMU_ISR3       3
+#define CLLC_EMU_ISR_TRIP   4       // trip zone, CLLC_TRIP_DECODE_EVENT
+
+//
+// typedefs
+//
+typedef enum
+{
+    CLLC_EMU_REG_16BIT = 1,
+    CLLC_EMU_REG_32BIT = 2
+} CLLC_EMU_RegWidth;
+
+typedef enum
+{
+    //
+    // plain register, an event is raised when the value changes
+    //
+    CLLC_EMU_ACTION_NONE = 0,
+    //
+    // write-1-to-clear strobe (ETCLR, ECCLR, XBAR CLRx, ...), the written bits
+    // are cleared in the target flag register and the strobe reads back 0
+    //
+    CLLC_EMU_ACTION_CLEAR_BITS = 1,
+    //
+    // write-1-to-set strobe (GPxSET), the written bits are set in the target
+    //
+    CLLC_EMU_ACTION_SET_BITS = 2
+} CLLC_EMU_Action;
+
+typedef struct
+{
+    uint32_t step;          // ISR2 period in which the write was observed
+    uint32_t address;       // word address of the register
+    uint32_t value;         // value written
+    uint32_t previous;      // value before the write
+    uint16_t isr;           // CLLC_EMU_ISRx that issued the write
+    uint16_t watch;         // index returned by CLLC_EMU_watchRegister
+    const char *name;       // register name, e.g. "EPWM1.TBPRDHR"
+} CLLC_EMU_Event;
+
+typedef void (*CLLC_EMU_EventHandler)(const CLLC_EMU_Event *event,
+                                      void *context);
+
+//
+// called at the start of every ISR2 period, before any ISR runs, this is
+// where a plant model refreshes the ADC result registers
+//
+typedef void (*CLLC_EMU_SampleHook)(void *context);
+
+//
+// called at the end of every ISR2 period, after the last ISR of the period
+//
+typedef void (*CLLC_EMU_StepEndHook)(void *context);
+
+typedef struct
+{
+    uint32_t step;
+    uint32_t isr1Count;
+    uint32_t isr2Count;
+    uint32_t isr3Count;
+    uint32_t eventCount;
+    uint32_t unknownVectorCount;
+    uint32_t dmaBurstCount;
+    uint32_t dmaFaultCount;     // bursts to or from an address not modelled
+} CLLC_EMU_Stats;
+
+//
+// PWM updates, see CLLC_PWM_UPDATE_MODE. An update is requested by the ISR2
+// that arms ISR1 or, with no ISR1, commits the global load itself, it is
+// loaded at the zero of PRIM LEG1 that makes the new set active. The latency
+// runs from the ISR2 trigger to that zero, ISR execution time is taken as 0
+// as the emulator freezes TBCTR at the ISR2 trigger.
+//
+typedef struct
+{
+    uint32_t requestCount;
+    uint32_t loadCount;
+    uint32_t isr1Count;         // ISR1 entries, C28x or CLA
+    uint32_t vectorWriteCount;  // PIE vector of ISR1 changed by an ISR
+    double latencySum_s;
+    double latencyMin_s;
+    double latencyMax_s;
+} CLLC_EMU_PwmUpdateStats;
+
+#ifdef CLLC_EMU_COUNT_ACCESSES
+//
+// register accesses of the runs of one ISR, see cllc_emu_target.h
+//
+typedef struct
+{
+    uint32_t runs;
+    uint32_t max;
+    uint64_t total;
+} CLLC_EMU_AccessStats;
+#endif
+
+//
+// globals
+//
+extern CLLC_EMU_Stats CLLC_EMU_stats;
+extern CLLC_EMU_PwmUpdateStats CLLC_EMU_pwmUpdate;
+#ifdef CLLC_EMU_COUNT_ACCESSES
+extern CLLC_EMU_AccessStats CLLC_EMU_accesses[CLLC_EMU_ISR_TRIP + 1];
+#endif
+
+//
+// the function prototypes
+//
+void CLLC_EMU_reset(void);
+int16_t CLLC_EMU_watchRegister(uint32_t address, CLLC_EMU_RegWidth width,
+                               CLLC_EMU_Action action, uint32_t target,
+                               const char *name);
+void CLLC_EMU_watchControlRegisters(void);
+void CLLC_EMU_setEventHandler(CLLC_EMU_EventHandler handler, void *context);
+void CLLC_EMU_setSampleHook(CLLC_EMU_SampleHook hook, void *context);
+void CLLC_EMU_getSampleHook(CLLC_EMU_SampleHook *hook, void **context);
+void CLLC_EMU_setStepEndHook(CLLC_EMU_StepEndHook hook, void *context);
+void CLLC_EMU_scanWrites(uint16_t isr);
+const char *CLLC_EMU_getRegisterName(uint32_t address);
+uint16_t CLLC_EMU_getWatchCount(void);
+const char *CLLC_EMU_getWatch(uint16_t index, uint32_t *address,
+                              CLLC_EMU_RegWidth *width,
+                              CLLC_EMU_Action *action);
+
+void CLLC_EMU_registerHandler(void (*handler)(void));
+void CLLC_EMU_mapMemory(volatile void *memory, uint32_t words);
+void CLLC_EMU_dispatch(uint32_t interruptNumber, uint16_t isr);
+uint16_t CLLC_EMU_isISR1Pending(void);
+double CLLC_EMU_getPWMPeriod_s(void);
+void CLLC_EMU_step(void);
+void CLLC_EMU_run(uint32_t steps);
+
+void CLLC_EMU_initFirmware(void);
+void CLLC_EMU_clearTrip(void);
+void CLLC_EMU_raiseTrip(uint16_t inputFlag);
+void CLLC_EMU_startPrecharge(void);
+void CLLC_EMU_startFirmware(void);
+uint32_t CLLC_EMU_closeLoop(void);
+
+//
+// Inline functions
+//
+static inline void CLLC_EMU_setADCResult(uint32_t resultBase, uint16_t soc,
+                                         uint16_t code)
+{
+    CLLC_EMU_regFile[resultBase + ADC_O_RESULT0 + soc] = code;
+}
+
+static inline void CLLC_EMU_setADCResultRange(uint32_t resultBase,
+                                              uint16_t firstSoc,
+                                              uint16_t lastSoc,
+                                              uint16_t code)
+{
+    uint16_t soc;
+
+    for(soc = firstSoc; soc <= lastSoc; soc++)
+    {
+        CLLC_EMU_regFile[resultBase + ADC_O_RESULT0 + soc] = code;
+    }
+}
+
+static inline float32_t CLLC_EMU_getTime_s(void)
+{
+    return((float32_t)CLLC_EMU_stats.step *
+           (1.0f / (float32_t)CLLC_ISR2_FREQUENCY_HZ));
+}
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
@@ -0,0 +1,16 @@
+//#############################################################################
+//
+// FILE:   cllc_emu_cla.c
+//
+// TITLE:  Host build of cllc_clatasks.cla
+//         Pulls in the CLA tasks unchanged for a build with the control on
+//         the CLA, the emulator calls the background task in place of the
+//         ISR2 the ECAP would trigger and task 1 in place of ISR1. The CLA
+//         interrupt attributes have no meaning on the host.
+//
+//#############################################################################
+
+#include "cllc.h"
+
+#define __attribute__(x)
+#include "cllc_clatasks.cla"
@@ -0,0 +1,13 @@
+//#############################################################################
+//
+// FILE:   cllc_emu_firmware.c
+//
+// TITLE:  Host build of cllc_main.c
+//         Pulls in the firmware ISR entry points (CLLC_ISR1, CLLC_ISR2_xxx,
+//         CLLC_ISR3) unchanged so the emulator dispatches the same code the
+//         PIE would. The firmware main() is renamed as it never returns.
+//
+//#############################################################################
+
+#define main CLLC_EMU_firmwareMain
+#include "cllc_main.c"
@@ -0,0 +1,365 @@
+//#############################################################################
+//
+// FILE:   cllc_emu_main.c
+//
+// TITLE:  Host runner for the register-level emulator
+//         Brings the firmware up against the emulated register file and
+//         runs the ISR cadence for a number of ISR2 periods, either dumping
+//         the register write events or reporting the ISR throughput. With
+//         a plant model attached the sensed signals are closed around the
+//         firmware and can be traced.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -include host/cllc_emu_target.h -I. -Icllc -Ihost -Idevice
+//             -Idevice/driverlib -Ilibraries
+//             host/cllc_emu.c host/cllc_emu_firmware.c host/cllc_emu_main.c
+//             host/cllc_plant_sw.c host/cllc_plant_fha.c cllc/cllc.c
+//             cllc/cllc_hal.c $(DRIVERLIB) -lm -o cllc_emu
+//         with DRIVERLIB the driverlib sources listed in host/README.md
+//
+//         Usage:
+//         cllc_emu [-n steps] [-e] [-b] [-u] [-p sw|fha] [-v volts]
+//                  [-r ohms] [-l step:ohms] [-c step] [-t divider] [-s]
+//                  [-k substeps] [-m divider]
+//           -n  number of ISR2 periods to run (default 1 s of ISR2)
+//           -e  print every register write event
+//           -b  benchmark, report ISR invocations and ISR2 periods per
+//               second, fails when the switching model runs less than
+//               CLLC_EMU_SW_MIN_REAL_TIME times faster than real time
+//           -u  report the PWM updates, the ISR1 entries and the PIE
+//               vector writes they took and their latency, see
+//               CLLC_PWM_UPDATE_MODE, and the counters of cllc_stats.h
+//           -p  attach a plant model, sw = switching-cycle model,
+//               fha = averaged (first harmonic) model
+//           -v  source voltage of the plant
+//           -r  load resistance of the plant
+//           -l  change the load resistance at the given ISR2 period
+//           -c  close the loop of a closed loop lab at the given ISR2
+//               period
+//           -t  print the plant signals every divider ISR2 periods
+//           -k  substeps per switching period of the switching model
+//           -m  run the switching model in substeps once every divider
+//               ISR2 periods and the calls in between on the map of its
+//               last switching period while that holds, 1 runs every call
+//               in substeps (default 256)
+//           -s  start the precharge ramp after the first ISR2, as done
+//               from the watch window with CLLC_PrechargeState, or with
+//               CLLC_startPrecharge when ISR2 runs on the CLA
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cllc.h"
+#include "cllc_emu.h"
+#include "cllc_plant_sw.h"
+#include "cllc_plant_fha.h"
+
+//
+// the switching model has to run at least this many times faster than real
+// time, below it -b reports FAIL
+//
+#define CLLC_EMU_SW_MIN_REAL_TIME   100.0
+
+static const char *CLLC_EMU_isrName[] = {"-", "ISR1", "ISR2", "ISR3",
+                                         "TRIP"};
+
+static void CLLC_EMU_printEvent(const CLLC_EMU_Event *event, void *context)
+{
+    (void)context;
+    printf("%10lu %-4s %-16s 0x%05lX 0x%08lX -> 0x%08lX\n",
+           (unsigned long)event->step, CLLC_EMU_isrName[event->isr],
+           event->name, (unsigned long)event->address,
+           (unsigned long)event->previous, (unsigned long)event->value);
+}
+
+static CLLC_PLANT_SW_Plant CLLC_EMU_plantSw;
+static CLLC_PLANT_FHA_Plant CLLC_EMU_plantFha;
+
+static double CLLC_EMU_now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9));
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t steps = (uint32_t)CLLC_ISR2_FREQUENCY_HZ;
+    uint16_t printEvents = 0;
+    uint16_t benchmark = 0;
+    uint16_t updateReport = 0;
+    uint32_t closeStep = 0xFFFFFFFFU;
+    const char *plantName = NULL;
+    CLLC_PLANT_SW_Params swParams;
+    CLLC_PLANT_FHA_Params fhaParams;
+    CLLC_PLANT_Sense *sense = NULL;
+    uint32_t loadStep = 0xFFFFFFFFU;
+    double loadStep_Ohms = 0.0;
+    uint32_t traceDivider = 0;
+    uint16_t startPrecharge = 0;
+    uint32_t done;
+    double start, elapsed, realTime;
+    double minRealTime = 0.0;
+    int status = 0;
+    uint32_t isrCount;
+    int i;
+
+    CLLC_PLANT_SW_setDefaultParams(&swParams);
+    CLLC_PLANT_FHA_setDefaultParams(&fhaParams);
+
+    for(i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "-n") == 0) && ((i + 1) < argc))
+        {
+            steps = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "-e") == 0)
+        {
+            printEvents = 1;
+        }
+        else if(strcmp(argv[i], "-b") == 0)
+        {
+            benchmark = 1;
+        }
+        else if(strcmp(argv[i], "-u") == 0)
+        {
+            updateReport = 1;
+        }
+        else if((strcmp(argv[i], "-c") == 0) && ((i + 1) < argc))
+        {
+            closeStep = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-p") == 0) && ((i + 1) < argc))
+        {
+            plantName = argv[++i];
+        }
+        else if((strcmp(argv[i], "-v") == 0) && ((i + 1) < argc))
+        {
+            double volts = strtod(argv[++i], NULL);
+
+            swParams.vPrimSource_Volts = volts;
+            swParams.vSecSource_Volts = volts;
+            fhaParams.vPrimSource_Volts = volts;
+            fhaParams.vSecSource_Volts = volts;
+        }
+        else if((strcmp(argv[i], "-r") == 0) && ((i + 1) < argc))
+        {
+            swParams.rLoad_Ohms = strtod(argv[++i], NULL);
+            fhaParams.rLoad_Ohms = swParams.rLoad_Ohms;
+        }
+        else if((strcmp(argv[i], "-l") == 0) && ((i + 1) < argc) &&
+                (sscanf(argv[i + 1], "%u:%lf", &loadStep,
+                        &loadStep_Ohms) == 2))
+        {
+            i++;
+        }
+        else if((strcmp(argv[i], "-k") == 0) && ((i + 1) < argc))
+        {
+            swParams.substepsPerPeriod = (uint16_t)strtoul(argv[++i], NULL,
+                                                           0);
+        }
+        else if((strcmp(argv[i], "-m") == 0) && ((i + 1) < argc))
+        {
+            swParams.detailDivider = (uint16_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "-s") == 0)
+        {
+            startPrecharge = 1;
+        }
+        else if((strcmp(argv[i], "-t") == 0) && ((i + 1) < argc))
+        {
+            traceDivider = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n steps] [-e] [-b] [-u] "
+                    "[-p sw|fha] [-v volts] [-r ohms] [-l step:ohms] "
+                    "[-c step] [-t divider] [-s] [-k substeps] "
+                    "[-m divider]\n",
+                    argv[0]);
+            return(1);
+        }
+    }
+
+    CLLC_EMU_initFirmware();
+
+    if(plantName != NULL)
+    {
+        if(strcmp(plantName, "sw") == 0)
+        {
+            CLLC_PLANT_SW_init(&CLLC_EMU_plantSw, &swParams);
+            CLLC_EMU_setSampleHook(&CLLC_PLANT_SW_sampleHook,
+                                   &CLLC_EMU_plantSw);
+            sense = &CLLC_EMU_plantSw.sense;
+            minRealTime = CLLC_EMU_SW_MIN_REAL_TIME;
+        }
+        else if(strcmp(plantName, "fha") == 0)
+        {
+            CLLC_PLANT_FHA_init(&CLLC_EMU_plantFha, &fhaParams);
+            CLLC_EMU_setSampleHook(&CLLC_PLANT_FHA_sampleHook,
+                                   &CLLC_EMU_plantFha);
+            sense = &CLLC_EMU_plantFha.sense;
+        }
+        else
+        {
+            fprintf(stderr, "unknown plant %s\n", plantName);
+            return(1);
+        }
+    }
+
+    if(printEvents)
+    {
+        CLLC_EMU_setEventHandler(&CLLC_EMU_printEvent, NULL);
+    }
+
+    //
+    // release the firmware the same way as from the watch window
+    //
+    CLLC_EMU_clearTrip();
+
+    start = CLLC_EMU_now_s();
+
+    if(startPrecharge && (steps != 0U))
+    {
+        //
+        // the first ISR2 loads the full phase shift, then let the ramp run
+        //
+        CLLC_EMU_step();
+        CLLC_EMU_startPrecharge();
+        steps--;
+    }
+
+    if(((sense == NULL) || ((traceDivider == 0U) && (loadStep >= steps))) &&
+       (closeStep >= steps))
+    {
+        CLLC_EMU_run(steps);
+    }
+    else
+    {
+        for(done = 0; done < steps; done++)
+        {
+            if(done == closeStep)
+            {
+                CLLC_EMU_closeLoop();
+            }
+
+            if((done == loadStep) && (sense != NULL))
+            {
+                if(sense == &CLLC_EMU_plantSw.sense)
+                {
+                    CLLC_PLANT_SW_setLoad(&CLLC_EMU_plantSw, loadStep_Ohms);
+                }
+                else
+                {
+                    CLLC_PLANT_FHA_setLoad(&CLLC_EMU_plantFha,
+                                           loadStep_Ohms);
+                }
+            }
+
+            CLLC_EMU_step();
+
+            if((sense != NULL) && (traceDivider != 0U) &&
+               ((done % traceDivider) == 0U))
+            {
+                printf("%.6f %.2f %.2f %.3f %.3f %.1f\n",
+                       (double)CLLC_EMU_getTime_s(),
+                       (double)sense->vPrim_Volts,
+                       (double)sense->vSec_Volts,
+                       (double)sense->iPrim_Amps,
+                       (double)sense->iSec_Amps,
+                       (double)CLLC_pwmFrequency_Hz * 1e-3);
+            }
+        }
+    }
+
+    elapsed = CLLC_EMU_now_s() - start;
+
+    isrCount = CLLC_EMU_stats.isr1Count + CLLC_EMU_stats.isr2Count +
+               CLLC_EMU_stats.isr3Count;
+
+    fprintf(stderr, "lab %d: %lu ISR2 periods (%.3f s simulated), "
+            "ISR1 %lu, ISR2 %lu, ISR3 %lu, events %lu\n",
+            CLLC_LAB, (unsigned long)CLLC_EMU_stats.step,
+            (double)CLLC_EMU_getTime_s(),
+            (unsigned long)CLLC_EMU_stats.isr1Count,
+            (unsigned long)CLLC_EMU_stats.isr2Count,
+            (unsigned long)CLLC_EMU_stats.isr3Count,
+            (unsigned long)CLLC_EMU_stats.eventCount);
+
+#if CLLC_ISR2_RUNNING_ON == CLA_CORE
+    fprintf(stderr, "CLA ISR2 %lu, setpoint sets %lu taken\n",
+            (unsigned long)CLLC_claISR2Count,
+            (unsigned long)CLLC_claSetpoint.count);
+#endif
+
+    if(CLLC_EMU_stats.unknownVectorCount != 0U)
+    {
+        fprintf(stderr, "warning: %lu interrupts with no registered handler\n",
+                (unsigned long)CLLC_EMU_stats.unknownVectorCount);
+    }
+
+    if(benchmark)
+    {
+        realTime = (double)CLLC_EMU_getTime_s() / elapsed;
+        fprintf(stderr, "%.3f s host time, %.2f M ISR/s, %.2f M ISR2 "
+                "periods/s, %.1fx real time\n",
+                elapsed, ((double)isrCount / elapsed) * 1e-6,
+                ((double)CLLC_EMU_stats.step / elapsed) * 1e-6, realTime);
+
+        if(realTime < minRealTime)
+        {
+            fprintf(stderr, "FAIL: %.1fx real time, the switching model "
+                    "needs %.0fx\n", realTime, minRealTime);
+            status = 1;
+        }
+    }
+
+    if(updateReport)
+    {
+        const CLLC_EMU_PwmUpdateStats *u = &CLLC_EMU_pwmUpdate;
+        double updates = (u->loadCount != 0U) ? (double)u->loadCount : 1.0;
+        CLLC_STATS_Counters stats;
+
+        fprintf(stderr, "PWM update mode %d: %lu requested, %lu loaded, "
+                "%lu deferred by ISR2\n",
+                CLLC_PWM_UPDATE_MODE, (unsigned long)u->requestCount,
+                (unsigned long)u->loadCount,
+                (unsigned long)CLLC_pwmUpdateDeferCount);
+        fprintf(stderr, "  ISR1 %lu (%.2f per update), PIE vector writes %lu\n",
+                (unsigned long)u->isr1Count, (double)u->isr1Count / updates,
+                (unsigned long)u->vectorWriteCount);
+        fprintf(stderr, "  latency ISR2 trigger to load %.2f us mean, "
+                "%.2f min, %.2f max\n",
+                (u->latencySum_s / updates) * 1e6, u->latencyMin_s * 1e6,
+                u->latencyMax_s * 1e6);
+
+        (void)CLLC_STATS_snapshot(&CLLC_stats, &stats);
+        fprintf(stderr, "  stats: ISR1 %lu, %lu re-triggered, ISR2 %lu, "
+                "%lu overruns, ISR3 %lu, %lu overruns\n",
+                (unsigned long)stats.isr1Count,
+                (unsigned long)stats.isr1Retriggers,
+                (unsigned long)stats.isr2Count,
+                (unsigned long)stats.isr2Overruns,
+                (unsigned long)stats.isr3Count,
+                (unsigned long)stats.isr3Overruns);
+        fprintf(stderr, "  trips %lu/%lu/%lu (prim/sec/tank), slew limited "
+                "ref %lu, period %lu, clamps GV %lu/%lu, GI %lu/%lu "
+                "(max/min)\n",
+                (unsigned long)stats.tripPrimOverCurrent,
+                (unsigned long)stats.tripSecOverCurrent,
+                (unsigned long)stats.tripPrimTankOverCurrent,
+                (unsigned long)stats.refSlewLimits,
+                (unsigned long)stats.periodSlewLimits,
+                (unsigned long)stats.gvOutMaxClamps,
+                (unsigned long)stats.gvOutMinClamps,
+                (unsigned long)stats.giOutMaxClamps,
+                (unsigned long)stats.giOutMinClamps);
+    }
+
+    return(status);
+}
@@ -0,0 +1,401 @@
+//#############################################################################
+//
+// FILE:   cllc_emu_sfra.c
+//
+// TITLE:  Host implementation of the SFRA_F32 library API
+//         The SFRA library only ships as a C28x object library, this file
+//         implements the API of sfra_f32.h for the host build so the
+//         firmware runs its own CLLC_SFRA_INJECT and CLLC_SFRA_COLLECT calls
+//         unchanged.
+//
+//         SFRA_F32_inject adds amplitude sin(2 pi f n / isrFreq) to the
+//         reference at the frequency of freqVect[freqIndex].
+//         SFRA_F32_collect ignores the ISRs without an injection, lets
+//         CLLC_EMU_SFRA_SETTLE_CYCLES go by and then fits an offset plus a
+//         sine and a cosine at the injection frequency to the control output
+//         and to the feedback over CLLC_EMU_SFRA_MEASURE_CYCLES, at least
+//         CLLC_EMU_SFRA_MIN_SAMPLES. The offset term keeps the operating
+//         point out of the response when the window is not a whole number
+//         of ISR periods.
+//
+//         SFRA_F32_runBackgroundTask stores the point and moves on to the
+//         next one, with the reference r constant and the injection d
+//         e = d - fb, u = G e, fb = H u, so
+//         H  = FB / U
+//         GH = FB / (D - FB)
+//         CL = FB / D
+//         stored as magnitude in dB and phase in degrees.
+//
+//         The SFRA GUI comms are not used on the host, SFRA_GUI_config and
+//         SFRA_GUI_runSerialHostComms do nothing.
+//
+//#############################################################################
+
+#include <math.h>
+#include <string.h>
+#include "cllc.h"
+
+#if CLLC_SFRA_TYPE != CLLC_SFRA_DISABLED
+
+#define CLLC_EMU_SFRA_SETTLE_CYCLES     3U
+#define CLLC_EMU_SFRA_MEASURE_CYCLES    5U
+#define CLLC_EMU_SFRA_MIN_SAMPLES       3000U
+
+//
+// sums of the least squares fit x = a + b sin + c cos
+//
+typedef struct
+{
+    float64_t x;
+    float64_t xSin;
+    float64_t xCos;
+} CLLC_EMU_SFRA_Sums;
+
+typedef struct
+{
+    SFRA_F32 *sfra;             // object of the last SFRA_F32_config
+    float64_t angle;
+    float64_t angleStep;
+    float64_t sinValue;         // of the injection of the present ISR
+    float64_t cosValue;
+    uint16_t injected;
+    uint16_t pointDone;
+    uint32_t sample;
+    uint32_t settleSamples;
+    uint32_t measureSamples;
+
+    //
+    // basis sums, then the sums of the control output and the feedback
+    //
+    float64_t sin;
+    float64_t cos;
+    float64_t sinSin;
+    float64_t sinCos;
+    float64_t cosCos;
+    CLLC_EMU_SFRA_Sums controlOutput;
+    CLLC_EMU_SFRA_Sums feedback;
+} CLLC_EMU_SFRA;
+
+static CLLC_EMU_SFRA CLLC_EMU_sfra;
+
+static void CLLC_EMU_SFRA_startPoint(SFRA_F32 *sfra)
+{
+    CLLC_EMU_SFRA *emu = &CLLC_EMU_sfra;
+    float64_t frequency = (float64_t)sfra->freqVect[sfra->freqIndex];
+    float64_t samplesPerCycle = (float64_t)sfra->isrFreq / frequency;
+
+    memset(emu, 0, sizeof(*emu));
+    emu->sfra = sfra;
+    emu->angleStep = (2.0 * M_PI) / samplesPerCycle;
+    emu->settleSamples = (uint32_t)ceil(samplesPerCycle *
+                                        CLLC_EMU_SFRA_SETTLE_CYCLES);
+    emu->measureSamples = (uint32_t)ceil(samplesPerCycle *
+                                         CLLC_EMU_SFRA_MEASURE_CYCLES);
+
+    if(emu->measureSamples < CLLC_EMU_SFRA_MIN_SAMPLES)
+    {
+        //
+        // whole cycles, so the sine and cosine stay orthogonal
+        //
+        emu->measureSamples = (uint32_t)ceil(
+                ceil(CLLC_EMU_SFRA_MIN_SAMPLES / samplesPerCycle) *
+                samplesPerCycle);
+    }
+}
+
+static void CLLC_EMU_SFRA_accumulate(CLLC_EMU_SFRA_Sums *sums, float64_t x,
+                                     float64_t s, float64_t c)
+{
+    sums->x += x;
+    sums->xSin += x * s;
+    sums->xCos += x * c;
+}
+
+//
+// Solve the 3x3 normal equations of the fit for b + jc, the phasor of the
+// signal against the injected sine
+//
+static void CLLC_EMU_SFRA_getPhasor(const CLLC_EMU_SFRA *emu,
+                                    const CLLC_EMU_SFRA_Sums *sums,
+                                    float64_t *re, float64_t *im)
+{
+    float64_t n = (float64_t)emu->measureSamples;
+    float64_t m[3][3], y[3], det, mi[3][3];
+    uint16_t j;
+
+    m[0][0] = n;
+    m[0][1] = emu->sin;
+    m[0][2] = emu->cos;
+    m[1][0] = emu->sin;
+    m[1][1] = emu->sinSin;
+    m[1][2] = emu->sinCos;
+    m[2][0] = emu->cos;
+    m[2][1] = emu->sinCos;
+    m[2][2] = emu->cosCos;
+    y[0] = sums->x;
+    y[1] = sums->xSin;
+    y[2] = sums->xCos;
+
+    det = (m[0][0] * ((m[1][1] * m[2][2]) - (m[1][2] * m[2][1]))) -
+          (m[0][1] * ((m[1][0] * m[2][2]) - (m[1][2] * m[2][0]))) +
+          (m[0][2] * ((m[1][0] * m[2][1]) - (m[1][1] * m[2][0])));
+
+    //
+    // adjugate, only rows 1 and 2 of the inverse are needed
+    //
+    mi[1][0] = (m[1][2] * m[2][0]) - (m[1][0] * m[2][2]);
+    mi[1][1] = (m[0][0] * m[2][2]) - (m[0][2] * m[2][0]);
+    mi[1][2] = (m[0][2] * m[1][0]) - (m[0][0] * m[1][2]);
+    mi[2][0] = (m[1][0] * m[2][1]) - (m[1][1] * m[2][0]);
+    mi[2][1] = (m[0][1] * m[2][0]) - (m[0][0] * m[2][1]);
+    mi[2][2] = (m[0][0] * m[1][1]) - (m[0][1] * m[1][0]);
+
+    *re = 0.0;
+    *im = 0.0;
+    for(j = 0; j < 3U; j++)
+    {
+        *re += mi[1][j] * y[j];
+        *im += mi[2][j] * y[j];
+    }
+    *re /= det;
+    *im /= det;
+}
+
+static void CLLC_EMU_SFRA_store(float32_t *magVect, float32_t *phaseVect,
+                                int16_t index, float64_t numRe,
+                                float64_t numIm, float64_t denRe,
+                                float64_t denIm)
+{
+    float64_t den = (denRe * denRe) + (denIm * denIm);
+    float64_t re, im;
+
+    if((magVect == NULL) || (phaseVect == NULL) || (den == 0.0))
+    {
+        return;
+    }
+
+    re = ((numRe * denRe) + (numIm * denIm)) / den;
+    im = ((numIm * denRe) - (numRe * denIm)) / den;
+
+    magVect[index] = (float32_t)(10.0 * log10((re * re) + (im * im)));
+    phaseVect[index] = (float32_t)(atan2(im, re) * (180.0 / M_PI));
+}
+
+void SFRA_F32_reset(SFRA_F32 *SFRA_F_obj)
+{
+    SFRA_F_obj->start = 0;
+    SFRA_F_obj->state = 0;
+    SFRA_F_obj->status = 0;
+    SFRA_F_obj->freqIndex = 0;
+}
+
+void SFRA_F32_config(SFRA_F32 *SFRA_F_obj,
+                     float32_t isrFrequency,
+                     float32_t injectionAmplitude,
+                     int16_t noFreqPoints,
+                     float32_t fraSweepStartFreq,
+                     float32_t freqStep,
+                     float32_t *h_magVect,
+                     float32_t *h_phaseVect,
+                     float32_t *gh_magVect,
+                     float32_t *gh_phaseVect,
+                     float32_t *cl_magVect,
+                     float32_t *cl_phaseVect,
+                     float32_t *freqVect,
+                     int16_t speed)
+{
+    SFRA_F_obj->isrFreq = isrFrequency;
+    SFRA_F_obj->amplitude = injectionAmplitude;
+    SFRA_F_obj->vecLength = noFreqPoints;
+    SFRA_F_obj->freqStart = fraSweepStartFreq;
+    SFRA_F_obj->freqStep = freqStep;
+    SFRA_F_obj->h_magVect = h_magVect;
+    SFRA_F_obj->h_phaseVect = h_phaseVect;
+    SFRA_F_obj->gh_magVect = gh_magVect;
+    SFRA_F_obj->gh_phaseVect = gh_phaseVect;
+    SFRA_F_obj->cl_magVect = cl_magVect;
+    SFRA_F_obj->cl_phaseVect = cl_phaseVect;
+    SFRA_F_obj->freqVect = freqVect;
+    SFRA_F_obj->storeH = (h_magVect != NULL);
+    SFRA_F_obj->storeGH = (gh_magVect != NULL);
+    SFRA_F_obj->storeCL = (cl_magVect != NULL);
+
+    //
+    // the number of cycles per point is fixed on the host
+    //
+    SFRA_F_obj->speed = speed;
+
+    memset(&CLLC_EMU_sfra, 0, sizeof(CLLC_EMU_sfra));
+    CLLC_EMU_sfra.sfra = SFRA_F_obj;
+}
+
+void SFRA_F32_initFreqArrayWithLogSteps(SFRA_F32 *SFRA_F_obj,
+                                        float32_t fra_sweep_start_freq,
+                                        float32_t freqStep)
+{
+    float32_t frequency = fra_sweep_start_freq;
+    int16_t i;
+
+    for(i = 0; i < SFRA_F_obj->vecLength; i++)
+    {
+        SFRA_F_obj->freqVect[i] = frequency;
+        frequency = frequency * freqStep;
+    }
+}
+
+void SFRA_F32_resetFreqRespArray(SFRA_F32 *SFRA_F_obj)
+{
+    int16_t i;
+
+    for(i = 0; i < SFRA_F_obj->vecLength; i++)
+    {
+        if(SFRA_F_obj->storeH)
+        {
+            SFRA_F_obj->h_magVect[i] = 0;
+            SFRA_F_obj->h_phaseVect[i] = 0;
+        }
+        if(SFRA_F_obj->storeGH)
+        {
+            SFRA_F_obj->gh_magVect[i] = 0;
+            SFRA_F_obj->gh_phaseVect[i] = 0;
+        }
+        if(SFRA_F_obj->storeCL)
+        {
+            SFRA_F_obj->cl_magVect[i] = 0;
+            SFRA_F_obj->cl_phaseVect[i] = 0;
+        }
+    }
+}
+
+void SFRA_F32_updateInjectionAmplitude(SFRA_F32 *SFRA_F_obj,
+                                       float32_t new_injection_amplitude)
+{
+    SFRA_F_obj->amplitude = new_injection_amplitude;
+}
+
+float SFRA_F32_inject(float ref)
+{
+    CLLC_EMU_SFRA *emu = &CLLC_EMU_sfra;
+
+    if((emu->sfra == NULL) || (emu->sfra->state == 0) || emu->pointDone)
+    {
+        return(ref);
+    }
+
+    emu->sinValue = sin(emu->angle);
+    emu->cosValue = cos(emu->angle);
+    emu->injected = 1;
+
+    return(ref + (emu->sfra->amplitude * (float32_t)emu->sinValue));
+}
+
+void SFRA_F32_collect(float *control_output, float *feedback)
+{
+    CLLC_EMU_SFRA *emu = &CLLC_EMU_sfra;
+    float64_t s = emu->sinValue;
+    float64_t c = emu->cosValue;
+
+    if(emu->injected == 0U)
+    {
+        return;
+    }
+    emu->injected = 0;
+
+    emu->angle += emu->angleStep;
+    if(emu->angle >= (2.0 * M_PI))
+    {
+        emu->angle -= 2.0 * M_PI;
+    }
+
+    emu->sample++;
+    if(emu->sample <= emu->settleSamples)
+    {
+        return;
+    }
+
+    emu->sin += s;
+    emu->cos += c;
+    emu->sinSin += s * s;
+    emu->sinCos += s * c;
+    emu->cosCos += c * c;
+    CLLC_EMU_SFRA_accumulate(&emu->controlOutput, *control_output, s, c);
+    CLLC_EMU_SFRA_accumulate(&emu->feedback, *feedback, s, c);
+
+    if(emu->sample == (emu->settleSamples + emu->measureSamples))
+    {
+        emu->pointDone = 1;
+    }
+}
+
+void SFRA_F32_runBackgroundTask(SFRA_F32 *SFRA_F_obj)
+{
+    CLLC_EMU_SFRA *emu = &CLLC_EMU_sfra;
+    float64_t uRe, uIm, fbRe, fbIm, d;
+    int16_t i;
+
+    if(SFRA_F_obj->start == 1)
+    {
+        SFRA_F_obj->start = 0;
+        SFRA_F_obj->freqIndex = 0;
+
+        if(SFRA_F_obj->vecLength > 0)
+        {
+            SFRA_F_obj->state = 1;
+            SFRA_F_obj->status = 1;
+            CLLC_EMU_SFRA_startPoint(SFRA_F_obj);
+        }
+        return;
+    }
+
+    if((SFRA_F_obj->state == 0) || (emu->sfra != SFRA_F_obj) ||
+       (emu->pointDone == 0U))
+    {
+        return;
+    }
+
+    CLLC_EMU_SFRA_getPhasor(emu, &emu->controlOutput, &uRe, &uIm);
+    CLLC_EMU_SFRA_getPhasor(emu, &emu->feedback, &fbRe, &fbIm);
+    d = (float64_t)SFRA_F_obj->amplitude;
+    i = SFRA_F_obj->freqIndex;
+
+    CLLC_EMU_SFRA_store(SFRA_F_obj->h_magVect, SFRA_F_obj->h_phaseVect, i,
+                        fbRe, fbIm, uRe, uIm);
+    CLLC_EMU_SFRA_store(SFRA_F_obj->gh_magVect, SFRA_F_obj->gh_phaseVect, i,
+                        fbRe, fbIm, d - fbRe, -fbIm);
+    CLLC_EMU_SFRA_store(SFRA_F_obj->cl_magVect, SFRA_F_obj->cl_phaseVect, i,
+                        fbRe, fbIm, d, 0.0);
+
+    SFRA_F_obj->freqIndex++;
+
+    if(SFRA_F_obj->freqIndex >= SFRA_F_obj->vecLength)
+    {
+        SFRA_F_obj->state = 0;
+        SFRA_F_obj->status = 0;
+        emu->pointDone = 0;
+    }
+    else
+    {
+        CLLC_EMU_SFRA_startPoint(SFRA_F_obj);
+    }
+}
+
+void SFRA_GUI_config(volatile uint32_t sci_base,
+                     uint32_t vbus_clk,
+                     uint32_t baudrate,
+                     uint16_t scirx_gpio_pin,
+                     uint32_t scirx_gpio_pin_config,
+                     uint16_t scitx_gpio_pin,
+                     uint32_t scitx_gpio_pin_config,
+                     uint16_t led_indicator_flag,
+                     uint16_t led_gpio_pin,
+                     uint32_t led_gpio_pin_config,
+                     SFRA_F32 *sfra,
+                     uint16_t plot_option)
+{
+}
+
+void SFRA_GUI_runSerialHostComms(SFRA_F32 *sfra)
+{
+}
+
+#endif
@@ -0,0 +1,116 @@
+//#############################################################################
+//
+// FILE:   cllc_emu_target.h
+//
+// TITLE:  Target shim for the host build of the CLLC firmware
+//         This file is force-included (gcc -include) ahead of every
+//         firmware and driverlib translation unit when building on the host.
+//         It takes the place of inc/hw_types.h and of the C28x intrinsics
+//         in cpu.h so that HWREG/HWREGH resolve into the emulated register
+//         file in cllc_emu.c instead of fixed peripheral addresses.
+//
+//#############################################################################
+
+#ifndef CLLC_EMU_TARGET_H
+#define CLLC_EMU_TARGET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+//
+// the driverlib sources only expose their C28x API under this define
+//
+#ifndef __TMS320C28XX__
+#define __TMS320C28XX__
+#endif
+
+//
+// hw_types.h replacement, the guard keeps the target version out
+//
+#define HW_TYPES_H
+
+//
+// The C28x address space is 16-bit word addressed, the register file keeps
+// the same layout so that every base + offset in hw_*.h maps 1:1 onto an
+// index. 32-bit accesses cover two consecutive words, low word first, which
+// matches the little-endian host.
+//
+#define CLLC_EMU_REGFILE_SIZE_WORDS ((uint32_t)0x80000)
+
+extern uint16_t CLLC_EMU_regFile[CLLC_EMU_REGFILE_SIZE_WORDS];
+
+//
+// Built with -DCLLC_EMU_COUNT_ACCESSES every HWREG/HWREGH expression counts
+// one register access, a read-modify-write counts once. CLLC_EMU_dispatch
+// keeps the figures per ISR in CLLC_EMU_accesses.
+//
+#ifdef CLLC_EMU_COUNT_ACCESSES
+extern uint32_t CLLC_EMU_accessCount;
+
+//
+// a call, so the two accesses of HWREG(x) = HWREG(x) | y are sequenced
+//
+static inline volatile uint16_t *CLLC_EMU_countAccess(uint32_t address)
+{
+    CLLC_EMU_accessCount++;
+    return(&CLLC_EMU_regFile[address]);
+}
+
+#define HWREG(x)                                                              \
+        (*((volatile uint32_t *)CLLC_EMU_countAccess((uint32_t)(x))))
+#define HWREGH(x)                                                             \
+        (*((volatile uint16_t *)CLLC_EMU_countAccess((uint32_t)(x))))
+#else
+#define HWREG(x)                                                              \
+        (*((volatile uint32_t *)&CLLC_EMU_regFile[(uint32_t)(x)]))
+#define HWREGH(x)                                                             \
+        (*((volatile uint16_t *)&CLLC_EMU_regFile[(uint32_t)(x)]))
+#endif
+#define HWREG_BP(x)     HWREG(x)
+#define HWREGB(x)       HWREGH(x)
+
+#define STATUS_S_SUCCESS    (0)
+#define STATUS_E_FAILURE    (-1)
+
+#ifndef C2000_IEEE754_TYPES
+#define C2000_IEEE754_TYPES
+typedef float         float32_t;
+typedef double        float64_t;
+#endif
+
+#ifndef TRUE
+#define TRUE  1
+#endif
+#ifndef FALSE
+#define FALSE  0
+#endif
+
+//
+// C28x compiler keywords and intrinsics, interrupts are dispatched by the
+// emulator so the global interrupt mask operations are no-ops
+//
+#define __cregister
+#define interrupt
+#define __interrupt
+
+#define EINT
+#define DINT
+#define ERTM
+#define DRTM
+#define EALLOW
+#define EDIS
+#define ESTOP0
+#define ESTOP1
+#define NOP
+#define IDLE
+
+//
+// inline assembly only shows up as the cycle delays after sysctl.h writes
+//
+#define asm(x)
+
+extern uint16_t __disable_interrupts(void);
+extern uint16_t __enable_interrupts(void);
+
+#endif // CLLC_EMU_TARGET_H
@@ -0,0 +1,471 @@
+//#############################################################################
+//
+// FILE:   cllc_fsi_check.c
+//
+// TITLE:  Check of the FSI link framing against a loopback model of FSI
+//         Runs the firmware side of cllc_fsilink.h as the firmware does it,
+//         a sample frame every ISR2 run and the receiver polled for a
+//         setpoint frame at the start of every ISR3 run, against a remote
+//         controller on the other end of two cllc_fsi_loopback.h links.
+//         Every sample and setpoint taken must be the one sent under its
+//         sequence number, frames lost, flagged or overwritten must show up
+//         in the counts of the receiving side, and a setpoint must be
+//         applied within one frame time, the line delay and one ISR3 period
+//         of the remote starting to send it. Then feeds frames with wrong
+//         tags, versions, lengths and values that must be rejected.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -Wno-unknown-pragmas -Icllc -Ihost
+//             host/cllc_fsi_check.c host/cllc_fsi_loopback.c
+//             cllc/cllc_fsilink.c -lm -o cllc_fsi_check
+//
+//         Usage:
+//         cllc_fsi_check [-t seconds] [-s seed]
+//           -t  simulated time of each link run (default 1)
+//           -s  seed of the errors and the setpoint timing (default 1)
+//
+//         Exits 0 when all checks pass.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "cllc_fsilink.h"
+#include "cllc_fsi_loopback.h"
+#include "cllc_check.h"
+
+//
+// Defines
+//
+#define CLLC_FSI_CHECK_ISR2_HZ          120000.0
+#define CLLC_FSI_CHECK_ISR3_RATIO       12U         // ISR2 runs per ISR3 run
+#define CLLC_FSI_CHECK_BIT_RATE_BPS     (2.0 * 120e6 / 3.0)
+#define CLLC_FSI_CHECK_DELAY_S          100e-9
+#define CLLC_FSI_CHECK_SETPOINTS_MAX    65536U
+
+//
+// typedefs
+//
+typedef struct
+{
+    const char *name;
+    double dropRate;
+    double bitErrorRate;
+    double setpointIntervalMin_s;
+    double setpointIntervalMax_s;
+} CLLC_FSI_CHECK_Case;
+
+typedef struct
+{
+    uint64_t samplesWrong;
+    uint64_t setpointsWrong;
+    uint16_t firstSetpoint;     // frames before it are not counted as lost
+    double latencyMin_s;
+    double latencyMax_s;
+} CLLC_FSI_CHECK_Result;
+
+static const CLLC_FSI_CHECK_Case CLLC_FSI_CHECK_case[] =
+{
+    { "clean",    0.0,  0.0,  0.5e-3, 1.5e-3 },
+    { "noisy",    1e-4, 1e-6, 0.5e-3, 1.5e-3 },
+    { "flooding", 0.0,  0.0,  20e-6,  60e-6  },
+};
+
+static const CLLC_FSILINK_Setpoint CLLC_FSI_CHECK_setpointMin =
+{
+    0.0f, 0.0f, 100000.0f
+};
+static const CLLC_FSILINK_Setpoint CLLC_FSI_CHECK_setpointMax =
+{
+    60.0f, 20.0f, 800000.0f
+};
+
+static double CLLC_FSI_CHECK_setpointSent_s[CLLC_FSI_CHECK_SETPOINTS_MAX];
+
+//
+// splitmix64, as cllc_mc_main.c
+//
+static uint64_t CLLC_FSI_CHECK_nextRandom(uint64_t *state)
+{
+    uint64_t z;
+
+    *state += 0x9E3779B97F4A7C15ULL;
+    z = *state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return(z ^ (z >> 31));
+}
+
+static double CLLC_FSI_CHECK_getUniform(uint64_t *state)
+{
+    return((double)(CLLC_FSI_CHECK_nextRandom(state) >> 11) *
+           (1.0 / 9007199254740992.0));
+}
+
+//
+// The values of a sequence number, exact in float32
+//
+static void CLLC_FSI_CHECK_getSample(uint16_t sequence,
+                                     CLLC_FSILINK_Sample *sample)
+{
+    sample->vSecSensed_pu = (float32_t)sequence * (1.0f / 65536.0f);
+    sample->iSecSensed_pu = -(float32_t)sequence * (1.0f / 32768.0f);
+    sample->pwmPeriod_pu = 0.5f + ((float32_t)(sequence & 0xFFU) * 0.001f);
+    sample->pwmPhaseShiftPrimSec_ns = (float32_t)(sequence % 200U) - 100.0f;
+}
+
+static void CLLC_FSI_CHECK_getSetpoint(uint16_t sequence,
+                                       CLLC_FSILINK_Setpoint *setpoint)
+{
+    setpoint->vSecRef_Volts = 40.0f + (float32_t)(sequence % 160U) * 0.125f;
+    setpoint->iSecRef_Amps = (float32_t)(sequence % 40U) * 0.5f;
+    setpoint->pwmFrequencyRef_Hz = 400000.0f + (float32_t)sequence;
+}
+
+static void CLLC_FSI_CHECK_runCase(const CLLC_FSI_CHECK_Case *c,
+                                   double time_s, uint64_t seed)
+{
+    CLLC_FSI_LOOPBACK_Link up, down;
+    CLLC_FSILINK_Tx deviceTx, remoteTx;
+    CLLC_FSILINK_Rx deviceRx, remoteRx;
+    CLLC_FSILINK_Frame frame;
+    CLLC_FSILINK_Sample sample, expectedSample;
+    CLLC_FSILINK_Setpoint setpoint, expectedSetpoint;
+    CLLC_FSI_CHECK_Result result;
+    uint64_t state = seed * 0x51ULL;
+    uint32_t runs = (uint32_t)(time_s * CLLC_FSI_CHECK_ISR2_HZ);
+    uint32_t k;
+    uint16_t events;
+    double t, nextSetpoint_s, arrival_s, latency_s, bound_s;
+    double period_s = 1.0 / CLLC_FSI_CHECK_ISR2_HZ;
+
+    CLLC_FSI_LOOPBACK_init(&up, CLLC_FSI_CHECK_BIT_RATE_BPS,
+                           CLLC_FSI_CHECK_DELAY_S, c->dropRate,
+                           c->bitErrorRate, seed);
+    CLLC_FSI_LOOPBACK_init(&down, CLLC_FSI_CHECK_BIT_RATE_BPS,
+                           CLLC_FSI_CHECK_DELAY_S, c->dropRate,
+                           c->bitErrorRate, seed + 1U);
+    CLLC_FSILINK_initTx(&deviceTx);
+    CLLC_FSILINK_initTx(&remoteTx);
+    CLLC_FSILINK_initRx(&deviceRx, &CLLC_FSI_CHECK_setpointMin,
+                        &CLLC_FSI_CHECK_setpointMax);
+    CLLC_FSILINK_initRx(&remoteRx, &CLLC_FSI_CHECK_setpointMin,
+                        &CLLC_FSI_CHECK_setpointMax);
+    memset(&result, 0, sizeof(result));
+    result.latencyMin_s = 1.0;
+
+    nextSetpoint_s = c->setpointIntervalMin_s;
+
+    for(k = 0; k < runs; k++)
+    {
+        t = (double)k * period_s;
+
+        //
+        // the remote sends its setpoints when they are due
+        //
+        while(nextSetpoint_s <= t)
+        {
+            CLLC_FSI_CHECK_getSetpoint(remoteTx.sequence, &setpoint);
+            CLLC_FSI_CHECK_setpointSent_s[remoteTx.sequence %
+                                         CLLC_FSI_CHECK_SETPOINTS_MAX] =
+                    nextSetpoint_s;
+            CLLC_FSILINK_packSetpoint(&remoteTx, &frame, &setpoint);
+            if(CLLC_FSI_LOOPBACK_send(&down, nextSetpoint_s, &frame) == 0U)
+            {
+                //
+                // the remote waits for its transmitter, the frame keeps its
+                // number and is sent with the next one due
+                //
+                remoteTx.sequence--;
+                remoteTx.frames--;
+                nextSetpoint_s = down.lineFree_s;
+                continue;
+            }
+            nextSetpoint_s += c->setpointIntervalMin_s +
+                              ((c->setpointIntervalMax_s -
+                                c->setpointIntervalMin_s) *
+                               CLLC_FSI_CHECK_getUniform(&state));
+        }
+
+        //
+        // ISR3 takes a setpoint first thing, then ISR2 sends its sample
+        //
+        if((k % CLLC_FSI_CHECK_ISR3_RATIO) == 0U)
+        {
+            events = CLLC_FSI_LOOPBACK_receive(&down, t, &frame, &arrival_s);
+            if((events != 0U) &&
+               (CLLC_FSILINK_takeSetpoint(&deviceRx, events, &frame,
+                                          &setpoint) != 0U))
+            {
+                CLLC_FSI_CHECK_getSetpoint(frame.word[0], &expectedSetpoint);
+                if(memcmp(&setpoint, &expectedSetpoint,
+                          sizeof(setpoint)) != 0)
+                {
+                    result.setpointsWrong++;
+                }
+                if(deviceRx.frames == 1U)
+                {
+                    result.firstSetpoint = frame.word[0];
+                }
+                latency_s = t - CLLC_FSI_CHECK_setpointSent_s[
+                                    frame.word[0] %
+                                    CLLC_FSI_CHECK_SETPOINTS_MAX];
+                result.latencyMin_s = fmin(result.latencyMin_s, latency_s);
+                result.latencyMax_s = fmax(result.latencyMax_s, latency_s);
+            }
+        }
+
+        CLLC_FSI_CHECK_getSample(deviceTx.sequence, &sample);
+        CLLC_FSILINK_packSample(&deviceTx, &frame, &sample);
+        (void)CLLC_FSI_LOOPBACK_send(&up, t, &frame);
+
+        //
+        // the remote reads every sample before the next one is sent
+        //
+        events = CLLC_FSI_LOOPBACK_receive(&up, t + (0.9 * period_s), &frame,
+                                           &arrival_s);
+        if((events != 0U) &&
+           (CLLC_FSILINK_takeSample(&remoteRx, events, &frame,
+                                    &sample) != 0U))
+        {
+            CLLC_FSI_CHECK_getSample(frame.word[0], &expectedSample);
+            if(memcmp(&sample, &expectedSample, sizeof(sample)) != 0)
+            {
+                result.samplesWrong++;
+            }
+        }
+    }
+
+    //
+    // the remote stops, what is still on the lines is read once more
+    //
+    t = (double)runs * period_s + 1e-3;
+    events = CLLC_FSI_LOOPBACK_receive(&down, t, &frame, &arrival_s);
+    if(events != 0U)
+    {
+        (void)CLLC_FSILINK_takeSetpoint(&deviceRx, events, &frame, &setpoint);
+    }
+    events = CLLC_FSI_LOOPBACK_receive(&up, t, &frame, &arrival_s);
+    if(events != 0U)
+    {
+        (void)CLLC_FSILINK_takeSample(&remoteRx, events, &frame, &sample);
+    }
+
+    bound_s = CLLC_FSI_LOOPBACK_getFrameTime(&down,
+                                             CLLC_FSILINK_SETPOINT_WORDS) +
+              CLLC_FSI_CHECK_DELAY_S +
+              ((double)CLLC_FSI_CHECK_ISR3_RATIO * period_s);
+
+    printf("%-9s samples %7lu taken %7lu lost %5lu flagged, "
+           "setpoints %5lu taken %5lu lost %5lu overruns, latency "
+           "%.1f..%.1f us (bound %.1f us)\n", c->name,
+           (unsigned long)remoteRx.frames, (unsigned long)remoteRx.lostFrames,
+           (unsigned long)remoteRx.errorFrames,
+           (unsigned long)deviceRx.frames, (unsigned long)deviceRx.lostFrames,
+           (unsigned long)deviceRx.overrunCount, result.latencyMin_s * 1e6,
+           result.latencyMax_s * 1e6, bound_s * 1e6);
+
+    if(result.samplesWrong != 0U)
+    {
+        CLLC_CHECK_failValue(c->name, "wrong samples", 0,
+                             (double)result.samplesWrong);
+    }
+    if(up.stats.busyFrames != 0U)
+    {
+        CLLC_CHECK_failValue(c->name, "samples refused by the transmitter", 0,
+                             (double)up.stats.busyFrames);
+    }
+    //
+    // a frame lost at the very end has no later sequence number to show it
+    //
+    if((remoteRx.frames + remoteRx.lostFrames + 1U) < deviceTx.frames)
+    {
+        CLLC_CHECK_failValue(c->name, "samples taken and lost",
+                             (double)deviceTx.frames,
+                             (double)(remoteRx.frames + remoteRx.lostFrames));
+    }
+    if(remoteRx.lostFrames != (up.stats.droppedFrames +
+                               up.stats.corruptedFrames))
+    {
+        CLLC_CHECK_failValue(c->name, "samples lost",
+                             (double)(up.stats.droppedFrames +
+                                      up.stats.corruptedFrames),
+                             (double)remoteRx.lostFrames);
+    }
+    if(remoteRx.errorFrames != up.stats.corruptedFrames)
+    {
+        CLLC_CHECK_failValue(c->name, "samples flagged",
+                             (double)up.stats.corruptedFrames,
+                             (double)remoteRx.errorFrames);
+    }
+
+    if(result.setpointsWrong != 0U)
+    {
+        CLLC_CHECK_failValue(c->name, "wrong setpoints", 0,
+                             (double)result.setpointsWrong);
+    }
+    if(deviceRx.frames == 0U)
+    {
+        CLLC_CHECK_failValue(c->name, "setpoints taken", 1, 0);
+    }
+    if((result.latencyMax_s > bound_s) || (result.latencyMin_s <= 0.0))
+    {
+        CLLC_CHECK_failValue(c->name, "setpoint latency bound", bound_s,
+                             result.latencyMax_s);
+    }
+    if(deviceRx.rejectedFrames != 0U)
+    {
+        CLLC_CHECK_failValue(c->name, "setpoints rejected", 0,
+                             (double)deviceRx.rejectedFrames);
+    }
+
+    if(c->setpointIntervalMin_s > (double)CLLC_FSI_CHECK_ISR3_RATIO *
+                                  period_s)
+    {
+        if((down.stats.overwrittenFrames != 0U) ||
+           (deviceRx.overrunCount != 0U))
+        {
+            CLLC_CHECK_failValue(c->name, "setpoint overruns", 0,
+                                 (double)deviceRx.overrunCount);
+        }
+    }
+    else if((deviceRx.overrunCount == 0U) ||
+            ((deviceRx.lostFrames + result.firstSetpoint) !=
+             down.stats.overwrittenFrames))
+    {
+        CLLC_CHECK_failValue(c->name, "setpoints overwritten and lost",
+                             (double)down.stats.overwrittenFrames,
+                             (double)deviceRx.lostFrames);
+    }
+    if((deviceRx.frames + deviceRx.lostFrames + result.firstSetpoint + 1U) <
+       remoteTx.frames)
+    {
+        CLLC_CHECK_failValue(c->name, "setpoints taken and lost",
+                             (double)remoteTx.frames,
+                             (double)(deviceRx.frames + deviceRx.lostFrames));
+    }
+}
+
+//
+// Frames the receiver has to turn down, and the sequence count around them
+//
+static void CLLC_FSI_CHECK_runRejects(void)
+{
+    CLLC_FSILINK_Tx tx;
+    CLLC_FSILINK_Rx rx;
+    CLLC_FSILINK_Frame frame;
+    CLLC_FSILINK_Setpoint setpoint, taken;
+    const uint16_t good = CLLC_FSILINK_RX_EVT_FRAME_DONE |
+                          CLLC_FSILINK_RX_EVT_DATA_FRAME;
+    uint16_t i, accepted = 0;
+
+    CLLC_FSILINK_initTx(&tx);
+    CLLC_FSILINK_initRx(&rx, &CLLC_FSI_CHECK_setpointMin,
+                        &CLLC_FSI_CHECK_setpointMax);
+
+    for(i = 0; i < 9U; i++)
+    {
+        CLLC_FSI_CHECK_getSetpoint(i, &setpoint);
+        switch(i)
+        {
+            case 1: setpoint.vSecRef_Volts = NAN; break;
+            case 2: setpoint.iSecRef_Amps = -1.0f; break;
+            case 3: setpoint.pwmFrequencyRef_Hz = INFINITY; break;
+            default: break;
+        }
+        CLLC_FSILINK_packSetpoint(&tx, &frame, &setpoint);
+        switch(i)
+        {
+            case 4: frame.tag = CLLC_FSILINK_TAG_SAMPLE; break;
+            case 5: frame.userData = CLLC_FSILINK_VERSION + 1U; break;
+            case 6: frame.words = CLLC_FSILINK_SAMPLE_WORDS; break;
+            default: break;
+        }
+        accepted += CLLC_FSILINK_takeSetpoint(&rx,
+                            (i == 7U) ? (good | CLLC_FSILINK_RX_EVT_EOF_ERR) :
+                                        good, &frame, &taken);
+    }
+
+    //
+    // 0 and 8 taken, 1 to 3 counted then turned down for their values,
+    // 4 to 6 turned down before their number is looked at, 7 flagged
+    //
+    printf("rejects   %u taken, %lu rejected, %lu flagged, %lu lost\n",
+           (unsigned)accepted, (unsigned long)rx.rejectedFrames,
+           (unsigned long)rx.errorFrames, (unsigned long)rx.lostFrames);
+    if((accepted != 2U) || (rx.frames != 2U))
+    {
+        CLLC_CHECK_failValue("rejects", "taken", 2, accepted);
+    }
+    if(rx.rejectedFrames != 6U)
+    {
+        CLLC_CHECK_failValue("rejects", "rejected", 6,
+                             (double)rx.rejectedFrames);
+    }
+    if(rx.errorFrames != 1U)
+    {
+        CLLC_CHECK_failValue("rejects", "flagged", 1, (double)rx.errorFrames);
+    }
+    if(rx.lostFrames != 4U)
+    {
+        CLLC_CHECK_failValue("rejects", "lost", 4, (double)rx.lostFrames);
+    }
+    CLLC_FSI_CHECK_getSetpoint(8, &setpoint);
+    if(memcmp(&taken, &setpoint, sizeof(taken)) != 0)
+    {
+        CLLC_CHECK_failValue("rejects", "last setpoint", 0, 1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    CLLC_FSI_LOOPBACK_Link link;
+    double time_s = 1.0;
+    uint64_t seed = 1;
+    uint16_t prescaler;
+    uint16_t i;
+    int a;
+
+    for(a = 1; a < argc; a++)
+    {
+        if((strcmp(argv[a], "-t") == 0) && ((a + 1) < argc))
+        {
+            time_s = atof(argv[++a]);
+        }
+        else if((strcmp(argv[a], "-s") == 0) && ((a + 1) < argc))
+        {
+            seed = strtoull(argv[++a], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-t seconds] [-s seed]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    //
+    // line time of a sample frame against the ISR2 period
+    //
+    for(prescaler = 3; prescaler <= 12U; prescaler *= 2U)
+    {
+        CLLC_FSI_LOOPBACK_init(&link, 2.0 * 120e6 / prescaler, 0, 0, 0, 0);
+        printf("TXCLK %5.1f MHz: sample frame %5.2f us, %3.0f %% of ISR2\n",
+               120.0 / prescaler,
+               CLLC_FSI_LOOPBACK_getFrameTime(&link,
+                                              CLLC_FSILINK_SAMPLE_WORDS) * 1e6,
+               CLLC_FSI_LOOPBACK_getFrameTime(&link,
+                                              CLLC_FSILINK_SAMPLE_WORDS) *
+               CLLC_FSI_CHECK_ISR2_HZ * 100.0);
+    }
+
+    for(i = 0; i < (sizeof(CLLC_FSI_CHECK_case) /
+                    sizeof(CLLC_FSI_CHECK_case[0])); i++)
+    {
+        CLLC_FSI_CHECK_runCase(&CLLC_FSI_CHECK_case[i], time_s, seed);
+    }
+    CLLC_FSI_CHECK_runRejects();
+
+    return(CLLC_CHECK_result());
+}
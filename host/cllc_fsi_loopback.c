@@ -0,0 +1,189 @@
+//#############################################################################
+//
+// FILE:   cllc_fsi_loopback.c
+//
+// TITLE:  Model of one direction of an FSI link, see cllc_fsi_loopback.h
+//
+//#############################################################################
+
+#include <string.h>
+#include <math.h>
+#include "cllc_fsi_loopback.h"
+
+//
+// splitmix64, as cllc_mc_main.c
+//
+static uint64_t CLLC_FSI_LOOPBACK_nextRandom(uint64_t *state)
+{
+    uint64_t z;
+
+    *state += 0x9E3779B97F4A7C15ULL;
+    z = *state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return(z ^ (z >> 31));
+}
+
+static double CLLC_FSI_LOOPBACK_getUniform(uint64_t *state)
+{
+    return((double)(CLLC_FSI_LOOPBACK_nextRandom(state) >> 11) *
+           (1.0 / 9007199254740992.0));
+}
+
+static uint16_t CLLC_FSI_LOOPBACK_crcByte(uint16_t crc, uint16_t byte)
+{
+    uint16_t bit;
+
+    crc ^= byte & 0xFFU;
+    for(bit = 0; bit < 8U; bit++)
+    {
+        crc = (crc & 0x80U) ? (uint16_t)(((crc << 1) ^ 0x07U) & 0xFFU) :
+                              (uint16_t)((crc << 1) & 0xFFU);
+    }
+    return(crc);
+}
+
+//
+// CRC-8, polynomial 0x07, over the tag, the user data and the data words
+//
+uint16_t CLLC_FSI_LOOPBACK_crc(const CLLC_FSILINK_Frame *frame)
+{
+    uint16_t crc = 0;
+    uint16_t i;
+
+    crc = CLLC_FSI_LOOPBACK_crcByte(crc, frame->tag);
+    crc = CLLC_FSI_LOOPBACK_crcByte(crc, frame->userData);
+    for(i = 0; i < frame->words; i++)
+    {
+        crc = CLLC_FSI_LOOPBACK_crcByte(crc, frame->word[i] >> 8);
+        crc = CLLC_FSI_LOOPBACK_crcByte(crc, frame->word[i]);
+    }
+    return(crc);
+}
+
+void CLLC_FSI_LOOPBACK_init(CLLC_FSI_LOOPBACK_Link *link, double bitRate_bps,
+                            double delay_s, double dropRate,
+                            double bitErrorRate, uint64_t seed)
+{
+    memset(link, 0, sizeof(*link));
+    link->bitRate_bps = bitRate_bps;
+    link->delay_s = delay_s;
+    link->dropRate = dropRate;
+    link->bitErrorRate = bitErrorRate;
+    link->random = seed;
+    link->lineFree_s = -1.0;
+}
+
+double CLLC_FSI_LOOPBACK_getFrameTime(const CLLC_FSI_LOOPBACK_Link *link,
+                                      uint16_t words)
+{
+    return((double)(CLLC_FSI_LOOPBACK_OVERHEAD_BITS + (16U * words)) /
+           link->bitRate_bps);
+}
+
+//
+// Returns 1 when the transmitter took the frame
+//
+uint16_t CLLC_FSI_LOOPBACK_send(CLLC_FSI_LOOPBACK_Link *link, double now_s,
+                                const CLLC_FSILINK_Frame *frame)
+{
+    CLLC_FSI_LOOPBACK_Flight *flight;
+    uint16_t bits = 12U + (16U * frame->words);     // tag, user data, words
+    uint16_t bit;
+
+    if((now_s < link->lineFree_s) ||
+       (link->flightCount == CLLC_FSI_LOOPBACK_FLIGHT_MAX))
+    {
+        link->stats.busyFrames++;
+        return(0);
+    }
+
+    link->lineFree_s = now_s + CLLC_FSI_LOOPBACK_getFrameTime(link,
+                                                              frame->words);
+    link->stats.sentFrames++;
+
+    if(CLLC_FSI_LOOPBACK_getUniform(&link->random) < link->dropRate)
+    {
+        link->stats.droppedFrames++;
+        return(1);
+    }
+
+    flight = &link->flight[(link->flightHead + link->flightCount) %
+                           CLLC_FSI_LOOPBACK_FLIGHT_MAX];
+    flight->frame = *frame;
+    flight->crc = CLLC_FSI_LOOPBACK_crc(frame);
+    flight->arrival_s = link->lineFree_s + link->delay_s;
+    link->flightCount++;
+
+    if(CLLC_FSI_LOOPBACK_getUniform(&link->random) <
+       (1.0 - pow(1.0 - link->bitErrorRate, (double)bits)))
+    {
+        bit = (uint16_t)(CLLC_FSI_LOOPBACK_nextRandom(&link->random) % bits);
+        if(bit < 4U)
+        {
+            flight->frame.tag ^= (uint16_t)(1U << bit);
+        }
+        else if(bit < 12U)
+        {
+            flight->frame.userData ^= (uint16_t)(1U << (bit - 4U));
+        }
+        else
+        {
+            bit -= 12U;
+            flight->frame.word[bit / 16U] ^= (uint16_t)(1U << (bit % 16U));
+        }
+        link->stats.corruptedFrames++;
+    }
+    return(1);
+}
+
+//
+// The frames landed by now go into the receiver buffer in order. Returns
+// the events since the last call, with the frame in the buffer, 0 when
+// nothing landed.
+//
+uint16_t CLLC_FSI_LOOPBACK_receive(CLLC_FSI_LOOPBACK_Link *link,
+                                   double now_s, CLLC_FSILINK_Frame *frame,
+                                   double *arrival_s)
+{
+    CLLC_FSI_LOOPBACK_Flight *flight;
+    uint16_t events;
+
+    while((link->flightCount != 0U) &&
+          (link->flight[link->flightHead].arrival_s <= now_s))
+    {
+        flight = &link->flight[link->flightHead];
+
+        if((link->events & CLLC_FSILINK_RX_EVT_FRAME_DONE) != 0U)
+        {
+            link->events |= CLLC_FSILINK_RX_EVT_FRAME_OVERRUN;
+            link->stats.overwrittenFrames++;
+        }
+
+        link->buffer = flight->frame;
+        link->bufferArrival_s = flight->arrival_s;
+        if(CLLC_FSI_LOOPBACK_crc(&flight->frame) != flight->crc)
+        {
+            link->events |= CLLC_FSILINK_RX_EVT_CRC_ERR;
+        }
+        else
+        {
+            link->events |= CLLC_FSILINK_RX_EVT_FRAME_DONE |
+                            CLLC_FSILINK_RX_EVT_DATA_FRAME;
+        }
+        link->stats.deliveredFrames++;
+
+        link->flightHead = (link->flightHead + 1U) %
+                           CLLC_FSI_LOOPBACK_FLIGHT_MAX;
+        link->flightCount--;
+    }
+
+    events = link->events;
+    if(events != 0U)
+    {
+        *frame = link->buffer;
+        *arrival_s = link->bufferArrival_s;
+        link->events = 0;
+    }
+    return(events);
+}
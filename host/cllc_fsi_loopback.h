@@ -0,0 +1,106 @@
+//#############################################################################
+//
+// FILE:   cllc_fsi_loopback.h
+//
+// TITLE:  Model of one direction of an FSI link, transmitter to receiver
+//         A frame sent takes the line for its bits at the bit rate, one
+//         lane at two bits per TXCLK, and lands in the receiver after the
+//         line delay. The transmitter takes no frame while it is still
+//         sending one. The receiver holds one frame, a frame landing before
+//         the last one was read overwrites it and raises the frame overrun
+//         event, as FSI_RX_EVT_FRAME_OVERRUN does.
+//
+//         Errors: a frame can be lost on the line whole, and a bit of it can
+//         be flipped. The receiver checks an 8 bit CRC over the tag, user
+//         data and data words, standing in for the CRC of the FSI, and
+//         raises the CRC error event on a mismatch. The flips are single bit
+//         errors, which the CRC always catches.
+//
+//         The events handed out are the FSI_RX_EVT_ flags the firmware reads,
+//         see cllc_fsilink.h. Time is in seconds, the caller's.
+//
+//#############################################################################
+
+#ifndef CLLC_FSI_LOOPBACK_H
+#define CLLC_FSI_LOOPBACK_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "cllc_fsilink.h"
+
+//
+// Defines
+//
+#define CLLC_FSI_LOOPBACK_FLIGHT_MAX    16U
+
+//
+// start of frame, frame type, user data, CRC, tag and end of frame
+//
+#define CLLC_FSI_LOOPBACK_OVERHEAD_BITS 32U
+
+//
+// typedefs
+//
+typedef struct
+{
+    CLLC_FSILINK_Frame frame;
+    uint16_t crc;               // as sent
+    double arrival_s;
+} CLLC_FSI_LOOPBACK_Flight;
+
+typedef struct
+{
+    uint64_t sentFrames;
+    uint64_t busyFrames;        // refused, the transmitter was sending
+    uint64_t droppedFrames;     // lost on the line
+    uint64_t corruptedFrames;   // a bit flipped
+    uint64_t deliveredFrames;
+    uint64_t overwrittenFrames; // landed on an unread frame
+} CLLC_FSI_LOOPBACK_Stats;
+
+typedef struct
+{
+    double bitRate_bps;
+    double delay_s;
+    double dropRate;            // per frame
+    double bitErrorRate;        // per bit
+    uint64_t random;
+
+    double lineFree_s;
+    CLLC_FSI_LOOPBACK_Flight flight[CLLC_FSI_LOOPBACK_FLIGHT_MAX];
+    uint16_t flightHead;
+    uint16_t flightCount;
+
+    CLLC_FSILINK_Frame buffer;
+    uint16_t events;            // since the last read
+    double bufferArrival_s;
+
+    CLLC_FSI_LOOPBACK_Stats stats;
+} CLLC_FSI_LOOPBACK_Link;
+
+//
+// the function prototypes
+//
+void CLLC_FSI_LOOPBACK_init(CLLC_FSI_LOOPBACK_Link *link, double bitRate_bps,
+                            double delay_s, double dropRate,
+                            double bitErrorRate, uint64_t seed);
+double CLLC_FSI_LOOPBACK_getFrameTime(const CLLC_FSI_LOOPBACK_Link *link,
+                                      uint16_t words);
+uint16_t CLLC_FSI_LOOPBACK_send(CLLC_FSI_LOOPBACK_Link *link, double now_s,
+                                const CLLC_FSILINK_Frame *frame);
+uint16_t CLLC_FSI_LOOPBACK_receive(CLLC_FSI_LOOPBACK_Link *link,
+                                   double now_s, CLLC_FSILINK_Frame *frame,
+                                   double *arrival_s);
+uint16_t CLLC_FSI_LOOPBACK_crc(const CLLC_FSILINK_Frame *frame);
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
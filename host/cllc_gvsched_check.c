@@ -0,0 +1,542 @@
+//#############################################################################
+//
+// FILE:   cllc_gvsched_check.c
+//
+// TITLE:  Frequency response of the voltage loop over the gain schedule
+//         Linearizes the averaged tank of cllc_plant_fha.h, the same
+//         reduction and parts, at operating points across the switching
+//         range: the receiving bus at its nominal voltage with a resistive
+//         load, the source set so the tank holds it at the period. The
+//         plant from the period to the sensed bus, ZOH discretized at the
+//         ISR2 rate, one ISR2 of delay and GV make the loop. It runs with
+//         the fixed GV and with the gain of cllc_gvsched.h at the period,
+//         on the bounds of the sectors and half way between, and reports
+//         crossover, phase margin and gain margin of both.
+//
+//         Checks, on the scheduled loop only, at every point: phase and
+//         gain margin, and the crossover within a factor of the one set
+//         for the schedule. Then the schedule itself: continuous over the
+//         sector bounds, held at the ends, and a DF13 at rest keeps its
+//         output while the period slews through all the sectors.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -include host/cllc_emu_target.h
+//             -I. -Icllc -Ihost -Idevice -Idevice/driverlib -Ilibraries
+//             host/cllc_gvsched_check.c -lm -o cllc_gvsched_check
+//
+//         Usage:
+//         cllc_gvsched_check [-l percent] [-g]
+//           -l  load in percent of the rated power (default
+//               CLLC_GV_SCHEDULE_LOAD)
+//           -g  print the gains that hold CLLC_GVx_SCHEDULE_CROSSOVER_HZ,
+//               for CLLC_GVx_SCHEDULE_GAINS
+//
+//         Exits 0 when all checks pass.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include "cllc_settings.h"
+#include "DCL/DCLF32.h"
+#include "cllc_gvsched.h"
+#include "cllc_plant.h"
+#include "cllc_check.h"
+
+//
+// Defines
+//
+#define CLLC_GVSCHED_CHECK_POINTS       ((2U * GSM_N) + 1U)
+#define CLLC_GVSCHED_CHECK_SWEEP        4000U
+#define CLLC_GVSCHED_CHECK_F_LOW_HZ     10.0
+#define CLLC_GVSCHED_CHECK_R_OHMS       0.1     // as cllc_plant_fha.c
+
+#define CLLC_GVSCHED_CHECK_PERIOD_MIN_PU                                     \
+        ((float64_t)CLLC_MIN_PWM_SWITCHING_FREQUENCY_HZ /                    \
+         (float64_t)CLLC_MAX_PWM_SWITCHING_FREQUENCY_HZ)
+#define CLLC_GVSCHED_CHECK_PERIOD_NOMINAL_PU                                 \
+        ((float64_t)CLLC_MIN_PWM_SWITCHING_FREQUENCY_HZ /                    \
+         (float64_t)CLLC_NOMINAL_PWM_SWITCHING_FREQUENCY_HZ)
+
+//
+// bounds of the checks, on the scheduled loop, the phase margin is that of
+// the loop
+//
+#define CLLC_GVSCHED_CHECK_PM_MIN_DEG   45.0
+#define CLLC_GVSCHED_CHECK_GM_MIN_DB    6.0
+#define CLLC_GVSCHED_CHECK_FC_RATIO     3.0     // of the set crossover
+#define CLLC_GVSCHED_CHECK_SAMPLES      8U      // per half sector, for -g
+#define CLLC_GVSCHED_CHECK_STEP_MAX     1.0e-5  // over a sector bound
+
+//
+// typedefs
+//
+typedef struct
+{
+    const char *name;
+    uint16_t powerFlow;
+    float64_t a[3];
+    float64_t b[4];
+    float32_t gain[GSM_N + 1];
+    float64_t fc_Hz;            // crossover the gains are set for
+} CLLC_GVSCHED_CHECK_Loop;
+
+typedef struct
+{
+    float64_t vSource_Volts;    // prim referred
+    float64_t gain;             // pu of period to pu of sensed bus, DC
+    float64_t pole;             // of the bus, z
+} CLLC_GVSCHED_CHECK_Plant;
+
+typedef struct
+{
+    float64_t fc_Hz;            // 0 when |L| stays below 1
+    float64_t pm_deg;
+    float64_t gm_dB;            // INFINITY without a -180 crossing
+} CLLC_GVSCHED_CHECK_Margins;
+
+//
+// Globals
+//
+static const CLLC_GVSCHED_CHECK_Loop CLLC_GVSCHED_CHECK_loop[] =
+{
+    {
+        "GV1 prim to sec", CLLC_POWER_FLOW_PRIM_SEC,
+        { CLLC_GV1_2P2Z_A1, CLLC_GV1_2P2Z_A2, CLLC_GV1_2P2Z_A3 },
+        { CLLC_GV1_2P2Z_B0, CLLC_GV1_2P2Z_B1, CLLC_GV1_2P2Z_B2,
+          CLLC_GV1_2P2Z_B3 },
+        CLLC_GV1_SCHEDULE_GAINS, CLLC_GV1_SCHEDULE_CROSSOVER_HZ
+    },
+    {
+        "GV2 sec to prim", CLLC_POWER_FLOW_SEC_PRIM,
+        { CLLC_GV2_2P2Z_A1, CLLC_GV2_2P2Z_A2, CLLC_GV2_2P2Z_A3 },
+        { CLLC_GV2_2P2Z_B0, CLLC_GV2_2P2Z_B1, CLLC_GV2_2P2Z_B2,
+          CLLC_GV2_2P2Z_B3 },
+        CLLC_GV2_SCHEDULE_GAINS, CLLC_GV2_SCHEDULE_CROSSOVER_HZ
+    },
+};
+
+//
+// Function Definitions
+//
+
+//
+// The rectified current into the receiving bus, prim referred, and its
+// slope over the bus voltage, the reduction of CLLC_PLANT_FHA_updateTank
+// and CLLC_PLANT_FHA_run at the period. The tank is symmetric, the power
+// flow does not change it.
+//
+static float64_t CLLC_GVSCHED_CHECK_getCurrent(float64_t period_pu,
+                                               float64_t vSource_Volts,
+                                               float64_t vBus_Volts,
+                                               float64_t *slope_S)
+{
+    float64_t r = CLLC_GVSCHED_CHECK_R_OHMS;
+    float64_t lr = CLLC_PLANT_LR1_H;
+    float64_t cr = CLLC_PLANT_getResonantCapacitance(lr);
+    float64_t omega, xs, xm, shunt, x, z2, vOpen, vRect, iTank;
+
+    omega = 2.0 * M_PI * (float64_t)CLLC_MIN_PWM_SWITCHING_FREQUENCY_HZ /
+            period_pu;
+    xs = (omega * lr) - (1.0 / (omega * cr));
+    xm = omega * CLLC_PLANT_LM_H;
+    shunt = xs + xm;
+    x = xs + ((xs * xm) / shunt);
+    z2 = (r * r) + (x * x);
+    vOpen = (4.0 / M_PI) * vSource_Volts * fabs(xm / shunt);
+    vRect = (4.0 / M_PI) * vBus_Volts;
+
+    *slope_S = 0.0;
+    if(vOpen <= vRect)
+    {
+        return(0.0);
+    }
+
+    iTank = (sqrt((r * r * vRect * vRect) -
+                  (z2 * ((vRect * vRect) - (vOpen * vOpen)))) -
+             (r * vRect)) / z2;
+    *slope_S = (8.0 / (M_PI * M_PI)) * ((r * iTank) + vRect) /
+               ((z2 * iTank) + (r * vRect));
+
+    return((2.0 / M_PI) * iTank);
+}
+
+//
+// The operating point at the period and its plant, per unit as GV sees it:
+// the period in, the sensed bus out
+//
+static void CLLC_GVSCHED_CHECK_getPlant(uint16_t powerFlow,
+                                        float64_t period_pu,
+                                        float64_t load_pu,
+                                        CLLC_GVSCHED_CHECK_Plant *plant)
+{
+    float64_t n = CLLC_PLANT_TURNS_RATIO;
+    float64_t dt = 1.0 / (float64_t)CLLC_ISR2_FREQUENCY_HZ;
+    float64_t vBus, c, g, sense, low, high, slope, dp, gIp, gTotal;
+    uint16_t k;
+
+    if(powerFlow == CLLC_POWER_FLOW_SEC_PRIM)
+    {
+        vBus = (float64_t)CLLC_VPRIM_NOMINAL_VOLTS;
+        c = CLLC_PLANT_CBUS_F;
+        sense = 1.0 / (float64_t)CLLC_VPRIM_MAX_SENSE_VOLTS;
+    }
+    else
+    {
+        vBus = n * (float64_t)CLLC_VSEC_NOMINAL_VOLTS;
+        c = CLLC_PLANT_CBUS_F / (n * n);
+        sense = 1.0 / (n * (float64_t)CLLC_VSEC_OPTIMAL_RANGE_VOLTS);
+    }
+    g = load_pu * CLLC_PLANT_RATED_POWER_W / (vBus * vBus);
+
+    //
+    // the source that holds the bus, the current rises with it
+    //
+    low = 0.0;
+    high = 20.0 * vBus;
+    for(k = 0; k < 100U; k++)
+    {
+        plant->vSource_Volts = 0.5 * (low + high);
+        if(CLLC_GVSCHED_CHECK_getCurrent(period_pu, plant->vSource_Volts,
+                                         vBus, &slope) < (g * vBus))
+        {
+            low = plant->vSource_Volts;
+        }
+        else
+        {
+            high = plant->vSource_Volts;
+        }
+    }
+
+    //
+    // C dv = (Ip dp - (g + slope) dv) dt
+    //
+    dp = 1.0e-6;
+    gIp = (CLLC_GVSCHED_CHECK_getCurrent(period_pu + dp, plant->vSource_Volts,
+                                         vBus, &slope) -
+           CLLC_GVSCHED_CHECK_getCurrent(period_pu - dp, plant->vSource_Volts,
+                                         vBus, &slope)) / (2.0 * dp);
+    CLLC_GVSCHED_CHECK_getCurrent(period_pu, plant->vSource_Volts, vBus,
+                                  &slope);
+    gTotal = g + slope;
+
+    plant->gain = sense * gIp / gTotal;
+    plant->pole = exp(-gTotal * dt / c);
+}
+
+//
+// The loop at f_Hz: gain times GV, one ISR2 of delay and the ZOH plant
+//
+static double complex CLLC_GVSCHED_CHECK_getLoop(
+                                    const CLLC_GVSCHED_CHECK_Loop *loop,
+                                    const CLLC_GVSCHED_CHECK_Plant *plant,
+                                    float64_t gain, float64_t f_Hz)
+{
+    double complex z1 = cexp(-I * 2.0 * M_PI * f_Hz /
+                             (float64_t)CLLC_ISR2_FREQUENCY_HZ);
+    double complex num, den, gv, p;
+
+    num = loop->b[0] + (z1 * (loop->b[1] + (z1 * (loop->b[2] +
+                                                  (z1 * loop->b[3])))));
+    den = 1.0 + (z1 * (loop->a[0] + (z1 * (loop->a[1] +
+                                           (z1 * loop->a[2])))));
+    gv = num / den;
+    p = plant->gain * (1.0 - plant->pole) * z1 / (1.0 - (plant->pole * z1));
+
+    return(gain * gv * z1 * p);
+}
+
+static void CLLC_GVSCHED_CHECK_getMargins(
+                                    const CLLC_GVSCHED_CHECK_Loop *loop,
+                                    const CLLC_GVSCHED_CHECK_Plant *plant,
+                                    float64_t gain,
+                                    CLLC_GVSCHED_CHECK_Margins *margins)
+{
+    float64_t fHigh = 0.5 * (float64_t)CLLC_ISR2_FREQUENCY_HZ;
+    float64_t ratio = pow(fHigh / CLLC_GVSCHED_CHECK_F_LOW_HZ,
+                          1.0 / (float64_t)(CLLC_GVSCHED_CHECK_SWEEP - 1U));
+    float64_t f = CLLC_GVSCHED_CHECK_F_LOW_HZ;
+    float64_t mag, phase, magPrev = 0.0, phasePrev = 0.0, step;
+    double complex l;
+    uint32_t k;
+
+    margins->fc_Hz = 0.0;
+    margins->pm_deg = 0.0;
+    margins->gm_dB = INFINITY;
+
+    for(k = 0; k < CLLC_GVSCHED_CHECK_SWEEP; k++, f *= ratio)
+    {
+        l = CLLC_GVSCHED_CHECK_getLoop(loop, plant, gain, f);
+        mag = cabs(l);
+        phase = carg(l) * (180.0 / M_PI);
+        if(k > 0U)
+        {
+            //
+            // unwrapped from the phase of the lowest point
+            //
+            step = phase - fmod(phasePrev, 360.0);
+            step -= 360.0 * floor((step + 180.0) / 360.0);
+            phase = phasePrev + step;
+
+            if((margins->fc_Hz == 0.0) && (magPrev >= 1.0) && (mag < 1.0))
+            {
+                margins->fc_Hz = f;
+                margins->pm_deg = 180.0 + phase;
+            }
+            if(isinf(margins->gm_dB) && (phasePrev > -180.0) &&
+               (phase <= -180.0))
+            {
+                margins->gm_dB = -20.0 * log10(mag);
+            }
+        }
+        magPrev = mag;
+        phasePrev = phase;
+    }
+}
+
+static void CLLC_GVSCHED_CHECK_printMargins(
+                                    const CLLC_GVSCHED_CHECK_Margins *m)
+{
+    if(m->fc_Hz > 0.0)
+    {
+        printf("  %7.0f Hz %6.1f deg", m->fc_Hz, m->pm_deg);
+    }
+    else
+    {
+        printf("        -        -    ");
+    }
+    if(isinf(m->gm_dB))
+    {
+        printf("     -   ");
+    }
+    else
+    {
+        printf(" %5.1f dB", m->gm_dB);
+    }
+}
+
+//
+// The schedule on its own: continuous over the sector bounds, held at the
+// ends, and an output at rest that stays while the period slews
+//
+static void CLLC_GVSCHED_CHECK_runSchedule(
+                                    const CLLC_GVSCHED_CHECK_Loop *loop)
+{
+    float32_t periodMin_pu = (float32_t)CLLC_GVSCHED_CHECK_PERIOD_MIN_PU;
+    float32_t scale = 1.0f / (1.0f - periodMin_pu);
+    float32_t p, below, above, out, out0, gain;
+    DCL_GSM schedule;
+    DCL_DF13 gv;
+    uint16_t j;
+
+    CLLC_GVSCHED_init(&schedule, loop->gain);
+
+    for(j = 1; j < GSM_N; j++)
+    {
+        p = periodMin_pu + ((float32_t)j / ((float32_t)GSM_N * scale));
+        below = CLLC_GVSCHED_getGain(&schedule, p - 1.0e-6f, periodMin_pu,
+                                     scale);
+        above = CLLC_GVSCHED_getGain(&schedule, p + 1.0e-6f, periodMin_pu,
+                                     scale);
+        CLLC_CHECK_expectTrue(fabsf(above - below) <
+                              CLLC_GVSCHED_CHECK_STEP_MAX +
+                              (fmaxf(fabsf(schedule.m[j - 1]),
+                                     fabsf(schedule.m[j])) *
+                               2.0e-6f * scale),
+                              "%s at %.4f: gain over a sector bound (%.4g)",
+                              loop->name, p, above - below);
+    }
+
+    gain = CLLC_GVSCHED_getGain(&schedule, 0.0f, periodMin_pu, scale);
+    CLLC_CHECK_expectTrue(gain == loop->gain[0],
+                          "%s at %.4f: gain below the range (%.4g)",
+                          loop->name, 0.0, gain);
+    gain = CLLC_GVSCHED_getGain(&schedule, 1.5f, periodMin_pu, scale);
+    CLLC_CHECK_expectTrue(gain == loop->gain[GSM_N],
+                          "%s at %.4f: gain above the range (%.4g)",
+                          loop->name, 1.5, gain);
+
+    //
+    // GV at rest on a period, as the loop runs it with the scheduled error
+    //
+    memset(&gv, 0, sizeof(gv));
+    gv.a1 = (float32_t)loop->a[0];
+    gv.a2 = (float32_t)loop->a[1];
+    gv.a3 = (float32_t)loop->a[2];
+    gv.b0 = (float32_t)loop->b[0];
+    gv.b1 = (float32_t)loop->b[1];
+    gv.b2 = (float32_t)loop->b[2];
+    gv.b3 = (float32_t)loop->b[3];
+    out0 = (float32_t)CLLC_GVSCHED_CHECK_PERIOD_NOMINAL_PU;
+    gv.d5 = out0;
+    gv.d6 = out0;
+    out = out0;
+
+    for(p = periodMin_pu; p <= 1.0f; p += CLLC_MAX_PERIOD_STEP_PU)
+    {
+        gain = CLLC_GVSCHED_getGain(&schedule, p, periodMin_pu, scale);
+        out = DCL_runDF13_C4(&gv, gain * 0.0f);
+    }
+    CLLC_CHECK_expectTrue(out == out0, "%s at %.4f: output at rest (%.4g)",
+                          loop->name, 1.0, out - out0);
+}
+
+//
+// The gains at the sector bounds for -g: the least of the gains that put
+// the crossover at fc_Hz within half a sector of the bound. The middle of
+// a sector then gets no more gain than it needs, where the tank gain
+// peaks at resonance faster than a sector can follow. Points past the
+// peak of the tank gain are left out, as the check leaves them out.
+//
+static void CLLC_GVSCHED_CHECK_printGains(const CLLC_GVSCHED_CHECK_Loop *loop,
+                                          float64_t load_pu)
+{
+    float64_t periodMin_pu = CLLC_GVSCHED_CHECK_PERIOD_MIN_PU;
+    float64_t sector_pu = (1.0 - periodMin_pu) / (float64_t)GSM_N;
+    float64_t period_pu, gain, least = 1.0;
+    int32_t j, k;
+    CLLC_GVSCHED_CHECK_Plant plant;
+
+    printf("%s, %.0f%% load, crossover %.0f Hz:\n", loop->name,
+           load_pu * 100.0, loop->fc_Hz);
+    for(j = 0; j <= (int32_t)GSM_N; j++)
+    {
+        gain = INFINITY;
+        for(k = -(int32_t)CLLC_GVSCHED_CHECK_SAMPLES;
+            k <= (int32_t)CLLC_GVSCHED_CHECK_SAMPLES; k++)
+        {
+            period_pu = periodMin_pu +
+                        (sector_pu * ((float64_t)j +
+                                      ((float64_t)k /
+                                       (2.0 *
+                                        (float64_t)CLLC_GVSCHED_CHECK_SAMPLES))));
+            if((period_pu < periodMin_pu) || (period_pu > 1.0))
+            {
+                continue;
+            }
+            CLLC_GVSCHED_CHECK_getPlant(loop->powerFlow, period_pu, load_pu,
+                                        &plant);
+            if(plant.gain > 0.0)
+            {
+                gain = fmin(gain, 1.0 /
+                            cabs(CLLC_GVSCHED_CHECK_getLoop(loop, &plant, 1.0,
+                                                            loop->fc_Hz)));
+            }
+        }
+        if(!isinf(gain))
+        {
+            least = gain;
+        }
+        printf("%s%.4ff", (j == 0) ? "    " : ", ", least);
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    float64_t load_pu = CLLC_GV_SCHEDULE_LOAD;
+    float64_t periodMin_pu = CLLC_GVSCHED_CHECK_PERIOD_MIN_PU;
+    float64_t step_pu = (1.0 - periodMin_pu) / (float64_t)(2U * GSM_N);
+    float64_t period_pu, gain, ratio;
+    float32_t scale = 1.0f / (1.0f - (float32_t)periodMin_pu);
+    uint16_t printGains = 0;
+    uint16_t n, j;
+    int i;
+    const CLLC_GVSCHED_CHECK_Loop *loop;
+    CLLC_GVSCHED_CHECK_Plant plant;
+    CLLC_GVSCHED_CHECK_Margins fixed, scheduled;
+    DCL_GSM schedule;
+
+    for(i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "-l") == 0) && (i + 1 < argc))
+        {
+            load_pu = atof(argv[++i]) / 100.0;
+        }
+        else if(strcmp(argv[i], "-g") == 0)
+        {
+            printGains = 1;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-l percent] [-g]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    for(n = 0; n < sizeof(CLLC_GVSCHED_CHECK_loop) /
+                   sizeof(CLLC_GVSCHED_CHECK_loop[0]); n++)
+    {
+        loop = &CLLC_GVSCHED_CHECK_loop[n];
+        if(printGains != 0U)
+        {
+            CLLC_GVSCHED_CHECK_printGains(loop, load_pu);
+            continue;
+        }
+
+        CLLC_GVSCHED_init(&schedule, loop->gain);
+
+        printf("%s, %.0f%% load, crossover set to %.0f Hz\n", loop->name,
+               load_pu * 100.0, loop->fc_Hz);
+        printf("period  f sw     source   fixed crossover  pm         gm"
+               "        gain    scheduled        pm         gm\n");
+
+        for(j = 0; j < CLLC_GVSCHED_CHECK_POINTS; j++)
+        {
+            period_pu = periodMin_pu + (step_pu * (float64_t)j);
+            CLLC_GVSCHED_CHECK_getPlant(loop->powerFlow, period_pu, load_pu,
+                                        &plant);
+            printf("%.4f  %3.0f kHz %5.0f V", period_pu,
+                   (float64_t)CLLC_MIN_PWM_SWITCHING_FREQUENCY_HZ /
+                   period_pu * 1e-3, plant.vSource_Volts);
+
+            //
+            // past the peak of the tank gain the bus falls with the period,
+            // outside the range the loop can run in
+            //
+            if(plant.gain <= 0.0)
+            {
+                printf("  past the peak gain\n");
+                continue;
+            }
+
+            CLLC_GVSCHED_CHECK_getMargins(loop, &plant, 1.0, &fixed);
+            gain = CLLC_GVSCHED_getGain(&schedule, (float32_t)period_pu,
+                                        (float32_t)periodMin_pu, scale);
+            CLLC_GVSCHED_CHECK_getMargins(loop, &plant, gain, &scheduled);
+
+            CLLC_GVSCHED_CHECK_printMargins(&fixed);
+            printf("  %6.4f", gain);
+            CLLC_GVSCHED_CHECK_printMargins(&scheduled);
+            printf("\n");
+
+            ratio = scheduled.fc_Hz / loop->fc_Hz;
+            CLLC_CHECK_expectTrue((ratio < CLLC_GVSCHED_CHECK_FC_RATIO) &&
+                                  (ratio > 1.0 / CLLC_GVSCHED_CHECK_FC_RATIO),
+                                  "%s at %.4f: crossover (%.4g)", loop->name,
+                                  period_pu, scheduled.fc_Hz);
+            CLLC_CHECK_expectTrue(scheduled.pm_deg >=
+                                  CLLC_GVSCHED_CHECK_PM_MIN_DEG,
+                                  "%s at %.4f: phase margin (%.4g)",
+                                  loop->name, period_pu, scheduled.pm_deg);
+            CLLC_CHECK_expectTrue(scheduled.gm_dB >=
+                                  CLLC_GVSCHED_CHECK_GM_MIN_DB,
+                                  "%s at %.4f: gain margin (%.4g)", loop->name,
+                                  period_pu, scheduled.gm_dB);
+        }
+
+        CLLC_GVSCHED_CHECK_runSchedule(loop);
+        printf("\n");
+    }
+
+    if(printGains != 0U)
+    {
+        return((CLLC_CHECK_failures == 0U) ? 0 : 1);
+    }
+
+    return(CLLC_CHECK_result());
+}
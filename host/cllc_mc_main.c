@@ -0,0 +1,1132 @@
+//#############################################################################
+//
+// FILE:   cllc_mc_main.c
+//
+// TITLE:  Monte Carlo tolerance runs on the averaged plant
+//         Runs the firmware of the lab selected at build time against the
+//         averaged plant (cllc_plant_fha.h) with the resonant components and
+//         the sensing chain drawn at random within their tolerances, and
+//         measures the response of the regulated bus to a load step. The
+//         firmware keeps the calibration constants of
+//         CLLC_initGlobalVariables, so a sensor gain or offset spread shows
+//         up as it would on a production board.
+//
+//         The firmware state is in globals, so every instance is a process.
+//         The workers are forked once and claim runs from a counter in
+//         shared memory, a worker that is done with its run takes the next
+//         unclaimed one, so runs that trip early or slew long balance out
+//         over the cores. Each run draws its values from a generator seeded
+//         by the seed and the run number only, so a run gives the same result
+//         whichever worker takes it and can be repeated alone with -r.
+//
+//         The workers send one record per run through a pipe, the parent
+//         collects them into row groups of CLLC_MC_ROW_GROUP_ROWS and writes
+//         each group to the result file column by column, so only one group
+//         is held in memory however many runs there are. The summary is
+//         kept in fixed histograms. Result files of several invocations can
+//         be summarised together with -i.
+//
+//         Result file, native byte order:
+//         char     magic[8]        "CLLCMC1"
+//         uint32_t lab
+//         uint32_t columns
+//         columns x { char name[24]; uint32_t type; }  type 'u' or 'f'
+//         then row groups to the end of the file:
+//         uint32_t rows
+//         columns x rows x 4 bytes, column by column
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -include host/cllc_emu_target.h -I. -Icllc -Ihost -Idevice
+//             -Idevice/driverlib -Ilibraries -DCLLC_LAB=<lab>
+//             host/cllc_emu.c host/cllc_emu_firmware.c host/cllc_mc_main.c
+//             host/cllc_plant_fha.c cllc/cllc.c cllc/cllc_hal.c $(DRIVERLIB)
+//             -lm -o cllc_mc_lab<lab>
+//         with DRIVERLIB the driverlib sources listed in host/README.md
+//
+//         Usage:
+//         cllc_mc [-N runs] [-j workers] [-s seed] [-r run] [-f file]
+//                 [-t lr:cr:lm] [-g percent] [-o percent] [-v volts]
+//                 [-L from:to] [-n steps] [-w steps] [-a steps] [-b percent]
+//         cllc_mc -i file [-i file ...]
+//           -N  number of runs (default 1000)
+//           -j  worker processes (default the number of online cores)
+//           -s  seed (default 1)
+//           -r  run this run number only and print its record
+//           -f  result file (default cllc_mc.dat)
+//           -t  resonant inductance, capacitance and magnetizing inductance
+//               tolerance in percent (default 5:5:10)
+//           -g  sensor gain tolerance in percent (default 2)
+//           -o  sensor offset tolerance in percent of full scale
+//               (default 0.5)
+//           -v  primary bus voltage, as for cllc_sweep (default nominal)
+//           -L  load step in percent of rated power (default 50:75)
+//           -n  ISR2 periods to settle before the step (default as
+//               cllc_sweep)
+//           -w  ISR2 periods recorded after the step (default 0.1 s)
+//           -a  ISR2 periods averaged for the levels (default 10 ms)
+//           -b  settling band in percent of the final value (default 1)
+//           -i  summarise existing result files
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "cllc.h"
+#include "cllc_emu.h"
+#include "cllc_plant_fha.h"
+
+#define CLLC_MC_MAGIC                   "CLLCMC1"
+#define CLLC_MC_NAME_LENGTH             24
+#define CLLC_MC_ROW_GROUP_ROWS          4096U
+#define CLLC_MC_MAX_WORKERS             256U
+#define CLLC_MC_MAX_INPUTS              64U
+
+//
+// the summary histograms, values past the range count in the last bin
+//
+#define CLLC_MC_HISTOGRAM_BINS          10000U
+#define CLLC_MC_SETTLING_MS_PER_BIN     ((float64_t)0.1)
+#define CLLC_MC_PERCENT_PER_BIN         ((float64_t)0.01)
+
+//
+// limit flags, set when the true bus quantity passed the trip limit of its
+// comparator in cllc_settings.h at any ISR2 period after the load step,
+// whether or not that protection is enabled in the build. The start up is
+// left out, its inrush is the same for every run.
+//
+#define CLLC_MC_LIMIT_IPRIM             0x1U
+#define CLLC_MC_LIMIT_ISEC              0x2U
+#define CLLC_MC_LIMIT_VSEC              0x4U
+
+//
+// typedefs
+//
+
+//
+// one run, every field is 4 bytes, the columns of the result file are
+// described by CLLC_MC_column
+//
+typedef struct
+{
+    uint32_t run;
+
+    //
+    // drawn values, components as a factor on the nominal value, sensor
+    // gains as a factor and offsets in volts or amps at the sensor
+    //
+    float32_t lr1Factor;
+    float32_t cr1Factor;
+    float32_t lmFactor;
+    float32_t lr2Factor;
+    float32_t cr2Factor;
+    float32_t vPrimGain;
+    float32_t vSecGain;
+    float32_t iPrimGain;
+    float32_t iSecGain;
+    float32_t vPrimOffset;
+    float32_t vSecOffset;
+    float32_t iPrimOffset;
+    float32_t iSecOffset;
+
+    //
+    // response of the regulated bus, the primary for sec to prim and the
+    // secondary for prim to sec
+    //
+    float32_t vBefore_Volts;    // average before the step
+    float32_t vFinal_Volts;     // average at the end of the window
+    float32_t overshoot_pct;    // peak above the final value after the step
+    float32_t undershoot_pct;   // peak below the final value after the step
+    float32_t settling_ms;      // last exit from the band around the final
+    float32_t frequency_kHz;    // switching frequency at the end
+
+    uint32_t limitFlags;        // CLLC_MC_LIMIT_xxx
+    uint32_t tripped;           // PWMs tripped at the end
+} CLLC_MC_Record;
+
+typedef struct
+{
+    char name[CLLC_MC_NAME_LENGTH];
+    uint32_t type;
+    size_t offset;
+} CLLC_MC_Column;
+
+typedef struct
+{
+    float64_t lrTolerance;      // fractions, the draw is uniform in +-
+    float64_t crTolerance;
+    float64_t lmTolerance;
+    float64_t gainTolerance;
+    float64_t offsetTolerance;  // fraction of the sensor full scale
+    float64_t vPrim_Volts;
+    float64_t loadFrom;         // fractions of rated power
+    float64_t loadTo;
+    float64_t band;             // fraction of the final value
+    uint32_t settleSteps;
+    uint32_t windowSteps;
+    uint32_t averageSteps;
+    uint64_t seed;
+} CLLC_MC_Config;
+
+//
+// plant and sensing chain of the instance run by this process
+//
+typedef struct
+{
+    CLLC_PLANT_FHA_Plant plant;
+    CLLC_PLANT_Sense gain;
+    CLLC_PLANT_Sense offset;
+    uint32_t limitFlags;
+} CLLC_MC_Instance;
+
+typedef struct
+{
+    uint64_t runs;
+    uint64_t tripped;
+    uint64_t limit[3];
+    uint64_t settled;           // runs that ended inside the band
+    float64_t sumFinal;
+    float64_t sumFinalSquared;
+    uint32_t settling[CLLC_MC_HISTOGRAM_BINS];
+    uint32_t overshoot[CLLC_MC_HISTOGRAM_BINS];
+    uint32_t undershoot[CLLC_MC_HISTOGRAM_BINS];
+    float32_t maxSettling_ms;
+    float32_t maxOvershoot_pct;
+    float32_t maxUndershoot_pct;
+} CLLC_MC_Summary;
+
+//
+// run counter shared by the workers
+//
+typedef struct
+{
+    uint32_t next;
+} CLLC_MC_Shared;
+
+static const CLLC_MC_Column CLLC_MC_column[] =
+{
+    {"run", 'u', offsetof(CLLC_MC_Record, run)},
+    {"lr1Factor", 'f', offsetof(CLLC_MC_Record, lr1Factor)},
+    {"cr1Factor", 'f', offsetof(CLLC_MC_Record, cr1Factor)},
+    {"lmFactor", 'f', offsetof(CLLC_MC_Record, lmFactor)},
+    {"lr2Factor", 'f', offsetof(CLLC_MC_Record, lr2Factor)},
+    {"cr2Factor", 'f', offsetof(CLLC_MC_Record, cr2Factor)},
+    {"vPrimGain", 'f', offsetof(CLLC_MC_Record, vPrimGain)},
+    {"vSecGain", 'f', offsetof(CLLC_MC_Record, vSecGain)},
+    {"iPrimGain", 'f', offsetof(CLLC_MC_Record, iPrimGain)},
+    {"iSecGain", 'f', offsetof(CLLC_MC_Record, iSecGain)},
+    {"vPrimOffset", 'f', offsetof(CLLC_MC_Record, vPrimOffset)},
+    {"vSecOffset", 'f', offsetof(CLLC_MC_Record, vSecOffset)},
+    {"iPrimOffset", 'f', offsetof(CLLC_MC_Record, iPrimOffset)},
+    {"iSecOffset", 'f', offsetof(CLLC_MC_Record, iSecOffset)},
+    {"vBefore_Volts", 'f', offsetof(CLLC_MC_Record, vBefore_Volts)},
+    {"vFinal_Volts", 'f', offsetof(CLLC_MC_Record, vFinal_Volts)},
+    {"overshoot_pct", 'f', offsetof(CLLC_MC_Record, overshoot_pct)},
+    {"undershoot_pct", 'f', offsetof(CLLC_MC_Record, undershoot_pct)},
+    {"settling_ms", 'f', offsetof(CLLC_MC_Record, settling_ms)},
+    {"frequency_kHz", 'f', offsetof(CLLC_MC_Record, frequency_kHz)},
+    {"limitFlags", 'u', offsetof(CLLC_MC_Record, limitFlags)},
+    {"tripped", 'u', offsetof(CLLC_MC_Record, tripped)},
+};
+
+#define CLLC_MC_COLUMNS (sizeof(CLLC_MC_column) / sizeof(CLLC_MC_column[0]))
+
+static CLLC_MC_Instance CLLC_MC_instance;
+static float32_t *CLLC_MC_window;
+static uint32_t CLLC_MC_group[CLLC_MC_COLUMNS][CLLC_MC_ROW_GROUP_ROWS];
+static uint32_t CLLC_MC_groupRows;
+static CLLC_MC_Summary CLLC_MC_summary;
+
+static double CLLC_MC_now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9));
+}
+
+//
+// splitmix64, one stream per run so the draws do not depend on which
+// worker takes the run
+//
+static uint64_t CLLC_MC_nextRandom(uint64_t *state)
+{
+    uint64_t z;
+
+    *state += 0x9E3779B97F4A7C15ULL;
+    z = *state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return(z ^ (z >> 31));
+}
+
+//
+// uniform in [-1, 1)
+//
+static float64_t CLLC_MC_getUniform(uint64_t *state)
+{
+    return(((float64_t)(CLLC_MC_nextRandom(state) >> 11) *
+            (2.0 / 9007199254740992.0)) - 1.0);
+}
+
+static float64_t CLLC_MC_getLoad_Ohms(float64_t loadFraction)
+{
+    float64_t vOut;
+
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+        vOut = (float64_t)CLLC_VPRIM_NOMINAL_VOLTS;
+    #else
+        vOut = (float64_t)CLLC_VSEC_NOMINAL_VOLTS;
+    #endif
+
+    if(loadFraction <= 0.0)
+    {
+        return(INFINITY);
+    }
+    return((vOut * vOut) / (loadFraction * CLLC_PLANT_RATED_POWER_W));
+}
+
+//
+// CLLC_EMU_SampleHook, the averaged plant with the sensing chain of the
+// instance in front of the ADC
+//
+static void CLLC_MC_sampleHook(void *context)
+{
+    CLLC_MC_Instance *instance = (CLLC_MC_Instance *)context;
+    CLLC_PLANT_FHA_Plant *plant = &instance->plant;
+    CLLC_PLANT_Sense sensed;
+
+    CLLC_PLANT_FHA_run(plant, 1.0 / (float64_t)CLLC_ISR2_FREQUENCY_HZ);
+
+    sensed.vPrim_Volts = (plant->sense.vPrim_Volts * instance->gain.vPrim_Volts)
+                         + instance->offset.vPrim_Volts;
+    sensed.vSec_Volts = (plant->sense.vSec_Volts * instance->gain.vSec_Volts) +
+                        instance->offset.vSec_Volts;
+    sensed.iPrim_Amps = (plant->sense.iPrim_Amps * instance->gain.iPrim_Amps) +
+                        instance->offset.iPrim_Amps;
+    sensed.iSec_Amps = (plant->sense.iSec_Amps * instance->gain.iSec_Amps) +
+                       instance->offset.iSec_Amps;
+
+    CLLC_PLANT_writeADC(&sensed);
+
+    if(plant->sense.iPrim_Amps > CLLC_IPRIM_TRIP_LIMIT_AMPS)
+    {
+        instance->limitFlags |= CLLC_MC_LIMIT_IPRIM;
+    }
+    if(plant->sense.iSec_Amps > CLLC_ISEC_TRIP_LIMIT_AMPS)
+    {
+        instance->limitFlags |= CLLC_MC_LIMIT_ISEC;
+    }
+    if(plant->sense.vSec_Volts > CLLC_VSEC_TRIP_LIMIT_VOLTS)
+    {
+        instance->limitFlags |= CLLC_MC_LIMIT_VSEC;
+    }
+}
+
+static float32_t CLLC_MC_getOutput_Volts(const CLLC_PLANT_FHA_Plant *plant)
+{
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+        return((float32_t)plant->vPrim_Volts);
+    #else
+        return((float32_t)plant->vSec_Volts);
+    #endif
+}
+
+//
+// Draw the tolerances of the run, start the firmware the same way as
+// cllc_sweep does, settle at the first load, step to the second and record
+// the regulated bus over the window
+//
+static void CLLC_MC_runOne(const CLLC_MC_Config *config, uint32_t run,
+                           CLLC_MC_Record *record)
+{
+    CLLC_MC_Instance *instance = &CLLC_MC_instance;
+    CLLC_PLANT_FHA_Plant *plant = &instance->plant;
+    CLLC_PLANT_FHA_Params params;
+    uint32_t settleSteps = config->settleSteps;
+    uint64_t state;
+    float64_t sum, band;
+    float32_t v, peak, dip;
+    uint32_t i, lastOutside;
+
+    memset(record, 0, sizeof(*record));
+    record->run = run;
+
+    state = config->seed ^ ((uint64_t)run * 0xD1B54A32D192ED03ULL);
+
+    record->lr1Factor = (float32_t)(1.0 + (config->lrTolerance *
+                                           CLLC_MC_getUniform(&state)));
+    record->cr1Factor = (float32_t)(1.0 + (config->crTolerance *
+                                           CLLC_MC_getUniform(&state)));
+    record->lmFactor = (float32_t)(1.0 + (config->lmTolerance *
+                                          CLLC_MC_getUniform(&state)));
+    record->lr2Factor = (float32_t)(1.0 + (config->lrTolerance *
+                                           CLLC_MC_getUniform(&state)));
+    record->cr2Factor = (float32_t)(1.0 + (config->crTolerance *
+                                           CLLC_MC_getUniform(&state)));
+    record->vPrimGain = (float32_t)(1.0 + (config->gainTolerance *
+                                           CLLC_MC_getUniform(&state)));
+    record->vSecGain = (float32_t)(1.0 + (config->gainTolerance *
+                                          CLLC_MC_getUniform(&state)));
+    record->iPrimGain = (float32_t)(1.0 + (config->gainTolerance *
+                                           CLLC_MC_getUniform(&state)));
+    record->iSecGain = (float32_t)(1.0 + (config->gainTolerance *
+                                          CLLC_MC_getUniform(&state)));
+    record->vPrimOffset = (float32_t)(config->offsetTolerance *
+                                      CLLC_VPRIM_MAX_SENSE_VOLTS *
+                                      CLLC_MC_getUniform(&state));
+    record->vSecOffset = (float32_t)(config->offsetTolerance *
+                                     CLLC_VSEC_MAX_SENSE_VOLTS *
+                                     CLLC_MC_getUniform(&state));
+    record->iPrimOffset = (float32_t)(config->offsetTolerance *
+                                      CLLC_IPRIM_MAX_SENSE_AMPS *
+                                      CLLC_MC_getUniform(&state));
+    record->iSecOffset = (float32_t)(config->offsetTolerance *
+                                     CLLC_ISEC_MAX_SENSE_AMPS *
+                                     CLLC_MC_getUniform(&state));
+
+    CLLC_EMU_initFirmware();
+
+    CLLC_PLANT_FHA_setDefaultParams(&params);
+    params.lr1_H *= record->lr1Factor;
+    params.cr1_F *= record->cr1Factor;
+    params.lm_H *= record->lmFactor;
+    params.lr2_H *= record->lr2Factor;
+    params.cr2_F *= record->cr2Factor;
+    params.rLoad_Ohms = CLLC_MC_getLoad_Ohms(config->loadFrom);
+
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+        #if CLLC_INCR_BUILD == CLLC_CLOSED_LOOP_BUILD
+            CLLC_vPrimRef_Volts = (float32_t)config->vPrim_Volts;
+        #else
+            params.vSecSource_Volts = config->vPrim_Volts / params.turnsRatio;
+        #endif
+    #else
+        params.vPrimSource_Volts = config->vPrim_Volts;
+    #endif
+
+    CLLC_PLANT_FHA_init(plant, &params);
+    instance->gain.vPrim_Volts = record->vPrimGain;
+    instance->gain.vSec_Volts = record->vSecGain;
+    instance->gain.iPrim_Amps = record->iPrimGain;
+    instance->gain.iSec_Amps = record->iSecGain;
+    instance->offset.vPrim_Volts = record->vPrimOffset;
+    instance->offset.vSec_Volts = record->vSecOffset;
+    instance->offset.iPrim_Amps = record->iPrimOffset;
+    instance->offset.iSec_Amps = record->iSecOffset;
+    CLLC_EMU_setSampleHook(&CLLC_MC_sampleHook, instance);
+
+    CLLC_EMU_startFirmware();
+
+    CLLC_EMU_run(settleSteps / 2U);
+    settleSteps -= settleSteps / 2U;
+    settleSteps += CLLC_EMU_closeLoop();
+
+    CLLC_EMU_run(settleSteps);
+
+    sum = 0.0;
+    for(i = 0; i < config->averageSteps; i++)
+    {
+        CLLC_EMU_step();
+        sum += CLLC_MC_getOutput_Volts(plant);
+    }
+    record->vBefore_Volts = (float32_t)(sum /
+                                        (float64_t)config->averageSteps);
+
+    instance->limitFlags = 0;
+    CLLC_PLANT_FHA_setLoad(plant, CLLC_MC_getLoad_Ohms(config->loadTo));
+
+    for(i = 0; i < config->windowSteps; i++)
+    {
+        CLLC_EMU_step();
+        CLLC_MC_window[i] = CLLC_MC_getOutput_Volts(plant);
+    }
+
+    //
+    // final value over the end of the window, then the excursions and the
+    // last sample outside the band around it
+    //
+    sum = 0.0;
+    for(i = config->windowSteps - config->averageSteps;
+        i < config->windowSteps; i++)
+    {
+        sum += CLLC_MC_window[i];
+    }
+    record->vFinal_Volts = (float32_t)(sum / (float64_t)config->averageSteps);
+
+    band = config->band * fabs(record->vFinal_Volts);
+    peak = 0.0f;
+    dip = 0.0f;
+    lastOutside = 0;
+
+    for(i = 0; i < config->windowSteps; i++)
+    {
+        v = CLLC_MC_window[i] - record->vFinal_Volts;
+
+        if(v > peak)
+        {
+            peak = v;
+        }
+        if(-v > dip)
+        {
+            dip = -v;
+        }
+        if(fabs(v) > band)
+        {
+            lastOutside = i + 1U;
+        }
+    }
+
+    if(fabs(record->vFinal_Volts) > 0.0f)
+    {
+        record->overshoot_pct = (100.0f * peak) / fabsf(record->vFinal_Volts);
+        record->undershoot_pct = (100.0f * dip) / fabsf(record->vFinal_Volts);
+    }
+    record->settling_ms = (float32_t)((1e3 * (float64_t)lastOutside) /
+                                      (float64_t)CLLC_ISR2_FREQUENCY_HZ);
+    record->frequency_kHz = (float32_t)(plant->frequency_Hz * 1e-3);
+    record->limitFlags = instance->limitFlags;
+    record->tripped = plant->tripped;
+}
+
+static void CLLC_MC_addToSummary(CLLC_MC_Summary *summary,
+                                 const CLLC_MC_Record *record,
+                                 float32_t windowEnd_ms)
+{
+    uint32_t bin;
+    uint16_t flag;
+
+    summary->runs++;
+
+    for(flag = 0; flag < 3U; flag++)
+    {
+        if((record->limitFlags & (1U << flag)) != 0U)
+        {
+            summary->limit[flag]++;
+        }
+    }
+
+    if(record->tripped != 0U)
+    {
+        summary->tripped++;
+        return;
+    }
+
+    //
+    // a run still outside the band at the end of its window counts at the
+    // window length, windowEnd_ms is negative when that is not known
+    //
+    if((windowEnd_ms < 0.0f) || (record->settling_ms < windowEnd_ms))
+    {
+        summary->settled++;
+    }
+
+    summary->sumFinal += record->vFinal_Volts;
+    summary->sumFinalSquared += (float64_t)record->vFinal_Volts *
+                                (float64_t)record->vFinal_Volts;
+
+    bin = (uint32_t)(record->settling_ms / CLLC_MC_SETTLING_MS_PER_BIN);
+    summary->settling[(bin < CLLC_MC_HISTOGRAM_BINS) ?
+                      bin : (CLLC_MC_HISTOGRAM_BINS - 1U)]++;
+    bin = (uint32_t)(record->overshoot_pct / CLLC_MC_PERCENT_PER_BIN);
+    summary->overshoot[(bin < CLLC_MC_HISTOGRAM_BINS) ?
+                       bin : (CLLC_MC_HISTOGRAM_BINS - 1U)]++;
+    bin = (uint32_t)(record->undershoot_pct / CLLC_MC_PERCENT_PER_BIN);
+    summary->undershoot[(bin < CLLC_MC_HISTOGRAM_BINS) ?
+                        bin : (CLLC_MC_HISTOGRAM_BINS - 1U)]++;
+
+    summary->maxSettling_ms = fmaxf(summary->maxSettling_ms,
+                                    record->settling_ms);
+    summary->maxOvershoot_pct = fmaxf(summary->maxOvershoot_pct,
+                                      record->overshoot_pct);
+    summary->maxUndershoot_pct = fmaxf(summary->maxUndershoot_pct,
+                                       record->undershoot_pct);
+}
+
+//
+// upper edge of the bin holding the given fraction of the histogram
+//
+static float64_t CLLC_MC_getPercentile(const uint32_t *histogram,
+                                       uint64_t count, float64_t fraction,
+                                       float64_t perBin)
+{
+    uint64_t target = (uint64_t)ceil(fraction * (float64_t)count);
+    uint64_t seen = 0;
+    uint32_t bin;
+
+    for(bin = 0; bin < CLLC_MC_HISTOGRAM_BINS; bin++)
+    {
+        seen += histogram[bin];
+        if((seen >= target) && (seen != 0U))
+        {
+            break;
+        }
+    }
+    return((float64_t)(bin + 1U) * perBin);
+}
+
+static void CLLC_MC_printDistribution(const char *name,
+                                      const uint32_t *histogram,
+                                      uint64_t count, float64_t perBin,
+                                      float32_t max)
+{
+    printf("%-15s p50 %8.2f  p90 %8.2f  p99 %8.2f  max %8.2f\n", name,
+           CLLC_MC_getPercentile(histogram, count, 0.5, perBin),
+           CLLC_MC_getPercentile(histogram, count, 0.9, perBin),
+           CLLC_MC_getPercentile(histogram, count, 0.99, perBin), max);
+}
+
+static void CLLC_MC_printSummary(const CLLC_MC_Summary *summary,
+                                 uint32_t lab)
+{
+    uint64_t good = summary->runs - summary->tripped;
+    float64_t mean = 0.0, sigma = 0.0;
+
+    if(good != 0U)
+    {
+        mean = summary->sumFinal / (float64_t)good;
+        sigma = sqrt(fmax((summary->sumFinalSquared / (float64_t)good) -
+                          (mean * mean), 0.0));
+    }
+
+    printf("lab %lu: %llu runs, %llu tripped, %llu settled\n",
+           (unsigned long)lab, (unsigned long long)summary->runs,
+           (unsigned long long)summary->tripped,
+           (unsigned long long)summary->settled);
+    printf("over limit      iPrim %llu  iSec %llu  vSec %llu\n",
+           (unsigned long long)summary->limit[0],
+           (unsigned long long)summary->limit[1],
+           (unsigned long long)summary->limit[2]);
+
+    if(good == 0U)
+    {
+        return;
+    }
+
+    printf("vFinal_Volts    mean %8.2f  sigma %8.3f\n", mean, sigma);
+    CLLC_MC_printDistribution("settling_ms", summary->settling, good,
+                              CLLC_MC_SETTLING_MS_PER_BIN,
+                              summary->maxSettling_ms);
+    CLLC_MC_printDistribution("overshoot_pct", summary->overshoot, good,
+                              CLLC_MC_PERCENT_PER_BIN,
+                              summary->maxOvershoot_pct);
+    CLLC_MC_printDistribution("undershoot_pct", summary->undershoot, good,
+                              CLLC_MC_PERCENT_PER_BIN,
+                              summary->maxUndershoot_pct);
+}
+
+static int CLLC_MC_writeHeader(FILE *file)
+{
+    char name[CLLC_MC_NAME_LENGTH];
+    char magic[8] = CLLC_MC_MAGIC;
+    uint32_t value;
+    uint32_t column;
+
+    if(fwrite(magic, sizeof(magic), 1, file) != 1U)
+    {
+        return(-1);
+    }
+
+    value = CLLC_LAB;
+    if(fwrite(&value, sizeof(value), 1, file) != 1U)
+    {
+        return(-1);
+    }
+
+    value = CLLC_MC_COLUMNS;
+    if(fwrite(&value, sizeof(value), 1, file) != 1U)
+    {
+        return(-1);
+    }
+
+    for(column = 0; column < CLLC_MC_COLUMNS; column++)
+    {
+        memset(name, 0, sizeof(name));
+        memcpy(name, CLLC_MC_column[column].name,
+               strlen(CLLC_MC_column[column].name));
+        value = CLLC_MC_column[column].type;
+
+        if((fwrite(name, sizeof(name), 1, file) != 1U) ||
+           (fwrite(&value, sizeof(value), 1, file) != 1U))
+        {
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+static int CLLC_MC_writeGroup(FILE *file)
+{
+    uint32_t column;
+
+    if(CLLC_MC_groupRows == 0U)
+    {
+        return(0);
+    }
+
+    if(fwrite(&CLLC_MC_groupRows, sizeof(CLLC_MC_groupRows), 1, file) != 1U)
+    {
+        return(-1);
+    }
+
+    for(column = 0; column < CLLC_MC_COLUMNS; column++)
+    {
+        if(fwrite(CLLC_MC_group[column], sizeof(uint32_t), CLLC_MC_groupRows,
+                  file) != CLLC_MC_groupRows)
+        {
+            return(-1);
+        }
+    }
+
+    CLLC_MC_groupRows = 0;
+    return(0);
+}
+
+static int CLLC_MC_addToGroup(FILE *file, const CLLC_MC_Record *record)
+{
+    uint32_t column;
+
+    for(column = 0; column < CLLC_MC_COLUMNS; column++)
+    {
+        memcpy(&CLLC_MC_group[column][CLLC_MC_groupRows],
+               (const char *)record + CLLC_MC_column[column].offset,
+               sizeof(uint32_t));
+    }
+
+    CLLC_MC_groupRows++;
+
+    if(CLLC_MC_groupRows == CLLC_MC_ROW_GROUP_ROWS)
+    {
+        return(CLLC_MC_writeGroup(file));
+    }
+    return(0);
+}
+
+//
+// Add the runs of a result file to the summary, one row group at a time
+//
+static int CLLC_MC_readFile(const char *path, uint32_t *lab)
+{
+    char name[CLLC_MC_NAME_LENGTH];
+    char magic[8];
+    CLLC_MC_Record record;
+    uint32_t columns, type, rows, row, column;
+    FILE *file;
+    int status = 0;
+
+    file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return(-1);
+    }
+
+    if((fread(magic, sizeof(magic), 1, file) != 1U) ||
+       (memcmp(magic, CLLC_MC_MAGIC, sizeof(magic)) != 0) ||
+       (fread(lab, sizeof(*lab), 1, file) != 1U) ||
+       (fread(&columns, sizeof(columns), 1, file) != 1U) ||
+       (columns != CLLC_MC_COLUMNS))
+    {
+        fprintf(stderr, "%s: not a result file of this runner\n", path);
+        fclose(file);
+        return(-1);
+    }
+
+    for(column = 0; column < CLLC_MC_COLUMNS; column++)
+    {
+        if((fread(name, sizeof(name), 1, file) != 1U) ||
+           (fread(&type, sizeof(type), 1, file) != 1U) ||
+           (strncmp(name, CLLC_MC_column[column].name, sizeof(name)) != 0) ||
+           (type != CLLC_MC_column[column].type))
+        {
+            fprintf(stderr, "%s: column %lu does not match\n", path,
+                    (unsigned long)column);
+            fclose(file);
+            return(-1);
+        }
+    }
+
+    while(fread(&rows, sizeof(rows), 1, file) == 1U)
+    {
+        if((rows == 0U) || (rows > CLLC_MC_ROW_GROUP_ROWS))
+        {
+            status = -1;
+            break;
+        }
+
+        for(column = 0; column < CLLC_MC_COLUMNS; column++)
+        {
+            if(fread(CLLC_MC_group[column], sizeof(uint32_t), rows, file) !=
+               rows)
+            {
+                status = -1;
+                break;
+            }
+        }
+
+        if(status != 0)
+        {
+            break;
+        }
+
+        for(row = 0; row < rows; row++)
+        {
+            for(column = 0; column < CLLC_MC_COLUMNS; column++)
+            {
+                memcpy((char *)&record + CLLC_MC_column[column].offset,
+                       &CLLC_MC_group[column][row], sizeof(uint32_t));
+            }
+            CLLC_MC_addToSummary(&CLLC_MC_summary, &record, -1.0f);
+        }
+    }
+
+    if(status != 0)
+    {
+        fprintf(stderr, "%s: truncated row group\n", path);
+    }
+
+    fclose(file);
+    return(status);
+}
+
+//
+// Claim runs until there are none left, each record goes to the parent in
+// one write, shorter than PIPE_BUF so the records of the workers do not
+// interleave
+//
+static void CLLC_MC_work(const CLLC_MC_Config *config,
+                         CLLC_MC_Shared *shared, uint32_t runs, int fd)
+{
+    CLLC_MC_Record record;
+    uint32_t run;
+
+    for(;;)
+    {
+        run = __atomic_fetch_add(&shared->next, 1U, __ATOMIC_RELAXED);
+        if(run >= runs)
+        {
+            break;
+        }
+
+        CLLC_MC_runOne(config, run, &record);
+
+        if(write(fd, &record, sizeof(record)) != (ssize_t)sizeof(record))
+        {
+            break;
+        }
+    }
+}
+
+static int CLLC_MC_parseTriple(const char *text, float64_t *a,
+                               float64_t *b, float64_t *c)
+{
+    return(sscanf(text, "%lf:%lf:%lf", a, b, c) == 3);
+}
+
+int main(int argc, char *argv[])
+{
+    CLLC_MC_Config config;
+    CLLC_MC_Shared *shared;
+    CLLC_MC_Record record;
+    const char *path = "cllc_mc.dat";
+    const char *input[CLLC_MC_MAX_INPUTS];
+    uint32_t inputs = 0;
+    uint32_t runs = 1000;
+    uint32_t workers;
+    int32_t single = -1;
+    uint32_t lab = 0;
+    uint32_t received = 0;
+    size_t filled = 0;
+    int pipeFd[2];
+    pid_t pid;
+    FILE *file;
+    double start, elapsed;
+    float64_t lr, cr, lm;
+    long online;
+    ssize_t count;
+    uint32_t w;
+    int status = 0;
+    int i;
+
+    memset(&config, 0, sizeof(config));
+    config.lrTolerance = 0.05;
+    config.crTolerance = 0.05;
+    config.lmTolerance = 0.10;
+    config.gainTolerance = 0.02;
+    config.offsetTolerance = 0.005;
+    config.vPrim_Volts = (float64_t)CLLC_VPRIM_NOMINAL_VOLTS;
+    config.loadFrom = 0.5;
+    config.loadTo = 0.75;
+    config.band = 0.01;
+    config.seed = 1;
+    config.settleSteps = (uint32_t)(0.5f * CLLC_ISR2_FREQUENCY_HZ);
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_PRIM_SEC
+        config.settleSteps += (uint32_t)CLLC_CONTROL_PRECHARGE_COUNT;
+    #endif
+    config.windowSteps = (uint32_t)(0.1f * CLLC_ISR2_FREQUENCY_HZ);
+    config.averageSteps = (uint32_t)(0.01f * CLLC_ISR2_FREQUENCY_HZ);
+
+    online = sysconf(_SC_NPROCESSORS_ONLN);
+    workers = (online > 0) ? (uint32_t)online : 1U;
+
+    for(i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "-N") == 0) && ((i + 1) < argc))
+        {
+            runs = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-j") == 0) && ((i + 1) < argc))
+        {
+            workers = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-s") == 0) && ((i + 1) < argc))
+        {
+            config.seed = strtoull(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-r") == 0) && ((i + 1) < argc))
+        {
+            single = (int32_t)strtol(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-f") == 0) && ((i + 1) < argc))
+        {
+            path = argv[++i];
+        }
+        else if((strcmp(argv[i], "-t") == 0) && ((i + 1) < argc) &&
+                CLLC_MC_parseTriple(argv[i + 1], &lr, &cr, &lm))
+        {
+            config.lrTolerance = lr * 0.01;
+            config.crTolerance = cr * 0.01;
+            config.lmTolerance = lm * 0.01;
+            i++;
+        }
+        else if((strcmp(argv[i], "-g") == 0) && ((i + 1) < argc))
+        {
+            config.gainTolerance = strtod(argv[++i], NULL) * 0.01;
+        }
+        else if((strcmp(argv[i], "-o") == 0) && ((i + 1) < argc))
+        {
+            config.offsetTolerance = strtod(argv[++i], NULL) * 0.01;
+        }
+        else if((strcmp(argv[i], "-v") == 0) && ((i + 1) < argc))
+        {
+            config.vPrim_Volts = strtod(argv[++i], NULL);
+        }
+        else if((strcmp(argv[i], "-L") == 0) && ((i + 1) < argc) &&
+                (sscanf(argv[i + 1], "%lf:%lf", &config.loadFrom,
+                        &config.loadTo) == 2))
+        {
+            config.loadFrom *= 0.01;
+            config.loadTo *= 0.01;
+            i++;
+        }
+        else if((strcmp(argv[i], "-n") == 0) && ((i + 1) < argc))
+        {
+            config.settleSteps = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-w") == 0) && ((i + 1) < argc))
+        {
+            config.windowSteps = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-a") == 0) && ((i + 1) < argc))
+        {
+            config.averageSteps = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-b") == 0) && ((i + 1) < argc))
+        {
+            config.band = strtod(argv[++i], NULL) * 0.01;
+        }
+        else if((strcmp(argv[i], "-i") == 0) && ((i + 1) < argc) &&
+                (inputs < CLLC_MC_MAX_INPUTS))
+        {
+            input[inputs++] = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-N runs] [-j workers] [-s seed] "
+                    "[-r run] [-f file] [-t lr:cr:lm] [-g percent] "
+                    "[-o percent] [-v volts] [-L from:to] [-n steps] "
+                    "[-w steps] [-a steps] [-b percent]\n"
+                    "       %s -i file [-i file ...]\n", argv[0], argv[0]);
+            return(1);
+        }
+    }
+
+    //
+    // summary of existing result files
+    //
+    if(inputs != 0U)
+    {
+        for(w = 0; w < inputs; w++)
+        {
+            if(CLLC_MC_readFile(input[w], &lab) != 0)
+            {
+                status = 1;
+            }
+        }
+        CLLC_MC_printSummary(&CLLC_MC_summary, lab);
+        return(status);
+    }
+
+    if((config.averageSteps == 0U) ||
+       (config.windowSteps < config.averageSteps) || (workers == 0U) ||
+       (workers > CLLC_MC_MAX_WORKERS))
+    {
+        fprintf(stderr, "the window must hold the average, 1 to %u "
+                "workers\n", CLLC_MC_MAX_WORKERS);
+        return(1);
+    }
+
+    CLLC_MC_window = malloc(config.windowSteps * sizeof(float32_t));
+    if(CLLC_MC_window == NULL)
+    {
+        fprintf(stderr, "window of %lu steps does not fit\n",
+                (unsigned long)config.windowSteps);
+        return(1);
+    }
+
+    if(single >= 0)
+    {
+        CLLC_MC_runOne(&config, (uint32_t)single, &record);
+        for(w = 0; w < CLLC_MC_COLUMNS; w++)
+        {
+            uint32_t raw;
+            float32_t value;
+
+            memcpy(&raw, (const char *)&record + CLLC_MC_column[w].offset,
+                   sizeof(raw));
+            memcpy(&value, &raw, sizeof(value));
+
+            if(CLLC_MC_column[w].type == 'u')
+            {
+                printf("%-15s %lu\n", CLLC_MC_column[w].name,
+                       (unsigned long)raw);
+            }
+            else
+            {
+                printf("%-15s %.6g\n", CLLC_MC_column[w].name, value);
+            }
+        }
+        return(0);
+    }
+
+    file = fopen(path, "wb");
+    if((file == NULL) || (CLLC_MC_writeHeader(file) != 0))
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return(1);
+    }
+
+    shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if((shared == MAP_FAILED) || (pipe(pipeFd) != 0))
+    {
+        fprintf(stderr, "no shared counter or pipe: %s\n", strerror(errno));
+        return(1);
+    }
+    shared->next = 0;
+
+    if(workers > runs)
+    {
+        workers = (runs != 0U) ? runs : 1U;
+    }
+
+    start = CLLC_MC_now_s();
+
+    for(w = 0; w < workers; w++)
+    {
+        pid = fork();
+        if(pid < 0)
+        {
+            fprintf(stderr, "fork: %s\n", strerror(errno));
+            break;
+        }
+        if(pid == 0)
+        {
+            //
+            // _exit, the stdio buffers inherited from the parent must not
+            // be flushed a second time
+            //
+            close(pipeFd[0]);
+            CLLC_MC_work(&config, shared, runs, pipeFd[1]);
+            close(pipeFd[1]);
+            _exit(0);
+        }
+    }
+
+    close(pipeFd[1]);
+
+    //
+    // collect until every worker has closed its end
+    //
+    for(;;)
+    {
+        count = read(pipeFd[0], (char *)&record + filled,
+                     sizeof(record) - filled);
+        if(count < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        if(count == 0)
+        {
+            break;
+        }
+
+        filled += (size_t)count;
+        if(filled < sizeof(record))
+        {
+            continue;
+        }
+        filled = 0;
+        received++;
+
+        CLLC_MC_addToSummary(&CLLC_MC_summary, &record,
+                             (float32_t)((1e3 * (float64_t)config.windowSteps)
+                                         / (float64_t)CLLC_ISR2_FREQUENCY_HZ));
+        if(CLLC_MC_addToGroup(file, &record) != 0)
+        {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            status = 1;
+            break;
+        }
+    }
+
+    close(pipeFd[0]);
+    while(wait(NULL) > 0)
+    {
+    }
+
+    if((CLLC_MC_writeGroup(file) != 0) || (fclose(file) != 0))
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        status = 1;
+    }
+
+    elapsed = CLLC_MC_now_s() - start;
+
+    CLLC_MC_printSummary(&CLLC_MC_summary, CLLC_LAB);
+
+    if(received != runs)
+    {
+        fprintf(stderr, "%lu of %lu runs missing\n",
+                (unsigned long)(runs - received), (unsigned long)runs);
+        status = 1;
+    }
+
+    fprintf(stderr, "lab %d: %lu runs on %lu workers in %.2f s, "
+            "%.1f runs/s\n", CLLC_LAB, (unsigned long)received,
+            (unsigned long)workers, elapsed, (double)received / elapsed);
+
+    return(status);
+}
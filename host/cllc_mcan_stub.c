@@ -0,0 +1,167 @@
+//#############################################################################
+//
+// FILE:   cllc_mcan_stub.c
+//
+// TITLE:  Stub of the MCAN for the host build, see cllc_mcan_stub.h
+//
+//#############################################################################
+
+#include <string.h>
+#include "cllc_mcan_stub.h"
+
+static void CLLC_MCAN_STUB_updateRxStatus(CLLC_MCAN_STUB_Model *model,
+                                          uint32_t lost)
+{
+    HWREG(model->base + MCAN_RXF0S) =
+            ((uint32_t)model->rxFill << MCAN_RXF0S_F0FL_SHIFT) |
+            ((uint32_t)model->rxGet << MCAN_RXF0S_F0GI_SHIFT) |
+            ((uint32_t)model->rxPut << MCAN_RXF0S_F0PI_SHIFT) |
+            ((model->rxFill == CLLC_CANLINK_RX_FIFO_SIZE) ?
+                    MCAN_RXF0S_F0F_MASK : 0U) |
+            lost;
+}
+
+void CLLC_MCAN_STUB_init(CLLC_MCAN_STUB_Model *model, uint32_t base)
+{
+    memset(model, 0, sizeof(*model));
+    model->base = base;
+
+    HWREG(base + MCAN_TXBAR) = 0;
+    HWREG(base + MCAN_TXBRP) = 0;
+    HWREG(base + MCAN_TXBTO) = 0;
+    HWREG(base + MCAN_IR) = 0;
+    HWREG(base + MCAN_RXF0A) = CLLC_MCAN_STUB_NO_ACK;
+    CLLC_MCAN_STUB_updateRxStatus(model, 0);
+}
+
+//
+// The acknowledge and the clear of the lost flag written since the last call
+//
+void CLLC_MCAN_STUB_acknowledge(CLLC_MCAN_STUB_Model *model)
+{
+    uint32_t ack = HWREG(model->base + MCAN_RXF0A);
+    uint32_t lost = HWREG(model->base + MCAN_RXF0S) & MCAN_RXF0S_RF0L_MASK;
+    uint16_t freed;
+
+    if(ack != CLLC_MCAN_STUB_NO_ACK)
+    {
+        freed = (uint16_t)(((ack + CLLC_CANLINK_RX_FIFO_SIZE - model->rxGet) %
+                            CLLC_CANLINK_RX_FIFO_SIZE) + 1U);
+        if((ack < CLLC_CANLINK_RX_FIFO_SIZE) && (freed <= model->rxFill))
+        {
+            model->rxFill -= freed;
+            model->rxGet = (uint16_t)((ack + 1U) % CLLC_CANLINK_RX_FIFO_SIZE);
+        }
+        HWREG(model->base + MCAN_RXF0A) = CLLC_MCAN_STUB_NO_ACK;
+    }
+
+    if((HWREG(model->base + MCAN_IR) & MCAN_IR_RF0L_MASK) != 0U)
+    {
+        lost = 0;
+        HWREG(model->base + MCAN_IR) = 0;
+    }
+
+    CLLC_MCAN_STUB_updateRxStatus(model, lost);
+}
+
+//
+// Returns the number of frames that left, at most framesMax
+//
+uint16_t CLLC_MCAN_STUB_transmit(CLLC_MCAN_STUB_Model *model,
+                                 CLLC_MCAN_STUB_Frame *frames,
+                                 uint16_t framesMax)
+{
+    CLLC_MCAN_STUB_Frame *frame;
+    uint32_t pending;
+    uint32_t element;
+    uint32_t t0;
+    uint32_t t1;
+    uint32_t word;
+    uint16_t count = 0;
+    uint16_t buffer;
+    uint16_t i;
+
+    pending = HWREG(model->base + MCAN_TXBRP) |
+              HWREG(model->base + MCAN_TXBAR);
+    HWREG(model->base + MCAN_TXBAR) = 0;
+
+    for(buffer = 0; (buffer < 32U) && (model->txBusy == 0U) &&
+                    (count < framesMax); buffer++)
+    {
+        if((pending & (1UL << buffer)) == 0U)
+        {
+            continue;
+        }
+
+        element = CLLC_CANLINK_getTxElement(model->base, buffer);
+        t0 = HWREG(element);
+        t1 = HWREG(element + 4U);
+
+        frame = &frames[count];
+        frame->xtd = ((t0 & CLLC_CANLINK_XTD) != 0U) ? 1U : 0U;
+        frame->id = (frame->xtd != 0U) ? (t0 & 0x1FFFFFFFUL) :
+                    ((t0 >> CLLC_CANLINK_STD_ID_SHIFT) & 0x7FFUL);
+        frame->fdf = ((t1 & CLLC_CANLINK_FDF) != 0U) ? 1U : 0U;
+        frame->brs = ((t1 & CLLC_CANLINK_BRS) != 0U) ? 1U : 0U;
+        frame->dlc = (uint16_t)((t1 >> CLLC_CANLINK_DLC_SHIFT) & 0xFU);
+        frame->bytes = CLLC_CANLINK_getBytes(frame->dlc);
+        for(i = 0; i < frame->bytes; i++)
+        {
+            word = CLLC_CANLINK_getWord(element, i >> 2);
+            frame->data[i] = (uint8_t)(word >> ((i & 3U) * 8U));
+        }
+
+        pending &= ~(1UL << buffer);
+        HWREG(model->base + MCAN_TXBTO) |= (1UL << buffer);
+        model->txFrames++;
+        count++;
+    }
+
+    HWREG(model->base + MCAN_TXBRP) = pending;
+    return(count);
+}
+
+//
+// Returns 1 when the frame went into the FIFO, 0 when it was dropped
+//
+uint16_t CLLC_MCAN_STUB_receive(CLLC_MCAN_STUB_Model *model,
+                                const CLLC_MCAN_STUB_Frame *frame)
+{
+    uint32_t element;
+    uint32_t word;
+    uint16_t bytes;
+    uint16_t i;
+
+    if(model->rxFill == CLLC_CANLINK_RX_FIFO_SIZE)
+    {
+        model->rxDropped++;
+        CLLC_MCAN_STUB_updateRxStatus(model, MCAN_RXF0S_RF0L_MASK);
+        return(0);
+    }
+
+    element = CLLC_CANLINK_getRxElement(model->base, model->rxPut);
+    HWREG(element) = (frame->xtd != 0U) ?
+                     ((frame->id & 0x1FFFFFFFUL) | CLLC_CANLINK_XTD) :
+                     ((frame->id & 0x7FFUL) << CLLC_CANLINK_STD_ID_SHIFT);
+    HWREG(element + 4U) = ((uint32_t)(frame->dlc & 0xFU) <<
+                           CLLC_CANLINK_DLC_SHIFT) |
+                          ((frame->fdf != 0U) ? CLLC_CANLINK_FDF : 0U) |
+                          ((frame->brs != 0U) ? CLLC_CANLINK_BRS : 0U);
+
+    bytes = CLLC_CANLINK_getBytes(frame->dlc);
+    for(i = 0; i < bytes; i += 4U)
+    {
+        word = (uint32_t)frame->data[i] |
+               ((uint32_t)frame->data[i + 1U] << 8) |
+               ((uint32_t)frame->data[i + 2U] << 16) |
+               ((uint32_t)frame->data[i + 3U] << 24);
+        CLLC_CANLINK_putWord(element, i >> 2, word);
+    }
+
+    model->rxPut = (uint16_t)((model->rxPut + 1U) % CLLC_CANLINK_RX_FIFO_SIZE);
+    model->rxFill++;
+    model->rxFrames++;
+    CLLC_MCAN_STUB_updateRxStatus(model, HWREG(model->base + MCAN_RXF0S) &
+                                         MCAN_RXF0S_RF0L_MASK);
+    return(1);
+}
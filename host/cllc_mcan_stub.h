@@ -0,0 +1,85 @@
+//#############################################################################
+//
+// FILE:   cllc_mcan_stub.h
+//
+// TITLE:  Stub of the MCAN for the host build of cllc_canlink.h
+//         Keeps the registers and message RAM the service uses in the
+//         emulated register file of cllc_emu_target.h, at the addresses the
+//         firmware takes them at, and acts on them between runs of the
+//         service:
+//
+//         transmit    buffers requested in TXBAR go pending in TXBRP and,
+//                     unless the bus is held busy, leave in buffer order:
+//                     decoded into frames, TXBTO set, TXBRP cleared
+//         receive     a frame goes into the next element of receive FIFO 0
+//                     and RXF0S is brought up to date; with the FIFO full
+//                     it is dropped and RXF0S.RF0L set
+//         acknowledge the index last written to RXF0A frees that element
+//                     and every one before it, a 1 written to IR.RF0L
+//                     clears RXF0S.RF0L
+//
+//         The layout of the message RAM is the one of cllc_canlink.h, the
+//         stub does not read the configuration registers.
+//
+//#############################################################################
+
+#ifndef CLLC_MCAN_STUB_H
+#define CLLC_MCAN_STUB_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "cllc_canlink.h"
+
+//
+// Defines
+//
+#define CLLC_MCAN_STUB_NO_ACK   0xFFFFFFFFUL
+
+//
+// typedefs
+//
+typedef struct
+{
+    uint32_t id;                // 11 or 29 bits
+    uint16_t xtd;
+    uint16_t fdf;
+    uint16_t brs;
+    uint16_t dlc;
+    uint16_t bytes;
+    uint8_t data[64];
+} CLLC_MCAN_STUB_Frame;
+
+typedef struct
+{
+    uint32_t base;
+    uint16_t txBusy;            // while set no frame leaves
+    uint16_t rxGet;
+    uint16_t rxPut;
+    uint16_t rxFill;
+    uint64_t txFrames;
+    uint64_t rxFrames;
+    uint64_t rxDropped;
+} CLLC_MCAN_STUB_Model;
+
+//
+// the function prototypes
+//
+void CLLC_MCAN_STUB_init(CLLC_MCAN_STUB_Model *model, uint32_t base);
+void CLLC_MCAN_STUB_acknowledge(CLLC_MCAN_STUB_Model *model);
+uint16_t CLLC_MCAN_STUB_transmit(CLLC_MCAN_STUB_Model *model,
+                                 CLLC_MCAN_STUB_Frame *frames,
+                                 uint16_t framesMax);
+uint16_t CLLC_MCAN_STUB_receive(CLLC_MCAN_STUB_Model *model,
+                                const CLLC_MCAN_STUB_Frame *frame);
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
@@ -0,0 +1,243 @@
+//#############################################################################
+//
+// FILE:   cllc_oversample_check.c
+//
+// TITLE:  Check of the ADC oversampling of ISEC and VSEC
+//         Runs the firmware in the emulator built to count register
+//         accesses, as CLLC_ADC_OVERSAMPLE was built. Checks the SOC setup,
+//         the first half of the SOCs on TRIG1 and the rest on TRIG2, and
+//         the ADC interrupt on the last SOC. Then writes a different code
+//         into each SOC result of ISEC and VSEC every ISR2 period and checks
+//         that the DMA model copied them all and that ISR2 took their
+//         average, in the order of the SOCs and without a stale burst.
+//         Then stops the DMA halfway through a burst into one half of the
+//         results and checks that ISR2 still takes the other, whole, half.
+//         Reports the register accesses of ISR2, which no longer grow with
+//         the number of SOCs.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -DCLLC_EMU_COUNT_ACCESSES -DCLLC_ADC_OVERSAMPLE=11
+//             -include host/cllc_emu_target.h
+//             -I. -Icllc -Ihost -Idevice -Idevice/driverlib -Ilibraries
+//             host/cllc_emu.c host/cllc_emu_firmware.c
+//             host/cllc_oversample_check.c cllc/cllc.c cllc/cllc_hal.c
+//             $(DRIVERLIB) device/driverlib/dma.c -lm
+//             -o cllc_oversample_check
+//         with DRIVERLIB the driverlib sources listed in host/README.md.
+//
+//         Usage:
+//         cllc_oversample_check [-n steps]
+//           -n  ISR2 periods to check (default 1000)
+//
+//         Exits 0 when all checks pass.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "cllc.h"
+#include "cllc_emu.h"
+#include "cllc_check.h"
+
+#ifndef CLLC_EMU_COUNT_ACCESSES
+#error "build with -DCLLC_EMU_COUNT_ACCESSES"
+#endif
+
+//
+// The SOCs of a signal: the trigger of each and the ADC interrupt source
+//
+static void CLLC_OVERSAMPLE_CHECK_checkSOCs(const char *name, uint32_t base,
+                                            uint16_t firstSOC,
+                                            ADC_Trigger trig1,
+                                            ADC_Trigger trig2)
+{
+    char what[64];
+    uint32_t ctl;
+    uint16_t i, trigger;
+
+    for(i = 0; i < CLLC_ADC_OVERSAMPLE; i++)
+    {
+        ctl = HWREG(base + ADC_SOCxCTL_OFFSET_BASE +
+                    ((uint32_t)(firstSOC + i) * 2U));
+        trigger = (uint16_t)((ctl & ADC_SOC0CTL_TRIGSEL_M) >>
+                             ADC_SOC0CTL_TRIGSEL_S);
+        snprintf(what, sizeof(what), "%s SOC%u trigger", name,
+                 (unsigned)(firstSOC + i));
+        CLLC_CHECK_expect(what, trigger,
+                          (i < (CLLC_ADC_OVERSAMPLE + 1U) / 2U) ?
+                          (unsigned long)trig1 :
+                          (unsigned long)trig2);
+    }
+
+#if CLLC_ADC_OVERSAMPLE > 1
+    snprintf(what, sizeof(what), "%s ADC interrupt source", name);
+    CLLC_CHECK_expect(what, HWREGH(base + ADC_O_INTSEL3N4) &
+                            ADC_INTSEL3N4_INT3SEL_M,
+                      firstSOC + CLLC_ADC_OVERSAMPLE - 1U);
+#endif
+}
+
+//
+// A different code in each SOC result, changing every step, returns the sum
+//
+static uint32_t CLLC_OVERSAMPLE_CHECK_writeCodes(uint32_t resultBase,
+                                                 uint16_t firstSOC,
+                                                 uint32_t step,
+                                                 uint16_t offset)
+{
+    uint32_t sum = 0;
+    uint16_t i, code;
+
+    for(i = 0; i < CLLC_ADC_OVERSAMPLE; i++)
+    {
+        code = (uint16_t)((offset + step * 7U + i * 131U) % 4096U);
+        CLLC_EMU_setADCResult(resultBase, firstSOC + i, code);
+        sum += code;
+    }
+
+    return(sum);
+}
+
+#if CLLC_ADC_OVERSAMPLE > 1
+//
+// The DMA halfway through the burst after the last one: the first half of
+// the new codes in the half it writes and the active destination address
+// in the middle of it
+//
+static void CLLC_OVERSAMPLE_CHECK_interruptBurst(uint32_t dmaBase,
+                                                 volatile uint16_t *result)
+{
+    uint32_t written = HWREG(dmaBase + DMA_O_DST_ADDR_ACTIVE) -
+                       (uint32_t)(uintptr_t)result;
+    uint32_t next = (written == CLLC_ADC_OVERSAMPLE) ?
+                    CLLC_ADC_OVERSAMPLE : 0U;
+    uint16_t i;
+
+    for(i = 0; i < CLLC_ADC_OVERSAMPLE / 2U; i++)
+    {
+        result[next + i] = 4095U - result[next + i];
+    }
+
+    //
+    // the DMA addresses count words, the host pointers count bytes
+    //
+    HWREG(dmaBase + DMA_O_DST_ADDR_ACTIVE) = (uint32_t)(uintptr_t)result +
+                                             next +
+                                             (CLLC_ADC_OVERSAMPLE / 2U);
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    const CLLC_EMU_AccessStats *a = &CLLC_EMU_accesses[CLLC_EMU_ISR2];
+    uint32_t steps = 1000;
+    uint32_t step;
+    uint32_t iSecSum = 0;
+    uint32_t vSecSum = 0;
+    uint32_t bursts;
+    int arg;
+
+    for(arg = 1; arg < argc; arg++)
+    {
+        if((strcmp(argv[arg], "-n") == 0) && (arg + 1 < argc))
+        {
+            steps = (uint32_t)strtoul(argv[++arg], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n steps]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    printf("lab %d, %ux oversampling\n", CLLC_LAB,
+           (unsigned)CLLC_ADC_OVERSAMPLE);
+
+    CLLC_EMU_initFirmware();
+
+    CLLC_OVERSAMPLE_CHECK_checkSOCs("ISEC", CLLC_ISEC_ADC_MODULE,
+                                    CLLC_ISEC_ADC_SOC_NO_1,
+                                    CLLC_ISEC_ADC_TRIG_SOURCE_1,
+                                    CLLC_ISEC_ADC_TRIG_SOURCE_2);
+    CLLC_OVERSAMPLE_CHECK_checkSOCs("VSEC", CLLC_VSEC_ADC_MODULE,
+                                    CLLC_VSEC_ADC_SOC_NO_1,
+                                    CLLC_VSEC_ADC_TRIG_SOURCE_1,
+                                    CLLC_VSEC_ADC_TRIG_SOURCE_2);
+
+    CLLC_EMU_startFirmware();
+    memset(CLLC_EMU_accesses, 0, sizeof(CLLC_EMU_accesses));
+    bursts = CLLC_EMU_stats.dmaBurstCount;
+
+    for(step = 0; step < steps; step++)
+    {
+        iSecSum = CLLC_OVERSAMPLE_CHECK_writeCodes(CLLC_ISEC_ADCRESULTREGBASE,
+                                                   CLLC_ISEC_ADC_SOC_NO_1,
+                                                   step, 100U);
+        vSecSum = CLLC_OVERSAMPLE_CHECK_writeCodes(CLLC_VSEC_ADCRESULTREGBASE,
+                                                   CLLC_VSEC_ADC_SOC_NO_1,
+                                                   step, 2000U);
+        CLLC_EMU_step();
+
+        //
+        // the same expression as ISR2 on the sum of the codes written in
+        // this period, a stale or partial copy would not match
+        //
+        CLLC_CHECK_expectNear("ISEC", CLLC_iSecSensed_pu,
+                              (float32_t)iSecSum *
+                              CLLC_ISEC_SENSE_PU_SCALE_FACTOR, 0.0);
+        CLLC_CHECK_expectNear("VSEC", CLLC_vSecSensed_pu,
+                              (float32_t)vSecSum *
+                              CLLC_VSEC_SENSE_PU_SCALE_FACTOR, 0.0);
+        if(CLLC_CHECK_failures > 10U)
+        {
+            break;
+        }
+    }
+
+    //
+    // the average within a code of the mean of the codes
+    //
+    CLLC_CHECK_expect("ISEC average",
+                      fabsf(CLLC_iSecSensed_pu /
+                            CLLC_ADC_PU_SCALE_FACTOR -
+                            (float32_t)iSecSum /
+                            (float32_t)CLLC_ADC_OVERSAMPLE) < 0.01f,
+                      1);
+
+#if CLLC_ADC_OVERSAMPLE > 1
+    CLLC_CHECK_expect("DMA bursts",
+                      CLLC_EMU_stats.dmaBurstCount - bursts,
+                      2U * steps);
+#else
+    CLLC_CHECK_expect("DMA bursts",
+                      CLLC_EMU_stats.dmaBurstCount - bursts, 0);
+#endif
+    CLLC_CHECK_expect("DMA faults", CLLC_EMU_stats.dmaFaultCount,
+                      0);
+
+    printf("ISR2 register accesses: mean %.1f, max %lu over %lu runs\n",
+           (a->runs != 0U) ? (double)a->total / (double)a->runs : 0.0,
+           (unsigned long)a->max, (unsigned long)a->runs);
+
+#if CLLC_ADC_OVERSAMPLE > 1
+    //
+    // ISR2 during a burst takes the half written last, the same sums again
+    //
+    CLLC_OVERSAMPLE_CHECK_interruptBurst(CLLC_ISEC_OVERSAMPLE_DMA_BASE,
+                                         CLLC_HAL_iSecOversample);
+    CLLC_OVERSAMPLE_CHECK_interruptBurst(CLLC_VSEC_OVERSAMPLE_DMA_BASE,
+                                         CLLC_HAL_vSecOversample);
+    CLLC_EMU_dispatch(CLLC_ISR2_TRIG, CLLC_EMU_ISR2);
+    CLLC_CHECK_expectNear("ISEC during a burst", CLLC_iSecSensed_pu,
+                          (float32_t)iSecSum *
+                          CLLC_ISEC_SENSE_PU_SCALE_FACTOR, 0.0);
+    CLLC_CHECK_expectNear("VSEC during a burst", CLLC_vSecSensed_pu,
+                          (float32_t)vSecSum *
+                          CLLC_VSEC_SENSE_PU_SCALE_FACTOR, 0.0);
+#endif
+
+    return(CLLC_CHECK_result());
+}
@@ -0,0 +1,360 @@
+//#############################################################################
+//
+// FILE:   cllc_phase_bench.c
+//
+// TITLE:  Check and cost of the interleaved phases
+//         Runs the firmware built with CLLC_PHASES 2 in the emulator built
+//         to count register accesses. Checks the setup of phase 1 and that
+//         an update of ISR2 writes its compares and TBPHS, at half the
+//         period of phase 0. Then checks the sharing of cllc_phase.h on 2
+//         to 8 phases of a model whose gains differ by up to 20%, and the
+//         tick calculation of a phase against that of phase 0.
+//
+//         Last it runs the work ISR2 does per phase, the ISEC read, the
+//         sharing, the ticks and the register writes, on 1 to 8 instances.
+//         The F28003x has PWMs for 2 phases, above that the instances reuse
+//         the PWMs of the two, the emulator counts the accesses the same. The
+//         accesses of N phases have to be N times those of one, and the
+//         host time per phase is reported next to them.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -DCLLC_EMU_COUNT_ACCESSES -DCLLC_PHASES=2
+//             -DCLLC_PWM_UPDATE_MODE=2 -DCLLC_LAB=5
+//             -include host/cllc_emu_target.h
+//             -I. -Icllc -Ihost -Idevice -Idevice/driverlib -Ilibraries
+//             host/cllc_emu.c host/cllc_emu_firmware.c
+//             host/cllc_phase_bench.c cllc/cllc.c cllc/cllc_hal.c
+//             $(DRIVERLIB) -lm -o cllc_phase_bench
+//         with DRIVERLIB the driverlib sources listed in host/README.md.
+//
+//         Usage:
+//         cllc_phase_bench [-t steps]
+//           -t  steps to time per number of phases (default 1000000)
+//
+//         Exits 0 when all checks pass.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "cllc.h"
+#include "cllc_emu.h"
+#include "cllc_check.h"
+
+#ifndef CLLC_EMU_COUNT_ACCESSES
+#error "build with -DCLLC_EMU_COUNT_ACCESSES"
+#endif
+
+#if CLLC_PHASES < 2
+#error "build with -DCLLC_PHASES=2"
+#endif
+
+//
+// Defines
+//
+#define CLLC_PHASE_BENCH_MAX_PHASES     8
+#define CLLC_PHASE_BENCH_SHARE_STEPS    20000
+
+//
+// The PWMs of phase 1 as CLLC_HAL_setupPhasePWM left them
+//
+static void CLLC_PHASE_BENCH_checkSetup(void)
+{
+    const CLLC_PHASE_Instance *phase = &CLLC_phase[1];
+    uint32_t base[4] = {phase->primLeg1Base, phase->primLeg2Base,
+                        phase->secLeg1Base, phase->secLeg2Base};
+    char what[64];
+    uint16_t i;
+
+    CLLC_CHECK_expect("phase 1 PRIM LEG1", phase->primLeg1Base,
+                      EPWM5_BASE);
+    CLLC_CHECK_expect("phase 1 ISEC result", phase->iSecResultBase,
+                      CLLC_PHASE1_ISEC_ADCRESULTREGBASE);
+
+    for(i = 0; i < 4; i++)
+    {
+        snprintf(what, sizeof(what), "phase 1 PWM%u phase load", i + 5U);
+        CLLC_CHECK_expect(what, (HWREGH(base[i] + EPWM_O_TBCTL) &
+                                 EPWM_TBCTL_PHSEN) != 0U, 1);
+
+        snprintf(what, sizeof(what), "phase 1 PWM%u sync in", i + 5U);
+        CLLC_CHECK_expect(what, HWREGH(base[i] + EPWM_O_SYNCINSEL) &
+                                EPWM_SYNCINSEL_SEL_M,
+                          EPWM_SYNC_IN_PULSE_SRC_SYNCOUT_EPWM1);
+
+        snprintf(what, sizeof(what), "phase 1 PWM%u TBPRD link", i + 5U);
+        CLLC_CHECK_expect(what, (HWREG(base[i] + EPWM_O_XLINK) &
+                                 EPWM_XLINK_TBPRDLINK_M) >>
+                                EPWM_XLINK_TBPRDLINK_S,
+                          EPWM_LINK_WITH_EPWM_1);
+
+        snprintf(what, sizeof(what), "phase 1 PWM%u global load", i + 5U);
+        CLLC_CHECK_expect(what, HWREGH(base[i] + EPWM_O_GLDCTL) &
+                                (EPWM_GLDCTL_GLD | EPWM_GLDCTL_OSHTMODE),
+                          EPWM_GLDCTL_GLD | EPWM_GLDCTL_OSHTMODE);
+    }
+
+    CLLC_CHECK_expect("phase 1 PRIM LEG2 CMPA link",
+                      (HWREG(base[1] + EPWM_O_XLINK) &
+                       EPWM_XLINK_CMPALINK_M) >> EPWM_XLINK_CMPALINK_S,
+                      EPWM_LINK_WITH_EPWM_5);
+    CLLC_CHECK_expect("phase 1 SEC LEG2 CMPB link",
+                      (HWREG(base[3] + EPWM_O_XLINK) &
+                       EPWM_XLINK_CMPBLINK_M) >> EPWM_XLINK_CMPBLINK_S,
+                      EPWM_LINK_WITH_EPWM_3);
+}
+
+//
+// Runs ISR2 until it has committed an update, then the registers of phase 1
+// hold the ticks of the instance at half the period of phase 0
+//
+static void CLLC_PHASE_BENCH_checkUpdate(void)
+{
+    const CLLC_PHASE_Instance *phase = &CLLC_phase[1];
+    uint32_t step;
+    uint32_t loads = CLLC_EMU_pwmUpdate.loadCount;
+    uint32_t tbprd;
+
+    CLLC_EMU_startFirmware();
+    for(step = 0; (step < 2000U) &&
+                  (CLLC_EMU_pwmUpdate.loadCount == loads); step++)
+    {
+        CLLC_EMU_step();
+    }
+    CLLC_CHECK_expect("an update", CLLC_EMU_pwmUpdate.loadCount != loads,
+                      1);
+
+    tbprd = CLLC_pwmPeriod_ticks >> 16;
+    CLLC_CHECK_expect("phase 1 CMPA", HWREG(phase->primLeg1Base +
+                                            HRPWM_O_CMPA),
+                      phase->dutyAPrim_ticks);
+    CLLC_CHECK_expect("phase 1 CMPB", HWREG(phase->primLeg1Base +
+                                            HRPWM_O_CMPB),
+                      phase->dutyBPrim_ticks);
+    CLLC_CHECK_expect("phase 1 PRIM LEG2 TBPHS",
+                      HWREG(phase->primLeg2Base + EPWM_O_TBPHS) >> 16,
+                      tbprd / 2U);
+    CLLC_CHECK_expect("phase 1 SEC LEG2 TBPHS",
+                      HWREG(phase->secLeg2Base + EPWM_O_TBPHS),
+                      phase->primPhase_ticks +
+                      (uint32_t)CLLC_pwmPhaseShiftPrimSec_ticks);
+}
+
+//
+// Gain of phase i of the model, the current of a phase falls with its trim
+//
+static float32_t CLLC_PHASE_BENCH_gain(uint16_t i, uint16_t phases)
+{
+    return(0.9f + 0.2f * (float32_t)i /
+                         (float32_t)((phases > 1U) ? (phases - 1U) : 1U));
+}
+
+static void CLLC_PHASE_BENCH_checkSharing(uint16_t phases)
+{
+    CLLC_PHASE_Instance phase[CLLC_PHASE_BENCH_MAX_PHASES];
+    float32_t mean_pu, spread_pu, spreadUntrimmed_pu, trimMin_pu;
+    char what[64];
+    uint32_t step;
+    uint16_t i;
+
+    memset(phase, 0, sizeof(phase));
+    for(step = 0; step <= CLLC_PHASE_BENCH_SHARE_STEPS; step++)
+    {
+        mean_pu = 0.0f;
+        for(i = 0; i < phases; i++)
+        {
+            phase[i].iSecSensed_pu = 0.8f / (float32_t)phases *
+                                     CLLC_PHASE_BENCH_gain(i, phases) *
+                                     (1.0f - 2.0f * phase[i].dutyTrim_pu);
+            mean_pu += phase[i].iSecSensed_pu / (float32_t)phases;
+        }
+        if(step < CLLC_PHASE_BENCH_SHARE_STEPS)
+        {
+            CLLC_PHASE_share(phase, phases, 1.0f / (float32_t)phases,
+                             CLLC_PHASE_SHARE_KI, CLLC_PHASE_TRIM_MAX_PU);
+        }
+    }
+
+    spread_pu = 0.0f;
+    spreadUntrimmed_pu = 0.0f;
+    trimMin_pu = CLLC_PHASE_TRIM_MAX_PU;
+    for(i = 0; i < phases; i++)
+    {
+        spread_pu = fmaxf(spread_pu, fabsf(phase[i].iSecSensed_pu - mean_pu));
+        spreadUntrimmed_pu = fmaxf(spreadUntrimmed_pu,
+                                   fabsf(CLLC_PHASE_BENCH_gain(i, phases) -
+                                         1.0f));
+        trimMin_pu = fminf(trimMin_pu, phase[i].dutyTrim_pu);
+    }
+
+    printf("%u phases: current spread %.2f%% of the mean, untrimmed %.0f%%\n",
+           phases, (double)(spread_pu / mean_pu * 100.0f),
+           (double)(spreadUntrimmed_pu * 100.0f));
+
+    snprintf(what, sizeof(what), "%u phases shared within 1%%", phases);
+    CLLC_CHECK_expect(what, spread_pu < 0.01f * mean_pu, 1);
+    snprintf(what, sizeof(what), "%u phases, least trim 0", phases);
+    CLLC_CHECK_expect(what, trimMin_pu == 0.0f, 1);
+}
+
+//
+// An untrimmed phase has the duty ticks of phase 0, the interleave is a
+// whole count of TBPRD * index / phases
+//
+static void CLLC_PHASE_BENCH_checkTicks(void)
+{
+    CLLC_PHASE_Instance phase[CLLC_PHASE_BENCH_MAX_PHASES];
+    float32_t period_pu;
+    uint32_t tbprd;
+    uint16_t phases, i;
+    char what[64];
+
+    CLLC_phase[0].dutyTrim_pu = 0.0f;
+    for(period_pu = CLLC_pwmPeriodMin_pu; period_pu <= 1.0f;
+        period_pu += 0.01f)
+    {
+        CLLC_pwmPeriodSlewed_pu = period_pu;
+        CLLC_calculatePWMDutyPeriodPhaseShiftTicks_primToSecPowerFlow();
+        tbprd = CLLC_pwmPeriod_ticks >> 16;
+
+        for(phases = 2; phases <= CLLC_PHASE_BENCH_MAX_PHASES; phases++)
+        {
+            for(i = 0; i < phases; i++)
+            {
+                CLLC_PHASE_init(&phase[i], i, phases, 0, 0, 0, 0, 0, 0);
+            }
+            CLLC_PHASE_calculateTicks(phase, phases, CLLC_pwmPeriod_ticks,
+                                      CLLC_pwmDutyAPrimFactor,
+                                      (uint32_t)CLLC_pwmPhaseShiftPrimSec_ticks);
+
+            for(i = 0; i < phases; i++)
+            {
+                snprintf(what, sizeof(what), "CMPA of %u/%u at %.2f pu", i,
+                         phases, (double)period_pu);
+                CLLC_CHECK_expect(what, phase[i].dutyAPrim_ticks,
+                                  CLLC_pwmDutyAPrim_ticks);
+                snprintf(what, sizeof(what), "interleave of %u/%u at %.2f pu",
+                         i, phases, (double)period_pu);
+                CLLC_CHECK_expect(what, phase[i].primPhase_ticks >> 16,
+                                  (unsigned long)floor((double)tbprd *
+                                                       i / phases));
+                if(CLLC_CHECK_failures > 10U)
+                {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+//
+// The work of ISR2 on the phases after phase 0, for phases instances
+//
+static void CLLC_PHASE_BENCH_run(CLLC_PHASE_Instance *phase, uint16_t phases)
+{
+    uint16_t i;
+
+    for(i = 0; i < phases; i++)
+    {
+        phase[i].iSecSensed_pu = (float32_t)CLLC_HAL_readPhaseISec(&phase[i]) *
+                                 CLLC_ADC_PU_SCALE_FACTOR;
+    }
+    CLLC_PHASE_share(phase, phases, 1.0f / (float32_t)phases,
+                     CLLC_PHASE_SHARE_KI, CLLC_PHASE_TRIM_MAX_PU);
+    CLLC_PHASE_calculateTicks(phase, phases, CLLC_pwmPeriod_ticks,
+                              CLLC_pwmDutyAPrimFactor,
+                              (uint32_t)CLLC_pwmPhaseShiftPrimSec_ticks);
+    for(i = 0; i < phases; i++)
+    {
+        CLLC_HAL_updatePhasePWM(&phase[i]);
+    }
+}
+
+static void CLLC_PHASE_BENCH_scaling(uint32_t steps)
+{
+    CLLC_PHASE_Instance phase[CLLC_PHASE_BENCH_MAX_PHASES];
+    uint32_t accessesOne = 0;
+    uint32_t accesses, step;
+    uint16_t phases, i;
+    double ns;
+    clock_t start;
+    char what[64];
+
+    printf("phases  accesses  host ns  ns per phase\n");
+    for(phases = 1; phases <= CLLC_PHASE_BENCH_MAX_PHASES; phases++)
+    {
+        for(i = 0; i < phases; i++)
+        {
+            CLLC_PHASE_init(&phase[i], i, phases,
+                            CLLC_phase[i % 2U].primLeg1Base,
+                            CLLC_phase[i % 2U].primLeg2Base,
+                            CLLC_phase[i % 2U].secLeg1Base,
+                            CLLC_phase[i % 2U].secLeg2Base,
+                            CLLC_phase[i % 2U].iSecResultBase,
+                            CLLC_phase[i % 2U].iSecSOC);
+            CLLC_EMU_setADCResult(phase[i].iSecResultBase, phase[i].iSecSOC,
+                                  (uint16_t)(1000U + 100U * i));
+        }
+
+        CLLC_EMU_accessCount = 0;
+        CLLC_PHASE_BENCH_run(phase, phases);
+        accesses = CLLC_EMU_accessCount;
+        if(phases == 1U)
+        {
+            accessesOne = accesses;
+        }
+        snprintf(what, sizeof(what), "accesses of %u phases", phases);
+        CLLC_CHECK_expect(what, accesses,
+                          (unsigned long)phases * accessesOne);
+
+        start = clock();
+        for(step = 0; step < steps; step++)
+        {
+            CLLC_PHASE_BENCH_run(phase, phases);
+        }
+        ns = ((double)(clock() - start) / (double)CLOCKS_PER_SEC) * 1.0e9 /
+             (double)steps;
+
+        printf("%6u  %8lu  %7.1f  %12.1f\n", phases, (unsigned long)accesses,
+               ns, ns / (double)phases);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t steps = 1000000UL;
+    uint16_t phases;
+    int arg;
+
+    for(arg = 1; arg < argc; arg++)
+    {
+        if((strcmp(argv[arg], "-t") == 0) && (arg + 1 < argc))
+        {
+            steps = (uint32_t)strtoul(argv[++arg], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-t steps]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    printf("lab %d, %u phases\n", CLLC_LAB, (unsigned)CLLC_PHASES);
+
+    CLLC_EMU_initFirmware();
+    CLLC_PHASE_BENCH_checkSetup();
+    CLLC_PHASE_BENCH_checkUpdate();
+
+    for(phases = 2; phases <= CLLC_PHASE_BENCH_MAX_PHASES; phases++)
+    {
+        CLLC_PHASE_BENCH_checkSharing(phases);
+    }
+    CLLC_PHASE_BENCH_checkTicks();
+    CLLC_PHASE_BENCH_scaling(steps);
+
+    return(CLLC_CHECK_result());
+}
@@ -0,0 +1,148 @@
+//#############################################################################
+//
+// FILE:   cllc_plant.h
+//
+// TITLE:  Common part of the host plant models
+//         Sensed quantities as seen by the ADC and their conversion into
+//         result register codes at the SOCs used by the CLLC_*_ADCREAD_*
+//         macros in cllc_user_settings.h. Both the switching model
+//         (cllc_plant_sw.h) and the averaged model (cllc_plant_fha.h) go
+//         through here so the firmware sees the same sensing chain.
+//
+//#############################################################################
+
+#ifndef CLLC_PLANT_H
+#define CLLC_PLANT_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include <math.h>
+#include "cllc_hal.h"
+#include "cllc_emu.h"
+
+//
+// Defines
+//
+#define CLLC_PLANT_ADC_FULL_SCALE_CODES ((float32_t)4096.0)
+#define CLLC_PLANT_ADC_MAX_CODE         ((uint16_t)4095)
+
+//
+// Default power stage shared by the plant models, a symmetric tank that
+// resonates at the nominal switching frequency with unity gain at the
+// nominal input and output voltages. Replace with the values of the board
+// under test.
+//
+#define CLLC_PLANT_TURNS_RATIO  ((float64_t)CLLC_VPRIM_NOMINAL_VOLTS /        \
+                                 (float64_t)CLLC_VSEC_NOMINAL_VOLTS)
+#define CLLC_PLANT_LR1_H        ((float64_t)24.0e-6)
+#define CLLC_PLANT_LM_H         ((float64_t)120.0e-6)
+#define CLLC_PLANT_CBUS_F       ((float64_t)100.0e-6)
+#define CLLC_PLANT_RATED_POWER_W ((float64_t)6600.0)
+
+//
+// typedefs
+//
+typedef struct
+{
+    float32_t vPrim_Volts;  // primary bus, VPRIM sense
+    float32_t vSec_Volts;   // secondary bus, VSEC sense
+    float32_t iPrim_Amps;   // primary DC bus current, IPRIM sense
+    float32_t iSec_Amps;    // secondary DC bus current, ISEC sense
+} CLLC_PLANT_Sense;
+
+//
+// Inline functions
+//
+
+//
+// Primary resonant capacitance that puts the series resonance of lr1_H at
+// the nominal switching frequency
+//
+static inline float64_t CLLC_PLANT_getResonantCapacitance(float64_t lr1_H)
+{
+    float64_t omega = 2.0 * M_PI *
+                      (float64_t)CLLC_NOMINAL_PWM_SWITCHING_FREQUENCY_HZ;
+
+    return(1.0 / (omega * omega * lr1_H));
+}
+
+//
+// Scale a sensed value against the full scale of its sense circuit, the
+// sense chains are unipolar so negative values clamp at code 0
+//
+static inline uint16_t CLLC_PLANT_toADCCode(float32_t value,
+                                            float32_t fullScale)
+{
+    float32_t code = value * (CLLC_PLANT_ADC_FULL_SCALE_CODES / fullScale);
+
+    if(code <= 0.0f)
+    {
+        return(0);
+    }
+    if(code >= (float32_t)CLLC_PLANT_ADC_MAX_CODE)
+    {
+        return(CLLC_PLANT_ADC_MAX_CODE);
+    }
+    return((uint16_t)(code + 0.5f));
+}
+
+//
+// Write the sensed values into every SOC result the firmware may read, the
+// oversampling SOCs are only read through the DMA of the oversampled builds
+//
+static inline void CLLC_PLANT_writeADC(const CLLC_PLANT_Sense *sense)
+{
+    uint16_t code;
+
+    code = CLLC_PLANT_toADCCode(sense->vPrim_Volts,
+                                CLLC_VPRIM_MAX_SENSE_VOLTS);
+    #if CLLC_ADC_OVERSAMPLE > 1
+        CLLC_EMU_setADCResultRange(CLLC_VPRIM_ADCRESULTREGBASE,
+                                   CLLC_VPRIM_ADC_SOC_NO_1,
+                                   CLLC_VPRIM_ADC_SOC_NO_4, code);
+    #else
+        CLLC_EMU_setADCResult(CLLC_VPRIM_ADCRESULTREGBASE,
+                              CLLC_VPRIM_ADC_SOC_NO_1, code);
+    #endif
+
+    code = CLLC_PLANT_toADCCode(sense->vSec_Volts,
+                                CLLC_VSEC_MAX_SENSE_VOLTS);
+    #if CLLC_ADC_OVERSAMPLE > 1
+        CLLC_EMU_setADCResultRange(CLLC_VSEC_ADCRESULTREGBASE,
+                                   CLLC_VSEC_ADC_SOC_NO_1,
+                                   CLLC_VSEC_ADC_SOC_NO_11, code);
+    #else
+        CLLC_EMU_setADCResult(CLLC_VSEC_ADCRESULTREGBASE,
+                              CLLC_VSEC_ADC_SOC_NO_1, code);
+    #endif
+    CLLC_EMU_setADCResult(CLLC_VSEC_ADCRESULTREGBASE,
+                          CLLC_VSEC_ADC_SOC_NO_13, code);
+
+    code = CLLC_PLANT_toADCCode(sense->iSec_Amps,
+                                CLLC_ISEC_MAX_SENSE_AMPS);
+    #if CLLC_ADC_OVERSAMPLE > 1
+        CLLC_EMU_setADCResultRange(CLLC_ISEC_ADCRESULTREGBASE,
+                                   CLLC_ISEC_ADC_SOC_NO_1,
+                                   CLLC_ISEC_ADC_SOC_NO_11, code);
+    #else
+        CLLC_EMU_setADCResult(CLLC_ISEC_ADCRESULTREGBASE,
+                              CLLC_ISEC_ADC_SOC_NO_1, code);
+    #endif
+
+    code = CLLC_PLANT_toADCCode(sense->iPrim_Amps,
+                                CLLC_IPRIM_MAX_SENSE_AMPS);
+    CLLC_EMU_setADCResult(CLLC_IPRIM_ADCRESULTREGBASE,
+                          CLLC_IPRIM_ADC_SOC_NO, code);
+}
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
@@ -0,0 +1,321 @@
+//#############################################################################
+//
+// FILE:   cllc_plant_fha.c
+//
+// TITLE:  Averaged CLLC plant model for the host emulator
+//         see cllc_plant_fha.h
+//
+//         Reactances at the switching frequency, primary referred:
+//         X1 = w Lr1 - 1/(w Cr1), Xm = w Lm, X2 = w Lr2' - 1/(w Cr2')
+//         With the primary bridge driving, the tank seen from the secondary
+//         rectifier is a source Vs Xm/(X1 + Xm) behind
+//         Rt + j(X2 + X1 Xm/(X1 + Xm)), X1 and X2 swap for the other power
+//         flow. The rectifier input is a resistive fundamental of amplitude
+//         4/pi Vbus in phase with the tank current, the rectified DC
+//         current is 2/pi of the tank current amplitude.
+//
+//#############################################################################
+
+#include <math.h>
+#include <string.h>
+#include "cllc.h"
+#include "cllc_plant_fha.h"
+
+void CLLC_PLANT_FHA_setDefaultParams(CLLC_PLANT_FHA_Params *params)
+{
+    float64_t n = CLLC_PLANT_TURNS_RATIO;
+
+    params->turnsRatio = n;
+    params->lr1_H = CLLC_PLANT_LR1_H;
+    params->cr1_F = CLLC_PLANT_getResonantCapacitance(params->lr1_H);
+    params->lm_H = CLLC_PLANT_LM_H;
+    params->lr2_H = params->lr1_H / (n * n);
+    params->cr2_F = params->cr1_F * (n * n);
+    params->rTank_Ohms = 0.1;
+    params->cPrim_F = CLLC_PLANT_CBUS_F;
+    params->cSec_F = CLLC_PLANT_CBUS_F;
+    params->vPrimSource_Volts = (float64_t)CLLC_VPRIM_NOMINAL_VOLTS;
+    params->vSecSource_Volts = (float64_t)CLLC_VSEC_NOMINAL_VOLTS;
+    params->rLoad_Ohms = 100.0;
+    params->powerFlow = CLLC_POWER_FLOW;
+}
+
+//
+// Open circuit gain and Thevenin reactance of the tank at the frequency of
+// the new period
+//
+static void CLLC_PLANT_FHA_updateTank(CLLC_PLANT_FHA_Plant *plant)
+{
+    const CLLC_PLANT_FHA_Params *params = &plant->params;
+    float64_t n2 = params->turnsRatio * params->turnsRatio;
+    float64_t omega, xPrim, xSec, xm, xDriven, xPassive, shunt;
+
+    plant->frequency_Hz = (float64_t)CLLC_PWMSYSCLOCK_FREQ_HZ /
+                          (2.0 * ((float64_t)plant->period / 65536.0));
+    omega = 2.0 * M_PI * plant->frequency_Hz;
+
+    xPrim = (omega * params->lr1_H) - (1.0 / (omega * params->cr1_F));
+    xSec = (omega * params->lr2_H * n2) - (n2 / (omega * params->cr2_F));
+    xm = omega * params->lm_H;
+
+    if(params->powerFlow == CLLC_POWER_FLOW_SEC_PRIM)
+    {
+        xDriven = xSec;
+        xPassive = xPrim;
+    }
+    else
+    {
+        xDriven = xPrim;
+        xPassive = xSec;
+    }
+
+    //
+    // the driven tank in parallel with Lm, only resonates with Lm well
+    // below the minimum switching frequency
+    //
+    shunt = xDriven + xm;
+    if(fabs(shunt) < 1.0e-9)
+    {
+        shunt = 1.0e-9;
+    }
+
+    plant->openCircuitGain = fabs(xm / shunt);
+    plant->reactance_Ohms = xPassive + ((xDriven * xm) / shunt);
+}
+
+//
+// |cos(pi/2 ratio)|, the fundamental of the bridge with leg 2 advanced by
+// ratio of a half cycle. Changes every ISR2 during the precharge ramp, so a
+// Taylor series (error below 3e-6) stands in for cos().
+//
+static inline float64_t CLLC_PLANT_FHA_getBridgeGain(float64_t ratio)
+{
+    float64_t x2;
+
+    //
+    // TBPHS does not exceed TBPRD, past a half cycle the legs swap roles
+    //
+    if(ratio > 1.0)
+    {
+        ratio = (ratio < 2.0) ? (2.0 - ratio) : 0.0;
+    }
+
+    x2 = (0.5 * M_PI * ratio) * (0.5 * M_PI * ratio);
+
+    return(fabs(1.0 - ((x2 / 2.0) *
+                       (1.0 - ((x2 / 12.0) *
+                               (1.0 - ((x2 / 30.0) *
+                                       (1.0 - (x2 / 56.0)))))))));
+}
+
+//
+// Pick up PWM register changes made by the last ISRs
+//
+static void CLLC_PLANT_FHA_updatePWM(CLLC_PLANT_FHA_Plant *plant)
+{
+    uint16_t secToPrim = (plant->params.powerFlow ==
+                          CLLC_POWER_FLOW_SEC_PRIM);
+    uint32_t base = secToPrim ? CLLC_SEC_LEG1_PWM_BASE :
+                                CLLC_PRIM_LEG1_PWM_BASE;
+    uint32_t period, phase;
+    uint16_t tripped;
+
+    //
+    // the legs share the period of the master PWM through the links
+    //
+    period = ((uint32_t)HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_TBPRD) <<
+              16) |
+             (HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_TBPRDHR) & 0xFF00U);
+
+    //
+    // leg 2 only takes TBPHS at the sync while the phase load is enabled,
+    // CLLC_precharge disables it once the ramp has finished
+    //
+    phase = plant->phase;
+    if((secToPrim == 0U) &&
+       ((HWREGH(CLLC_PRIM_LEG2_PWM_BASE + EPWM_O_TBCTL) &
+         EPWM_TBCTL_PHSEN) != 0U))
+    {
+        phase = HWREG(CLLC_PRIM_LEG2_PWM_BASE + EPWM_O_TBPHS) & 0xFFFFFF00U;
+    }
+
+    tripped = ((HWREGH(base + EPWM_O_TZFLG) & EPWM_TZFLG_OST) != 0U) ||
+              ((HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_TZFLG) &
+                EPWM_TZFLG_OST) != 0U);
+
+    if((period == plant->period) && (phase == plant->phase) &&
+       (tripped == plant->tripped))
+    {
+        return;
+    }
+
+    if((period != plant->period) && (period != 0U))
+    {
+        plant->period = period;
+        CLLC_PLANT_FHA_updateTank(plant);
+    }
+
+    plant->period = period;
+    plant->phase = phase;
+    plant->tripped = tripped;
+
+    if(tripped || (period == 0U))
+    {
+        plant->bridgeGain = 0.0;
+    }
+    else
+    {
+        //
+        // leg 2 advanced by phase/period of a half cycle on top of the
+        // complementary drive, zero bridge voltage at a full half cycle
+        //
+        plant->bridgeGain = CLLC_PLANT_FHA_getBridgeGain(
+                                    (float64_t)phase / (float64_t)period);
+    }
+}
+
+void CLLC_PLANT_FHA_init(CLLC_PLANT_FHA_Plant *plant,
+                         const CLLC_PLANT_FHA_Params *params)
+{
+    memset(plant, 0, sizeof(*plant));
+    plant->params = *params;
+
+    if(plant->params.powerFlow == CLLC_POWER_FLOW_SEC_PRIM)
+    {
+        plant->vSec_Volts = plant->params.vSecSource_Volts;
+        plant->busCapacitance_F = plant->params.cPrim_F;
+    }
+    else
+    {
+        plant->vPrim_Volts = plant->params.vPrimSource_Volts;
+        plant->busCapacitance_F = plant->params.cSec_F /
+                                  (plant->params.turnsRatio *
+                                   plant->params.turnsRatio);
+    }
+
+    CLLC_PLANT_FHA_setLoad(plant, plant->params.rLoad_Ohms);
+
+    //
+    // force the first update to decode everything
+    //
+    plant->period = 0xFFFFFFFFU;
+    plant->tripped = 1;
+    CLLC_PLANT_FHA_updatePWM(plant);
+}
+
+void CLLC_PLANT_FHA_setLoad(CLLC_PLANT_FHA_Plant *plant,
+                            float64_t rLoad_Ohms)
+{
+    float64_t n = plant->params.turnsRatio;
+
+    plant->params.rLoad_Ohms = rLoad_Ohms;
+    plant->loadConductance_S = 1.0 / rLoad_Ohms;
+
+    if(plant->params.powerFlow != CLLC_POWER_FLOW_SEC_PRIM)
+    {
+        plant->loadConductance_S /= (n * n);
+    }
+}
+
+void CLLC_PLANT_FHA_setSource(CLLC_PLANT_FHA_Plant *plant, float64_t volts)
+{
+    if(plant->params.powerFlow == CLLC_POWER_FLOW_SEC_PRIM)
+    {
+        plant->params.vSecSource_Volts = volts;
+        plant->vSec_Volts = volts;
+    }
+    else
+    {
+        plant->params.vPrimSource_Volts = volts;
+        plant->vPrim_Volts = volts;
+    }
+}
+
+//
+// Advance the plant by duration_s with the PWM registers as they are now.
+// The bus equation is stiff close to resonance, where the tank impedance is
+// only rTank_Ohms, so it is stepped linearly implicit.
+//
+void CLLC_PLANT_FHA_run(CLLC_PLANT_FHA_Plant *plant, float64_t duration_s)
+{
+    const CLLC_PLANT_FHA_Params *params = &plant->params;
+    uint16_t secToPrim = (params->powerFlow == CLLC_POWER_FLOW_SEC_PRIM);
+    float64_t n = params->turnsRatio;
+    float64_t r = params->rTank_Ohms;
+    float64_t x, z2;
+    float64_t vSource, vBus, vOpen, vRect, g = plant->loadConductance_S;
+    float64_t iTank = 0.0, f, pDriven;
+    float64_t slope = 0.0, slopeDen = 1.0;
+
+    CLLC_PLANT_FHA_updatePWM(plant);
+
+    x = plant->reactance_Ohms;
+    z2 = (r * r) + (x * x);
+    vSource = secToPrim ? (n * plant->vSec_Volts) : plant->vPrim_Volts;
+    vBus = secToPrim ? plant->vPrim_Volts : (n * plant->vSec_Volts);
+
+    vOpen = (4.0 / M_PI) * vSource * plant->bridgeGain *
+            plant->openCircuitGain;
+    vRect = (4.0 / M_PI) * vBus;
+
+    if(vOpen > vRect)
+    {
+        //
+        // |vOpen|^2 = (r i + vRect)^2 + (x i)^2
+        //
+        iTank = (sqrt((r * r * vRect * vRect) -
+                      (z2 * ((vRect * vRect) - (vOpen * vOpen)))) -
+                 (r * vRect)) / z2;
+
+        //
+        // d iTank / d vRect = -slope / slopeDen
+        //
+        slope = (r * iTank) + vRect;
+        slopeDen = (z2 * iTank) + (r * vRect);
+    }
+
+    //
+    // C dv = h (f + J dv), J = -(8/pi^2) slope/slopeDen - g, kept as one
+    // division
+    //
+    f = ((2.0 / M_PI) * iTank) - (g * vBus);
+    vBus += (duration_s * f * slopeDen) /
+            (((plant->busCapacitance_F + (duration_s * g)) * slopeDen) +
+             (duration_s * (8.0 / (M_PI * M_PI)) * slope));
+    if(vBus < 0.0)
+    {
+        vBus = 0.0;
+    }
+
+    //
+    // lossless bridges, the tank resistance takes the rest
+    //
+    pDriven = (vBus * (2.0 / M_PI) * iTank) + (0.5 * r * iTank * iTank);
+    plant->iTank_Amps = iTank;
+
+    if(secToPrim)
+    {
+        plant->vPrim_Volts = vBus;
+        plant->sense.iPrim_Amps = (float32_t)(vBus * g);
+        plant->sense.iSec_Amps = (vSource > 0.0) ?
+                                 (float32_t)((pDriven / vSource) * n) : 0.0f;
+    }
+    else
+    {
+        plant->vSec_Volts = vBus / n;
+        plant->sense.iSec_Amps = (float32_t)(vBus * g * n);
+        plant->sense.iPrim_Amps = (vSource > 0.0) ?
+                                  (float32_t)(pDriven / vSource) : 0.0f;
+    }
+
+    plant->sense.vPrim_Volts = (float32_t)plant->vPrim_Volts;
+    plant->sense.vSec_Volts = (float32_t)plant->vSec_Volts;
+}
+
+void CLLC_PLANT_FHA_sampleHook(void *context)
+{
+    CLLC_PLANT_FHA_Plant *plant = (CLLC_PLANT_FHA_Plant *)context;
+
+    CLLC_PLANT_FHA_run(plant, 1.0 / (float64_t)CLLC_ISR2_FREQUENCY_HZ);
+    CLLC_PLANT_writeADC(&plant->sense);
+}
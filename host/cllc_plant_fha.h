@@ -0,0 +1,114 @@
+//#############################################################################
+//
+// FILE:   cllc_plant_fha.h
+//
+// TITLE:  Averaged CLLC plant model for the host emulator
+//         First harmonic approximation of the resonant tank. The tank seen
+//         from the rectifier is reduced to a Thevenin source whose open
+//         circuit gain and reactance depend on the switching frequency
+//         only, the rectifier is the usual FHA equivalent, and the
+//         receiving bus capacitor is integrated once per ISR2 period. The
+//         switching frequency is decoded from the period registers written
+//         from CLLC_pwmPeriodSlewed_pu, the bridge amplitude from the
+//         precharge phase shift and the trip state, so the model follows
+//         the firmware exactly as the switching model does, at a fraction
+//         of the cost.
+//
+//         Valid near and above resonance where the tank current is close
+//         to sinusoidal. Use cllc_plant_sw.h for the switching detail.
+//
+//#############################################################################
+
+#ifndef CLLC_PLANT_FHA_H
+#define CLLC_PLANT_FHA_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "cllc_plant.h"
+
+//
+// typedefs
+//
+typedef struct
+{
+    float64_t lr1_H;            // primary resonant inductance
+    float64_t cr1_F;            // primary resonant capacitance
+    float64_t lm_H;             // magnetizing inductance, primary referred
+    float64_t lr2_H;            // secondary resonant inductance
+    float64_t cr2_F;            // secondary resonant capacitance
+    float64_t turnsRatio;       // Np / Ns
+    float64_t rTank_Ohms;       // tank and switch resistance, primary referred
+    float64_t cPrim_F;          // primary bus capacitance
+    float64_t cSec_F;           // secondary bus capacitance
+    float64_t vPrimSource_Volts;// primary source, prim to sec power flow
+    float64_t vSecSource_Volts; // secondary source, sec to prim power flow
+    float64_t rLoad_Ohms;       // load on the receiving bus, INFINITY = open
+    uint16_t powerFlow;         // CLLC_POWER_FLOW_PRIM_SEC or _SEC_PRIM
+} CLLC_PLANT_FHA_Params;
+
+typedef struct
+{
+    CLLC_PLANT_FHA_Params params;
+
+    //
+    // bus voltages, the receiving bus is a state, the sending bus follows
+    // the source
+    //
+    float64_t vPrim_Volts;
+    float64_t vSec_Volts;
+
+    //
+    // PWM decode, refreshed when the registers change
+    //
+    uint32_t period;            // TBPRD:TBPRDHR
+    uint32_t phase;             // latched TBPHS of leg 2
+    uint16_t tripped;
+    float64_t frequency_Hz;
+
+    //
+    // tank reduced to the receiving side, primary referred: open circuit
+    // gain, Thevenin reactance, and the fundamental amplitude of the drive
+    //
+    float64_t openCircuitGain;
+    float64_t reactance_Ohms;
+    float64_t bridgeGain;
+
+    //
+    // receiving bus, primary referred
+    //
+    float64_t busCapacitance_F;
+    float64_t loadConductance_S;
+
+    float64_t iTank_Amps;       // fundamental amplitude of the tank current
+
+    CLLC_PLANT_Sense sense;
+} CLLC_PLANT_FHA_Plant;
+
+//
+// the function prototypes
+//
+void CLLC_PLANT_FHA_setDefaultParams(CLLC_PLANT_FHA_Params *params);
+void CLLC_PLANT_FHA_init(CLLC_PLANT_FHA_Plant *plant,
+                         const CLLC_PLANT_FHA_Params *params);
+void CLLC_PLANT_FHA_setLoad(CLLC_PLANT_FHA_Plant *plant,
+                            float64_t rLoad_Ohms);
+void CLLC_PLANT_FHA_setSource(CLLC_PLANT_FHA_Plant *plant, float64_t volts);
+void CLLC_PLANT_FHA_run(CLLC_PLANT_FHA_Plant *plant, float64_t duration_s);
+
+//
+// CLLC_EMU_SampleHook, advances the plant by one ISR2 period and refreshes
+// the ADC results, context is the CLLC_PLANT_FHA_Plant
+//
+void CLLC_PLANT_FHA_sampleHook(void *context);
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
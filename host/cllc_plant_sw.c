@@ -0,0 +1,1471 @@
+//#############################################################################
+//
+// FILE:   cllc_plant_sw.c
+//
+// TITLE:  Switching-cycle CLLC plant model for the host emulator
+//         see cllc_plant_sw.h
+//
+//         Tank equations, secondary quantities referred to the primary:
+//         Lr1 di1/dt = vp - vCr1 - vm      Cr1 dvCr1/dt = i1
+//         Lr2 di2/dt = vm - vCr2 - vs      Cr2 dvCr2/dt = i2
+//         vm = Lm d(i1 - i2)/dt
+//         vp, vs are the bridge voltages. The driven bridge follows the PWM
+//         drive table, the passive bridge is a rectifier onto its bus,
+//         synchronous rectification is treated as ideal diode conduction.
+//
+//#############################################################################
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cllc.h"
+#include "cllc_plant_sw.h"
+
+#define CLLC_PLANT_SW_AUGMENTED (CLLC_PLANT_SW_STATES + CLLC_PLANT_SW_INPUTS)
+#define CLLC_PLANT_SW_TAYLOR_ORDER 12
+
+typedef float64_t CLLC_PLANT_SW_Matrix[CLLC_PLANT_SW_AUGMENTED]
+                                      [CLLC_PLANT_SW_AUGMENTED];
+
+#define CLLC_PLANT_SW_I1    0
+#define CLLC_PLANT_SW_VCR1  1
+#define CLLC_PLANT_SW_I2    2
+#define CLLC_PLANT_SW_VCR2  3
+
+//
+// a step taken by the tank, as kept in CLLC_PLANT_SW_Plant.taken: the
+// topology and rectifier sign it was advanced with, whether the rectifier
+// current was cut to zero after it and whether it is one of the fine steps
+// of its substep
+//
+#define CLLC_PLANT_SW_TAKEN_TOPOLOGY_M  0x03U
+#define CLLC_PLANT_SW_TAKEN_NEGATIVE    0x04U
+#define CLLC_PLANT_SW_TAKEN_CUT         0x08U
+#define CLLC_PLANT_SW_TAKEN_FINE        0x10U
+
+void CLLC_PLANT_SW_setDefaultParams(CLLC_PLANT_SW_Params *params)
+{
+    float64_t n = CLLC_PLANT_TURNS_RATIO;
+
+    params->turnsRatio = n;
+    params->lr1_H = CLLC_PLANT_LR1_H;
+    params->cr1_F = CLLC_PLANT_getResonantCapacitance(params->lr1_H);
+    params->lm_H = CLLC_PLANT_LM_H;
+    params->lr2_H = params->lr1_H / (n * n);
+    params->cr2_F = params->cr1_F * (n * n);
+    params->cPrim_F = CLLC_PLANT_CBUS_F;
+    params->cSec_F = CLLC_PLANT_CBUS_F;
+    params->vPrimSource_Volts = (float64_t)CLLC_VPRIM_NOMINAL_VOLTS;
+    params->vSecSource_Volts = (float64_t)CLLC_VSEC_NOMINAL_VOLTS;
+    params->rLoad_Ohms = 100.0;
+    params->powerFlow = CLLC_POWER_FLOW;
+    params->substepsPerPeriod = CLLC_PLANT_SW_DEFAULT_SUBSTEPS;
+    params->detailDivider = CLLC_PLANT_SW_DEFAULT_DETAIL_DIVIDER;
+}
+
+//
+// out = a * b
+//
+static void CLLC_PLANT_SW_multiply(CLLC_PLANT_SW_Matrix a,
+                                   CLLC_PLANT_SW_Matrix b,
+                                   CLLC_PLANT_SW_Matrix out)
+{
+    uint16_t i, j, k;
+
+    for(i = 0; i < CLLC_PLANT_SW_AUGMENTED; i++)
+    {
+        for(j = 0; j < CLLC_PLANT_SW_AUGMENTED; j++)
+        {
+            float64_t sum = 0.0;
+
+            for(k = 0; k < CLLC_PLANT_SW_AUGMENTED; k++)
+            {
+                sum += a[i][k] * b[k][j];
+            }
+            out[i][j] = sum;
+        }
+    }
+}
+
+//
+// m = exp(m), scaling and squaring with a truncated Taylor series
+//
+static void CLLC_PLANT_SW_exponential(CLLC_PLANT_SW_Matrix m)
+{
+    CLLC_PLANT_SW_Matrix result, term, temp;
+    float64_t norm = 0.0;
+    uint16_t squarings = 0;
+    uint16_t i, j, k;
+
+    for(i = 0; i < CLLC_PLANT_SW_AUGMENTED; i++)
+    {
+        float64_t rowSum = 0.0;
+
+        for(j = 0; j < CLLC_PLANT_SW_AUGMENTED; j++)
+        {
+            rowSum += fabs(m[i][j]);
+        }
+        norm = (rowSum > norm) ? rowSum : norm;
+    }
+
+    while(norm > 0.5)
+    {
+        norm *= 0.5;
+        squarings++;
+    }
+
+    for(i = 0; i < CLLC_PLANT_SW_AUGMENTED; i++)
+    {
+        for(j = 0; j < CLLC_PLANT_SW_AUGMENTED; j++)
+        {
+            m[i][j] = ldexp(m[i][j], -(int)squarings);
+            result[i][j] = (i == j) ? 1.0 : 0.0;
+            term[i][j] = result[i][j];
+        }
+    }
+
+    for(k = 1; k <= CLLC_PLANT_SW_TAYLOR_ORDER; k++)
+    {
+        CLLC_PLANT_SW_multiply(term, m, temp);
+
+        for(i = 0; i < CLLC_PLANT_SW_AUGMENTED; i++)
+        {
+            for(j = 0; j < CLLC_PLANT_SW_AUGMENTED; j++)
+            {
+                term[i][j] = temp[i][j] / (float64_t)k;
+                result[i][j] += term[i][j];
+            }
+        }
+    }
+
+    for(k = 0; k < squarings; k++)
+    {
+        CLLC_PLANT_SW_multiply(result, result, temp);
+        memcpy(result, temp, sizeof(result));
+    }
+
+    memcpy(m, result, sizeof(result));
+}
+
+//
+// Continuous time model dx/dt = A x + B u of one topology, u = [vp, vs]
+//
+static void CLLC_PLANT_SW_getModel(const CLLC_PLANT_SW_Params *params,
+                                   uint16_t topology,
+                                   CLLC_PLANT_SW_Matrix m)
+{
+    float64_t n2 = params->turnsRatio * params->turnsRatio;
+    float64_t lr1 = params->lr1_H;
+    float64_t lr2 = params->lr2_H * n2;
+    float64_t lm = params->lm_H;
+    float64_t cr1 = params->cr1_F;
+    float64_t cr2 = params->cr2_F / n2;
+    float64_t det = ((lr1 + lm) * (lr2 + lm)) - (lm * lm);
+
+    memset(m, 0, sizeof(CLLC_PLANT_SW_Matrix));
+
+    switch(topology)
+    {
+        case CLLC_PLANT_SW_CONDUCTING:
+            m[CLLC_PLANT_SW_I1][CLLC_PLANT_SW_VCR1] = -(lr2 + lm) / det;
+            m[CLLC_PLANT_SW_I1][CLLC_PLANT_SW_VCR2] = -lm / det;
+            m[CLLC_PLANT_SW_I1][4] = (lr2 + lm) / det;
+            m[CLLC_PLANT_SW_I1][5] = -lm / det;
+            m[CLLC_PLANT_SW_VCR1][CLLC_PLANT_SW_I1] = 1.0 / cr1;
+            m[CLLC_PLANT_SW_I2][CLLC_PLANT_SW_VCR1] = -lm / det;
+            m[CLLC_PLANT_SW_I2][CLLC_PLANT_SW_VCR2] = -(lr1 + lm) / det;
+            m[CLLC_PLANT_SW_I2][4] = lm / det;
+            m[CLLC_PLANT_SW_I2][5] = -(lr1 + lm) / det;
+            m[CLLC_PLANT_SW_VCR2][CLLC_PLANT_SW_I2] = 1.0 / cr2;
+            break;
+
+        case CLLC_PLANT_SW_SEC_BLOCKING:
+            //
+            // i2 held at zero, the primary sees Lr1 + Lm
+            //
+            m[CLLC_PLANT_SW_I1][CLLC_PLANT_SW_VCR1] = -1.0 / (lr1 + lm);
+            m[CLLC_PLANT_SW_I1][4] = 1.0 / (lr1 + lm);
+            m[CLLC_PLANT_SW_VCR1][CLLC_PLANT_SW_I1] = 1.0 / cr1;
+            break;
+
+        case CLLC_PLANT_SW_PRIM_BLOCKING:
+            //
+            // i1 held at zero, the secondary sees Lr2 + Lm
+            //
+            m[CLLC_PLANT_SW_I2][CLLC_PLANT_SW_VCR2] = -1.0 / (lr2 + lm);
+            m[CLLC_PLANT_SW_I2][5] = -1.0 / (lr2 + lm);
+            m[CLLC_PLANT_SW_VCR2][CLLC_PLANT_SW_I2] = 1.0 / cr2;
+            break;
+    }
+}
+
+//
+// exp([A B; 0 0] h) = [Phi Gamma; 0 I]
+//
+static void CLLC_PLANT_SW_discretizeStep(
+                const CLLC_PLANT_SW_Params *params, float64_t h,
+                float64_t phi[][CLLC_PLANT_SW_STATES][CLLC_PLANT_SW_STATES],
+                float64_t gamma[][CLLC_PLANT_SW_STATES][CLLC_PLANT_SW_INPUTS])
+{
+    CLLC_PLANT_SW_Matrix m;
+    uint16_t topology, i, j;
+
+    for(topology = 0; topology < CLLC_PLANT_SW_TOPOLOGIES; topology++)
+    {
+        CLLC_PLANT_SW_getModel(params, topology, m);
+
+        for(i = 0; i < CLLC_PLANT_SW_STATES; i++)
+        {
+            for(j = 0; j < CLLC_PLANT_SW_AUGMENTED; j++)
+            {
+                m[i][j] *= h;
+            }
+        }
+
+        CLLC_PLANT_SW_exponential(m);
+
+        for(i = 0; i < CLLC_PLANT_SW_STATES; i++)
+        {
+            for(j = 0; j < CLLC_PLANT_SW_STATES; j++)
+            {
+                phi[topology][i][j] = m[i][j];
+            }
+            for(j = 0; j < CLLC_PLANT_SW_INPUTS; j++)
+            {
+                gamma[topology][i][j] = m[i][CLLC_PLANT_SW_STATES + j];
+            }
+        }
+    }
+}
+
+static void CLLC_PLANT_SW_discretize(const CLLC_PLANT_SW_Params *params,
+                                     float64_t h,
+                                     CLLC_PLANT_SW_Discrete *discrete)
+{
+    CLLC_PLANT_SW_discretizeStep(params, h, discrete->phi, discrete->gamma);
+    CLLC_PLANT_SW_discretizeStep(params,
+                                 h / (float64_t)CLLC_PLANT_SW_FINE_STEPS,
+                                 discrete->phiFine, discrete->gammaFine);
+}
+
+//
+// Integral over [0, t) of one leg output, high from rise to fall with
+// linear transitions over the dead band (the node swings during the dead
+// time under ZVS), repeated every period
+//
+static float64_t CLLC_PLANT_SW_legIntegral(float64_t t, float64_t period,
+                                           float64_t rise, float64_t riseTime,
+                                           float64_t fall, float64_t fallTime)
+{
+    float64_t cycles = floor(t / period);
+    float64_t area = (fall - rise) + (0.5 * (fallTime - riseTime));
+    float64_t integral = cycles * area;
+    float64_t tau = t - (cycles * period);
+
+    if(tau <= rise)
+    {
+        return(integral);
+    }
+    if(tau < (rise + riseTime))
+    {
+        return(integral + (((tau - rise) * (tau - rise)) / (2.0 * riseTime)));
+    }
+
+    integral += (0.5 * riseTime);
+
+    if(tau < fall)
+    {
+        return(integral + (tau - rise - riseTime));
+    }
+
+    integral += (fall - rise - riseTime);
+
+    if(tau < (fall + fallTime))
+    {
+        return(integral + (tau - fall) -
+               (((tau - fall) * (tau - fall)) / (2.0 * fallTime)));
+    }
+
+    return(integral + (0.5 * fallTime));
+}
+
+//
+// Average bridge voltage, normalized to the bus, over each substep of one
+// switching period. Leg 1 is high between CMPA up and CMPA down, leg 2 is
+// its complement phase advanced by TBPHS, the bridge is leg1 - leg2.
+//
+static void CLLC_PLANT_SW_buildDrive(CLLC_PLANT_SW_Plant *plant)
+{
+    const CLLC_PLANT_SW_PWMState *pwm = &plant->pwm;
+    uint16_t substeps = plant->params.substepsPerPeriod;
+    float64_t period, compare, phase, rise, riseTime, fall, fallTime, h;
+    float64_t integral;
+    uint16_t k;
+
+    period = 2.0 * ((float64_t)pwm->period / 65536.0);
+    compare = (float64_t)pwm->compare / 65536.0;
+    phase = (float64_t)pwm->phase / 65536.0;
+
+    //
+    // dead band counts run on the half cycle clock
+    //
+    riseTime = 0.5 * (float64_t)pwm->deadBandRED;
+    fallTime = 0.5 * (float64_t)pwm->deadBandFED;
+
+    rise = compare;
+    fall = period - compare;
+
+    if(pwm->tripped || (period <= 0.0) || (fall <= rise))
+    {
+        memset(plant->drive, 0, sizeof(plant->drive));
+        plant->legKey.tripped = 1;
+        return;
+    }
+
+    if(riseTime > (fall - rise))
+    {
+        riseTime = fall - rise;
+    }
+    if(fallTime > (period - fall))
+    {
+        fallTime = period - fall;
+    }
+
+    h = period / (float64_t)substeps;
+
+    //
+    // leg 1 only changes with the period, compare and dead band, during the
+    // precharge ramp only the phase of leg 2 moves
+    //
+    if((pwm->period != plant->legKey.period) ||
+       (pwm->compare != plant->legKey.compare) ||
+       (pwm->deadBandRED != plant->legKey.deadBandRED) ||
+       (pwm->deadBandFED != plant->legKey.deadBandFED) ||
+       (plant->legKey.tripped != 0U))
+    {
+        float64_t previous = 0.0;
+
+        for(k = 0; k < substeps; k++)
+        {
+            float64_t next = CLLC_PLANT_SW_legIntegral(h * (float64_t)(k + 1),
+                                                       period, rise, riseTime,
+                                                       fall, fallTime);
+
+            plant->leg[k] = (next - previous) / h;
+            previous = next;
+        }
+
+        plant->legKey = *pwm;
+    }
+
+    integral = CLLC_PLANT_SW_legIntegral(phase, period, rise, riseTime,
+                                         fall, fallTime);
+
+    for(k = 0; k < substeps; k++)
+    {
+        float64_t next = CLLC_PLANT_SW_legIntegral(phase +
+                                                   (h * (float64_t)(k + 1)),
+                                                   period, rise, riseTime,
+                                                   fall, fallTime);
+
+        plant->drive[k] = plant->leg[k] + ((next - integral) / h) - 1.0;
+        integral = next;
+    }
+}
+
+static void CLLC_PLANT_SW_readPWM(CLLC_PLANT_SW_Plant *plant,
+                                  CLLC_PLANT_SW_PWMState *pwm)
+{
+    uint32_t base;
+
+    base = (plant->params.powerFlow == CLLC_POWER_FLOW_SEC_PRIM) ?
+            CLLC_SEC_LEG1_PWM_BASE : CLLC_PRIM_LEG1_PWM_BASE;
+
+    //
+    // the legs share the period of the master PWM through the links
+    //
+    pwm->period = ((uint32_t)HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_TBPRD)
+                   << 16) |
+                  (HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_TBPRDHR) &
+                   0xFF00U);
+    pwm->compare = HWREG(base + HRPWM_O_CMPA) & 0xFFFFFF00U;
+
+    //
+    // leg 2 only takes TBPHS at the sync while the phase load is enabled,
+    // CLLC_precharge disables it once the ramp has finished
+    //
+    if(plant->params.powerFlow == CLLC_POWER_FLOW_SEC_PRIM)
+    {
+        pwm->phase = 0;
+    }
+    else
+    {
+        if((HWREGH(CLLC_PRIM_LEG2_PWM_BASE + EPWM_O_TBCTL) &
+            EPWM_TBCTL_PHSEN) != 0U)
+        {
+            plant->latchedPhase = HWREG(CLLC_PRIM_LEG2_PWM_BASE +
+                                        EPWM_O_TBPHS) & 0xFFFFFF00U;
+        }
+        pwm->phase = plant->latchedPhase;
+    }
+
+    pwm->deadBandRED = HWREGH(base + EPWM_O_DBRED);
+    pwm->deadBandFED = HWREGH(base + EPWM_O_DBFED);
+    pwm->tripped = ((HWREGH(base + EPWM_O_TZFLG) & EPWM_TZFLG_OST) != 0U) ||
+                   ((HWREGH(CLLC_PRIM_LEG1_PWM_BASE + EPWM_O_TZFLG) &
+                     EPWM_TZFLG_OST) != 0U);
+}
+
+//
+// Pick up PWM register changes made by the last ISRs, rebuild the drive
+// table and select the discretization for the new substep length
+//
+static void CLLC_PLANT_SW_updatePWM(CLLC_PLANT_SW_Plant *plant)
+{
+    CLLC_PLANT_SW_PWMState pwm;
+    CLLC_PLANT_SW_Discrete *entry;
+
+    CLLC_PLANT_SW_readPWM(plant, &pwm);
+
+    if(memcmp(&pwm, &plant->pwm, sizeof(pwm)) == 0)
+    {
+        return;
+    }
+
+    if(pwm.period == 0U)
+    {
+        //
+        // PWM not configured yet
+        //
+        plant->period_s = 0.0;
+        plant->substep_s = 0.0;
+        plant->discrete = NULL;
+    }
+    else if(pwm.period != plant->pwm.period)
+    {
+        plant->period_s = (2.0 * ((float64_t)pwm.period / 65536.0)) /
+                          (float64_t)CLLC_PWMSYSCLOCK_FREQ_HZ;
+        plant->substep_s = plant->period_s /
+                           (float64_t)plant->params.substepsPerPeriod;
+
+        entry = &plant->cache[(pwm.period >> 8) %
+                              CLLC_PLANT_SW_CACHE_SIZE];
+
+        if((entry->valid == 0U) || (entry->key != pwm.period))
+        {
+            CLLC_PLANT_SW_discretize(&plant->params, plant->substep_s,
+                                     entry);
+            entry->key = pwm.period;
+            entry->valid = 1;
+            plant->cacheMisses++;
+        }
+
+        plant->discrete = entry;
+    }
+
+    plant->pwm = pwm;
+    CLLC_PLANT_SW_buildDrive(plant);
+
+    //
+    // the steps kept were taken with the old drive
+    //
+    plant->takenCount = 0;
+}
+
+void CLLC_PLANT_SW_init(CLLC_PLANT_SW_Plant *plant,
+                        const CLLC_PLANT_SW_Params *params)
+{
+    memset(plant, 0, sizeof(*plant));
+    plant->params = *params;
+
+    if((plant->params.substepsPerPeriod == 0U) ||
+       (plant->params.substepsPerPeriod > CLLC_PLANT_SW_MAX_SUBSTEPS))
+    {
+        plant->params.substepsPerPeriod = CLLC_PLANT_SW_DEFAULT_SUBSTEPS;
+    }
+    if(plant->params.detailDivider == 0U)
+    {
+        plant->params.detailDivider = 1;
+    }
+
+    if(plant->params.powerFlow == CLLC_POWER_FLOW_SEC_PRIM)
+    {
+        plant->vSec_Volts = plant->params.vSecSource_Volts;
+        plant->topology = CLLC_PLANT_SW_PRIM_BLOCKING;
+    }
+    else
+    {
+        plant->vPrim_Volts = plant->params.vPrimSource_Volts;
+        plant->topology = CLLC_PLANT_SW_SEC_BLOCKING;
+    }
+
+    //
+    // force the first update to decode everything
+    //
+    plant->pwm.period = 0xFFFFFFFFU;
+    plant->legKey.tripped = 1;
+    CLLC_PLANT_SW_updatePWM(plant);
+}
+
+//
+// the load and the source are part of the period map, the next calls run
+// in substeps until it is built again, the time held so far still runs on
+// the old one
+//
+void CLLC_PLANT_SW_setLoad(CLLC_PLANT_SW_Plant *plant, float64_t rLoad_Ohms)
+{
+    plant->params.rLoad_Ohms = rLoad_Ohms;
+    plant->mapValid = 0;
+    plant->mapBuilt = 0;
+    plant->mapLeft = 0;
+    plant->holdLeft = 0;
+}
+
+void CLLC_PLANT_SW_setSource(CLLC_PLANT_SW_Plant *plant, float64_t volts)
+{
+    if(plant->params.powerFlow == CLLC_POWER_FLOW_SEC_PRIM)
+    {
+        plant->params.vSecSource_Volts = volts;
+        plant->vSec_Volts = volts;
+    }
+    else
+    {
+        plant->params.vPrimSource_Volts = volts;
+        plant->vPrim_Volts = volts;
+    }
+    plant->mapValid = 0;
+    plant->mapBuilt = 0;
+    plant->mapLeft = 0;
+    plant->holdLeft = 0;
+}
+
+//
+// Currents accumulated over the substeps of one run, divided by the
+// substep count they give the averages seen by the sense circuits
+//
+typedef struct
+{
+    float64_t iDriven;      // bridge input current of the driven side
+    float64_t iLoad;        // load current of the receiving bus
+} CLLC_PLANT_SW_Sums;
+
+static inline void CLLC_PLANT_SW_advance(
+                        const float64_t phi[][CLLC_PLANT_SW_STATES],
+                        const float64_t gamma[][CLLC_PLANT_SW_INPUTS],
+                        float64_t *x, float64_t vp, float64_t vs)
+{
+    float64_t x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3];
+    uint16_t i;
+
+    //
+    // summed pairwise to keep the dependency chain from one substep to the
+    // next short
+    //
+    for(i = 0; i < CLLC_PLANT_SW_STATES; i++)
+    {
+        x[i] = (((phi[i][0] * x0) + (phi[i][1] * x1)) +
+                ((phi[i][2] * x2) + (phi[i][3] * x3))) +
+               ((gamma[i][0] * vp) + (gamma[i][1] * vs));
+    }
+}
+
+//
+// One step with the primary bridge driven and the secondary bridge
+// rectifying, returns the rectified current (primary referred) averaged
+// over the step. *event is set when the rectifier commutates inside the
+// step, the caller then repeats the step on the fine grid.
+//
+static inline float64_t CLLC_PLANT_SW_stepPrimToSec(
+                        const CLLC_PLANT_SW_Discrete *discrete,
+                        uint16_t fine, float64_t *x, uint16_t *topology,
+                        float64_t *sign, float64_t vp, float64_t vBus,
+                        float64_t magnetizingRatio, uint16_t *event,
+                        uint8_t *taken)
+{
+    float64_t i2 = x[CLLC_PLANT_SW_I2];
+    float64_t vOpen;
+
+    if(*topology == CLLC_PLANT_SW_SEC_BLOCKING)
+    {
+        //
+        // open circuit voltage at the rectifier with i2 = 0
+        //
+        vOpen = (magnetizingRatio * (vp - x[CLLC_PLANT_SW_VCR1])) -
+                x[CLLC_PLANT_SW_VCR2];
+
+        if(fabs(vOpen) > vBus)
+        {
+            *topology = CLLC_PLANT_SW_CONDUCTING;
+            *sign = (vOpen > 0.0) ? 1.0 : -1.0;
+        }
+    }
+
+    *taken = (uint8_t)(*topology | ((*sign < 0.0) ?
+                                    CLLC_PLANT_SW_TAKEN_NEGATIVE : 0U));
+
+    if(fine)
+    {
+        CLLC_PLANT_SW_advance(discrete->phiFine[*topology],
+                              discrete->gammaFine[*topology], x, vp,
+                              *sign * vBus);
+    }
+    else
+    {
+        CLLC_PLANT_SW_advance(discrete->phi[*topology],
+                              discrete->gamma[*topology], x, vp,
+                              *sign * vBus);
+    }
+
+    if(*topology == CLLC_PLANT_SW_CONDUCTING)
+    {
+        if((x[CLLC_PLANT_SW_I2] * *sign) > 0.0)
+        {
+            return(0.5 * fabs(i2 + x[CLLC_PLANT_SW_I2]));
+        }
+
+        //
+        // current reached zero inside the step, the rectifier turns off
+        //
+        x[CLLC_PLANT_SW_I2] = 0.0;
+        *topology = CLLC_PLANT_SW_SEC_BLOCKING;
+        *event = 1;
+        *taken |= CLLC_PLANT_SW_TAKEN_CUT;
+        return(0.5 * fabs(i2));
+    }
+
+    vOpen = (magnetizingRatio * (vp - x[CLLC_PLANT_SW_VCR1])) -
+            x[CLLC_PLANT_SW_VCR2];
+    *event = (fabs(vOpen) > vBus);
+    return(0.0);
+}
+
+//
+// One step with the secondary bridge driven and the primary bridge
+// rectifying, see CLLC_PLANT_SW_stepPrimToSec
+//
+static inline float64_t CLLC_PLANT_SW_stepSecToPrim(
+                        const CLLC_PLANT_SW_Discrete *discrete,
+                        uint16_t fine, float64_t *x, uint16_t *topology,
+                        float64_t *sign, float64_t vs, float64_t vBus,
+                        float64_t magnetizingRatio, uint16_t *event,
+                        uint8_t *taken)
+{
+    float64_t i1 = x[CLLC_PLANT_SW_I1];
+    float64_t vOpen;
+
+    if(*topology == CLLC_PLANT_SW_PRIM_BLOCKING)
+    {
+        //
+        // open circuit voltage at the primary bridge with i1 = 0
+        //
+        vOpen = x[CLLC_PLANT_SW_VCR1] -
+                (magnetizingRatio * (x[CLLC_PLANT_SW_VCR2] + vs));
+
+        if(fabs(vOpen) > vBus)
+        {
+            *topology = CLLC_PLANT_SW_CONDUCTING;
+            *sign = (vOpen > 0.0) ? -1.0 : 1.0;
+        }
+    }
+
+    *taken = (uint8_t)(*topology | ((*sign < 0.0) ?
+                                    CLLC_PLANT_SW_TAKEN_NEGATIVE : 0U));
+
+    if(fine)
+    {
+        CLLC_PLANT_SW_advance(discrete->phiFine[*topology],
+                              discrete->gammaFine[*topology], x,
+                              -*sign * vBus, vs);
+    }
+    else
+    {
+        CLLC_PLANT_SW_advance(discrete->phi[*topology],
+                              discrete->gamma[*topology], x,
+                              -*sign * vBus, vs);
+    }
+
+    if(*topology == CLLC_PLANT_SW_CONDUCTING)
+    {
+        if((x[CLLC_PLANT_SW_I1] * *sign) > 0.0)
+        {
+            return(0.5 * fabs(i1 + x[CLLC_PLANT_SW_I1]));
+        }
+
+        x[CLLC_PLANT_SW_I1] = 0.0;
+        *topology = CLLC_PLANT_SW_PRIM_BLOCKING;
+        *event = 1;
+        *taken |= CLLC_PLANT_SW_TAKEN_CUT;
+        return(0.5 * fabs(i1));
+    }
+
+    vOpen = x[CLLC_PLANT_SW_VCR1] -
+            (magnetizingRatio * (x[CLLC_PLANT_SW_VCR2] + vs));
+    *event = (fabs(vOpen) > vBus);
+    return(0.0);
+}
+
+//
+// count substeps with the primary bridge driven and the secondary bridge
+// rectifying onto the secondary bus
+//
+static void CLLC_PLANT_SW_runPrimToSec(CLLC_PLANT_SW_Plant *plant,
+                                       uint32_t count,
+                                       CLLC_PLANT_SW_Sums *sums)
+{
+    const CLLC_PLANT_SW_Params *params = &plant->params;
+    const CLLC_PLANT_SW_Discrete *discrete = plant->discrete;
+    const float64_t *drive = plant->drive;
+    float64_t x[CLLC_PLANT_SW_STATES], xStart[CLLC_PLANT_SW_STATES];
+    float64_t n = params->turnsRatio;
+    float64_t vPrim = plant->vPrim_Volts;
+    float64_t vSec = plant->vSec_Volts;
+    float64_t magnetizingRatio = params->lm_H /
+                                 (params->lr1_H + params->lm_H);
+    float64_t busGain = plant->substep_s / params->cSec_F;
+    float64_t loadConductance = 1.0 / params->rLoad_Ohms;
+    float64_t iDriven = 0.0, iLoad = 0.0;
+    uint16_t topology = plant->topology;
+    float64_t sign = (float64_t)plant->rectifierSign;
+    uint16_t substep = plant->substep;
+    uint16_t substeps = params->substepsPerPeriod;
+
+    memcpy(x, plant->x, sizeof(x));
+
+    while(count-- != 0U)
+    {
+        float64_t d = drive[substep];
+        uint8_t *taken = plant->taken[substep];
+        float64_t vp = d * vPrim;
+        float64_t vBus = n * vSec;
+        float64_t i1 = x[CLLC_PLANT_SW_I1];
+        uint16_t topologyStart = topology;
+        float64_t signStart = sign;
+        uint16_t event = 0;
+        float64_t iRect;
+        uint16_t j;
+
+        memcpy(xStart, x, sizeof(x));
+
+        iRect = CLLC_PLANT_SW_stepPrimToSec(discrete, 0, x, &topology, &sign,
+                                            vp, vBus, magnetizingRatio,
+                                            &event, &taken[0]);
+
+        if(event)
+        {
+            //
+            // redo the substep on the fine grid to place the commutation
+            //
+            memcpy(x, xStart, sizeof(x));
+            topology = topologyStart;
+            sign = signStart;
+            iRect = 0.0;
+
+            for(j = 0; j < CLLC_PLANT_SW_FINE_STEPS; j++)
+            {
+                iRect += CLLC_PLANT_SW_stepPrimToSec(discrete, 1, x,
+                                                     &topology, &sign, vp,
+                                                     vBus, magnetizingRatio,
+                                                     &event, &taken[j]);
+                taken[j] |= CLLC_PLANT_SW_TAKEN_FINE;
+            }
+            iRect *= (1.0 / (float64_t)CLLC_PLANT_SW_FINE_STEPS);
+        }
+
+        iDriven += 0.5 * d * (i1 + x[CLLC_PLANT_SW_I1]);
+
+        //
+        // secondary bus, rectified current in, load current out
+        //
+        vSec += busGain * ((n * iRect) - (vSec * loadConductance));
+        iLoad += vSec * loadConductance;
+
+        if(++substep >= substeps)
+        {
+            substep = 0;
+        }
+    }
+
+    memcpy(plant->x, x, sizeof(x));
+    plant->vSec_Volts = vSec;
+    plant->topology = topology;
+    plant->rectifierSign = (int16_t)sign;
+    plant->substep = substep;
+
+    sums->iDriven += iDriven;
+    sums->iLoad += iLoad;
+}
+
+//
+// count substeps with the secondary bridge driven and the primary bridge
+// rectifying onto the primary bus
+//
+static void CLLC_PLANT_SW_runSecToPrim(CLLC_PLANT_SW_Plant *plant,
+                                       uint32_t count,
+                                       CLLC_PLANT_SW_Sums *sums)
+{
+    const CLLC_PLANT_SW_Params *params = &plant->params;
+    const CLLC_PLANT_SW_Discrete *discrete = plant->discrete;
+    const float64_t *drive = plant->drive;
+    float64_t x[CLLC_PLANT_SW_STATES], xStart[CLLC_PLANT_SW_STATES];
+    float64_t n = params->turnsRatio;
+    float64_t vPrim = plant->vPrim_Volts;
+    float64_t vSec = plant->vSec_Volts;
+    float64_t lr2 = params->lr2_H * n * n;
+    float64_t magnetizingRatio = params->lm_H / (lr2 + params->lm_H);
+    float64_t busGain = plant->substep_s / params->cPrim_F;
+    float64_t loadConductance = 1.0 / params->rLoad_Ohms;
+    float64_t iDriven = 0.0, iLoad = 0.0;
+    uint16_t topology = plant->topology;
+    float64_t sign = (float64_t)plant->rectifierSign;
+    uint16_t substep = plant->substep;
+    uint16_t substeps = params->substepsPerPeriod;
+
+    memcpy(x, plant->x, sizeof(x));
+
+    while(count-- != 0U)
+    {
+        float64_t d = drive[substep];
+        uint8_t *taken = plant->taken[substep];
+        float64_t vs = d * n * vSec;
+        float64_t i2 = x[CLLC_PLANT_SW_I2];
+        uint16_t topologyStart = topology;
+        float64_t signStart = sign;
+        uint16_t event = 0;
+        float64_t iRect;
+        uint16_t j;
+
+        memcpy(xStart, x, sizeof(x));
+
+        iRect = CLLC_PLANT_SW_stepSecToPrim(discrete, 0, x, &topology, &sign,
+                                            vs, vPrim, magnetizingRatio,
+                                            &event, &taken[0]);
+
+        if(event)
+        {
+            memcpy(x, xStart, sizeof(x));
+            topology = topologyStart;
+            sign = signStart;
+            iRect = 0.0;
+
+            for(j = 0; j < CLLC_PLANT_SW_FINE_STEPS; j++)
+            {
+                iRect += CLLC_PLANT_SW_stepSecToPrim(discrete, 1, x,
+                                                     &topology, &sign, vs,
+                                                     vPrim, magnetizingRatio,
+                                                     &event, &taken[j]);
+                taken[j] |= CLLC_PLANT_SW_TAKEN_FINE;
+            }
+            iRect *= (1.0 / (float64_t)CLLC_PLANT_SW_FINE_STEPS);
+        }
+
+        iDriven += 0.5 * d * n * (i2 + x[CLLC_PLANT_SW_I2]);
+
+        //
+        // primary bus, rectified current in, load current out
+        //
+        vPrim += busGain * (iRect - (vPrim * loadConductance));
+        iLoad += vPrim * loadConductance;
+
+        if(++substep >= substeps)
+        {
+            substep = 0;
+        }
+    }
+
+    memcpy(plant->x, x, sizeof(x));
+    plant->vPrim_Volts = vPrim;
+    plant->topology = topology;
+    plant->rectifierSign = (int16_t)sign;
+    plant->substep = substep;
+
+    sums->iDriven += iDriven;
+    sums->iLoad += iLoad;
+}
+
+//
+// count substeps in the direction of the power flow, the steps they take
+// are kept by substep
+//
+static void CLLC_PLANT_SW_runSubsteps(CLLC_PLANT_SW_Plant *plant,
+                                      uint32_t count,
+                                      CLLC_PLANT_SW_Sums *sums)
+{
+    if(plant->params.powerFlow == CLLC_POWER_FLOW_SEC_PRIM)
+    {
+        CLLC_PLANT_SW_runSecToPrim(plant, count, sums);
+    }
+    else
+    {
+        CLLC_PLANT_SW_runPrimToSec(plant, count, sums);
+    }
+
+    if(plant->takenCount < plant->params.substepsPerPeriod)
+    {
+        plant->takenCount += count;
+    }
+}
+
+//
+// One step of the period map under construction, rows 0..3 of t are the
+// tank state and t[CLLC_PLANT_SW_MAP_BUS], t[CLLC_PLANT_SW_MAP_ONE] the
+// receiving bus and 1, each as a row over the state the period started
+// from. Same as CLLC_PLANT_SW_advance with the driven bridge at drive and
+// the rectifying bridge at bus times the receiving bus.
+//
+static void CLLC_PLANT_SW_advanceMap(
+                        const float64_t phi[][CLLC_PLANT_SW_STATES],
+                        const float64_t gamma[][CLLC_PLANT_SW_INPUTS],
+                        float64_t t[][CLLC_PLANT_SW_MAP_STATES],
+                        uint16_t drivenInput, float64_t drive, float64_t bus)
+{
+    float64_t next[CLLC_PLANT_SW_STATES][CLLC_PLANT_SW_MAP_STATES];
+    uint16_t i, j, c;
+
+    for(i = 0; i < CLLC_PLANT_SW_STATES; i++)
+    {
+        float64_t driveGain = gamma[i][drivenInput] * drive;
+        float64_t busGain = gamma[i][1U - drivenInput] * bus;
+        float64_t row[CLLC_PLANT_SW_MAP_STATES];
+
+        //
+        // two partial sums halve the chain of dependent adds
+        //
+        for(c = 0; c < CLLC_PLANT_SW_MAP_STATES; c++)
+        {
+            float64_t even = driveGain * t[CLLC_PLANT_SW_MAP_ONE][c];
+            float64_t odd = busGain * t[CLLC_PLANT_SW_MAP_BUS][c];
+
+            for(j = 0; j < CLLC_PLANT_SW_STATES; j += 2U)
+            {
+                even += phi[i][j] * t[j][c];
+                odd += phi[i][j + 1U] * t[j + 1U][c];
+            }
+
+            row[c] = even + odd;
+        }
+
+        memcpy(next[i], row, sizeof(row));
+    }
+
+    memcpy(t, next, sizeof(next));
+}
+
+//
+// out = map z with the map by columns, z is the state with 1 at
+// CLLC_PLANT_SW_MAP_ONE, out the same followed by the two sums, out may
+// be z
+//
+static inline void CLLC_PLANT_SW_applyMap(
+                        const float64_t map[][CLLC_PLANT_SW_MAP_ROWS],
+                        const float64_t *z, float64_t *out)
+{
+    float64_t next[CLLC_PLANT_SW_MAP_ROWS];
+    uint16_t r, c;
+
+    for(r = 0; r < CLLC_PLANT_SW_MAP_ROWS; r++)
+    {
+        float64_t sum = map[0][r] * z[0];
+
+        for(c = 1; c < CLLC_PLANT_SW_MAP_STATES; c++)
+        {
+            sum += map[c][r] * z[c];
+        }
+
+        next[r] = sum;
+    }
+
+    memcpy(out, next, sizeof(next));
+}
+
+//
+// Build the period map from the steps taken by the last period run in
+// substeps, plant->mapTaken, replaying them with the state as rows over
+// the state the period starts from: the bridge topologies, the rectifier
+// signs and the cuts are taken as they came, everything else is linear.
+// The map then does exactly what the substeps did for that period, for a
+// period that starts elsewhere it is right as long as the bridges would
+// take the same steps.
+//
+static void CLLC_PLANT_SW_buildMap(CLLC_PLANT_SW_Plant *plant)
+{
+    const CLLC_PLANT_SW_Params *params = &plant->params;
+    const CLLC_PLANT_SW_Discrete *discrete = plant->discrete;
+    uint16_t secToPrim = (params->powerFlow == CLLC_POWER_FLOW_SEC_PRIM);
+    float64_t n = params->turnsRatio;
+    uint16_t rect = secToPrim ? CLLC_PLANT_SW_I1 : CLLC_PLANT_SW_I2;
+    uint16_t driven = secToPrim ? CLLC_PLANT_SW_I2 : CLLC_PLANT_SW_I1;
+    uint16_t drivenInput = secToPrim ? 1U : 0U;
+    float64_t source = secToPrim ? (n * plant->vSec_Volts) :
+                                   plant->vPrim_Volts;
+    float64_t busInput = secToPrim ? -1.0 : n;
+    float64_t rectGain = secToPrim ? 1.0 : n;
+    float64_t drivenGain = secToPrim ? n : 1.0;
+    float64_t busGain = plant->substep_s /
+                        (secToPrim ? params->cPrim_F : params->cSec_F);
+    float64_t loadConductance = 1.0 / params->rLoad_Ohms;
+    float64_t t[CLLC_PLANT_SW_MAP_STATES][CLLC_PLANT_SW_MAP_STATES];
+    float64_t drivenSum[CLLC_PLANT_SW_MAP_STATES];
+    float64_t loadSum[CLLC_PLANT_SW_MAP_STATES];
+    float64_t drivenStart[CLLC_PLANT_SW_MAP_STATES];
+    float64_t rectStart[CLLC_PLANT_SW_MAP_STATES];
+    float64_t iRect[CLLC_PLANT_SW_MAP_STATES];
+    uint16_t k, j, c, steps;
+    uint8_t taken = 0;
+
+    memset(t, 0, sizeof(t));
+    for(c = 0; c < CLLC_PLANT_SW_MAP_STATES; c++)
+    {
+        t[c][c] = 1.0;
+    }
+    memset(drivenSum, 0, sizeof(drivenSum));
+    memset(loadSum, 0, sizeof(loadSum));
+
+    for(k = 0; k < params->substepsPerPeriod; k++)
+    {
+        float64_t d = plant->drive[k];
+        uint16_t fine = ((plant->mapTaken[k][0] &
+                          CLLC_PLANT_SW_TAKEN_FINE) != 0U);
+        float64_t weight = fine ?
+                           (1.0 / (float64_t)CLLC_PLANT_SW_FINE_STEPS) : 1.0;
+
+        memcpy(drivenStart, t[driven], sizeof(drivenStart));
+        memset(iRect, 0, sizeof(iRect));
+        steps = fine ? CLLC_PLANT_SW_FINE_STEPS : 1U;
+
+        for(j = 0; j < steps; j++)
+        {
+            uint16_t topology;
+            float64_t sign;
+
+            taken = plant->mapTaken[k][j];
+            topology = taken & CLLC_PLANT_SW_TAKEN_TOPOLOGY_M;
+            sign = ((taken & CLLC_PLANT_SW_TAKEN_NEGATIVE) != 0U) ? -1.0 :
+                                                                    1.0;
+
+            memcpy(rectStart, t[rect], sizeof(rectStart));
+            CLLC_PLANT_SW_advanceMap(fine ? discrete->phiFine[topology] :
+                                            discrete->phi[topology],
+                                     fine ? discrete->gammaFine[topology] :
+                                            discrete->gamma[topology],
+                                     t, drivenInput, d * source,
+                                     sign * busInput);
+
+            if(topology != CLLC_PLANT_SW_CONDUCTING)
+            {
+                continue;
+            }
+
+            //
+            // the rectifier current keeps its sign over a conducting step,
+            // its magnitude is sign times it
+            //
+            if((taken & CLLC_PLANT_SW_TAKEN_CUT) != 0U)
+            {
+                for(c = 0; c < CLLC_PLANT_SW_MAP_STATES; c++)
+                {
+                    iRect[c] += weight * 0.5 * sign * rectStart[c];
+                    t[rect][c] = 0.0;
+                }
+            }
+            else
+            {
+                for(c = 0; c < CLLC_PLANT_SW_MAP_STATES; c++)
+                {
+                    iRect[c] += weight * 0.5 * sign *
+                                (rectStart[c] + t[rect][c]);
+                }
+            }
+        }
+
+        for(c = 0; c < CLLC_PLANT_SW_MAP_STATES; c++)
+        {
+            drivenSum[c] += 0.5 * d * drivenGain *
+                            (drivenStart[c] + t[driven][c]);
+            t[CLLC_PLANT_SW_MAP_BUS][c] +=
+                    busGain * ((rectGain * iRect[c]) -
+                               (t[CLLC_PLANT_SW_MAP_BUS][c] *
+                                loadConductance));
+            loadSum[c] += t[CLLC_PLANT_SW_MAP_BUS][c] * loadConductance;
+        }
+    }
+
+    //
+    // stored by column, the map over twice the periods is the map applied to
+    // its own columns, its sums add those of the first half
+    //
+    for(c = 0; c < CLLC_PLANT_SW_MAP_STATES; c++)
+    {
+        for(j = 0; j < CLLC_PLANT_SW_MAP_STATES; j++)
+        {
+            plant->map[0][c][j] = t[j][c];
+        }
+        plant->map[0][c][CLLC_PLANT_SW_MAP_DRIVEN] = drivenSum[c];
+        plant->map[0][c][CLLC_PLANT_SW_MAP_LOAD] = loadSum[c];
+    }
+
+    for(k = 1; k < CLLC_PLANT_SW_MAP_POWERS; k++)
+    {
+        const float64_t (*half)[CLLC_PLANT_SW_MAP_ROWS] =
+                (const float64_t (*)[CLLC_PLANT_SW_MAP_ROWS])
+                plant->map[k - 1U];
+
+        for(c = 0; c < CLLC_PLANT_SW_MAP_STATES; c++)
+        {
+            float64_t *column = plant->map[k][c];
+
+            CLLC_PLANT_SW_applyMap(half, half[c], column);
+            column[CLLC_PLANT_SW_MAP_DRIVEN] +=
+                    half[c][CLLC_PLANT_SW_MAP_DRIVEN];
+            column[CLLC_PLANT_SW_MAP_LOAD] += half[c][CLLC_PLANT_SW_MAP_LOAD];
+        }
+    }
+
+    //
+    // the bridges leave the period the way its last step left them
+    //
+    plant->mapRectifierSign = ((taken & CLLC_PLANT_SW_TAKEN_NEGATIVE) != 0U) ?
+                              -1 : 1;
+    if((taken & CLLC_PLANT_SW_TAKEN_CUT) != 0U)
+    {
+        plant->mapTopology = secToPrim ? CLLC_PLANT_SW_PRIM_BLOCKING :
+                                         CLLC_PLANT_SW_SEC_BLOCKING;
+    }
+    else
+    {
+        plant->mapTopology = taken & CLLC_PLANT_SW_TAKEN_TOPOLOGY_M;
+    }
+}
+
+//
+// periods whole switching periods on the map, from the start of a period,
+// with the largest powers of the map first
+//
+static void CLLC_PLANT_SW_runMap(CLLC_PLANT_SW_Plant *plant,
+                                 uint32_t periods, CLLC_PLANT_SW_Sums *sums)
+{
+    float64_t *vBus = (plant->params.powerFlow == CLLC_POWER_FLOW_SEC_PRIM) ?
+                      &plant->vPrim_Volts : &plant->vSec_Volts;
+    float64_t z[CLLC_PLANT_SW_MAP_ROWS];
+    uint16_t k;
+
+    if(periods == 0U)
+    {
+        return;
+    }
+
+    memcpy(z, plant->x, sizeof(plant->x));
+    z[CLLC_PLANT_SW_MAP_BUS] = *vBus;
+    z[CLLC_PLANT_SW_MAP_ONE] = 1.0;
+
+    for(k = CLLC_PLANT_SW_MAP_POWERS; k-- != 0U; )
+    {
+        while(periods >= (1UL << k))
+        {
+            CLLC_PLANT_SW_applyMap(
+                    (const float64_t (*)[CLLC_PLANT_SW_MAP_ROWS])plant->map[k],
+                    z, z);
+            sums->iDriven += z[CLLC_PLANT_SW_MAP_DRIVEN];
+            sums->iLoad += z[CLLC_PLANT_SW_MAP_LOAD];
+            periods -= (1UL << k);
+        }
+    }
+
+    memcpy(plant->x, z, sizeof(plant->x));
+    *vBus = z[CLLC_PLANT_SW_MAP_BUS];
+    plant->topology = plant->mapTopology;
+    plant->rectifierSign = plant->mapRectifierSign;
+}
+
+//
+// 1 when the steps taken a and b are the same, the fine steps of a fine
+// substep only count with fine set
+//
+static uint16_t CLLC_PLANT_SW_isSameTaken(
+                        const uint8_t a[][CLLC_PLANT_SW_FINE_STEPS],
+                        const uint8_t b[][CLLC_PLANT_SW_FINE_STEPS],
+                        uint16_t substeps, uint16_t fine)
+{
+    uint16_t k;
+
+    for(k = 0; k < substeps; k++)
+    {
+        if((a[k][0] != b[k][0]) ||
+           (fine && ((a[k][0] & CLLC_PLANT_SW_TAKEN_FINE) != 0U) &&
+            (memcmp(a[k], b[k], CLLC_PLANT_SW_FINE_STEPS) != 0)))
+        {
+            return(0);
+        }
+    }
+    return(1);
+}
+
+//
+// 1 when the PWM a is within 1 / 2^CLLC_PLANT_SW_MAP_SHIFT of the period of
+// b in its period and edges, with the same dead bands and trip
+//
+static uint16_t CLLC_PLANT_SW_isNearPWM(const CLLC_PLANT_SW_PWMState *a,
+                                        const CLLC_PLANT_SW_PWMState *b)
+{
+    uint32_t tolerance = b->period >> CLLC_PLANT_SW_MAP_SHIFT;
+
+    return((a->tripped == b->tripped) &&
+           (a->deadBandRED == b->deadBandRED) &&
+           (a->deadBandFED == b->deadBandFED) &&
+           ((uint32_t)labs((int32_t)(a->period - b->period)) <= tolerance) &&
+           ((uint32_t)labs((int32_t)(a->compare - b->compare)) <=
+            tolerance) &&
+           ((uint32_t)labs((int32_t)(a->phase - b->phase)) <= tolerance));
+}
+
+//
+// After a call run in substeps with a detail divider, once a whole period
+// was taken with the drive as it is: the next calls run on the map when
+// the PWM is still near the one the steps were kept with and the bridges
+// switch in the same substeps. The map is built then, unless it already
+// was from the same steps. Otherwise the steps are only kept for the next
+// check, the bridges may still be moving.
+//
+static void CLLC_PLANT_SW_checkMap(CLLC_PLANT_SW_Plant *plant)
+{
+    const CLLC_PLANT_SW_Params *params = &plant->params;
+    const uint8_t (*taken)[CLLC_PLANT_SW_FINE_STEPS] =
+            (const uint8_t (*)[CLLC_PLANT_SW_FINE_STEPS])plant->taken;
+    const uint8_t (*mapTaken)[CLLC_PLANT_SW_FINE_STEPS] =
+            (const uint8_t (*)[CLLC_PLANT_SW_FINE_STEPS])plant->mapTaken;
+    uint16_t near;
+
+    if(plant->takenCount < params->substepsPerPeriod)
+    {
+        return;
+    }
+
+    near = plant->mapValid &&
+           CLLC_PLANT_SW_isNearPWM(&plant->pwm, &plant->mapPWM) &&
+           CLLC_PLANT_SW_isSameTaken(taken, mapTaken,
+                                     params->substepsPerPeriod, 0);
+
+    if(near && plant->mapBuilt &&
+       CLLC_PLANT_SW_isSameTaken(taken, mapTaken,
+                                 params->substepsPerPeriod, 1))
+    {
+        //
+        // the map still holds
+        //
+    }
+    else
+    {
+        memcpy(plant->mapTaken, plant->taken, sizeof(plant->mapTaken));
+        plant->mapPWM = plant->pwm;
+        plant->mapValid = 1;
+        plant->mapBuilt = 0;
+
+        if(!near)
+        {
+            return;
+        }
+
+        CLLC_PLANT_SW_buildMap(plant);
+        plant->mapBuilt = 1;
+    }
+
+    plant->mapLeft = params->detailDivider - 1U;
+    plant->mapStart_Volts = (params->powerFlow == CLLC_POWER_FLOW_SEC_PRIM) ?
+                            plant->vPrim_Volts : plant->vSec_Volts;
+}
+
+//
+// A call runs on the map while the PWM stays near the one of the map and
+// the receiving bus within 1 / 2^CLLC_PLANT_SW_MAP_BUS_SHIFT of where it was
+// at the check
+//
+static uint16_t CLLC_PLANT_SW_isMapped(CLLC_PLANT_SW_Plant *plant)
+{
+    CLLC_PLANT_SW_PWMState pwm;
+    float64_t vBus = (plant->params.powerFlow == CLLC_POWER_FLOW_SEC_PRIM) ?
+                     plant->vPrim_Volts : plant->vSec_Volts;
+
+    if(plant->mapLeft == 0U)
+    {
+        return(0);
+    }
+
+    CLLC_PLANT_SW_readPWM(plant, &pwm);
+
+    if(!CLLC_PLANT_SW_isNearPWM(&pwm, &plant->mapPWM) ||
+       (fabs(vBus - plant->mapStart_Volts) >
+        (plant->mapStart_Volts *
+         (1.0 / (float64_t)(1UL << CLLC_PLANT_SW_MAP_BUS_SHIFT)))))
+    {
+        plant->mapLeft = 0;
+        return(0);
+    }
+
+    plant->mapLeft--;
+    return(1);
+}
+
+//
+// duration_s on the map: the period the map was checked in is finished in
+// substeps, then whole periods go on the map and the rest is carried like
+// a substep is. Returns the substeps gone by.
+//
+static uint32_t CLLC_PLANT_SW_runMapFor(CLLC_PLANT_SW_Plant *plant,
+                                        float64_t duration_s,
+                                        CLLC_PLANT_SW_Sums *sums)
+{
+    const CLLC_PLANT_SW_Params *params = &plant->params;
+    float64_t h = plant->substep_s;
+    float64_t remaining = duration_s + plant->carry_s;
+    uint32_t count = 0, periods;
+
+    if(plant->substep != 0U)
+    {
+        count = params->substepsPerPeriod - plant->substep;
+        CLLC_PLANT_SW_runSubsteps(plant, count, sums);
+        remaining -= (float64_t)count * h;
+    }
+
+    periods = (remaining > 0.0) ?
+              (uint32_t)((remaining / plant->period_s) + 0.5) : 0U;
+    CLLC_PLANT_SW_runMap(plant, periods, sums);
+    remaining -= (float64_t)periods * plant->period_s;
+
+    count += periods * params->substepsPerPeriod;
+    plant->carry_s = remaining;
+    plant->time_s += (float64_t)count * h;
+
+    return(count);
+}
+
+//
+// Advance the plant by duration_s with the PWM registers as they are now,
+// the sensed currents are the averages over that interval
+//
+void CLLC_PLANT_SW_run(CLLC_PLANT_SW_Plant *plant, float64_t duration_s)
+{
+    const CLLC_PLANT_SW_Params *params = &plant->params;
+    uint16_t secToPrim = (params->powerFlow == CLLC_POWER_FLOW_SEC_PRIM);
+    CLLC_PLANT_SW_Sums sums = {0.0, 0.0};
+    float64_t remaining, h, iDriven, iLoad;
+    uint32_t count;
+
+    if(CLLC_PLANT_SW_isMapped(plant))
+    {
+        count = CLLC_PLANT_SW_runMapFor(plant, duration_s + plant->held_s,
+                                        &sums);
+        plant->held_s = 0.0;
+
+        //
+        // the sample hook holds the next calls, see
+        // CLLC_PLANT_SW_sampleHook
+        //
+        plant->holdLeft = (plant->mapLeft < (CLLC_PLANT_SW_MAP_HOLD - 1U)) ?
+                          plant->mapLeft : (CLLC_PLANT_SW_MAP_HOLD - 1U);
+        plant->mapLeft -= plant->holdLeft;
+
+        if(count == 0U)
+        {
+            //
+            // the call is shorter than the period left over, the sensed
+            // values hold
+            //
+            return;
+        }
+
+        iDriven = fabs(sums.iDriven / (float64_t)count);
+        iLoad = sums.iLoad / (float64_t)count;
+    }
+    else
+    {
+        if(plant->held_s != 0.0)
+        {
+            //
+            // the calls held went by on the map, their time still does
+            //
+            CLLC_PLANT_SW_runMapFor(plant, plant->held_s, &sums);
+            plant->held_s = 0.0;
+            sums.iDriven = 0.0;
+            sums.iLoad = 0.0;
+        }
+
+        CLLC_PLANT_SW_updatePWM(plant);
+
+        if(plant->pwm.tripped || (plant->discrete == NULL))
+        {
+            //
+            // all switches off, the tank energy is returned through the body
+            // diodes within a cycle, only the receiving bus discharge is left
+            //
+            float64_t decay;
+
+            duration_s += plant->carry_s;
+            decay = exp(-duration_s / (params->rLoad_Ohms *
+                                       (secToPrim ? params->cPrim_F :
+                                                    params->cSec_F)));
+
+            memset(plant->x, 0, sizeof(plant->x));
+            plant->topology = secToPrim ? CLLC_PLANT_SW_PRIM_BLOCKING :
+                                          CLLC_PLANT_SW_SEC_BLOCKING;
+            plant->carry_s = 0.0;
+
+            if(secToPrim)
+            {
+                plant->vPrim_Volts *= decay;
+                iLoad = plant->vPrim_Volts / params->rLoad_Ohms;
+            }
+            else
+            {
+                plant->vSec_Volts *= decay;
+                iLoad = plant->vSec_Volts / params->rLoad_Ohms;
+            }
+            iDriven = 0.0;
+            plant->time_s += duration_s;
+        }
+        else
+        {
+            h = plant->substep_s;
+            remaining = duration_s + plant->carry_s;
+            count = (uint32_t)((remaining / h) + 0.5);
+            plant->carry_s = remaining - ((float64_t)count * h);
+            plant->time_s += (float64_t)count * h;
+
+            if(count == 0U)
+            {
+                count = 1;
+            }
+
+            CLLC_PLANT_SW_runSubsteps(plant, count, &sums);
+
+            if(params->detailDivider > 1U)
+            {
+                CLLC_PLANT_SW_checkMap(plant);
+            }
+
+            iDriven = fabs(sums.iDriven / (float64_t)count);
+            iLoad = sums.iLoad / (float64_t)count;
+        }
+    }
+
+    plant->sense.vPrim_Volts = (float32_t)plant->vPrim_Volts;
+    plant->sense.vSec_Volts = (float32_t)plant->vSec_Volts;
+    plant->sense.iPrim_Amps = (float32_t)(secToPrim ? iLoad : iDriven);
+    plant->sense.iSec_Amps = (float32_t)(secToPrim ? iDriven : iLoad);
+}
+
+void CLLC_PLANT_SW_sampleHook(void *context)
+{
+    CLLC_PLANT_SW_Plant *plant = (CLLC_PLANT_SW_Plant *)context;
+
+    if(plant->holdLeft != 0U)
+    {
+        //
+        // held on the map, the time is run by the next call
+        //
+        plant->holdLeft--;
+        plant->held_s += 1.0 / (float64_t)CLLC_ISR2_FREQUENCY_HZ;
+        return;
+    }
+
+    CLLC_PLANT_SW_run(plant, 1.0 / (float64_t)CLLC_ISR2_FREQUENCY_HZ);
+    CLLC_PLANT_writeADC(&plant->sense);
+}
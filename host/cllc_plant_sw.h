@@ -0,0 +1,229 @@
+//#############################################################################
+//
+// FILE:   cllc_plant_sw.h
+//
+// TITLE:  Switching-cycle CLLC plant model for the host emulator
+//         Time-domain model of the full bridge CLLC, primary bridge, primary
+//         resonant tank, transformer with magnetizing inductance, secondary
+//         resonant tank, secondary bridge and the bus capacitors. The bridge
+//         waveforms are decoded from the EPWM period, compare, dead band and
+//         phase registers written by CLLC_HAL_updatePWMDutyPeriodPhaseShift,
+//         CLLC_HAL_updatePWMDeadBandPrim and CLLC_precharge, and the sensed
+//         voltages and currents are written back as ADC result codes once
+//         per ISR2 period.
+//
+//         The tank is linear between bridge edges, it is advanced with the
+//         exact discretization (matrix exponential) over a fixed number of
+//         substeps per switching period. The bridge voltage of a substep is
+//         the average of the PWM waveform over that substep, so edges that
+//         fall between substeps (phase shift, dead band, hi-res) are
+//         accounted for by area. The discretization is cached per period
+//         value, so the per substep cost is one 4x4 matrix vector product.
+//
+//         Between edges every step is linear in the tank state and the
+//         receiving bus, as long as the bridges take the same topologies,
+//         so a whole switching period is one affine map. With a detail
+//         divider the steps of the last period run in substeps are kept,
+//         and once two calls in substeps in a row took the same steps the
+//         next detailDivider - 1 calls advance by that map, a period per
+//         6x6 matrix vector product, until the PWM or the receiving bus
+//         move away from where the map was taken. The sample hook then
+//         only refreshes the sensed values every CLLC_PLANT_SW_MAP_HOLD
+//         calls.
+//
+//#############################################################################
+
+#ifndef CLLC_PLANT_SW_H
+#define CLLC_PLANT_SW_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include "cllc_plant.h"
+
+//
+// Defines
+//
+#define CLLC_PLANT_SW_STATES            4
+#define CLLC_PLANT_SW_INPUTS            2
+#define CLLC_PLANT_SW_MAX_SUBSTEPS      128
+#define CLLC_PLANT_SW_DEFAULT_SUBSTEPS  16
+#define CLLC_PLANT_SW_CACHE_SIZE        256
+#define CLLC_PLANT_SW_DEFAULT_DETAIL_DIVIDER 256
+
+//
+// a substep in which the rectifier commutates is repeated in this many
+// fine steps, so the commutation instant resolves to
+// 1 / (substepsPerPeriod * CLLC_PLANT_SW_FINE_STEPS) of the period
+//
+#define CLLC_PLANT_SW_FINE_STEPS        8
+
+//
+// tank topologies, the passive bridge blocks when its current reaches zero
+// and the tank voltage is below the bus
+//
+#define CLLC_PLANT_SW_CONDUCTING        0
+#define CLLC_PLANT_SW_SEC_BLOCKING      1
+#define CLLC_PLANT_SW_PRIM_BLOCKING     2
+#define CLLC_PLANT_SW_TOPOLOGIES        3
+
+//
+// the period map acts on the tank state, the receiving bus and 1, its rows
+// give them after the period followed by the substep sums of the driven and
+// the load current. The calls on the map end when the PWM edges or period
+// move by more than 1 / 2^CLLC_PLANT_SW_MAP_SHIFT of the period since the
+// map was taken, or the receiving bus by more than
+// 1 / 2^CLLC_PLANT_SW_MAP_BUS_SHIFT of itself since it was checked.
+//
+#define CLLC_PLANT_SW_MAP_BUS           4
+#define CLLC_PLANT_SW_MAP_ONE           5
+#define CLLC_PLANT_SW_MAP_STATES        6
+#define CLLC_PLANT_SW_MAP_DRIVEN        6
+#define CLLC_PLANT_SW_MAP_LOAD          7
+#define CLLC_PLANT_SW_MAP_ROWS          8
+#define CLLC_PLANT_SW_MAP_SHIFT         8
+#define CLLC_PLANT_SW_MAP_BUS_SHIFT     6
+
+//
+// the map is kept over 1, 2, 4 ... 2^(CLLC_PLANT_SW_MAP_POWERS - 1)
+// periods. A call on the map is followed by CLLC_PLANT_SW_MAP_HOLD - 1
+// sample hook calls that leave the sensed values and the ADC results as
+// they are, the next call runs their time on the map, before its own.
+//
+#define CLLC_PLANT_SW_MAP_POWERS        5
+#define CLLC_PLANT_SW_MAP_HOLD          16
+
+//
+// typedefs
+//
+typedef struct
+{
+    float64_t lr1_H;            // primary resonant inductance
+    float64_t cr1_F;            // primary resonant capacitance
+    float64_t lm_H;             // magnetizing inductance, primary referred
+    float64_t lr2_H;            // secondary resonant inductance
+    float64_t cr2_F;            // secondary resonant capacitance
+    float64_t turnsRatio;       // Np / Ns
+    float64_t cPrim_F;          // primary bus capacitance
+    float64_t cSec_F;           // secondary bus capacitance
+    float64_t vPrimSource_Volts;// primary source, prim to sec power flow
+    float64_t vSecSource_Volts; // secondary source, sec to prim power flow
+    float64_t rLoad_Ohms;       // load on the receiving bus
+    uint16_t powerFlow;         // CLLC_POWER_FLOW_PRIM_SEC or _SEC_PRIM
+    uint16_t substepsPerPeriod; // up to CLLC_PLANT_SW_MAX_SUBSTEPS
+    uint16_t detailDivider;     // calls per call run in substeps once the
+                                // period map holds, 1 runs every call in
+                                // substeps
+} CLLC_PLANT_SW_Params;
+
+//
+// exact discretization of the three topologies for one substep length and
+// for one fine step
+//
+typedef struct
+{
+    uint32_t key;
+    uint16_t valid;
+    float64_t phi[CLLC_PLANT_SW_TOPOLOGIES][CLLC_PLANT_SW_STATES]
+                 [CLLC_PLANT_SW_STATES];
+    float64_t gamma[CLLC_PLANT_SW_TOPOLOGIES][CLLC_PLANT_SW_STATES]
+                   [CLLC_PLANT_SW_INPUTS];
+    float64_t phiFine[CLLC_PLANT_SW_TOPOLOGIES][CLLC_PLANT_SW_STATES]
+                     [CLLC_PLANT_SW_STATES];
+    float64_t gammaFine[CLLC_PLANT_SW_TOPOLOGIES][CLLC_PLANT_SW_STATES]
+                       [CLLC_PLANT_SW_INPUTS];
+} CLLC_PLANT_SW_Discrete;
+
+//
+// bridge drive decoded from the PWM registers, the drive table is rebuilt
+// whenever any of these change
+//
+typedef struct
+{
+    uint32_t period;            // TBPRD:TBPRDHR
+    uint32_t compare;           // CMPA:CMPAHR
+    uint32_t phase;             // latched TBPHS of leg 2
+    uint16_t deadBandRED;
+    uint16_t deadBandFED;
+    uint16_t tripped;
+} CLLC_PLANT_SW_PWMState;
+
+typedef struct
+{
+    CLLC_PLANT_SW_Params params;
+
+    //
+    // tank state, primary referred: i1, vCr1, i2, vCr2
+    //
+    float64_t x[CLLC_PLANT_SW_STATES];
+    float64_t vPrim_Volts;
+    float64_t vSec_Volts;
+    uint16_t topology;
+    int16_t rectifierSign;
+
+    CLLC_PLANT_SW_PWMState pwm;
+    CLLC_PLANT_SW_PWMState legKey;
+    uint32_t latchedPhase;
+    float64_t period_s;
+    float64_t substep_s;
+    float64_t leg[CLLC_PLANT_SW_MAX_SUBSTEPS];
+    float64_t drive[CLLC_PLANT_SW_MAX_SUBSTEPS];
+    uint16_t substep;
+    float64_t carry_s;
+    float64_t time_s;
+
+    //
+    // steps taken by the last period run in substeps, by substep, the steps
+    // kept at the last check with the PWM at mapPWM and the maps, built
+    // from them once mapBuilt is set, see CLLC_PLANT_SW_buildMap
+    //
+    uint8_t taken[CLLC_PLANT_SW_MAX_SUBSTEPS][CLLC_PLANT_SW_FINE_STEPS];
+    uint8_t mapTaken[CLLC_PLANT_SW_MAX_SUBSTEPS][CLLC_PLANT_SW_FINE_STEPS];
+    uint32_t takenCount;
+    uint16_t mapValid;
+    uint16_t mapBuilt;
+    uint16_t mapLeft;
+    uint16_t mapTopology;
+    int16_t mapRectifierSign;
+    uint16_t holdLeft;
+    float64_t held_s;
+    float64_t mapStart_Volts;
+    CLLC_PLANT_SW_PWMState mapPWM;
+    float64_t map[CLLC_PLANT_SW_MAP_POWERS][CLLC_PLANT_SW_MAP_STATES]
+                 [CLLC_PLANT_SW_MAP_ROWS];
+
+    const CLLC_PLANT_SW_Discrete *discrete;
+    uint32_t cacheMisses;
+
+    CLLC_PLANT_Sense sense;
+
+    CLLC_PLANT_SW_Discrete cache[CLLC_PLANT_SW_CACHE_SIZE];
+} CLLC_PLANT_SW_Plant;
+
+//
+// the function prototypes
+//
+void CLLC_PLANT_SW_setDefaultParams(CLLC_PLANT_SW_Params *params);
+void CLLC_PLANT_SW_init(CLLC_PLANT_SW_Plant *plant,
+                        const CLLC_PLANT_SW_Params *params);
+void CLLC_PLANT_SW_setLoad(CLLC_PLANT_SW_Plant *plant, float64_t rLoad_Ohms);
+void CLLC_PLANT_SW_setSource(CLLC_PLANT_SW_Plant *plant, float64_t volts);
+void CLLC_PLANT_SW_run(CLLC_PLANT_SW_Plant *plant, float64_t duration_s);
+
+//
+// CLLC_EMU_SampleHook, advances the plant by one ISR2 period with the PWM
+// registers as left by the previous ISRs and refreshes the ADC results,
+// context is the CLLC_PLANT_SW_Plant
+//
+void CLLC_PLANT_SW_sampleHook(void *context);
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
@@ -0,0 +1,431 @@
+//#############################################################################
+//
+// FILE:   cllc_profiler_check.c
+//
+// TITLE:  Check of the ISR profiler histograms against synthetic cycle
+//         streams
+//         Feeds cycle streams of known shape to the histograms of
+//         cllc_profiler.h, the way the ISRs do, and compares the bins,
+//         count, minimum, maximum, mean, standard deviation and percentiles
+//         against the same figures worked out from the stream directly. A
+//         percentile of the histogram must be the upper edge of the bin
+//         that holds the exact percentile, or the maximum for the last bin.
+//         Then checks the reset handshake and the entry and exit pairing.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -Wno-unknown-pragmas -Icllc
+//             host/cllc_profiler_check.c cllc/cllc_profiler.c -lm
+//             -o cllc_profiler_check
+//
+//         Usage:
+//         cllc_profiler_check [-n runs] [-s seed]
+//           -n  runs of the random streams (default 1000000)
+//           -s  seed of the random streams (default 1)
+//
+//         Exits 0 when all checks pass.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "cllc_profiler.h"
+#include "cllc_check.h"
+
+//
+// typedefs
+//
+typedef struct
+{
+    const char *name;
+    uint32_t (*next)(uint32_t i, uint64_t *state);
+    uint32_t runs;              // 0 = the -n runs
+} CLLC_PROFILER_CHECK_Stream;
+
+static uint32_t *CLLC_PROFILER_CHECK_cycles;
+
+//
+// splitmix64, as cllc_mc_main.c
+//
+static uint64_t CLLC_PROFILER_CHECK_nextRandom(uint64_t *state)
+{
+    uint64_t z;
+
+    *state += 0x9E3779B97F4A7C15ULL;
+    z = *state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return(z ^ (z >> 31));
+}
+
+//
+// uniform in [0, range)
+//
+static uint32_t CLLC_PROFILER_CHECK_getUniform(uint64_t *state,
+                                               uint32_t range)
+{
+    return((uint32_t)(CLLC_PROFILER_CHECK_nextRandom(state) % range));
+}
+
+//
+// the streams
+//
+static uint32_t CLLC_PROFILER_CHECK_constant(uint32_t i, uint64_t *state)
+{
+    (void)i;
+    (void)state;
+    return(123);
+}
+
+//
+// every value from 0 to past the last bin at the widest shift once
+//
+static uint32_t CLLC_PROFILER_CHECK_ramp(uint32_t i, uint64_t *state)
+{
+    (void)state;
+    return(i);
+}
+
+//
+// ISR2 like, about 600 cycles with a spread of a few tens and 1 % of runs
+// preempted by an ISR1 of 250 to 350 cycles
+//
+static uint32_t CLLC_PROFILER_CHECK_preempted(uint32_t i, uint64_t *state)
+{
+    uint32_t cycles = 560;
+    uint16_t k;
+
+    (void)i;
+
+    for(k = 0; k < 4; k++)
+    {
+        cycles += CLLC_PROFILER_CHECK_getUniform(state, 21);
+    }
+    if(CLLC_PROFILER_CHECK_getUniform(state, 100) == 0U)
+    {
+        cycles += 250 + CLLC_PROFILER_CHECK_getUniform(state, 101);
+    }
+    return(cycles);
+}
+
+//
+// latency like, a few cycles with a long thin tail
+//
+static uint32_t CLLC_PROFILER_CHECK_tail(uint32_t i, uint64_t *state)
+{
+    uint32_t cycles = 14 + CLLC_PROFILER_CHECK_getUniform(state, 4);
+
+    (void)i;
+
+    while(CLLC_PROFILER_CHECK_getUniform(state, 8) == 0U)
+    {
+        cycles += 1 + CLLC_PROFILER_CHECK_getUniform(state, 64);
+    }
+    return(cycles);
+}
+
+//
+// large counts up to 2^20 cycles, most past the last bin, for the 64 bit
+// sums (see CLLC_PROFILER_Histogram)
+//
+static uint32_t CLLC_PROFILER_CHECK_wide(uint32_t i, uint64_t *state)
+{
+    (void)i;
+    return(CLLC_PROFILER_CHECK_getUniform(state, 1UL << 20));
+}
+
+static const CLLC_PROFILER_CHECK_Stream CLLC_PROFILER_CHECK_stream[] =
+{
+    {"constant",  &CLLC_PROFILER_CHECK_constant,  1000},
+    {"ramp",      &CLLC_PROFILER_CHECK_ramp,
+                  (CLLC_PROFILER_BINS << 7) + 100U},
+    {"preempted", &CLLC_PROFILER_CHECK_preempted, 0},
+    {"tail",      &CLLC_PROFILER_CHECK_tail,      0},
+    {"wide",      &CLLC_PROFILER_CHECK_wide,      0},
+};
+
+static const uint16_t CLLC_PROFILER_CHECK_shift[] = {0, 2, 5, 7};
+
+static int CLLC_PROFILER_CHECK_compareCycles(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return((x > y) - (x < y));
+}
+
+//
+// Upper edge of the bin holding a value, the maximum for the last bin
+//
+static uint32_t CLLC_PROFILER_CHECK_getEdge(uint32_t cycles, uint16_t shift,
+                                            uint32_t max)
+{
+    uint32_t bin = cycles >> shift;
+
+    if(bin >= (CLLC_PROFILER_BINS - 1U))
+    {
+        return(max);
+    }
+    return(((bin + 1U) << shift) - 1U);
+}
+
+//
+// The stream through a channel as the ISRs feed it, latency and execution
+// alike, then everything compared against the sorted stream
+//
+static void CLLC_PROFILER_CHECK_run(const CLLC_PROFILER_CHECK_Stream *stream,
+                                    uint32_t runs, uint16_t shift,
+                                    uint64_t seed)
+{
+    CLLC_PROFILER_Channel channel;
+    CLLC_PROFILER_Summary summary;
+    uint32_t bin[CLLC_PROFILER_BINS];
+    const float32_t fraction[3] = {0.5f, 0.99f, 0.999f};
+    uint32_t percentile[3];
+    uint32_t *cycles = CLLC_PROFILER_CHECK_cycles;
+    uint64_t state = seed;
+    uint32_t failuresBefore = CLLC_CHECK_failures;
+    double sum = 0.0, sumSquared = 0.0, mean, sd;
+    uint32_t i, b, target;
+    char name[48];
+
+    snprintf(name, sizeof(name), "%s shift %u", stream->name,
+             (unsigned)shift);
+    CLLC_PROFILER_init(&channel, shift, shift);
+    memset(bin, 0, sizeof(bin));
+
+    for(i = 0; i < runs; i++)
+    {
+        cycles[i] = stream->next(i, &state);
+
+        CLLC_PROFILER_enter(&channel, cycles[i]);
+        CLLC_PROFILER_exit(&channel, cycles[i]);
+
+        b = cycles[i] >> shift;
+        bin[(b < CLLC_PROFILER_BINS) ? b : (CLLC_PROFILER_BINS - 1U)]++;
+        sum += cycles[i];
+    }
+
+    mean = sum / (double)runs;
+    for(i = 0; i < runs; i++)
+    {
+        sumSquared += (cycles[i] - mean) * (cycles[i] - mean);
+    }
+    sd = sqrt(sumSquared / (double)runs);
+
+    qsort(cycles, runs, sizeof(uint32_t), &CLLC_PROFILER_CHECK_compareCycles);
+
+    for(i = 0; i < 3U; i++)
+    {
+        target = (uint32_t)ceilf(fraction[i] * (float32_t)runs);
+        if(target == 0U)
+        {
+            target = 1;
+        }
+        percentile[i] = CLLC_PROFILER_CHECK_getEdge(cycles[target - 1U],
+                                                    shift, cycles[runs - 1U]);
+    }
+
+    if((memcmp(channel.latency.bin, channel.execution.bin,
+               sizeof(channel.latency.bin)) != 0) ||
+       (channel.latency.sum != channel.execution.sum) ||
+       (channel.latency.sumSquared != channel.execution.sumSquared))
+    {
+        CLLC_CHECK_failValue(name, "latency and execution histograms differ",
+                             0, 1);
+    }
+
+    for(b = 0; b < CLLC_PROFILER_BINS; b++)
+    {
+        if(channel.execution.bin[b] != bin[b])
+        {
+            CLLC_CHECK_failValue(name, "bin count", bin[b],
+                                 channel.execution.bin[b]);
+        }
+    }
+
+    CLLC_PROFILER_getSummary(&channel.execution, &summary);
+
+    if(summary.count != runs)
+    {
+        CLLC_CHECK_failValue(name, "count", runs, summary.count);
+    }
+    if(summary.min != cycles[0])
+    {
+        CLLC_CHECK_failValue(name, "min", cycles[0], summary.min);
+    }
+    if(summary.max != cycles[runs - 1U])
+    {
+        CLLC_CHECK_failValue(name, "max", cycles[runs - 1U], summary.max);
+    }
+    if(summary.overflow != bin[CLLC_PROFILER_BINS - 1U])
+    {
+        CLLC_CHECK_failValue(name, "overflow", bin[CLLC_PROFILER_BINS - 1U],
+                             summary.overflow);
+    }
+    if(fabs(summary.mean - mean) > (1e-6 * fabs(mean)))
+    {
+        CLLC_CHECK_failValue(name, "mean", mean, summary.mean);
+    }
+    if(fabs(summary.standardDeviation - sd) > ((1e-4 * sd) + 1e-3))
+    {
+        CLLC_CHECK_failValue(name, "standard deviation", sd,
+                             summary.standardDeviation);
+    }
+    if(summary.p50 != percentile[0])
+    {
+        CLLC_CHECK_failValue(name, "p50", percentile[0], summary.p50);
+    }
+    if(summary.p99 != percentile[1])
+    {
+        CLLC_CHECK_failValue(name, "p99", percentile[1], summary.p99);
+    }
+    if(summary.p999 != percentile[2])
+    {
+        CLLC_CHECK_failValue(name, "p99.9", percentile[2], summary.p999);
+    }
+
+    printf("%-9s shift %u: %8lu runs, min %8lu max %10lu mean %12.3f "
+           "sd %10.3f p50 %8lu p99 %8lu p99.9 %10lu %s\n", stream->name,
+           (unsigned)shift, (unsigned long)summary.count,
+           (unsigned long)summary.min, (unsigned long)summary.max,
+           summary.mean, summary.standardDeviation,
+           (unsigned long)summary.p50, (unsigned long)summary.p99,
+           (unsigned long)summary.p999,
+           (CLLC_CHECK_failures == failuresBefore) ? "ok" : "FAIL");
+}
+
+//
+// A reset asked for from the background is taken on the next run and only
+// once, the runs before it are gone and the ones after it are all there.
+// The latency given on entry goes with the execution given on exit.
+//
+static void CLLC_PROFILER_CHECK_runHandshake(void)
+{
+    CLLC_PROFILER_Channel channel;
+    uint32_t failuresBefore = CLLC_CHECK_failures;
+    uint32_t i;
+
+    CLLC_PROFILER_init(&channel, 2, 4);
+
+    for(i = 0; i < 100U; i++)
+    {
+        CLLC_PROFILER_enter(&channel, 1000);
+        CLLC_PROFILER_exit(&channel, 2000);
+    }
+
+    CLLC_PROFILER_requestReset(&channel);
+    CLLC_PROFILER_requestReset(&channel);
+    if(channel.execution.count != 100U)
+    {
+        CLLC_CHECK_failValue("handshake",
+                             "count before the ISR takes the reset", 100,
+                             channel.execution.count);
+    }
+
+    for(i = 0; i < 10U; i++)
+    {
+        CLLC_PROFILER_enter(&channel, 8 + i);
+        CLLC_PROFILER_exit(&channel, 64 + i);
+    }
+
+    if((channel.latency.count != 10U) || (channel.execution.count != 10U))
+    {
+        CLLC_CHECK_failValue("handshake", "count after the reset", 10,
+                             channel.execution.count);
+    }
+    if((channel.latency.min != 8U) || (channel.latency.max != 17U))
+    {
+        CLLC_CHECK_failValue("handshake", "latency max", 17,
+                             channel.latency.max);
+    }
+    if((channel.execution.min != 64U) || (channel.execution.max != 73U))
+    {
+        CLLC_CHECK_failValue("handshake", "execution max", 73,
+                             channel.execution.max);
+    }
+    if((channel.latency.bin[2] != 4U) || (channel.latency.bin[3] != 4U) ||
+       (channel.latency.bin[4] != 2U) || (channel.execution.bin[4] != 10U))
+    {
+        CLLC_CHECK_failValue("handshake", "bins after the reset", 0, 1);
+    }
+    if(channel.resetCount != channel.resetRequest)
+    {
+        CLLC_CHECK_failValue("handshake", "reset count", channel.resetRequest,
+                             channel.resetCount);
+    }
+
+    printf("handshake: %s\n",
+           (CLLC_CHECK_failures == failuresBefore) ? "ok" : "FAIL");
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t runs = 1000000;
+    uint64_t seed = 1;
+    uint32_t maxRuns, streamRuns;
+    size_t s, k;
+    int i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "-n") == 0) && ((i + 1) < argc))
+        {
+            runs = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-s") == 0) && ((i + 1) < argc))
+        {
+            seed = strtoull(argv[++i], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n runs] [-s seed]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    if(runs == 0U)
+    {
+        fprintf(stderr, "runs must be at least 1\n");
+        return(1);
+    }
+
+    maxRuns = runs;
+    for(s = 0; s < (sizeof(CLLC_PROFILER_CHECK_stream) /
+                    sizeof(CLLC_PROFILER_CHECK_stream[0])); s++)
+    {
+        if(CLLC_PROFILER_CHECK_stream[s].runs > maxRuns)
+        {
+            maxRuns = CLLC_PROFILER_CHECK_stream[s].runs;
+        }
+    }
+
+    CLLC_PROFILER_CHECK_cycles = malloc(maxRuns * sizeof(uint32_t));
+    if(CLLC_PROFILER_CHECK_cycles == NULL)
+    {
+        fprintf(stderr, "%lu runs do not fit\n", (unsigned long)maxRuns);
+        return(1);
+    }
+
+    for(s = 0; s < (sizeof(CLLC_PROFILER_CHECK_stream) /
+                    sizeof(CLLC_PROFILER_CHECK_stream[0])); s++)
+    {
+        streamRuns = (CLLC_PROFILER_CHECK_stream[s].runs != 0U) ?
+                     CLLC_PROFILER_CHECK_stream[s].runs : runs;
+
+        for(k = 0; k < (sizeof(CLLC_PROFILER_CHECK_shift) /
+                        sizeof(CLLC_PROFILER_CHECK_shift[0])); k++)
+        {
+            CLLC_PROFILER_CHECK_run(&CLLC_PROFILER_CHECK_stream[s],
+                                    streamRuns, CLLC_PROFILER_CHECK_shift[k],
+                                    seed);
+        }
+    }
+
+    CLLC_PROFILER_CHECK_runHandshake();
+
+    free(CLLC_PROFILER_CHECK_cycles);
+
+    return(CLLC_CHECK_result());
+}
@@ -0,0 +1,413 @@
+//#############################################################################
+//
+// FILE:   cllc_scheduler_check.c
+//
+// TITLE:  Check of the background scheduler against a virtual clock
+//         Runs cllc_scheduler.h as the background loop of cllc_main.c does,
+//         frame A ahead of frame B on the overflow flags of two timers, with
+//         the timers, the flags and the run time of the tasks taken from
+//         one virtual cycle count. Every task must run on exactly the ticks
+//         its divider and phase select, in table order, and be measured to
+//         the cycle, across a tick that passes under it too. Over budget
+//         runs and frame overruns must be counted as they were made, and
+//         the entries of the table that can never run must be rejected.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -Wno-unknown-pragmas -Icllc
+//             host/cllc_scheduler_check.c -o cllc_scheduler_check
+//
+//         Usage:
+//         cllc_scheduler_check [-n ticks]
+//           -n  ticks of frame A to run, 100 to 40000 (default 1000)
+//
+//         Exits 0 when all checks pass.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cllc_scheduler.h"
+#include "cllc_check.h"
+
+//
+// Defines
+//
+#define CLLC_SCHEDULER_CHECK_PERIOD_A   1000U       // cycles
+#define CLLC_SCHEDULER_CHECK_PERIOD_B   10000U
+#define CLLC_SCHEDULER_CHECK_LOOP       7U          // cycles of a loop pass
+#define CLLC_SCHEDULER_CHECK_LOG_MAX    65536U
+
+//
+// typedefs
+//
+typedef struct
+{
+    uint16_t frame;
+    uint32_t tick;
+    uint16_t task;
+} CLLC_SCHEDULER_CHECK_Run;
+
+//
+// the globals
+//
+static uint64_t CLLC_SCHEDULER_CHECK_now;
+static uint64_t CLLC_SCHEDULER_CHECK_seen[CLLC_SCHEDULER_FRAMES];
+static CLLC_SCHEDULER_Scheduler CLLC_SCHEDULER_CHECK_scheduler;
+static CLLC_SCHEDULER_TaskStats CLLC_SCHEDULER_CHECK_stats[8];
+static CLLC_SCHEDULER_CHECK_Run
+        CLLC_SCHEDULER_CHECK_log[CLLC_SCHEDULER_CHECK_LOG_MAX];
+static uint32_t CLLC_SCHEDULER_CHECK_logged;
+
+static const uint32_t
+        CLLC_SCHEDULER_CHECK_period[CLLC_SCHEDULER_FRAMES] =
+{
+    CLLC_SCHEDULER_CHECK_PERIOD_A, CLLC_SCHEDULER_CHECK_PERIOD_B
+};
+
+//
+// the timers, counting the cycles since their last overflow, and their
+// overflow flags, set by every overflow since the last clear
+//
+static uint32_t CLLC_SCHEDULER_CHECK_getElapsedA(void)
+{
+    return((uint32_t)(CLLC_SCHEDULER_CHECK_now %
+                      CLLC_SCHEDULER_CHECK_PERIOD_A));
+}
+
+static uint32_t CLLC_SCHEDULER_CHECK_getElapsedB(void)
+{
+    return((uint32_t)(CLLC_SCHEDULER_CHECK_now %
+                      CLLC_SCHEDULER_CHECK_PERIOD_B));
+}
+
+static uint16_t CLLC_SCHEDULER_CHECK_isPending(uint16_t frame)
+{
+    return((CLLC_SCHEDULER_CHECK_now / CLLC_SCHEDULER_CHECK_period[frame]) !=
+           CLLC_SCHEDULER_CHECK_seen[frame]);
+}
+
+static void CLLC_SCHEDULER_CHECK_clear(uint16_t frame)
+{
+    CLLC_SCHEDULER_CHECK_seen[frame] =
+            CLLC_SCHEDULER_CHECK_now / CLLC_SCHEDULER_CHECK_period[frame];
+}
+
+//
+// the tasks, each logs its run and takes its cycles off the virtual clock
+//
+static void CLLC_SCHEDULER_CHECK_run(uint16_t task, uint32_t cycles)
+{
+    const CLLC_SCHEDULER_Task *t =
+            &CLLC_SCHEDULER_CHECK_scheduler.task[task];
+    CLLC_SCHEDULER_CHECK_Run *run;
+
+    if(CLLC_SCHEDULER_CHECK_logged < CLLC_SCHEDULER_CHECK_LOG_MAX)
+    {
+        run = &CLLC_SCHEDULER_CHECK_log[CLLC_SCHEDULER_CHECK_logged];
+        run->frame = t->frame;
+        run->tick = CLLC_SCHEDULER_CHECK_scheduler.frame[t->frame].tick;
+        run->task = task;
+    }
+    CLLC_SCHEDULER_CHECK_logged++;
+    CLLC_SCHEDULER_CHECK_now += cycles;
+}
+
+static void CLLC_SCHEDULER_CHECK_runFast(void)
+{
+    CLLC_SCHEDULER_CHECK_run(0, 50);
+}
+
+//
+// 100 and 300 cycles on alternate runs, against a budget of 200
+//
+static void CLLC_SCHEDULER_CHECK_runAlternate(void)
+{
+    CLLC_SCHEDULER_CHECK_run(1, ((CLLC_SCHEDULER_CHECK_stats[1].runs & 1U) ==
+                                 0U) ? 100U : 300U);
+}
+
+static void CLLC_SCHEDULER_CHECK_runNever(void)
+{
+    CLLC_CHECK_fail("rejected task ran");
+}
+
+static void CLLC_SCHEDULER_CHECK_runSlow(void)
+{
+    CLLC_SCHEDULER_CHECK_run(3, 400);
+}
+
+static void CLLC_SCHEDULER_CHECK_runOverBudget(void)
+{
+    CLLC_SCHEDULER_CHECK_run(6, 20);
+}
+
+//
+// runs past the next tick of frame A
+//
+static void CLLC_SCHEDULER_CHECK_runLate(void)
+{
+    CLLC_SCHEDULER_CHECK_run(7, 980);
+}
+
+static const CLLC_SCHEDULER_Task CLLC_SCHEDULER_CHECK_task[] =
+{
+    {"fast", &CLLC_SCHEDULER_CHECK_runFast, CLLC_SCHEDULER_FRAME_A,
+     1, 0, 60},
+    {"alternate", &CLLC_SCHEDULER_CHECK_runAlternate, CLLC_SCHEDULER_FRAME_A,
+     4, 3, 200},
+    {"divider0", &CLLC_SCHEDULER_CHECK_runNever, CLLC_SCHEDULER_FRAME_A,
+     0, 0, 100},
+    {"slow", &CLLC_SCHEDULER_CHECK_runSlow, CLLC_SCHEDULER_FRAME_B,
+     1, 0, 1000},
+    {"frame2", &CLLC_SCHEDULER_CHECK_runNever, CLLC_SCHEDULER_FRAMES,
+     1, 0, 100},
+    {"phase2of2", &CLLC_SCHEDULER_CHECK_runNever, CLLC_SCHEDULER_FRAME_B,
+     2, 2, 100},
+    {"overBudget", &CLLC_SCHEDULER_CHECK_runOverBudget,
+     CLLC_SCHEDULER_FRAME_B, 2, 1, 10},
+    {"late", &CLLC_SCHEDULER_CHECK_runLate, CLLC_SCHEDULER_FRAME_A,
+     50, 25, 1000},
+};
+
+#define CLLC_SCHEDULER_CHECK_TASKS                                            \
+            (sizeof(CLLC_SCHEDULER_CHECK_task) /                              \
+             sizeof(CLLC_SCHEDULER_CHECK_task[0]))
+
+//
+// runs of a task over the ticks its frame ran
+//
+static uint32_t CLLC_SCHEDULER_CHECK_getDue(const CLLC_SCHEDULER_Task *task,
+                                            uint32_t ticks)
+{
+    if(ticks <= task->phase)
+    {
+        return(0);
+    }
+    return((ticks - task->phase - 1U) / task->divider + 1U);
+}
+
+//
+// every logged run due on its tick, in table order within the tick
+//
+static void CLLC_SCHEDULER_CHECK_checkLog(void)
+{
+    const CLLC_SCHEDULER_CHECK_Run *run, *previous = NULL;
+    const CLLC_SCHEDULER_Task *task;
+    uint32_t logged[CLLC_SCHEDULER_CHECK_TASKS] = {0};
+    uint32_t i;
+
+    if(CLLC_SCHEDULER_CHECK_logged > CLLC_SCHEDULER_CHECK_LOG_MAX)
+    {
+        CLLC_CHECK_fail("log overflow: %lu runs, room for %lu",
+                        (unsigned long)CLLC_SCHEDULER_CHECK_logged,
+                        (unsigned long)CLLC_SCHEDULER_CHECK_LOG_MAX);
+        return;
+    }
+
+    for(i = 0; i < CLLC_SCHEDULER_CHECK_logged; i++)
+    {
+        run = &CLLC_SCHEDULER_CHECK_log[i];
+        task = &CLLC_SCHEDULER_CHECK_task[run->task];
+        logged[run->task]++;
+
+        if((run->tick % task->divider) != task->phase)
+        {
+            CLLC_CHECK_fail("%s ran on tick %lu", task->name,
+                            (unsigned long)run->tick);
+        }
+        if((previous != NULL) && (previous->frame == run->frame) &&
+           (previous->tick == run->tick) && (previous->task >= run->task))
+        {
+            CLLC_CHECK_fail("%s ran after %s on tick %lu", task->name,
+                            CLLC_SCHEDULER_CHECK_task[previous->task].name,
+                            (unsigned long)run->tick);
+        }
+        previous = run;
+    }
+
+    for(i = 0; i < CLLC_SCHEDULER_CHECK_TASKS; i++)
+    {
+        CLLC_CHECK_expect(CLLC_SCHEDULER_CHECK_task[i].name,
+                          logged[i],
+                          CLLC_SCHEDULER_CHECK_stats[i].runs);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    CLLC_SCHEDULER_Scheduler *s = &CLLC_SCHEDULER_CHECK_scheduler;
+    const CLLC_SCHEDULER_TaskStats *stats = CLLC_SCHEDULER_CHECK_stats;
+    const CLLC_SCHEDULER_Task *task;
+    CLLC_SCHEDULER_TaskStats dirty[2];
+    CLLC_SCHEDULER_Scheduler empty;
+    uint32_t ticks = 1000;
+    uint32_t maxFrameB;
+    uint16_t rejected;
+    uint16_t i;
+    int arg;
+
+    for(arg = 1; arg < argc; arg++)
+    {
+        if((strcmp(argv[arg], "-n") == 0) && (arg + 1 < argc))
+        {
+            ticks = (uint32_t)strtoul(argv[++arg], NULL, 0);
+        }
+        if((ticks < 100U) || (ticks > 40000U) ||
+           (strcmp(argv[arg - 1], "-n") != 0))
+        {
+            fprintf(stderr, "usage: %s [-n ticks]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    //
+    // a table set up with stats left from before
+    //
+    memset(CLLC_SCHEDULER_CHECK_stats, 0xA5,
+           sizeof(CLLC_SCHEDULER_CHECK_stats));
+    rejected = CLLC_SCHEDULER_config(s, CLLC_SCHEDULER_CHECK_task,
+                                     CLLC_SCHEDULER_CHECK_stats,
+                                     CLLC_SCHEDULER_CHECK_TASKS);
+    CLLC_CHECK_expect("rejected", rejected, 3);
+    CLLC_SCHEDULER_configFrame(s, CLLC_SCHEDULER_FRAME_A,
+                               &CLLC_SCHEDULER_CHECK_getElapsedA,
+                               CLLC_SCHEDULER_CHECK_PERIOD_A);
+    CLLC_SCHEDULER_configFrame(s, CLLC_SCHEDULER_FRAME_B,
+                               &CLLC_SCHEDULER_CHECK_getElapsedB,
+                               CLLC_SCHEDULER_CHECK_PERIOD_B);
+
+    //
+    // the background loop of cllc_main.c
+    //
+    while(s->frame[CLLC_SCHEDULER_FRAME_A].tick < ticks)
+    {
+        CLLC_SCHEDULER_CHECK_now += CLLC_SCHEDULER_CHECK_LOOP;
+
+        if(CLLC_SCHEDULER_CHECK_isPending(CLLC_SCHEDULER_FRAME_A) != 0U)
+        {
+            CLLC_SCHEDULER_CHECK_clear(CLLC_SCHEDULER_FRAME_A);
+            CLLC_SCHEDULER_runFrame(s, CLLC_SCHEDULER_FRAME_A);
+        }
+        else if(CLLC_SCHEDULER_CHECK_isPending(CLLC_SCHEDULER_FRAME_B) != 0U)
+        {
+            CLLC_SCHEDULER_CHECK_clear(CLLC_SCHEDULER_FRAME_B);
+            CLLC_SCHEDULER_runFrame(s, CLLC_SCHEDULER_FRAME_B);
+        }
+    }
+
+    printf("%lu cycles, frame A %lu ticks, frame B %lu ticks\n",
+           (unsigned long)CLLC_SCHEDULER_CHECK_now,
+           (unsigned long)s->frame[CLLC_SCHEDULER_FRAME_A].tick,
+           (unsigned long)s->frame[CLLC_SCHEDULER_FRAME_B].tick);
+    for(i = 0; i < CLLC_SCHEDULER_CHECK_TASKS; i++)
+    {
+        printf("  %-10s runs %6lu  last %4lu  max %4lu  over budget %6lu\n",
+               CLLC_SCHEDULER_CHECK_task[i].name,
+               (unsigned long)stats[i].runs,
+               (unsigned long)stats[i].lastCycles,
+               (unsigned long)stats[i].maxCycles,
+               (unsigned long)stats[i].overBudget);
+    }
+    for(i = 0; i < CLLC_SCHEDULER_FRAMES; i++)
+    {
+        printf("  frame %c   max latency %4lu  max %4lu  overruns %lu\n",
+               'A' + i, (unsigned long)s->frame[i].maxLatencyCycles,
+               (unsigned long)s->frame[i].maxCycles,
+               (unsigned long)s->frame[i].overruns);
+    }
+
+    //
+    // every tick of both frames ran, but one still pending
+    //
+    for(i = 0; i < CLLC_SCHEDULER_FRAMES; i++)
+    {
+        CLLC_CHECK_expect((i == CLLC_SCHEDULER_FRAME_A) ?
+                          "frame A ticks" : "frame B ticks",
+                          s->frame[i].tick,
+                          (unsigned long)(CLLC_SCHEDULER_CHECK_now /
+                              CLLC_SCHEDULER_CHECK_period[i]) -
+                          CLLC_SCHEDULER_CHECK_isPending(i));
+    }
+
+    //
+    // runs of each task as its divider and phase select, none of the
+    // rejected ones
+    //
+    for(i = 0; i < CLLC_SCHEDULER_CHECK_TASKS; i++)
+    {
+        task = &CLLC_SCHEDULER_CHECK_task[i];
+        if((task->frame >= CLLC_SCHEDULER_FRAMES) || (task->divider == 0U) ||
+           (task->phase >= task->divider))
+        {
+            CLLC_CHECK_expect(task->name, stats[i].runs, 0);
+            continue;
+        }
+        CLLC_CHECK_expect(task->name, stats[i].runs,
+                          CLLC_SCHEDULER_CHECK_getDue(task,
+                              s->frame[task->frame].tick));
+    }
+    CLLC_SCHEDULER_CHECK_checkLog();
+
+    //
+    // cycles to the cycle, the late task across the next tick of frame A
+    //
+    CLLC_CHECK_expect("fast max", stats[0].maxCycles, 50);
+    CLLC_CHECK_expect("alternate max", stats[1].maxCycles, 300);
+    CLLC_CHECK_expect("slow max", stats[3].maxCycles, 400);
+    CLLC_CHECK_expect("overBudget max", stats[6].maxCycles, 20);
+    CLLC_CHECK_expect("late last", stats[7].lastCycles, 980);
+    CLLC_CHECK_expect("late max", stats[7].maxCycles, 980);
+
+    CLLC_CHECK_expect("fast over budget", stats[0].overBudget, 0);
+    CLLC_CHECK_expect("alternate over budget",
+                      stats[1].overBudget, stats[1].runs / 2U);
+    CLLC_CHECK_expect("overBudget over budget",
+                      stats[6].overBudget, stats[6].runs);
+    CLLC_CHECK_expect("late over budget", stats[7].overBudget, 0);
+
+    //
+    // frame A overruns are the late runs, frame B never runs into its next
+    // tick; frame A waits at most a loop pass and a frame B run
+    //
+    CLLC_CHECK_expect("frame A overruns",
+                      s->frame[CLLC_SCHEDULER_FRAME_A].overruns,
+                      stats[7].runs);
+    CLLC_CHECK_expect("frame B overruns",
+                      s->frame[CLLC_SCHEDULER_FRAME_B].overruns, 0);
+    maxFrameB = s->frame[CLLC_SCHEDULER_FRAME_B].maxCycles;
+    if(s->frame[CLLC_SCHEDULER_FRAME_A].maxLatencyCycles >
+       (CLLC_SCHEDULER_CHECK_LOOP + maxFrameB))
+    {
+        CLLC_CHECK_fail("frame A latency: %lu cycles, bound %lu",
+                        (unsigned long)
+                        s->frame[CLLC_SCHEDULER_FRAME_A].maxLatencyCycles,
+                        (unsigned long)(CLLC_SCHEDULER_CHECK_LOOP + maxFrameB));
+    }
+    if(s->frame[CLLC_SCHEDULER_FRAME_B].maxLatencyCycles < 50U)
+    {
+        CLLC_CHECK_fail("frame B behind frame A: %lu cycles, at least 50",
+                        (unsigned long)
+                        s->frame[CLLC_SCHEDULER_FRAME_B].maxLatencyCycles);
+    }
+
+    //
+    // an empty table still counts the ticks
+    //
+    memset(dirty, 0xA5, sizeof(dirty));
+    CLLC_CHECK_expect("empty rejected",
+                      CLLC_SCHEDULER_config(&empty,
+                              CLLC_SCHEDULER_CHECK_task, dirty, 0),
+                      0);
+    CLLC_SCHEDULER_configFrame(&empty, CLLC_SCHEDULER_FRAME_A,
+                               &CLLC_SCHEDULER_CHECK_getElapsedA,
+                               CLLC_SCHEDULER_CHECK_PERIOD_A);
+    CLLC_SCHEDULER_runFrame(&empty, CLLC_SCHEDULER_FRAME_A);
+    CLLC_CHECK_expect("empty ticks",
+                      empty.frame[CLLC_SCHEDULER_FRAME_A].tick, 1);
+    CLLC_CHECK_expect("empty overruns",
+                      empty.frame[CLLC_SCHEDULER_FRAME_A].overruns,
+                      0);
+
+    return(CLLC_CHECK_result());
+}
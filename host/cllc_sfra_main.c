@@ -0,0 +1,497 @@
+//#############################################################################
+//
+// FILE:   cllc_sfra_main.c
+//
+// TITLE:  Offline SFRA on the averaged plant
+//         Runs the SFRA of the firmware against the averaged plant
+//         (cllc_plant_fha.h), the injection and collection are the
+//         CLLC_SFRA_INJECT and CLLC_SFRA_COLLECT calls of
+//         CLLC_runISR2_secToPrimPowerFlow, with the SFRA_F32 library
+//         implemented by cllc_emu_sfra.c.
+//
+//         Every frequency point of CLLC_sfra1 is measured from its own cold
+//         start, so the points are independent and run in parallel. The
+//         workers are forked processes that claim points from a counter in
+//         shared memory. Each brings the lab up the same way as cllc_sweep,
+//         reconfigures CLLC_sfra1 for a one point sweep at its frequency
+//         and runs the SFRA background task every 1 ms, as task A1 does on
+//         the target. The parent puts the points back into the vectors of
+//         its own CLLC_sfra1 and prints them in the vector order of SFRA_F32,
+//         then the crossover and the margins of GH on stderr.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -include host/cllc_emu_target.h -I. -Icllc -Ihost -Idevice
+//             -Idevice/driverlib -Ilibraries -DCLLC_LAB=8 -DCLLC_SFRA_TYPE=2
+//             host/cllc_emu.c host/cllc_emu_firmware.c host/cllc_emu_sfra.c
+//             host/cllc_sfra_main.c host/cllc_plant_fha.c cllc/cllc.c
+//             cllc/cllc_hal.c $(DRIVERLIB) -lm -o cllc_sfra_lab8
+//         with DRIVERLIB the driverlib sources listed in host/README.md.
+//         Lab 6 or 7 measures the plant only.
+//
+//         Usage:
+//         cllc_sfra [-v volts] [-l percent] [-a amplitude] [-n steps]
+//                   [-j workers]
+//           -v  primary bus voltage, as for cllc_sweep (default nominal)
+//           -l  load in percent of rated power (default 50)
+//           -a  injection amplitude in pu (default CLLC_SFRA_AMPLITUDE)
+//           -n  ISR2 periods to settle before the injection (default as
+//               cllc_sweep)
+//           -j  worker processes (default the number of online cores)
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "cllc.h"
+#include "cllc_emu.h"
+#include "cllc_plant_fha.h"
+
+#if CLLC_SFRA_TYPE == CLLC_SFRA_DISABLED
+#error "build with -DCLLC_SFRA_TYPE=2 to select the voltage loop"
+#endif
+
+#if CLLC_POWER_FLOW != CLLC_POWER_FLOW_SEC_PRIM
+#error "the SFRA injection is in the sec to prim ISR2, build lab 6, 7 or 8"
+#endif
+
+#define CLLC_SFRA_MAX_WORKERS           256U
+
+//
+// SFRA background task period, task A1 runs every 1 ms
+//
+#define CLLC_SFRA_BACKGROUND_STEPS      ((uint32_t)(CLLC_ISR2_FREQUENCY_HZ /  \
+                                                    1000))
+
+//
+// typedefs
+//
+typedef struct
+{
+    uint32_t index;
+    uint32_t valid;             // 0 when the point tripped or timed out
+    float32_t h_mag;
+    float32_t h_phase;
+    float32_t gh_mag;
+    float32_t gh_phase;
+    float32_t cl_mag;
+    float32_t cl_phase;
+} CLLC_SFRA_Point;
+
+typedef struct
+{
+    float64_t vPrim_Volts;
+    float64_t loadFraction;
+    float32_t amplitude;
+    uint32_t settleSteps;
+} CLLC_SFRA_Config;
+
+typedef struct
+{
+    uint32_t next;
+} CLLC_SFRA_Shared;
+
+static CLLC_PLANT_FHA_Plant CLLC_SFRA_plant;
+
+static double CLLC_SFRA_now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9));
+}
+
+static float64_t CLLC_SFRA_getLoad_Ohms(float64_t loadFraction)
+{
+    float64_t vOut;
+
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+        vOut = (float64_t)CLLC_VPRIM_NOMINAL_VOLTS;
+    #else
+        vOut = (float64_t)CLLC_VSEC_NOMINAL_VOLTS;
+    #endif
+
+    if(loadFraction <= 0.0)
+    {
+        return(INFINITY);
+    }
+    return((vOut * vOut) / (loadFraction * CLLC_PLANT_RATED_POWER_W));
+}
+
+//
+// One frequency point from a cold start
+//
+static void CLLC_SFRA_runPoint(const CLLC_SFRA_Config *config,
+                               uint32_t index, CLLC_SFRA_Point *point)
+{
+    CLLC_PLANT_FHA_Plant *plant = &CLLC_SFRA_plant;
+    CLLC_PLANT_FHA_Params params;
+    uint32_t settleSteps = config->settleSteps;
+    float32_t hMag, hPhase, ghMag, ghPhase, clMag, clPhase;
+    float32_t frequency;
+    uint64_t maxSteps;
+
+    CLLC_EMU_initFirmware();
+
+    CLLC_PLANT_FHA_setDefaultParams(&params);
+    params.rLoad_Ohms = CLLC_SFRA_getLoad_Ohms(config->loadFraction);
+
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+        #if CLLC_INCR_BUILD == CLLC_CLOSED_LOOP_BUILD
+            CLLC_vPrimRef_Volts = (float32_t)config->vPrim_Volts;
+        #else
+            params.vSecSource_Volts = config->vPrim_Volts / params.turnsRatio;
+        #endif
+    #else
+        params.vPrimSource_Volts = config->vPrim_Volts;
+    #endif
+
+    CLLC_PLANT_FHA_init(plant, &params);
+    CLLC_EMU_setSampleHook(&CLLC_PLANT_FHA_sampleHook, plant);
+
+    CLLC_EMU_startFirmware();
+    CLLC_EMU_run(settleSteps / 2U);
+    settleSteps -= settleSteps / 2U;
+    settleSteps += CLLC_EMU_closeLoop();
+    CLLC_EMU_run(settleSteps);
+
+    //
+    // one point sweep at the frequency of the point in the full vector
+    //
+    frequency = CLLC_sfra1.freqVect[index];
+    SFRA_F32_config(&CLLC_sfra1, CLLC_SFRA_ISR_FREQ_HZ, config->amplitude, 1,
+                    frequency, CLLC_SFRA_FREQ_STEP_MULTIPLY, &hMag, &hPhase,
+                    &ghMag, &ghPhase, &clMag, &clPhase, &frequency, 1);
+    SFRA_F32_resetFreqRespArray(&CLLC_sfra1);
+    CLLC_sfra1.start = 1;
+
+    //
+    // the point takes a few cycles, give up well after that
+    //
+    maxSteps = CLLC_EMU_stats.step +
+               (uint64_t)((20.0f * CLLC_ISR2_FREQUENCY_HZ) / frequency) +
+               (uint64_t)CLLC_ISR2_FREQUENCY_HZ;
+
+    do
+    {
+        CLLC_EMU_run(CLLC_SFRA_BACKGROUND_STEPS);
+        CLLC_runSFRABackgroundTasks();
+    } while(((CLLC_sfra1.start != 0) || (CLLC_sfra1.state != 0)) &&
+            (plant->tripped == 0U) && (CLLC_EMU_stats.step < maxSteps));
+
+    memset(point, 0, sizeof(*point));
+    point->index = index;
+    point->valid = (CLLC_sfra1.state == 0) && (CLLC_sfra1.freqIndex == 1) &&
+                   (plant->tripped == 0U);
+    point->h_mag = hMag;
+    point->h_phase = hPhase;
+    point->gh_mag = ghMag;
+    point->gh_phase = ghPhase;
+    point->cl_mag = clMag;
+    point->cl_phase = clPhase;
+}
+
+//
+// Claim points until there are none left, a point goes to the parent in
+// one write, shorter than PIPE_BUF
+//
+static void CLLC_SFRA_work(const CLLC_SFRA_Config *config,
+                           CLLC_SFRA_Shared *shared, uint32_t points, int fd)
+{
+    CLLC_SFRA_Point point;
+    uint32_t index;
+
+    for(;;)
+    {
+        index = __atomic_fetch_add(&shared->next, 1U, __ATOMIC_RELAXED);
+        if(index >= points)
+        {
+            break;
+        }
+
+        CLLC_SFRA_runPoint(config, index, &point);
+
+        if(write(fd, &point, sizeof(point)) != (ssize_t)sizeof(point))
+        {
+            break;
+        }
+    }
+}
+
+//
+// Log frequency where the vector crosses level going down (mag) or going
+// through level (phase), interpolated between the points, 0 if it does not
+//
+static float32_t CLLC_SFRA_getCrossing(const float32_t *vect,
+                                       const uint16_t *valid,
+                                       float32_t level, int16_t *index)
+{
+    const SFRA_F32 *sfra = &CLLC_sfra1;
+    float32_t a, b, t;
+    int16_t i;
+
+    for(i = 1; i < sfra->vecLength; i++)
+    {
+        if(!valid[i - 1] || !valid[i])
+        {
+            continue;
+        }
+
+        a = vect[i - 1] - level;
+        b = vect[i] - level;
+
+        if((a >= 0.0f) && (b < 0.0f))
+        {
+            t = a / (a - b);
+            *index = i;
+            return(sfra->freqVect[i - 1] *
+                   powf(sfra->freqVect[i] / sfra->freqVect[i - 1], t));
+        }
+    }
+
+    *index = -1;
+    return(0.0f);
+}
+
+//
+// Value of vect at frequency, interpolated in log frequency around the
+// crossing found at index
+//
+static float32_t CLLC_SFRA_getValueAt(const float32_t *vect, int16_t index,
+                                      float32_t frequency)
+{
+    const SFRA_F32 *sfra = &CLLC_sfra1;
+    float32_t t = logf(frequency / sfra->freqVect[index - 1]) /
+                  logf(sfra->freqVect[index] / sfra->freqVect[index - 1]);
+
+    return(vect[index - 1] + ((vect[index] - vect[index - 1]) * t));
+}
+
+static void CLLC_SFRA_printMargins(const uint16_t *valid)
+{
+    const SFRA_F32 *sfra = &CLLC_sfra1;
+    float32_t crossover, phaseCrossover;
+    int16_t index;
+
+    #if CLLC_INCR_BUILD == CLLC_OPEN_LOOP_BUILD
+        fprintf(stderr, "open loop build, only H is meaningful\n");
+        return;
+    #endif
+
+    crossover = CLLC_SFRA_getCrossing(sfra->gh_magVect, valid, 0.0f, &index);
+    if(index > 0)
+    {
+        fprintf(stderr, "crossover %.1f Hz, phase margin %.1f deg\n",
+                crossover,
+                180.0f + CLLC_SFRA_getValueAt(sfra->gh_phaseVect, index,
+                                              crossover));
+    }
+    else
+    {
+        fprintf(stderr, "no 0 dB crossover in the sweep\n");
+    }
+
+    phaseCrossover = CLLC_SFRA_getCrossing(sfra->gh_phaseVect, valid,
+                                           -180.0f, &index);
+    if(index > 0)
+    {
+        fprintf(stderr, "phase crossover %.1f Hz, gain margin %.1f dB\n",
+                phaseCrossover,
+                -CLLC_SFRA_getValueAt(sfra->gh_magVect, index,
+                                      phaseCrossover));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    CLLC_SFRA_Config config;
+    CLLC_SFRA_Shared *shared;
+    CLLC_SFRA_Point point;
+    SFRA_F32 *sfra = &CLLC_sfra1;
+    uint16_t valid[CLLC_SFRA_FREQ_LENGTH];
+    uint32_t points, workers, received = 0;
+    size_t filled = 0;
+    int pipeFd[2];
+    double start, elapsed;
+    ssize_t count;
+    long online;
+    pid_t pid;
+    uint32_t w;
+    int16_t i;
+    int status = 0;
+
+    config.vPrim_Volts = (float64_t)CLLC_VPRIM_NOMINAL_VOLTS;
+    config.loadFraction = 0.5;
+    config.amplitude = CLLC_SFRA_AMPLITUDE;
+    config.settleSteps = (uint32_t)(0.5f * CLLC_ISR2_FREQUENCY_HZ);
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_PRIM_SEC
+        config.settleSteps += (uint32_t)CLLC_CONTROL_PRECHARGE_COUNT;
+    #endif
+
+    online = sysconf(_SC_NPROCESSORS_ONLN);
+    workers = (online > 0) ? (uint32_t)online : 1U;
+
+    for(i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "-v") == 0) && ((i + 1) < argc))
+        {
+            config.vPrim_Volts = strtod(argv[++i], NULL);
+        }
+        else if((strcmp(argv[i], "-l") == 0) && ((i + 1) < argc))
+        {
+            config.loadFraction = strtod(argv[++i], NULL) * 0.01;
+        }
+        else if((strcmp(argv[i], "-a") == 0) && ((i + 1) < argc))
+        {
+            config.amplitude = strtof(argv[++i], NULL);
+        }
+        else if((strcmp(argv[i], "-n") == 0) && ((i + 1) < argc))
+        {
+            config.settleSteps = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-j") == 0) && ((i + 1) < argc))
+        {
+            workers = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-v volts] [-l percent] "
+                    "[-a amplitude] [-n steps] [-j workers]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    if((workers == 0U) || (workers > CLLC_SFRA_MAX_WORKERS))
+    {
+        fprintf(stderr, "1 to %u workers\n", CLLC_SFRA_MAX_WORKERS);
+        return(1);
+    }
+
+    //
+    // the parent keeps the full sweep configured by CLLC_setupSFRA
+    //
+    CLLC_EMU_initFirmware();
+    points = (uint32_t)sfra->vecLength;
+    memset(valid, 0, sizeof(valid));
+
+    shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if((shared == MAP_FAILED) || (pipe(pipeFd) != 0))
+    {
+        fprintf(stderr, "no shared counter or pipe: %s\n", strerror(errno));
+        return(1);
+    }
+    shared->next = 0;
+
+    if(workers > points)
+    {
+        workers = points;
+    }
+
+    start = CLLC_SFRA_now_s();
+
+    for(w = 0; w < workers; w++)
+    {
+        pid = fork();
+        if(pid < 0)
+        {
+            fprintf(stderr, "fork: %s\n", strerror(errno));
+            break;
+        }
+        if(pid == 0)
+        {
+            //
+            // _exit, the stdio buffers inherited from the parent must not
+            // be flushed a second time
+            //
+            close(pipeFd[0]);
+            CLLC_SFRA_work(&config, shared, points, pipeFd[1]);
+            close(pipeFd[1]);
+            _exit(0);
+        }
+    }
+
+    close(pipeFd[1]);
+
+    for(;;)
+    {
+        count = read(pipeFd[0], (char *)&point + filled,
+                     sizeof(point) - filled);
+        if(count < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        if(count == 0)
+        {
+            break;
+        }
+
+        filled += (size_t)count;
+        if(filled < sizeof(point))
+        {
+            continue;
+        }
+        filled = 0;
+
+        if(point.index >= points)
+        {
+            continue;
+        }
+
+        received++;
+        valid[point.index] = (uint16_t)point.valid;
+        sfra->h_magVect[point.index] = point.h_mag;
+        sfra->h_phaseVect[point.index] = point.h_phase;
+        sfra->gh_magVect[point.index] = point.gh_mag;
+        sfra->gh_phaseVect[point.index] = point.gh_phase;
+        sfra->cl_magVect[point.index] = point.cl_mag;
+        sfra->cl_phaseVect[point.index] = point.cl_phase;
+    }
+
+    close(pipeFd[0]);
+    while(wait(NULL) > 0)
+    {
+    }
+
+    elapsed = CLLC_SFRA_now_s() - start;
+
+    printf("# lab %d, vPrim %.1f V, load %.1f %%, amplitude %g pu\n",
+           CLLC_LAB, config.vPrim_Volts, config.loadFraction * 100.0,
+           config.amplitude);
+    printf("# freq_Hz h_mag_dB h_phase_deg gh_mag_dB gh_phase_deg "
+           "cl_mag_dB cl_phase_deg valid\n");
+
+    for(i = 0; i < sfra->vecLength; i++)
+    {
+        printf("%.2f %.3f %.2f %.3f %.2f %.3f %.2f %u\n", sfra->freqVect[i],
+               sfra->h_magVect[i], sfra->h_phaseVect[i], sfra->gh_magVect[i],
+               sfra->gh_phaseVect[i], sfra->cl_magVect[i],
+               sfra->cl_phaseVect[i], valid[i]);
+    }
+
+    CLLC_SFRA_printMargins(valid);
+
+    if(received != points)
+    {
+        fprintf(stderr, "%lu of %lu points missing\n",
+                (unsigned long)(points - received), (unsigned long)points);
+        status = 1;
+    }
+
+    fprintf(stderr, "lab %d: %lu points on %lu workers in %.2f s\n",
+            CLLC_LAB, (unsigned long)received, (unsigned long)workers,
+            elapsed);
+
+    return(status);
+}
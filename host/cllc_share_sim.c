@@ -0,0 +1,711 @@
+//#############################################################################
+//
+// FILE:   cllc_share_sim.c
+//
+// TITLE:  Simulation of 2 to 8 boards sharing one secondary bus
+//         Each board is the averaged tank of cllc_plant_fha.h with its own
+//         tolerances on the resonant parts and the sense gains and the lag
+//         of the tank envelope, all of them driving one bus capacitor and
+//         one resistive load. The boards run the voltage loop with droop
+//         of the prim to sec power flow as ISR2 does with CLLC_SHARE_ROLE,
+//         and in their ISR3, which runs off the ISR2 of each board with its
+//         own offset, the averaged ISEC, the link of cllc_share.h and
+//         cllc_fsilink.h and the slew of the voltage reference. Board 0 is
+//         the master, the followers are daisy chained over
+//         cllc_fsi_loopback.h links.
+//
+//         Every case settles at 10% of the rated load per board, steps to
+//         25% and back, about the most the averaged tank carries at the
+//         nominal output. It reports the sharing error, the largest
+//         deviation of a board current from the mean over the mean, on the
+//         currents averaged over 10 ms as the ISR3 of the boards does,
+//         settled before each change and at its peak after the steps.
+//         The voltage loop of the boards with GV1 cycles on the lagged tank
+//         by some 2% of the bus, the settled bound of 8% takes it in. The
+//         cases run 2, 4 and 8 boards on a line of 100 ns, 8 boards with
+//         the line delay raised to 100 us and to 1 ms, and 4 boards with
+//         the link between the first and second follower cut for 50 ms at
+//         25%: the boards behind the cut must fall back to the droop within
+//         the timeout, stay within the trip limit, and trim again once the
+//         link returns.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -include host/cllc_emu_target.h
+//             -I. -Icllc -Ihost -Idevice -Idevice/driverlib -Ilibraries
+//             host/cllc_share_sim.c host/cllc_fsi_loopback.c
+//             cllc/cllc_fsilink.c -lm -o cllc_share_sim
+//
+//         Usage:
+//         cllc_share_sim [-s seed] [-v]
+//           -s  seed of the board tolerances (default 1)
+//           -v  print the board currents every 5 ms
+//
+//         Exits 0 when all checks pass.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "cllc_settings.h"
+#include "DCL/DCLF32.h"
+#include "cllc_fsilink.h"
+#include "cllc_share.h"
+#include "cllc_fsi_loopback.h"
+#include "cllc_check.h"
+
+//
+// Defines
+//
+#define CLLC_SHARE_SIM_BOARDS_MAX       8U
+#define CLLC_SHARE_SIM_ISR3_RATIO       12U     // ISR2 runs per ISR3 run
+#define CLLC_SHARE_SIM_BIT_RATE_BPS     (2.0 * 120e6 / 3.0)
+#define CLLC_SHARE_SIM_LINE_DELAY_S     100e-9
+
+//
+// the power stage of cllc_plant.h: tank resonant at the nominal frequency,
+// 0.1 Ohm of tank resistance, 100 uF of bus per board, 6.6 kW rated
+//
+#define CLLC_SHARE_SIM_TURNS_RATIO      ((double)CLLC_VPRIM_NOMINAL_VOLTS /   \
+                                         (double)CLLC_VSEC_NOMINAL_VOLTS)
+#define CLLC_SHARE_SIM_LR_H             24.0e-6
+#define CLLC_SHARE_SIM_LM_H             120.0e-6
+#define CLLC_SHARE_SIM_R_OHMS           0.1
+#define CLLC_SHARE_SIM_LAG_S            0.7e-3
+#define CLLC_SHARE_SIM_CBUS_F           100.0e-6
+#define CLLC_SHARE_SIM_RATED_W          6600.0
+#define CLLC_SHARE_SIM_PERIOD_MIN_PU    ((float32_t)CLLC_MIN_PWM_SWITCHING_FREQUENCY_HZ / \
+                                         (float32_t)CLLC_MAX_PWM_SWITCHING_FREQUENCY_HZ)
+
+//
+// tolerances, peak: resonant parts, current sense and voltage sense gains
+//
+#define CLLC_SHARE_SIM_TANK_TOL         0.05
+#define CLLC_SHARE_SIM_ISENSE_TOL       0.01
+#define CLLC_SHARE_SIM_VSENSE_TOL       0.001
+
+//
+// run of a case, the loops close at CLOSE, the load steps at STEP_UP and
+// STEP_DOWN, the cut link is down from CUT for CUT_LENGTH
+//
+#define CLLC_SHARE_SIM_LIGHT_LOAD       0.10    // of the rated, per board
+#define CLLC_SHARE_SIM_HEAVY_LOAD       0.25
+#define CLLC_SHARE_SIM_CLOSE_S          0.002
+#define CLLC_SHARE_SIM_STEP_UP_S        0.100
+#define CLLC_SHARE_SIM_CUT_S            0.160
+#define CLLC_SHARE_SIM_CUT_LENGTH_S     0.050
+#define CLLC_SHARE_SIM_STEP_DOWN_S      0.300
+#define CLLC_SHARE_SIM_END_S            0.400
+#define CLLC_SHARE_SIM_SETTLE_S         0.020
+#define CLLC_SHARE_SIM_AVERAGE_S        0.010   // as CLLC_AVG_ISEC_MULTIPLIER
+
+//
+// bounds of the checks
+//
+#define CLLC_SHARE_SIM_SETTLED_MAX      0.08    // of the mean, link up
+#define CLLC_SHARE_SIM_DROOP_MAX        0.30    // of the mean, link cut
+#define CLLC_SHARE_SIM_VBUS_MAX         0.05    // of the nominal, settled
+
+//
+// typedefs
+//
+typedef struct
+{
+    const char *name;
+    uint16_t boards;
+    double lineDelay_s;
+    int16_t cutLink;            // link cut, -1 for none
+} CLLC_SHARE_SIM_Case;
+
+typedef struct
+{
+    //
+    // tank and sensing
+    //
+    double lr_H;
+    double cr_F;
+    double iSenseGain;
+    double vSenseGain;
+    double iSec_Amps;
+    double iSecAvg_Amps;        // over CLLC_SHARE_SIM_AVERAGE_S
+
+    //
+    // ISR2
+    //
+    DCL_DF13 gv;
+    float32_t gvPartialComputedValue;
+    float32_t iSecSensed_pu;
+    float32_t vSecSensed_pu;
+    float32_t vSecRef_pu;
+    float32_t vSecRefSlewed_pu;
+    float32_t pwmPeriod_pu;
+    float32_t pwmPeriodSlewed_pu;
+
+    //
+    // ISR3 and the link
+    //
+    uint16_t isr3Offset;
+    float32_t iSecSensedAvg_pu;
+    CLLC_FSILINK_Tx tx;
+    CLLC_FSILINK_Rx rx;
+    CLLC_FSILINK_Share share;
+    CLLC_SHARE_Follower follower;
+    double linkDown_s;          // last dropout, -1 for none
+} CLLC_SHARE_SIM_Board;
+
+typedef struct
+{
+    double settled;             // sharing error, settled after the steps
+    double peak;                // sharing error, after the steps
+    double droop;               // sharing error, settled while cut
+    double vBusError;           // of the nominal, settled
+    double iMax_Amps;
+    double fallback_s;          // dropout after the cut
+    uint32_t dropouts;
+    uint32_t recoveries;
+    uint16_t linkUp;            // all followers at the end
+} CLLC_SHARE_SIM_Result;
+
+static const CLLC_SHARE_SIM_Case CLLC_SHARE_SIM_case[] =
+{
+    { "2 boards",              2, CLLC_SHARE_SIM_LINE_DELAY_S, -1 },
+    { "4 boards",              4, CLLC_SHARE_SIM_LINE_DELAY_S, -1 },
+    { "8 boards",              8, CLLC_SHARE_SIM_LINE_DELAY_S, -1 },
+    { "8 boards, 100 us line", 8, 100e-6,                      -1 },
+    { "8 boards, 1 ms line",   8, 1e-3,                        -1 },
+    { "4 boards, cut link 1",  4, CLLC_SHARE_SIM_LINE_DELAY_S,  1 },
+};
+
+static const CLLC_FSILINK_Setpoint CLLC_SHARE_SIM_limitMin =
+{
+    CLLC_FSI_VSEC_REF_MIN_VOLTS, CLLC_FSI_ISEC_REF_MIN_AMPS,
+    CLLC_FSI_PWM_FREQUENCY_MIN_HZ
+};
+static const CLLC_FSILINK_Setpoint CLLC_SHARE_SIM_limitMax =
+{
+    CLLC_FSI_VSEC_REF_MAX_VOLTS, CLLC_FSI_ISEC_REF_MAX_AMPS,
+    CLLC_FSI_PWM_FREQUENCY_MAX_HZ
+};
+
+static CLLC_SHARE_SIM_Board CLLC_SHARE_SIM_board[CLLC_SHARE_SIM_BOARDS_MAX];
+static CLLC_FSI_LOOPBACK_Link CLLC_SHARE_SIM_link[CLLC_SHARE_SIM_BOARDS_MAX];
+static uint16_t CLLC_SHARE_SIM_verbose;
+
+//
+// splitmix64, as cllc_mc_main.c
+//
+static uint64_t CLLC_SHARE_SIM_nextRandom(uint64_t *state)
+{
+    uint64_t z;
+
+    *state += 0x9E3779B97F4A7C15ULL;
+    z = *state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return(z ^ (z >> 31));
+}
+
+static double CLLC_SHARE_SIM_getTolerance(uint64_t *state, double tolerance)
+{
+    return(1.0 + tolerance *
+                 (((double)(CLLC_SHARE_SIM_nextRandom(state) >> 11) *
+                   (2.0 / 9007199254740992.0)) - 1.0));
+}
+
+//
+// The rectified current of a board into the bus, the FHA reduction of
+// CLLC_PLANT_FHA_run with the tank of the board at its period. The FHA
+// current is the steady state of the tank, the envelope follows it with
+// CLLC_SHARE_SIM_LAG_S, of the order of the 2 L / r of the series tank.
+// Without the lag the boards on one bus move their currents within an ISR2
+// run and the droop of each is a loop of its own much faster than the
+// voltage loop.
+//
+static void CLLC_SHARE_SIM_runTank(CLLC_SHARE_SIM_Board *board,
+                                   double vBus_Volts, double dt)
+{
+    double n = CLLC_SHARE_SIM_TURNS_RATIO;
+    double r = CLLC_SHARE_SIM_R_OHMS;
+    double f, omega, xs, xm, shunt, x, z2, vOpen, vRect, iTank;
+    double iSteady_Amps = 0.0;
+
+    f = (double)CLLC_MIN_PWM_SWITCHING_FREQUENCY_HZ /
+        (double)board->pwmPeriodSlewed_pu;
+    omega = 2.0 * M_PI * f;
+    xs = (omega * board->lr_H) - (1.0 / (omega * board->cr_F));
+    xm = omega * CLLC_SHARE_SIM_LM_H;
+    shunt = xs + xm;
+
+    //
+    // symmetric tank, the sec resonant parts as those of the prim
+    //
+    x = xs + ((xs * xm) / shunt);
+    z2 = (r * r) + (x * x);
+    vOpen = (4.0 / M_PI) * (double)CLLC_VPRIM_NOMINAL_VOLTS *
+            fabs(xm / shunt);
+    vRect = (4.0 / M_PI) * n * vBus_Volts;
+
+    if(vOpen > vRect)
+    {
+        iTank = (sqrt((r * r * vRect * vRect) -
+                      (z2 * ((vRect * vRect) - (vOpen * vOpen)))) -
+                 (r * vRect)) / z2;
+        iSteady_Amps = n * (2.0 / M_PI) * iTank;
+    }
+
+    board->iSec_Amps += (iSteady_Amps - board->iSec_Amps) *
+                        (1.0 - exp(-dt / CLLC_SHARE_SIM_LAG_S));
+}
+
+//
+// The voltage loop with droop as CLLC_runGvLoop_primToSecPowerFlow, its
+// history tracks the period while the loop is open as
+// CLLC_trackOpenLoop_primToSecPowerFlow
+//
+static void CLLC_SHARE_SIM_runGv(CLLC_SHARE_SIM_Board *board)
+{
+    float32_t error = CLLC_SHARE_getDroopError(board->vSecRefSlewed_pu,
+                                               board->vSecSensed_pu,
+                                               board->iSecSensed_pu,
+                                               CLLC_SHARE_DROOP_PU);
+    float32_t out = DCL_runDF13_C5(&board->gv, error,
+                                   board->gvPartialComputedValue);
+
+    out = (out > CLLC_GV_OUT_MAX) ? CLLC_GV_OUT_MAX : out;
+    out = (out < CLLC_SHARE_SIM_PERIOD_MIN_PU) ?
+          CLLC_SHARE_SIM_PERIOD_MIN_PU : out;
+    board->pwmPeriod_pu = out;
+    board->gvPartialComputedValue = DCL_runDF13_C6(&board->gv, error, out);
+}
+
+static void CLLC_SHARE_SIM_trackGv(CLLC_SHARE_SIM_Board *board)
+{
+    float32_t error = CLLC_SHARE_getDroopError(board->vSecRefSlewed_pu,
+                                               board->vSecSensed_pu,
+                                               board->iSecSensed_pu,
+                                               CLLC_SHARE_DROOP_PU);
+
+    board->gv.d1 = error;
+    board->gv.d2 = error;
+    board->gv.d5 = board->pwmPeriod_pu;
+    board->gv.d6 = board->pwmPeriod_pu;
+    board->gvPartialComputedValue = board->pwmPeriod_pu -
+                                    (board->gv.b0 * error);
+}
+
+//
+// One ISR2 run of a board
+//
+static void CLLC_SHARE_SIM_runISR2(CLLC_SHARE_SIM_Board *board,
+                                   uint16_t closeLoop, double vBus_Volts)
+{
+    float32_t step;
+
+    board->iSecSensed_pu = (float32_t)(floor(board->iSec_Amps *
+                                             board->iSenseGain *
+                                             (4096.0 /
+                                              CLLC_ISEC_MAX_SENSE_AMPS)) /
+                                       4096.0);
+    board->vSecSensed_pu = (float32_t)(floor(vBus_Volts * board->vSenseGain *
+                                             (4096.0 /
+                                              CLLC_VSEC_OPTIMAL_RANGE_VOLTS)) /
+                                       4096.0);
+
+    if(closeLoop)
+    {
+        CLLC_SHARE_SIM_runGv(board);
+    }
+    else
+    {
+        CLLC_SHARE_SIM_trackGv(board);
+    }
+
+    step = board->pwmPeriod_pu - board->pwmPeriodSlewed_pu;
+    if(step > CLLC_MAX_PERIOD_STEP_PU)
+    {
+        step = CLLC_MAX_PERIOD_STEP_PU;
+    }
+    else if(step < -CLLC_MAX_PERIOD_STEP_PU)
+    {
+        step = -CLLC_MAX_PERIOD_STEP_PU;
+    }
+    board->pwmPeriodSlewed_pu += step;
+}
+
+//
+// One ISR3 run of a board, the master sends the reference as
+// CLLC_runShareTx, a follower takes it as CLLC_runShareRx, then the
+// averaged ISEC and the slew of the voltage reference of CLLC_runISR3
+//
+static void CLLC_SHARE_SIM_runISR3(uint16_t index, uint16_t boards,
+                                   uint16_t closeLoop, double t)
+{
+    CLLC_SHARE_SIM_Board *board = &CLLC_SHARE_SIM_board[index];
+    CLLC_FSILINK_Frame frame;
+    float32_t slew = CLLC_VOLTS_PER_SECOND_SLEW /
+                     CLLC_VSEC_OPTIMAL_RANGE_VOLTS /
+                     CLLC_ISR3_FREQUENCY_HZ;
+    uint16_t events;
+    uint16_t taken = 0;
+    double arrival_s;
+
+    if(index == 0U)
+    {
+        board->share.iSecRef_pu = board->iSecSensedAvg_pu;
+        if(board->share.iSecRef_pu < 0.0f)
+        {
+            board->share.iSecRef_pu = 0.0f;
+        }
+        board->share.vSecRef_pu = board->vSecRefSlewed_pu;
+        CLLC_FSILINK_packShare(&board->tx, &frame, &board->share);
+        CLLC_FSI_LOOPBACK_send(&CLLC_SHARE_SIM_link[0], t, &frame);
+    }
+    else
+    {
+        events = CLLC_FSI_LOOPBACK_receive(&CLLC_SHARE_SIM_link[index - 1U],
+                                           t, &frame, &arrival_s);
+        if(events != 0U)
+        {
+            taken = CLLC_FSILINK_takeShare(&board->rx, events, &frame,
+                                           &board->share);
+            if((taken != 0U) && (index + 1U < boards))
+            {
+                CLLC_FSI_LOOPBACK_send(&CLLC_SHARE_SIM_link[index], t,
+                                       &frame);
+            }
+        }
+
+        board->vSecRef_pu = CLLC_SHARE_poll(&board->follower, taken,
+                                            board->share.iSecRef_pu,
+                                            board->share.vSecRef_pu,
+                                            board->iSecSensedAvg_pu);
+        if((board->linkDown_s < 0.0) && (board->follower.dropouts != 0U))
+        {
+            board->linkDown_s = t;
+        }
+    }
+
+    board->iSecSensedAvg_pu += 0.01f * (board->iSecSensed_pu -
+                                        board->iSecSensedAvg_pu);
+
+    if(closeLoop == 0U)
+    {
+        board->vSecRefSlewed_pu = board->vSecSensed_pu;
+    }
+    else if((board->vSecRef_pu - board->vSecRefSlewed_pu) > (2.0f * slew))
+    {
+        board->vSecRefSlewed_pu += slew;
+    }
+    else if((board->vSecRef_pu - board->vSecRefSlewed_pu) < -(2.0f * slew))
+    {
+        board->vSecRefSlewed_pu -= slew;
+    }
+    else
+    {
+        board->vSecRefSlewed_pu = board->vSecRef_pu;
+    }
+}
+
+static void CLLC_SHARE_SIM_initBoard(CLLC_SHARE_SIM_Board *board,
+                                     uint16_t index, uint64_t *state)
+{
+    double omega = 2.0 * M_PI *
+                   (double)CLLC_NOMINAL_PWM_SWITCHING_FREQUENCY_HZ;
+
+    memset(board, 0, sizeof(*board));
+
+    board->lr_H = CLLC_SHARE_SIM_LR_H *
+                  CLLC_SHARE_SIM_getTolerance(state, CLLC_SHARE_SIM_TANK_TOL);
+    board->cr_F = (1.0 / (omega * omega * CLLC_SHARE_SIM_LR_H)) *
+                  CLLC_SHARE_SIM_getTolerance(state, CLLC_SHARE_SIM_TANK_TOL);
+    board->iSenseGain = CLLC_SHARE_SIM_getTolerance(state,
+                                                    CLLC_SHARE_SIM_ISENSE_TOL);
+    board->vSenseGain = CLLC_SHARE_SIM_getTolerance(state,
+                                                    CLLC_SHARE_SIM_VSENSE_TOL);
+
+    //
+    // the history of the loop is cleared with the board
+    //
+    board->gv.a1 = CLLC_GV1_2P2Z_A1;
+    board->gv.a2 = CLLC_GV1_2P2Z_A2;
+    board->gv.a3 = CLLC_GV1_2P2Z_A3;
+    board->gv.b0 = CLLC_GV1_2P2Z_B0;
+    board->gv.b1 = CLLC_GV1_2P2Z_B1;
+    board->gv.b2 = CLLC_GV1_2P2Z_B2;
+    board->gv.b3 = CLLC_GV1_2P2Z_B3;
+
+    board->vSecRef_pu = CLLC_VSEC_NOMINAL_VOLTS /
+                        CLLC_VSEC_OPTIMAL_RANGE_VOLTS;
+    board->pwmPeriod_pu = (float32_t)CLLC_MIN_PWM_SWITCHING_FREQUENCY_HZ /
+                          (float32_t)CLLC_NOMINAL_PWM_SWITCHING_FREQUENCY_HZ;
+    board->pwmPeriodSlewed_pu = board->pwmPeriod_pu;
+
+    board->isr3Offset = (uint16_t)((index * 5U) % CLLC_SHARE_SIM_ISR3_RATIO);
+    CLLC_FSILINK_initTx(&board->tx);
+    CLLC_FSILINK_initRx(&board->rx, &CLLC_SHARE_SIM_limitMin,
+                        &CLLC_SHARE_SIM_limitMax);
+    CLLC_SHARE_initFollower(&board->follower, board->vSecRef_pu,
+                            CLLC_SHARE_TRIM_GAIN, CLLC_SHARE_TRIM_MAX_PU,
+                            CLLC_SHARE_TIMEOUT_POLLS,
+                            CLLC_SHARE_RECOVER_FRAMES);
+    board->linkDown_s = -1.0;
+}
+
+//
+// Largest deviation of a board current from the mean, over the mean
+//
+static double CLLC_SHARE_SIM_getSharingError(uint16_t boards)
+{
+    double mean = 0.0, error = 0.0;
+    uint16_t i;
+
+    for(i = 0; i < boards; i++)
+    {
+        mean += CLLC_SHARE_SIM_board[i].iSecAvg_Amps / (double)boards;
+    }
+    for(i = 0; i < boards; i++)
+    {
+        error = fmax(error, fabs(CLLC_SHARE_SIM_board[i].iSecAvg_Amps -
+                                 mean));
+    }
+
+    return((mean > 0.0) ? (error / mean) : 0.0);
+}
+
+//
+// t within the window of SETTLE before at_s
+//
+static int CLLC_SHARE_SIM_isSettled(double t, double at_s)
+{
+    return((t >= at_s - CLLC_SHARE_SIM_SETTLE_S) && (t < at_s));
+}
+
+static void CLLC_SHARE_SIM_runCase(const CLLC_SHARE_SIM_Case *c,
+                                   uint64_t seed, CLLC_SHARE_SIM_Result *result)
+{
+    double dt = 1.0 / (double)CLLC_ISR2_FREQUENCY_HZ;
+    double cBus = CLLC_SHARE_SIM_CBUS_F * (double)c->boards;
+    double vNominal = (double)CLLC_VSEC_NOMINAL_VOLTS;
+    double vBus = vNominal;
+    double gLoad, iTotal, t, error, nextPrint_s = 0.0;
+    double cut_s = CLLC_SHARE_SIM_CUT_S;
+    uint32_t steps = (uint32_t)(CLLC_SHARE_SIM_END_S / dt);
+    uint32_t k;
+    uint64_t state = seed;
+    uint16_t i, closeLoop;
+    CLLC_SHARE_SIM_Board *board;
+
+    memset(result, 0, sizeof(*result));
+    result->fallback_s = -1.0;
+
+    for(i = 0; i < c->boards; i++)
+    {
+        CLLC_SHARE_SIM_initBoard(&CLLC_SHARE_SIM_board[i], i, &state);
+        CLLC_FSI_LOOPBACK_init(&CLLC_SHARE_SIM_link[i],
+                               CLLC_SHARE_SIM_BIT_RATE_BPS, c->lineDelay_s,
+                               0.0, 0.0, seed + i);
+    }
+
+    for(k = 0; k < steps; k++)
+    {
+        t = (double)k * dt;
+        closeLoop = (t >= CLLC_SHARE_SIM_CLOSE_S);
+
+        gLoad = (double)c->boards * CLLC_SHARE_SIM_RATED_W *
+                (((t >= CLLC_SHARE_SIM_STEP_UP_S) &&
+                  (t < CLLC_SHARE_SIM_STEP_DOWN_S)) ?
+                 CLLC_SHARE_SIM_HEAVY_LOAD : CLLC_SHARE_SIM_LIGHT_LOAD) /
+                (vNominal * vNominal);
+
+        if(c->cutLink >= 0)
+        {
+            CLLC_SHARE_SIM_link[c->cutLink].dropRate =
+                    ((t >= cut_s) &&
+                     (t < cut_s + CLLC_SHARE_SIM_CUT_LENGTH_S)) ? 1.0 : 0.0;
+        }
+
+        for(i = 0; i < c->boards; i++)
+        {
+            CLLC_SHARE_SIM_runISR2(&CLLC_SHARE_SIM_board[i], closeLoop, vBus);
+            if(((k + CLLC_SHARE_SIM_board[i].isr3Offset) %
+                CLLC_SHARE_SIM_ISR3_RATIO) == 0U)
+            {
+                CLLC_SHARE_SIM_runISR3(i, c->boards, closeLoop, t);
+            }
+        }
+
+        //
+        // the bus over the currents of all boards
+        //
+        iTotal = 0.0;
+        for(i = 0; i < c->boards; i++)
+        {
+            board = &CLLC_SHARE_SIM_board[i];
+            CLLC_SHARE_SIM_runTank(board, vBus, dt);
+            board->iSecAvg_Amps += (board->iSec_Amps - board->iSecAvg_Amps) *
+                                   (dt / CLLC_SHARE_SIM_AVERAGE_S);
+            iTotal += board->iSec_Amps;
+            result->iMax_Amps = fmax(result->iMax_Amps, board->iSec_Amps);
+        }
+        vBus += dt * (iTotal - (gLoad * vBus)) / cBus;
+
+        //
+        // the errors, settled before each change and at the end, at the
+        // peak after the steps with the link up, and with the droop in the
+        // second half of the cut
+        //
+        error = CLLC_SHARE_SIM_getSharingError(c->boards);
+        if(((t >= CLLC_SHARE_SIM_STEP_UP_S) && (t < cut_s)) ||
+           (t >= CLLC_SHARE_SIM_STEP_DOWN_S))
+        {
+            result->peak = fmax(result->peak, error);
+        }
+        if(CLLC_SHARE_SIM_isSettled(t, CLLC_SHARE_SIM_STEP_UP_S) ||
+           CLLC_SHARE_SIM_isSettled(t, cut_s) ||
+           CLLC_SHARE_SIM_isSettled(t, CLLC_SHARE_SIM_STEP_DOWN_S) ||
+           CLLC_SHARE_SIM_isSettled(t, CLLC_SHARE_SIM_END_S))
+        {
+            result->settled = fmax(result->settled, error);
+            result->vBusError = fmax(result->vBusError,
+                                     fabs(vBus - vNominal) / vNominal);
+        }
+        if((c->cutLink >= 0) &&
+           CLLC_SHARE_SIM_isSettled(t, cut_s + CLLC_SHARE_SIM_CUT_LENGTH_S))
+        {
+            result->droop = fmax(result->droop, error);
+        }
+
+        if(CLLC_SHARE_SIM_verbose && (t >= nextPrint_s))
+        {
+            printf("  %6.1f ms  %6.2f V ", t * 1e3, vBus);
+            for(i = 0; i < c->boards; i++)
+            {
+                printf(" %6.2f%s", CLLC_SHARE_SIM_board[i].iSecAvg_Amps,
+                       ((i == 0U) ||
+                        (CLLC_SHARE_SIM_board[i].follower.linkUp != 0U)) ?
+                       "" : "d");
+            }
+            printf("\n");
+            nextPrint_s += 0.005;
+        }
+    }
+
+    result->linkUp = 1;
+    for(i = 1; i < c->boards; i++)
+    {
+        board = &CLLC_SHARE_SIM_board[i];
+        result->dropouts += board->follower.dropouts;
+        result->recoveries += board->follower.recoveries;
+        if(board->follower.linkUp == 0U)
+        {
+            result->linkUp = 0;
+        }
+        if(board->linkDown_s >= 0.0)
+        {
+            result->fallback_s = fmax(result->fallback_s,
+                                      board->linkDown_s - cut_s);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    CLLC_SHARE_SIM_Result result;
+    const CLLC_SHARE_SIM_Case *c;
+    uint64_t seed = 1;
+    double fallbackMax_s;
+    uint16_t n;
+    int arg;
+
+    for(arg = 1; arg < argc; arg++)
+    {
+        if((strcmp(argv[arg], "-s") == 0) && (arg + 1 < argc))
+        {
+            seed = strtoull(argv[++arg], NULL, 0);
+        }
+        else if(strcmp(argv[arg], "-v") == 0)
+        {
+            CLLC_SHARE_SIM_verbose = 1;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-s seed] [-v]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    //
+    // timeout polls, the ISR3 run it lands in and the frame in flight
+    //
+    fallbackMax_s = (double)(CLLC_SHARE_TIMEOUT_POLLS + 2U) /
+                    (double)CLLC_ISR3_FREQUENCY_HZ;
+
+    printf("case                    settled  peak    droop   vbus    "
+           "imax     fallback\n");
+    for(n = 0; n < sizeof(CLLC_SHARE_SIM_case) /
+                   sizeof(CLLC_SHARE_SIM_case[0]); n++)
+    {
+        c = &CLLC_SHARE_SIM_case[n];
+        CLLC_SHARE_SIM_runCase(c, seed, &result);
+
+        printf("%-22s  %5.2f%%  %5.2f%%  ", c->name, result.settled * 100.0,
+               result.peak * 100.0);
+        if(c->cutLink >= 0)
+        {
+            printf("%5.2f%%  ", result.droop * 100.0);
+        }
+        else
+        {
+            printf("   -    ");
+        }
+        printf("%5.2f%%  %5.2f A  ", result.vBusError * 100.0,
+               result.iMax_Amps);
+        if(result.fallback_s >= 0.0)
+        {
+            printf("%.2f ms\n", result.fallback_s * 1e3);
+        }
+        else
+        {
+            printf("   -\n");
+        }
+
+        CLLC_CHECK_expectTrue(result.settled < CLLC_SHARE_SIM_SETTLED_MAX,
+                              "%s: settled sharing error (%.4g)", c->name,
+                              result.settled);
+        CLLC_CHECK_expectTrue(result.vBusError < CLLC_SHARE_SIM_VBUS_MAX,
+                              "%s: bus voltage (%.4g)", c->name,
+                              result.vBusError);
+        CLLC_CHECK_expectTrue(result.iMax_Amps <
+                              (double)CLLC_ISEC_TRIP_LIMIT_AMPS,
+                              "%s: board current within the trip limit (%.4g)",
+                              c->name, result.iMax_Amps);
+        CLLC_CHECK_expectTrue(result.linkUp != 0U,
+                              "%s: all followers on the link (%.4g)", c->name,
+                              (double)result.linkUp);
+
+        if(c->cutLink < 0)
+        {
+            CLLC_CHECK_expectTrue(result.dropouts == 0U,
+                                  "%s: no dropout (%.4g)", c->name,
+                                  (double)result.dropouts);
+        }
+        else
+        {
+            CLLC_CHECK_expectTrue(result.dropouts ==
+                                  (uint32_t)(c->boards - 1 - c->cutLink),
+                                  "%s: a dropout per board behind the cut "
+                                  "(%.4g)", c->name, (double)result.dropouts);
+            CLLC_CHECK_expectTrue((result.fallback_s >= 0.0) &&
+                                  (result.fallback_s <= fallbackMax_s),
+                                  "%s: fallback within the timeout (%.4g)",
+                                  c->name, result.fallback_s);
+            CLLC_CHECK_expectTrue(result.droop < CLLC_SHARE_SIM_DROOP_MAX,
+                                  "%s: droop sharing error (%.4g)", c->name,
+                                  result.droop);
+        }
+    }
+
+    return(CLLC_CHECK_result());
+}
@@ -0,0 +1,469 @@
+//#############################################################################
+//
+// FILE:   cllc_stats_dump.c
+//
+// TITLE:  Decoder of the runtime counters of cllc_stats.h in a RAM dump
+//         Takes the address of CLLC_stats from the .map file of the build
+//         the dump came from, reads the block out of the dump, checks
+//         CLLC_STATS_LAYOUT and prints every counter.
+//
+//         The dump is raw 16 bit words in little endian order, as "Save
+//         Memory" of CCS writes them in raw binary, the first at the word
+//         address given with -a. A 32 bit counter is two words, the low
+//         one first.
+//
+//         Without options it checks itself: a map and a dump written the
+//         same way are decoded back, and CLLC_STATS_snapshot is run against
+//         a thread counting the block up, every copy it returns must be one
+//         the block held at some moment.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -Wno-unknown-pragmas -Icllc
+//             host/cllc_stats_dump.c -lpthread -o cllc_stats_dump
+//
+//         Usage:
+//         cllc_stats_dump [-m file.map -d dump.bin [-a address]]
+//           -m  the .map file of the build, CLLC_stats is looked up in it
+//           -d  the dump
+//           -a  word address of the first word in the dump, hex (default 0)
+//
+//         Exits 0 when the block is found and its layout is right, or when
+//         all checks pass.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "cllc_stats.h"
+#include "cllc_check.h"
+
+//
+// Defines
+//
+#define CLLC_STATS_DUMP_LINE_MAX        512U
+#define CLLC_STATS_DUMP_CHECK_ADDRESS   0xE040UL
+#define CLLC_STATS_DUMP_CHECK_BASE      0xE000UL
+#define CLLC_STATS_DUMP_CHECK_WORDS     0x200U
+#define CLLC_STATS_DUMP_CHECK_SECONDS   0.5
+#define CLLC_STATS_DUMP_CHECK_SPACING   200U
+
+//
+// The block the snapshot check copies from, and the counter thread
+//
+CLLC_STATS_Counters CLLC_stats;
+
+static volatile int CLLC_STATS_DUMP_stop;
+
+//
+// In the order of CLLC_STATS_Counters
+//
+static const char *CLLC_STATS_DUMP_name[CLLC_STATS_WORDS] =
+{
+    "layout", "isr1Count", "isr1Retriggers", "isr2Count", "isr2Overruns",
+    "isr3Count", "isr3Overruns", "tripPrimOverCurrent", "tripSecOverCurrent",
+    "tripPrimTankOverCurrent", "refSlewLimits", "periodSlewLimits",
+    "gvOutMaxClamps", "gvOutMinClamps", "giOutMaxClamps", "giOutMinClamps"
+};
+
+//
+// The word address of CLLC_stats, from either of the symbol tables of the
+// map ("page address name"). COFF builds put an underscore ahead of it.
+// Returns 0 when it is not there.
+//
+static int CLLC_STATS_DUMP_findSymbol(const char *path, unsigned long *address)
+{
+    char line[CLLC_STATS_DUMP_LINE_MAX];
+    char name[CLLC_STATS_DUMP_LINE_MAX];
+    unsigned long value;
+    unsigned page;
+    FILE *file = fopen(path, "r");
+
+    if(file == NULL)
+    {
+        perror(path);
+        return(0);
+    }
+
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        if((sscanf(line, "%u %lx %511s", &page, &value, name) == 3) &&
+           ((strcmp(name, "CLLC_stats") == 0) ||
+            (strcmp(name, "_CLLC_stats") == 0)))
+        {
+            *address = value;
+            fclose(file);
+            return(1);
+        }
+    }
+
+    fclose(file);
+    return(0);
+}
+
+//
+// The block at the word address from a dump starting at base. Returns 0
+// when the dump does not hold all of it.
+//
+static int CLLC_STATS_DUMP_readBlock(const char *path, unsigned long base,
+                                     unsigned long address,
+                                     CLLC_STATS_Counters *stats)
+{
+    uint32_t *word = (uint32_t *)stats;
+    uint8_t bytes[4U * CLLC_STATS_WORDS];
+    FILE *file;
+    uint16_t i;
+
+    if(address < base)
+    {
+        return(0);
+    }
+
+    file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        perror(path);
+        return(0);
+    }
+    if((fseek(file, (long)(address - base) * 2L, SEEK_SET) != 0) ||
+       (fread(bytes, 1, sizeof(bytes), file) != sizeof(bytes)))
+    {
+        fclose(file);
+        return(0);
+    }
+    fclose(file);
+
+    for(i = 0; i < CLLC_STATS_WORDS; i++)
+    {
+        word[i] = (uint32_t)bytes[4U * i] |
+                  ((uint32_t)bytes[4U * i + 1U] << 8) |
+                  ((uint32_t)bytes[4U * i + 2U] << 16) |
+                  ((uint32_t)bytes[4U * i + 3U] << 24);
+    }
+    return(1);
+}
+
+static void CLLC_STATS_DUMP_print(const CLLC_STATS_Counters *stats,
+                                  unsigned long address)
+{
+    const uint32_t *word = (const uint32_t *)stats;
+    uint16_t i;
+
+    printf("CLLC_stats at 0x%08lx, layout 0x%08lx\n", address,
+           (unsigned long)stats->layout);
+    for(i = 1; i < CLLC_STATS_WORDS; i++)
+    {
+        printf("  %-24s %10lu\n", CLLC_STATS_DUMP_name[i],
+               (unsigned long)word[i]);
+    }
+}
+
+//
+// Returns 1 for a block with the right layout, prints it and why there is
+// none with print set
+//
+static int CLLC_STATS_DUMP_decode(const char *mapPath, const char *dumpPath,
+                                  unsigned long base, int print)
+{
+    CLLC_STATS_Counters stats;
+    unsigned long address;
+
+    if(CLLC_STATS_DUMP_findSymbol(mapPath, &address) == 0)
+    {
+        if(print != 0)
+        {
+            fprintf(stderr, "%s: no CLLC_stats\n", mapPath);
+        }
+        return(0);
+    }
+    if(CLLC_STATS_DUMP_readBlock(dumpPath, base, address, &stats) == 0)
+    {
+        if(print != 0)
+        {
+            fprintf(stderr, "%s: 0x%08lx to 0x%08lx not in the dump\n",
+                    dumpPath, address,
+                    address + (2UL * CLLC_STATS_WORDS) - 1UL);
+        }
+        return(0);
+    }
+    if(stats.layout != CLLC_STATS_LAYOUT)
+    {
+        if(print != 0)
+        {
+            fprintf(stderr, "%s: layout 0x%08lx, expected 0x%08lx, dump and "
+                    "map of different builds?\n", dumpPath,
+                    (unsigned long)stats.layout,
+                    (unsigned long)CLLC_STATS_LAYOUT);
+        }
+        return(0);
+    }
+
+    if(print != 0)
+    {
+        CLLC_STATS_DUMP_print(&stats, address);
+    }
+    return(1);
+}
+
+//
+// A map with the symbol between others and a dump of the words around it
+//
+static void CLLC_STATS_DUMP_checkDecode(void)
+{
+    const char *mapPath = "cllc_stats_check.map";
+    const char *dumpPath = "cllc_stats_check.bin";
+    CLLC_STATS_Counters stats;
+    uint32_t *word = (uint32_t *)&stats;
+    unsigned long offset;
+    FILE *file;
+    uint16_t i;
+
+    file = fopen(mapPath, "w");
+    if(file == NULL)
+    {
+        perror(mapPath);
+        exit(1);
+    }
+    fprintf(file, "GLOBAL SYMBOLS: SORTED ALPHABETICALLY BY Name \n\n"
+            "page  address   name                            \n"
+            "----  --------  ----                            \n"
+            "0     0000e03e  CLLC_stat                       \n"
+            "0     %08lx  CLLC_stats                      \n"
+            "0     0000e060  CLLC_statsCLAISR2Count          \n",
+            CLLC_STATS_DUMP_CHECK_ADDRESS);
+    fclose(file);
+
+    CLLC_STATS_reset(&stats);
+    for(i = 1; i < CLLC_STATS_WORDS; i++)
+    {
+        word[i] = 0x01010101UL * i + ((uint32_t)i << 24);
+    }
+
+    file = fopen(dumpPath, "wb");
+    if(file == NULL)
+    {
+        perror(dumpPath);
+        exit(1);
+    }
+    offset = CLLC_STATS_DUMP_CHECK_ADDRESS - CLLC_STATS_DUMP_CHECK_BASE;
+    for(i = 0; i < CLLC_STATS_DUMP_CHECK_WORDS; i++)
+    {
+        uint16_t value = (uint16_t)(0xA000U + i);
+
+        if((i >= offset) && (i < (offset + (2U * CLLC_STATS_WORDS))))
+        {
+            value = (uint16_t)(word[(i - offset) >> 1] >>
+                               (((i - offset) & 1U) * 16U));
+        }
+        fputc(value & 0xFFU, file);
+        fputc(value >> 8, file);
+    }
+    fclose(file);
+
+    if(CLLC_STATS_DUMP_decode(mapPath, dumpPath, CLLC_STATS_DUMP_CHECK_BASE,
+                              0) == 0)
+    {
+        CLLC_CHECK_fail("decode of the map and dump written");
+    }
+    else
+    {
+        CLLC_STATS_Counters back;
+        unsigned long address;
+
+        (void)CLLC_STATS_DUMP_findSymbol(mapPath, &address);
+        (void)CLLC_STATS_DUMP_readBlock(dumpPath, CLLC_STATS_DUMP_CHECK_BASE,
+                                        address, &back);
+        if(memcmp(&back, &stats, sizeof(stats)) != 0)
+        {
+            CLLC_CHECK_fail("counters read back differ");
+        }
+    }
+
+    //
+    // a base past the block and a wrong layout are refused
+    //
+    if(CLLC_STATS_DUMP_decode(mapPath, dumpPath,
+                              CLLC_STATS_DUMP_CHECK_ADDRESS + 1UL, 0) != 0)
+    {
+        CLLC_CHECK_fail("block outside the dump taken");
+    }
+    if(CLLC_STATS_DUMP_decode(mapPath, dumpPath,
+                              CLLC_STATS_DUMP_CHECK_BASE + 2UL, 0) != 0)
+    {
+        CLLC_CHECK_fail("block with a wrong layout taken");
+    }
+
+    remove(mapPath);
+    remove(dumpPath);
+}
+
+//
+// Counts the block up as the ISRs would, a round counts isr2Count and then
+// isr3Count and every counter after it, one after the other. The rounds
+// are spaced out as ISR2 runs are against the background, or the copies
+// on another core would never settle.
+//
+static void *CLLC_STATS_DUMP_count(void *context)
+{
+    uint32_t *word = (uint32_t *)&CLLC_stats;
+    volatile uint32_t spin;
+    uint16_t i;
+
+    (void)context;
+
+    while(CLLC_STATS_DUMP_stop == 0)
+    {
+        __atomic_store_n(&CLLC_stats.isr2Count, CLLC_stats.isr2Count + 1U,
+                         __ATOMIC_RELEASE);
+        for(i = 5; i < CLLC_STATS_WORDS; i++)
+        {
+            __atomic_store_n(&word[i], word[i] + 1U, __ATOMIC_RELEASE);
+        }
+        for(spin = 0; spin < CLLC_STATS_DUMP_CHECK_SPACING; spin++)
+        {
+        }
+    }
+    return(NULL);
+}
+
+//
+// At any moment the block is part way through a round: from isr2Count on
+// the counters never grow and the last is at most one behind isr2Count. A
+// copy read while a round passes under it breaks that.
+//
+static int CLLC_STATS_DUMP_isConsistent(const CLLC_STATS_Counters *copy)
+{
+    const uint32_t *word = (const uint32_t *)copy;
+    uint32_t previous = copy->isr2Count;
+    uint16_t i;
+
+    for(i = 5; i < CLLC_STATS_WORDS; i++)
+    {
+        if(word[i] > previous)
+        {
+            return(0);
+        }
+        previous = word[i];
+    }
+    return(((copy->isr2Count - previous) <= 1U) ? 1 : 0);
+}
+
+static void CLLC_STATS_DUMP_checkSnapshot(void)
+{
+    CLLC_STATS_Counters copy;
+    pthread_t thread;
+    const volatile uint32_t *live = (const volatile uint32_t *)&CLLC_stats;
+    uint32_t *plain = (uint32_t *)&copy;
+    uint32_t torn = 0, wrong = 0, unsettled = 0, copies;
+    struct timespec start, now;
+    uint16_t i;
+
+    CLLC_STATS_reset(&CLLC_stats);
+    CLLC_STATS_DUMP_stop = 0;
+    if(pthread_create(&thread, NULL, &CLLC_STATS_DUMP_count, NULL) != 0)
+    {
+        CLLC_CHECK_fail("no counter thread");
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    now = start;
+    for(copies = 0; ((double)(now.tv_sec - start.tv_sec) +
+                     ((double)(now.tv_nsec - start.tv_nsec) * 1e-9)) <
+                    CLLC_STATS_DUMP_CHECK_SECONDS; copies++)
+    {
+        if((copies & 0x3FFU) == 0U)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+        }
+
+        //
+        // every other copy a plain one, to see the check catches tears
+        //
+        if((copies & 1U) != 0U)
+        {
+            for(i = 0; i < CLLC_STATS_WORDS; i++)
+            {
+                plain[i] = live[i];
+            }
+            if(CLLC_STATS_DUMP_isConsistent(&copy) == 0)
+            {
+                torn++;
+            }
+        }
+        else if(CLLC_STATS_snapshot(&CLLC_stats, &copy) == 0U)
+        {
+            unsettled++;
+        }
+        else if(CLLC_STATS_DUMP_isConsistent(&copy) == 0)
+        {
+            wrong++;
+        }
+    }
+
+    CLLC_STATS_DUMP_stop = 1;
+    pthread_join(thread, NULL);
+
+    printf("snapshot: %lu copies, %lu inconsistent, %lu not settled; "
+           "plain copies: %lu torn\n",
+           (unsigned long)(copies / 2U),
+           (unsigned long)wrong, (unsigned long)unsettled,
+           (unsigned long)torn);
+
+    if(wrong != 0U)
+    {
+        CLLC_CHECK_fail("inconsistent snapshot");
+    }
+    if(unsettled == (copies / 2U))
+    {
+        CLLC_CHECK_fail("no snapshot settled");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *mapPath = NULL;
+    const char *dumpPath = NULL;
+    unsigned long base = 0;
+    int i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "-m") == 0) && ((i + 1) < argc))
+        {
+            mapPath = argv[++i];
+        }
+        else if((strcmp(argv[i], "-d") == 0) && ((i + 1) < argc))
+        {
+            dumpPath = argv[++i];
+        }
+        else if((strcmp(argv[i], "-a") == 0) && ((i + 1) < argc))
+        {
+            base = strtoul(argv[++i], NULL, 16);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-m file.map -d dump.bin "
+                    "[-a address]]\n", argv[0]);
+            return(2);
+        }
+    }
+
+    if((mapPath != NULL) || (dumpPath != NULL))
+    {
+        if((mapPath == NULL) || (dumpPath == NULL))
+        {
+            fprintf(stderr, "-m and -d go together\n");
+            return(2);
+        }
+        return((CLLC_STATS_DUMP_decode(mapPath, dumpPath, base, 1) != 0) ?
+               0 : 1);
+    }
+
+    CLLC_STATS_DUMP_checkDecode();
+    CLLC_STATS_DUMP_checkSnapshot();
+
+    return(CLLC_CHECK_result());
+}
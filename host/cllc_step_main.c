@@ -0,0 +1,444 @@
+//#############################################################################
+//
+// FILE:   cllc_step_main.c
+//
+// TITLE:  Reference step response on the averaged plant
+//         Runs the firmware of a closed loop lab against the averaged plant
+//         (cllc_plant_fha.h), settles it at the nominal operating point,
+//         steps the reference of the closed loop and measures the response
+//         of the regulated quantity: rise time, overshoot, settling time
+//         and the error left at the end of the window. The step is applied
+//         to the reference and to the slewed reference together, so
+//         CLLC_runISR3 does not ramp it and the response is that of the
+//         loop alone.
+//
+//         The regulated quantity is the primary bus for the sec to prim
+//         lab, the secondary bus for the prim to sec voltage loop and the
+//         secondary current for the prim to sec current loop.
+//
+//         The host time per ISR2 period is measured over the same number of
+//         periods open loop, before the loop is closed, and closed loop,
+//         before the step. Both include the plant and the emulator, the
+//         difference is the host cost of the control law. As for
+//         cllc_ticks_bench it only shows the trend, the device cycles are
+//         measured on the target.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -include host/cllc_emu_target.h -I. -Icllc -Ihost -Idevice
+//             -Idevice/driverlib -Ilibraries -DCLLC_LAB=<lab>
+//             host/cllc_emu.c host/cllc_emu_firmware.c host/cllc_step_main.c
+//             host/cllc_plant_fha.c cllc/cllc.c cllc/cllc_hal.c $(DRIVERLIB)
+//             -lm -o cllc_step_lab<lab>
+//         with DRIVERLIB the driverlib sources listed in host/README.md,
+//         for the closed loop labs 3, 4, 5 and 8
+//
+//         Usage:
+//         cllc_step [-d step] [-L percent] [-n steps] [-w steps] [-a steps]
+//                   [-b percent] [-t steps] [-p divider]
+//           -d  reference step in volts or amps (default 10 V, 0.5 A)
+//           -L  load in percent of rated power (default 20)
+//           -n  ISR2 periods to settle before the step, after the
+//               precharge for the prim to sec labs (default 0.5 s)
+//           -w  ISR2 periods recorded after the step (default 50 ms)
+//           -a  ISR2 periods averaged for the levels (default 5 ms)
+//           -b  settling band in percent of the step (default 5)
+//           -t  ISR2 periods timed open and closed loop (default 0.1 s)
+//           -p  print the response every divider ISR2 periods
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "cllc.h"
+#include "cllc_emu.h"
+#include "cllc_plant_fha.h"
+
+#if CLLC_INCR_BUILD != CLLC_CLOSED_LOOP_BUILD
+#error "cllc_step runs the closed loop labs only"
+#endif
+
+//
+// the closed loop of the build, its reference and the regulated quantity
+//
+#if CLLC_CONTROL_MODE == CLLC_CURRENT_MODE
+    #define CLLC_STEP_UNIT              "A"
+    #define CLLC_STEP_DEFAULT_STEP      ((float64_t)0.5)
+#else
+    #define CLLC_STEP_UNIT              "V"
+    #define CLLC_STEP_DEFAULT_STEP      ((float64_t)10.0)
+#endif
+
+//
+// longest wait for the slewed reference after the loop is closed, 5 s
+//
+#define CLLC_STEP_MAX_SLEW_STEPS    (5U * (uint32_t)CLLC_ISR2_FREQUENCY_HZ)
+
+static CLLC_PLANT_FHA_Plant CLLC_STEP_plant;
+static float32_t *CLLC_STEP_window;
+
+typedef struct
+{
+    float64_t step;             // reference step, volts or amps
+    float64_t loadFraction;     // fraction of rated power
+    float64_t band;             // fraction of the step
+    uint32_t settleSteps;
+    uint32_t windowSteps;
+    uint32_t averageSteps;
+    uint32_t timedSteps;
+    uint32_t printDivider;      // 0 = no trace
+} CLLC_STEP_Config;
+
+typedef struct
+{
+    float64_t refBefore;
+    float64_t refAfter;
+    float64_t before;           // average before the step
+    float64_t final;            // average at the end of the window
+    float64_t rise_ms;          // 10 to 90 % of the step, < 0 not reached
+    float64_t overshoot_pct;    // peak past the final value, % of the step
+    float64_t settling_ms;      // last exit from the band around the final
+    float64_t frequency_kHz;    // switching frequency at the end
+    float64_t openLoop_ns;      // host time per ISR2 period
+    float64_t closedLoop_ns;
+    uint16_t tripped;
+} CLLC_STEP_Result;
+
+static double CLLC_STEP_now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9));
+}
+
+static float64_t CLLC_STEP_getLoad_Ohms(float64_t loadFraction)
+{
+    float64_t vOut;
+
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+        vOut = (float64_t)CLLC_VPRIM_NOMINAL_VOLTS;
+    #else
+        vOut = (float64_t)CLLC_VSEC_NOMINAL_VOLTS;
+    #endif
+
+    if(loadFraction <= 0.0)
+    {
+        return(INFINITY);
+    }
+    return((vOut * vOut) / (loadFraction * CLLC_PLANT_RATED_POWER_W));
+}
+
+static float32_t CLLC_STEP_getOutput(const CLLC_PLANT_FHA_Plant *plant)
+{
+    #if CLLC_CONTROL_MODE == CLLC_CURRENT_MODE
+        return((float32_t)plant->sense.iSec_Amps);
+    #elif CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+        return((float32_t)plant->vPrim_Volts);
+    #else
+        return((float32_t)plant->vSec_Volts);
+    #endif
+}
+
+static float64_t CLLC_STEP_getReference(void)
+{
+    #if CLLC_CONTROL_MODE == CLLC_CURRENT_MODE
+        return((float64_t)CLLC_iSecRef_Amps);
+    #elif CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+        return((float64_t)CLLC_vPrimRef_Volts);
+    #else
+        return((float64_t)CLLC_vSecRef_Volts);
+    #endif
+}
+
+static uint16_t CLLC_STEP_isReferenceSlewed(void)
+{
+    #if CLLC_CONTROL_MODE == CLLC_CURRENT_MODE
+        return(CLLC_iSecRefSlewed_pu == CLLC_iSecRef_pu);
+    #elif CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+        return(CLLC_vPrimRefSlewed_pu == CLLC_vPrimRef_pu);
+    #else
+        return(CLLC_vSecRefSlewed_pu == CLLC_vSecRef_pu);
+    #endif
+}
+
+//
+// Set the reference and the slewed reference together, CLLC_runISR3 then
+// finds nothing to slew
+//
+static void CLLC_STEP_setReference(float64_t value)
+{
+    #if CLLC_CONTROL_MODE == CLLC_CURRENT_MODE
+        CLLC_iSecRef_Amps = (float32_t)value;
+        CLLC_iSecRef_pu = CLLC_iSecRef_Amps / CLLC_ISEC_MAX_SENSE_AMPS;
+        CLLC_iSecRefSlewed_pu = CLLC_iSecRef_pu;
+    #elif CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+        CLLC_vPrimRef_Volts = (float32_t)value;
+        CLLC_vPrimRef_pu = CLLC_vPrimRef_Volts / CLLC_VPRIM_MAX_SENSE_VOLTS;
+        CLLC_vPrimRefSlewed_pu = CLLC_vPrimRef_pu;
+    #else
+        CLLC_vSecRef_Volts = (float32_t)value;
+        CLLC_vSecRef_pu = CLLC_vSecRef_Volts / CLLC_VSEC_OPTIMAL_RANGE_VOLTS;
+        CLLC_vSecRefSlewed_pu = CLLC_vSecRef_pu;
+    #endif
+}
+
+static float64_t CLLC_STEP_time_ns(uint32_t steps)
+{
+    double start;
+
+    if(steps == 0U)
+    {
+        return(0.0);
+    }
+
+    start = CLLC_STEP_now_s();
+    CLLC_EMU_run(steps);
+    return(((CLLC_STEP_now_s() - start) * 1e9) / (float64_t)steps);
+}
+
+//
+// Start the firmware as cllc_sweep does, time the open loop periods at the
+// end of the first half of the settle time and the closed loop periods at
+// the end of the second, then step the reference and record the window.
+// The prim to sec labs run the precharge open loop on top, so their loop
+// is closed on the precharged bus. The second half starts once the slewed
+// reference has reached the reference, the step is taken from a settled
+// operating point whatever the load.
+//
+static void CLLC_STEP_run(const CLLC_STEP_Config *config,
+                          CLLC_STEP_Result *result)
+{
+    CLLC_PLANT_FHA_Plant *plant = &CLLC_STEP_plant;
+    CLLC_PLANT_FHA_Params params;
+    uint32_t settleSteps = config->settleSteps;
+    uint32_t openSteps;
+    uint32_t i, rise10, rise90, lastOutside;
+    float64_t sum, delta, band, peak, v;
+
+    memset(result, 0, sizeof(*result));
+
+    CLLC_EMU_initFirmware();
+
+    CLLC_PLANT_FHA_setDefaultParams(&params);
+    params.rLoad_Ohms = CLLC_STEP_getLoad_Ohms(config->loadFraction);
+    CLLC_PLANT_FHA_init(plant, &params);
+    CLLC_EMU_setSampleHook(&CLLC_PLANT_FHA_sampleHook, plant);
+
+    CLLC_EMU_startFirmware();
+
+    openSteps = settleSteps / 2U;
+    settleSteps -= openSteps;
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_PRIM_SEC
+        openSteps += (uint32_t)CLLC_CONTROL_PRECHARGE_COUNT;
+    #endif
+    if(openSteps > config->timedSteps)
+    {
+        CLLC_EMU_run(openSteps - config->timedSteps);
+        result->openLoop_ns = CLLC_STEP_time_ns(config->timedSteps);
+    }
+    else
+    {
+        CLLC_EMU_run(openSteps);
+    }
+
+    CLLC_EMU_run(CLLC_EMU_closeLoop());
+    for(i = 0; (i < CLLC_STEP_MAX_SLEW_STEPS) &&
+               !CLLC_STEP_isReferenceSlewed(); i++)
+    {
+        CLLC_EMU_step();
+    }
+
+    if(settleSteps > config->timedSteps)
+    {
+        CLLC_EMU_run(settleSteps - config->timedSteps);
+        result->closedLoop_ns = CLLC_STEP_time_ns(config->timedSteps);
+    }
+    else
+    {
+        CLLC_EMU_run(settleSteps);
+    }
+
+    sum = 0.0;
+    for(i = 0; i < config->averageSteps; i++)
+    {
+        CLLC_EMU_step();
+        sum += CLLC_STEP_getOutput(plant);
+    }
+    result->before = sum / (float64_t)config->averageSteps;
+
+    result->refBefore = CLLC_STEP_getReference();
+    result->refAfter = result->refBefore + config->step;
+    CLLC_STEP_setReference(result->refAfter);
+
+    for(i = 0; i < config->windowSteps; i++)
+    {
+        CLLC_EMU_step();
+        CLLC_STEP_window[i] = CLLC_STEP_getOutput(plant);
+
+        if((config->printDivider != 0U) && ((i % config->printDivider) == 0U))
+        {
+            printf("%10.4f %10.4f %10.4f %9.3f\n",
+                   (1e3 * (float64_t)i) / (float64_t)CLLC_ISR2_FREQUENCY_HZ,
+                   result->refAfter, CLLC_STEP_window[i],
+                   plant->frequency_Hz * 1e-3);
+        }
+    }
+
+    sum = 0.0;
+    for(i = config->windowSteps - config->averageSteps;
+        i < config->windowSteps; i++)
+    {
+        sum += CLLC_STEP_window[i];
+    }
+    result->final = sum / (float64_t)config->averageSteps;
+
+    //
+    // the step as the output actually moved, so a response that settles
+    // off the reference is still timed against its own final value
+    //
+    delta = result->final - result->before;
+    band = config->band * fabs(delta);
+    peak = 0.0;
+    rise10 = config->windowSteps;
+    rise90 = config->windowSteps;
+    lastOutside = 0;
+
+    for(i = 0; i < config->windowSteps; i++)
+    {
+        v = (CLLC_STEP_window[i] - result->before) / delta;
+
+        if((rise10 == config->windowSteps) && (v >= 0.1))
+        {
+            rise10 = i;
+        }
+        if((rise90 == config->windowSteps) && (v >= 0.9))
+        {
+            rise90 = i;
+        }
+        if((v - 1.0) > peak)
+        {
+            peak = v - 1.0;
+        }
+        if(fabs(CLLC_STEP_window[i] - result->final) > band)
+        {
+            lastOutside = i + 1U;
+        }
+    }
+
+    result->rise_ms = (rise90 < config->windowSteps) ?
+                      ((1e3 * (float64_t)(rise90 - rise10)) /
+                       (float64_t)CLLC_ISR2_FREQUENCY_HZ) : -1.0;
+    result->overshoot_pct = 100.0 * peak;
+    result->settling_ms = (1e3 * (float64_t)lastOutside) /
+                          (float64_t)CLLC_ISR2_FREQUENCY_HZ;
+    result->frequency_kHz = plant->frequency_Hz * 1e-3;
+    result->tripped = plant->tripped;
+}
+
+int main(int argc, char *argv[])
+{
+    CLLC_STEP_Config config;
+    CLLC_STEP_Result result;
+    int i;
+
+    memset(&config, 0, sizeof(config));
+    config.step = CLLC_STEP_DEFAULT_STEP;
+    config.loadFraction = 0.2;
+    config.band = 0.05;
+    config.settleSteps = (uint32_t)(0.5f * CLLC_ISR2_FREQUENCY_HZ);
+    config.windowSteps = (uint32_t)(0.05f * CLLC_ISR2_FREQUENCY_HZ);
+    config.averageSteps = (uint32_t)(0.005f * CLLC_ISR2_FREQUENCY_HZ);
+    config.timedSteps = (uint32_t)(0.1f * CLLC_ISR2_FREQUENCY_HZ);
+
+    for(i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "-d") == 0) && ((i + 1) < argc))
+        {
+            config.step = strtod(argv[++i], NULL);
+        }
+        else if((strcmp(argv[i], "-L") == 0) && ((i + 1) < argc))
+        {
+            config.loadFraction = strtod(argv[++i], NULL) * 0.01;
+        }
+        else if((strcmp(argv[i], "-n") == 0) && ((i + 1) < argc))
+        {
+            config.settleSteps = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-w") == 0) && ((i + 1) < argc))
+        {
+            config.windowSteps = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-a") == 0) && ((i + 1) < argc))
+        {
+            config.averageSteps = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-b") == 0) && ((i + 1) < argc))
+        {
+            config.band = strtod(argv[++i], NULL) * 0.01;
+        }
+        else if((strcmp(argv[i], "-t") == 0) && ((i + 1) < argc))
+        {
+            config.timedSteps = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-p") == 0) && ((i + 1) < argc))
+        {
+            config.printDivider = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-d step] [-L percent] [-n steps] "
+                    "[-w steps] [-a steps] [-b percent] [-t steps] "
+                    "[-p divider]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    if((config.averageSteps == 0U) ||
+       (config.windowSteps < config.averageSteps) || (config.step == 0.0))
+    {
+        fprintf(stderr, "the window must hold the average, the step must "
+                "not be 0\n");
+        return(1);
+    }
+
+    CLLC_STEP_window = malloc(config.windowSteps * sizeof(float32_t));
+    if(CLLC_STEP_window == NULL)
+    {
+        fprintf(stderr, "window of %lu steps does not fit\n",
+                (unsigned long)config.windowSteps);
+        return(1);
+    }
+
+    CLLC_STEP_run(&config, &result);
+
+    printf("lab %u: reference %.3f -> %.3f %s at %.0f %% load\n",
+           (unsigned)CLLC_LAB, result.refBefore, result.refAfter,
+           CLLC_STEP_UNIT, config.loadFraction * 100.0);
+    printf("  before %.3f %s, final %.3f %s, error %+.3f %s\n",
+           result.before, CLLC_STEP_UNIT, result.final, CLLC_STEP_UNIT,
+           result.final - result.refAfter, CLLC_STEP_UNIT);
+    if(result.rise_ms < 0.0)
+    {
+        printf("  rise not reached in the window\n");
+    }
+    else
+    {
+        printf("  rise 10-90 %% %.3f ms\n", result.rise_ms);
+    }
+    printf("  overshoot %.1f %%, settling to %.1f %% %.3f ms\n",
+           result.overshoot_pct, config.band * 100.0, result.settling_ms);
+    printf("  %.1f kHz at the end%s\n", result.frequency_kHz,
+           result.tripped ? ", tripped" : "");
+    if((result.openLoop_ns > 0.0) && (result.closedLoop_ns > 0.0))
+    {
+        printf("  host %.0f ns per ISR2 period open loop, %.0f ns closed "
+               "loop\n", result.openLoop_ns, result.closedLoop_ns);
+    }
+
+    free(CLLC_STEP_window);
+    return(result.tripped ? 2 : 0);
+}
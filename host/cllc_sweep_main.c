@@ -0,0 +1,247 @@
+//#############################################################################
+//
+// FILE:   cllc_sweep_main.c
+//
+// TITLE:  Operating point sweep on the averaged plant
+//         Runs the firmware of the lab selected at build time against the
+//         averaged plant (cllc_plant_fha.h) over a grid of primary bus
+//         voltage and load, restarting the firmware at every point the same
+//         way as from the watch window, and prints the settled operating
+//         point. Build once per lab with -DCLLC_LAB=1..8. The closed loop
+//         labs run open loop for the first half of the settle time.
+//
+//         The swept voltage is the primary bus. It is the source for the
+//         prim to sec labs. For the sec to prim labs the primary bus is the
+//         output, so the closed loop lab takes it as CLLC_vPrimRef_Volts and
+//         the open loop labs scale the secondary source to the same
+//         conversion ratio.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -include host/cllc_emu_target.h -I. -Icllc -Ihost -Idevice
+//             -Idevice/driverlib -Ilibraries -DCLLC_LAB=<lab>
+//             host/cllc_emu.c host/cllc_emu_firmware.c host/cllc_sweep_main.c
+//             host/cllc_plant_fha.c cllc/cllc.c cllc/cllc_hal.c $(DRIVERLIB)
+//             -lm -o cllc_sweep_lab<lab>
+//         with DRIVERLIB the driverlib sources listed in host/README.md
+//
+//         Usage:
+//         cllc_sweep [-v min:max:points] [-l points] [-n steps] [-a steps]
+//           -v  primary bus voltage grid (default 350:450:11)
+//           -l  number of load points from 0 to 100 % (default 11)
+//           -n  ISR2 periods to settle after the start (default precharge
+//               plus 0.5 s)
+//           -a  ISR2 periods averaged at the end of the settle time
+//               (default 10 ms)
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "cllc.h"
+#include "cllc_emu.h"
+#include "cllc_plant_fha.h"
+
+static CLLC_PLANT_FHA_Plant CLLC_SWEEP_plant;
+
+typedef struct
+{
+    float64_t vPrim_Volts;
+    float64_t vSec_Volts;
+    float64_t iPrim_Amps;
+    float64_t iSec_Amps;
+    float64_t frequency_Hz;
+    uint32_t steps;             // ISR2 periods run for the point
+} CLLC_SWEEP_Result;
+
+static double CLLC_SWEEP_now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9));
+}
+
+//
+// Load resistance giving loadFraction of the rated power at the nominal
+// voltage of the receiving bus, no load is an open circuit
+//
+static float64_t CLLC_SWEEP_getLoad_Ohms(float64_t loadFraction)
+{
+    float64_t vOut;
+
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+        vOut = (float64_t)CLLC_VPRIM_NOMINAL_VOLTS;
+    #else
+        vOut = (float64_t)CLLC_VSEC_NOMINAL_VOLTS;
+    #endif
+
+    if(loadFraction <= 0.0)
+    {
+        return(INFINITY);
+    }
+    return((vOut * vOut) / (loadFraction * CLLC_PLANT_RATED_POWER_W));
+}
+
+//
+// One operating point from a cold start, returns 1 when the PWMs ended up
+// tripped
+//
+static uint16_t CLLC_SWEEP_runPoint(float64_t vPrim_Volts,
+                                    float64_t loadFraction,
+                                    uint32_t settleSteps,
+                                    uint32_t averageSteps,
+                                    CLLC_SWEEP_Result *result)
+{
+    CLLC_PLANT_FHA_Plant *plant = &CLLC_SWEEP_plant;
+    CLLC_PLANT_FHA_Params params;
+    uint32_t i;
+
+    CLLC_EMU_initFirmware();
+
+    CLLC_PLANT_FHA_setDefaultParams(&params);
+    params.rLoad_Ohms = CLLC_SWEEP_getLoad_Ohms(loadFraction);
+
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+        #if CLLC_INCR_BUILD == CLLC_CLOSED_LOOP_BUILD
+            CLLC_vPrimRef_Volts = (float32_t)vPrim_Volts;
+        #else
+            params.vSecSource_Volts = vPrim_Volts / params.turnsRatio;
+        #endif
+    #else
+        params.vPrimSource_Volts = vPrim_Volts;
+    #endif
+
+    CLLC_PLANT_FHA_init(plant, &params);
+    CLLC_EMU_setSampleHook(&CLLC_PLANT_FHA_sampleHook, plant);
+
+    CLLC_EMU_startFirmware();
+
+    //
+    // the closed loop labs are started open loop and the loop is closed
+    // once the buses have come up, as on the bench
+    //
+    CLLC_EMU_run(settleSteps / 2U);
+    settleSteps -= settleSteps / 2U;
+    settleSteps += CLLC_EMU_closeLoop();
+
+    CLLC_EMU_run(settleSteps);
+
+    memset(result, 0, sizeof(*result));
+    result->steps = CLLC_EMU_stats.step + averageSteps;
+
+    for(i = 0; i < averageSteps; i++)
+    {
+        CLLC_EMU_step();
+        result->vPrim_Volts += plant->sense.vPrim_Volts;
+        result->vSec_Volts += plant->sense.vSec_Volts;
+        result->iPrim_Amps += plant->sense.iPrim_Amps;
+        result->iSec_Amps += plant->sense.iSec_Amps;
+        result->frequency_Hz += plant->frequency_Hz;
+    }
+
+    if(averageSteps != 0U)
+    {
+        result->vPrim_Volts /= (float64_t)averageSteps;
+        result->vSec_Volts /= (float64_t)averageSteps;
+        result->iPrim_Amps /= (float64_t)averageSteps;
+        result->iSec_Amps /= (float64_t)averageSteps;
+        result->frequency_Hz /= (float64_t)averageSteps;
+    }
+
+    return(plant->tripped);
+}
+
+int main(int argc, char *argv[])
+{
+    float64_t vMin = 350.0, vMax = 450.0;
+    uint32_t vPoints = 11, loadPoints = 11;
+    uint32_t settleSteps, averageSteps;
+    uint64_t totalSteps = 0;
+    CLLC_SWEEP_Result result;
+    double start, elapsed;
+    uint32_t iv, il;
+    uint16_t tripped;
+    int i;
+
+    settleSteps = (uint32_t)(0.5f * CLLC_ISR2_FREQUENCY_HZ);
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_PRIM_SEC
+        settleSteps += (uint32_t)CLLC_CONTROL_PRECHARGE_COUNT;
+    #endif
+    averageSteps = (uint32_t)(0.01f * CLLC_ISR2_FREQUENCY_HZ);
+
+    for(i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "-v") == 0) && ((i + 1) < argc) &&
+           (sscanf(argv[i + 1], "%lf:%lf:%u", &vMin, &vMax,
+                   &vPoints) == 3))
+        {
+            i++;
+        }
+        else if((strcmp(argv[i], "-l") == 0) && ((i + 1) < argc))
+        {
+            loadPoints = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-n") == 0) && ((i + 1) < argc))
+        {
+            settleSteps = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-a") == 0) && ((i + 1) < argc))
+        {
+            averageSteps = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-v min:max:points] [-l points] "
+                    "[-n steps] [-a steps]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    if((vPoints == 0U) || (loadPoints == 0U))
+    {
+        fprintf(stderr, "empty grid\n");
+        return(1);
+    }
+
+    printf("# lab vPrimSweep loadPct vPrim vSec iPrim iSec fsw_kHz "
+           "tripped\n");
+
+    start = CLLC_SWEEP_now_s();
+
+    for(iv = 0; iv < vPoints; iv++)
+    {
+        float64_t v = (vPoints > 1U) ?
+                      (vMin + (((vMax - vMin) * (float64_t)iv) /
+                               (float64_t)(vPoints - 1U))) : vMin;
+
+        for(il = 0; il < loadPoints; il++)
+        {
+            float64_t load = (loadPoints > 1U) ?
+                             ((float64_t)il / (float64_t)(loadPoints - 1U)) :
+                             1.0;
+
+            tripped = CLLC_SWEEP_runPoint(v, load, settleSteps,
+                                          averageSteps, &result);
+            totalSteps += result.steps;
+
+            printf("%d %.1f %.1f %.2f %.2f %.3f %.3f %.2f %u\n",
+                   CLLC_LAB, v, load * 100.0, result.vPrim_Volts,
+                   result.vSec_Volts, result.iPrim_Amps, result.iSec_Amps,
+                   result.frequency_Hz * 1e-3, tripped);
+        }
+    }
+
+    elapsed = CLLC_SWEEP_now_s() - start;
+
+    fprintf(stderr, "lab %d: %lu points, %llu ISR2 periods in %.2f s, "
+            "%.2f M ISR2/s\n",
+            CLLC_LAB, (unsigned long)(vPoints * loadPoints),
+            (unsigned long long)totalSteps, elapsed,
+            ((double)totalSteps / elapsed) * 1e-6);
+
+    return(0);
+}
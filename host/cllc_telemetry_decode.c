@@ -0,0 +1,287 @@
+//#############################################################################
+//
+// FILE:   cllc_telemetry_decode.c
+//
+// TITLE:  Decoder of the binary telemetry stream, see cllc_telemetry_decode.h
+//
+//#############################################################################
+
+#include <string.h>
+#include "cllc_telemetry_decode.h"
+
+//
+// Defines, the frame layout of cllc_telemetry.h
+//
+#define CLLC_TELEMETRY_DECODE_SYNC0         0xA5U
+#define CLLC_TELEMETRY_DECODE_SYNC1         0x5AU
+#define CLLC_TELEMETRY_DECODE_SCHEMA        1U
+#define CLLC_TELEMETRY_DECODE_DATA          2U
+#define CLLC_TELEMETRY_DECODE_OVERHEAD      8U
+
+static uint16_t CLLC_TELEMETRY_DECODE_crcTable[256];
+static int CLLC_TELEMETRY_DECODE_crcTableReady;
+
+static void CLLC_TELEMETRY_DECODE_setupCRCTable(void)
+{
+    uint16_t crc;
+    int i, bit;
+
+    for(i = 0; i < 256; i++)
+    {
+        crc = (uint16_t)(i << 8);
+        for(bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) :
+                                    (uint16_t)(crc << 1);
+        }
+        CLLC_TELEMETRY_DECODE_crcTable[i] = crc;
+    }
+    CLLC_TELEMETRY_DECODE_crcTableReady = 1;
+}
+
+//
+// CRC-16/CCITT-FALSE, continuing from crc
+//
+uint16_t CLLC_TELEMETRY_DECODE_crc(uint16_t crc, const uint8_t *bytes,
+                                   size_t length)
+{
+    size_t i;
+
+    if(CLLC_TELEMETRY_DECODE_crcTableReady == 0)
+    {
+        CLLC_TELEMETRY_DECODE_setupCRCTable();
+    }
+
+    for(i = 0; i < length; i++)
+    {
+        crc = (uint16_t)(crc << 8) ^
+              CLLC_TELEMETRY_DECODE_crcTable[(crc >> 8) ^ bytes[i]];
+    }
+    return(crc);
+}
+
+void CLLC_TELEMETRY_DECODE_init(CLLC_TELEMETRY_DECODE_Decoder *decoder,
+                                CLLC_TELEMETRY_DECODE_Handler handler,
+                                void *context)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->handler = handler;
+    decoder->context = context;
+
+    if(CLLC_TELEMETRY_DECODE_crcTableReady == 0)
+    {
+        CLLC_TELEMETRY_DECODE_setupCRCTable();
+    }
+}
+
+static uint32_t CLLC_TELEMETRY_DECODE_get32(const uint8_t *bytes)
+{
+    return((uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+           ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24));
+}
+
+//
+// A schema payload that does not add up leaves the schema before in place
+//
+static void CLLC_TELEMETRY_DECODE_takeSchema(
+                        CLLC_TELEMETRY_DECODE_Decoder *decoder,
+                        const uint8_t *payload, size_t length)
+{
+    CLLC_TELEMETRY_DECODE_Schema schema;
+    size_t at = 7, nameLength;
+    uint16_t i;
+
+    if(length < 7U)
+    {
+        decoder->stats.unknownFrames++;
+        return;
+    }
+
+    schema.variables = payload[0];
+    schema.tickFrequency_Hz = CLLC_TELEMETRY_DECODE_get32(&payload[1]);
+    schema.decimation = (uint16_t)(payload[5] | (payload[6] << 8));
+
+    if(schema.variables > CLLC_TELEMETRY_DECODE_VARIABLES_MAX)
+    {
+        decoder->stats.unknownFrames++;
+        return;
+    }
+
+    for(i = 0; i < schema.variables; i++)
+    {
+        if(((at + 2U) > length) ||
+           ((payload[at] != CLLC_TELEMETRY_DECODE_FLOAT32) &&
+            (payload[at] != CLLC_TELEMETRY_DECODE_UINT32)))
+        {
+            decoder->stats.unknownFrames++;
+            return;
+        }
+        schema.type[i] = payload[at];
+        nameLength = payload[at + 1U];
+        at += 2U;
+        if((at + nameLength) > length)
+        {
+            decoder->stats.unknownFrames++;
+            return;
+        }
+        memcpy(schema.name[i], &payload[at], nameLength);
+        schema.name[i][nameLength] = '\0';
+        at += nameLength;
+    }
+
+    decoder->schema = schema;
+    decoder->haveSchema = 1;
+    decoder->stats.schemaFrames++;
+}
+
+static void CLLC_TELEMETRY_DECODE_takeData(
+                        CLLC_TELEMETRY_DECODE_Decoder *decoder,
+                        uint16_t sequence, const uint8_t *payload,
+                        size_t length)
+{
+    CLLC_TELEMETRY_DECODE_Value value[CLLC_TELEMETRY_DECODE_VARIABLES_MAX];
+    uint16_t i;
+
+    if((decoder->haveSchema == 0U) ||
+       (length != (4U + (4U * (size_t)decoder->schema.variables))))
+    {
+        decoder->stats.unknownFrames++;
+        return;
+    }
+
+    for(i = 0; i < decoder->schema.variables; i++)
+    {
+        value[i].count = CLLC_TELEMETRY_DECODE_get32(&payload[4U + (4U * i)]);
+    }
+
+    decoder->stats.dataFrames++;
+    if(decoder->handler != NULL)
+    {
+        decoder->handler(decoder->context, &decoder->schema, sequence,
+                         CLLC_TELEMETRY_DECODE_get32(payload), value);
+    }
+}
+
+//
+// Takes the frames of a piece, returns where the first frame that is not
+// complete in it starts
+//
+static size_t CLLC_TELEMETRY_DECODE_takeFrames(
+                        CLLC_TELEMETRY_DECODE_Decoder *decoder,
+                        const uint8_t *bytes, size_t length)
+{
+    const uint8_t *sync;
+    size_t i = 0, payloadLength, frameLength;
+    uint16_t crc, sequence;
+
+    while((length - i) >= CLLC_TELEMETRY_DECODE_OVERHEAD)
+    {
+        if(bytes[i] != CLLC_TELEMETRY_DECODE_SYNC0)
+        {
+            sync = memchr(&bytes[i + 1U], CLLC_TELEMETRY_DECODE_SYNC0,
+                          length - i - 1U);
+            if(sync == NULL)
+            {
+                decoder->stats.skippedBytes += length - i;
+                return(length);
+            }
+            decoder->stats.skippedBytes += (size_t)(sync - &bytes[i]);
+            i = (size_t)(sync - bytes);
+            continue;
+        }
+
+        if((bytes[i + 1U] != CLLC_TELEMETRY_DECODE_SYNC1) ||
+           ((bytes[i + 2U] != CLLC_TELEMETRY_DECODE_SCHEMA) &&
+            (bytes[i + 2U] != CLLC_TELEMETRY_DECODE_DATA)))
+        {
+            decoder->stats.skippedBytes++;
+            i++;
+            continue;
+        }
+
+        payloadLength = bytes[i + 3U];
+        frameLength = payloadLength + CLLC_TELEMETRY_DECODE_OVERHEAD;
+        if((length - i) < frameLength)
+        {
+            break;
+        }
+
+        crc = CLLC_TELEMETRY_DECODE_crc(0xFFFFU, &bytes[i + 2U],
+                                        4U + payloadLength);
+        if(crc != (uint16_t)(bytes[i + 6U + payloadLength] |
+                             (bytes[i + 7U + payloadLength] << 8)))
+        {
+            decoder->stats.crcErrors++;
+            decoder->stats.skippedBytes++;
+            i++;
+            continue;
+        }
+
+        sequence = (uint16_t)(bytes[i + 4U] | (bytes[i + 5U] << 8));
+        if(decoder->haveSequence != 0U)
+        {
+            decoder->stats.lostFrames +=
+                    (uint16_t)(sequence - decoder->nextSequence);
+        }
+        decoder->haveSequence = 1;
+        decoder->nextSequence = sequence + 1U;
+
+        if(bytes[i + 2U] == CLLC_TELEMETRY_DECODE_SCHEMA)
+        {
+            CLLC_TELEMETRY_DECODE_takeSchema(decoder, &bytes[i + 6U],
+                                             payloadLength);
+        }
+        else
+        {
+            CLLC_TELEMETRY_DECODE_takeData(decoder, sequence, &bytes[i + 6U],
+                                           payloadLength);
+        }
+
+        i += frameLength;
+    }
+
+    return(i);
+}
+
+//
+// A frame split over two pieces is put together in the carry, with at most
+// one frame worth of the new piece, the rest is decoded where it is
+//
+void CLLC_TELEMETRY_DECODE_feed(CLLC_TELEMETRY_DECODE_Decoder *decoder,
+                                const uint8_t *bytes, size_t length)
+{
+    size_t take, used;
+
+    decoder->stats.bytes += length;
+
+    if(decoder->carryLength != 0U)
+    {
+        take = (length < CLLC_TELEMETRY_DECODE_FRAME_MAX) ?
+               length : CLLC_TELEMETRY_DECODE_FRAME_MAX;
+        memcpy(&decoder->carry[decoder->carryLength], bytes, take);
+
+        used = CLLC_TELEMETRY_DECODE_takeFrames(decoder, decoder->carry,
+                                                decoder->carryLength + take);
+
+        if(used < decoder->carryLength)
+        {
+            //
+            // still short of the frame, the whole piece is in the carry
+            //
+            memmove(decoder->carry, &decoder->carry[used],
+                    decoder->carryLength + take - used);
+            decoder->carryLength = decoder->carryLength + take - used;
+            return;
+        }
+
+        used -= decoder->carryLength;
+        decoder->carryLength = 0;
+        bytes += used;
+        length -= used;
+    }
+
+    used = CLLC_TELEMETRY_DECODE_takeFrames(decoder, bytes, length);
+
+    decoder->carryLength = length - used;
+    memcpy(decoder->carry, &bytes[used], decoder->carryLength);
+}
@@ -0,0 +1,116 @@
+//#############################################################################
+//
+// FILE:   cllc_telemetry_decode.h
+//
+// TITLE:  Decoder of the binary telemetry stream of cllc_telemetry.h
+//         Takes the bytes as they come off the SCI or out of a capture
+//         file, in pieces of any size, and hands every data frame to a
+//         handler together with the schema it was sent under. A frame is
+//         taken only with its sync, a known type and a good CRC, on
+//         anything else the decoder steps one byte and looks for the next
+//         sync, so it starts and recovers anywhere in the stream. Frames
+//         lost on the way are counted from the gaps in the sequence.
+//
+//         Plain C on bytes, no device types, so it goes into any host tool.
+//
+//#############################################################################
+
+#ifndef CLLC_TELEMETRY_DECODE_H
+#define CLLC_TELEMETRY_DECODE_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include <stddef.h>
+
+//
+// Defines
+//
+#define CLLC_TELEMETRY_DECODE_FRAME_MAX     263U
+#define CLLC_TELEMETRY_DECODE_VARIABLES_MAX 64U
+#define CLLC_TELEMETRY_DECODE_NAME_MAX      255U
+
+#define CLLC_TELEMETRY_DECODE_FLOAT32       1U
+#define CLLC_TELEMETRY_DECODE_UINT32        2U
+
+//
+// typedefs
+//
+typedef struct
+{
+    uint16_t variables;
+    uint32_t tickFrequency_Hz;
+    uint16_t decimation;
+    uint16_t type[CLLC_TELEMETRY_DECODE_VARIABLES_MAX];
+    char name[CLLC_TELEMETRY_DECODE_VARIABLES_MAX]
+             [CLLC_TELEMETRY_DECODE_NAME_MAX + 1U];
+} CLLC_TELEMETRY_DECODE_Schema;
+
+//
+// a value as schema->type says, real for FLOAT32, count for UINT32
+//
+typedef union
+{
+    float real;
+    uint32_t count;
+} CLLC_TELEMETRY_DECODE_Value;
+
+//
+// one data frame, value holds schema->variables values
+//
+typedef void (*CLLC_TELEMETRY_DECODE_Handler)(
+                void *context, const CLLC_TELEMETRY_DECODE_Schema *schema,
+                uint16_t sequence, uint32_t tick,
+                const CLLC_TELEMETRY_DECODE_Value *value);
+
+typedef struct
+{
+    uint64_t bytes;             // fed
+    uint64_t schemaFrames;
+    uint64_t dataFrames;
+    uint64_t crcErrors;         // sync and header fine, CRC not
+    uint64_t skippedBytes;      // stepped over looking for a sync
+    uint64_t lostFrames;        // sequence numbers missing
+    uint64_t unknownFrames;     // data frames ahead of the first schema
+                                // or not matching it
+} CLLC_TELEMETRY_DECODE_Stats;
+
+typedef struct
+{
+    CLLC_TELEMETRY_DECODE_Schema schema;
+    uint16_t haveSchema;
+    uint16_t haveSequence;
+    uint16_t nextSequence;
+    CLLC_TELEMETRY_DECODE_Handler handler;
+    void *context;
+    CLLC_TELEMETRY_DECODE_Stats stats;
+
+    //
+    // the start of a frame the last piece ended in, with room for the
+    // rest of it
+    //
+    uint8_t carry[2U * CLLC_TELEMETRY_DECODE_FRAME_MAX];
+    size_t carryLength;
+} CLLC_TELEMETRY_DECODE_Decoder;
+
+//
+// the function prototypes
+//
+void CLLC_TELEMETRY_DECODE_init(CLLC_TELEMETRY_DECODE_Decoder *decoder,
+                                CLLC_TELEMETRY_DECODE_Handler handler,
+                                void *context);
+void CLLC_TELEMETRY_DECODE_feed(CLLC_TELEMETRY_DECODE_Decoder *decoder,
+                                const uint8_t *bytes, size_t length);
+uint16_t CLLC_TELEMETRY_DECODE_crc(uint16_t crc, const uint8_t *bytes,
+                                   size_t length);
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
@@ -0,0 +1,567 @@
+//#############################################################################
+//
+// FILE:   cllc_telemetry_main.c
+//
+// TITLE:  Telemetry stream check, capture file writer and decoder
+//         Without options it encodes a stream of synthetic variables, and a
+//         counter that runs through all 32 bit patterns, with the firmware
+//         encoder (cllc_telemetry.c), the ring drained in
+//         pieces of random size as the SCI transmit interrupt does at the
+//         line rate of the firmware, once decimated to fit the line and
+//         once not so frames are dropped. Then it
+//         decodes the stream in pieces of random size and checks every
+//         sample against the values encoded and the lost frame count
+//         against the frames the encoder dropped, decodes a copy with
+//         random bytes corrupted to check nothing wrong gets through, and
+//         times the decoder over a large stream.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -Wno-unknown-pragmas -Icllc -Ihost
+//             host/cllc_telemetry_main.c host/cllc_telemetry_decode.c
+//             cllc/cllc_telemetry.c -o cllc_telemetry
+//
+//         Usage:
+//         cllc_telemetry [-w file] [-n frames] [-r file] [-c] [-m MB]
+//           -w  write a synthetic stream of -n frames (default 100000)
+//           -r  decode a captured stream, print the schema and the counts
+//           -c  with -r, print every sample as tick,seq,values CSV
+//           -m  MB of stream to time the decoder over (default 256)
+//
+//         Exits 0 when all checks pass.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cllc_telemetry.h"
+#include "cllc_telemetry_decode.h"
+#include "cllc_check.h"
+
+//
+// Defines
+//
+#define CLLC_TELEMETRY_MAIN_VARIABLES   9U
+#define CLLC_TELEMETRY_MAIN_COUNTER     8U      // the one uint32 variable
+#define CLLC_TELEMETRY_MAIN_RING_SIZE   1024U
+#define CLLC_TELEMETRY_MAIN_PIECE       65536U
+
+//
+// the bytes the SCI sends per tick, 1.875 Mbaud 8N1 (LSPCLK / 16, as
+// CLLC_TELEMETRY_SCI_BAUDRATE) per 10 kHz ISR3 run, and the decimation that
+// fits the 48 byte frames of the variables below into it
+//
+#define CLLC_TELEMETRY_MAIN_LINE_BYTES  18U
+#define CLLC_TELEMETRY_MAIN_LINE_DECIMATION 3U
+
+//
+// typedefs
+//
+typedef struct
+{
+    uint64_t samples;
+    uint64_t wrong;
+    uint16_t printCSV;
+} CLLC_TELEMETRY_MAIN_Check;
+
+static const char *CLLC_TELEMETRY_MAIN_name[CLLC_TELEMETRY_MAIN_VARIABLES] =
+{
+    "vSecSensed", "iSecSensed", "vPrimSensed", "iPrimSensed",
+    "pwmPeriod", "giOut", "gvOut", "a_long_variable_name", "isr2Overrun"
+};
+
+static float32_t CLLC_TELEMETRY_MAIN_value[CLLC_TELEMETRY_MAIN_VARIABLES];
+static uint32_t CLLC_TELEMETRY_MAIN_count;
+static volatile uint16_t CLLC_TELEMETRY_MAIN_ring[CLLC_TELEMETRY_MAIN_RING_SIZE];
+
+//
+// splitmix64, as cllc_mc_main.c
+//
+static uint64_t CLLC_TELEMETRY_MAIN_nextRandom(uint64_t *state)
+{
+    uint64_t z;
+
+    *state += 0x9E3779B97F4A7C15ULL;
+    z = *state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return(z ^ (z >> 31));
+}
+
+static double CLLC_TELEMETRY_MAIN_now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9));
+}
+
+//
+// The variables at a tick, exact in float32 so the check can compare bits
+//
+static float32_t CLLC_TELEMETRY_MAIN_getValue(uint32_t tick, uint16_t i)
+{
+    return((float32_t)((tick * (i + 1U)) & 0xFFFFFU) * 0.125f -
+           (float32_t)i);
+}
+
+//
+// The counter at a tick, NaN and denormal patterns included
+//
+static uint32_t CLLC_TELEMETRY_MAIN_getCount(uint32_t tick)
+{
+    return(tick * 2654435761UL);
+}
+
+//
+// Runs the encoder for frames data frames, the transmit side taking
+// between 0 and 2 * bytesPerRun bytes after each run. Frames dropped at the
+// very end leave no gap a decoder could see, so it runs on until one gets
+// through, the frames it took in all go to encoded when that is not NULL.
+// Returns the length.
+//
+static size_t CLLC_TELEMETRY_MAIN_encode(uint8_t *out, size_t capacity,
+                                         uint32_t frames, uint16_t decimation,
+                                         uint16_t bytesPerRun,
+                                         uint32_t *dropped, uint32_t *encoded)
+{
+    CLLC_TELEMETRY_Stream stream;
+    uint16_t piece[2U * CLLC_TELEMETRY_MAIN_RING_SIZE];
+    uint64_t state = 7;
+    size_t length = 0;
+    uint32_t droppedBefore, sentBefore;
+    uint16_t count, maxBytes, i;
+    uint16_t tailDropped = 0;
+
+    CLLC_TELEMETRY_config(&stream, CLLC_TELEMETRY_MAIN_ring,
+                          CLLC_TELEMETRY_MAIN_RING_SIZE, 10000, decimation,
+                          100);
+    for(i = 0; i < CLLC_TELEMETRY_MAIN_COUNTER; i++)
+    {
+        CLLC_TELEMETRY_addVariable(&stream, CLLC_TELEMETRY_MAIN_name[i],
+                                   &CLLC_TELEMETRY_MAIN_value[i]);
+    }
+    CLLC_TELEMETRY_addCounter(&stream,
+                              CLLC_TELEMETRY_MAIN_name[
+                                      CLLC_TELEMETRY_MAIN_COUNTER],
+                              &CLLC_TELEMETRY_MAIN_count);
+
+    while(((stream.sentFrames + stream.droppedFrames) < frames) ||
+          (tailDropped != 0U))
+    {
+        droppedBefore = stream.droppedFrames;
+        sentBefore = stream.sentFrames;
+
+        for(i = 0; i < CLLC_TELEMETRY_MAIN_COUNTER; i++)
+        {
+            CLLC_TELEMETRY_MAIN_value[i] =
+                    CLLC_TELEMETRY_MAIN_getValue(stream.tick, i);
+        }
+        CLLC_TELEMETRY_MAIN_count = CLLC_TELEMETRY_MAIN_getCount(stream.tick);
+        (void)CLLC_TELEMETRY_run(&stream);
+        if(stream.droppedFrames != droppedBefore)
+        {
+            tailDropped = 1;
+        }
+        else if(stream.sentFrames != sentBefore)
+        {
+            tailDropped = 0;
+        }
+
+        maxBytes = (uint16_t)(CLLC_TELEMETRY_MAIN_nextRandom(&state) %
+                              (2U * bytesPerRun + 1U));
+        count = CLLC_TELEMETRY_read(&stream, piece, maxBytes);
+        for(i = 0; (i < count) && (length < capacity); i++)
+        {
+            out[length++] = (uint8_t)piece[i];
+        }
+    }
+
+    do
+    {
+        count = CLLC_TELEMETRY_read(&stream, piece, sizeof(piece) /
+                                                    sizeof(piece[0]));
+        for(i = 0; (i < count) && (length < capacity); i++)
+        {
+            out[length++] = (uint8_t)piece[i];
+        }
+    }
+    while(count != 0U);
+
+    *dropped = stream.droppedFrames;
+    if(encoded != NULL)
+    {
+        *encoded = stream.sentFrames + stream.droppedFrames;
+    }
+    return(length);
+}
+
+static void CLLC_TELEMETRY_MAIN_checkSample(
+                void *context, const CLLC_TELEMETRY_DECODE_Schema *schema,
+                uint16_t sequence, uint32_t tick,
+                const CLLC_TELEMETRY_DECODE_Value *value)
+{
+    CLLC_TELEMETRY_MAIN_Check *check = context;
+    float32_t expected;
+    uint16_t i;
+
+    (void)sequence;
+
+    check->samples++;
+    for(i = 0; i < schema->variables; i++)
+    {
+        if(i == CLLC_TELEMETRY_MAIN_COUNTER)
+        {
+            if((schema->type[i] != CLLC_TELEMETRY_DECODE_UINT32) ||
+               (value[i].count != CLLC_TELEMETRY_MAIN_getCount(tick)))
+            {
+                check->wrong++;
+                return;
+            }
+            continue;
+        }
+
+        expected = CLLC_TELEMETRY_MAIN_getValue(tick, i);
+        if((schema->type[i] != CLLC_TELEMETRY_DECODE_FLOAT32) ||
+           (memcmp(&expected, &value[i].real, sizeof(float)) != 0))
+        {
+            check->wrong++;
+            return;
+        }
+    }
+}
+
+static void CLLC_TELEMETRY_MAIN_printSample(
+                void *context, const CLLC_TELEMETRY_DECODE_Schema *schema,
+                uint16_t sequence, uint32_t tick,
+                const CLLC_TELEMETRY_DECODE_Value *value)
+{
+    CLLC_TELEMETRY_MAIN_Check *check = context;
+    uint16_t i;
+
+    check->samples++;
+    if(check->printCSV != 0U)
+    {
+        printf("%lu,%u", (unsigned long)tick, (unsigned)sequence);
+        for(i = 0; i < schema->variables; i++)
+        {
+            if(schema->type[i] == CLLC_TELEMETRY_DECODE_UINT32)
+            {
+                printf(",%lu", (unsigned long)value[i].count);
+            }
+            else
+            {
+                printf(",%.9g", value[i].real);
+            }
+        }
+        printf("\n");
+    }
+}
+
+//
+// Decodes in pieces of 1 to maxPiece bytes
+//
+static void CLLC_TELEMETRY_MAIN_decode(CLLC_TELEMETRY_DECODE_Decoder *decoder,
+                                       const uint8_t *bytes, size_t length,
+                                       size_t maxPiece, uint64_t seed)
+{
+    uint64_t state = seed;
+    size_t at = 0, piece;
+
+    while(at < length)
+    {
+        piece = 1U + (size_t)(CLLC_TELEMETRY_MAIN_nextRandom(&state) %
+                              maxPiece);
+        if(piece > (length - at))
+        {
+            piece = length - at;
+        }
+        CLLC_TELEMETRY_DECODE_feed(decoder, &bytes[at], piece);
+        at += piece;
+    }
+}
+
+static void CLLC_TELEMETRY_MAIN_printStats(const char *name,
+                                           const CLLC_TELEMETRY_DECODE_Stats *s)
+{
+    printf("%-10s %10llu bytes, %8llu data, %5llu schema, %5llu lost, "
+           "%6llu CRC errors, %8llu skipped, %3llu unknown\n", name,
+           (unsigned long long)s->bytes, (unsigned long long)s->dataFrames,
+           (unsigned long long)s->schemaFrames,
+           (unsigned long long)s->lostFrames,
+           (unsigned long long)s->crcErrors,
+           (unsigned long long)s->skippedBytes,
+           (unsigned long long)s->unknownFrames);
+}
+
+//
+// Encode, decode, corrupt and time
+//
+static void CLLC_TELEMETRY_MAIN_runChecks(uint32_t megabytes)
+{
+    const uint32_t frames = 200000;
+    size_t capacity = (size_t)frames * 64U;
+    uint8_t *stream = malloc(capacity);
+    uint8_t *corrupt = malloc(capacity);
+    uint8_t *large;
+    CLLC_TELEMETRY_DECODE_Decoder decoder;
+    CLLC_TELEMETRY_MAIN_Check check;
+    size_t length, largeLength, at, i;
+    uint32_t dropped, encoded;
+    uint64_t state = 11, dataFrames;
+    double start, seconds;
+    const char *name;
+    uint16_t pass;
+
+    if((stream == NULL) || (corrupt == NULL))
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    //
+    // the line rate of the firmware, with a decimation it carries and
+    // without
+    //
+    for(pass = 0; pass < 2U; pass++)
+    {
+        name = (pass == 0U) ? "clean" : "dropping";
+        length = CLLC_TELEMETRY_MAIN_encode(stream, capacity, frames,
+                                            (pass == 0U) ?
+                                            CLLC_TELEMETRY_MAIN_LINE_DECIMATION :
+                                            1U,
+                                            CLLC_TELEMETRY_MAIN_LINE_BYTES,
+                                            &dropped, &encoded);
+
+        memset(&check, 0, sizeof(check));
+        CLLC_TELEMETRY_DECODE_init(&decoder, &CLLC_TELEMETRY_MAIN_checkSample,
+                                   &check);
+        CLLC_TELEMETRY_MAIN_decode(&decoder, stream, length, 700,
+                                   13 + pass);
+        CLLC_TELEMETRY_MAIN_printStats(name, &decoder.stats);
+
+        if((decoder.stats.dataFrames + decoder.stats.schemaFrames +
+            decoder.stats.lostFrames) != encoded)
+        {
+            CLLC_CHECK_failValue(name, "frames", encoded,
+                                 decoder.stats.dataFrames +
+                                 decoder.stats.schemaFrames +
+                                 decoder.stats.lostFrames);
+        }
+        if(decoder.stats.lostFrames != dropped)
+        {
+            CLLC_CHECK_failValue(name, "lost frames", dropped,
+                                 decoder.stats.lostFrames);
+        }
+        if((pass == 0U) && (dropped != 0U))
+        {
+            CLLC_CHECK_failValue(name, "frames dropped at the line rate", 0,
+                                 dropped);
+        }
+        if((pass == 1U) && (dropped == 0U))
+        {
+            CLLC_CHECK_failValue(name, "frames dropped by a slow SCI", 1, 0);
+        }
+        if((check.wrong != 0U) || (decoder.stats.crcErrors != 0U) ||
+           (decoder.stats.skippedBytes != 0U) ||
+           (decoder.stats.unknownFrames != 0U))
+        {
+            CLLC_CHECK_failValue(name, "wrong samples and errors", 0,
+                                 check.wrong + decoder.stats.crcErrors +
+                                 decoder.stats.skippedBytes +
+                                 decoder.stats.unknownFrames);
+        }
+    }
+
+    //
+    // one byte in 500 changed, the decoder has to resync and must not hand
+    // out a single wrong sample
+    //
+    length = CLLC_TELEMETRY_MAIN_encode(stream, capacity, frames, 1, 64,
+                                        &dropped, NULL);
+    memcpy(corrupt, stream, length);
+    for(i = 0; i < (length / 500U); i++)
+    {
+        at = (size_t)(CLLC_TELEMETRY_MAIN_nextRandom(&state) % length);
+        corrupt[at] ^= (uint8_t)(1U + (CLLC_TELEMETRY_MAIN_nextRandom(&state)
+                                       % 255U));
+    }
+    memset(&check, 0, sizeof(check));
+    CLLC_TELEMETRY_DECODE_init(&decoder, &CLLC_TELEMETRY_MAIN_checkSample,
+                               &check);
+    CLLC_TELEMETRY_MAIN_decode(&decoder, corrupt, length, 4096, 17);
+    CLLC_TELEMETRY_MAIN_printStats("corrupted", &decoder.stats);
+    if(check.wrong != 0U)
+    {
+        CLLC_CHECK_failValue("corrupted",
+                             "wrong samples through a corrupted stream", 0,
+                             check.wrong);
+    }
+    if(decoder.stats.dataFrames < ((uint64_t)frames * 8U / 10U))
+    {
+        CLLC_CHECK_failValue("corrupted", "data frames recovered",
+                             frames * 8U / 10U, decoder.stats.dataFrames);
+    }
+
+    //
+    // decoder throughput, the clean stream over and over in pieces of 64 kB
+    //
+    if(megabytes != 0U)
+    {
+        length = CLLC_TELEMETRY_MAIN_encode(stream, capacity, frames, 1, 64,
+                                            &dropped, NULL);
+        largeLength = (size_t)megabytes << 20;
+        large = malloc(largeLength);
+        if(large == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        for(at = 0; at < largeLength; at += i)
+        {
+            i = ((largeLength - at) < length) ? (largeLength - at) : length;
+            memcpy(&large[at], stream, i);
+        }
+
+        memset(&check, 0, sizeof(check));
+        CLLC_TELEMETRY_DECODE_init(&decoder,
+                                   &CLLC_TELEMETRY_MAIN_printSample, &check);
+        start = CLLC_TELEMETRY_MAIN_now_s();
+        for(at = 0; at < largeLength; at += CLLC_TELEMETRY_MAIN_PIECE)
+        {
+            i = ((largeLength - at) < CLLC_TELEMETRY_MAIN_PIECE) ?
+                (largeLength - at) : CLLC_TELEMETRY_MAIN_PIECE;
+            CLLC_TELEMETRY_DECODE_feed(&decoder, &large[at], i);
+        }
+        seconds = CLLC_TELEMETRY_MAIN_now_s() - start;
+        dataFrames = decoder.stats.dataFrames;
+
+        printf("decoder: %u MB in %.3f s, %.0f MB/s, %.1f M samples/s\n",
+               (unsigned)megabytes, seconds, (double)megabytes / seconds,
+               (double)dataFrames * CLLC_TELEMETRY_MAIN_VARIABLES /
+               seconds * 1e-6);
+        free(large);
+    }
+
+    free(stream);
+    free(corrupt);
+}
+
+int main(int argc, char *argv[])
+{
+    CLLC_TELEMETRY_DECODE_Decoder decoder;
+    CLLC_TELEMETRY_MAIN_Check check;
+    const char *writeName = NULL;
+    const char *readName = NULL;
+    uint32_t frames = 100000;
+    uint32_t megabytes = 256;
+    uint16_t printCSV = 0;
+    uint8_t *bytes;
+    size_t length, capacity;
+    uint32_t dropped;
+    double start, seconds;
+    FILE *file;
+    uint16_t i;
+    int a;
+
+    for(a = 1; a < argc; a++)
+    {
+        if((strcmp(argv[a], "-w") == 0) && ((a + 1) < argc))
+        {
+            writeName = argv[++a];
+        }
+        else if((strcmp(argv[a], "-r") == 0) && ((a + 1) < argc))
+        {
+            readName = argv[++a];
+        }
+        else if((strcmp(argv[a], "-n") == 0) && ((a + 1) < argc))
+        {
+            frames = (uint32_t)strtoul(argv[++a], NULL, 0);
+        }
+        else if((strcmp(argv[a], "-m") == 0) && ((a + 1) < argc))
+        {
+            megabytes = (uint32_t)strtoul(argv[++a], NULL, 0);
+        }
+        else if(strcmp(argv[a], "-c") == 0)
+        {
+            printCSV = 1;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-w file] [-n frames] [-r file] [-c] "
+                    "[-m MB]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    if(writeName != NULL)
+    {
+        capacity = (size_t)frames * 64U;
+        bytes = malloc(capacity);
+        file = fopen(writeName, "wb");
+        if((bytes == NULL) || (file == NULL))
+        {
+            fprintf(stderr, "cannot write %s\n", writeName);
+            return(1);
+        }
+        length = CLLC_TELEMETRY_MAIN_encode(bytes, capacity, frames, 1, 64,
+                                            &dropped, NULL);
+        fwrite(bytes, 1, length, file);
+        fclose(file);
+        free(bytes);
+        printf("%s: %lu bytes, %lu frames\n", writeName,
+               (unsigned long)length, (unsigned long)frames);
+        return(0);
+    }
+
+    if(readName != NULL)
+    {
+        file = fopen(readName, "rb");
+        if(file == NULL)
+        {
+            fprintf(stderr, "cannot read %s\n", readName);
+            return(1);
+        }
+        fseek(file, 0, SEEK_END);
+        length = (size_t)ftell(file);
+        fseek(file, 0, SEEK_SET);
+        bytes = malloc(length + 1U);
+        if((bytes == NULL) || (fread(bytes, 1, length, file) != length))
+        {
+            fprintf(stderr, "cannot read %s\n", readName);
+            return(1);
+        }
+        fclose(file);
+
+        memset(&check, 0, sizeof(check));
+        check.printCSV = printCSV;
+        CLLC_TELEMETRY_DECODE_init(&decoder,
+                                   &CLLC_TELEMETRY_MAIN_printSample, &check);
+        start = CLLC_TELEMETRY_MAIN_now_s();
+        CLLC_TELEMETRY_DECODE_feed(&decoder, bytes, length);
+        seconds = CLLC_TELEMETRY_MAIN_now_s() - start;
+        free(bytes);
+
+        if(printCSV == 0U)
+        {
+            printf("schema: %u variables, tick %lu Hz, decimation %u\n",
+                   (unsigned)decoder.schema.variables,
+                   (unsigned long)decoder.schema.tickFrequency_Hz,
+                   (unsigned)decoder.schema.decimation);
+            for(i = 0; i < decoder.schema.variables; i++)
+            {
+                printf("  %2u %s%s\n", (unsigned)i, decoder.schema.name[i],
+                       (decoder.schema.type[i] ==
+                        CLLC_TELEMETRY_DECODE_UINT32) ? " (counter)" : "");
+            }
+            CLLC_TELEMETRY_MAIN_printStats(readName, &decoder.stats);
+            printf("%.0f MB/s\n", (double)length / seconds * 1e-6);
+        }
+        return(0);
+    }
+
+    CLLC_TELEMETRY_MAIN_runChecks(megabytes);
+
+    return(CLLC_CHECK_result());
+}
@@ -0,0 +1,510 @@
+//#############################################################################
+//
+// FILE:   cllc_ticks_bench.c
+//
+// TITLE:  Bit compatibility check and timing of the PWM tick calculation
+//         ISR3 works the duty and phase shift factors out when it takes a
+//         new reference (CLLC_calculatePWMDutyPhaseShiftFactors_*), ISR2
+//         only takes them and reuses the ISR1 trigger ticks of the previous
+//         update, so a change of the switching frequency only runs the
+//         period dependent part of the tick calculation. This runner holds
+//         verbatim copies of the tick calculation as it was before, and
+//         compares the period, duty, phase shift and ISR1 trigger ticks of
+//         both for every float32 period in [CLLC_pwmPeriodMin_pu, 1] at a
+//         set of duty and phase shift references, for both power flows.
+//         Then it times one update of either on the host, for the firmware
+//         also the worst case, a new reference in the same ISR2 as the
+//         change of the frequency.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -include host/cllc_emu_target.h -I. -Icllc -Ihost -Idevice
+//             -Idevice/driverlib -Ilibraries
+//             host/cllc_emu.c host/cllc_emu_firmware.c
+//             host/cllc_ticks_bench.c cllc/cllc.c cllc/cllc_hal.c
+//             $(DRIVERLIB) -lm -o cllc_ticks_bench
+//         with DRIVERLIB the driverlib sources listed in host/README.md.
+//
+//         Usage:
+//         cllc_ticks_bench [-s stride] [-t updates]
+//           -s  check every stride-th float32 period (default 1, all)
+//           -t  updates to time per variant (default 10000000)
+//
+//         Each reference and power flow whose ticks differ from the copy
+//         at some period is one failure. Exits 0 when all ticks match.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "cllc.h"
+#include "cllc_check.h"
+
+//
+// typedefs
+//
+typedef struct
+{
+    uint32_t period;
+    uint32_t dutyAPrim;
+    uint32_t dutyBPrim;
+    uint32_t dutyASec;
+    uint32_t dutyBSec;
+    int32_t phaseShift;
+    uint16_t isrTrig;
+} CLLC_TICKS_Result;
+
+typedef struct
+{
+    float32_t dutyPrim_pu;
+    float32_t dutySec_pu;
+    float32_t phaseShift_ns;
+} CLLC_TICKS_Ref;
+
+//
+// duty and phase shift references, as set by the labs and the closed loops
+//
+static const CLLC_TICKS_Ref CLLC_TICKS_ref[] =
+{
+    {0.5f, 0.5f, 0.0f},
+    {0.5f, 0.5f, 50.0f},
+    {0.5f, 0.5f, -50.0f},
+    {0.45f, 0.3f, 120.5f},
+    {-0.5f, 0.25f, 1000.0f},
+    {0.1f, 0.9f, 3.3f},
+};
+
+#define CLLC_TICKS_REF_COUNT    (sizeof(CLLC_TICKS_ref) /                     \
+                                 sizeof(CLLC_TICKS_ref[0]))
+
+//
+// the tick calculation before the factors were hoisted, verbatim apart from
+// taking its inputs as arguments and returning the ticks
+//
+static void CLLC_TICKS_referencePrimToSec(float32_t periodSlewed_pu,
+                                          float32_t dutyPrim_pu,
+                                          float32_t dutySec_pu,
+                                          float32_t phaseShift_ns,
+                                          CLLC_TICKS_Result *r)
+{
+    uint32_t temp;
+    float32_t frequency_Hz;
+
+    temp = ((uint32_t)(((float32_t)(periodSlewed_pu *
+                                   CLLC_pwmPeriodMax_ticks) *
+                       (float32_t)TWO_RAISED_TO_THE_POWER_SIXTEEN)))>> 1;
+
+    r->period = temp & 0xFFFFFF00;
+
+    r->dutyAPrim = (uint32_t)((float32_t)r->period *
+                              (float32_t)
+                              (1 - fabsf(dutyPrim_pu)));
+
+    r->dutyBPrim = r->dutyAPrim;
+
+    if((r->dutyAPrim & 0x00FF00) == 0)
+    {
+        r->dutyAPrim = r->dutyAPrim | 0x000100;
+    }
+
+    r->dutyASec = (uint32_t)((float32_t)r->period *
+                             (float32_t)
+                             (fabsf(dutySec_pu))) << 1;
+
+    r->dutyBSec = (r->period) - r->dutyASec;
+
+    r->phaseShift = ((int32_t)(r->period >> 1) -
+                     (int32_t)((float32_t)phaseShift_ns *
+                               CLLC_PWMSYSCLOCK_FREQ_HZ * ONE_NANO_SEC *
+                               TWO_RAISED_TO_THE_POWER_SIXTEEN) +
+                     ((int32_t)2 << 16));
+
+    r->phaseShift = r->phaseShift & 0xFFFF0000;
+
+    frequency_Hz = (CLLC_PWMSYSCLOCK_FREQ_HZ /
+                    (periodSlewed_pu * CLLC_pwmPeriodMax_ticks));
+
+#if CLLC_ISR1_RUNNING_ON == CLA_CORE
+    r->isrTrig = ((TICKS_IN_PWM_FREQUENCY(frequency_Hz,
+                                          CLLC_PWMSYSCLOCK_FREQ_HZ)>> 1) - 20);
+#else
+    r->isrTrig = ((TICKS_IN_PWM_FREQUENCY(frequency_Hz,
+                                          CLLC_PWMSYSCLOCK_FREQ_HZ)>> 1) - 27);
+#endif
+}
+
+static void CLLC_TICKS_referenceSecToPrim(float32_t periodSlewed_pu,
+                                          float32_t dutyPrim_pu,
+                                          float32_t dutySec_pu,
+                                          float32_t phaseShift_ns,
+                                          CLLC_TICKS_Result *r)
+{
+    uint32_t temp;
+    float32_t frequency_Hz;
+
+    temp = ((uint32_t)(((float32_t)(periodSlewed_pu *
+                                   CLLC_pwmPeriodMax_ticks) *
+                       (float32_t)TWO_RAISED_TO_THE_POWER_SIXTEEN)))>> 1;
+
+    r->period = temp & 0xFFFFFF00;
+
+    r->dutyASec = (uint32_t)((float32_t)r->period *
+                             (float32_t)
+                             (1 - fabsf(dutySec_pu)));
+
+    r->dutyBSec = r->dutyASec;
+
+    r->dutyAPrim = (uint32_t)((float32_t)r->period *
+                              (float32_t)
+                              (fabsf(dutyPrim_pu))) << 1;
+
+    r->dutyBPrim = (r->period) - r->dutyAPrim;
+
+    if((r->dutyASec & 0x00FF00) == 0)
+    {
+        r->dutyASec = r->dutyASec | 0x000100;
+    }
+
+    r->phaseShift = ((int32_t)(r->period >> 1) +
+                     (int32_t)((float32_t)phaseShift_ns *
+                               CLLC_PWMSYSCLOCK_FREQ_HZ * ONE_NANO_SEC) +
+                     ((int32_t)2 << 16));
+
+    frequency_Hz = (CLLC_PWMSYSCLOCK_FREQ_HZ /
+                    (periodSlewed_pu * CLLC_pwmPeriodMax_ticks));
+
+#if CLLC_ISR1_RUNNING_ON == CLA_CORE
+    r->isrTrig = ((TICKS_IN_PWM_FREQUENCY(frequency_Hz,
+                                          CLLC_PWMSYSCLOCK_FREQ_HZ)>> 1) - 20);
+#else
+    r->isrTrig = ((TICKS_IN_PWM_FREQUENCY(frequency_Hz,
+                                          CLLC_PWMSYSCLOCK_FREQ_HZ)>> 1) - 27);
+#endif
+}
+
+//
+// the firmware path, the ticks are left in the firmware globals. The factors
+// of a reference are worked out as by ISR3.
+//
+static void CLLC_TICKS_calculateFactors(const CLLC_TICKS_Ref *ref,
+                                        uint16_t secToPrim,
+                                        CLLC_PWMFactors *f)
+{
+    CLLC_pwmDutyPrim_pu = ref->dutyPrim_pu;
+    CLLC_pwmDutySec_pu = ref->dutySec_pu;
+    CLLC_pwmPhaseShiftPrimSec_ns = ref->phaseShift_ns;
+
+    if(secToPrim)
+    {
+        CLLC_calculatePWMDutyPhaseShiftFactors_secToPrimPowerFlow(f);
+    }
+    else
+    {
+        CLLC_calculatePWMDutyPhaseShiftFactors_primToSecPowerFlow(f);
+    }
+}
+
+static void CLLC_TICKS_setRef(const CLLC_TICKS_Ref *ref, uint16_t secToPrim)
+{
+    CLLC_PWMFactors factors;
+
+    CLLC_TICKS_calculateFactors(ref, secToPrim, &factors);
+    CLLC_setPWMDutyPhaseShiftFactors(&factors);
+}
+
+static void CLLC_TICKS_firmware(float32_t periodSlewed_pu, uint16_t secToPrim,
+                                CLLC_TICKS_Result *r)
+{
+    CLLC_pwmPeriodSlewed_pu = periodSlewed_pu;
+    CLLC_pwmFrequency_Hz = (CLLC_PWMSYSCLOCK_FREQ_HZ /
+                             (CLLC_pwmPeriodSlewed_pu *
+                              CLLC_pwmPeriodMax_ticks));
+
+    if(secToPrim)
+    {
+        CLLC_calculatePWMDutyPeriodPhaseShiftTicks_secToPrimPowerFlow();
+    }
+    else
+    {
+        CLLC_calculatePWMDutyPeriodPhaseShiftTicks_primToSecPowerFlow();
+    }
+
+    CLLC_pwmISRTrig_ticks = CLLC_HAL_getISR1TriggerTicks(CLLC_pwmFrequency_Hz);
+
+    r->period = CLLC_pwmPeriod_ticks;
+    r->dutyAPrim = CLLC_pwmDutyAPrim_ticks;
+    r->dutyBPrim = CLLC_pwmDutyBPrim_ticks;
+    r->dutyASec = CLLC_pwmDutyASec_ticks;
+    r->dutyBSec = CLLC_pwmDutyBSec_ticks;
+    r->phaseShift = CLLC_pwmPhaseShiftPrimSec_ticks;
+    r->isrTrig = CLLC_pwmISRTrig_ticks;
+}
+
+static uint32_t CLLC_TICKS_compare(const CLLC_TICKS_Result *a,
+                                   const CLLC_TICKS_Result *b)
+{
+    return((a->period != b->period) || (a->dutyAPrim != b->dutyAPrim) ||
+           (a->dutyBPrim != b->dutyBPrim) || (a->dutyASec != b->dutyASec) ||
+           (a->dutyBSec != b->dutyBSec) || (a->phaseShift != b->phaseShift) ||
+           (a->isrTrig != b->isrTrig));
+}
+
+static double CLLC_TICKS_now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return((double)t.tv_sec + (double)t.tv_nsec * 1.0e-9);
+}
+
+//
+// checks every stride-th float32 from the minimum period up to 1 pu, a
+// reference with mismatching periods fails with the first of them. Returns
+// the number of mismatching periods.
+//
+static uint32_t CLLC_TICKS_check(uint16_t secToPrim, uint32_t stride,
+                                 uint32_t *checked)
+{
+    uint32_t total = 0;
+    uint32_t mismatches, periods;
+    uint32_t i, step;
+    float32_t p, firstPeriod = 0.0f;
+    CLLC_TICKS_Result ref, fw, first, firstFw;
+
+    for(i = 0; i < CLLC_TICKS_REF_COUNT; i++)
+    {
+        const CLLC_TICKS_Ref *r = &CLLC_TICKS_ref[i];
+
+        CLLC_TICKS_setRef(r, secToPrim);
+        mismatches = 0;
+        periods = 0;
+
+        for(p = CLLC_pwmPeriodMin_pu; p <= 1.0f; )
+        {
+            if(secToPrim)
+            {
+                CLLC_TICKS_referenceSecToPrim(p, r->dutyPrim_pu,
+                                              r->dutySec_pu,
+                                              r->phaseShift_ns, &ref);
+            }
+            else
+            {
+                CLLC_TICKS_referencePrimToSec(p, r->dutyPrim_pu,
+                                              r->dutySec_pu,
+                                              r->phaseShift_ns, &ref);
+            }
+
+            CLLC_TICKS_firmware(p, secToPrim, &fw);
+            periods++;
+
+            if(CLLC_TICKS_compare(&ref, &fw))
+            {
+                if(mismatches == 0)
+                {
+                    first = ref;
+                    firstFw = fw;
+                    firstPeriod = p;
+                }
+                mismatches++;
+            }
+
+            for(step = 0; step < stride; step++)
+            {
+                p = nextafterf(p, 2.0f);
+            }
+        }
+
+        if(mismatches != 0)
+        {
+            CLLC_CHECK_fail("%s ref %u: %u of %u periods differ, first at "
+                            "%.9g: period %08x/%08x prim %08x/%08x "
+                            "sec %08x/%08x phase %08x/%08x trig %u/%u",
+                            secToPrim ? "sec->prim" : "prim->sec", i,
+                            mismatches, periods, (double)firstPeriod,
+                            first.period, firstFw.period, first.dutyAPrim,
+                            firstFw.dutyAPrim, first.dutyASec,
+                            firstFw.dutyASec, (uint32_t)first.phaseShift,
+                            (uint32_t)firstFw.phaseShift, first.isrTrig,
+                            firstFw.isrTrig);
+        }
+        *checked += periods;
+        total += mismatches;
+    }
+
+    return(total);
+}
+
+//
+// the references as set from the watch window and the ones the tick
+// calculation took before the factors were hoisted
+//
+static volatile CLLC_TICKS_Ref CLLC_TICKS_refSet;
+static CLLC_TICKS_Ref CLLC_TICKS_refTaken;
+
+//
+// one update per period change, the reference recomputes everything, the
+// firmware path only the period dependent part. Both look for a new
+// reference first, as ISR2 does. With newRef every update comes with one,
+// alternately references 3 and 4, the worst case of ISR2: before, it
+// worked out the factors there, the firmware only takes the set ISR3 left.
+//
+static double CLLC_TICKS_timeReference(uint16_t secToPrim, uint32_t updates,
+                                       uint16_t newRef)
+{
+    const CLLC_TICKS_Ref *r;
+    volatile uint32_t sink = 0;
+    CLLC_TICKS_Result res;
+    float32_t p = CLLC_pwmPeriodMin_pu;
+    float32_t dp = (1.0f - CLLC_pwmPeriodMin_pu) / (float32_t)updates;
+    double t0;
+    uint32_t i;
+
+    r = &CLLC_TICKS_ref[3];
+    CLLC_TICKS_refSet = *r;
+    CLLC_TICKS_refTaken = *r;
+
+    t0 = CLLC_TICKS_now();
+    for(i = 0; i < updates; i++)
+    {
+        if(newRef)
+        {
+            r = &CLLC_TICKS_ref[3U + (i & 1U)];
+            CLLC_TICKS_refSet.dutyPrim_pu = r->dutyPrim_pu;
+            CLLC_TICKS_refSet.dutySec_pu = r->dutySec_pu;
+            CLLC_TICKS_refSet.phaseShift_ns = r->phaseShift_ns;
+        }
+
+        if((CLLC_TICKS_refTaken.phaseShift_ns !=
+            CLLC_TICKS_refSet.phaseShift_ns) ||
+           (CLLC_TICKS_refTaken.dutyPrim_pu != CLLC_TICKS_refSet.dutyPrim_pu) ||
+           (CLLC_TICKS_refTaken.dutySec_pu != CLLC_TICKS_refSet.dutySec_pu))
+        {
+            CLLC_TICKS_refTaken.dutyPrim_pu = CLLC_TICKS_refSet.dutyPrim_pu;
+            CLLC_TICKS_refTaken.dutySec_pu = CLLC_TICKS_refSet.dutySec_pu;
+            CLLC_TICKS_refTaken.phaseShift_ns =
+                    CLLC_TICKS_refSet.phaseShift_ns;
+        }
+
+        if(secToPrim)
+        {
+            CLLC_TICKS_referenceSecToPrim(p, CLLC_TICKS_refTaken.dutyPrim_pu,
+                                          CLLC_TICKS_refTaken.dutySec_pu,
+                                          CLLC_TICKS_refTaken.phaseShift_ns,
+                                          &res);
+        }
+        else
+        {
+            CLLC_TICKS_referencePrimToSec(p, CLLC_TICKS_refTaken.dutyPrim_pu,
+                                          CLLC_TICKS_refTaken.dutySec_pu,
+                                          CLLC_TICKS_refTaken.phaseShift_ns,
+                                          &res);
+        }
+        sink += res.dutyASec + res.isrTrig;
+
+        //
+        // the trigger of the previous frequency was set up from scratch
+        //
+        sink += TICKS_IN_PWM_FREQUENCY(CLLC_PWMSYSCLOCK_FREQ_HZ /
+                                       ((p - dp) * CLLC_pwmPeriodMax_ticks),
+                                       CLLC_PWMSYSCLOCK_FREQ_HZ);
+        p += dp;
+    }
+
+    return((CLLC_TICKS_now() - t0) * 1.0e9 / (double)updates);
+}
+
+static double CLLC_TICKS_timeFirmware(uint16_t secToPrim, uint32_t updates,
+                                      uint16_t newRef)
+{
+    volatile uint32_t sink = 0;
+    CLLC_TICKS_Result res;
+    float32_t p = CLLC_pwmPeriodMin_pu;
+    float32_t dp = (1.0f - CLLC_pwmPeriodMin_pu) / (float32_t)updates;
+    double t0;
+    uint32_t i;
+
+    CLLC_TICKS_calculateFactors(&CLLC_TICKS_ref[3], secToPrim,
+                                &CLLC_pwmFactorsSet[0]);
+    CLLC_TICKS_calculateFactors(&CLLC_TICKS_ref[4], secToPrim,
+                                &CLLC_pwmFactorsSet[1]);
+    CLLC_pwmFactorsCount = 0;
+    CLLC_pwmFactorsTaken = 1;
+
+    t0 = CLLC_TICKS_now();
+    for(i = 0; i < updates; i++)
+    {
+        if(newRef)
+        {
+            CLLC_pwmFactorsCount++;
+        }
+        sink += CLLC_takePWMDutyPhaseShiftFactors();
+        CLLC_TICKS_firmware(p, secToPrim, &res);
+        sink += res.dutyASec + res.isrTrig;
+        p += dp;
+    }
+
+    return((CLLC_TICKS_now() - t0) * 1.0e9 / (double)updates);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t stride = 1;
+    uint32_t updates = 10000000;
+    uint32_t mismatches = 0;
+    uint32_t checked = 0;
+    uint16_t secToPrim;
+    int opt;
+
+    while((opt = getopt(argc, argv, "s:t:")) != -1)
+    {
+        switch(opt)
+        {
+            case 's':
+                stride = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                updates = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-s stride] [-t updates]\n",
+                        argv[0]);
+                return(2);
+        }
+    }
+
+    if(stride == 0 || updates == 0)
+    {
+        fprintf(stderr, "stride and updates must be at least 1\n");
+        return(2);
+    }
+
+    //
+    // the period limits and the references of the lab
+    //
+    CLLC_initGlobalVariables();
+
+    for(secToPrim = 0; secToPrim < 2; secToPrim++)
+    {
+        mismatches += CLLC_TICKS_check(secToPrim, stride, &checked);
+    }
+
+    printf("%u periods x references checked, %u mismatches\n", checked,
+           mismatches);
+
+    for(secToPrim = 0; secToPrim < 2; secToPrim++)
+    {
+        printf("%s: reference %.1f ns/update, firmware %.1f ns/update, "
+               "with a new reference %.1f and %.1f ns/update\n",
+               secToPrim ? "sec->prim" : "prim->sec",
+               CLLC_TICKS_timeReference(secToPrim, updates, 0),
+               CLLC_TICKS_timeFirmware(secToPrim, updates, 0),
+               CLLC_TICKS_timeReference(secToPrim, updates, 1),
+               CLLC_TICKS_timeFirmware(secToPrim, updates, 1));
+    }
+
+    return(CLLC_CHECK_result());
+}
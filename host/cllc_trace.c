@@ -0,0 +1,1075 @@
+//#############################################################################
+//
+// FILE:   cllc_trace.c
+//
+// TITLE:  Golden trace record and replay for the host emulator
+//         The writer chains itself in front of the sample hook of the plant
+//         and takes the event handler and the step end hook of the
+//         emulator. The reader maps the whole file and decodes the stream in
+//         place, one ISR2 period per sample hook, so a replay costs little
+//         more than the ISRs themselves.
+//
+//#############################################################################
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cllc.h"
+#include "cllc_trace.h"
+
+//
+// The ADC result words, all SOCs of every ADC, so the trace does not depend
+// on which of them the CLLC_*_ADCREAD_* macros read
+//
+#define CLLC_TRACE_ADC_COUNT        3U
+#define CLLC_TRACE_SOC_COUNT        16U
+
+static const uint32_t CLLC_TRACE_adcResultBase[CLLC_TRACE_ADC_COUNT] =
+{
+    ADCARESULT_BASE, ADCBRESULT_BASE, ADCCRESULT_BASE
+};
+
+//
+// The variables set from the watch window in the lab instructions. A write
+// from outside the ISRs is recorded at the start of the next ISR2 period
+// and played back there, writes by the ISRs themselves are not recorded.
+//
+typedef struct
+{
+    const char *name;
+    void *address;
+    uint32_t size;
+} CLLC_TRACE_Variable;
+
+#define CLLC_TRACE_VARIABLE(v)  {#v, (void *)&(v), sizeof(v)}
+
+static const CLLC_TRACE_Variable CLLC_TRACE_variable[] =
+{
+    CLLC_TRACE_VARIABLE(CLLC_clearTrip),
+    CLLC_TRACE_VARIABLE(CLLC_closeGiLoop),
+    CLLC_TRACE_VARIABLE(CLLC_closeGvLoop),
+    CLLC_TRACE_VARIABLE(CLLC_PrechargeState),
+    CLLC_TRACE_VARIABLE(CLLC_pwmSwState),
+    CLLC_TRACE_VARIABLE(CLLC_powerFlowState),
+    CLLC_TRACE_VARIABLE(CLLC_pwmFrequencyRef_Hz),
+    CLLC_TRACE_VARIABLE(CLLC_pwmPeriodRef_pu),
+    CLLC_TRACE_VARIABLE(CLLC_pwmPhaseShiftPrimSecRef_ns),
+    CLLC_TRACE_VARIABLE(CLLC_pwmDutyPrimRef_pu),
+    CLLC_TRACE_VARIABLE(CLLC_pwmDutySecRef_pu),
+    CLLC_TRACE_VARIABLE(CLLC_pwmDeadBandREDPrimRef_ns),
+    CLLC_TRACE_VARIABLE(CLLC_pwmDeadBandFEDPrimRef_ns),
+    CLLC_TRACE_VARIABLE(CLLC_vPrimRef_Volts),
+    CLLC_TRACE_VARIABLE(CLLC_vPrimRefSlewed_pu),
+    CLLC_TRACE_VARIABLE(CLLC_vSecRef_Volts),
+    CLLC_TRACE_VARIABLE(CLLC_iSecRef_Amps)
+};
+
+#define CLLC_TRACE_VARIABLE_COUNT   (sizeof(CLLC_TRACE_variable) /            \
+                                     sizeof(CLLC_TRACE_variable[0]))
+
+static const char *CLLC_TRACE_isrName[] = {"-", "ISR1", "ISR2", "ISR3",
+                                           "TRIP"};
+
+static inline uint32_t CLLC_TRACE_readVariable(const CLLC_TRACE_Variable *v)
+{
+    uint32_t value = 0;
+
+    memcpy(&value, v->address, v->size);
+    return(value);
+}
+
+static inline void CLLC_TRACE_writeVariable(const CLLC_TRACE_Variable *v,
+                                            uint32_t value)
+{
+    memcpy(v->address, &value, v->size);
+}
+
+static inline uint32_t CLLC_TRACE_readRegister(uint32_t address,
+                                               uint16_t width)
+{
+    if(width == CLLC_EMU_REG_32BIT)
+    {
+        return(HWREG(address));
+    }
+    return(HWREGH(address));
+}
+
+static void CLLC_TRACE_initHistory(CLLC_TRACE_History *history,
+                                   const uint32_t *initial, uint16_t count)
+{
+    uint16_t i;
+
+    memset(history, 0, sizeof(*history));
+    for(i = 0; i < count; i++)
+    {
+        history->last[i] = initial[i];
+        history->prior[i] = initial[i];
+    }
+}
+
+static inline void CLLC_TRACE_updateHistory(CLLC_TRACE_History *history,
+                                            uint16_t watch, uint32_t value)
+{
+    if(value != history->last[watch])
+    {
+        history->prior[watch] = history->last[watch];
+        history->last[watch] = value;
+    }
+    history->previousEvent = value;
+}
+
+//
+// Writer
+//
+static void CLLC_TRACE_flush(CLLC_TRACE_Writer *writer)
+{
+    if((writer->fill != 0U) &&
+       (fwrite(writer->buffer, 1, writer->fill, writer->file) !=
+        writer->fill))
+    {
+        writer->error = 1;
+    }
+    writer->bytes += writer->fill;
+    writer->fill = 0;
+}
+
+static inline void CLLC_TRACE_put(CLLC_TRACE_Writer *writer, uint32_t value,
+                                  uint16_t bytes)
+{
+    uint16_t i;
+
+    if((writer->fill + bytes) > CLLC_TRACE_BUFFER_BYTES)
+    {
+        CLLC_TRACE_flush(writer);
+    }
+
+    for(i = 0; i < bytes; i++)
+    {
+        writer->buffer[writer->fill++] = (uint8_t)(value >> (8U * i));
+    }
+}
+
+static void CLLC_TRACE_writerSampleHook(void *context)
+{
+    CLLC_TRACE_Writer *writer = (CLLC_TRACE_Writer *)context;
+    uint32_t value, address;
+    uint16_t i, j, code;
+
+    CLLC_TRACE_put(writer, CLLC_TRACE_OP_STEP, 1);
+    writer->history.isr = CLLC_EMU_ISR_NONE;
+
+    //
+    // variables written since the end of the last period
+    //
+    for(i = 0; i < CLLC_TRACE_VARIABLE_COUNT; i++)
+    {
+        value = CLLC_TRACE_readVariable(&CLLC_TRACE_variable[i]);
+        if(value != writer->variable[i])
+        {
+            CLLC_TRACE_put(writer, CLLC_TRACE_OP_VARIABLE, 1);
+            CLLC_TRACE_put(writer, i, 1);
+            CLLC_TRACE_put(writer, value, 4);
+            writer->variable[i] = value;
+        }
+    }
+
+    if(writer->plantHook != NULL)
+    {
+        writer->plantHook(writer->plantContext);
+    }
+
+    //
+    // the plant writes the SOCs of a channel with one code, so the changed
+    // words come in runs of the same value
+    //
+    i = 0;
+    while(i < writer->inputCount)
+    {
+        address = CLLC_TRACE_adcResultBase[i / CLLC_TRACE_SOC_COUNT] +
+                  ADC_O_RESULT0 + (i % CLLC_TRACE_SOC_COUNT);
+        code = HWREGH(address);
+
+        if(code == writer->input[i])
+        {
+            i++;
+            continue;
+        }
+
+        j = i + 1U;
+        while((j < writer->inputCount) && ((j - i) < 255U) &&
+              ((j % CLLC_TRACE_SOC_COUNT) != 0U) &&
+              (HWREGH(address + (j - i)) != writer->input[j]) &&
+              (HWREGH(address + (j - i)) == code))
+        {
+            j++;
+        }
+
+        CLLC_TRACE_put(writer, CLLC_TRACE_OP_INPUT, 1);
+        CLLC_TRACE_put(writer, i, 1);
+        CLLC_TRACE_put(writer, j - i, 1);
+        CLLC_TRACE_put(writer, code, 2);
+
+        for(; i < j; i++)
+        {
+            writer->input[i] = code;
+        }
+    }
+}
+
+static void CLLC_TRACE_writerStepEnd(void *context)
+{
+    CLLC_TRACE_Writer *writer = (CLLC_TRACE_Writer *)context;
+    uint16_t i;
+
+    for(i = 0; i < CLLC_TRACE_VARIABLE_COUNT; i++)
+    {
+        writer->variable[i] = CLLC_TRACE_readVariable(&CLLC_TRACE_variable[i]);
+    }
+}
+
+static void CLLC_TRACE_writerEvent(const CLLC_EMU_Event *event,
+                                   void *context)
+{
+    CLLC_TRACE_Writer *writer = (CLLC_TRACE_Writer *)context;
+    CLLC_TRACE_History *history = &writer->history;
+    uint16_t watch = event->watch;
+
+    if(event->isr != history->isr)
+    {
+        CLLC_TRACE_put(writer, CLLC_TRACE_OP_ISR + event->isr, 1);
+        history->isr = event->isr;
+    }
+
+    if(event->value == history->last[watch])
+    {
+        CLLC_TRACE_put(writer, watch, 1);
+    }
+    else if(event->value == history->previousEvent)
+    {
+        CLLC_TRACE_put(writer, CLLC_TRACE_OP_SAME, 1);
+        CLLC_TRACE_put(writer, watch, 1);
+    }
+    else if(event->value == history->prior[watch])
+    {
+        CLLC_TRACE_put(writer, CLLC_TRACE_OP_PRIOR, 1);
+        CLLC_TRACE_put(writer, watch, 1);
+    }
+    else
+    {
+        CLLC_TRACE_put(writer, CLLC_TRACE_OP_EVENT, 1);
+        CLLC_TRACE_put(writer, watch, 1);
+        CLLC_TRACE_put(writer, event->value,
+                       (writer->watchWidth[watch] == CLLC_EMU_REG_32BIT) ?
+                       4U : 2U);
+    }
+
+    CLLC_TRACE_updateHistory(history, watch, event->value);
+}
+
+//
+// Start recording, right after CLLC_EMU_initFirmware() and once the plant
+// sample hook is set. Everything the ISRs see from then on goes to the trace.
+//
+int16_t CLLC_TRACE_openWriter(CLLC_TRACE_Writer *writer, const char *path)
+{
+    CLLC_TRACE_FileHeader header;
+    CLLC_TRACE_FileInput input;
+    CLLC_TRACE_FileWatch watch;
+    CLLC_TRACE_FileVariable variable;
+    uint32_t initial[CLLC_TRACE_MAX_WATCHES];
+    CLLC_EMU_RegWidth width;
+    CLLC_EMU_Action action;
+    const char *name;
+    uint16_t i;
+
+    memset(writer, 0, sizeof(*writer));
+
+    if(CLLC_EMU_stats.step != 0U)
+    {
+        fprintf(stderr, "trace: open the writer before the first ISR2\n");
+        return(-1);
+    }
+
+    writer->watchCount = CLLC_EMU_getWatchCount();
+    writer->inputCount = CLLC_TRACE_ADC_COUNT * CLLC_TRACE_SOC_COUNT;
+
+    if(writer->watchCount > CLLC_TRACE_MAX_WATCHES)
+    {
+        fprintf(stderr, "trace: %u watches, at most %u\n",
+                writer->watchCount, CLLC_TRACE_MAX_WATCHES);
+        return(-1);
+    }
+
+    writer->file = fopen(path, "wb");
+    if(writer->file == NULL)
+    {
+        fprintf(stderr, "trace: %s: %s\n", path, strerror(errno));
+        return(-1);
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CLLC_TRACE_MAGIC, sizeof(CLLC_TRACE_MAGIC));
+    header.lab = CLLC_LAB;
+    header.isr2Frequency_Hz = (uint32_t)CLLC_ISR2_FREQUENCY_HZ;
+    header.inputCount = writer->inputCount;
+    header.watchCount = writer->watchCount;
+    header.variableCount = CLLC_TRACE_VARIABLE_COUNT;
+    fwrite(&header, sizeof(header), 1, writer->file);
+
+    for(i = 0; i < writer->inputCount; i++)
+    {
+        input.address = CLLC_TRACE_adcResultBase[i / CLLC_TRACE_SOC_COUNT] +
+                        ADC_O_RESULT0 + (i % CLLC_TRACE_SOC_COUNT);
+        input.initial = HWREGH(input.address);
+        writer->input[i] = (uint16_t)input.initial;
+        fwrite(&input, sizeof(input), 1, writer->file);
+    }
+
+    for(i = 0; i < writer->watchCount; i++)
+    {
+        memset(&watch, 0, sizeof(watch));
+        name = CLLC_EMU_getWatch(i, &watch.address, &width, &action);
+        watch.width = (uint16_t)width;
+        watch.action = (uint16_t)action;
+        memcpy(watch.name, name, strlen(name));
+        watch.initial = CLLC_TRACE_readRegister(watch.address, watch.width);
+        writer->watchWidth[i] = watch.width;
+        initial[i] = watch.initial;
+        fwrite(&watch, sizeof(watch), 1, writer->file);
+    }
+
+    for(i = 0; i < CLLC_TRACE_VARIABLE_COUNT; i++)
+    {
+        memset(&variable, 0, sizeof(variable));
+        memcpy(variable.name, CLLC_TRACE_variable[i].name,
+               strlen(CLLC_TRACE_variable[i].name));
+        variable.size = CLLC_TRACE_variable[i].size;
+        variable.initial = CLLC_TRACE_readVariable(&CLLC_TRACE_variable[i]);
+        writer->variable[i] = variable.initial;
+        fwrite(&variable, sizeof(variable), 1, writer->file);
+    }
+
+    CLLC_TRACE_initHistory(&writer->history, initial, writer->watchCount);
+
+    CLLC_EMU_getSampleHook(&writer->plantHook, &writer->plantContext);
+    CLLC_EMU_setSampleHook(&CLLC_TRACE_writerSampleHook, writer);
+    CLLC_EMU_setStepEndHook(&CLLC_TRACE_writerStepEnd, writer);
+    CLLC_EMU_setEventHandler(&CLLC_TRACE_writerEvent, writer);
+
+    return(ferror(writer->file) ? -1 : 0);
+}
+
+int16_t CLLC_TRACE_closeWriter(CLLC_TRACE_Writer *writer)
+{
+    CLLC_TRACE_FileTrailer trailer;
+    int16_t status = 0;
+
+    CLLC_EMU_setSampleHook(writer->plantHook, writer->plantContext);
+    CLLC_EMU_setStepEndHook(NULL, NULL);
+    CLLC_EMU_setEventHandler(NULL, NULL);
+
+    CLLC_TRACE_put(writer, CLLC_TRACE_OP_END, 1);
+    CLLC_TRACE_flush(writer);
+
+    memset(&trailer, 0, sizeof(trailer));
+    trailer.steps = CLLC_EMU_stats.step;
+    trailer.isr1Count = CLLC_EMU_stats.isr1Count;
+    trailer.isr2Count = CLLC_EMU_stats.isr2Count;
+    trailer.isr3Count = CLLC_EMU_stats.isr3Count;
+    trailer.eventCount = CLLC_EMU_stats.eventCount;
+    memcpy(trailer.magic, CLLC_TRACE_END_MAGIC, sizeof(CLLC_TRACE_END_MAGIC));
+
+    if((fwrite(&trailer, sizeof(trailer), 1, writer->file) != 1U) ||
+       writer->error || ferror(writer->file))
+    {
+        status = -1;
+    }
+    if(fclose(writer->file) != 0)
+    {
+        status = -1;
+    }
+    writer->file = NULL;
+
+    return(status);
+}
+
+//
+// Reader
+//
+int16_t CLLC_TRACE_openReader(CLLC_TRACE_Reader *reader, const char *path)
+{
+    const CLLC_TRACE_FileHeader *header;
+    struct stat st;
+    size_t tables;
+    void *base;
+    uint32_t i;
+    int fd;
+
+    memset(reader, 0, sizeof(*reader));
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        fprintf(stderr, "trace: %s: %s\n", path, strerror(errno));
+        return(-1);
+    }
+
+    if((fstat(fd, &st) != 0) ||
+       ((size_t)st.st_size < (sizeof(CLLC_TRACE_FileHeader) +
+                              sizeof(CLLC_TRACE_FileTrailer))))
+    {
+        fprintf(stderr, "trace: %s: too short\n", path);
+        close(fd);
+        return(-1);
+    }
+
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED)
+    {
+        fprintf(stderr, "trace: %s: %s\n", path, strerror(errno));
+        return(-1);
+    }
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    reader->base = (const uint8_t *)base;
+    reader->size = (size_t)st.st_size;
+    header = (const CLLC_TRACE_FileHeader *)base;
+    reader->header = header;
+
+    if(memcmp(header->magic, CLLC_TRACE_MAGIC, sizeof(CLLC_TRACE_MAGIC)) != 0)
+    {
+        fprintf(stderr, "trace: %s: not a trace\n", path);
+        CLLC_TRACE_closeReader(reader);
+        return(-1);
+    }
+
+    tables = sizeof(*header) +
+             (header->inputCount * sizeof(CLLC_TRACE_FileInput)) +
+             (header->watchCount * sizeof(CLLC_TRACE_FileWatch)) +
+             (header->variableCount * sizeof(CLLC_TRACE_FileVariable));
+
+    if((header->inputCount > CLLC_TRACE_MAX_INPUTS) ||
+       (header->watchCount > CLLC_TRACE_MAX_WATCHES) ||
+       (header->variableCount > CLLC_TRACE_MAX_VARIABLES) ||
+       ((tables + sizeof(CLLC_TRACE_FileTrailer)) > reader->size))
+    {
+        fprintf(stderr, "trace: %s: bad header\n", path);
+        CLLC_TRACE_closeReader(reader);
+        return(-1);
+    }
+
+    reader->input = (const CLLC_TRACE_FileInput *)(reader->base +
+                                                   sizeof(*header));
+    reader->watch = (const CLLC_TRACE_FileWatch *)(reader->input +
+                                                   header->inputCount);
+    reader->variable = (const CLLC_TRACE_FileVariable *)(reader->watch +
+                                                         header->watchCount);
+    reader->stream = reader->base + tables;
+    reader->trailer = (const CLLC_TRACE_FileTrailer *)
+                      (reader->base + reader->size -
+                       sizeof(CLLC_TRACE_FileTrailer));
+    reader->end = (const uint8_t *)reader->trailer;
+    reader->p = reader->stream;
+
+    for(i = 0; i < header->inputCount; i++)
+    {
+        if(reader->input[i].address >= CLLC_EMU_REGFILE_SIZE_WORDS)
+        {
+            fprintf(stderr, "trace: %s: bad input table\n", path);
+            CLLC_TRACE_closeReader(reader);
+            return(-1);
+        }
+    }
+
+    if(memcmp(reader->trailer->magic, CLLC_TRACE_END_MAGIC,
+              sizeof(CLLC_TRACE_END_MAGIC)) != 0)
+    {
+        fprintf(stderr, "trace: %s: truncated, the recording did not "
+                "finish\n", path);
+        CLLC_TRACE_closeReader(reader);
+        return(-1);
+    }
+
+    return(0);
+}
+
+void CLLC_TRACE_closeReader(CLLC_TRACE_Reader *reader)
+{
+    if(reader->base != NULL)
+    {
+        munmap((void *)reader->base, reader->size);
+        reader->base = NULL;
+    }
+}
+
+static inline uint32_t CLLC_TRACE_get(const uint8_t *p, uint16_t bytes)
+{
+    uint32_t value = 0;
+    uint16_t i;
+
+    for(i = 0; i < bytes; i++)
+    {
+        value |= (uint32_t)p[i] << (8U * i);
+    }
+    return(value);
+}
+
+static void CLLC_TRACE_initReaderHistory(CLLC_TRACE_Reader *reader)
+{
+    uint32_t initial[CLLC_TRACE_MAX_WATCHES];
+    uint16_t i;
+
+    for(i = 0; i < reader->header->watchCount; i++)
+    {
+        initial[i] = reader->watch[i].initial;
+    }
+    CLLC_TRACE_initHistory(&reader->history, initial,
+                           (uint16_t)reader->header->watchCount);
+}
+
+//
+// Decode the event at the read position. Returns 1 for an event, 0 at the
+// start of the next period or the end, -1 when the stream is malformed.
+// ISR codes are consumed on the way.
+//
+static int16_t CLLC_TRACE_decodeEvent(CLLC_TRACE_Reader *reader,
+                                      CLLC_TRACE_Event *event)
+{
+    CLLC_TRACE_History *history = &reader->history;
+    const uint8_t *p = reader->p;
+    uint32_t value;
+    uint16_t watch, bytes;
+    uint8_t op;
+
+    for(;;)
+    {
+        if(p >= reader->end)
+        {
+            return(-1);
+        }
+
+        op = *p;
+        if((op == CLLC_TRACE_OP_STEP) || (op == CLLC_TRACE_OP_END))
+        {
+            reader->p = p;
+            return(0);
+        }
+        if((op >= CLLC_TRACE_OP_ISR) && (op <= (CLLC_TRACE_OP_ISR +
+                                                CLLC_EMU_ISR_TRIP)))
+        {
+            history->isr = op - CLLC_TRACE_OP_ISR;
+            p++;
+            continue;
+        }
+        break;
+    }
+
+    if(op <= CLLC_TRACE_OP_REPEAT_LAST)
+    {
+        watch = op;
+        if(watch >= reader->header->watchCount)
+        {
+            return(-1);
+        }
+        value = history->last[watch];
+        p++;
+    }
+    else
+    {
+        if(((p + 2) > reader->end) || (p[1] >= reader->header->watchCount))
+        {
+            return(-1);
+        }
+        watch = p[1];
+
+        if(op == CLLC_TRACE_OP_SAME)
+        {
+            value = history->previousEvent;
+            p += 2;
+        }
+        else if(op == CLLC_TRACE_OP_PRIOR)
+        {
+            value = history->prior[watch];
+            p += 2;
+        }
+        else if(op == CLLC_TRACE_OP_EVENT)
+        {
+            bytes = (reader->watch[watch].width == CLLC_EMU_REG_32BIT) ?
+                    4U : 2U;
+            if((p + 2 + bytes) > reader->end)
+            {
+                return(-1);
+            }
+            value = CLLC_TRACE_get(p + 2, bytes);
+            p += 2 + bytes;
+        }
+        else
+        {
+            return(-1);
+        }
+    }
+
+    CLLC_TRACE_updateHistory(history, watch, value);
+
+    event->isr = history->isr;
+    event->watch = watch;
+    event->value = value;
+    reader->p = p;
+    return(1);
+}
+
+static void CLLC_TRACE_report(CLLC_TRACE_Reader *reader,
+                              const CLLC_TRACE_Event *expected,
+                              const CLLC_TRACE_Event *actual)
+{
+    const CLLC_TRACE_Event *e = (expected != NULL) ? expected : actual;
+
+    if(reader->maxReports == 0U)
+    {
+        return;
+    }
+    reader->maxReports--;
+
+    printf("step %lu %s %s: trace ", (unsigned long)(reader->result.steps -
+                                                     1U),
+           CLLC_TRACE_isrName[e->isr], reader->watch[e->watch].name);
+    if(expected != NULL)
+    {
+        printf("0x%08lX", (unsigned long)expected->value);
+    }
+    else
+    {
+        printf("-");
+    }
+    printf(", build ");
+    if(actual != NULL)
+    {
+        if(actual->watch != e->watch)
+        {
+            printf("%s ", reader->watch[actual->watch].name);
+        }
+        printf("0x%08lX", (unsigned long)actual->value);
+        if(actual->isr != e->isr)
+        {
+            printf(" in %s", CLLC_TRACE_isrName[actual->isr]);
+        }
+    }
+    else
+    {
+        printf("-");
+    }
+    printf("\n");
+}
+
+static uint16_t CLLC_TRACE_isDivergent(const CLLC_TRACE_Reader *reader)
+{
+    const CLLC_TRACE_FileWatch *watch;
+    uint16_t i;
+
+    for(i = 0; i < reader->header->watchCount; i++)
+    {
+        watch = &reader->watch[i];
+        if((watch->action == CLLC_EMU_ACTION_NONE) &&
+           (CLLC_TRACE_readRegister(watch->address, watch->width) !=
+            reader->history.last[i]))
+        {
+            return(1);
+        }
+    }
+    return(0);
+}
+
+//
+// Compare the events the build emitted in the last period against the trace
+//
+static void CLLC_TRACE_verifyStep(CLLC_TRACE_Reader *reader)
+{
+    CLLC_TRACE_Event expected;
+    const CLLC_TRACE_Event *actual;
+    uint32_t k = 0;
+    uint16_t mismatch = 0;
+    int16_t status;
+
+    if(!reader->stepPending)
+    {
+        return;
+    }
+    reader->stepPending = 0;
+
+    while((status = CLLC_TRACE_decodeEvent(reader, &expected)) == 1)
+    {
+        if(!mismatch)
+        {
+            actual = (k < reader->actualCount) ? &reader->actual[k] : NULL;
+            if((actual == NULL) || (actual->isr != expected.isr) ||
+               (actual->watch != expected.watch) ||
+               (actual->value != expected.value))
+            {
+                mismatch = 1;
+                CLLC_TRACE_report(reader, &expected, actual);
+            }
+        }
+        k++;
+    }
+
+    if(status < 0)
+    {
+        reader->result.error = 1;
+        return;
+    }
+
+    if(!mismatch && (k != reader->actualCount))
+    {
+        mismatch = 1;
+        CLLC_TRACE_report(reader, NULL, &reader->actual[k]);
+    }
+
+    reader->result.events += k;
+
+    //
+    // events only show changes, a register left at another value would go
+    // unnoticed after the period it was written in, so the periods count as
+    // differing until the plain registers are back to the trace
+    //
+    if(mismatch || reader->divergent)
+    {
+        reader->divergent = CLLC_TRACE_isDivergent(reader);
+        mismatch |= reader->divergent;
+    }
+
+    if(mismatch)
+    {
+        if(reader->result.mismatchSteps == 0U)
+        {
+            reader->result.firstMismatchStep = reader->result.steps - 1U;
+        }
+        reader->result.mismatchSteps++;
+    }
+}
+
+//
+// Play the inputs of the next period from the trace, after checking the
+// previous one
+//
+static void CLLC_TRACE_readerSampleHook(void *context)
+{
+    CLLC_TRACE_Reader *reader = (CLLC_TRACE_Reader *)context;
+    const uint8_t *p;
+    uint16_t i, first, count;
+
+    CLLC_TRACE_verifyStep(reader);
+
+    p = reader->p;
+    if(reader->result.error || (p >= reader->end) ||
+       (*p != CLLC_TRACE_OP_STEP))
+    {
+        reader->result.error = 1;
+        return;
+    }
+    p++;
+    reader->history.isr = CLLC_EMU_ISR_NONE;
+
+    for(;;)
+    {
+        if((p < reader->end) && (*p == CLLC_TRACE_OP_VARIABLE))
+        {
+            if(((p + 6) > reader->end) ||
+               (p[1] >= reader->header->variableCount))
+            {
+                reader->result.error = 1;
+                return;
+            }
+            CLLC_TRACE_writeVariable(&CLLC_TRACE_variable[p[1]],
+                                     CLLC_TRACE_get(p + 2, 4));
+            p += 6;
+        }
+        else if((p < reader->end) && (*p == CLLC_TRACE_OP_INPUT))
+        {
+            if((p + 5) > reader->end)
+            {
+                reader->result.error = 1;
+                return;
+            }
+            first = p[1];
+            count = p[2];
+            if((first + count) > reader->header->inputCount)
+            {
+                reader->result.error = 1;
+                return;
+            }
+            for(i = first; i < (first + count); i++)
+            {
+                HWREGH(reader->input[i].address) =
+                        (uint16_t)CLLC_TRACE_get(p + 3, 2);
+            }
+            p += 5;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    reader->p = p;
+    reader->actualCount = 0;
+    reader->stepPending = 1;
+    reader->result.steps++;
+}
+
+static void CLLC_TRACE_readerEvent(const CLLC_EMU_Event *event, void *context)
+{
+    CLLC_TRACE_Reader *reader = (CLLC_TRACE_Reader *)context;
+    CLLC_TRACE_Event *actual;
+
+    if(reader->actualCount < CLLC_TRACE_MAX_STEP_EVENTS)
+    {
+        actual = &reader->actual[reader->actualCount++];
+        actual->isr = event->isr;
+        actual->watch = event->watch;
+        actual->value = event->value;
+    }
+}
+
+//
+// Check that the trace was recorded against the same lab and the same
+// emulator setup, and that its variables are known to this build
+//
+static int16_t CLLC_TRACE_checkSetup(const CLLC_TRACE_Reader *reader)
+{
+    const CLLC_TRACE_FileHeader *header = reader->header;
+    CLLC_EMU_RegWidth width;
+    CLLC_EMU_Action action;
+    uint32_t address;
+    uint16_t i;
+
+    if((header->lab != CLLC_LAB) ||
+       (header->isr2Frequency_Hz != (uint32_t)CLLC_ISR2_FREQUENCY_HZ))
+    {
+        fprintf(stderr, "trace: recorded with lab %lu at %lu Hz, this is "
+                "lab %d at %lu Hz\n", (unsigned long)header->lab,
+                (unsigned long)header->isr2Frequency_Hz, CLLC_LAB,
+                (unsigned long)CLLC_ISR2_FREQUENCY_HZ);
+        return(-1);
+    }
+
+    if(header->watchCount != CLLC_EMU_getWatchCount())
+    {
+        fprintf(stderr, "trace: %lu watches, the emulator sets %u, record "
+                "the trace again\n", (unsigned long)header->watchCount,
+                CLLC_EMU_getWatchCount());
+        return(-1);
+    }
+
+    for(i = 0; i < header->watchCount; i++)
+    {
+        CLLC_EMU_getWatch(i, &address, &width, &action);
+        if((address != reader->watch[i].address) ||
+           ((uint16_t)width != reader->watch[i].width) ||
+           ((uint16_t)action != reader->watch[i].action))
+        {
+            fprintf(stderr, "trace: watch %u (%.*s) differs from the "
+                    "emulator, record the trace again\n", i,
+                    CLLC_EMU_NAME_LENGTH, reader->watch[i].name);
+            return(-1);
+        }
+    }
+
+    if(header->variableCount != CLLC_TRACE_VARIABLE_COUNT)
+    {
+        fprintf(stderr, "trace: %lu variables, this build traces %u\n",
+                (unsigned long)header->variableCount,
+                (unsigned int)CLLC_TRACE_VARIABLE_COUNT);
+        return(-1);
+    }
+
+    for(i = 0; i < header->variableCount; i++)
+    {
+        if((strncmp(reader->variable[i].name, CLLC_TRACE_variable[i].name,
+                    CLLC_EMU_NAME_LENGTH) != 0) ||
+           (reader->variable[i].size != CLLC_TRACE_variable[i].size))
+        {
+            fprintf(stderr, "trace: variable %u is %.*s, this build traces "
+                    "%s\n", i, CLLC_EMU_NAME_LENGTH,
+                    reader->variable[i].name, CLLC_TRACE_variable[i].name);
+            return(-1);
+        }
+    }
+
+    return(0);
+}
+
+//
+// Bring the firmware up, then run it period by period on the inputs of the
+// trace. Reports the first events of up to maxReports differing periods on
+// stdout, the totals are in reader->result. Returns -1 when the trace cannot
+// be replayed at all.
+//
+int16_t CLLC_TRACE_replay(CLLC_TRACE_Reader *reader, uint32_t maxReports)
+{
+    const CLLC_TRACE_FileTrailer *trailer = reader->trailer;
+    CLLC_TRACE_Result *result = &reader->result;
+    uint32_t value;
+    uint16_t i;
+
+    memset(result, 0, sizeof(*result));
+    reader->maxReports = maxReports;
+    reader->p = reader->stream;
+    reader->stepPending = 0;
+    reader->divergent = 0;
+
+    CLLC_EMU_initFirmware();
+
+    if(CLLC_TRACE_checkSetup(reader) != 0)
+    {
+        return(-1);
+    }
+
+    for(i = 0; i < reader->header->watchCount; i++)
+    {
+        value = CLLC_TRACE_readRegister(reader->watch[i].address,
+                                        reader->watch[i].width);
+        if(value != reader->watch[i].initial)
+        {
+            result->initMismatch++;
+            if(reader->maxReports != 0U)
+            {
+                reader->maxReports--;
+                printf("init %.*s: trace 0x%08lX, build 0x%08lX\n",
+                       CLLC_EMU_NAME_LENGTH, reader->watch[i].name,
+                       (unsigned long)reader->watch[i].initial,
+                       (unsigned long)value);
+            }
+        }
+    }
+
+    for(i = 0; i < reader->header->inputCount; i++)
+    {
+        HWREGH(reader->input[i].address) = (uint16_t)reader->input[i].initial;
+    }
+    for(i = 0; i < reader->header->variableCount; i++)
+    {
+        CLLC_TRACE_writeVariable(&CLLC_TRACE_variable[i],
+                                 reader->variable[i].initial);
+    }
+
+    CLLC_TRACE_initReaderHistory(reader);
+
+    CLLC_EMU_setSampleHook(&CLLC_TRACE_readerSampleHook, reader);
+    CLLC_EMU_setEventHandler(&CLLC_TRACE_readerEvent, reader);
+
+    for(;;)
+    {
+        CLLC_TRACE_verifyStep(reader);
+        if(result->error || (reader->p >= reader->end) ||
+           (*reader->p != CLLC_TRACE_OP_STEP))
+        {
+            break;
+        }
+        CLLC_EMU_step();
+    }
+
+    CLLC_EMU_setSampleHook(NULL, NULL);
+    CLLC_EMU_setEventHandler(NULL, NULL);
+
+    if(!result->error && ((reader->p >= reader->end) ||
+                          (*reader->p != CLLC_TRACE_OP_END)))
+    {
+        result->error = 1;
+    }
+
+    if((CLLC_EMU_stats.step != trailer->steps) ||
+       (CLLC_EMU_stats.isr1Count != trailer->isr1Count) ||
+       (CLLC_EMU_stats.isr2Count != trailer->isr2Count) ||
+       (CLLC_EMU_stats.isr3Count != trailer->isr3Count) ||
+       (CLLC_EMU_stats.eventCount != trailer->eventCount))
+    {
+        result->countMismatch = 1;
+    }
+
+    return(0);
+}
+
+//
+// Print the periods firstStep to firstStep + stepCount - 1 of the trace
+//
+void CLLC_TRACE_dump(CLLC_TRACE_Reader *reader, uint32_t firstStep,
+                     uint32_t stepCount)
+{
+    CLLC_TRACE_Event event;
+    const uint8_t *p;
+    uint32_t step = 0;
+    uint16_t print;
+    int16_t status;
+
+    CLLC_TRACE_initReaderHistory(reader);
+    reader->p = reader->stream;
+
+    while((reader->p < reader->end) && (*reader->p == CLLC_TRACE_OP_STEP) &&
+          ((uint64_t)step < ((uint64_t)firstStep + stepCount)))
+    {
+        print = (step >= firstStep);
+        if(print)
+        {
+            printf("step %lu\n", (unsigned long)step);
+        }
+
+        p = reader->p + 1;
+        reader->history.isr = CLLC_EMU_ISR_NONE;
+
+        for(;;)
+        {
+            if(((p + 6) <= reader->end) && (*p == CLLC_TRACE_OP_VARIABLE) &&
+               (p[1] < reader->header->variableCount))
+            {
+                if(print)
+                {
+                    printf("     var  %-24.*s 0x%08lX\n", CLLC_EMU_NAME_LENGTH,
+                           reader->variable[p[1]].name,
+                           (unsigned long)CLLC_TRACE_get(p + 2, 4));
+                }
+                p += 6;
+            }
+            else if(((p + 5) <= reader->end) && (*p == CLLC_TRACE_OP_INPUT) &&
+                    ((p[1] + p[2]) <= reader->header->inputCount))
+            {
+                if(print)
+                {
+                    printf("     in   0x%05lX-0x%05lX          0x%04lX\n",
+                           (unsigned long)reader->input[p[1]].address,
+                           (unsigned long)reader->input[p[1] + p[2] -
+                                                        1].address,
+                           (unsigned long)CLLC_TRACE_get(p + 3, 2));
+                }
+                p += 5;
+            }
+            else
+            {
+                break;
+            }
+        }
+        reader->p = p;
+
+        while((status = CLLC_TRACE_decodeEvent(reader, &event)) == 1)
+        {
+            if(print)
+            {
+                printf("     %-4s %-24.*s 0x%08lX\n",
+                       CLLC_TRACE_isrName[event.isr], CLLC_EMU_NAME_LENGTH,
+                       reader->watch[event.watch].name,
+                       (unsigned long)event.value);
+            }
+        }
+        if(status < 0)
+        {
+            fprintf(stderr, "trace: malformed at byte %lu\n",
+                    (unsigned long)(reader->p - reader->base));
+            return;
+        }
+        step++;
+    }
+}
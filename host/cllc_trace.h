@@ -0,0 +1,207 @@
+//#############################################################################
+//
+// FILE:   cllc_trace.h
+//
+// TITLE:  Golden trace record and replay for the host emulator
+//         A trace holds, per ISR2 period, everything that goes into the
+//         ISRs from outside, the ADC result registers and the watch window
+//         variables, and every register write event the ISRs emit, tagged
+//         with the ISR that issued it. Replaying feeds the recorded inputs
+//         to the firmware of the present build, with no plant attached, and
+//         compares its events against the recorded ones bit for bit.
+//
+//         The file is a header with the tables below, a byte coded stream
+//         of the ISR2 periods and a trailer with the emulator counts:
+//
+//         CLLC_TRACE_FileHeader
+//         CLLC_TRACE_FileInput[inputCount]       ADC result words
+//         CLLC_TRACE_FileWatch[watchCount]       as set by the emulator
+//         CLLC_TRACE_FileVariable[variableCount] watch window variables
+//         stream, ends with CLLC_TRACE_OP_END
+//         CLLC_TRACE_FileTrailer
+//
+//         Stream, values little endian:
+//         0x00-0x7F  event on watch op, same value as its last event
+//         STEP       start of an ISR2 period
+//         VARIABLE   u8 variable, u32 value, written from outside the ISRs
+//         INPUT      u8 first input, u8 count, u16 value for all of them
+//         EVENT      u8 watch, u16 or u32 value (width of the watch)
+//         PRIOR      u8 watch, same value as its event before the last
+//         SAME       u8 watch, same value as the event just before
+//         ISR + n    the events that follow were issued by CLLC_EMU_ISRn
+//
+//         The strobes repeat their value and the CMPC arm and park toggle,
+//         so in a settled period most events take one or two bytes.
+//
+//#############################################################################
+
+#ifndef CLLC_TRACE_H
+#define CLLC_TRACE_H
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+//
+// the includes
+//
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "cllc_emu.h"
+
+//
+// Defines
+//
+#define CLLC_TRACE_MAGIC            "CLLCTR1"
+#define CLLC_TRACE_END_MAGIC        "CLLCEND"
+
+#define CLLC_TRACE_MAX_INPUTS       64
+#define CLLC_TRACE_MAX_WATCHES      128
+#define CLLC_TRACE_MAX_VARIABLES    32
+#define CLLC_TRACE_MAX_STEP_EVENTS  1024
+
+#define CLLC_TRACE_OP_REPEAT_LAST   0x7FU
+#define CLLC_TRACE_OP_STEP          0xC0U
+#define CLLC_TRACE_OP_VARIABLE      0xC1U
+#define CLLC_TRACE_OP_INPUT         0xC2U
+#define CLLC_TRACE_OP_EVENT         0xC3U
+#define CLLC_TRACE_OP_PRIOR         0xC4U
+#define CLLC_TRACE_OP_SAME          0xC5U
+#define CLLC_TRACE_OP_ISR           0xC8U
+#define CLLC_TRACE_OP_END           0xFFU
+
+#define CLLC_TRACE_BUFFER_BYTES     65536U
+
+//
+// typedefs
+//
+typedef struct
+{
+    char magic[8];
+    uint32_t lab;
+    uint32_t isr2Frequency_Hz;
+    uint32_t inputCount;
+    uint32_t watchCount;
+    uint32_t variableCount;
+    uint32_t reserved;
+} CLLC_TRACE_FileHeader;
+
+typedef struct
+{
+    uint32_t address;
+    uint32_t initial;
+} CLLC_TRACE_FileInput;
+
+typedef struct
+{
+    uint32_t address;
+    uint16_t width;
+    uint16_t action;
+    char name[CLLC_EMU_NAME_LENGTH];
+    uint32_t initial;
+} CLLC_TRACE_FileWatch;
+
+typedef struct
+{
+    char name[CLLC_EMU_NAME_LENGTH];
+    uint32_t size;
+    uint32_t initial;
+} CLLC_TRACE_FileVariable;
+
+typedef struct
+{
+    uint32_t steps;
+    uint32_t isr1Count;
+    uint32_t isr2Count;
+    uint32_t isr3Count;
+    uint32_t eventCount;
+    uint32_t reserved;
+    char magic[8];
+} CLLC_TRACE_FileTrailer;
+
+//
+// Value history of the watches, kept the same way by the writer and the
+// reader so that the short event codes resolve to the same values
+//
+typedef struct
+{
+    uint32_t last[CLLC_TRACE_MAX_WATCHES];
+    uint32_t prior[CLLC_TRACE_MAX_WATCHES];
+    uint32_t previousEvent;
+    uint16_t isr;
+} CLLC_TRACE_History;
+
+typedef struct
+{
+    uint16_t isr;
+    uint16_t watch;
+    uint32_t value;
+} CLLC_TRACE_Event;
+
+typedef struct
+{
+    FILE *file;
+    uint8_t buffer[CLLC_TRACE_BUFFER_BYTES];
+    uint32_t fill;
+    uint16_t inputCount;
+    uint16_t watchCount;
+    uint16_t error;
+    uint16_t input[CLLC_TRACE_MAX_INPUTS];
+    uint32_t variable[CLLC_TRACE_MAX_VARIABLES];
+    uint16_t watchWidth[CLLC_TRACE_MAX_WATCHES];
+    CLLC_TRACE_History history;
+    CLLC_EMU_SampleHook plantHook;
+    void *plantContext;
+    uint64_t bytes;
+} CLLC_TRACE_Writer;
+
+typedef struct
+{
+    uint32_t steps;
+    uint32_t events;
+    uint32_t mismatchSteps;     // ISR2 periods whose events differ
+    uint32_t firstMismatchStep;
+    uint16_t initMismatch;      // watches that differ after the bring-up
+    uint16_t countMismatch;     // the emulator counts differ from the trailer
+    uint16_t error;             // the stream is malformed or truncated
+} CLLC_TRACE_Result;
+
+typedef struct
+{
+    const uint8_t *base;
+    size_t size;
+    const CLLC_TRACE_FileHeader *header;
+    const CLLC_TRACE_FileInput *input;
+    const CLLC_TRACE_FileWatch *watch;
+    const CLLC_TRACE_FileVariable *variable;
+    const CLLC_TRACE_FileTrailer *trailer;
+    const uint8_t *stream;
+    const uint8_t *p;
+    const uint8_t *end;
+    CLLC_TRACE_History history;
+    CLLC_TRACE_Event actual[CLLC_TRACE_MAX_STEP_EVENTS];
+    uint32_t actualCount;
+    uint16_t stepPending;
+    uint16_t divergent;         // plain registers differ from the trace
+    uint32_t maxReports;
+    CLLC_TRACE_Result result;
+} CLLC_TRACE_Reader;
+
+//
+// the function prototypes
+//
+int16_t CLLC_TRACE_openWriter(CLLC_TRACE_Writer *writer, const char *path);
+int16_t CLLC_TRACE_closeWriter(CLLC_TRACE_Writer *writer);
+
+int16_t CLLC_TRACE_openReader(CLLC_TRACE_Reader *reader, const char *path);
+void CLLC_TRACE_closeReader(CLLC_TRACE_Reader *reader);
+int16_t CLLC_TRACE_replay(CLLC_TRACE_Reader *reader, uint32_t maxReports);
+void CLLC_TRACE_dump(CLLC_TRACE_Reader *reader, uint32_t firstStep,
+                     uint32_t stepCount);
+
+#ifdef __cplusplus
+}
+#endif                                  /* extern "C" */
+#endif
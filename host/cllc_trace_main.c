@@ -0,0 +1,385 @@
+//#############################################################################
+//
+// FILE:   cllc_trace_main.c
+//
+// TITLE:  Golden trace runner
+//         Records a golden trace (cllc_trace.h) of the firmware against a
+//         plant model, replays a trace against the firmware of this build
+//         and reports every ISR2 period whose register writes differ, or
+//         prints the periods of a trace.
+//
+//         The recording brings the lab up as cllc_sweep does: release, half
+//         the run open loop, close the loop (CLLC_EMU_closeLoop) and run the
+//         rest, with an optional load step in the plant.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -include host/cllc_emu_target.h -I. -Icllc -Ihost -Idevice
+//             -Idevice/driverlib -Ilibraries
+//             host/cllc_emu.c host/cllc_emu_firmware.c host/cllc_trace.c
+//             host/cllc_trace_main.c host/cllc_plant_sw.c
+//             host/cllc_plant_fha.c cllc/cllc.c cllc/cllc_hal.c
+//             $(DRIVERLIB) -lm -o cllc_trace
+//         with DRIVERLIB the driverlib sources listed in host/README.md
+//
+//         Usage:
+//         cllc_trace -w file [-p sw|fha] [-n steps] [-v volts] [-l percent]
+//                    [-L step:percent] [-k substeps]
+//         cllc_trace -r file [-m reports]
+//         cllc_trace -d file [-f first] [-c count]
+//           -w  record a trace
+//           -p  plant model of the recording, default fha
+//           -n  ISR2 periods to record (default 1 s, plus the precharge
+//               for prim to sec)
+//           -v  primary bus voltage, as for cllc_sweep (default nominal)
+//           -l  load in percent of rated power (default 50)
+//           -L  change the load to percent at the given ISR2 period
+//           -k  substeps per switching period of the switching model
+//           -r  replay a trace, the exit status is 0 only if every period
+//               matches
+//           -m  differing periods to print (default 20)
+//           -d  print the periods first to first + count - 1 of a trace
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "cllc.h"
+#include "cllc_emu.h"
+#include "cllc_trace.h"
+#include "cllc_plant_sw.h"
+#include "cllc_plant_fha.h"
+
+typedef struct
+{
+    const char *plantName;
+    uint32_t steps;
+    float64_t vPrim_Volts;
+    float64_t loadFraction;
+    uint32_t loadStep;
+    float64_t loadStepFraction;
+    uint16_t substeps;
+} CLLC_TRACE_Config;
+
+static CLLC_PLANT_SW_Plant CLLC_TRACE_plantSw;
+static CLLC_PLANT_FHA_Plant CLLC_TRACE_plantFha;
+static CLLC_TRACE_Writer CLLC_TRACE_writer;
+static CLLC_TRACE_Reader CLLC_TRACE_reader;
+
+static double CLLC_TRACE_now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9));
+}
+
+static float64_t CLLC_TRACE_getLoad_Ohms(float64_t loadFraction)
+{
+    float64_t vOut;
+
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+        vOut = (float64_t)CLLC_VPRIM_NOMINAL_VOLTS;
+    #else
+        vOut = (float64_t)CLLC_VSEC_NOMINAL_VOLTS;
+    #endif
+
+    if(loadFraction <= 0.0)
+    {
+        return(INFINITY);
+    }
+    return((vOut * vOut) / (loadFraction * CLLC_PLANT_RATED_POWER_W));
+}
+
+static int CLLC_TRACE_record(const CLLC_TRACE_Config *config,
+                             const char *path)
+{
+    CLLC_PLANT_SW_Params swParams;
+    CLLC_PLANT_FHA_Params fhaParams;
+    uint16_t useSw;
+    uint32_t done;
+    double start, elapsed;
+
+    useSw = (strcmp(config->plantName, "sw") == 0);
+    if(!useSw && (strcmp(config->plantName, "fha") != 0))
+    {
+        fprintf(stderr, "unknown plant %s\n", config->plantName);
+        return(1);
+    }
+
+    CLLC_EMU_initFirmware();
+
+    CLLC_PLANT_SW_setDefaultParams(&swParams);
+    CLLC_PLANT_FHA_setDefaultParams(&fhaParams);
+    swParams.rLoad_Ohms = CLLC_TRACE_getLoad_Ohms(config->loadFraction);
+    fhaParams.rLoad_Ohms = swParams.rLoad_Ohms;
+    if(config->substeps != 0U)
+    {
+        swParams.substepsPerPeriod = config->substeps;
+    }
+
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM
+        #if CLLC_INCR_BUILD == CLLC_CLOSED_LOOP_BUILD
+            CLLC_vPrimRef_Volts = (float32_t)config->vPrim_Volts;
+        #else
+            swParams.vSecSource_Volts = config->vPrim_Volts /
+                                        swParams.turnsRatio;
+            fhaParams.vSecSource_Volts = config->vPrim_Volts /
+                                         fhaParams.turnsRatio;
+        #endif
+    #else
+        swParams.vPrimSource_Volts = config->vPrim_Volts;
+        fhaParams.vPrimSource_Volts = config->vPrim_Volts;
+    #endif
+
+    if(useSw)
+    {
+        CLLC_PLANT_SW_init(&CLLC_TRACE_plantSw, &swParams);
+        CLLC_EMU_setSampleHook(&CLLC_PLANT_SW_sampleHook,
+                               &CLLC_TRACE_plantSw);
+    }
+    else
+    {
+        CLLC_PLANT_FHA_init(&CLLC_TRACE_plantFha, &fhaParams);
+        CLLC_EMU_setSampleHook(&CLLC_PLANT_FHA_sampleHook,
+                               &CLLC_TRACE_plantFha);
+    }
+
+    if(CLLC_TRACE_openWriter(&CLLC_TRACE_writer, path) != 0)
+    {
+        return(1);
+    }
+
+    start = CLLC_TRACE_now_s();
+
+    CLLC_EMU_startFirmware();
+
+    for(done = 1; done < config->steps; done++)
+    {
+        if(done == (config->steps / 2U))
+        {
+            CLLC_EMU_closeLoop();
+        }
+
+        if(done == config->loadStep)
+        {
+            if(useSw)
+            {
+                CLLC_PLANT_SW_setLoad(&CLLC_TRACE_plantSw,
+                        CLLC_TRACE_getLoad_Ohms(config->loadStepFraction));
+            }
+            else
+            {
+                CLLC_PLANT_FHA_setLoad(&CLLC_TRACE_plantFha,
+                        CLLC_TRACE_getLoad_Ohms(config->loadStepFraction));
+            }
+        }
+
+        CLLC_EMU_step();
+    }
+
+    if(CLLC_TRACE_closeWriter(&CLLC_TRACE_writer) != 0)
+    {
+        fprintf(stderr, "trace: writing %s failed\n", path);
+        return(1);
+    }
+
+    elapsed = CLLC_TRACE_now_s() - start;
+
+    fprintf(stderr, "lab %d: %lu ISR2 periods, %lu events, %.1f MB "
+            "(%.1f bytes per period) in %.2f s\n", CLLC_LAB,
+            (unsigned long)CLLC_EMU_stats.step,
+            (unsigned long)CLLC_EMU_stats.eventCount,
+            (double)CLLC_TRACE_writer.bytes * 1e-6,
+            (double)CLLC_TRACE_writer.bytes / (double)CLLC_EMU_stats.step,
+            elapsed);
+
+    return(0);
+}
+
+static int CLLC_TRACE_runReplay(const char *path, uint32_t maxReports)
+{
+    CLLC_TRACE_Reader *reader = &CLLC_TRACE_reader;
+    const CLLC_TRACE_Result *result = &reader->result;
+    double start, elapsed;
+    int status;
+
+    if(CLLC_TRACE_openReader(reader, path) != 0)
+    {
+        return(2);
+    }
+
+    start = CLLC_TRACE_now_s();
+
+    if(CLLC_TRACE_replay(reader, maxReports) != 0)
+    {
+        CLLC_TRACE_closeReader(reader);
+        return(2);
+    }
+
+    elapsed = CLLC_TRACE_now_s() - start;
+
+    if(result->error)
+    {
+        fprintf(stderr, "trace: malformed after ISR2 period %lu\n",
+                (unsigned long)result->steps);
+        status = 2;
+    }
+    else if((result->mismatchSteps != 0U) || (result->initMismatch != 0U) ||
+            result->countMismatch)
+    {
+        fprintf(stderr, "lab %d: MISMATCH, %lu of %lu ISR2 periods differ",
+                CLLC_LAB, (unsigned long)result->mismatchSteps,
+                (unsigned long)result->steps);
+        if(result->mismatchSteps != 0U)
+        {
+            fprintf(stderr, ", first at %lu",
+                    (unsigned long)result->firstMismatchStep);
+        }
+        if(result->initMismatch != 0U)
+        {
+            fprintf(stderr, ", %u registers differ after the bring-up",
+                    result->initMismatch);
+        }
+        if(result->countMismatch)
+        {
+            fprintf(stderr, ", ISR or event counts differ");
+        }
+        fprintf(stderr, "\n");
+        status = 1;
+    }
+    else
+    {
+        fprintf(stderr, "lab %d: match, %lu ISR2 periods, %lu events\n",
+                CLLC_LAB, (unsigned long)result->steps,
+                (unsigned long)result->events);
+        status = 0;
+    }
+
+    fprintf(stderr, "%.2f s, %.2f M ISR2 periods per second\n", elapsed,
+            ((double)result->steps / elapsed) * 1e-6);
+
+    CLLC_TRACE_closeReader(reader);
+    return(status);
+}
+
+int main(int argc, char *argv[])
+{
+    CLLC_TRACE_Config config;
+    const char *writePath = NULL;
+    const char *readPath = NULL;
+    const char *dumpPath = NULL;
+    uint32_t maxReports = 20;
+    uint32_t first = 0;
+    uint32_t count = 1;
+    double loadStepPercent;
+    int status;
+    int i;
+
+    config.plantName = "fha";
+    config.steps = (uint32_t)CLLC_ISR2_FREQUENCY_HZ;
+    #if CLLC_POWER_FLOW == CLLC_POWER_FLOW_PRIM_SEC
+        config.steps += (uint32_t)CLLC_CONTROL_PRECHARGE_COUNT;
+    #endif
+    config.vPrim_Volts = (float64_t)CLLC_VPRIM_NOMINAL_VOLTS;
+    config.loadFraction = 0.5;
+    config.loadStep = 0xFFFFFFFFU;
+    config.loadStepFraction = 0.5;
+    config.substeps = 0;
+
+    for(i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "-w") == 0) && ((i + 1) < argc))
+        {
+            writePath = argv[++i];
+        }
+        else if((strcmp(argv[i], "-r") == 0) && ((i + 1) < argc))
+        {
+            readPath = argv[++i];
+        }
+        else if((strcmp(argv[i], "-d") == 0) && ((i + 1) < argc))
+        {
+            dumpPath = argv[++i];
+        }
+        else if((strcmp(argv[i], "-p") == 0) && ((i + 1) < argc))
+        {
+            config.plantName = argv[++i];
+        }
+        else if((strcmp(argv[i], "-n") == 0) && ((i + 1) < argc))
+        {
+            config.steps = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-v") == 0) && ((i + 1) < argc))
+        {
+            config.vPrim_Volts = strtod(argv[++i], NULL);
+        }
+        else if((strcmp(argv[i], "-l") == 0) && ((i + 1) < argc))
+        {
+            config.loadFraction = strtod(argv[++i], NULL) * 0.01;
+        }
+        else if((strcmp(argv[i], "-L") == 0) && ((i + 1) < argc) &&
+                (sscanf(argv[i + 1], "%u:%lf", &config.loadStep,
+                        &loadStepPercent) == 2))
+        {
+            config.loadStepFraction = loadStepPercent * 0.01;
+            i++;
+        }
+        else if((strcmp(argv[i], "-k") == 0) && ((i + 1) < argc))
+        {
+            config.substeps = (uint16_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-m") == 0) && ((i + 1) < argc))
+        {
+            maxReports = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-f") == 0) && ((i + 1) < argc))
+        {
+            first = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if((strcmp(argv[i], "-c") == 0) && ((i + 1) < argc))
+        {
+            count = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else
+        {
+            writePath = NULL;
+            readPath = NULL;
+            dumpPath = NULL;
+            break;
+        }
+    }
+
+    if((writePath != NULL) + (readPath != NULL) + (dumpPath != NULL) != 1)
+    {
+        fprintf(stderr, "usage: %s -w file [-p sw|fha] [-n steps] "
+                "[-v volts] [-l percent] [-L step:percent] [-k substeps]\n"
+                "       %s -r file [-m reports]\n"
+                "       %s -d file [-f first] [-c count]\n",
+                argv[0], argv[0], argv[0]);
+        return(2);
+    }
+
+    if(writePath != NULL)
+    {
+        status = CLLC_TRACE_record(&config, writePath);
+    }
+    else if(readPath != NULL)
+    {
+        status = CLLC_TRACE_runReplay(readPath, maxReports);
+    }
+    else
+    {
+        status = 2;
+        if(CLLC_TRACE_openReader(&CLLC_TRACE_reader, dumpPath) == 0)
+        {
+            CLLC_TRACE_dump(&CLLC_TRACE_reader, first, count);
+            CLLC_TRACE_closeReader(&CLLC_TRACE_reader);
+            status = 0;
+        }
+    }
+
+    return(status);
+}
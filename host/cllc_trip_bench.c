@@ -0,0 +1,162 @@
+//#############################################################################
+//
+// FILE:   cllc_trip_bench.c
+//
+// TITLE:  Register accesses of ISR2 and check of the trip decoding
+//         Runs the firmware in the emulator built to count register
+//         accesses and reports the accesses of ISR2 with no trip, the mean
+//         and the worst case, as CLLC_TRIP_DECODE was built. The trip flag
+//         reads of the ISR2 decoding are peripheral frame accesses on the
+//         device, which the event decoding takes out of ISR2. Then raises a
+//         board trip and checks that it is decoded where CLLC_TRIP_DECODE
+//         says: CLLC_tripFlag and the trip counter set and, with
+//         CLLC_TRIP_DECODE_EVENT, the cause and time latched in
+//         CLLC_tripEvent by the trip zone interrupt before the next ISR2. A
+//         second trip on the latched one-shot flag must raise no interrupt,
+//         one after the clear trip must, and must leave the first trip
+//         latched.
+//
+//         Build (from the project root, see host/README.md):
+//         gcc -O2 -std=gnu99 -fno-strict-aliasing -Wno-unknown-pragmas
+//             -DCLLC_EMU_COUNT_ACCESSES -include host/cllc_emu_target.h
+//             -I. -Icllc -Ihost -Idevice -Idevice/driverlib -Ilibraries
+//             host/cllc_emu.c host/cllc_emu_firmware.c
+//             host/cllc_trip_bench.c cllc/cllc.c cllc/cllc_hal.c
+//             $(DRIVERLIB) -lm -o cllc_trip_bench
+//         with DRIVERLIB the driverlib sources listed in host/README.md,
+//         add -DCLLC_TRIP_DECODE=0 for the ISR2 decoding.
+//
+//         Usage:
+//         cllc_trip_bench [-n steps]
+//           -n  ISR2 periods to run before the trip (default 120000)
+//
+//         Exits 0 when all checks pass.
+//
+//#############################################################################
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cllc.h"
+#include "cllc_emu.h"
+#include "cllc_check.h"
+
+#ifndef CLLC_EMU_COUNT_ACCESSES
+#error "build with -DCLLC_EMU_COUNT_ACCESSES"
+#endif
+
+//
+// the globals
+//
+static const char *CLLC_TRIP_BENCH_decodeName[] = {"ISR2", "background",
+                                                   "event"};
+
+static void CLLC_TRIP_BENCH_printISR2(const char *when)
+{
+    const CLLC_EMU_AccessStats *a = &CLLC_EMU_accesses[CLLC_EMU_ISR2];
+
+    printf("ISR2 register accesses %s: mean %.1f, max %lu over %lu runs\n",
+           when, (a->runs != 0U) ? (double)a->total / (double)a->runs : 0.0,
+           (unsigned long)a->max, (unsigned long)a->runs);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t steps = (uint32_t)CLLC_ISR2_FREQUENCY_HZ;
+#if CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_EVENT
+    uint32_t isr2Count;
+#endif
+    int arg;
+
+    for(arg = 1; arg < argc; arg++)
+    {
+        if((strcmp(argv[arg], "-n") == 0) && (arg + 1 < argc))
+        {
+            steps = (uint32_t)strtoul(argv[++arg], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n steps]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    printf("lab %d, trip decoding in %s\n", CLLC_LAB,
+           CLLC_TRIP_BENCH_decodeName[CLLC_TRIP_DECODE]);
+
+    CLLC_EMU_initFirmware();
+    CLLC_EMU_startFirmware();
+    memset(CLLC_EMU_accesses, 0, sizeof(CLLC_EMU_accesses));
+    CLLC_EMU_run(steps);
+    CLLC_TRIP_BENCH_printISR2("with no trip");
+
+    //
+    // the first trip
+    //
+#if CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_EVENT
+    isr2Count = CLLC_stats.isr2Count;
+    CLLC_EMU_raiseTrip(CLLC_IPRIM_CMPSS_XBAR_FLAG1);
+
+    CLLC_CHECK_expect("trip zone interrupts",
+                      CLLC_EMU_accesses[CLLC_EMU_ISR_TRIP].runs, 1);
+    CLLC_CHECK_expect("events", CLLC_tripEvent.events, 1);
+    CLLC_CHECK_expect("source", CLLC_tripEvent.source,
+                      CLLC_primOverCurrentTrip);
+    CLLC_CHECK_expect("cause", CLLC_tripEvent.cause,
+                      CLLC_primOverCurrentTrip);
+    CLLC_CHECK_expect("ISR2 run", CLLC_tripEvent.isr2Count, isr2Count);
+    CLLC_CHECK_expect("interrupt flag",
+                      HWREGH(CLLC_TRIP_EVENT_PWM_BASE + EPWM_O_TZFLG) &
+                      EPWM_TZFLG_INT, 0);
+    printf("trip zone interrupt register accesses: %lu\n",
+           (unsigned long)CLLC_EMU_accesses[CLLC_EMU_ISR_TRIP].max);
+#elif CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_ISR2
+    CLLC_EMU_raiseTrip(CLLC_IPRIM_CMPSS_XBAR_FLAG1);
+    CLLC_EMU_step();
+#else
+    //
+    // the frame A task, the background loop does not run in the emulator
+    //
+    CLLC_EMU_raiseTrip(CLLC_IPRIM_CMPSS_XBAR_FLAG1);
+    CLLC_updateBoardStatus();
+#endif
+
+#if (CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_ISR2) && \
+    (CLLC_POWER_FLOW == CLLC_POWER_FLOW_SEC_PRIM)
+    //
+    // ISR2 of the sec to prim labs never decoded the trips
+    //
+    CLLC_CHECK_expect("trip flag", CLLC_tripFlag.CLLC_TripFlag_Enum,
+                      CLLC_noTrip);
+#else
+    CLLC_CHECK_expect("trip flag", CLLC_tripFlag.CLLC_TripFlag_Enum,
+                      CLLC_primOverCurrentTrip);
+    CLLC_CHECK_expect("trips counted", CLLC_stats.tripPrimOverCurrent,
+                      1);
+#endif
+
+    memset(CLLC_EMU_accesses, 0, sizeof(CLLC_EMU_accesses));
+    CLLC_EMU_run(steps / 10U);
+    CLLC_TRIP_BENCH_printISR2("tripped");
+
+#if CLLC_TRIP_DECODE == CLLC_TRIP_DECODE_EVENT
+    //
+    // on the latched one-shot flag no interrupt, after the clear trip one
+    //
+    CLLC_EMU_raiseTrip(CLLC_IPRIM_CMPSS_XBAR_FLAG1);
+    CLLC_CHECK_expect("events on the latched trip",
+                      CLLC_tripEvent.events, 1);
+
+    CLLC_EMU_clearTrip();
+    CLLC_EMU_step();
+    CLLC_EMU_raiseTrip(CLLC_IPRIM_CMPSS_XBAR_FLAG1);
+    CLLC_CHECK_expect("events after the clear", CLLC_tripEvent.events,
+                      2);
+    CLLC_CHECK_expect("first ISR2 run kept", CLLC_tripEvent.isr2Count,
+                      isr2Count);
+    CLLC_CHECK_expect("trips counted after the clear",
+                      CLLC_stats.tripPrimOverCurrent, 1);
+#endif
+
+    return(CLLC_CHECK_result());
+}